@@ -0,0 +1,244 @@
+# PatchSdCondCache.cmake
+#
+# Adds a conditioning cache hook to stable-diffusion.cpp. Every prompt
+# encode (cond_stage_model->get_learned_condition in stable-diffusion.cpp)
+# goes through Conditioner::get_learned_condition_cached, which asks the
+# hooks installed by sd_set_cond_cache_hooks() for a stored result first
+# and hands new results to them. The restapi side is ConditioningCache
+# (bounded LRU) wired up by SDWrapper.
+#
+# The conditioning tensors are copied out of, and back into, the per-call
+# work context as a flat blob, so nothing outlives generate_image() on the
+# sd.cpp side. Prompts with image inputs (PhotoMaker, Qwen-Image-Edit
+# reference images) and SDCondition layouts other than the three tensors
+# the blob holds always run the encoder.
+#
+# Included (not run with -P) so it can report back: sets SDCPP_COND_CACHE
+# to TRUE when the hook is in the sources. When sd.cpp's conditioner no
+# longer looks the way this patch expects, it warns and leaves the sources
+# alone; the server then builds without the cache.
+#
+# Idempotent: re-running on already-patched sources is a no-op.
+#
+# Required input variables:
+#   SD_HEADER_PATH — stable-diffusion.h
+#   SD_CPP_PATH    — stable-diffusion.cpp
+#   SD_COND_PATH   — conditioner.hpp
+
+set(SDCPP_COND_CACHE FALSE)
+
+set(_COND_SENTINEL "SDCPP_COND_CACHE_PATCH_APPLIED")
+
+file(READ "${SD_HEADER_PATH}" _COND_HEADER)
+file(READ "${SD_CPP_PATH}" _COND_CPP)
+file(READ "${SD_COND_PATH}" _COND_CONDITIONER)
+
+string(FIND "${_COND_CONDITIONER}" "${_COND_SENTINEL}" _COND_DONE)
+if(NOT _COND_DONE EQUAL -1)
+    message(STATUS "PatchSdCondCache: already applied")
+    set(SDCPP_COND_CACHE TRUE)
+    return()
+endif()
+
+# What the hook relies on: the encode entry point's signature, the
+# ConditionerParams fields in the key, the declaration the header hook
+# goes after (added by the sd_get_model_version_name patch) and at least
+# one call site to route through the cache.
+set(_COND_MISSING "")
+string(REGEX MATCH
+    "virtual SDCondition get_learned_condition\\(ggml_context\\* work_ctx,[ \t\r\n]*int n_threads,[ \t\r\n]*const ConditionerParams&"
+    _COND_SIGNATURE "${_COND_CONDITIONER}")
+if(NOT _COND_SIGNATURE)
+    list(APPEND _COND_MISSING "get_learned_condition(work_ctx, n_threads, ConditionerParams)")
+endif()
+foreach(_needle "struct Conditioner {" "struct ConditionerParams" "std::string text"
+                "clip_skip" "adm_in_channels" "zero_out_masked" "num_input_imgs" "ref_images")
+    string(FIND "${_COND_CONDITIONER}" "${_needle}" _pos)
+    if(_pos EQUAL -1)
+        list(APPEND _COND_MISSING "${_needle}")
+    endif()
+endforeach()
+set(_COND_HEADER_ANCHOR "SD_API const char* sd_get_model_version_name(const sd_ctx_t* sd_ctx);")
+string(FIND "${_COND_HEADER}" "${_COND_HEADER_ANCHOR}" _pos)
+if(_pos EQUAL -1)
+    list(APPEND _COND_MISSING "sd_get_model_version_name declaration")
+endif()
+set(_COND_CALL "cond_stage_model->get_learned_condition(")
+string(FIND "${_COND_CPP}" "${_COND_CALL}" _pos)
+if(_pos EQUAL -1)
+    list(APPEND _COND_MISSING "${_COND_CALL} call sites")
+endif()
+
+if(_COND_MISSING)
+    string(REPLACE ";" ", " _COND_MISSING "${_COND_MISSING}")
+    message(WARNING
+        "PatchSdCondCache: sd.cpp sources don't match the patch (missing: ${_COND_MISSING}). "
+        "Building without the conditioning cache — adjust cmake/PatchSdCondCache.cmake.")
+    return()
+endif()
+
+# Header: the C API that installs the hooks
+# (A bracket argument drops the newline right after its opening bracket)
+set(_COND_HEADER_HOOK [=[
+
+
+// SDCPP_COND_CACHE_PATCH_APPLIED — conditioning cache hooks (sdcpp-restapi).
+// fetch: return true and point *data / *size at the blob stored under key;
+// it must stay valid until the next fetch on the calling thread.
+// store: keep a copy of the blob for key. Null fetch turns the cache off.
+typedef bool (*sd_cond_fetch_cb_t)(const char* key, const void** data, size_t* size, void* user);
+typedef void (*sd_cond_store_cb_t)(const char* key, const void* data, size_t size, void* user);
+SD_API void sd_set_cond_cache_hooks(sd_cond_fetch_cb_t fetch, sd_cond_store_cb_t store, void* user);]=])
+string(REPLACE "${_COND_HEADER_ANCHOR}" "${_COND_HEADER_ANCHOR}${_COND_HEADER_HOOK}"
+    _COND_HEADER "${_COND_HEADER}")
+
+# Conditioner: hook storage, blob (de)serialization and the cached entry point
+set(_COND_HELPERS [=[// SDCPP_COND_CACHE_PATCH_APPLIED — see sd_set_cond_cache_hooks()
+#include <cstring>
+#include <type_traits>
+
+struct SDCondCacheHooks {
+    bool (*fetch)(const char* key, const void** data, size_t* size, void* user) = nullptr;
+    void (*store)(const char* key, const void* data, size_t size, void* user) = nullptr;
+    void* user = nullptr;
+};
+inline SDCondCacheHooks sd_cond_cache_hooks;
+
+namespace sd_cond_cache {
+
+template <typename T>
+inline bool has_items(const T& v) {
+    if constexpr (std::is_pointer_v<T>) {
+        return v != nullptr && !v->empty();
+    } else {
+        return !v.empty();
+    }
+}
+
+// Everything besides the weights that the encode result depends on
+inline std::string key(const ConditionerParams& p) {
+    return p.text + '\x1f' + std::to_string(p.clip_skip) + ',' + std::to_string(p.width) + 'x' +
+           std::to_string(p.height) + ',' + std::to_string(p.adm_in_channels) + (p.zero_out_masked ? ",z" : "");
+}
+
+// Blob: per tensor (c_crossattn, c_vector, c_concat) an int32 presence flag,
+// then int32 type, int64 ne[GGML_MAX_DIMS], uint64 byte count and the data
+inline bool pack(const SDCondition& cond, std::string& out) {
+    const ggml_tensor* tensors[3] = {cond.c_crossattn, cond.c_vector, cond.c_concat};
+    for (const ggml_tensor* t : tensors) {
+        int32_t present = t != nullptr ? 1 : 0;
+        out.append(reinterpret_cast<const char*>(&present), sizeof(present));
+        if (t == nullptr) continue;
+        if (t->data == nullptr || !ggml_is_contiguous(t)) return false;
+        if (t->buffer != nullptr && !ggml_backend_buffer_is_host(t->buffer)) return false;
+        int32_t type = static_cast<int32_t>(t->type);
+        uint64_t nbytes = ggml_nbytes(t);
+        out.append(reinterpret_cast<const char*>(&type), sizeof(type));
+        out.append(reinterpret_cast<const char*>(t->ne), sizeof(t->ne));
+        out.append(reinterpret_cast<const char*>(&nbytes), sizeof(nbytes));
+        out.append(static_cast<const char*>(t->data), nbytes);
+    }
+    return true;
+}
+
+// Checks the whole blob before allocating, so a bad one costs no work_ctx memory
+inline bool unpack(ggml_context* ctx, const void* data, size_t size, SDCondition& cond) {
+    struct Slot {
+        bool present = false;
+        int32_t type = 0;
+        int64_t ne[GGML_MAX_DIMS] = {};
+        uint64_t nbytes = 0;
+        const char* bytes = nullptr;
+    } slots[3];
+    const char* p = static_cast<const char*>(data);
+    const char* end = p + size;
+    auto read = [&](void* dst, size_t n) {
+        if (static_cast<size_t>(end - p) < n) return false;
+        std::memcpy(dst, p, n);
+        p += n;
+        return true;
+    };
+    for (Slot& s : slots) {
+        int32_t present = 0;
+        if (!read(&present, sizeof(present))) return false;
+        s.present = present != 0;
+        if (!s.present) continue;
+        if (!read(&s.type, sizeof(s.type)) || !read(s.ne, sizeof(s.ne)) || !read(&s.nbytes, sizeof(s.nbytes))) {
+            return false;
+        }
+        if (s.type < 0 || s.type >= GGML_TYPE_COUNT || static_cast<uint64_t>(end - p) < s.nbytes) return false;
+        s.bytes = p;
+        p += s.nbytes;
+    }
+    if (p != end) return false;
+
+    ggml_tensor** targets[3] = {&cond.c_crossattn, &cond.c_vector, &cond.c_concat};
+    for (int i = 0; i < 3; ++i) {
+        const Slot& s = slots[i];
+        if (!s.present) {
+            *targets[i] = nullptr;
+            continue;
+        }
+        ggml_tensor* t = ggml_new_tensor(ctx, static_cast<ggml_type>(s.type), GGML_MAX_DIMS, s.ne);
+        if (t == nullptr || t->data == nullptr || ggml_nbytes(t) != s.nbytes) return false;
+        std::memcpy(t->data, s.bytes, s.nbytes);
+        *targets[i] = t;
+    }
+    return true;
+}
+
+}  // namespace sd_cond_cache
+
+struct Conditioner {
+    // get_learned_condition() through sd_cond_cache_hooks. Encodes that
+    // depend on images, and SDCondition layouts the blob doesn't cover,
+    // always run the encoder.
+    SDCondition get_learned_condition_cached(ggml_context* work_ctx,
+                                             int n_threads,
+                                             const ConditionerParams& params) {
+        const SDCondCacheHooks& hooks = sd_cond_cache_hooks;
+        const bool cacheable = hooks.fetch != nullptr &&
+                               sizeof(SDCondition) == 3 * sizeof(ggml_tensor*) &&
+                               !ggml_get_no_alloc(work_ctx) &&
+                               params.num_input_imgs == 0 &&
+                               !sd_cond_cache::has_items(params.ref_images);
+        if (!cacheable) {
+            return get_learned_condition(work_ctx, n_threads, params);
+        }
+        const std::string key = sd_cond_cache::key(params);
+        const void* data      = nullptr;
+        size_t size           = 0;
+        if (hooks.fetch(key.c_str(), &data, &size, hooks.user)) {
+            SDCondition cached;
+            if (sd_cond_cache::unpack(work_ctx, data, size, cached)) {
+                return cached;
+            }
+        }
+        SDCondition cond = get_learned_condition(work_ctx, n_threads, params);
+        std::string blob;
+        if (hooks.store != nullptr && sd_cond_cache::pack(cond, blob)) {
+            hooks.store(key.c_str(), blob.data(), blob.size(), hooks.user);
+        }
+        return cond;
+    }
+]=])
+string(REPLACE "struct Conditioner {" "${_COND_HELPERS}" _COND_CONDITIONER "${_COND_CONDITIONER}")
+
+# Implementation: the setter, and every encode routed through the cache
+string(REPLACE "${_COND_CALL}" "cond_stage_model->get_learned_condition_cached(" _COND_CPP "${_COND_CPP}")
+string(APPEND _COND_CPP [=[
+
+
+// SDCPP_COND_CACHE_PATCH_APPLIED
+void sd_set_cond_cache_hooks(sd_cond_fetch_cb_t fetch, sd_cond_store_cb_t store, void* user) {
+    sd_cond_cache_hooks.fetch = fetch;
+    sd_cond_cache_hooks.store = store;
+    sd_cond_cache_hooks.user  = user;
+}
+]=])
+
+file(WRITE "${SD_HEADER_PATH}" "${_COND_HEADER}")
+file(WRITE "${SD_COND_PATH}" "${_COND_CONDITIONER}")
+file(WRITE "${SD_CPP_PATH}" "${_COND_CPP}")
+message(STATUS "PatchSdCondCache: applied to ${stable-diffusion_SOURCE_DIR}")
+set(SDCPP_COND_CACHE TRUE)
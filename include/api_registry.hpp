@@ -7,9 +7,13 @@
 #include <vector>
 #include <map>
 #include <functional>
+#include <memory>
+#include <mutex>
 
 namespace sdcpp {
 
+class CachedDocument;
+
 // Query parameter descriptor for GET endpoints
 struct QueryParam {
     std::string name;
@@ -117,13 +121,30 @@ public:
         int response_code,
         std::function<void(const httplib::Request&, httplib::Response&)> handler);
 
+    using ContentReaderHandler = std::function<void(const httplib::Request&, httplib::Response&,
+                                                    const httplib::ContentReader&)>;
+
+    // Register an endpoint that reads its own request body (streaming uploads);
+    // httplib hands over the body through the ContentReader instead of req.body
+    template<typename ResSchema = void>
+    EndpointBuilder addStreamingEndpoint(
+        httplib::Server& server,
+        const std::string& method,
+        const std::string& path,
+        const std::string& summary,
+        const std::string& tag,
+        int response_code,
+        ContentReaderHandler handler);
+
     // Register a schema without an endpoint (for shared components)
     void registerSchema(const std::string& name, const schema::SchemaDescriptor& desc);
 
     // Generate the complete OpenAPI 3.1 specification
     nlohmann::json generateOpenApiSpec() const;
 
-    // Register the /openapi.json endpoint on the server
+    // Register the /openapi.json endpoint on the server. The spec is built
+    // and compressed on the first fetch (every route is registered by then)
+    // and served from that copy afterwards.
     void serveOpenApiSpec(httplib::Server& server, const std::string& path = "/openapi.json");
 
 private:
@@ -133,11 +154,17 @@ private:
     // Extract path parameter names from OpenAPI-style path
     static std::vector<std::string> extract_path_params(const std::string& path);
 
-    // Register route with httplib server
+    // Register route with httplib server. Handlers are timed into the
+    // /metrics HTTP histogram under `path`, the route's OpenAPI path.
     void register_route(httplib::Server& server, const std::string& method,
-                        const std::string& pattern,
+                        const std::string& path, const std::string& pattern,
                         std::function<void(const httplib::Request&, httplib::Response&)> handler);
 
+    // Register a content-reader route (POST/PUT/PATCH/DELETE only)
+    void register_streaming_route(httplib::Server& server, const std::string& method,
+                                  const std::string& path, const std::string& pattern,
+                                  ContentReaderHandler handler);
+
     // Collect schema from a type if it has static schema()
     template<typename T>
     void collect_schema_if_available();
@@ -147,6 +174,9 @@ private:
     std::string description_;
     std::vector<EndpointEntry> endpoints_;
     std::map<std::string, schema::SchemaDescriptor> schemas_;
+
+    std::once_flag spec_once_;
+    std::shared_ptr<const CachedDocument> spec_;
 };
 
 // Template implementation
@@ -195,7 +225,42 @@ EndpointBuilder ApiRegistry::addEndpoint(
     }
 
     // Register route with httplib
-    register_route(server, method, entry.httplib_pattern, handler);
+    register_route(server, method, path, entry.httplib_pattern, handler);
+
+    endpoints_.push_back(entry);
+    return EndpointBuilder(endpoints_.back());
+}
+
+template<typename ResSchema>
+EndpointBuilder ApiRegistry::addStreamingEndpoint(
+    httplib::Server& server,
+    const std::string& method,
+    const std::string& path,
+    const std::string& summary,
+    const std::string& tag,
+    int response_code,
+    ContentReaderHandler handler)
+{
+    EndpointEntry entry;
+    entry.method = method;
+    entry.path = path;
+    entry.httplib_pattern = path_to_httplib_pattern(path);
+    entry.summary = summary;
+    entry.tag = tag;
+    entry.response_code = response_code;
+
+    if constexpr (!std::is_void_v<ResSchema>) {
+        if constexpr (schema::has_schema_v<ResSchema>) {
+            auto desc = ResSchema::schema();
+            entry.response_schema = desc.name;
+            if (schemas_.find(desc.name) == schemas_.end()) {
+                schemas_[desc.name] = desc;
+            }
+            collect_schema_if_available<ResSchema>();
+        }
+    }
+
+    register_streaming_route(server, method, path, entry.httplib_pattern, std::move(handler));
 
     endpoints_.push_back(entry);
     return EndpointBuilder(endpoints_.back());
@@ -45,13 +45,29 @@ inline const std::vector<std::string> JOB_STATUS_VALUES = {
 };
 
 inline const std::vector<std::string> JOB_TYPE_VALUES = {
-    "txt2img", "img2img", "txt2vid", "upscale", "convert", "model_download", "model_hash"
+    "txt2img", "img2img", "txt2vid", "upscale", "convert", "model_download", "model_hash", "pipeline"
+};
+
+inline const std::vector<std::string> JOB_PRIORITY_VALUES = {
+    "interactive", "normal", "batch"
 };
 
 inline const std::vector<std::string> PREVIEW_MODE_VALUES = {
     "none", "proj", "tae", "vae"
 };
 
+inline const std::vector<std::string> OUTPUT_FORMAT_VALUES = {
+    "png", "jpeg", "webp"
+};
+
+inline const std::vector<std::string> VIDEO_FORMAT_VALUES = {
+    "mp4", "webm", "avi", "none"
+};
+
+inline const std::vector<std::string> VIDEO_CODEC_VALUES = {
+    "h264", "vp9", "av1"
+};
+
 #ifdef SDCPP_EXPERIMENTAL_OFFLOAD
 inline const std::vector<std::string> OFFLOAD_MODE_VALUES = {
     "none", "cond_only", "cond_diffusion", "aggressive", "layer_streaming"
@@ -12,6 +12,7 @@ struct GenerationRequestBase {
         builder
             .required_field("prompt", schema::FieldType::String, "Text prompt for generation")
             .optional_field("title", schema::FieldType::String, "Optional display title for the queue job (free-form, shown next to the type label in the WebUI)", "")
+            .enum_field("priority", "Scheduling class of the queue job", JOB_PRIORITY_VALUES, "normal")
             .optional_field("negative_prompt", schema::FieldType::String, "Negative prompt", "")
             .arch_default_field("width", schema::FieldType::Integer, "Image width in pixels")
             .arch_default_field("height", schema::FieldType::Integer, "Image height in pixels")
@@ -88,7 +89,10 @@ struct GenerationRequestBase {
             // Post-gen ESRGAN upscale — restapi orchestration on top of sd.cpp, NOT the same as hires_*
             .optional_field("upscale", schema::FieldType::Boolean, "Auto-run a loaded ESRGAN upscaler after generation (post-gen, distinct from hires_enabled)", false)
             .optional_field("upscale_repeats", schema::FieldType::Integer, "Number of upscale passes", 1)
-            .optional_field("upscale_auto_unload", schema::FieldType::Boolean, "Unload upscaler after use", true);
+            .optional_field("upscale_auto_unload", schema::FieldType::Boolean, "Unload upscaler after use", true)
+            // Output encoding — omitted fields fall back to the server's "output" config
+            .enum_field("output_format", "Output image format (webp only when the server was built with libwebp; see /health features.webp_output)", OUTPUT_FORMAT_VALUES)
+            .optional_field("output_quality", schema::FieldType::Integer, "JPEG / lossy WebP quality 1-100 (default from server config)");
         return builder.build();
     }
 };
@@ -107,7 +111,7 @@ struct Img2ImgRequest {
     static schema::SchemaDescriptor schema() {
         return schema::SchemaBuilder("Img2ImgRequest", "Image-to-image generation request")
             .inherits("GenerationRequestBase")
-            .required_field("init_image_base64", schema::FieldType::String, "Source image as base64-encoded string")
+            .required_field("init_image_base64", schema::FieldType::String, "Source image as base64, or an output:/job: image reference")
             .optional_field("strength", schema::FieldType::Number, "Denoising strength (0.0-1.0)", 0.75)
             .optional_field("img_cfg_scale", schema::FieldType::Number, "Image CFG scale (-1 for auto)", -1.0)
             .optional_field("mask_image_base64", schema::FieldType::String, "Inpainting mask as base64 (white=inpaint)")
@@ -145,6 +149,10 @@ struct Txt2VidRequest {
             .optional_field("high_noise_slg_end", schema::FieldType::Number, "SLG end for high-noise", 0.2)
             .optional_field("moe_boundary", schema::FieldType::Number, "MoE boundary for WAN models", 0.875)
             .optional_field("vace_strength", schema::FieldType::Number, "VACE control strength", 1.0)
+            // Video file output
+            .enum_field("video_format", "Video container (default from server config; mp4/webm need FFmpeg, see /health features.video_output)", VIDEO_FORMAT_VALUES)
+            .enum_field("video_codec", "Video codec (default: h264 for mp4, vp9 for webm)", VIDEO_CODEC_VALUES)
+            .optional_field("keep_frames", schema::FieldType::Boolean, "Also write every frame as PNG (default from server config)", true)
             .build();
     }
 };
@@ -152,11 +160,30 @@ struct Txt2VidRequest {
 struct UpscaleRequest {
     static schema::SchemaDescriptor schema() {
         return schema::SchemaBuilder("UpscaleRequest", "Image upscaling request")
-            .required_field("image_base64", schema::FieldType::String, "Image to upscale as base64")
+            .required_field("image_base64", schema::FieldType::String, "Image to upscale as base64, or an output:/job: image reference")
             .optional_field("title", schema::FieldType::String, "Optional display title for the queue job", "")
+            .enum_field("priority", "Scheduling class of the queue job", JOB_PRIORITY_VALUES, "normal")
             .optional_field("upscale_factor", schema::FieldType::Integer, "Upscale factor", 4)
             .optional_field("tile_size", schema::FieldType::Integer, "Processing tile size", 128)
             .optional_field("repeats", schema::FieldType::Integer, "Number of upscale passes", 1)
+            .optional_field("pass_tile_size", schema::FieldType::Integer, "Source pixels per upscale pass (0 = auto)", 0)
+            .optional_field("tile_overlap", schema::FieldType::Integer, "Source pixels blended between neighbouring passes", 16)
+            .enum_field("output_format", "Output image format", OUTPUT_FORMAT_VALUES)
+            .optional_field("output_quality", schema::FieldType::Integer, "JPEG / lossy WebP quality 1-100")
+            .build();
+    }
+};
+
+struct PipelineRequest {
+    static schema::SchemaDescriptor schema() {
+        return schema::SchemaBuilder("PipelineRequest", "Chained generation stages that hand images to each other in memory")
+            .array_field("stages", schema::FieldType::Object,
+                         "Stages in order; each is {type: txt2img|img2img|upscale|adetailer, persist?, ...that endpoint's params}", true)
+            .optional_field("persist_intermediate", schema::FieldType::Boolean, "Also save every intermediate stage's images", false)
+            .enum_field("output_format", "Output image format", OUTPUT_FORMAT_VALUES)
+            .optional_field("output_quality", schema::FieldType::Integer, "JPEG / lossy WebP quality 1-100")
+            .optional_field("title", schema::FieldType::String, "Optional display title for the queue job", "")
+            .enum_field("priority", "Scheduling class of the queue job", JOB_PRIORITY_VALUES, "normal")
             .build();
     }
 };
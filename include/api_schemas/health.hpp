@@ -25,7 +25,10 @@ struct HealthResponse {
             .optional_field("upscaler_name", schema::FieldType::String, "Loaded upscaler name")
             .optional_field("ws_enabled", schema::FieldType::Boolean, "Whether WebSocket is enabled")
             .object_field("memory", "System/GPU memory information")
+            .object_field("model_cache", "Warm model cache stats (budget_bytes, used_bytes, hits, misses, hit_rate, evictions, entries)")
+            .object_field("image_encoders", "Encoder backend per output format (png, jpeg, webp)")
             .object_field("features", "Enabled feature flags")
+            .object_field("startup", "Startup stages behind the listener (ready, uptime_ms, stages[{name, state, gates_ready, started_ms, duration_ms, note}])")
             .build();
     }
 };
@@ -36,6 +39,7 @@ struct MemoryResponse {
             .object_field("system", "System RAM usage (total/used/free in bytes and MB)")
             .object_field("process", "Process memory (RSS and virtual)")
             .object_field("gpu", "GPU VRAM usage (if available)")
+            .object_field("model_cache", "Warm model cache stats (budget_bytes, used_bytes, hits, misses, hit_rate, evictions, entries)")
             .build();
     }
 };
@@ -32,6 +32,18 @@ struct LoadModelRequest {
     }
 };
 
+struct PrefetchModelResponse {
+    static schema::SchemaDescriptor schema() {
+        return schema::SchemaBuilder("PrefetchModelResponse", "Background read-ahead of a model's files")
+            .required_field("model_name", schema::FieldType::String, "Model being read ahead")
+            .required_field("state", schema::FieldType::String, "queued, already_queued, skipped_low_ram or loaded")
+            .optional_field("files", schema::FieldType::Integer, "Component files found")
+            .optional_field("bytes", schema::FieldType::Integer, "Their total size")
+            .optional_field("available_bytes", schema::FieldType::Integer, "Host RAM available (skipped_low_ram only)")
+            .build();
+    }
+};
+
 struct LoadOptions {
     static schema::SchemaDescriptor schema() {
         auto builder = schema::SchemaBuilder("LoadOptions", "Model loading options");
@@ -64,6 +76,11 @@ struct LoadOptions {
             .optional_field("backend", schema::FieldType::String, "Main compute backend override (empty = sd.cpp picks). Use per-component placement here too — e.g. \"diffusion=cuda0,vae=cpu\" — that's how per-component CPU keeping is expressed now (formerly keep_clip_on_cpu / keep_vae_on_cpu / keep_controlnet_on_cpu).")
             .optional_field("params_backend", schema::FieldType::String, "Parameter storage backend override (empty = same as backend). Set to \"*=cpu\" for the global \"keep all weights in RAM\" mode that was previously offload_to_cpu.")
             .optional_field("rpc_servers", schema::FieldType::String, "RPC distributed-backend node list, comma-separated host:port pairs (leejet PR #1629). Empty = no RPC.")
+            .enum_field("rpc_split", "\"auto\" probes the rpc_servers (latency, free VRAM), drops unreachable ones and sets a per-device max_vram budget in proportion to free VRAM. Empty = use rpc_servers and max_vram as given.", {"", "auto"}, "")
+            .enum_field("offload_tune", "\"auto\" reuses the offload settings calibrated for this model, GPU and resolution bucket, calibrating them first (a few steps per candidate config) if there are none. \"force\" always calibrates. Empty = offload options as given.", {"", "auto", "force"}, "")
+            .optional_field("tune_width", schema::FieldType::Integer, "offload_tune calibration width; rounded up to 256 it keys the cache", 1024)
+            .optional_field("tune_height", schema::FieldType::Integer, "offload_tune calibration height", 1024)
+            .optional_field("tune_steps", schema::FieldType::Integer, "Sampling steps per offload_tune calibration run (2-50)", 4)
 #if defined(SDCPP_EXPERIMENTAL_OFFLOAD) && !defined(SDCPP_UNIFIED_STREAMING)
             // ── feature/vram-offloading-v2 fields (legacy multi-mode API) ──
             .enum_field("offload_mode", "VRAM offload strategy", OFFLOAD_MODE_VALUES, "none")
@@ -82,6 +99,7 @@ struct LoadOptions {
             // ── feature/unified-streaming field (new minimal API) ──────────
             .optional_field("stream_layers", schema::FieldType::Boolean, "Engage residency+async-prefetch streaming on top of max_vram. Requires max_vram > 0; no effect when max_vram == 0. sd.cpp's planner picks the residency split automatically and overlaps next-segment H2D with current-segment compute.", false)
 #endif
+            .optional_field("mlock", schema::FieldType::Boolean, "Lock the loaded weight buffers in RAM so they are never paged out (needs RLIMIT_MEMLOCK headroom). Default: numa.mlock", false)
             .optional_field("eager_load", schema::FieldType::Boolean, "Pre-load all params into the params backend at model-load time instead of lazily on first use (leejet PR #1687). Pairs naturally with stream_layers on a CPU params backend — the first generation no longer pays for lazy fault-in. Restapi defaults to true (long-lived server: first request after load should be fast); upstream sd-cli defaults to false (one-shot tool).", true)
             ;
         return builder.build();
@@ -152,6 +170,15 @@ struct ModelPathsResponse {
     }
 };
 
+struct HashModelsRequest {
+    static schema::SchemaDescriptor schema() {
+        return schema::SchemaBuilder("HashModelsRequest", "Queue SHA256 hashing of several models")
+            .enum_field("model_type", "Restrict to one model type (required with names)", MODEL_TYPE_VALUES)
+            .array_field("names", schema::FieldType::String, "Model names to hash (default: all models without a hash)")
+            .build();
+    }
+};
+
 struct DownloadModelRequest {
     static schema::SchemaDescriptor schema() {
         return schema::SchemaBuilder("DownloadModelRequest", "Download a model from external source")
@@ -163,6 +190,8 @@ struct DownloadModelRequest {
             .optional_field("filename", schema::FieldType::String, "Target filename")
             .optional_field("subfolder", schema::FieldType::String, "Subfolder within HF repo")
             .optional_field("revision", schema::FieldType::String, "Git revision for HF repo", "main")
+            .optional_field("connections", schema::FieldType::Integer, "Parallel range connections (1-16, default from server config)")
+            .optional_field("max_speed_kbps", schema::FieldType::Integer, "Bandwidth cap for this download in KiB/s (0 = unlimited)")
             .build();
     }
 };
@@ -216,7 +245,7 @@ struct LoadUpscalerRequest {
         return schema::SchemaBuilder("LoadUpscalerRequest", "Load an ESRGAN upscaler model")
             .required_field("model_name", schema::FieldType::String, "ESRGAN model name")
             .optional_field("n_threads", schema::FieldType::Integer, "CPU threads (-1 for auto)", -1)
-            .optional_field("tile_size", schema::FieldType::Integer, "Processing tile size", 128)
+            .optional_field("tile_size", schema::FieldType::Integer, "Processing tile size (0 = fit to free VRAM)", 128)
             .build();
     }
 };
@@ -235,6 +264,7 @@ struct UploadModelResponse {
             .required_field("size_bytes", schema::FieldType::Integer, "Size of the stored file in bytes")
             .required_field("full_path", schema::FieldType::String, "Absolute path of the stored file on the server")
             .optional_field("subfolder", schema::FieldType::String, "Subfolder under the model_type directory (if any)")
+            .optional_field("sha256", schema::FieldType::String, "SHA256 of the stored file, computed while it was received")
             .build();
     }
 };
@@ -269,6 +299,7 @@ struct AdetailerRequest {
             .optional_field("negative_prompt", schema::FieldType::String, "Negative prompt for the inpaint pass", "")
             .optional_field("extra_ad_args", schema::FieldType::String, "Comma-separated k=v ADetailer flags (upstream sd.cpp format)", "")
             .object_field("inpaint_params", "Optional subset of GenerationRequestBase for the inpaint pass (steps, cfg_scale, sampler, scheduler, seed, ...)")
+            .enum_field("priority", "Scheduling class of the queue job", JOB_PRIORITY_VALUES, "normal")
             .build();
     }
 };
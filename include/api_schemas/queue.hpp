@@ -14,6 +14,10 @@ struct QueueListResponse {
             .required_field("failed_count", schema::FieldType::Integer, "Number of failed jobs")
             .required_field("cancelled_count", schema::FieldType::Integer, "Number of cancelled jobs")
             .required_field("total_count", schema::FieldType::Integer, "Total job count")
+            .array_field("workers", schema::FieldType::Object, "Worker pool snapshot (id, lane, busy, jobs_processed, job_id, progress)")
+            .object_field("scheduler", "Generation-lane scheduler state (policy, picks by reason, jobs_reordered, recent_decisions)")
+            .object_field("persistence", "Queue journal state (records_written, journal_length, compactions, pending)")
+            .object_field("progress_events", "Progress/preview fan-out counters (published, dropped, coalesced, broadcasts)")
             .required_field("filtered_count", schema::FieldType::Integer, "Count after filters applied")
             .optional_field("offset", schema::FieldType::Integer, "Pagination offset")
             .optional_field("limit", schema::FieldType::Integer, "Results per page")
@@ -36,6 +40,8 @@ struct JobStatusResponse {
             .required_field("type", schema::FieldType::String, "Job type (txt2img, img2img, etc.)")
             .required_field("status", schema::FieldType::String, "Job status")
             .optional_field("title", schema::FieldType::String, "User-supplied display title (only present when set)", "")
+            .required_field("priority", schema::FieldType::String, "Scheduling class: interactive, normal or batch")
+            .optional_field("owner", schema::FieldType::String, "User who queued the job (only present with auth enabled)")
             .object_field("progress", "Generation progress (step/total_steps)")
             .required_field("created_at", schema::FieldType::String, "Creation timestamp (ISO8601)")
             .optional_field("started_at", schema::FieldType::String, "Start timestamp (ISO8601)")
@@ -13,6 +13,8 @@ struct PreviewSettingsResponse {
             .required_field("interval", schema::FieldType::Integer, "Preview interval (every N steps)")
             .optional_field("max_size", schema::FieldType::Integer, "Maximum preview dimension")
             .optional_field("quality", schema::FieldType::Integer, "JPEG quality (1-100)")
+            .optional_field("on_demand", schema::FieldType::Boolean, "Only decode previews while a client watches the job")
+            .optional_field("max_overhead_percent", schema::FieldType::Integer, "Preview cost budget as a share of step time (0 = fixed interval)")
             .build();
     }
 };
@@ -25,6 +27,8 @@ struct UpdatePreviewSettingsRequest {
             .optional_field("interval", schema::FieldType::Integer, "Preview interval (every N steps)")
             .optional_field("max_size", schema::FieldType::Integer, "Maximum preview dimension")
             .optional_field("quality", schema::FieldType::Integer, "JPEG quality (1-100)")
+            .optional_field("on_demand", schema::FieldType::Boolean, "Only decode previews while a client watches the job")
+            .optional_field("max_overhead_percent", schema::FieldType::Integer, "Preview cost budget as a share of step time (0 = fixed interval)")
             .build();
     }
 };
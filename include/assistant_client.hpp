@@ -2,7 +2,10 @@
 
 #include <string>
 #include <vector>
+#include <map>
+#include <memory>
 #include <mutex>
+#include <atomic>
 #include <optional>
 #include <chrono>
 #include <functional>
@@ -12,6 +15,11 @@
 
 #include "config.hpp"
 
+// Forward declare httplib types
+namespace httplib {
+class Client;
+}
+
 namespace sdcpp {
 
 // Forward declaration
@@ -610,6 +618,23 @@ private:
      */
     std::vector<AssistantAction> extract_tool_calls(const nlohmann::json& message);
 
+    /**
+     * Run the backend tools among one turn's tool calls (concurrently when
+     * there are several)
+     * @return Their results, in call order, skipping the UI-only calls
+     */
+    std::vector<nlohmann::json> execute_backend_tools(
+        const std::vector<std::pair<std::string, nlohmann::json>>& calls);
+
+    /**
+     * Keep-alive connection to host:port, from the idle pool or new, with
+     * the given timeouts. One request uses it at a time (httplib::Client
+     * isn't safe to share); the lease puts it back when it goes out of
+     * scope, so a tool loop of ten round trips reuses one connection.
+     */
+    using ClientLease = std::unique_ptr<httplib::Client, std::function<void(httplib::Client*)>>;
+    ClientLease acquire_client(const std::string& host, int port, int timeout_seconds);
+
     AssistantConfig config_;
     std::string history_file_;
     std::string config_file_path_;
@@ -624,6 +649,13 @@ private:
     // Cached model capabilities (refreshed on model change)
     mutable ModelCapabilities current_model_capabilities_;
     mutable std::mutex capabilities_mutex_;
+
+    // Idle keep-alive connections by "host:port"
+    static constexpr size_t MAX_IDLE_CLIENTS = 4;   // Per endpoint
+    std::mutex client_pool_mutex_;
+    std::map<std::string, std::vector<std::unique_ptr<httplib::Client>>> client_pool_;
+    std::atomic<uint64_t> connections_opened_{0};
+    std::atomic<uint64_t> connections_reused_{0};
 };
 
 } // namespace sdcpp
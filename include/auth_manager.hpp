@@ -1,9 +1,15 @@
 #pragma once
 
+#include <array>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <unordered_set>
 #include <shared_mutex>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <deque>
 #include <chrono>
 #include <optional>
 #include <vector>
@@ -30,6 +36,12 @@ struct Config;
  *   - Bearer token: REST API + MCP (Authorization: Bearer <token>)
  *   - Query token: WebSocket (?token=<token>)
  *   - HTTP Basic: design hooks reserved for future WebDAV use (NOT YET WIRED)
+ *
+ * Tokens live in TOKEN_SHARDS maps picked by token hash, each with its own
+ * shared_mutex, so concurrent verifications rarely touch the same lock.
+ * Expired tokens are evicted by a background thread: every token has the
+ * same TTL, so issue order is expiry order and the thread just sleeps
+ * until the oldest one is due. Nothing on the request path sweeps.
  */
 class AuthManager {
 public:
@@ -39,6 +51,10 @@ public:
      * @throws std::runtime_error if enabled and no credentials available.
      */
     explicit AuthManager(const Config& config);
+    ~AuthManager();
+
+    AuthManager(const AuthManager&) = delete;
+    AuthManager& operator=(const AuthManager&) = delete;
 
     /** True iff the server is enforcing authentication. */
     bool enabled() const { return enabled_; }
@@ -59,7 +75,7 @@ public:
     /**
      * Verify a previously-issued token.
      * Returns the username it was issued for if still valid; nullopt otherwise.
-     * Side-effect: lazily evicts the entry if expired.
+     * Takes one shard's shared lock; expired entries are left to the expiry thread.
      */
     std::optional<std::string> verify_token(const std::string& token) const;
 
@@ -78,9 +94,10 @@ public:
 
     /**
      * True iff the given request path should bypass auth entirely.
-     * Matches against exact paths and known path prefixes.
+     * Matches against exact paths and known path prefixes in one pass over
+     * `path` (a byte trie built from both lists on first use).
      */
-    static bool is_always_allowed(const std::string& path);
+    static bool is_always_allowed(std::string_view path);
 
 private:
     /**
@@ -93,8 +110,8 @@ private:
     /** Generate a 32-byte random token, base64url-encoded (no padding). */
     static std::string generate_token();
 
-    /** Drop all expired tokens from the map. Caller must hold an exclusive lock. */
-    void cleanup_expired_locked() const;
+    /** Expiry thread: evict tokens as their expiry passes */
+    void expiry_loop();
 
     bool enabled_ = true;
     std::string username_;
@@ -106,9 +123,22 @@ private:
         std::chrono::steady_clock::time_point expires_at;
     };
 
-    // Mutable so const verify_token() can lazily evict expired entries.
-    mutable std::shared_mutex tokens_mutex_;
-    mutable std::unordered_map<std::string, TokenEntry> tokens_;
+    struct TokenShard {
+        mutable std::shared_mutex mutex;
+        std::unordered_map<std::string, TokenEntry> tokens;
+    };
+    static constexpr size_t TOKEN_SHARDS = 16;
+    std::array<TokenShard, TOKEN_SHARDS> shards_;
+
+    TokenShard& shard_for(const std::string& token);
+    const TokenShard& shard_for(const std::string& token) const;
+
+    // Tokens in issue (= expiry) order, for the expiry thread
+    std::mutex expiry_mutex_;
+    std::condition_variable expiry_cv_;
+    std::deque<std::pair<std::chrono::steady_clock::time_point, std::string>> expiry_queue_;
+    bool stopping_ = false;
+    std::thread expiry_thread_;
 };
 
 } // namespace sdcpp
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <mutex>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+namespace sdcpp {
+
+/**
+ * Call sizing for checkpointed batches (queue.checkpoint_interval_seconds).
+ *
+ * Keeps the seconds per sampling step of one image measured by the last
+ * call for each model and resolution. A batch is only split once its key
+ * has an estimate: until then it runs in one call, as it would without
+ * checkpoints, and that call provides the estimate. Thread-safe.
+ */
+class BatchCheckpoints {
+public:
+    /** Oldest keys beyond this are dropped */
+    static constexpr size_t MAX_KEYS = 256;
+
+    /** "<model>@<width>x<height>" */
+    static std::string key(const std::string& model, int width, int height);
+
+    /**
+     * Images for the next call of a batch with `remaining` images left:
+     * all of them without an estimate (per_image_seconds <= 0) or when they
+     * fit into `interval_seconds`, else as many as fit, at least one
+     */
+    static int next_call(int remaining, double per_image_seconds, double interval_seconds);
+
+    /**
+     * Where a batch resumes: the first of the `recorded` checkpointed
+     * outputs that is not on disk (images handed to the output pipeline
+     * may not have been written before a crash)
+     */
+    static int resume_point(const std::vector<std::string>& outputs, int recorded,
+                            const std::function<bool(const std::string&)>& exists);
+
+    /** Seconds per step of one image for `key`; 0 when not measured */
+    double seconds_per_step(const std::string& key) const;
+
+    /** A call of `images` images at `steps` steps took `seconds` */
+    void record(const std::string& key, double seconds, int images, int steps);
+
+    /** {key: seconds_per_step} */
+    nlohmann::json stats_json() const;
+
+private:
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, double> seconds_per_step_;
+    std::unordered_map<std::string, uint64_t> recorded_at_;     // Key -> record() sequence, for eviction
+    uint64_t sequence_ = 0;
+};
+
+} // namespace sdcpp
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <chrono>
+#include <cstdint>
+
+#include <nlohmann/json.hpp>
+#include "config.hpp"
+
+namespace sdcpp {
+
+/**
+ * Coordinator side of multi-node dispatch (cluster.role = "coordinator").
+ *
+ * Each worker node is a plain sdcpp-restapi instance with its own model
+ * loaded. A poller reads every node's /health and /queue; the queue's
+ * remote lane acquire()s a node for each txt2img / img2img / txt2vid job,
+ * preferring one whose last job had the same affinity key (same LoRAs and
+ * settings), then the least loaded, then the most free VRAM. run_job()
+ * submits the job over the node's REST API, relays its progress and
+ * previews, and copies the outputs into the coordinator's output
+ * directory so /output and /thumb serve them as if generated locally.
+ */
+class ClusterCoordinator {
+public:
+    struct JobHooks {
+        std::function<void(const nlohmann::json& node)> on_submitted;  // {name, url, job_id}
+        std::function<void(int step, int total_steps)> on_progress;
+        std::function<void(int step, const std::vector<uint8_t>& jpeg, int width, int height)> on_preview;
+    };
+
+    explicit ClusterCoordinator(const ClusterConfig& config);
+    ~ClusterCoordinator();
+
+    ClusterCoordinator(const ClusterCoordinator&) = delete;
+    ClusterCoordinator& operator=(const ClusterCoordinator&) = delete;
+
+    bool enabled() const { return config_.role == "coordinator" && !nodes_.empty(); }
+
+    /**
+     * Remote worker slots the queue should run: the nodes' max_jobs summed
+     */
+    int slot_count() const;
+
+    std::chrono::milliseconds health_interval() const {
+        return std::chrono::milliseconds(config_.health_interval_ms);
+    }
+
+    /**
+     * Start / stop the health poller. start() polls every node once before
+     * returning so the first jobs see real state.
+     */
+    void start();
+    void stop();
+
+    /**
+     * Reserve a job slot on the best node serving `model` (any loaded
+     * model when empty). Returns the node index, or -1 if none is free.
+     * Pair with release().
+     */
+    int acquire(const std::string& model, const std::string& affinity_key);
+    void release(int node, bool success);
+
+    /**
+     * Whether some healthy node has `model` loaded, free or not
+     */
+    bool serves(const std::string& model) const;
+
+    /**
+     * Run one job on an acquired node: POST it to `endpoint` ("/txt2img",
+     * ...), follow it until it finishes and download its outputs to
+     * <output_dir>/<subpath>/. Returns the outputs relative to output_dir.
+     * Throws std::runtime_error if the node fails the job or stops
+     * answering for timeout_seconds.
+     */
+    std::vector<std::string> run_job(int node, const std::string& endpoint, const nlohmann::json& params,
+                                     const std::string& output_dir, const std::string& subpath,
+                                     const JobHooks& hooks);
+
+    /**
+     * Nodes and their last polled state (GET /cluster/nodes)
+     */
+    nlohmann::json status_json() const;
+
+private:
+    struct Node {
+        ClusterNodeConfig config;
+        std::string token;                  // Bearer token from /auth/login
+
+        // Last poll
+        bool healthy = false;
+        bool model_loaded = false;
+        bool model_loading = false;
+        std::string model_name;
+        std::string model_architecture;
+        bool gpu_available = false;
+        uint64_t gpu_free = 0;
+        uint64_t gpu_total = 0;
+        int queued = 0;                     // Node's pending + processing jobs, ours included
+        std::string last_error;
+        std::chrono::steady_clock::time_point last_seen{};
+
+        // This coordinator's use of it
+        int in_flight = 0;
+        std::string last_affinity;
+        uint64_t dispatched = 0;
+        uint64_t failed = 0;
+    };
+
+    // The node's snapshot after a /health + /queue round
+    struct Poll {
+        bool ok = false;
+        nlohmann::json health;
+        int queued = 0;
+        std::string error;
+    };
+
+    struct Response {
+        int status = 0;                     // 0 = no response
+        std::string body;
+        std::string content_type;
+        std::string error;
+        int width = 0;                      // X-Preview-Width / -Height / -Step
+        int height = 0;
+        int step = 0;
+    };
+
+    // One HTTP call to node `index`, with its token; logs in and retries
+    // once on 401 when the node has credentials. Takes mutex_ only to read
+    // or store the token.
+    Response request(int index, const std::string& method, const std::string& path,
+                     const std::string& body = "");
+    bool login(int index);
+    // GET `path` from the node straight into `local_path`
+    bool download(int index, const std::string& path, const std::string& local_path, std::string& error);
+
+    Poll poll_node(int index);
+    void poll_all();
+    void poller_thread();
+
+    const std::string& node_label(int index) const;
+    static bool model_matches(const std::string& loaded, const std::string& wanted);
+
+    ClusterConfig config_;
+    std::vector<Node> nodes_;
+    mutable std::mutex mutex_;              // guards nodes_ state
+
+    std::thread poller_;
+    std::mutex poller_mutex_;
+    std::condition_variable poller_cv_;
+    std::atomic<bool> running_{false};
+};
+
+} // namespace sdcpp
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <string>
+#include <list>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <cstdint>
+
+#include <nlohmann/json.hpp>
+
+namespace sdcpp {
+
+/**
+ * Encoded prompts kept across generate calls.
+ *
+ * sd.cpp runs the text encoders (CLIP, T5, the LLM) inside every
+ * generate_image() call. With the hook cmake/PatchSdCondCache.cmake adds
+ * to it, each encode first asks this cache and stores what it computed, so
+ * a prompt seen before skips the cond stage. Values are sd.cpp's
+ * conditioning blobs, opaque here.
+ *
+ * Keys are built by SDWrapper: the loaded model's components and their
+ * hashes, the job's LoRA set, then sd.cpp's own part (prompt text,
+ * clip_skip, size). An LRU bounded by budget_bytes; a value larger than
+ * the budget is never kept. Thread-safe.
+ */
+class ConditioningCache {
+public:
+    explicit ConditioningCache(uint64_t budget_bytes);
+
+    ConditioningCache(const ConditioningCache&) = delete;
+    ConditioningCache& operator=(const ConditioningCache&) = delete;
+
+    bool enabled() const { return budget_bytes_ > 0; }
+
+    /**
+     * The blob stored under `key` (now the most recently used), or null.
+     * The returned blob stays valid after eviction.
+     */
+    std::shared_ptr<const std::string> find(const std::string& key);
+
+    /** Store `blob` under `key`, evicting least recently used entries to fit */
+    void insert(const std::string& key, std::string blob);
+
+    /** Drop every entry */
+    void clear();
+
+    /**
+     * enabled, budget_bytes, used_bytes, entries, hits, misses, hit_rate,
+     * stores, evictions
+     */
+    nlohmann::json stats_json() const;
+
+private:
+    struct Entry {
+        std::shared_ptr<const std::string> blob;
+        std::list<std::string>::iterator lru_it;
+    };
+
+    void erase_locked(std::unordered_map<std::string, Entry>::iterator it);
+
+    const uint64_t budget_bytes_;
+
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, Entry> entries_;
+    std::list<std::string> lru_;            // Front = most recently used
+    uint64_t used_bytes_ = 0;               // Keys and blobs
+
+    uint64_t hits_ = 0;
+    uint64_t misses_ = 0;
+    uint64_t stores_ = 0;
+    uint64_t evictions_ = 0;
+};
+
+} // namespace sdcpp
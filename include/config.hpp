@@ -26,6 +26,23 @@ struct ServerConfig {
     // this to the address(es) of your reverse proxy (e.g. ["127.0.0.1",
     // "10.0.0.0/8"]) when the server runs behind nginx/Caddy/Traefik.
     std::vector<std::string> trusted_proxies;
+
+    // In-memory cache for WebUI assets, including their gzip/brotli
+    // encodings (see FileServer). 0 serves every asset from disk.
+    int static_cache_mb = 32;
+
+    // Serve the port from an epoll event loop (HttpFrontEnd, Linux only)
+    // instead of httplib's thread-per-connection accept loop. Idle
+    // keep-alive and WebSocket connections then cost no thread, and
+    // `threads` only bounds requests being handled.
+    bool event_loop = false;
+    int max_connections = 10000;        // Open client connections (event loop)
+    int keep_alive_timeout = 60;        // Seconds an idle connection is kept (event loop)
+
+    // Levels a WebDAV PROPFIND with "Depth: infinity" descends. 1 answers
+    // it like Depth: 1; raise it so sync clients can mirror a whole output
+    // tree in one (streamed) request instead of one per folder.
+    int webdav_max_depth = 1;
 };
 
 /**
@@ -71,15 +88,181 @@ struct PreviewConfig {
     int interval = 1;                    // Generate preview every N steps
     int max_size = 256;                  // Maximum preview dimension in pixels
     int quality = 75;                    // JPEG quality 1-100
+    bool on_demand = true;               // Only while a client watches the job (WebSocket or HTTP polling)
+    int max_overhead_percent = 10;       // Widen the interval to keep preview cost under this share of step time (0 = off)
 };
 
 /**
  * Recycle bin configuration for queue items
- * Allows soft-deletion with automatic cleanup after retention period
+ * Allows soft-deletion with automatic cleanup after retention period.
+ * Purges, and evictions over the output quota, run on a background thread
+ * (see OutputReaper), which also deletes the files.
  */
 struct RecycleBinConfig {
     bool enabled = true;                    // Enable/disable recycle bin (if disabled, items are permanently deleted)
     int retention_minutes = 10080;          // Time to keep deleted items (default: 7 days = 7*24*60)
+    bool delete_outputs = false;            // Delete a purged job's output files (default: leave them on disk)
+    int output_quota_mb = 0;                // Evict the oldest finished jobs and their files above this (0 = no quota)
+    int sweep_interval_seconds = 60;        // How often retention and the quota are checked
+    int reap_files_per_second = 200;        // Deletion rate limit (0 = unthrottled)
+};
+
+/**
+ * Queue worker pool configuration
+ *
+ * Jobs are routed to a lane by type. The generation lane owns the sd.cpp
+ * context (ModelManager holds exactly one sd_ctx_t, and sd.cpp's progress /
+ * preview callbacks are process-global), so it always runs one worker per
+ * loaded context. The I/O lane runs model downloads and hashing, which never
+ * touch the context and would otherwise sit in line behind a long video job.
+ * The post lane runs upscale jobs, which only need the upscaler context, next
+ * to a generation when the free VRAM allows it.
+ */
+struct QueueConfig {
+    // One generation worker per entry, each with its own copy of the loaded
+    // model on that sd.cpp backend device ("cuda0", "cuda1", ...). Empty =
+    // one generation worker on the load's own backend.
+    std::vector<std::string> generation_devices;
+    int io_workers = 1;                     // Workers for download/hash jobs (0 = run them on the generation lane)
+    bool work_stealing = true;              // Idle generation worker may pick up I/O-lane jobs
+
+    // Generation-lane ordering: "fifo" or "affinity" (prefer jobs sharing
+    // the LoRA set / detector of the job that just ran; see JobScheduler)
+    std::string scheduler = "affinity";
+    int affinity_lookahead = 32;            // Pending jobs considered per pick
+    int affinity_max_skips = 4;             // Oldest job runs after being passed over this often
+    int affinity_max_wait_seconds = 300;    // ...or after waiting this long
+    // Priority classes ("priority": interactive / normal / batch) and
+    // per-user fair share within a class (see JobScheduler)
+    int priority_aging_seconds = 600;       // A waiting job moves up one class per this long (0 = never)
+    int fair_share_half_life_seconds = 600; // Decay of a user's charged generation time (0 = queue order within a class)
+    int max_pending_per_user = 0;           // Queued jobs one user may have waiting (0 = unlimited)
+    bool preempt_sweeps = true;             // A running sweep yields to higher-priority jobs between variations
+    int checkpoint_interval_seconds = 0;    // Long txt2img/img2img batches run in calls of about this long, each recorded (0 = off)
+    int journal_compact_records = 2000;     // Rewrite the state snapshot after this many journal records
+    int output_workers = 2;                 // Threads encoding/writing job images (0 = write on the generation worker)
+    int output_buffer_mb = 1024;            // Raw frames allowed in flight before generation blocks
+    int max_batch_images = 8;               // Compatible pending txt2img jobs merged into one generate call (1 = off)
+    bool post_worker = true;                // Run upscale jobs on their own worker, next to a generation
+    int post_vram_reserve_mb = 1024;        // VRAM that must stay free when one starts beside a generation
+    bool dedup_results = true;              // Fixed-seed repeats of a job reuse it (result cache)
+    bool trace_jobs = false;                // Record a Chrome trace of every job (see JobTrace)
+    int max_job_waiters = 16;               // Open /wait, /events and "wait" requests (each holds a server thread)
+    int max_wait_seconds = 300;             // Longest a /wait or "wait" request blocks
+    // Generations predicted not to fit in VRAM (estimate_job_vram): "off",
+    // "reject" (fail them), "wait" (let smaller jobs go first, then fail)
+    // or "auto" (turn on vae_tiling, then max_vram + stream_layers)
+    std::string vram_admission = "off";
+    int vram_headroom_mb = 512;             // Kept free on top of a job's estimate
+};
+
+/**
+ * Warm model cache: keeps recently loaded model files resident in host RAM
+ * so switching back to a recent model skips the disk read (see WarmModelCache)
+ */
+struct ModelCacheConfig {
+    int ram_budget_mb = 0;                  // 0 = disabled
+    bool pin = false;                       // mlock retained files (needs RLIMIT_MEMLOCK headroom)
+    int prefetch_min_free_mb = 2048;        // Host RAM /models/prefetch and the pre-read must leave available
+    bool parallel_preread = true;           // Read component files concurrently before new_sd_ctx()
+};
+
+/**
+ * Resident LoRA files (LoraCache). Separate budget from model_cache so a
+ * big checkpoint never pushes out the small LoRAs every job uses.
+ */
+struct LoraCacheConfig {
+    int ram_budget_mb = 0;                  // 0 = disabled
+    bool pin = false;                       // mlock retained files
+};
+
+/**
+ * Encoded prompts kept across generate calls (ConditioningCache). Needs
+ * the sd.cpp hook applied at configure time (SDCPP_COND_CACHE).
+ */
+struct ConditioningCacheConfig {
+    int ram_budget_mb = 256;                // 0 = disabled
+};
+
+/**
+ * One VRAM class of the quantization cache: GPUs with at most
+ * max_vram_mb in total get float models converted to weight_type
+ */
+struct QuantCacheClass {
+    int max_vram_mb = 0;
+    std::string weight_type;                // sd.cpp type name ("q4_K", "q8_0", ...)
+};
+
+/**
+ * Background quantized copies of frequently loaded f16/f32 models
+ * (see QuantCache)
+ */
+struct QuantCacheConfig {
+    bool enabled = false;
+    std::string dir;                        // Empty = <output>/.quant_cache
+    int min_loads = 3;                      // Loads of a model before it is converted
+    int idle_seconds = 300;                 // Queue idle time before a conversion is queued
+    std::string tensor_type_rules;          // Passed to the conversion; part of the cache key
+    std::vector<QuantCacheClass> vram_classes = {{8192, "q4_K"}, {16384, "q8_0"}};  // Ascending; larger GPUs keep f16
+};
+
+/**
+ * Placement of model weights and compute threads on multi-socket CPU hosts
+ * (see NumaPlacement)
+ */
+struct NumaConfig {
+    std::string policy = "off";             // "off", "interleave" (weights spread over `nodes`) or "bind" (weights on `nodes`)
+    std::vector<int> nodes;                 // NUMA node ids; empty = every node
+    bool pin_threads = true;                // "bind": run the process on the nodes' CPUs only
+    std::string hugepages = "off";          // "off" or "madvise" (transparent huge pages for weight buffers)
+    bool mlock = false;                     // Default of the "mlock" load option
+};
+
+/**
+ * Output image encoding defaults. Requests may override the format and
+ * quality per job (output_format / output_quality).
+ */
+struct OutputConfig {
+    std::string format = "png";             // "png", "jpeg" or "webp"
+    int png_compression = 6;                // zlib level 0-9
+    int jpeg_quality = 92;                  // 1-100
+    int webp_quality = 90;                  // 1-100 (lossy)
+    bool webp_lossless = false;             // Lossless WebP ignores webp_quality
+};
+
+/**
+ * Gallery thumbnails (see ThumbnailCache). Every size is written when an
+ * output is saved; /thumb/ picks one with ?size=.
+ */
+struct ThumbnailConfig {
+    std::vector<int> sizes = {120, 256, 512};   // Square edge lengths in px
+    std::string format = "jpeg";            // "jpeg" or "webp"
+    int quality = 85;                       // 1-100
+    int memory_cache_mb = 64;               // Encoded thumbnails kept in RAM (0 = always read from disk)
+};
+
+/**
+ * txt2vid video files (see VideoWriter). Requests may override the format,
+ * codec and keep_frames per job.
+ */
+struct VideoConfig {
+    std::string format = "auto";            // "auto" (mp4 with FFmpeg, else avi), "mp4", "webm", "avi", "none"
+    std::string codec;                      // "h264", "vp9", "av1"; empty = container default
+    int crf = 23;                           // Constant quality (lower = better), 0-51
+    bool hardware = true;                   // Prefer NVENC / VideoToolbox when the FFmpeg build has them
+    bool keep_frames = true;                // Also write frame_%04d.png
+};
+
+/**
+ * Model download transfers (see DownloadManager). Download requests may
+ * override connections and max_speed_kbps per job.
+ */
+struct DownloadConfig {
+    int connections = 4;                    // Parallel HTTP Range connections per file (1 = single stream)
+    int min_segment_mb = 16;                // Ranges are never split below this size
+    int max_speed_kbps = 0;                 // Per-job bandwidth cap in KiB/s (0 = unlimited)
+    int max_retries = 5;                    // Attempts per range before the download fails
+    bool resume = true;                     // Keep <file>.part + .part.json on failure and continue from them
 };
 
 /**
@@ -123,6 +306,10 @@ struct AuthConfig {
     // require the same auth as everything else. Has no effect when
     // `enabled=false` — there's no auth to bypass.
     bool allow_public_outputs = true;
+
+    // When true, GET /metrics is served without auth so a Prometheus
+    // scraper on a trusted network doesn't need a bearer token.
+    bool allow_public_metrics = false;
 };
 
 struct McpConfig {
@@ -147,6 +334,29 @@ struct McpConfig {
     int image_jpeg_quality = 85;
 };
 
+/**
+ * One sdcpp-restapi instance a coordinator dispatches jobs to
+ */
+struct ClusterNodeConfig {
+    std::string name;                       // Label in /cluster/nodes and metadata.node (empty = the URL)
+    std::string url;                        // Base URL, e.g. "http://gpu-1:8080"
+    std::string username;                   // The node's auth credentials, when its auth is on
+    std::string password;
+    int max_jobs = 2;                       // Jobs in flight on the node at once
+};
+
+/**
+ * Multi-node dispatch (see ClusterCoordinator). A coordinator runs its
+ * txt2img / img2img / txt2vid jobs on the worker nodes instead of locally.
+ */
+struct ClusterConfig {
+    std::string role = "standalone";        // "standalone" or "coordinator"
+    std::vector<ClusterNodeConfig> nodes;
+    int health_interval_ms = 2000;          // How often each node's /health and /queue are read
+    int job_poll_ms = 250;                  // Progress poll of a dispatched job
+    int timeout_seconds = 30;               // Per HTTP request to a node
+};
+
 /**
  * Complete application configuration
  */
@@ -157,8 +367,19 @@ struct Config {
     PreviewConfig preview;
     AssistantConfig assistant;
     RecycleBinConfig recycle_bin;
+    QueueConfig queue;
+    ModelCacheConfig model_cache;
+    LoraCacheConfig lora_cache;
+    ConditioningCacheConfig conditioning_cache;
+    QuantCacheConfig quant_cache;
+    NumaConfig numa;
+    OutputConfig output;
+    ThumbnailConfig thumbnails;
+    VideoConfig video;
+    DownloadConfig download;
     AuthConfig auth;
     McpConfig mcp;
+    ClusterConfig cluster;
 
     // When true, jobs created via expand_prompt write outputs into
     // <output>/<group_id>/<job_id>/ instead of flat <output>/<job_id>/. Lets
@@ -205,9 +426,43 @@ void from_json(const nlohmann::json& j, AssistantConfig& c);
 void to_json(nlohmann::json& j, const RecycleBinConfig& c);
 void from_json(const nlohmann::json& j, RecycleBinConfig& c);
 
+void to_json(nlohmann::json& j, const QueueConfig& c);
+void from_json(const nlohmann::json& j, QueueConfig& c);
+
+void to_json(nlohmann::json& j, const ModelCacheConfig& c);
+void from_json(const nlohmann::json& j, ModelCacheConfig& c);
+void to_json(nlohmann::json& j, const LoraCacheConfig& c);
+void from_json(const nlohmann::json& j, LoraCacheConfig& c);
+void to_json(nlohmann::json& j, const ConditioningCacheConfig& c);
+void from_json(const nlohmann::json& j, ConditioningCacheConfig& c);
+void to_json(nlohmann::json& j, const QuantCacheClass& c);
+void from_json(const nlohmann::json& j, QuantCacheClass& c);
+void to_json(nlohmann::json& j, const QuantCacheConfig& c);
+void from_json(const nlohmann::json& j, QuantCacheConfig& c);
+void to_json(nlohmann::json& j, const NumaConfig& c);
+void from_json(const nlohmann::json& j, NumaConfig& c);
+
+void to_json(nlohmann::json& j, const OutputConfig& c);
+void from_json(const nlohmann::json& j, OutputConfig& c);
+
+void to_json(nlohmann::json& j, const ThumbnailConfig& c);
+void from_json(const nlohmann::json& j, ThumbnailConfig& c);
+
+void to_json(nlohmann::json& j, const VideoConfig& c);
+void from_json(const nlohmann::json& j, VideoConfig& c);
+
+void to_json(nlohmann::json& j, const DownloadConfig& c);
+void from_json(const nlohmann::json& j, DownloadConfig& c);
+
 void to_json(nlohmann::json& j, const AuthConfig& c);
 void from_json(const nlohmann::json& j, AuthConfig& c);
 
+void to_json(nlohmann::json& j, const ClusterNodeConfig& c);
+void from_json(const nlohmann::json& j, ClusterNodeConfig& c);
+
+void to_json(nlohmann::json& j, const ClusterConfig& c);
+void from_json(const nlohmann::json& j, ClusterConfig& c);
+
 void to_json(nlohmann::json& j, const Config& c);
 void from_json(const nlohmann::json& j, Config& c);
 
@@ -1,7 +1,10 @@
 #pragma once
 
+#include <cstdint>
 #include <filesystem>
+#include <memory>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <utility>
 #include <vector>
@@ -30,19 +33,31 @@ struct DocSearchResult {
  *   - Pre-computable at server start; no per-query model call.
  *   - For technical-keyword-heavy docs and "how do I X" questions, quality
  *     is on par with embeddings while costing 0 dependencies.
+ *
+ * The chunked, tokenized corpus is kept in a cache file, one record per
+ * markdown file tagged with its size and mtime. At startup the cache is
+ * memory-mapped and only files whose size or mtime changed are read and
+ * tokenized again; chunk text and terms point into the mapping, so an
+ * unchanged corpus loads without copying it.
  */
 class DocsIndex {
 public:
     /**
      * Read every *.md under docs_dir, chunk by H2/H3 sections, build the
      * BM25 index. Empty / missing dir → empty index (search returns []).
+     * @param cache_file Index cache to load and update ("" = no cache)
      */
-    explicit DocsIndex(const std::string& docs_dir);
+    explicit DocsIndex(const std::string& docs_dir, const std::string& cache_file = "");
+    ~DocsIndex();
+
+    DocsIndex(const DocsIndex&) = delete;
+    DocsIndex& operator=(const DocsIndex&) = delete;
 
     /**
      * Rank chunks against `query` by BM25. Returns at most `max_results`
      * results, ordered descending by score. Empty list if the corpus is
-     * empty or no terms match.
+     * empty or no terms match. Scoring uses per-thread scratch buffers and
+     * a bounded top-k heap, so only the results themselves are allocated.
      */
     std::vector<DocSearchResult> search(const std::string& query,
                                          std::size_t max_results = 3) const;
@@ -51,26 +66,33 @@ public:
     const std::string& docs_dir() const { return docs_dir_; }
 
 private:
+    // Views into a cache record (mapped file or freshly built bytes)
     struct Chunk {
-        std::string doc_filename;
-        std::string section;
-        std::string section_path;
-        std::string content;
-        std::vector<std::string> tokens;
+        std::string_view doc_filename;
+        std::string_view section;
+        std::string_view section_path;
+        std::string_view content;
     };
 
-    void index_file(const std::filesystem::path& path);
+    struct Storage;
+
+    // Serialized record (see docs_index.cpp) for one markdown file
+    static std::string build_record(const std::filesystem::path& path, uint64_t size, int64_t mtime_ns);
+
+    // Add a record's chunks and postings; false if it is malformed
+    bool load_record(std::string_view record);
 
     // Tokenize: lowercase, split on non-alphanumeric, drop tokens < 2 chars
     // and a tiny English stopword set. Static so the search path can re-use it.
     static std::vector<std::string> tokenize(const std::string& text);
 
     std::string                 docs_dir_;
+    std::unique_ptr<Storage>    storage_;             // Backs every string_view
     std::vector<Chunk>          chunks_;
     // term → list of (chunk index, term frequency in that chunk)
-    std::unordered_map<std::string,
-                       std::vector<std::pair<std::size_t, int>>> postings_;
-    std::vector<std::size_t>    chunk_lengths_;       // token count per chunk
+    std::unordered_map<std::string_view,
+                       std::vector<std::pair<uint32_t, uint32_t>>> postings_;
+    std::vector<uint32_t>       chunk_lengths_;       // token count per chunk
     double                      avg_chunk_length_ = 0;
 };
 
@@ -5,6 +5,7 @@
 #include <functional>
 #include <optional>
 #include <nlohmann/json.hpp>
+#include "config.hpp"
 
 namespace sdcpp {
 
@@ -35,6 +36,8 @@ struct DownloadResult {
     std::string error_message;
     size_t file_size = 0;
     std::string content_type;       // MIME type from response
+    size_t resumed_bytes = 0;       // Bytes taken over from an earlier partial download
+    std::string sha256;             // Computed during the transfer (empty if it could not be)
 
     // Metadata from source (CivitAI/HuggingFace)
     nlohmann::json metadata;
@@ -78,14 +81,28 @@ const std::vector<std::string> SUPPORTED_MODEL_EXTENSIONS = {
 
 /**
  * Download Manager - handles model downloads from various sources
+ *
+ * When the server advertises byte ranges and a Content-Length, a file is
+ * fetched as several HTTP Range requests over parallel connections (one
+ * libcurl multi handle, so progress stays on the calling thread), written
+ * with pwrite() into a preallocated <file>.part. Segment progress is kept
+ * in <file>.part.json; a failed or interrupted download resumes from it
+ * on the next attempt, including after a server restart. Servers without
+ * range support get a single stream.
+ *
+ * The file's SHA256 is computed as the data arrives (DownloadResult::sha256),
+ * so a finished download never has to be read again just to hash it.
+ * CivitAI downloads are checked against the published hash.
  */
 class DownloadManager {
 public:
     /**
      * Constructor
      * @param paths_config Paths configuration for model directories
+     * @param options Transfer settings (connections, bandwidth cap, resume)
      */
-    explicit DownloadManager(const nlohmann::json& paths_config);
+    explicit DownloadManager(const nlohmann::json& paths_config,
+                             const DownloadConfig& options = DownloadConfig{});
 
     /**
      * Download a model from a direct URL
@@ -188,6 +205,7 @@ public:
 
 private:
     nlohmann::json paths_config_;
+    DownloadConfig options_;
 
     /**
      * Internal download with progress tracking
@@ -0,0 +1,192 @@
+#pragma once
+
+#include "httplib_compat.h"
+#include <nlohmann/json.hpp>
+#include <string>
+#include <list>
+#include <vector>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace sdcpp {
+
+/**
+ * HTTP file serving for /output, WebDAV GET and the WebUI.
+ *
+ * serve() memory-maps the file and the content provider hands slices of
+ * the mapping straight to httplib's socket writer, so a gallery image or a
+ * multi-GB checkpoint is never read() into a user-space buffer first.
+ * (cpp-httplib's DataSink doesn't expose the socket, so sendfile()/splice()
+ * are out of reach; the mapping gets the same "one copy, into the kernel"
+ * result and also works over TLS.) Range requests are sliced by httplib on
+ * top of the provider; If-Range is honoured here.
+ *
+ * serve_asset() is for small static files (the SPA bundle, login page):
+ * each one is held in memory with its gzip and brotli encodings, taken
+ * from precompressed siblings (app.js.br / app.js.gz) when the build
+ * emitted them, else compressed once at load time with whatever codecs
+ * were available at build time. Responses negotiate Accept-Encoding and
+ * stream from the shared buffer without copying it into the response.
+ *
+ * Both paths send ETag + Last-Modified and answer If-None-Match /
+ * If-Modified-Since with 304. Validators are cached per path and re-checked
+ * against the filesystem at most once per REVALIDATE_INTERVAL, so a
+ * browser revalidating a page of thumbnails costs no syscalls at all.
+ *
+ * list_directory() keeps directory listings (entries with size and mtime,
+ * for WebDAV PROPFIND) the same way. A listing is rebuilt when the
+ * directory's own mtime moves - new, renamed and deleted files all change
+ * it, and outputs are written by rename - so a revalidated listing costs
+ * one stat() instead of one per entry.
+ */
+class FileServer {
+public:
+    static constexpr auto REVALIDATE_INTERVAL = std::chrono::seconds(1);
+    static constexpr const char* IMMUTABLE = "public, max-age=31536000, immutable";
+    static constexpr const char* REVALIDATE = "no-cache";
+
+    /**
+     * @param asset_cache_bytes Budget for serve_asset() (all encodings);
+     *        files larger than a quarter of it are served by serve() instead
+     */
+    explicit FileServer(size_t asset_cache_bytes);
+
+    FileServer(const FileServer&) = delete;
+    FileServer& operator=(const FileServer&) = delete;
+
+    /**
+     * Serve a regular file (conditional and range requests included).
+     * With head_only, only the headers (Content-Length/Type) are set.
+     * @return false if the file doesn't exist or can't be opened; the
+     *         response is untouched and the caller picks the error
+     */
+    bool serve(const httplib::Request& req, httplib::Response& res,
+               const std::string& path, const std::string& mime,
+               const std::string& cache_control, bool head_only = false);
+
+    /**
+     * Serve a static asset from the in-memory cache
+     * @return false if the file doesn't exist or can't be read
+     */
+    bool serve_asset(const httplib::Request& req, httplib::Response& res,
+                     const std::string& path, const std::string& mime,
+                     const std::string& cache_control);
+
+    struct DirEntry {
+        std::string name;
+        bool is_dir = false;
+        uint64_t size = 0;
+        std::string last_modified;      // HTTP date; empty if unknown
+    };
+
+    struct DirListing {
+        int64_t mtime_ns = 0;
+        std::vector<DirEntry> entries;  // Sorted by name
+        bool truncated = false;         // Stopped at MAX_LISTING_ENTRIES
+        std::chrono::steady_clock::time_point checked;
+    };
+
+    static constexpr size_t MAX_LISTING_ENTRIES = 100000;
+
+    /**
+     * Entries of a directory, from the listing cache
+     * @return null if `path` isn't a readable directory
+     */
+    std::shared_ptr<const DirListing> list_directory(const std::string& path);
+
+    /**
+     * Drop cached validators/assets for `path` (and everything below it for
+     * a directory), and the listing of its parent. Use after writing, moving
+     * or deleting a file.
+     */
+    void invalidate(const std::string& path);
+
+    /**
+     * Counters: mapped (file bodies served), not_modified (304s),
+     * listing_entries/listing_hits/listing_loads,
+     * asset_entries/asset_bytes/asset_budget_bytes, asset_hits, asset_loads,
+     * gzip/brotli (encoded asset responses), codecs available
+     */
+    nlohmann::json stats_json() const;
+
+private:
+    struct Validators {
+        uint64_t size = 0;
+        int64_t mtime_ns = 0;
+        std::string etag;
+        std::string last_modified;
+        std::chrono::steady_clock::time_point checked;
+    };
+
+    struct Asset {
+        Validators validators;
+        std::string mime;
+        std::shared_ptr<const std::string> identity;
+        std::shared_ptr<const std::string> gzip;        // May be null
+        std::shared_ptr<const std::string> brotli;      // May be null
+        size_t bytes = 0;                               // All encodings
+        std::list<std::string>::iterator lru_it;
+    };
+
+    // stat() through the validator cache; false if missing / not a file
+    bool validators_for(const std::string& path, Validators& out);
+    std::shared_ptr<const Asset> load_asset(const std::string& path, const std::string& mime,
+                                            const Validators& validators);
+    void insert_asset_locked(const std::string& path, std::shared_ptr<Asset> asset);
+
+    // True (and the 304 is filled in) when the request's validators match
+    bool not_modified(const httplib::Request& req, httplib::Response& res,
+                      const std::string& etag, const std::string& last_modified);
+
+    size_t asset_budget_;
+
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, Validators> validators_;
+    std::unordered_map<std::string, std::shared_ptr<Asset>> assets_;
+    std::list<std::string> asset_lru_;      // Front = most recently used
+    size_t asset_bytes_ = 0;
+    std::unordered_map<std::string, std::shared_ptr<const DirListing>> listings_;
+
+    std::atomic<uint64_t> mapped_{0};
+    std::atomic<uint64_t> not_modified_{0};
+    std::atomic<uint64_t> asset_hits_{0};
+    std::atomic<uint64_t> asset_loads_{0};
+    std::atomic<uint64_t> gzip_responses_{0};
+    std::atomic<uint64_t> brotli_responses_{0};
+    std::atomic<uint64_t> listing_hits_{0};
+    std::atomic<uint64_t> listing_loads_{0};
+};
+
+/**
+ * A generated response that doesn't change once the server is set up (the
+ * OpenAPI spec, the option descriptions). Serialized once and compressed
+ * like a serve_asset() file; the ETag is a hash of the body, so it only
+ * changes when the content does. Responses share the buffers, and a
+ * matching If-None-Match gets a 304. Immutable, so safe to share.
+ */
+class CachedDocument {
+public:
+    CachedDocument(std::string body, std::string mime);
+
+    CachedDocument(const CachedDocument&) = delete;
+    CachedDocument& operator=(const CachedDocument&) = delete;
+
+    void serve(const httplib::Request& req, httplib::Response& res,
+               const std::string& cache_control = FileServer::REVALIDATE) const;
+
+    const std::string& etag() const { return etag_; }
+    size_t size() const { return identity_->size(); }
+
+private:
+    std::string mime_;
+    std::string etag_;
+    std::shared_ptr<const std::string> identity_;
+    std::shared_ptr<const std::string> gzip_;       // May be null
+    std::shared_ptr<const std::string> brotli_;     // May be null
+};
+
+} // namespace sdcpp
@@ -0,0 +1,124 @@
+#pragma once
+
+#include "httplib_compat.h"
+#include <nlohmann/json.hpp>
+#include <string>
+#include <functional>
+#include <optional>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+
+namespace sdcpp {
+
+/**
+ * Connects /ws connections terminated by the front end to the
+ * WebSocketServer. Everything runs on the event-loop thread except the
+ * `wake` callback handed to open(), which the WebSocketServer calls from
+ * whichever thread queued a message for the client.
+ */
+struct WebSocketHooks {
+    // Authenticate the handshake and register the client; nullopt = 401
+    std::function<std::optional<size_t>(const httplib::Request& handshake,
+                                        std::function<void()> wake)> open;
+    // A complete text message from the client
+    std::function<void(size_t id, const std::string& text)> message;
+    // Pop the next queued outbound message; false when there is none
+    std::function<bool(size_t id, std::shared_ptr<const std::string>& payload, bool& binary)> next;
+    // The connection is gone (no more calls for this id)
+    std::function<void(size_t id)> close;
+};
+
+struct FrontEndOptions {
+    std::string host = "0.0.0.0";
+    int port = 8080;
+    int backend_port = 0;               // httplib, listening on 127.0.0.1
+    size_t max_connections = 10000;
+    size_t max_in_flight = 0;           // Requests handed to httplib at once (0 = unlimited)
+    int keep_alive_timeout_sec = 60;    // Idle keep-alive connections
+    int header_timeout_sec = 30;        // Request head (and a fresh connection's first byte)
+};
+
+/**
+ * Event-loop HTTP front end (Linux epoll).
+ *
+ * cpp-httplib is thread-per-connection: a worker is tied up for as long as
+ * a socket is open, including keep-alive idle time and whole WebSocket
+ * sessions. This class owns the public port instead and runs every client
+ * socket on one epoll thread:
+ *
+ *  - /ws upgrades are terminated here (handshake, framing, ping/pong) and
+ *    wired to the WebSocketServer through WebSocketHooks, so a connected
+ *    dashboard costs a few KB of buffers and no thread.
+ *  - Every other request is parsed just far enough to find where it ends,
+ *    then forwarded to httplib on a loopback port as a one-request
+ *    `Connection: close` exchange; the response streams back and the
+ *    client connection returns to the idle set. httplib's workers only
+ *    ever run handler logic, so server.threads bounds concurrent requests,
+ *    not open connections; requests beyond max_in_flight wait here.
+ *
+ * The client's address travels in PEER_HEADER (see url_utils.hpp).
+ * Responses stream through a bounded per-connection buffer, so a slow
+ * download still occupies its handler while the body is in flight.
+ */
+class HttpFrontEnd {
+public:
+    /** False on platforms without epoll; the caller keeps httplib on the public port */
+    static bool supported();
+
+    HttpFrontEnd(FrontEndOptions options, WebSocketHooks ws_hooks = {});
+    ~HttpFrontEnd();
+
+    HttpFrontEnd(const HttpFrontEnd&) = delete;
+    HttpFrontEnd& operator=(const HttpFrontEnd&) = delete;
+
+    /**
+     * Bind the public port and start the event-loop thread
+     * @throws std::runtime_error if the port can't be bound
+     */
+    void start();
+
+    /**
+     * Stop accepting and drop idle connections; requests in flight and
+     * WebSocket sessions carry on until stop(). Async-signal-safe.
+     */
+    void request_stop();
+
+    /**
+     * Flush what's queued for WebSocket clients, close every connection
+     * and join the loop thread
+     */
+    void stop();
+
+    /** Token that authenticates PEER_HEADER (pass to set_peer_header_token) */
+    const std::string& peer_token() const { return peer_token_; }
+
+    /**
+     * Counters: connections (open), websocket, idle, in_flight, queued, peak,
+     * accepted, requests, websocket_sessions, rejected, backend_errors
+     */
+    nlohmann::json stats_json() const;
+
+private:
+    struct Loop;
+
+    FrontEndOptions options_;
+    WebSocketHooks ws_hooks_;
+    std::string peer_token_;
+    std::unique_ptr<Loop> loop_;
+    std::thread thread_;
+
+    std::atomic<uint64_t> connections_{0};
+    std::atomic<uint64_t> websocket_{0};
+    std::atomic<uint64_t> in_flight_{0};
+    std::atomic<uint64_t> queued_{0};
+    std::atomic<uint64_t> peak_{0};
+    std::atomic<uint64_t> accepted_{0};
+    std::atomic<uint64_t> requests_{0};
+    std::atomic<uint64_t> websocket_sessions_{0};
+    std::atomic<uint64_t> rejected_{0};
+    std::atomic<uint64_t> backend_errors_{0};
+};
+
+} // namespace sdcpp
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include <nlohmann/json.hpp>
+
+namespace sdcpp {
+
+/**
+ * Output image container format
+ */
+enum class ImageFormat {
+    Png,
+    Jpeg,
+    Webp
+};
+
+/**
+ * Parse "png" / "jpeg" / "jpg" / "webp" (case-insensitive)
+ * @throws std::runtime_error on unknown names
+ */
+ImageFormat image_format_from_string(const std::string& name);
+
+/**
+ * Canonical API name ("png", "jpeg", "webp")
+ */
+std::string image_format_to_string(ImageFormat format);
+
+/**
+ * File extension without the dot ("png", "jpg", "webp")
+ */
+std::string image_format_extension(ImageFormat format);
+
+/**
+ * Whether this build can encode the format. PNG and JPEG always can (stb
+ * fallback); WebP needs libwebp at build time.
+ */
+bool image_format_available(ImageFormat format);
+
+/**
+ * Encoder settings for one image
+ */
+struct EncodeOptions {
+    ImageFormat format = ImageFormat::Png;
+    int quality = 90;               // JPEG / lossy WebP quality, 1-100
+    int png_compression = 6;        // zlib level 0-9 (0 = store, 9 = smallest/slowest)
+    bool lossless = false;          // WebP only
+};
+
+/**
+ * Process-wide defaults (from the "output" config section). Per-request
+ * overrides start from these.
+ */
+void set_default_encode_options(const EncodeOptions& options,
+                                int default_jpeg_quality, int default_webp_quality);
+EncodeOptions default_encode_options();
+
+/**
+ * Resolve per-request output settings on top of the server defaults
+ * @param format Requested format name; empty = server default
+ * @param quality Requested quality; <= 0 = default for the resolved format
+ * @throws std::runtime_error for unknown or unavailable formats
+ */
+EncodeOptions resolve_encode_options(const std::string& format, int quality);
+
+/**
+ * Encode interleaved 8-bit pixels (1, 3 or 4 channels) to an in-memory file.
+ *
+ * JPEG uses libjpeg-turbo and PNG uses libpng (linked against whatever zlib
+ * the system provides, zlib-ng in compat mode included) when they were found
+ * at build time; otherwise both fall back to stb_image_write.
+ *
+ * @throws std::runtime_error on encoder failure
+ */
+std::vector<uint8_t> encode_image(const uint8_t* data, int width, int height, int channels,
+                                  const EncodeOptions& options);
+
+/**
+ * Encode and write to `path`. Logs and returns false on failure.
+ */
+bool write_image_file(const std::string& path, const uint8_t* data, int width, int height,
+                      int channels, const EncodeOptions& options);
+
+/**
+ * Decode an image file to RGB (3 channels). Handles everything stb_image
+ * reads, plus WebP when libwebp is available.
+ * @return empty vector on failure
+ */
+std::vector<uint8_t> load_image_file_rgb(const std::string& path, int& width, int& height);
+
+/**
+ * Which backend serves each format, e.g. {"jpeg": "libjpeg-turbo", ...}
+ */
+nlohmann::json image_encoder_backends();
+
+} // namespace sdcpp
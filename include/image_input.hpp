@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+namespace sdcpp {
+
+/**
+ * Image request fields. Each one takes base64 file bytes, or in their place
+ * an image reference:
+ *   "output:<path>"      a file under the output directory
+ *   "job:<id>[#<n>]"     output n (default 0) of an earlier job; the request
+ *                        handlers turn these into "output:" references
+ * Multipart and raw-body uploads are spooled to <output>/uploads and queued
+ * as "output:" references, so the worker decodes them from the file and the
+ * queued job never carries the image itself.
+ */
+inline constexpr const char* IMAGE_SCALAR_FIELDS[] = {
+    "init_image_base64", "mask_image_base64", "control_image_base64", "end_image_base64", "image_base64",
+};
+inline constexpr const char* IMAGE_ARRAY_FIELDS[] = {
+    "ref_images", "control_frames", "pm_id_images",
+};
+
+inline constexpr std::string_view IMAGE_REF_OUTPUT = "output:";
+inline constexpr std::string_view IMAGE_REF_JOB = "job:";
+
+/**
+ * Root that "output:" references resolve against (the output directory).
+ * Process-wide, set once at startup.
+ */
+void set_image_input_root(const std::string& output_dir);
+
+/** Whether `value` is an "output:" reference (base64 never contains ':') */
+bool is_image_ref(std::string_view value);
+
+/**
+ * "output:" reference for a file under the output directory: relative
+ * paths are taken as relative to it, absolute ones must lie inside it
+ * @throws std::runtime_error for paths outside the output directory
+ */
+std::string image_ref_for_path(const std::string& path);
+
+/**
+ * Absolute path of an "output:" reference
+ * @throws std::runtime_error if it escapes the output directory or the file does not exist
+ */
+std::string image_ref_path(std::string_view ref);
+
+/**
+ * Decode an image field value (base64 or "output:" reference) to RGB
+ * @throws std::runtime_error if it does not decode
+ */
+std::vector<uint8_t> decode_image_input(const std::string& value, int& width, int& height);
+
+/**
+ * Image field a multipart part name fills: the field itself, or its name
+ * without "_base64" ("init_image" -> "init_image_base64")
+ * @return empty for names that are not image fields
+ */
+std::string image_field_for_part(const std::string& part_name);
+
+bool is_image_array_field(const std::string& field);
+
+/**
+ * Drop inline (base64) images from request params, pipeline stages
+ * included; references stay. Used to shrink finished queue jobs.
+ * @return The fields that lost data ("stages[1].init_image_base64", ...)
+ */
+std::vector<std::string> strip_image_blobs(nlohmann::json& params);
+
+/**
+ * Write uploaded image file bytes to <output>/uploads, named by their SHA256
+ * so the same upload is stored once, and return its "output:" reference.
+ * Only the header is parsed here; the pixels are decoded by the worker.
+ * @throws std::runtime_error for data that is not a readable image or a failed write
+ */
+std::string spool_image_upload(std::string_view data);
+
+} // namespace sdcpp
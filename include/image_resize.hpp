@@ -0,0 +1,57 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace sdcpp {
+
+/**
+ * Resampling filter for resize_image()
+ */
+enum class ResizeFilter {
+    Bilinear,   // Triangle filter, widened when downscaling (antialiased)
+    Lanczos3,   // Sharpest; best for upscaling init images
+    Area        // Box filter; averages source pixels, best for large downscales
+};
+
+/**
+ * Parse "bilinear" / "lanczos" / "area" (case-insensitive)
+ * @throws std::runtime_error on unknown names
+ */
+ResizeFilter resize_filter_from_string(const std::string& name);
+
+/**
+ * Separable resampler over interleaved 8-bit images.
+ *
+ * Filter weights are computed once per axis; the horizontal pass writes a
+ * float intermediate and the vertical pass accumulates whole rows with
+ * AVX2/FMA (runtime-detected) or NEON, falling back to scalar code. Both
+ * passes are split across threads when the image is large enough to pay
+ * for them.
+ *
+ * @param src Source pixels; rows are `src_stride` bytes apart (so a crop is
+ *            just an offset pointer with the full image's stride)
+ * @param dst Destination, dst_w * dst_h * channels bytes, tightly packed
+ */
+void resize_image(const uint8_t* src, int src_w, int src_h, size_t src_stride, int channels,
+                  uint8_t* dst, int dst_w, int dst_h,
+                  ResizeFilter filter = ResizeFilter::Bilinear);
+
+/**
+ * Convenience overload for a tightly packed source
+ * @return dst_w * dst_h * channels bytes
+ */
+std::vector<uint8_t> resize_image(const uint8_t* src, int src_w, int src_h, int channels,
+                                  int dst_w, int dst_h,
+                                  ResizeFilter filter = ResizeFilter::Bilinear);
+
+/**
+ * Square center crop of the largest possible size, area-resampled to
+ * size x size (the gallery thumbnail shape)
+ * @return size * size * channels bytes
+ */
+std::vector<uint8_t> make_square_thumbnail(const uint8_t* src, int src_w, int src_h, int channels, int size);
+
+} // namespace sdcpp
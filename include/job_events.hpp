@@ -0,0 +1,98 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+namespace sdcpp {
+
+/**
+ * Per-job event feed for HTTP watchers: GET /queue/{id}/wait, the
+ * /queue/{id}/events SSE stream and synchronous generation requests.
+ *
+ * QueueManager publishes here at the same points it broadcasts job events
+ * over the WebSocket, and the ProgressDispatcher its coalesced progress,
+ * so a watcher sees what a WebSocket client subscribed to the job sees
+ * without taking queue_mutex_ or copying the job. publish() is one map
+ * lookup when nobody watches the job. Thread-safe.
+ */
+class JobEvents {
+public:
+    struct Event {
+        std::string name;                   // "status", "progress", "cancelled" or "deleted"
+        nlohmann::json data;
+    };
+
+    class Watch {
+    public:
+        ~Watch();
+
+        Watch(const Watch&) = delete;
+        Watch& operator=(const Watch&) = delete;
+
+        /**
+         * Next event, waiting up to `timeout`
+         * @return nullopt on timeout, or at once when the feed is closed
+         */
+        std::optional<Event> next(std::chrono::milliseconds timeout);
+
+        /** The job has reached a final state (its last event is queued) */
+        bool finished() const;
+
+        /** The server is shutting down */
+        bool closed() const;
+
+    private:
+        friend class JobEvents;
+        Watch(JobEvents& owner, std::string job_id) : owner_(owner), job_id_(std::move(job_id)) {}
+        void push(const Event& event, bool terminal);
+        void close();
+
+        JobEvents& owner_;
+        const std::string job_id_;
+        mutable std::mutex mutex_;
+        std::condition_variable cv_;
+        std::deque<Event> events_;
+        bool finished_ = false;
+        bool closed_ = false;
+    };
+
+    explicit JobEvents(size_t max_watches);
+
+    /**
+     * Start watching `job_id`. Watch before reading the job's state, so no
+     * event between the two is missed.
+     * @return nullptr when max_watches are open already
+     */
+    std::shared_ptr<Watch> watch(const std::string& job_id);
+
+    void publish(const std::string& job_id, const std::string& name, const nlohmann::json& data);
+
+    /** Wake every watch for shutdown; later watch() calls return nullptr */
+    void close();
+
+    /** {watches, max_watches, rejected, published} */
+    nlohmann::json stats_json() const;
+
+private:
+    void remove(const std::string& job_id, Watch* watch);
+
+    const size_t max_watches_;
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, std::vector<Watch*>> watches_;
+    size_t open_ = 0;
+    bool closed_ = false;
+    uint64_t rejected_ = 0;
+    uint64_t published_ = 0;
+};
+
+} // namespace sdcpp
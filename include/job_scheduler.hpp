@@ -0,0 +1,153 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <unordered_map>
+#include <chrono>
+
+#include <nlohmann/json.hpp>
+#include "config.hpp"
+
+namespace sdcpp {
+
+/**
+ * Priority class a job is queued under (the request's "priority").
+ * Lower values run first.
+ */
+enum class JobPriority {
+    Interactive = 0,
+    Normal = 1,
+    Batch = 2
+};
+
+const char* job_priority_to_string(JobPriority priority);
+
+/** @throws std::runtime_error for anything but "interactive", "normal" or "batch" */
+JobPriority string_to_job_priority(const std::string& str);
+
+/**
+ * Picks the next generation-lane job from the pending queue.
+ *
+ * Pending jobs are ranked first: by priority class, a job moving up one
+ * class for every `priority_aging_seconds` it has waited; then, within a
+ * class, by the recent generation time of the user who queued it (fair
+ * share, decaying with `fair_share_half_life_seconds`); then in queue order.
+ *
+ * Jobs run against whatever is resident on the sd.cpp context, but some
+ * per-job state still costs real time to switch: the LoRA set (sd.cpp
+ * re-applies weight deltas whenever the set or multipliers change) and the
+ * ADetailer detector (ModelManager keeps an LRU-1 adetailer_ctx_t). Each
+ * pending job is reduced to an "affinity key" describing that state, and the
+ * scheduler prefers a job matching the key of the job that just ran.
+ *
+ * Affinity only reorders jobs of the head's (aged) class, and is bounded:
+ * the first ranked job is forced through once it has been passed over
+ * `affinity_max_skips` times or has waited `affinity_max_wait_seconds`.
+ *
+ * Not thread-safe. QueueManager calls it with queue_mutex_ held.
+ */
+class JobScheduler {
+public:
+    enum class Reason { Fifo, Affinity, Fairness, Priority, FairShare };
+
+    struct Candidate {
+        std::string job_id;
+        std::string affinity_key;        // Filled in by QueueManager after rank()
+        std::chrono::system_clock::time_point created_at;
+        JobPriority priority = JobPriority::Normal;
+        std::string owner;               // Authenticated user; "" without auth
+    };
+
+    explicit JobScheduler(const QueueConfig& config);
+
+    /**
+     * Affinity key for a job: captured model name, sorted LoRA tags from the
+     * prompt(s), and ADetailer detector. Empty params produce "model=<name>".
+     */
+    static std::string affinity_key(const nlohmann::json& params,
+                                    const nlohmann::json& model_settings);
+
+    /**
+     * Sort `candidates` (given in queue order) by class, owner share and
+     * queue order, and keep the first lookahead() of them.
+     */
+    void rank(std::vector<Candidate>& candidates);
+
+    /**
+     * `priority` after aging: one class up per priority_aging_seconds
+     * waited since `created_at`
+     */
+    JobPriority effective_priority(JobPriority priority,
+                                   std::chrono::system_clock::time_point created_at,
+                                   std::chrono::system_clock::time_point now) const;
+
+    /** Add generation time used by `owner` to its fair share */
+    void charge(const std::string& owner, double seconds);
+
+    /**
+     * Choose one of `candidates` (ranked, best first) for generation worker
+     * `worker`, preferring the affinity key of the job that worker ran last.
+     * Records the decision and bumps skip counters of jobs that were passed
+     * over.
+     * @return Index into candidates
+     */
+    size_t pick(const std::vector<Candidate>& candidates, Reason* reason = nullptr, int worker = 0);
+
+    /**
+     * Drop bookkeeping for a job that left the pending queue without being
+     * picked (cancelled, deleted).
+     */
+    void forget(const std::string& job_id);
+
+    /**
+     * Max number of candidates QueueManager should collect per pick
+     */
+    size_t lookahead() const;
+
+    bool affinity_enabled() const { return config_.scheduler == "affinity"; }
+
+    /**
+     * Snapshot for /queue: policy, counters, last key, recent decisions
+     */
+    nlohmann::json status_json() const;
+
+    static const char* reason_to_string(Reason reason);
+
+private:
+    struct Decision {
+        std::string job_id;
+        int worker = 0;
+        std::string affinity_key;
+        Reason reason = Reason::Fifo;
+        size_t passed_over = 0;
+        std::chrono::system_clock::time_point at;
+    };
+
+    struct Usage {
+        double seconds = 0.0;
+        std::chrono::steady_clock::time_point at;
+    };
+
+    // Generation seconds charged to `owner`, decayed to now
+    double usage_of(const std::string& owner, std::chrono::steady_clock::time_point now) const;
+
+    QueueConfig config_;
+    std::map<int, std::string> last_keys_;  // Generation worker -> key of its last job
+    std::string last_key_;                  // Of the last pick on any worker
+    std::unordered_map<std::string, Usage> usage_;
+    Reason rank_reason_ = Reason::Fifo;     // Why rank() moved a job to the head
+    std::unordered_map<std::string, int> skip_counts_;
+    std::deque<Decision> recent_;
+    static constexpr size_t RECENT_DECISIONS = 16;
+
+    size_t fifo_picks_ = 0;
+    size_t affinity_picks_ = 0;
+    size_t fairness_picks_ = 0;
+    size_t priority_picks_ = 0;
+    size_t fair_share_picks_ = 0;
+    size_t jobs_reordered_ = 0;     // jobs that ran ahead of an older job
+};
+
+} // namespace sdcpp
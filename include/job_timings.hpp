@@ -0,0 +1,115 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+
+#include <nlohmann/json.hpp>
+
+namespace sdcpp {
+
+/**
+ * Where one job's time goes (metadata.timings on the job).
+ *
+ * The worker creates one per job and installs it on its thread with a
+ * Scope. Everything that runs on that thread then adds to it: sd.cpp's own
+ * "<phase> completed, taking ..." log lines (LoRA apply, conditioning,
+ * sampling, VAE decode, tensor loading), sampler progress ticks (per-step
+ * wall time) and the queue's own spans (upscale, detector load). Each phase
+ * records the peak process RSS and GPU memory in use seen while it ran.
+ *
+ * sd.cpp reports a phase when it ends, so the memory peaks and step times of
+ * an sd.cpp phase are those seen since the previous phase was recorded.
+ * Not thread-safe: only the owning thread touches a JobTimings.
+ *
+ * While the model is split over RPC devices (rpc_split = "auto"), each
+ * phase also gets a per-device estimate: busy time from the device's share
+ * of the weights, and transfer time from its probed round trip per graph
+ * evaluation.
+ */
+class JobTimings {
+public:
+    /** One device of a split model, as planned at load */
+    struct DeviceShare {
+        std::string device;
+        double share = 0.0;                 // Fraction of the weights, and of each step's compute
+        double rtt_ms = 0.0;                // Link round trip; 0 for the local GPU
+    };
+
+    JobTimings();
+
+    /**
+     * The loaded model's device split; timings created afterwards report
+     * per-device figures. Empty when the model runs on one device.
+     */
+    static void set_device_split(std::vector<DeviceShare> devices);
+
+    /** Installs `timings` as this thread's current() for its lifetime */
+    class Scope {
+    public:
+        explicit Scope(JobTimings& timings);
+        ~Scope();
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    private:
+        JobTimings* previous_;
+    };
+
+    /** Records a named phase from construction to destruction on current(), if any */
+    class Span {
+    public:
+        explicit Span(const char* name);
+        ~Span();
+        Span(const Span&) = delete;
+        Span& operator=(const Span&) = delete;
+    private:
+        const char* name_;
+        std::chrono::steady_clock::time_point start_;
+    };
+
+    /** This thread's timings, or nullptr outside a job */
+    static JobTimings* current();
+
+    /** Feed an sd.cpp INFO log line; credits current() with any phase it reports */
+    static void note_sd_log(const std::string& message);
+
+    /** Sampler progress tick on this thread (per-step times, memory peaks) */
+    static void note_step();
+
+    void set_queue_wait_ms(int64_t ms) { queue_wait_ms_ = ms; }
+
+    /** Add a finished phase of `ms`, taking the peaks and steps gathered since the last one */
+    void add_phase(const std::string& name, int64_t ms);
+
+    /** Summary: queue_wait_ms, run_ms (since construction), phases, overall peaks */
+    nlohmann::json to_json() const;
+
+private:
+    void sample_memory();
+
+    struct Phase {
+        std::string name;
+        int64_t ms = 0;
+        uint64_t peak_rss = 0;
+        uint64_t peak_vram = 0;
+        std::vector<int64_t> step_ms;
+    };
+
+    std::chrono::steady_clock::time_point start_;
+    std::vector<DeviceShare> devices_;      // Split in effect when the job started
+    int64_t queue_wait_ms_ = -1;
+    std::vector<Phase> phases_;
+    int samplings_ = 0;                     // "sampling" phases so far (the second is the hires pass)
+
+    // Since the last recorded phase
+    std::chrono::steady_clock::time_point last_tick_;
+    std::vector<int64_t> window_steps_;
+    uint64_t window_rss_ = 0;
+    uint64_t window_vram_ = 0;
+
+    uint64_t peak_rss_ = 0;
+    uint64_t peak_vram_ = 0;
+};
+
+} // namespace sdcpp
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <atomic>
+#include <array>
+#include <mutex>
+#include <vector>
+#include <thread>
+#include <cstdint>
+
+#include <nlohmann/json.hpp>
+
+namespace sdcpp {
+
+/**
+ * Opt-in execution timeline of one job (queue.trace_jobs), exported as a
+ * Chrome trace (chrome://tracing, ui.perfetto.dev).
+ *
+ * A trace is created when the job is enqueued and registered by job id,
+ * so any thread that knows the id can add to it: the HTTP handler that
+ * submitted it, the generation worker (scheduler pick, model load,
+ * new_sd_ctx, each sampling step, sd.cpp's reported phases, preview
+ * encodes), the output pipeline (image writes) and the WebSocket server
+ * (broadcasts). The worker also installs it as its thread's current().
+ *
+ * Each thread appends to its own chunked buffer inside the trace: writes
+ * are lock-free, and the trace's mutex is only taken the first time a
+ * thread writes to a given trace. When tracing is off every entry point is
+ * one relaxed atomic load.
+ */
+class JobTrace {
+public:
+    explicit JobTrace(std::string job_id);
+    ~JobTrace();
+
+    JobTrace(const JobTrace&) = delete;
+    JobTrace& operator=(const JobTrace&) = delete;
+
+    static void set_enabled(bool enabled);
+    static bool enabled() { return enabled_.load(std::memory_order_relaxed); }
+
+    /** Create and register the trace of a new job; null when tracing is off */
+    static std::shared_ptr<JobTrace> start(const std::string& job_id);
+
+    /** Registered trace of a job, or null */
+    static std::shared_ptr<JobTrace> find(const std::string& job_id);
+
+    /** Unregister and return a job's trace (at export) */
+    static std::shared_ptr<JobTrace> take(const std::string& job_id);
+
+    /** This thread's trace (set by Scope), or nullptr */
+    static JobTrace* current();
+
+    /** Installs `trace` (may be null) as this thread's current() for its lifetime */
+    class Scope {
+    public:
+        explicit Scope(JobTrace* trace);
+        ~Scope();
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    private:
+        JobTrace* previous_;
+    };
+
+    /** Records [construction, destruction) on `trace`, or on current() */
+    class Span {
+    public:
+        explicit Span(const char* name, const char* category = "job");
+        Span(JobTrace* trace, const char* name, const char* category = "job");
+        ~Span();
+        Span(const Span&) = delete;
+        Span& operator=(const Span&) = delete;
+    private:
+        JobTrace* trace_;
+        const char* name_;
+        const char* category_;
+        int64_t start_us_ = 0;
+    };
+
+    /**
+     * Wraps an API handler. A trace started on this thread while it runs
+     * (i.e. the job the request submitted) gets the whole handler as a span.
+     */
+    class RequestScope {
+    public:
+        RequestScope(const std::string& method, const std::string& route);
+        ~RequestScope();
+        RequestScope(const RequestScope&) = delete;
+        RequestScope& operator=(const RequestScope&) = delete;
+    private:
+        bool active_ = false;
+    };
+
+    /** Label for this thread's track in traces (e.g. "generation-0") */
+    static void set_thread_name(const std::string& name);
+
+    /** Sampler progress tick on this thread: one span per step */
+    static void note_step(int step, int steps);
+
+    /** A phase of `ms` that just ended on this thread (JobTimings) */
+    static void note_phase(const std::string& name, int64_t ms);
+
+    /** Microseconds on the trace clock (steady, process-wide origin) */
+    static int64_t now_us();
+
+    void complete(const std::string& name, const char* category, int64_t start_us, int64_t end_us,
+                  const std::string& detail = "");
+    void instant(const std::string& name, const char* category, const std::string& detail = "");
+
+    const std::string& job_id() const { return job_id_; }
+    int64_t created_us() const { return created_us_; }
+
+    /** {"traceEvents": [...], ...} in the Chrome trace event format */
+    nlohmann::json to_chrome_json() const;
+
+private:
+    struct Event {
+        std::string name;
+        const char* category = "";
+        char phase = 'X';
+        int64_t ts_us = 0;
+        int64_t dur_us = 0;
+        std::string detail;
+    };
+
+    // Written by one thread, read by to_chrome_json() up to the published count
+    struct ThreadBuffer {
+        static constexpr size_t CHUNK = 1024;
+        static constexpr size_t MAX_CHUNKS = 256;
+
+        std::thread::id owner;
+        int tid = 0;
+        std::string thread_name;
+        std::array<std::atomic<Event*>, MAX_CHUNKS> chunks{};
+        std::atomic<size_t> count{0};
+
+        ~ThreadBuffer();
+    };
+
+    ThreadBuffer* buffer_for_this_thread();
+    void push(Event&& event);
+
+    static std::atomic<bool> enabled_;
+
+    const std::string job_id_;
+    const uint64_t serial_;
+    const int64_t created_us_;
+    mutable std::mutex buffers_mutex_;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers_;
+    std::atomic<uint64_t> dropped_{0};
+};
+
+} // namespace sdcpp
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+
+#include <nlohmann/json.hpp>
+
+#include "warm_model_cache.hpp"
+
+namespace sdcpp {
+
+/**
+ * Resident LoRA files and the LoRA set applied to the loaded context.
+ *
+ * sd.cpp reads each LoRA safetensors from disk whenever it has to merge it
+ * (and on every job in at_runtime mode); its tensors can't be handed in from
+ * outside. This keeps the files of recently used LoRAs mapped under their
+ * own RAM budget (a WarmModelCache), so those reads come from page cache.
+ *
+ * It also mirrors the set sd.cpp has merged into the current context. In
+ * immediately mode sd.cpp only merges the multiplier difference against
+ * that set, so a job that reuses the previous job's LoRAs costs nothing;
+ * prepare() reports which LoRAs were added, removed or re-weighted, and
+ * finish() adds the apply time sd.cpp logged for the call.
+ *
+ * prepare()/finish()/reset() run under the model context mutex; stats are
+ * safe from any thread.
+ */
+class LoraCache {
+public:
+    struct Lora {
+        std::string path;
+        float multiplier = 1.0f;
+        bool is_high_noise = false;
+    };
+
+    LoraCache(uint64_t budget_bytes, bool pin);
+
+    bool enabled() const { return files_->enabled(); }
+
+    /**
+     * Make `loras` resident and diff them against the applied set, which
+     * becomes `loras`. Call right before the generate call.
+     * @return Job metadata: count, added, removed, changed, unchanged,
+     *         resident (all files were already mapped) and prepare_ms
+     */
+    nlohmann::json prepare(const std::vector<Lora>& loras);
+
+    /**
+     * Add apply_ms (sd.cpp's own LoRA apply time for the call that followed
+     * prepare(), when it logged one) to the metadata
+     */
+    void finish(nlohmann::json& info) const;
+
+    /** Forget the applied set (new or unloaded context) */
+    void reset();
+
+    /** Drop the mapped files */
+    void clear() { files_->clear(); }
+
+    /** For /health and /memory: the file cache stats plus the applied set */
+    nlohmann::json stats_json() const;
+
+    /** Feed an sd.cpp log line; picks up the "apply_loras completed" timing */
+    static void note_sd_log(const std::string& message);
+
+private:
+    static std::string key(const Lora& l);
+
+    std::unique_ptr<WarmModelCache> files_;
+
+    mutable std::mutex mutex_;
+    std::map<std::string, float> applied_;  // key -> multiplier
+
+    static std::atomic<int64_t> last_apply_ms_;  // -1 = not logged this call
+};
+
+} // namespace sdcpp
@@ -3,6 +3,9 @@
 #include "httplib_compat.h"
 #include <nlohmann/json.hpp>
 #include <string>
+#include <list>
+#include <mutex>
+#include <unordered_map>
 
 namespace sdcpp {
 
@@ -62,12 +65,28 @@ private:
     static std::string get_base_url(const httplib::Request& req);
     nlohmann::json rewrite_job_outputs(const nlohmann::json& job_json) const;
 
+    // tool_image JPEG (base64) for an output, through the preview cache
+    std::string image_preview(const std::string& path, int max_dim, std::string& err);
+
     httplib::Server& server_;
     ModelManager& model_manager_;
     QueueManager& queue_manager_;
     AuthManager& auth_manager_;
     const McpConfig& mcp_config_;
     std::string base_url_;  // Set per-request from Host header
+
+    // tool_image results by (path, mtime, max_dim, quality), most recent
+    // first. Outputs are write-once, so an agent polling the same job's
+    // images gets them without another decode/resize/encode.
+    struct CachedPreview {
+        std::string key;
+        std::string base64;
+    };
+    static constexpr size_t PREVIEW_CACHE_BYTES = 32 * 1024 * 1024;
+    std::mutex preview_mutex_;
+    std::list<CachedPreview> previews_;
+    std::unordered_map<std::string, std::list<CachedPreview>::iterator> preview_index_;
+    size_t preview_bytes_ = 0;
 };
 
 } // namespace sdcpp
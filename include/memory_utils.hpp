@@ -1,10 +1,21 @@
 #pragma once
 
 #include <cstdint>
+#include <vector>
 #include <nlohmann/json.hpp>
 
 namespace sdcpp {
 
+/**
+ * RAM of one NUMA node (from /sys/devices/system/node/node<N>/meminfo)
+ */
+struct NumaNodeMemory {
+    int node = 0;
+    uint64_t total = 0;
+    uint64_t free = 0;
+    uint64_t file_pages = 0;       // Page cache on the node (mmapped model files among it)
+};
+
 /**
  * Memory information structure
  */
@@ -18,6 +29,9 @@ struct MemoryInfo {
     uint64_t process_rss = 0;      // Resident Set Size (physical memory used by process)
     uint64_t process_virtual = 0;  // Virtual memory size
 
+    // Per NUMA node (empty without NUMA support in the kernel)
+    std::vector<NumaNodeMemory> numa_nodes;
+
     // GPU VRAM (in bytes) - only available if GPU backend enabled
     bool gpu_available = false;
     uint64_t gpu_total = 0;
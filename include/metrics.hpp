@@ -0,0 +1,106 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <atomic>
+#include <shared_mutex>
+#include <cstdint>
+
+namespace sdcpp {
+namespace metrics {
+
+/**
+ * Cumulative histogram with fixed upper bounds. observe() is a couple of
+ * relaxed atomic increments, so it is safe on any hot path.
+ */
+class Histogram {
+public:
+    explicit Histogram(const std::vector<double>& bounds);
+
+    void observe(double value);
+
+    /** Prometheus text lines for `name` with `labels` ("" or `a="b",c="d"`) */
+    void render(std::string& out, const std::string& name, const std::string& labels) const;
+
+private:
+    const std::vector<double>& bounds_;
+    std::unique_ptr<std::atomic<uint64_t>[]> buckets_;  // one per bound, plus +Inf
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> sum_micros_{0};
+};
+
+/**
+ * A metric name with one Histogram or counter per label-value combination.
+ * with() takes a shared lock to find the series (exclusive only the first
+ * time a combination is seen); the update itself is lock-free.
+ */
+class HistogramFamily {
+public:
+    HistogramFamily(std::string name, std::string help, std::vector<double> bounds,
+                    std::vector<std::string> label_names);
+
+    Histogram& with(const std::vector<std::string>& label_values);
+    void render(std::string& out) const;
+
+private:
+    const std::string name_;
+    const std::string help_;
+    const std::vector<double> bounds_;
+    const std::vector<std::string> label_names_;
+    mutable std::shared_mutex mutex_;
+    std::map<std::vector<std::string>, std::unique_ptr<Histogram>> series_;
+};
+
+class CounterFamily {
+public:
+    CounterFamily(std::string name, std::string help, std::vector<std::string> label_names);
+
+    std::atomic<uint64_t>& with(const std::vector<std::string>& label_values);
+    void inc(const std::vector<std::string>& label_values, uint64_t n = 1) {
+        with(label_values).fetch_add(n, std::memory_order_relaxed);
+    }
+    void render(std::string& out) const;
+
+private:
+    const std::string name_;
+    const std::string help_;
+    const std::vector<std::string> label_names_;
+    mutable std::shared_mutex mutex_;
+    std::map<std::vector<std::string>, std::unique_ptr<std::atomic<uint64_t>>> series_;
+};
+
+/**
+ * Everything that is recorded as it happens. Gauges that are cheaper to
+ * read at scrape time (queue depth, memory, cache stats) are written by
+ * their owners straight into the /metrics response instead.
+ */
+struct Registry {
+    HistogramFamily job_duration;           // type, model
+    HistogramFamily job_queue_wait;         // type
+    CounterFamily jobs_finished;            // type, status
+    HistogramFamily model_load;             // result
+    HistogramFamily http_request_duration;  // method, route
+    CounterFamily http_responses;           // method, route, code
+
+    Registry();
+
+    /** Prometheus text for all of the above */
+    std::string render() const;
+};
+
+/** Process-wide registry */
+Registry& registry();
+
+/** `# HELP` and `# TYPE` lines */
+void write_header(std::string& out, const std::string& name, const std::string& help, const char* type);
+
+/** One sample line; `labels` as for Histogram::render */
+void write_sample(std::string& out, const std::string& name, const std::string& labels, double value);
+
+/** `key="value"` with the value escaped for the text format */
+std::string label(const std::string& key, const std::string& value);
+
+} // namespace metrics
+} // namespace sdcpp
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include <optional>
+#include <mutex>
+#include <functional>
+#include <cstdint>
+
+#include <nlohmann/json.hpp>
+#include "utils.hpp"
+
+namespace sdcpp {
+
+/**
+ * On-disk catalog of the model directories: per-directory listings, per-file
+ * size/mtime, SHA256 hashes and cached content probes.
+ *
+ * scan() walks a model root but only re-reads directories whose mtime
+ * changed since the catalog last saw them; files in an unchanged directory
+ * come straight from the catalog without a stat. Adding, removing or
+ * renaming a file (downloads and uploads rename into place) bumps its
+ * directory's mtime, so startup and /models/refresh cost O(changed
+ * directories) rather than O(files) — which matters on NFS model stores.
+ * A file rewritten in place without a rename is only noticed by a full
+ * scan (scan(..., true)).
+ *
+ * Hashes and probes are keyed by (path, size, mtime) and survive restarts
+ * in <output>/model_catalog.json (temp file + rename). Thread-safe; hashing
+ * runs outside the lock.
+ */
+class ModelCatalog {
+public:
+    /**
+     * @param catalog_file Catalog location
+     * @param legacy_hash_file Hash-only cache from older versions, imported
+     *        once when the catalog does not exist yet (may be empty)
+     */
+    ModelCatalog(std::string catalog_file, const std::string& legacy_hash_file = "");
+    ~ModelCatalog();
+
+    ModelCatalog(const ModelCatalog&) = delete;
+    ModelCatalog& operator=(const ModelCatalog&) = delete;
+
+    struct ScannedFile {
+        std::string rel_path;       // Relative to the scanned root, '/'-separated
+        std::string full_path;
+        uint64_t size = 0;
+        std::string sha256;         // Empty if not known yet
+    };
+
+    /**
+     * Begin a catalog pass. Entries not visited by scan() calls before
+     * end_scan() are dropped (deleted files, removed roots).
+     */
+    void begin_scan();
+    void end_scan();
+
+    /**
+     * List model files under `root` (recursive)
+     * @param extensions Lower-case extensions with dot (".safetensors")
+     * @param full Re-read every directory and stat every file
+     */
+    std::vector<ScannedFile> scan(const std::string& root, const std::vector<std::string>& extensions, bool full);
+
+    /**
+     * Cached utils::is_zip_archive() of a cataloged file
+     */
+    bool is_zip_archive(const std::string& full_path);
+
+    /**
+     * Cached hash of `path`, if the file still has the recorded size and mtime
+     */
+    std::optional<std::string> lookup(const std::string& path) const;
+
+    /**
+     * Record a hash computed elsewhere (e.g. while downloading). Stats the
+     * file now, so call it once the file is in its final place.
+     */
+    void store(const std::string& path, const std::string& sha256);
+
+    /**
+     * Cached hash, or compute it with utils::compute_sha256 and store it
+     * @throws std::runtime_error if the file cannot be read
+     */
+    std::string get_or_compute(const std::string& path, const utils::HashProgressCallback& progress = nullptr);
+
+    /**
+     * Hash several files concurrently (one file per thread). Cached files
+     * are returned without reading them.
+     * @param progress Called on the calling thread with (files finished, files total)
+     * @return path -> hash; files that failed are logged and omitted
+     */
+    std::map<std::string, std::string> get_or_compute_many(
+        const std::vector<std::string>& paths, int threads,
+        const std::function<void(size_t done, size_t total)>& progress = nullptr);
+
+    /**
+     * Stats: files, directories, hashes, last scan (directories reused /
+     * re-read, files statted, duration), hash hits/misses, bytes_hashed
+     */
+    nlohmann::json stats_json() const;
+
+private:
+    struct FileEntry {
+        uint64_t size = 0;
+        int64_t mtime_ns = 0;
+        std::string sha256;
+        int zip_archive = -1;       // -1 = not probed
+    };
+
+    struct DirEntry {
+        int64_t mtime_ns = 0;
+        std::vector<std::string> files;     // Names of regular files
+        std::vector<std::string> subdirs;   // Names of subdirectories
+    };
+
+    static bool stat_path(const std::string& path, bool want_dir, uint64_t& size, int64_t& mtime_ns);
+    void load(const std::string& legacy_hash_file);
+    void save_locked();
+    void walk_locked(const std::string& dir, const std::string& rel_prefix,
+                     const std::vector<std::string>& extensions, bool full,
+                     std::vector<ScannedFile>& out);
+
+    std::string catalog_file_;
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, FileEntry> files_;
+    std::unordered_map<std::string, DirEntry> dirs_;
+    bool dirty_ = false;
+    int64_t last_save_ms_ = 0;
+
+    // begin_scan()/end_scan() bookkeeping
+    bool scanning_ = false;
+    std::unordered_set<std::string> seen_files_;
+    std::unordered_set<std::string> seen_dirs_;
+
+    // Last pass
+    uint64_t dirs_reused_ = 0;
+    uint64_t dirs_read_ = 0;
+    uint64_t files_statted_ = 0;
+    int64_t last_scan_ms_ = 0;
+    int64_t scan_started_ms_ = 0;
+
+    mutable uint64_t hits_ = 0;
+    mutable uint64_t misses_ = 0;
+    uint64_t bytes_hashed_ = 0;
+};
+
+} // namespace sdcpp
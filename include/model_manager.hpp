@@ -10,6 +10,15 @@
 #include <cmath>
 
 #include "config.hpp"
+#include "warm_model_cache.hpp"
+#include "lora_cache.hpp"
+#include "conditioning_cache.hpp"
+#include "model_prefetcher.hpp"
+#include "model_catalog.hpp"
+#include "vram_estimator.hpp"
+#include "offload_tuner.hpp"
+#include "quant_cache.hpp"
+#include "numa_placement.hpp"
 
 // Forward declaration of sd.cpp types
 struct sd_ctx_t;
@@ -46,7 +55,7 @@ struct ModelInfo {
     ModelType type;
     std::string file_extension; // "safetensors", "gguf", "ckpt"
     size_t file_size = 0;
-    std::string hash;           // SHA256, computed on demand
+    std::string hash;           // SHA256: from the hash cache, a download, or computed on demand
     
     nlohmann::json to_json() const;
 };
@@ -161,6 +170,8 @@ struct ModelLoadParams {
     // request after a load should be fast, so we flip the default. Users
     // can still pass eager_load=false to opt out.
     bool eager_load = true;
+    std::optional<bool> mlock;                  // mlock the weight buffers after the load
+                                                 // (unset = numa.mlock, see NumaPlacement)
 
     // RNG options
     std::string rng_type = "cuda";              // std_default, cuda, cpu
@@ -202,6 +213,18 @@ struct ModelLoadParams {
     std::string rpc_servers = "";               // RPC distributed-backend node list (leejet PR #1629).
                                                  // Format is sd.cpp's own — comma-separated "host:port" pairs.
                                                  // Empty = no RPC, ctx_params.rpc_servers stays nullptr.
+    std::string rpc_split = "";                 // "auto": probe the RPC servers and budget max_vram per device
+                                                 // by free VRAM (see plan_rpc_split). "" = as given.
+
+    // Offload autotune: "auto" reuses the settings chosen for this model,
+    // GPU and resolution bucket, calibrating them first if there are none;
+    // "force" always calibrates. The chosen options replace max_vram /
+    // stream_layers (offload_mode / streaming_prefetch_layers on
+    // SDCPP_EXPERIMENTAL_OFFLOAD builds). "" = as given.
+    std::string offload_tune = "";
+    int tune_width = 1024;                      // Calibration resolution (its bucket keys the cache)
+    int tune_height = 1024;
+    int tune_steps = 4;                         // Sampling steps per calibration run (>= 2)
 
     static ModelLoadParams from_json(const nlohmann::json& j);
 };
@@ -220,9 +243,12 @@ public:
     ModelManager& operator=(const ModelManager&) = delete;
     
     /**
-     * Scan all configured directories for models
+     * Scan all configured directories for models. Incremental by default:
+     * directories unchanged since the last scan (by mtime) are taken from
+     * the model catalog without being read.
+     * @param full Re-read every directory and stat every file
      */
-    void scan_models();
+    void scan_models(bool full = false);
 
     /**
      * If a previous run persisted its last-loaded model identity to disk,
@@ -284,7 +310,7 @@ public:
      * Used by /models/load to reject concurrent loads with 409 instead of
      * letting the second request queue on context_mutex_ for minutes.
      */
-    bool is_loading() const { return model_loading_.load(); }
+    bool is_loading() const { return model_loading_.load() || offload_tuning_.load(); }
 
     /**
      * Last load failure message, or empty string if the most recent load
@@ -311,6 +337,20 @@ public:
      * Get info about all currently loaded models as JSON
      */
     nlohmann::json get_loaded_models_info() const;
+
+    /**
+     * Weight size, architecture and attention/offload options of the
+     * loaded model, for VRAM admission (see estimate_job_vram)
+     */
+    VramModelInfo get_vram_model_info() const;
+
+    /**
+     * Load the current model again with some of its load options replaced
+     * (VRAM admission turning on max_vram / stream_layers). Must not be
+     * called with the context mutex held.
+     * @return false when no model is loaded or the reload failed
+     */
+    bool reload_with_options(const nlohmann::json& options);
     
     /**
      * Compute hash for a model (thread-safe, caches result)
@@ -319,23 +359,70 @@ public:
      * @return SHA256 hash
      */
     std::string compute_model_hash(const std::string& name, ModelType type);
+
+    /**
+     * Hash a file by path through the model catalog and attach the
+     * result to its registry entry. The registry lock is not held while
+     * reading the file.
+     */
+    std::string hash_model_file(const std::string& full_path,
+                                const utils::HashProgressCallback& progress = nullptr);
+
+    /**
+     * Hash several files concurrently (see ModelCatalog::get_or_compute_many)
+     * @return full_path -> hash for the files that could be read
+     */
+    std::map<std::string, std::string> hash_model_files(
+        const std::vector<std::string>& full_paths, int threads,
+        const std::function<void(size_t done, size_t total)>& progress = nullptr);
+
+    /**
+     * Record a hash computed elsewhere (e.g. during download) for a file
+     * already in its final location
+     */
+    void record_model_hash(const std::string& full_path, const std::string& sha256);
+
+    /**
+     * Full paths of registered models with no known hash
+     * @param type Restrict to one model type (all types if nullopt)
+     */
+    std::vector<std::string> get_unhashed_model_paths(std::optional<ModelType> type = std::nullopt) const;
     
+    /**
+     * Generation devices (queue.generation_devices), at least 1. Every load
+     * creates one context per device; device 0 is the one the rest of the
+     * model state (controlnet, ADetailer, upscaler) belongs to.
+     */
+    size_t device_count() const { return 1 + devices_.size(); }
+
+    /**
+     * The loaded model has a context on `device` (a copy on another device
+     * may have failed to load, e.g. for lack of VRAM there)
+     */
+    bool is_model_loaded(size_t device) const;
+
     /**
      * Get SD context for generation (caller must hold lock)
      * @return Pointer to sd_ctx_t or nullptr if not loaded
      */
-    sd_ctx_t* get_context();
+    sd_ctx_t* get_context(size_t device = 0);
     
     /**
      * Get mutex for locking context during generation
      */
-    std::mutex& get_context_mutex();
+    std::mutex& get_context_mutex(size_t device = 0);
     
     /**
      * Get the LoRA directory path
      */
     std::string get_lora_dir() const;
 
+    /**
+     * Resident LoRA files and the applied LoRA set of the context on
+     * `device`. Use with that device's context mutex held.
+     */
+    LoraCache& lora_cache(size_t device = 0) { return device == 0 ? *lora_cache_ : *devices_[device - 1]->loras; }
+
     // ==================== ControlNet hot-swap ====================
     // Load / swap a ControlNet on the currently loaded model without a full
     // context reload. Uses sd_ctx_load_control_net upstream. Acquires the
@@ -361,7 +448,8 @@ public:
      * Load an upscaler model
      * @param model_name ESRGAN model name
      * @param n_threads Number of threads (-1 = auto)
-     * @param tile_size Tile size for processing (default 128)
+     * @param tile_size Tile size for processing (default 128; <= 0 picks
+     *        the largest that fits the free VRAM)
      * @return true if successful
      */
     bool load_upscaler(const std::string& model_name, int n_threads = -1, int tile_size = 128);
@@ -390,6 +478,11 @@ public:
      * Get loaded upscaler model name
      */
     std::string get_loaded_upscaler_name() const;
+
+    /**
+     * Get the tile_size the loaded upscaler was created with
+     */
+    int get_upscaler_tile_size() const;
     
     /**
      * Get upscale factor from currently loaded model
@@ -402,14 +495,107 @@ public:
      */
     void update_loading_progress(int step, int total_steps);
 
+    /**
+     * Same, for the parallel pre-read: steps are MiB and `components` the
+     * per-file progress ({component, bytes, bytes_read, done})
+     */
+    void update_loading_progress(int step, int total_steps, const nlohmann::json& components);
+
     /**
      * Get paths configuration as JSON for download manager
      */
     nlohmann::json get_paths_config() const;
 
+    /**
+     * Warm model cache statistics (for /health and /memory). Does not take
+     * the context mutex.
+     */
+    nlohmann::json get_model_cache_stats() const;
+
+    /**
+     * LoRA cache statistics (lora_cache config). Does not take the context
+     * mutex.
+     */
+    nlohmann::json get_lora_cache_stats() const;
+
+    /**
+     * Conditioning cache statistics (conditioning_cache config), plus
+     * `available`: whether the build has the sd.cpp hook. Does not take
+     * the context mutex.
+     */
+    nlohmann::json get_conditioning_cache_stats() const;
+
+    /**
+     * Start reading the component files of `params` into RAM in the
+     * background, so a later load_model(params) doesn't wait on the disk.
+     * Never takes the context mutex: it runs while the current model keeps
+     * generating. Throws if the main model doesn't exist.
+     * @return ModelPrefetcher::request() result
+     */
+    nlohmann::json prefetch_model(const ModelLoadParams& params);
+
+    /** Prefetch statistics (for /memory) */
+    nlohmann::json get_prefetch_stats() const;
+
+    /**
+     * What a fixed-seed generation's output depends on besides its params:
+     * loaded model and component names, load options, and the SHA256 (or
+     * the size, while unhashed) of each of those files. Does not take the
+     * context mutex.
+     */
+    nlohmann::json get_loaded_model_fingerprint() const;
+
+    /**
+     * Append model state and cache gauges to a /metrics response. Does not
+     * take the context mutex.
+     */
+    void append_metrics(std::string& out) const;
+
+    /**
+     * Model catalog statistics (files, hashes, last scan cost, hash hits)
+     */
+    nlohmann::json get_catalog_stats() const;
+
+    /** Quantized copies of frequently loaded models (quant_cache config) */
+    QuantCache& quant_cache() { return *quant_cache_; }
+
+    /** NUMA / huge page placement of the loaded weights (for /health and /memory) */
+    nlohmann::json get_numa_stats() const;
+
+    /**
+     * Params of the convert job that fills the quantization cache next
+     * (quant_cache: true), or nullopt when nothing is due
+     */
+    std::optional<nlohmann::json> next_quantize_job() const;
+
 private:
-    void scan_directory(const std::string& base_path, ModelType type);
+    /** load_model with offload_tune set: cached settings, or calibrate them */
+    bool load_model_tuned(const ModelLoadParams& params);
+
+    /** Files a load of `params` reads, main model first. Throws if it does not exist. */
+    std::vector<std::string> component_paths(const ModelLoadParams& params) const;
+
+    /** Load `params` with `options` overlaid and time a short txt2img */
+    OffloadTuneTrial run_offload_trial(const ModelLoadParams& params, const nlohmann::json& options);
+
+    void scan_directory(const std::string& base_path, ModelType type, bool full);
     std::string get_base_path(ModelType type) const;
+
+    /** Read {component, path} files into the page cache concurrently, reporting progress */
+    void preread_components(const std::vector<std::pair<std::string, std::string>>& files);
+
+    /** Lock every generation device after context_mutex_, in device order */
+    std::vector<std::unique_lock<std::mutex>> lock_devices();
+
+    /** Free the contexts on devices 1..n-1 (device locks held) */
+    void free_device_contexts();
+
+    /**
+     * Give every loaded context its conditioning cache scope: a hash of
+     * the model fingerprint without the ControlNet, which never touches
+     * the text encoders
+     */
+    void publish_conditioning_scope();
     
     Config config_;
     
@@ -442,18 +628,77 @@ private:
 
     // Store the load options used when loading the model
     nlohmann::json loaded_options_;
+    // The whole load request (last_loaded_model.json) and the size of its files
+    nlohmann::json loaded_request_;
+    std::atomic<uint64_t> loaded_weight_bytes_{0};
+    // rpc_split = "auto": the probe and split the model was loaded with
+    nlohmann::json rpc_split_plan_;
+    // offload_tune: what picked the loaded model's offload settings. The
+    // pending one is handed over by the load that applies it.
+    nlohmann::json offload_tune_;
+    nlohmann::json pending_offload_tune_;
+    std::atomic<bool> offload_tuning_{false};   // Calibrating (spans several loads)
     
+    // Copies of the loaded model on generation devices 1..n-1 (device 0 is
+    // context_). Created and freed only by load_model / unload_model, which
+    // hold context_mutex_ and then every device mutex.
+    struct DeviceContext {
+        std::string backend;
+        std::mutex mutex;
+        sd_ctx_t* ctx = nullptr;
+        std::atomic<bool> loaded{false};
+        std::unique_ptr<LoraCache> loras;
+    };
+    std::vector<std::unique_ptr<DeviceContext>> devices_;
+    std::string device0_backend_;            // queue.generation_devices[0], or "" without a list
+
     // Upscaler context (separate from main SD context)
     mutable std::mutex upscaler_mutex_;
     upscaler_ctx_t* upscaler_context_ = nullptr;
     std::atomic<bool> upscaler_loaded_{false};  // Lock-free check for is_upscaler_loaded
     std::string loaded_upscaler_name_;
+    std::atomic<int> upscaler_tile_size_{128};
 
     // ADetailer ctx cache (LRU size 1). Guarded by context_mutex_ since the
     // ADetailer inpaint pass reuses the loaded sd_ctx_t and callers already
     // hold the same mutex during generation.
     adetailer_ctx_t* adetailer_context_ = nullptr;
     std::string loaded_adetailer_name_;
+
+    // Host-RAM LRU of recently loaded model files (model_cache config)
+    std::unique_ptr<WarmModelCache> warm_cache_;
+
+    // Recently used LoRA files, kept mapped (lora_cache config)
+    std::unique_ptr<LoraCache> lora_cache_;
+
+    // Encoded prompts reused across generate calls (conditioning_cache config)
+    std::unique_ptr<ConditioningCache> conditioning_cache_;
+
+    // Background read-ahead of the next model's files (POST /models/prefetch)
+    std::unique_ptr<ModelPrefetcher> prefetcher_;
+
+    // Per-component progress while load_model pre-reads files (null otherwise)
+    mutable std::mutex preread_mutex_;
+    nlohmann::json preread_components_;
+
+    // Directory listings, sizes, hashes and probes, persisted in
+    // <output>/model_catalog.json
+    std::unique_ptr<ModelCatalog> catalog_;
+
+    // offload_tune's chosen settings, persisted in <output>/offload_tune.json
+    std::unique_ptr<OffloadTuneCache> tune_cache_;
+
+    // Quantized GGUFs of often loaded float models, indexed in <output>/quant_cache.json
+    std::unique_ptr<QuantCache> quant_cache_;
+
+    // Weight placement after new_sd_ctx() (numa config)
+    std::unique_ptr<NumaPlacement> placement_;
+
+    // n_threads for -1: physical cores this process may run on
+    int default_threads() const;
+
+    // Set ModelInfo::hash on every registry entry for full_path
+    void set_registry_hash(const std::string& full_path, const std::string& hash);
 };
 
 // String conversions
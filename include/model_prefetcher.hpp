@@ -0,0 +1,101 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+
+#include <nlohmann/json.hpp>
+
+namespace sdcpp {
+
+class WarmModelCache;
+
+/**
+ * Background read-ahead of a model's component files.
+ *
+ * Loading a model needs the sd.cpp context mutex and, since /models/load
+ * replaces the loaded model, it can't start while jobs still sample on the
+ * current one. Reading the next model's files can: a prefetch pulls them
+ * into the page cache (or into the warm model cache when that is enabled)
+ * while the current model keeps working, so the later load parses from RAM
+ * instead of stacking a multi-GB disk read behind the generation.
+ *
+ * Reads run on one thread, in 8 MiB chunks. A prefetch is skipped, and one
+ * in progress stops, when MemAvailable would drop below the configured
+ * reserve; prefetching must never push the running job into swap.
+ */
+class ModelPrefetcher {
+public:
+    ModelPrefetcher(uint64_t min_free_bytes, WarmModelCache* warm_cache);
+    ~ModelPrefetcher();
+
+    ModelPrefetcher(const ModelPrefetcher&) = delete;
+    ModelPrefetcher& operator=(const ModelPrefetcher&) = delete;
+
+    /**
+     * Queue `paths` for read-ahead under `label` (the model name). A request
+     * that hasn't started yet is replaced; one in progress finishes first.
+     * @return {label, files, bytes, state}: state is "queued",
+     *         "skipped_low_ram" (not enough host RAM for all files) or
+     *         "already_queued"
+     */
+    nlohmann::json request(const std::string& label, const std::vector<std::string>& paths);
+
+    /** Stop the running read-ahead and drop queued ones */
+    void cancel();
+
+    /** For /memory: totals and the current or last prefetch */
+    nlohmann::json stats_json() const;
+
+    /**
+     * Read `path` into the page cache: fadvise(WILLNEED) plus a sequential
+     * read. Stops early (returning false) when `stop` becomes true or, if
+     * min_free_bytes > 0, when MemAvailable drops below it.
+     * @param bytes_read Incremented as chunks are read
+     */
+    static bool read_into_page_cache(const std::string& path,
+                                     const std::atomic<bool>& stop,
+                                     std::atomic<uint64_t>& bytes_read,
+                                     uint64_t min_free_bytes = 0);
+
+private:
+    struct Request {
+        std::string label;
+        std::vector<std::string> paths;
+        uint64_t bytes = 0;
+    };
+
+    void worker_loop();
+    void run(const Request& req);
+
+    const uint64_t min_free_bytes_;
+    WarmModelCache* warm_cache_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<Request> queue_;     // at most one waiting request
+    std::thread thread_;
+    bool stopping_ = false;
+    std::atomic<bool> cancel_{false};
+
+    // Current or last prefetch (mutex_)
+    std::string current_label_;
+    std::string current_state_ = "idle";
+    uint64_t current_total_ = 0;
+    int64_t current_ms_ = 0;
+    std::atomic<uint64_t> current_read_{0};
+
+    // Totals (mutex_)
+    uint64_t requests_ = 0;
+    uint64_t completed_ = 0;
+    uint64_t skipped_low_ram_ = 0;
+    uint64_t stopped_low_ram_ = 0;
+    std::atomic<uint64_t> bytes_read_total_{0};
+};
+
+} // namespace sdcpp
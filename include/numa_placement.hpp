@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "config.hpp"
+
+namespace sdcpp {
+
+/**
+ * NUMA and huge page placement of model weights (numa config).
+ *
+ * sd.cpp allocates and fills its weight buffers inside new_sd_ctx() and has
+ * no placement hooks, so placement works from the outside:
+ *  - apply_numa_process_policy() sets the memory policy (interleave or bind)
+ *    and, for "bind", the CPU affinity of the process at startup, before any
+ *    thread exists, so every later thread (the workers, ggml's compute
+ *    threads) inherits them and first-touch no longer piles the weights on
+ *    the node of the loading thread.
+ *  - NumaPlacement::place() runs after new_sd_ctx() on the mappings it
+ *    created (large anonymous buffers and mappings of the component files):
+ *    pages that landed elsewhere are migrated to the policy's nodes, the
+ *    ranges are marked for transparent huge pages, and mlock'd on request.
+ *
+ * Linux only; elsewhere every call is a no-op. Thread-safe.
+ */
+class NumaPlacement {
+public:
+    struct Node {
+        int id = 0;
+        std::vector<int> cpus;
+    };
+
+    /** Mappings of the process (start, end) at one point in time */
+    using Snapshot = std::set<std::pair<uintptr_t, uintptr_t>>;
+
+    explicit NumaPlacement(NumaConfig config);
+
+    /** The policy, hugepages or mlock do something for a load */
+    bool enabled() const;
+    bool mlock_default() const { return config_.mlock; }
+
+    /** NUMA nodes with CPUs or memory, from /sys/devices/system/node */
+    static std::vector<Node> nodes();
+
+    /**
+     * Physical cores among the CPUs this process may run on (SMT siblings
+     * count once), the thread count for n_threads = -1
+     * @return 0 when the topology can't be read
+     */
+    static int physical_cores();
+
+    /** physical_cores() when the placement was created (after the startup affinity) */
+    int cores() const { return cores_; }
+
+    Snapshot snapshot() const;
+
+    /**
+     * Place what new_sd_ctx() mapped since `before`: anonymous mappings of
+     * at least 32 MiB and mappings of `files`
+     */
+    void place(const Snapshot& before, const std::vector<std::string>& files, bool mlock);
+
+    /** The context was freed; its mappings are gone */
+    void clear();
+
+    /**
+     * {policy, nodes, pin_threads, hugepages, physical_cores, regions,
+     * bytes, locked_bytes, huge_ranges, weights_by_node}
+     */
+    nlohmann::json stats_json() const;
+
+private:
+    const NumaConfig config_;
+    const int cores_;
+
+    mutable std::mutex mutex_;
+    size_t regions_ = 0;
+    uint64_t bytes_ = 0;
+    uint64_t locked_bytes_ = 0;
+    size_t huge_ranges_ = 0;                        // Ranges MADV_COLLAPSE turned into huge pages
+    std::map<int, uint64_t> by_node_;               // Node -> bytes of the placed ranges, after placement
+};
+
+/**
+ * Set the process-wide memory policy and CPU affinity of `config`. Call once
+ * from main() before any thread is started; threads inherit both.
+ */
+void apply_numa_process_policy(const NumaConfig& config);
+
+} // namespace sdcpp
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+namespace sdcpp {
+
+/**
+ * One offload configuration tried by offload_tune: the load options it
+ * overlays on the request and what its calibration generation measured
+ */
+struct OffloadTuneTrial {
+    nlohmann::json options = nlohmann::json::object();
+    bool ok = false;                    // Loaded and generated an image
+    double load_ms = 0.0;
+    double step_ms = 0.0;               // Median sampling step, the first one excluded
+    double total_ms = 0.0;              // The whole calibration generation
+    double projected_ms = 0.0;          // Same generation at OFFLOAD_TUNE_PROJECTED_STEPS steps
+    std::string error;
+
+    nlohmann::json to_json() const;
+};
+
+// Steps of the generation trials are ranked by: a sampler step that is a
+// little slower must not win just because its config saves time around
+// the short calibration run
+constexpr int OFFLOAD_TUNE_PROJECTED_STEPS = 20;
+
+/**
+ * Resolution bucket a calibration stands for: each side rounded up to a
+ * multiple of 256 ("1024x1024"). Compute buffers grow with the area, so
+ * a config tuned at the top of a bucket fits everything below it.
+ */
+std::string offload_tune_bucket(int width, int height);
+
+/**
+ * Load option overlays to calibrate, most resident first. Fully resident
+ * weights are only tried when they plausibly fit next to `compute_bytes`;
+ * the rest budget max_vram at fractions of the free VRAM left after the
+ * compute buffers (with and without stream_layers), or on
+ * SDCPP_EXPERIMENTAL_OFFLOAD builds walk the offload modes and the layer
+ * streaming prefetch depths of scripts/streaming_tune.sh.
+ */
+std::vector<nlohmann::json> offload_tune_candidates(uint64_t weight_bytes, uint64_t gpu_free_bytes,
+                                                    uint64_t compute_bytes);
+
+/**
+ * Chosen offload settings per (model hash, GPU, resolution bucket),
+ * persisted in <output>/offload_tune.json (temp file + rename) so later
+ * loads with offload_tune = "auto" skip the calibration. Thread-safe.
+ */
+class OffloadTuneCache {
+public:
+    explicit OffloadTuneCache(std::string cache_file);
+
+    static std::string key(const std::string& model_hash, const std::string& gpu, const std::string& bucket);
+
+    /** The stored entry ({options, step_ms, projected_ms, trials, ...}) */
+    std::optional<nlohmann::json> lookup(const std::string& key) const;
+
+    void store(const std::string& key, nlohmann::json entry);
+
+    /** Entry count and file */
+    nlohmann::json stats_json() const;
+
+private:
+    void load();
+    void save_locked();
+
+    std::string cache_file_;
+    mutable std::mutex mutex_;
+    nlohmann::json entries_ = nlohmann::json::object();
+};
+
+} // namespace sdcpp
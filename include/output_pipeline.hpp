@@ -0,0 +1,163 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <cstdint>
+#include <cstdlib>
+
+#include <nlohmann/json.hpp>
+#include "image_encoder.hpp"
+
+namespace sdcpp {
+
+class OutputPipeline;
+class ThumbnailCache;
+class JobTrace;
+
+/**
+ * One image to encode and write. Owns its pixels: sd.cpp allocates output
+ * buffers with malloc, and adopting them avoids a copy of every frame.
+ */
+struct OutputImage {
+    struct FreeDeleter { void operator()(uint8_t* p) const { std::free(p); } };
+
+    std::string path;               // Absolute destination file
+    std::string output_ref;         // Relative path reported in job outputs
+    std::unique_ptr<uint8_t, FreeDeleter> pixels;
+    int width = 0;
+    int height = 0;
+    int channels = 3;
+    EncodeOptions encode;
+    bool thumbnail = true;          // Also write every thumbnail size from memory
+
+    size_t bytes() const { return static_cast<size_t>(width) * height * channels; }
+};
+
+/**
+ * The images of one job. Created by OutputPipeline::begin_batch(); the
+ * producer add()s images and then finish()es the batch with a completion
+ * callback, which runs once every image has been written.
+ */
+class OutputBatch : public std::enable_shared_from_this<OutputBatch> {
+public:
+    struct Result {
+        size_t written = 0;
+        std::vector<std::string> failed_refs;   // output_ref of images that could not be written
+    };
+    using CompletionFn = std::function<void(const Result&)>;
+
+    /**
+     * Queue an image. Blocks while the pipeline is over its memory budget,
+     * so a fast sampler cannot pile up unbounded raw frames.
+     */
+    void add(OutputImage&& image);
+
+    /**
+     * Seal the batch. `on_done` runs on an encoder thread after the last
+     * image is written, or on the calling thread if nothing is outstanding.
+     * May be null.
+     */
+    void finish(CompletionFn on_done);
+
+    size_t size() const;
+
+    /** Job trace the image writes are recorded on (queue.trace_jobs); may be null */
+    void set_trace(std::shared_ptr<JobTrace> trace) { trace_ = std::move(trace); }
+
+private:
+    friend class OutputPipeline;
+class ThumbnailCache;
+    explicit OutputBatch(OutputPipeline* pipeline) : pipeline_(pipeline) {}
+
+    // Called by the pipeline after each image; runs the callback when done
+    void image_done(const std::string& output_ref, bool ok);
+
+    OutputPipeline* pipeline_;
+    mutable std::mutex mutex_;
+    size_t added_ = 0;
+    size_t done_ = 0;
+    bool sealed_ = false;
+    Result result_;
+    CompletionFn on_done_;
+    std::shared_ptr<JobTrace> trace_;
+};
+
+/**
+ * Background output stage: encodes and writes job images on its own thread
+ * pool so the generation worker can start the next job while the previous
+ * one's PNGs are still being compressed.
+ *
+ * The queue is bounded by raw pixel bytes (max_pending_bytes), not by
+ * count, since one 2048² frame costs as much as sixteen 512² ones. A single
+ * image larger than the budget is still accepted when the queue is empty.
+ *
+ * stop() drains: every queued image is written and every completion
+ * callback runs before it returns.
+ */
+class OutputPipeline {
+public:
+    OutputPipeline(int threads, size_t max_pending_bytes);
+    ~OutputPipeline();
+
+    OutputPipeline(const OutputPipeline&) = delete;
+    OutputPipeline& operator=(const OutputPipeline&) = delete;
+
+    void start();
+    void stop();
+
+    bool running() const { return running_; }
+
+    /**
+     * Thumbnails rendered from each written image's pixels. Set before
+     * start(); without one, images are written without thumbnails.
+     */
+    void set_thumbnail_cache(ThumbnailCache* cache) { thumbnails_cache_ = cache; }
+
+    std::shared_ptr<OutputBatch> begin_batch();
+
+    /**
+     * Counters: queued, pending_bytes, written, failed, thumbnails,
+     * encode_ms_total, producer_wait_ms_total
+     */
+    nlohmann::json stats_json() const;
+
+private:
+    friend class OutputBatch;
+
+    struct Task {
+        OutputImage image;
+        std::shared_ptr<OutputBatch> batch;
+    };
+
+    void enqueue(Task&& task);
+    void worker_loop();
+    bool write_one(const OutputImage& image);
+
+    int thread_count_;
+    size_t max_pending_bytes_;
+    ThumbnailCache* thumbnails_cache_ = nullptr;
+
+    mutable std::mutex mutex_;
+    std::condition_variable work_cv_;       // workers: task available / stopping
+    std::condition_variable space_cv_;      // producers: budget freed
+    std::deque<Task> queue_;
+    size_t pending_bytes_ = 0;              // queued + being encoded
+    std::vector<std::thread> threads_;
+    std::atomic<bool> running_{false};
+    bool stopping_ = false;
+
+    std::atomic<uint64_t> written_{0};
+    std::atomic<uint64_t> failed_{0};
+    std::atomic<uint64_t> thumbnails_{0};
+    std::atomic<uint64_t> encode_ms_total_{0};
+    std::atomic<uint64_t> producer_wait_ms_total_{0};
+};
+
+} // namespace sdcpp
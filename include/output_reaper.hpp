@@ -0,0 +1,96 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <unordered_set>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <cstdint>
+
+#include <nlohmann/json.hpp>
+
+namespace sdcpp {
+
+class ThumbnailCache;
+
+/**
+ * Background deletion of job output files.
+ *
+ * Purges and quota evictions hand the reaper the files of the jobs they
+ * dropped instead of deleting them under queue_mutex_. Its thread removes
+ * them REMOVE_BATCH at a time, at most files_per_second, at idle CPU and
+ * I/O priority where the OS has them, together with their thumbnails, and
+ * then prunes directories left empty up to the output root. Files that a
+ * remaining job still lists are kept: the referenced hook is asked about
+ * each batch's own paths only.
+ *
+ * The same thread runs the sweep hook once at start() and then every
+ * sweep_interval, so the retention purge and the disk quota never run on a
+ * request thread.
+ *
+ * stop() removes whatever is still queued, unthrottled, before it returns:
+ * the jobs are already gone from the journal and nothing else would.
+ */
+class OutputReaper {
+public:
+    struct Hooks {
+        std::function<void()> sweep;                                    // Periodic maintenance
+        // The files of a batch that a job still lists
+        std::function<std::unordered_set<std::string>(const std::vector<std::string>&)> referenced;
+    };
+
+    static constexpr size_t REMOVE_BATCH = 64;
+
+    OutputReaper(std::string output_dir, Hooks hooks,
+                 std::chrono::seconds sweep_interval, int files_per_second);
+    ~OutputReaper();
+
+    OutputReaper(const OutputReaper&) = delete;
+    OutputReaper& operator=(const OutputReaper&) = delete;
+
+    void start();
+    void stop();
+
+    /** Thumbnails to delete with their sources; set before start(), may be null */
+    void set_thumbnail_cache(ThumbnailCache* cache) { thumbnail_cache_ = cache; }
+
+    /** Queue files (relative to the output directory) for deletion */
+    void remove(std::vector<std::string> files);
+
+    /** Run the sweep hook now instead of at the next interval */
+    void wake();
+
+    /** {pending, removed, kept, failed, bytes_freed, dirs_removed, sweeps} */
+    nlohmann::json stats_json() const;
+
+private:
+    void run();
+    void remove_batch(const std::vector<std::string>& batch);
+
+    const std::string output_dir_;
+    const Hooks hooks_;
+    const std::chrono::seconds sweep_interval_;
+    const int files_per_second_;
+    ThumbnailCache* thumbnail_cache_ = nullptr;
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<std::string> pending_;
+    bool stopping_ = false;
+    bool sweep_requested_ = false;
+    std::thread thread_;
+
+    std::atomic<uint64_t> removed_{0};
+    std::atomic<uint64_t> kept_{0};
+    std::atomic<uint64_t> failed_{0};
+    std::atomic<uint64_t> bytes_freed_{0};
+    std::atomic<uint64_t> dirs_removed_{0};
+    std::atomic<uint64_t> sweeps_{0};
+};
+
+} // namespace sdcpp
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <optional>
+
+#include <nlohmann/json.hpp>
+#include "spsc_ring.hpp"
+
+namespace sdcpp {
+
+/**
+ * Progress or preview update emitted by a running job
+ */
+struct ProgressEvent {
+    enum class Kind { Progress, Preview };
+
+    Kind kind = Kind::Progress;
+    std::string job_id;
+    int step = 0;
+    int total_steps = 0;
+
+    // Preview only
+    int frame_count = 0;
+    int width = 0;
+    int height = 0;
+    bool is_noisy = false;
+    std::shared_ptr<const std::vector<uint8_t>> jpeg;
+};
+
+/**
+ * Moves progress/preview events off the sampler thread.
+ *
+ * Every worker gets its own SpscRing (add_producer()); publishing is a
+ * lock-free push plus a futex wake, so a sd.cpp step callback never waits on
+ * a mutex or on the network. When a ring is full the event is dropped — a
+ * newer one for the same job supersedes it anyway.
+ *
+ * The dispatcher thread drains all rings, keeps only the latest progress and
+ * preview per job, hands previews to `store_preview` (for GET
+ * /jobs/{id}/preview), and broadcasts job_progress / job_preview over the
+ * WebSocket no more often than the throttle intervals. Events for jobs that
+ * are no longer running (`is_running` false) are discarded, so no progress
+ * arrives after the job's final status.
+ */
+class ProgressDispatcher {
+public:
+    using Ring = SpscRing<ProgressEvent, 64>;
+
+    struct Hooks {
+        std::function<bool(const std::string& job_id)> is_running;
+        std::function<void(const ProgressEvent& preview)> store_preview;
+        std::function<void(const nlohmann::json& progress)> publish_progress;  // The JobProgress payload
+    };
+
+    ProgressDispatcher(Hooks hooks,
+                       std::chrono::milliseconds progress_interval,
+                       std::chrono::milliseconds preview_interval);
+    ~ProgressDispatcher();
+
+    ProgressDispatcher(const ProgressDispatcher&) = delete;
+    ProgressDispatcher& operator=(const ProgressDispatcher&) = delete;
+
+    /**
+     * Create a ring for one producer thread. The ring lives as long as the
+     * dispatcher.
+     */
+    Ring* add_producer();
+
+    void start();
+    void stop();
+
+    /**
+     * Producer side: push onto the caller's own ring. Never blocks.
+     * @return false if the ring was full and the event was dropped
+     */
+    bool publish(Ring* ring, ProgressEvent&& event);
+
+    /**
+     * Counters: published, dropped (ring full), coalesced, broadcasts
+     */
+    nlohmann::json stats_json() const;
+
+private:
+    struct JobState {
+        std::optional<ProgressEvent> progress;
+        std::optional<ProgressEvent> preview;
+        std::chrono::steady_clock::time_point last_progress_sent{};
+        std::chrono::steady_clock::time_point last_preview_sent{};
+    };
+
+    void dispatch_loop();
+    void drain_rings();
+    // Broadcast what is due; returns the time of the next deferred send
+    std::optional<std::chrono::steady_clock::time_point> flush_due();
+
+    Hooks hooks_;
+    std::chrono::milliseconds progress_interval_;
+    std::chrono::milliseconds preview_interval_;
+
+    std::mutex producers_mutex_;                 // add_producer() vs. dispatcher only
+    std::vector<std::unique_ptr<Ring>> rings_;
+
+    std::atomic<uint32_t> wake_seq_{0};
+    std::atomic<bool> running_{false};
+    std::thread thread_;
+
+    // Dispatcher-thread-only
+    std::map<std::string, JobState> jobs_;
+
+    std::atomic<uint64_t> published_{0};
+    std::atomic<uint64_t> dropped_{0};
+    std::atomic<uint64_t> coalesced_{0};
+    std::atomic<uint64_t> broadcasts_{0};
+};
+
+} // namespace sdcpp
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -34,4 +35,26 @@ std::vector<std::string> expand_prompt_template(const std::string& templated);
 // but cheaper for large fan-outs.
 size_t count_prompt_variations(const std::string& templated);
 
+// Random access into a template's expansion, for sweeps too large to
+// materialize. at(i) builds the i-th prompt in expand_prompt_template()'s
+// order without producing the others, so a job can walk the space with a
+// persisted index. Unlike expand_prompt_template() the space is not
+// deduplicated: {a|a|b} has size() 3 and yields "a" twice.
+// Throws std::runtime_error on a malformed template (same messages).
+class PromptTemplateCursor {
+public:
+    explicit PromptTemplateCursor(const std::string& templated);
+
+    // Number of variations; SIZE_MAX when the count overflows
+    size_t size() const { return size_; }
+
+    // The index-th variation. index must be < size()
+    std::string at(size_t index) const;
+
+private:
+    struct Impl;
+    std::shared_ptr<const Impl> impl_;
+    size_t size_ = 0;
+};
+
 } // namespace sdcpp
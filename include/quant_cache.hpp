@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+
+#include <nlohmann/json.hpp>
+
+#include "config.hpp"
+
+namespace sdcpp {
+
+/**
+ * Quantized copies of frequently loaded f16/f32 models (quant_cache config).
+ *
+ * load_model records every load of a float checkpoint or diffusion model.
+ * When the queue has been idle for a while, QueueManager asks for the most
+ * loaded source without a copy at the GPU's target weight type and queues a
+ * convert job for it; the GGUF lands in the cache directory, named by the
+ * source's SHA256, the weight type and the tensor_type_rules. Later loads of
+ * that source without an explicit weight_type open the GGUF instead.
+ *
+ * Load counts and artifacts are persisted in <output>/quant_cache.json
+ * (temp file + rename). Thread-safe.
+ */
+class QuantCache {
+public:
+    struct Candidate {
+        std::string source_path;
+        std::string name;                   // Model name, for the job title
+        uint64_t loads = 0;
+    };
+
+    QuantCache(QuantCacheConfig config, std::string index_file, std::string dir);
+
+    bool enabled() const { return config_.enabled; }
+    int idle_seconds() const { return config_.idle_seconds; }
+    const std::string& tensor_type_rules() const { return config_.tensor_type_rules; }
+
+    /**
+     * Weight type for a GPU with `vram_bytes` in total: the first VRAM class
+     * it fits under, the smallest one when there is no GPU (0).
+     * @return empty when the GPU is above every class (f16 fits)
+     */
+    std::string target_type(uint64_t vram_bytes) const;
+
+    /** Count a load of `source_path`; `hash` is its SHA256 when known */
+    void record_load(const std::string& source_path, const std::string& name, const std::string& hash);
+
+    /**
+     * Cached GGUF of the source with SHA256 `source_hash` at `weight_type`
+     * (and the configured tensor_type_rules)
+     * @return empty on a miss or when the file is gone
+     */
+    std::string lookup(const std::string& source_hash, const std::string& weight_type);
+
+    /**
+     * Most loaded source with at least min_loads loads, no artifact at
+     * `weight_type` and no failed conversion since startup
+     */
+    std::optional<Candidate> next_candidate(const std::string& weight_type) const;
+
+    /** Where the artifact of `source_hash` at `weight_type` goes */
+    std::string artifact_path(const std::string& source_hash, const std::string& weight_type) const;
+
+    void store(const std::string& source_path, const std::string& source_hash,
+               const std::string& weight_type, const std::string& artifact);
+
+    /** A conversion of `source_path` failed; it is not tried again until restart */
+    void mark_failed(const std::string& source_path, const std::string& weight_type, const std::string& error);
+
+    /** {enabled, dir, sources, artifacts, bytes, hits, conversions, failures} */
+    nlohmann::json stats_json() const;
+
+private:
+    std::string key(const std::string& source_hash, const std::string& weight_type) const;
+    void load();
+    void save_locked();
+
+    const QuantCacheConfig config_;
+    const std::string index_file_;
+    const std::string dir_;
+    std::string rules_tag_;                 // Short hash of tensor_type_rules (empty without rules)
+
+    mutable std::mutex mutex_;
+    nlohmann::json sources_ = nlohmann::json::object();     // path -> {name, hash, loads, last_load}
+    nlohmann::json artifacts_ = nlohmann::json::object();   // key -> {path, source, bytes, created_at}
+    nlohmann::json failed_ = nlohmann::json::object();      // "<path>|<type>" -> error (not persisted)
+    uint64_t hits_ = 0;
+    uint64_t conversions_ = 0;
+};
+
+} // namespace sdcpp
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+#include <shared_mutex>
+#include <functional>
+#include <chrono>
+#include <utility>
+
+namespace sdcpp {
+
+// Defined in queue_manager.hpp
+enum class QueueStatus;
+enum class GenerationType;
+// Defined in job_scheduler.hpp
+enum class JobPriority;
+struct QueueItem;
+struct QueueFilter;
+
+/**
+ * Secondary indexes over QueueManager::jobs_ for the listing endpoints.
+ *
+ * Keeps, per job, a small projection (created_at, status, type, lowercased
+ * model/architecture and search text) plus ordered sets keyed by
+ * (created_at, job_id) per status and per type, and the set of non-deleted
+ * jobs. Prompt search goes through an inverted token index: the query is
+ * split into the same alnum tokens as the indexed text, each query token
+ * narrows the candidates through the vocabulary (exact for interior
+ * tokens, prefix/suffix/substring at the query edges), and survivors are
+ * verified with the same substring test QueueFilter::matches() uses, so
+ * results are identical to a full scan.
+ *
+ * Has its own shared mutex. Writers are called with queue_mutex_ held
+ * (lock order: queue_mutex_ -> index); queries take only the shared lock,
+ * so polling the listing never waits on, or blocks, the queue mutex.
+ */
+class QueueIndex {
+public:
+    using Clock = std::chrono::system_clock;
+
+    /**
+     * Insert or refresh a job's projection
+     */
+    void upsert(const QueueItem& item);
+
+    /**
+     * Drop a job
+     */
+    void erase(const std::string& job_id);
+
+    void clear();
+
+    /**
+     * Visit jobs matching `filter` (pagination fields ignored), newest
+     * first. The visitor returns false to stop early. Runs under the
+     * index's shared lock — the visitor must not call back into
+     * QueueManager.
+     */
+    void for_each_match(const QueueFilter& filter,
+                        const std::function<bool(const std::string& job_id, Clock::time_point created_at)>& visit) const;
+
+    /**
+     * Number of jobs currently in `status`
+     */
+    size_t count(QueueStatus status) const;
+
+    /**
+     * Number of jobs in `status` queued under `priority`
+     */
+    size_t count(QueueStatus status, JobPriority priority) const;
+
+    size_t size() const;
+
+private:
+    using Key = std::pair<Clock::time_point, std::string>;  // (created_at, job_id)
+
+    struct Entry {
+        Key key;
+        QueueStatus status;
+        GenerationType type;
+        JobPriority priority;
+        std::string model;       // lowercased model_settings.model_name
+        std::string arch;        // lowercased model_settings.model_architecture
+        std::string prompt;      // lowercased
+        std::string negative;    // lowercased
+        std::string job_id;      // lowercased
+        std::vector<std::string> tokens;  // distinct tokens posted for this job
+    };
+
+    // Lowercased filter strings, computed once per query
+    struct Needles {
+        std::string search;
+        std::string model;
+        std::string arch;
+    };
+
+    void erase_locked(const std::string& job_id);
+    bool matches_locked(const Entry& e, const QueueFilter& filter, const Needles& needles,
+                        const std::unordered_set<std::string>* candidates) const;
+
+    // Job ids that can contain `query_lc`. Returns false when the query has
+    // no tokens and cannot narrow anything (every job is a candidate).
+    bool search_candidates_locked(const std::string& query_lc,
+                                  std::unordered_set<std::string>& out) const;
+
+    mutable std::shared_mutex mutex_;
+    std::unordered_map<std::string, Entry> entries_;
+    std::set<Key> live_;                                 // everything but Deleted
+    std::map<QueueStatus, std::set<Key>> by_status_;
+    std::map<GenerationType, std::set<Key>> by_type_;    // all statuses
+    std::map<std::pair<QueueStatus, JobPriority>, size_t> by_priority_;
+    std::map<std::string, std::set<Key>> by_model_;
+    std::map<std::string, std::set<Key>> by_arch_;
+    std::unordered_map<std::string, std::unordered_set<std::string>> postings_;  // token -> job ids
+};
+
+} // namespace sdcpp
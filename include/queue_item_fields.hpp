@@ -27,9 +27,14 @@ struct QueueItemFields {
     static constexpr const char* ERROR = "error";
     static constexpr const char* OUTPUTS = "outputs";
     static constexpr const char* PARAMS = "params";
+    static constexpr const char* PARAMS_FILE = "params_file";
     static constexpr const char* MODEL_SETTINGS = "model_settings";
     static constexpr const char* LINKED_JOB_ID = "linked_job_id";
     static constexpr const char* TITLE = "title";
+    static constexpr const char* METADATA = "metadata";
+    static constexpr const char* DEDUP_KEY = "dedup_key";
+    static constexpr const char* PRIORITY = "priority";
+    static constexpr const char* OWNER = "owner";
 
     // Params field names (used inside params object)
     static constexpr const char* PARAM_PROMPT = "prompt";
@@ -63,6 +68,7 @@ struct QueueItemFields {
     static constexpr const char* TYPE_CONVERT = "convert";
     static constexpr const char* TYPE_MODEL_DOWNLOAD = "model_download";
     static constexpr const char* TYPE_MODEL_HASH = "model_hash";
+    static constexpr const char* TYPE_PIPELINE = "pipeline";
 
     // Status values
     static constexpr const char* STATUS_PENDING = "pending";
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <cstdio>
+
+#include <nlohmann/json.hpp>
+
+namespace sdcpp {
+
+/**
+ * Append-only persistence for QueueManager.
+ *
+ * State lives in two files next to each other:
+ *   <state_file>          snapshot, {"items": [...]} (same shape the old
+ *                         save_state() wrote, so existing files load as-is)
+ *   <state_file>.journal  one compact JSON record per line:
+ *                         {"op":"put","item":{...}} or {"op":"del","job_id":"..."}
+ *
+ * put()/erase() only enqueue the record and return — they are O(1) in the
+ * history size and safe to call with queue_mutex_ held. A background writer
+ * appends records to the journal and applies them to its own mirror of the
+ * state; once the journal holds `compact_after` records it rewrites the
+ * snapshot from that mirror (tmp + rename) and truncates the journal. No
+ * QueueManager lock is taken for persistence.
+ *
+ * Startup loads the snapshot and replays the journal tail. A torn last line
+ * (crash mid-write) is ignored.
+ */
+class QueueJournal {
+public:
+    explicit QueueJournal(const std::string& snapshot_path, size_t compact_after = 2000);
+    ~QueueJournal();
+
+    QueueJournal(const QueueJournal&) = delete;
+    QueueJournal& operator=(const QueueJournal&) = delete;
+
+    /**
+     * Load snapshot + journal and compact them. Call once, before start().
+     * @return Persisted items (QueueItem JSON), ordered by job id
+     */
+    std::vector<nlohmann::json> load();
+
+    /**
+     * Start the background writer
+     */
+    void start();
+
+    /**
+     * Drain pending records, compact, and stop the writer
+     */
+    void stop();
+
+    /**
+     * Record the current state of a job (insert or update)
+     */
+    void put(const std::string& job_id, nlohmann::json item);
+
+    /**
+     * Record a permanent removal
+     */
+    void erase(const std::string& job_id);
+
+    /**
+     * Block until every record enqueued so far is on disk
+     */
+    void flush();
+
+    /**
+     * Writer stats: records written, journal length, compactions
+     */
+    nlohmann::json stats_json() const;
+
+private:
+    struct Record {
+        bool erase = false;
+        std::string job_id;
+        nlohmann::json item;
+    };
+
+    void writer_loop();
+    void apply_to_mirror(const Record& r);
+    void write_records(const std::vector<Record>& batch);
+    void compact();
+    bool open_journal(bool truncate);
+
+    std::string snapshot_path_;
+    std::string journal_path_;
+    size_t compact_after_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::condition_variable drained_cv_;
+    std::vector<Record> pending_;
+    uint64_t enqueued_seq_ = 0;      // guarded by mutex_
+    uint64_t written_seq_ = 0;       // guarded by mutex_
+    bool stop_requested_ = false;
+    std::thread writer_;
+    std::atomic<bool> running_{false};
+
+    // Writer-thread-only state (load() runs before the writer starts)
+    // Compact dump of every live item: a parsed nlohmann::json costs
+    // several times its text, and the history can be large
+    std::map<std::string, std::string> mirror_;
+    std::FILE* journal_ = nullptr;
+    size_t journal_records_ = 0;
+
+    std::atomic<uint64_t> records_written_{0};
+    std::atomic<uint64_t> compactions_{0};
+    std::atomic<size_t> journal_length_{0};
+};
+
+} // namespace sdcpp
@@ -4,7 +4,9 @@
 #include <vector>
 #include <map>
 #include <unordered_map>
-#include <queue>
+#include <unordered_set>
+#include <deque>
+#include <memory>
 #include <mutex>
 #include <condition_variable>
 #include <thread>
@@ -16,11 +18,23 @@
 #include <nlohmann/json.hpp>
 #include "sd_wrapper.hpp"
 #include "config.hpp"
+#include "job_scheduler.hpp"
+#include "batch_checkpoints.hpp"
+#include "queue_journal.hpp"
+#include "queue_index.hpp"
+#include "progress_dispatcher.hpp"
+#include "job_events.hpp"
+#include "output_pipeline.hpp"
+#include "output_reaper.hpp"
+#include "memory_utils.hpp"
+#include "vram_estimator.hpp"
 
 namespace sdcpp {
 
 // Forward declarations
 class ModelManager;
+class ClusterCoordinator;
+enum class WSEventType;
 
 /**
  * Queue item status
@@ -45,7 +59,8 @@ enum class GenerationType {
     Convert,
     ModelDownload,
     ModelHash,
-    ADetailer
+    ADetailer,
+    Pipeline        // txt2img/img2img -> upscale/adetailer/img2img, chained in memory
 };
 
 /**
@@ -65,10 +80,19 @@ struct QueueItem {
     std::string job_id;
     GenerationType type;
     QueueStatus status = QueueStatus::Pending;
-    nlohmann::json params;          // Generation parameters
-    nlohmann::json model_settings;  // Model settings at time of job creation
+    nlohmann::json params;          // Generation parameters (a summary once off-loaded, see params_file)
+    // Model settings at time of job creation. Interned: every job created
+    // on the same loaded model shares one immutable copy.
+    std::shared_ptr<const nlohmann::json> model_settings;
     ProgressInfo progress;
 
+    // A finished job whose config.json holds exactly its params keeps only
+    // the fields listing and search read (prompt, negative_prompt,
+    // variation_group_id) in `params`; this is that config.json, relative
+    // to the output dir. QueueManager loads the full params back on the
+    // way out (get_job, listings). Empty while `params` is complete.
+    std::string params_file;
+
     // Optional user-supplied display title. Set at job creation time via
     // the request body (`"title": "..."`); empty by default. Surfaced
     // next to the type label in the WebUI Queue card and in /queue
@@ -77,6 +101,11 @@ struct QueueItem {
     // typed structs don't need to enumerate it.
     std::string title;
 
+    // Who queued the job (authenticated username, "" without auth) and its
+    // scheduling class; see JobScheduler
+    std::string owner;
+    JobPriority priority = JobPriority::Normal;
+
     std::chrono::system_clock::time_point created_at;
     std::chrono::system_clock::time_point started_at;
     std::chrono::system_clock::time_point completed_at;
@@ -84,17 +113,37 @@ struct QueueItem {
     std::string error_message;
     std::vector<std::string> outputs;   // Output file paths (relative to output dir)
 
+    // What happened while the job ran, as opposed to what it asked for
+    // (e.g. "lora": the applied-set delta and apply timing). Not saved to
+    // the job's config.json, so re-running a job never carries it along.
+    nlohmann::json metadata;
+
     // Linked job ID (e.g., hash job linked to download job)
     std::string linked_job_id;
 
+    // Result cache key (submit_job); empty when the job can't be reused
+    std::string dedup_key;
+
     // Recycle bin fields
     std::chrono::system_clock::time_point deleted_at;  // When item was soft-deleted
     QueueStatus previous_status = QueueStatus::Pending; // Status before deletion (for restore)
 
+    /** model_settings, or an empty object */
+    const nlohmann::json& settings() const;
+
     nlohmann::json to_json() const;
     static QueueItem from_json(const nlohmann::json& j);
 };
 
+/**
+ * Who submits a job and at which priority class. The request handlers fill
+ * it in from the auth session and the request's "priority".
+ */
+struct JobOrigin {
+    std::string owner;
+    JobPriority priority = JobPriority::Normal;
+};
+
 /**
  * Filter parameters for queue listing
  */
@@ -179,7 +228,8 @@ public:
         ModelManager& model_manager,
         const std::string& output_dir,
         const std::string& state_file,
-        const RecycleBinConfig& recycle_bin_config = RecycleBinConfig{}
+        const RecycleBinConfig& recycle_bin_config = RecycleBinConfig{},
+        const QueueConfig& queue_config = QueueConfig{}
     );
     
     ~QueueManager();
@@ -189,12 +239,12 @@ public:
     QueueManager& operator=(const QueueManager&) = delete;
     
     /**
-     * Start the worker thread
+     * Start the worker pool (one generation worker plus queue.io_workers)
      */
     void start();
     
     /**
-     * Stop the worker thread (waits for current job to finish)
+     * Stop all worker threads (waits for running jobs to finish)
      */
     void stop();
     
@@ -205,7 +255,46 @@ public:
      * @return Job ID (UUID)
      */
     std::string add_job(GenerationType type, const nlohmann::json& params,
-                        const std::string& title = "");
+                        const std::string& title = "", const JobOrigin& origin = {});
+
+    struct SubmitResult {
+        std::string job_id;
+        bool deduplicated = false;          // job_id is an earlier, identical job
+        QueueStatus status = QueueStatus::Pending;
+        std::string refusal;                // queue.max_pending_per_user refused it; nothing was queued
+    };
+
+    /**
+     * add_job() for a generation request that may repeat an earlier one.
+     * With a fixed seed (and queue.dedup_results on), the params are hashed
+     * together with the loaded model's names, load options and known file
+     * hashes. A pending or processing job with the same key is returned to
+     * attach to, as is a completed one that is within the recycle bin
+     * retention and still has its outputs on disk. Otherwise a new job is
+     * added under that key. A new job of an authenticated owner over
+     * queue.max_pending_per_user is refused (checked and added under one
+     * lock, so concurrent submissions can't overshoot).
+     * @param allow_dedup false for the request's "dedup": false opt-out
+     */
+    SubmitResult submit_job(GenerationType type, const nlohmann::json& params,
+                            const std::string& title = "", bool allow_dedup = true,
+                            const JobOrigin& origin = {});
+
+    /**
+     * Queue one job per entry of `params` (a prompt expansion), all or none:
+     * when they would take `origin.owner` over queue.max_pending_per_user,
+     * nothing is queued and `refusal` says why.
+     * @return Job IDs in `params` order, empty when refused
+     */
+    std::vector<std::string> add_jobs(GenerationType type, const std::vector<nlohmann::json>& params,
+                                      const std::string& title, const JobOrigin& origin,
+                                      std::string& refusal);
+
+    /**
+     * Append queue depth and counters to a /metrics response. Reads the
+     * index and atomics only, never queue_mutex_.
+     */
+    void append_metrics(std::string& out) const;
 
     /**
      * Add a model download job with automatic hash job
@@ -221,13 +310,52 @@ public:
      * @param error_message Error message
      */
     void fail_linked_job(const std::string& job_id, const std::string& error_message);
+
+    /**
+     * Complete a pending linked job without running it (e.g. the hash job
+     * of a download that already computed the file's SHA256)
+     * @param job_id Job ID to complete
+     * @param outputs Outputs to record
+     */
+    void complete_linked_job(const std::string& job_id, const std::vector<std::string>& outputs);
     
     /**
-     * Get a specific job by ID
+     * Get a specific job by ID, with off-loaded params read back from its
+     * config.json (listings return the finished-job summary instead)
      * @param job_id Job UUID
      * @return QueueItem if found
      */
     std::optional<QueueItem> get_job(const std::string& job_id) const;
+
+    /**
+     * Follow a job's status and progress events (see JobEvents)
+     * @return nullptr when queue.max_job_waiters watches are open
+     */
+    std::shared_ptr<JobEvents::Watch> watch_job(const std::string& job_id);
+
+    /**
+     * The job once it has completed, failed or been cancelled or deleted,
+     * or as it is after `timeout` (capped at queue.max_wait_seconds).
+     * Returns at once when queue.max_job_waiters watches are open.
+     * @param finished Set to whether the returned job is in a final state
+     */
+    std::optional<QueueItem> wait_job(const std::string& job_id, std::chrono::seconds timeout,
+                                      bool* finished = nullptr);
+
+    /**
+     * Chrome trace of a job (queue.trace_jobs): the live one while the job
+     * runs, else the exported file
+     * @return null if the job has no trace
+     */
+    nlohmann::json get_job_trace(const std::string& job_id) const;
+
+    /**
+     * Submit-time VRAM admission (queue.vram_admission): why a generation
+     * with these params can never fit on this GPU, or "" when it may be
+     * queued. Under "auto" it only refuses jobs that vae_tiling and weight
+     * offload would not rescue.
+     */
+    std::string check_vram_admission(GenerationType type, const nlohmann::json& params) const;
     
     /**
      * Get all jobs
@@ -260,12 +388,20 @@ public:
 
     /**
      * Get queue status summary
-     * @return JSON with pending_count, processing_count, etc.
+     * @return JSON with pending_count, processing_count, workers, etc.
      */
     nlohmann::json get_status() const;
+
+    /**
+     * Per-worker snapshot: lane, running job, progress, jobs processed.
+     * Included in get_status() under "workers".
+     */
+    nlohmann::json get_workers_status() const;
     
     /**
-     * Cancel a pending job
+     * Cancel a pending job. A running sweep job (expand_prompt "sweep") is
+     * stopped after its current variation and ends as cancelled, keeping
+     * the outputs made so far.
      * @param job_id Job UUID
      * @return true if job was cancelled
      */
@@ -284,6 +420,7 @@ public:
      * Clear all completed jobs from history
      * If recycle bin is enabled, moves to recycle bin
      * If recycle bin is disabled, permanently deletes
+     * Works through the jobs PURGE_CHUNK at a time, releasing queue_mutex_ in between
      */
     void clear_completed();
 
@@ -308,7 +445,9 @@ public:
     std::vector<QueueItem> get_deleted_jobs() const;
 
     /**
-     * Purge jobs that have been in recycle bin past retention period
+     * Purge jobs that have been in recycle bin past retention period.
+     * Runs on the output reaper's sweep; their files (with
+     * recycle_bin.delete_outputs) are deleted by the reaper later.
      * @return Number of jobs purged
      */
     int purge_expired_jobs();
@@ -330,7 +469,7 @@ public:
     int get_recycle_bin_retention_minutes() const { return recycle_bin_config_.retention_minutes; }
 
     /**
-     * Get current progress of processing job
+     * Get current progress of the job running on the generation lane
      */
     ProgressInfo get_current_progress() const;
 
@@ -340,8 +479,14 @@ public:
      * @param interval Generate preview every N steps
      * @param max_size Maximum preview dimension in pixels
      * @param quality JPEG quality 1-100
+     * @param on_demand Only decode previews while a WebSocket client is
+     *        subscribed to the job or its preview was polled over HTTP in
+     *        the last PREVIEW_POLL_GRACE
+     * @param max_overhead_percent Widen the interval so previews cost at
+     *        most this share of the step time (0 = fixed interval)
      */
-    void set_preview_settings(PreviewMode mode, int interval = 1, int max_size = 256, int quality = 75);
+    void set_preview_settings(PreviewMode mode, int interval = 1, int max_size = 256, int quality = 75,
+                              bool on_demand = true, int max_overhead_percent = 10);
 
     /**
      * Get current preview settings
@@ -351,6 +496,8 @@ public:
         int interval = 1;
         int max_size = 256;
         int quality = 75;
+        bool on_demand = true;
+        int max_overhead_percent = 10;
     };
     PreviewSettings get_preview_settings() const;
 
@@ -367,7 +514,8 @@ public:
     };
 
     /**
-     * Get current preview data for a job (for HTTP endpoint)
+     * Get current preview data for a job (for HTTP endpoint). Counts as
+     * preview demand for the job (see set_preview_settings on_demand).
      * @param job_id Job UUID
      * @return Optional preview buffer if available
      */
@@ -380,12 +528,215 @@ public:
     void clear_preview_buffer(const std::string& job_id);
 
 private:
-    void worker_thread();
-    void save_state();
+    /**
+     * Worker lanes. Generation jobs need the sd.cpp context and the global
+     * SDWrapper progress/preview callbacks, so that lane has exactly one
+     * worker per loaded context. I/O jobs (download, hash) only touch the
+     * network and disk and may run alongside a generation. The post lane
+     * runs upscale jobs, which only need the upscaler context, beside a
+     * generation when the free VRAM admits them; otherwise the generation
+     * lane runs them in turn. Remote workers (coordinator mode, one per
+     * cluster node job slot) hand generations to worker nodes.
+     */
+    enum class WorkerLane { Generation, Io, Post, Remote };
+
+    /**
+     * A pending txt2img job that runs inside another job's generate_image
+     * call (cross-job batching). It has its own output batch, outputs and
+     * final status; only the sampling is shared.
+     */
+    struct MergedJob {
+        std::string job_id;
+        nlohmann::json params;
+        std::chrono::system_clock::time_point started_at;
+        std::shared_ptr<OutputBatch> batch;
+        std::vector<std::string> outputs;
+    };
+
+    /**
+     * One pool worker. current_job_id and jobs_processed are written by the
+     * slot's own thread under progress_mutex_ (so that thread may read them
+     * without it). Live progress is atomic because the sd.cpp callback
+     * updates it on every step and must not take a lock.
+     */
+    struct WorkerSlot {
+        int id = 0;
+        WorkerLane lane = WorkerLane::Generation;
+        std::thread thread;
+        std::string current_job_id;
+        std::atomic<int> live_step{0};
+        std::atomic<int> live_total_steps{0};
+        ProgressDispatcher::Ring* events = nullptr;  // this thread's progress/preview ring
+        OutputBatch* output_batch = nullptr;          // current job's images go here when set
+        std::vector<MergedJob>* merged_jobs = nullptr; // jobs sharing the current job's generate call
+        std::vector<std::string> merged_job_ids;      // their ids (progress_mutex_, like current_job_id)
+        int remote_node = -1;                         // Remote lane: node acquired for the current job
+        size_t device = 0;                            // Generation lane: ModelManager device it runs on
+        size_t jobs_processed = 0;
+
+        ProgressInfo progress() const {
+            return ProgressInfo{live_step.load(std::memory_order_relaxed),
+                                live_total_steps.load(std::memory_order_relaxed)};
+        }
+    };
+
+    static WorkerLane lane_for(GenerationType type);
+    static const char* lane_to_string(WorkerLane lane);
+
+    // Worker running on the calling thread (nullptr off-pool). Lets the
+    // sd.cpp progress callback, which carries no job context, find its job.
+    static thread_local WorkerSlot* current_slot_;
+
+    void worker_thread(WorkerSlot* slot);
+
+    // Pop the next job this worker may run from pending_queue_ and mark it
+    // Processing. Generation-lane order comes from scheduler_; VRAM checks
+    // use `mem`, sampled without the lock when needs_memory_sample_locked().
+    // Caller holds queue_mutex_. Returns false if none is runnable.
+    bool take_next_job_locked(WorkerSlot& slot, std::string& job_id, const MemoryInfo& mem);
+    // The next take on `slot` reads device memory (a driver query, so the
+    // worker samples it with queue_mutex_ released)
+    bool needs_memory_sample_locked(const WorkerSlot& slot) const;
+    bool has_runnable_job_locked(const WorkerSlot& slot) const;
+    // A generation-lane job `slot` may take: its device has the model, and
+    // ADetailer / pipeline jobs (which share device 0's detector context)
+    // stay on device 0
+    bool runs_on_device_locked(const WorkerSlot& slot, GenerationType type) const;
+    // ModelManager device of the worker on the calling thread (0 off-pool)
+    static size_t current_device();
+
+    // Claim pending txt2img jobs that can share lead_id's generate_image
+    // call: identical params and model settings except seed/batch_count,
+    // seeds continuing the lead's seed + batch_count run, up to
+    // queue.max_batch_images images in total. Resolves random seeds (the
+    // lead's too) so each job records the seed it ran with. Caller holds
+    // queue_mutex_; returned jobs are Processing.
+    std::vector<std::string> take_merge_partners_locked(const std::string& lead_id);
+    bool may_steal_io_locked(const WorkerSlot& slot) const;
+
+    // Post lane: upscale jobs, left to the post worker by the generation
+    // lane unless it has been refused VRAM. post_admits_locked() is the
+    // admission check while a generation holds the GPU.
+    static bool runs_on_post_lane(GenerationType type) { return type == GenerationType::Upscale; }
+    bool generation_defers_locked(GenerationType type) const;
+    bool post_admits_locked(const MemoryInfo& mem) const;
+
+    // Coordinator mode: generations the remote lane dispatches to cluster
+    // nodes instead of the local context. Sweeps stay local, they keep
+    // their cursor in the local job.
+    bool runs_remote(GenerationType type, const nlohmann::json& params) const;
+    std::vector<std::string> process_remote_unlocked(GenerationType type, const nlohmann::json& params,
+                                                     const std::string& job_id, int node);
+
+    // VRAM admission of generation jobs (queue.vram_admission, see
+    // estimate_job_vram). A plan is the estimate after the downgrades
+    // "auto" may apply: vae_tiling in the job params, then reloading the
+    // model with a max_vram budget + stream_layers.
+    struct VramPlan {
+        VramEstimate estimate;              // As submitted
+        VramEstimate planned;               // After the downgrades below
+        nlohmann::json param_changes = nlohmann::json::object();
+        nlohmann::json load_options = nlohmann::json::object();
+        bool fits = false;
+    };
+    static bool runs_vram_admission(GenerationType type) {
+        return type == GenerationType::Text2Image || type == GenerationType::Image2Image ||
+               type == GenerationType::Text2Video;
+    }
+    bool vram_admission_enabled() const { return queue_config_.vram_admission != "off"; }
+    // `free_bytes` is what the job may use beyond the resident weights; the
+    // whole device at submit time, gpu_free at pickup
+    VramPlan plan_vram(GenerationType type, const nlohmann::json& params, const MemoryInfo& mem,
+                       bool whole_device, bool allow_downgrade) const;
+    std::string vram_refusal(const VramPlan& plan, const MemoryInfo& mem, bool whole_device) const;
+    // "wait": may this pending job start beside what holds the GPU now?
+    bool vram_admits_locked(const QueueItem& item, const MemoryInfo& mem) const;
+    // Pickup check on the worker, before the job runs: applies "auto"
+    // downgrades to `params` (and reloads the model if needed), records
+    // metadata.vram, throws when the job does not fit
+    void admit_vram_unlocked(const std::string& job_id, GenerationType type, nlohmann::json& params);
+
+    // Overlay live progress for a Processing job. Caller holds queue_mutex_.
+    void apply_live_progress(QueueItem& item) const;
+
     void load_state();
+
+    // Journal and re-index the current state of a job. Caller holds
+    // queue_mutex_; cost is one item's to_json() plus an index update, the
+    // write happens on the journal thread.
+    void record_job_locked(const QueueItem& item);
+
+    // Set a finished job's final status, broadcast it and journal it. Runs
+    // on the worker, or on an output encoder thread once the job's images
+    // are written. Takes queue_mutex_.
+    void finish_job(const std::string& job_id, bool success,
+                    const std::vector<std::string>& outputs,
+                    const std::string& error_message,
+                    std::chrono::system_clock::time_point start_time,
+                    const ProgressInfo& final_progress);
+
+    void forget_job_locked(const std::string& job_id);
+
+    // Hard-delete jobs PURGE_CHUNK at a time, re-checking `still_matches`
+    // under queue_mutex_ for each, and hand their files to the reaper when
+    // `delete_files`. Takes queue_mutex_ once per chunk.
+    int purge_jobs(const std::vector<std::string>& job_ids,
+                   const std::function<bool(const QueueItem&)>& still_matches, bool delete_files);
+
+    // Files of a job relative to the output dir: outputs, params file, trace,
+    // and the config.json, poster and preview next to outputs in its own dirs
+    // (sweep variations included). Some of those may not exist.
+    static void append_job_files(const QueueItem& item, std::vector<std::string>& files);
+
+    // The files of `batch` that a remaining job still lists (OutputReaper
+    // hook). Only jobs named by a path component are looked at: outputs live
+    // under their job's id. Takes queue_mutex_.
+    std::unordered_set<std::string> referenced_files(const std::vector<std::string>& batch) const;
+
+    // Reaper sweep: retention purge, the output quota, then the quant cache
+    void run_maintenance();
+
+    // Queue the quant cache's next convert job once the queue has been
+    // empty for quant_cache.idle_seconds
+    void schedule_quantization();
+
+    // Purge the oldest finished jobs (recycle bin first) until their outputs
+    // fit in recycle_bin.output_quota_mb. Sizes are stat()ed without the lock.
+    void enforce_output_quota();
+
+    // queue.max_pending_per_user: why origin `owner` may not queue `jobs`
+    // more jobs, or "" when it may. Anonymous jobs ("" without auth) are
+    // never limited. Caller holds queue_mutex_
+    std::string check_user_quota_locked(const std::string& owner, size_t jobs) const;
+
+    // add_job() body; caller holds queue_mutex_
+    std::string add_job_locked(GenerationType type, const nlohmann::json& params,
+                               const std::string& title, const std::string& dedup_key,
+                               const JobOrigin& origin);
+
+    // queue.preempt_sweeps: a generation job of a better class than
+    // `running` (after aging) is waiting. Caller holds queue_mutex_.
+    bool preempt_wanted_locked(const QueueItem& running) const;
+
+    // A sweep that yielded goes back to the head of the pending queue with
+    // its variation_cursor and outputs so far. Caller holds queue_mutex_.
+    void requeue_preempted_locked(QueueItem& item, const std::vector<std::string>& outputs);
+
+    // Result cache key of a generation on the loaded model, or "" when its
+    // output isn't deterministic (random seed)
+    std::string dedup_key_for(GenerationType type, const nlohmann::json& params) const;
+
+    // Copy jobs out of jobs_ (with live progress) in the given order,
+    // skipping ids that no longer exist. Off-loaded params stay the
+    // summary: no disk reads per listed job. Takes queue_mutex_.
+    std::vector<QueueItem> materialize_jobs(const std::vector<std::string>& job_ids) const;
     void update_progress(int step, int total_steps);
     void set_batch_info(int total_images);
     void update_job_params(const std::string& job_id, const nlohmann::json& params);
+    void set_job_metadata(const std::string& job_id, const std::string& key, const nlohmann::json& value);
+    // Write a finished job's trace (queue.trace_jobs) next to its outputs
+    // and record the path as metadata.trace. No-op without a trace.
+    void export_trace(const std::string& job_id);
     
     // Process job without holding queue_mutex_ (to avoid deadlock)
     std::vector<std::string> process_job_unlocked(
@@ -400,12 +751,45 @@ private:
     std::vector<std::string> process_txt2vid_unlocked(const nlohmann::json& params, const std::string& job_id);
     std::vector<std::string> process_upscale_unlocked(const nlohmann::json& params, const std::string& job_id);
     std::vector<std::string> process_adetailer_unlocked(const nlohmann::json& params, const std::string& job_id);
+    std::vector<std::string> process_pipeline_unlocked(const nlohmann::json& params, const std::string& job_id);
     std::vector<std::string> process_convert_unlocked(const nlohmann::json& params, const std::string& job_id);
+    std::vector<std::string> process_quant_cache_unlocked(const nlohmann::json& params, const std::string& job_id);
     std::vector<std::string> process_model_download_unlocked(const nlohmann::json& params, const std::string& job_id);
     std::vector<std::string> process_model_hash_unlocked(const nlohmann::json& params, const std::string& job_id);
 
-    // Save job config to output folder
+    // Sweep job: generate variation_template's variations from
+    // variation_cursor on, one process_*_unlocked call each, into
+    // <job>/<index>/. The cursor and outputs are persisted after every
+    // variation, so a restart resumes where it stopped.
+    std::vector<std::string> process_sweep_unlocked(GenerationType type, const nlohmann::json& params,
+                                                    const std::string& job_id);
+
+    // queue.checkpoint_interval_seconds: a txt2img/img2img batch of `total`
+    // images expected to run longer than the interval is generated over
+    // several `generate(first, count)` calls of about that length. Finished
+    // images and metadata.checkpoint are recorded after each call, so a
+    // restart resumes after the last image on disk. Calls are sized from
+    // checkpoint_estimates_ under `estimate_key` (model and resolution) at
+    // `steps` steps per image.
+    std::vector<std::string> run_checkpointed_batch_unlocked(
+        const std::string& job_id, int total, const std::string& estimate_key, int steps,
+        const std::function<std::vector<std::string>(int first, int count)>& generate);
+
+    // Save job config to output folder. When `params` are the job's own,
+    // the file becomes its params_file.
     void save_job_config(const std::string& job_id, GenerationType type, const nlohmann::json& params);
+
+    // Shrink a finished job: params down to the summary (prompts, group and
+    // what a queue row shows) when they are in its params_file, otherwise inline input images dropped (named in
+    // metadata.stripped_inputs). No I/O; caller holds queue_mutex_.
+    void compact_job_locked(QueueItem& item);
+
+    // Read off-loaded params back from params_file (keeps the summary if
+    // the file is gone). Only get_job() does. Call without queue_mutex_.
+    void load_offloaded_params(QueueItem& item) const;
+
+    // Shared copy of `settings` for QueueItem::model_settings; caller holds queue_mutex_
+    std::shared_ptr<const nlohmann::json> intern_settings_locked(nlohmann::json settings);
     
     ModelManager& model_manager_;
     std::string output_dir_;
@@ -419,6 +803,12 @@ private:
     // useful precisely when expand_prompt creates many similar outputs.
     std::atomic<bool> group_folders_enabled_{true};
 
+    // Transfer defaults for model_download jobs (config "download" section)
+    DownloadConfig download_config_;
+
+    // Gallery thumbnails / video posters (owned by main, may be null)
+    ThumbnailCache* thumbnail_cache_ = nullptr;
+
 public:
     void set_group_folders_enabled(bool enabled) {
         group_folders_enabled_.store(enabled, std::memory_order_relaxed);
@@ -426,6 +816,30 @@ public:
     bool get_group_folders_enabled() const {
         return group_folders_enabled_.load(std::memory_order_relaxed);
     }
+
+    /**
+     * Transfer defaults for model_download jobs. Call before start().
+     */
+    void set_download_config(const DownloadConfig& config) {
+        download_config_ = config;
+    }
+
+    /**
+     * Thumbnail cache the output pipeline fills as images are written.
+     * Must outlive the QueueManager. Call before start().
+     */
+    void set_thumbnail_cache(ThumbnailCache* cache) {
+        thumbnail_cache_ = cache;
+        output_pipeline_.set_thumbnail_cache(cache);
+        output_reaper_.set_thumbnail_cache(cache);
+    }
+
+    /**
+     * Coordinator mode: dispatch txt2img / img2img / txt2vid to the
+     * cluster's nodes. Must outlive the QueueManager. Call before start().
+     */
+    void set_cluster(ClusterCoordinator* cluster) { cluster_ = cluster; }
+
     // Output directory that job output paths are relative to. Used by callers
     // (e.g. MCP image tool) that need to read generated files off disk.
     const std::string& output_dir() const { return output_dir_; }
@@ -449,33 +863,115 @@ private:
     // Queue storage
     mutable std::mutex queue_mutex_;
     std::map<std::string, QueueItem> jobs_;
-    std::queue<std::string> pending_queue_;
+    std::deque<std::string> pending_queue_;
+    // intern_settings_locked() pool, keyed by the settings' dump()
+    std::unordered_map<std::string, std::weak_ptr<const nlohmann::json>> settings_pool_;
     
-    // Worker thread
-    std::thread worker_;
+    // Worker pool
+    QueueConfig queue_config_;
+    std::vector<std::unique_ptr<WorkerSlot>> workers_;
+    int busy_io_workers_ = 0;                       // guarded by queue_mutex_
+    int generation_workers_ = 1;                    // One per queue.generation_devices entry
+    int generation_busy_ = 0;                       // guarded by queue_mutex_; generation workers running a job
+    bool has_post_worker_ = false;
+    bool post_vram_blocked_ = false;                // guarded by queue_mutex_; cleared when a generation ends
+    bool vram_held_ = false;                        // guarded by queue_mutex_; last pick held jobs back for VRAM
+    bool remote_held_ = false;                      // guarded by queue_mutex_; remote jobs waiting for a free node
+    ClusterCoordinator* cluster_ = nullptr;         // owned by main, null outside coordinator mode
+    std::mutex upscale_run_mutex_;                  // one upscale() on the upscaler context at a time
+    JobScheduler scheduler_;                        // guarded by queue_mutex_
+
+    // Persistence (snapshot + append-only journal, background writer)
+    QueueJournal journal_;
+
+    // Listing indexes (own shared mutex; written under queue_mutex_)
+    QueueIndex index_;
+
     std::atomic<bool> running_{false};
     std::condition_variable queue_cv_;
     
-    // Current job progress
+    // Running job progress (per WorkerSlot)
     mutable std::mutex progress_mutex_;
-    std::string current_job_id_;
-    ProgressInfo current_progress_;
-    std::chrono::steady_clock::time_point last_progress_broadcast_;
     static constexpr std::chrono::milliseconds PROGRESS_THROTTLE_MS{50};
+    static constexpr std::chrono::seconds VRAM_RECHECK_INTERVAL{2};
+
+    // Cross-job txt2img batching counters
+    std::atomic<uint64_t> merged_calls_{0};
+    std::atomic<uint64_t> merged_jobs_{0};
+
+    // Result cache: dedup key -> job id (guarded by queue_mutex_)
+    std::unordered_map<std::string, std::string> result_index_;
+    std::atomic<uint64_t> dedup_hits_{0};
+    std::atomic<uint64_t> dedup_misses_{0};
+
+    // Finished jobs whose params went to their params_file
+    std::atomic<uint64_t> params_offloaded_{0};
+
+    // VRAM admission counters (jobs refused at submit or pickup, jobs run
+    // with downgrades)
+    mutable std::atomic<uint64_t> vram_refused_{0};
+    std::atomic<uint64_t> vram_downgraded_{0};
+
+    // Running sweep jobs asked to stop after the current variation
+    // (guarded by queue_mutex_)
+    std::unordered_set<std::string> sweep_stops_;
+    // ...and those yielding to higher-priority work (same guard)
+    std::unordered_set<std::string> sweep_yields_;
+    std::atomic<uint64_t> sweeps_preempted_{0};
 
-    // Preview settings and state
+    // Per model and resolution time estimates, for checkpoint sizing
+    BatchCheckpoints checkpoint_estimates_;
+    std::atomic<uint64_t> checkpoints_written_{0};
+    std::atomic<uint64_t> batches_resumed_{0};
+
+    // When the last job finished, for the quant cache's idle check (queue_mutex_)
+    std::chrono::steady_clock::time_point last_job_finished_ = std::chrono::steady_clock::now();
+
+    // Files a batch model_hash job reads concurrently
+    static constexpr int MODEL_HASH_THREADS = 4;
+
+    // Preview settings
     mutable std::mutex preview_mutex_;
     PreviewSettings preview_settings_;
-    std::chrono::steady_clock::time_point last_preview_broadcast_;
     static constexpr std::chrono::milliseconds PREVIEW_THROTTLE_MS{200};
 
     // In-memory preview buffer storage (job_id -> buffer)
     mutable std::mutex preview_buffer_mutex_;
     std::unordered_map<std::string, PreviewBuffer> preview_buffers_;
+    // Last HTTP preview poll per job (preview_buffer_mutex_); keeps
+    // on-demand previews running for HTTP-only clients
+    mutable std::unordered_map<std::string, std::chrono::steady_clock::time_point> preview_polls_;
+    static constexpr std::chrono::seconds PREVIEW_POLL_GRACE{10};
+    static constexpr size_t PREVIEW_POLLS_MAX = 256;
+
+    // Someone is watching `job_id`'s previews (sampler thread, once per step)
+    bool preview_wanted(const std::string& job_id) const;
+
+    // Job events for HTTP watchers, next to the WebSocket broadcasts
+    JobEvents job_events_;
 
-    // Preview callback for broadcasting
+    // Broadcast a job event over the WebSocket and to the job's watchers
+    void publish_job_event(WSEventType type, const nlohmann::json& data);
+
+    // Progress/preview fan-out off the sampler thread
+    ProgressDispatcher progress_dispatcher_;
+
+    // Encodes and writes generation outputs off the worker threads
+    OutputPipeline output_pipeline_;
+
+    // Deletes purged jobs' files and runs retention/quota sweeps
+    static constexpr size_t PURGE_CHUNK = 256;
+    OutputReaper output_reaper_;
+    std::atomic<uint64_t> output_bytes_{0};         // Job outputs on disk at the last quota check
+    std::atomic<uint64_t> quota_evicted_{0};
+
+    // Preview callback (sampler thread): hands the frame to the dispatcher
     void update_preview(int step, int frame_count, const std::vector<uint8_t>& jpeg_data,
                        int width, int height, bool is_noisy);
+
+    // Dispatcher hooks
+    bool is_job_running(const std::string& job_id) const;
+    void store_preview(const ProgressEvent& preview);
 };
 
 // String conversions
@@ -5,7 +5,9 @@
 #include <string>
 #include <memory>
 #include <optional>
+#include <map>
 #include <filesystem>
+#include <mutex>
 
 #include "config.hpp"
 #include "architecture_manager.hpp"
@@ -25,6 +27,13 @@ namespace sdcpp {
 class ModelManager;
 class QueueManager;
 class AuthManager;
+class ThumbnailCache;
+class FileServer;
+class CachedDocument;
+class HttpFrontEnd;
+class ClusterCoordinator;
+struct JobOrigin;
+class StartupStatus;
 
 /**
  * Request Handlers - implements HTTP API endpoints
@@ -56,14 +65,42 @@ public:
      */
     void register_routes(httplib::Server& server);
 
+    /**
+     * Thumbnail cache behind /thumb/ (shared with the output pipeline).
+     * Must outlive the handlers.
+     */
+    void set_thumbnail_cache(ThumbnailCache* cache) { thumbnails_ = cache; }
+
+    /**
+     * Event-loop front end, when server.event_loop is on (stats in /health).
+     * Must outlive the handlers.
+     */
+    void set_front_end(const HttpFrontEnd* front_end) { front_end_ = front_end; }
+
+    /**
+     * Cluster coordinator, when cluster.role is "coordinator": generations
+     * no longer need a local model and /cluster/nodes reports the nodes.
+     * Must outlive the handlers.
+     */
+    void set_cluster(const ClusterCoordinator* cluster) { cluster_ = cluster; }
+
+    /**
+     * Startup stages still running behind the listener (/health "startup",
+     * /health/ready). Must outlive the handlers.
+     */
+    void set_startup_status(const StartupStatus* startup) { startup_ = startup; }
+
 private:
     // Model endpoints
     void handle_get_models(const httplib::Request& req, httplib::Response& res);
     void handle_refresh_models(const httplib::Request& req, httplib::Response& res);
     void handle_load_model(const httplib::Request& req, httplib::Response& res);
+    void handle_prefetch_model(const httplib::Request& req, httplib::Response& res);
     void handle_unload_model(const httplib::Request& req, httplib::Response& res);
     void handle_get_model_hash(const httplib::Request& req, httplib::Response& res);
-    void handle_upload_model(const httplib::Request& req, httplib::Response& res);
+    void handle_hash_models(const httplib::Request& req, httplib::Response& res);
+    void handle_upload_model(const httplib::Request& req, httplib::Response& res,
+                             const httplib::ContentReader& content_reader);
 
     // ControlNet hot-swap endpoints (sd_ctx_load_control_net / unload / has)
     void handle_controlnet_load(const httplib::Request& req, httplib::Response& res);
@@ -78,14 +115,17 @@ private:
     void handle_img2img(const httplib::Request& req, httplib::Response& res);
     void handle_txt2vid(const httplib::Request& req, httplib::Response& res);
     void handle_upscale(const httplib::Request& req, httplib::Response& res);
+    void handle_pipeline(const httplib::Request& req, httplib::Response& res);
     void handle_convert(const httplib::Request& req, httplib::Response& res);
 
     // Shared submission path used by txt2img/img2img/txt2vid. Honors
     // `expand_prompt: true` in the request body — when set, the prompt is
     // parsed for {a|b|c} / {N$$a|b|c} syntax, expanded into all variations,
     // and one queue item per variation is created with a shared
-    // variation_group_id. When the prompt has no template syntax (or the flag
-    // is false/absent), creates a single job exactly as before.
+    // variation_group_id. Templates over 200 variations (or
+    // `expand_prompt: "sweep"`) become one sweep job instead, which walks
+    // the variations lazily. When the prompt has no template syntax (or the
+    // flag is false/absent), creates a single job exactly as before.
     // generation_type is GenerationType (kept as int in the header so we
     // don't need to forward-declare the enum from queue_manager.hpp).
     void submit_generation_jobs(const httplib::Request& req, httplib::Response& res,
@@ -98,6 +138,9 @@ private:
     // Queue endpoints
     void handle_get_queue(const httplib::Request& req, httplib::Response& res);
     void handle_get_job(const httplib::Request& req, httplib::Response& res);
+    void handle_get_job_trace(const httplib::Request& req, httplib::Response& res);
+    void handle_wait_job(const httplib::Request& req, httplib::Response& res);
+    void handle_job_events(const httplib::Request& req, httplib::Response& res);
     void handle_cancel_job(const httplib::Request& req, httplib::Response& res);
     void handle_delete_jobs(const httplib::Request& req, httplib::Response& res);
 
@@ -109,7 +152,8 @@ private:
     void handle_get_recycle_bin_settings(const httplib::Request& req, httplib::Response& res);
     void handle_get_generation_option_descriptions(const httplib::Request& req, httplib::Response& res);
     // Shared "load JSON from data/<file> and serve" helper for the option-descriptions endpoints.
-    void serve_options_json(httplib::Response& res, const std::string& filename);
+    // The file is read once; later requests get the cached, precompressed body.
+    void serve_options_json(const httplib::Request& req, httplib::Response& res, const std::string& filename);
     // Output folder grouping (variation_group_id -> nested dirs).
     void handle_get_output_settings(const httplib::Request& req, httplib::Response& res);
     void handle_set_output_settings(const httplib::Request& req, httplib::Response& res);
@@ -121,11 +165,14 @@ private:
     void handle_auth_login(const httplib::Request& req, httplib::Response& res);
     void handle_auth_logout(const httplib::Request& req, httplib::Response& res);
 
-    // Health endpoint
+    // Health endpoints
     void handle_health(const httplib::Request& req, httplib::Response& res);
+    void handle_health_ready(const httplib::Request& req, httplib::Response& res);
 
     // Memory status endpoint
     void handle_memory(const httplib::Request& req, httplib::Response& res);
+    void handle_cluster_nodes(const httplib::Request& req, httplib::Response& res);
+    void handle_metrics(const httplib::Request& req, httplib::Response& res);
 
     // Options endpoint (samplers, schedulers)
     void handle_get_options(const httplib::Request& req, httplib::Response& res);
@@ -173,6 +220,21 @@ private:
     // <img src="/output/..."> and WS handshakes that can't carry an
     // Authorization header.
     static std::string extract_cookie_token(const httplib::Request& req);
+
+    // Username behind the request's cookie or bearer token; "" without auth
+    // or without a valid session
+    std::string authenticated_user(const httplib::Request& req) const;
+
+    // Strip the body's "priority" and fill in who queues the job. Sends
+    // the 400 for a bad priority and returns false. The
+    // queue.max_pending_per_user quota is checked when the job is added.
+    bool take_job_origin(const httplib::Request& req, nlohmann::json& body,
+                         JobOrigin& origin, httplib::Response& res);
+    // Block until the job is finished (QueueManager::wait_job) and send it
+    // like GET /queue/{id}, plus "finished"; `unfinished_status` is the
+    // HTTP status when the wait timed out
+    void send_job_when_finished(const httplib::Request& req, httplib::Response& res,
+                                const std::string& job_id, int timeout_seconds, int unfinished_status);
     // Resolve a /webdav/... URL path to an absolute filesystem path under
     // a configured root. Returns nullopt for traversal attempts (`..`),
     // unknown roots, or malformed paths. The resulting path may not exist.
@@ -193,7 +255,8 @@ private:
     httplib::Server::HandlerResponse handle_webdav_copy(
         const httplib::Request& req, httplib::Response& res);
     void handle_webdav_get(const httplib::Request& req, httplib::Response& res, bool head_only);
-    void handle_webdav_put(const httplib::Request& req, httplib::Response& res);
+    void handle_webdav_put(const httplib::Request& req, httplib::Response& res,
+                           const httplib::ContentReader& content_reader);
     void handle_webdav_delete(const httplib::Request& req, httplib::Response& res);
     void send_webdav_unauthorized(httplib::Response& res) const;
 
@@ -219,9 +282,7 @@ private:
     void handle_update_ui_preferences(const httplib::Request& req, httplib::Response& res);
     void handle_reset_settings(const httplib::Request& req, httplib::Response& res);
 
-    // Thumbnail generation
-    bool generate_thumbnail(const std::string& source_path, const std::string& thumb_path, int size = 120);
-    std::string get_thumbnail_path(const std::string& source_path);
+    // Media type checks for /thumb/
     bool is_image_file(const std::string& path);
     bool is_video_file(const std::string& path);
 
@@ -229,6 +290,19 @@ private:
     void send_json(httplib::Response& res, const nlohmann::json& json, int status = 200);
     void send_error(httplib::Response& res, const std::string& message, int status = 400);
     nlohmann::json parse_json_body(const httplib::Request& req);
+
+    /**
+     * Body of an endpoint that takes images: JSON, multipart/form-data (an
+     * optional "json" part, plain fields, image file parts named after
+     * their field) or a raw image (application/octet-stream / image/*)
+     * filling `raw_field`, with the other parameters in the query string.
+     * Uploads are spooled and "job:" references resolved, so image fields
+     * come back as base64 or "output:" references (image_input.hpp).
+     */
+    nlohmann::json parse_image_request_body(const httplib::Request& req, const std::string& raw_field);
+
+    /** Replace "job:<id>[#<n>]" image references with the job's output file */
+    void resolve_job_image_refs(nlohmann::json& body);
     std::string get_mime_type(const std::string& filepath);
     std::string format_file_size(size_t size);
     size_t calculate_directory_size(const std::string& path);
@@ -241,18 +315,36 @@ private:
     ModelManager& model_manager_;
     QueueManager& queue_manager_;
     AuthManager& auth_manager_;
+    ThumbnailCache* thumbnails_ = nullptr;
+    const HttpFrontEnd* front_end_ = nullptr;
+    const ClusterCoordinator* cluster_ = nullptr;
+    const StartupStatus* startup_ = nullptr;
     PathsConfig paths_config_;  // Snapshot of configured model/output paths (for WebDAV mapping)
     bool allow_public_outputs_ = true;          // auth.allow_public_outputs
+    bool allow_public_metrics_ = false;         // auth.allow_public_metrics
     std::vector<std::string> trusted_proxies_;  // server.trusted_proxies (X-Forwarded-* whitelist)
+    int webdav_max_depth_ = 1;                  // server.webdav_max_depth (PROPFIND Depth: infinity)
     bool mcp_image_tool_enabled_ = false;       // mcp.image_tool_enabled (surfaced in /health features)
     std::string output_dir_;
     std::string webui_dir_;
     std::string docs_dir_;
+    std::unique_ptr<FileServer> files_;         // /output, WebDAV GET and WebUI bodies
+    std::mutex options_docs_mutex_;
+    std::map<std::string, std::shared_ptr<const CachedDocument>> options_docs_;    // By data/ filename
     std::unique_ptr<ArchitectureManager> architecture_manager_;
     std::unique_ptr<SettingsManager> settings_manager_;
     std::unique_ptr<ApiRegistry> api_registry_;
 
 #ifdef SDCPP_ASSISTANT_ENABLED
+    // Built on first use, off the startup path: assistant() on the first
+    // assistant request, docs_index() on the first search_docs call
+    AssistantClient& assistant();
+    DocsIndex* docs_index();
+
+    AssistantConfig assistant_config_;
+    std::string config_file_path_;
+    std::once_flag assistant_once_;
+    std::once_flag docs_index_once_;
     std::unique_ptr<ToolExecutor> tool_executor_;
     std::unique_ptr<AssistantClient> assistant_client_;
     std::unique_ptr<DocsIndex> docs_index_;  // BM25 index over docs/*.md
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+namespace sdcpp {
+
+/**
+ * One ggml rpc-server as seen from here (see probe_rpc_servers)
+ */
+struct RpcNodeProbe {
+    std::string endpoint;               // "host:port" as listed in rpc_servers
+    bool reachable = false;
+    std::string version;                // RPC protocol version from HELLO
+    double connect_ms = 0.0;            // TCP connect
+    double rtt_ms = 0.0;                // Median request/response round trip
+    uint64_t free_bytes = 0;            // Device 0 of the server
+    uint64_t total_bytes = 0;
+    std::string error;
+
+    nlohmann::json to_json() const;
+};
+
+/**
+ * Probe every "host:port" in an rpc_servers list: connect, HELLO, then
+ * GET_DEVICE_MEMORY `samples` times for the link round trip and the
+ * server's free VRAM. ggml's rpc-server serves one client at a time, so
+ * this must finish before sd.cpp connects.
+ */
+std::vector<RpcNodeProbe> probe_rpc_servers(const std::string& rpc_servers, int samples = 5,
+                                            int timeout_ms = 2000);
+
+/**
+ * How rpc_split = "auto" spreads a model's weights over the local GPU and
+ * the reachable RPC servers
+ */
+struct RpcSplitPlan {
+    struct Device {
+        std::string name;               // Device name in the max_vram budget string
+        std::string endpoint;           // Empty for the local GPU
+        uint64_t free_bytes = 0;
+        uint64_t budget_bytes = 0;      // Weights placed on it
+        double share = 0.0;             // Of the weights, and so of each step's compute
+        double rtt_ms = 0.0;
+    };
+    std::vector<Device> devices;
+    std::string rpc_servers;            // Reachable servers only, in the original order
+    std::string max_vram;               // "<device>:<GiB>,..." for sd_ctx_params_t.max_vram; empty = no plan
+    uint64_t weight_bytes = 0;
+    bool fits = false;                  // The budgets hold all weights
+    double probe_ms = 0.0;
+    std::vector<RpcNodeProbe> probes;
+
+    nlohmann::json to_json() const;
+};
+
+/**
+ * Split `weight_bytes` over the devices in proportion to their free VRAM
+ * less `headroom_bytes` (which stays free for compute buffers). Servers
+ * that did not answer are left out of rpc_servers. `local_device` is the
+ * local GPU's name ("" when there is none).
+ */
+RpcSplitPlan plan_rpc_split(const std::vector<RpcNodeProbe>& probes, const std::string& local_device,
+                            uint64_t local_free_bytes, uint64_t weight_bytes, uint64_t headroom_bytes);
+
+} // namespace sdcpp
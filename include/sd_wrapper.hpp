@@ -7,9 +7,14 @@
 
 #include <nlohmann/json.hpp>
 #include "stable-diffusion.h"
+#include "tiled_upscaler.hpp"
 
 namespace sdcpp {
 
+class ConditioningCache;
+class OutputBatch;
+class ThumbnailCache;
+
 /**
  * Progress callback type
  * @param step Current step
@@ -29,6 +34,12 @@ using ProgressCallback = std::function<void(int step, int total)>;
 using PreviewCallback = std::function<void(int step, int frame_count,
     const std::vector<uint8_t>& jpeg_data, int width, int height, bool is_noisy)>;
 
+/**
+ * Whether anyone is watching the running job's previews. Asked once per
+ * diffusion step on the sampler thread, so it must be cheap.
+ */
+using PreviewDemandFn = std::function<bool()>;
+
 /**
  * Preview mode for generation
  */
@@ -151,6 +162,10 @@ struct Txt2ImgParams {
     bool upscale_auto_unload = true;    // Unload upscaler after upscaling
     int upscale_repeats = 1;            // Run upscaler multiple times
 
+    // Output encoding; empty / -1 = server "output" config defaults
+    std::string output_format;          // "png", "jpeg", "webp"
+    int output_quality = -1;            // JPEG / lossy WebP quality 1-100
+
     static Txt2ImgParams from_json(const nlohmann::json& j);
     nlohmann::json to_json() const;
 };
@@ -272,6 +287,10 @@ struct Img2ImgParams {
     bool upscale_auto_unload = true;    // Unload upscaler after upscaling
     int upscale_repeats = 1;            // Run upscaler multiple times
 
+    // Output encoding; empty / -1 = server "output" config defaults
+    std::string output_format;          // "png", "jpeg", "webp"
+    int output_quality = -1;            // JPEG / lossy WebP quality 1-100
+
     static Img2ImgParams from_json(const nlohmann::json& j);
     nlohmann::json to_json() const;
 };
@@ -287,6 +306,13 @@ struct UpscaleParams {
     int upscale_factor = 4;             // Target upscale factor (model determines actual)
     int tile_size = 128;                // Tile size for ESRGAN (VRAM optimization)
     int repeats = 1;                    // Run upscaler multiple times
+    int pass_tile_size = 0;             // Source pixels per upscale() pass; 0 = auto
+    int tile_overlap = 16;              // Source pixels blended between neighbouring passes
+    int model_tile_size = 128;          // Loaded upscaler's tile_size (set by the worker, not JSON)
+
+    // Output encoding; empty / -1 = server "output" config defaults
+    std::string output_format;
+    int output_quality = -1;
 
     static UpscaleParams from_json(const nlohmann::json& j);
     nlohmann::json to_json() const;
@@ -451,45 +477,126 @@ struct Txt2VidParams {
     bool circular_x = false;
     bool circular_y = false;
 
+    // Video file output (see video_encoder.hpp). Empty = server default
+    // from the "video" config section; "none" writes frames only.
+    std::string video_format;           // "mp4", "webm", "avi", "none"
+    std::string video_codec;            // "h264", "vp9", "av1"; empty = container default
+    bool keep_frames = true;            // Also write frame_NNNN.png (default from config)
+
     static Txt2VidParams from_json(const nlohmann::json& j);
     nlohmann::json to_json() const;
 };
 
+/**
+ * One queued job's slice of a merged txt2img call (see QueueManager's
+ * cross-job batching). Images are handed out in order: the first `images`
+ * go to the first share, and so on.
+ */
+struct Txt2ImgShare {
+    std::string subpath;                // Job's output dir under output_dir
+    int images = 1;                     // The job's batch_count
+    OutputBatch* outputs_batch = nullptr;
+    std::vector<std::string> outputs;   // Filled in: paths relative to output_dir
+};
+
+/**
+ * Decoded image handed from one pipeline stage to the next in memory,
+ * instead of through an encoded file (see QueueManager pipeline jobs)
+ */
+struct StageImage {
+    std::vector<uint8_t> data;
+    int width = 0;
+    int height = 0;
+    int channels = 3;
+};
+
 /**
  * SD Wrapper - wraps stable-diffusion.cpp functionality
  */
 class SDWrapper {
 public:
     /**
-     * Set global progress callback
+     * Set the calling thread's progress callback. sd.cpp's callback is
+     * process-global; it stays registered while any thread has one of its
+     * own, and each call goes to the callback of the thread it runs on.
      * @param callback Progress callback function
      * @param expected_steps Expected diffusion steps (used to identify phases in logging)
      */
     static void set_progress_callback(ProgressCallback callback, int expected_steps = 0);
 
     /**
-     * Clear progress callback
+     * Clear the calling thread's progress callback
      */
     static void clear_progress_callback();
 
     /**
-     * Set global preview callback for live preview images
+     * Register sd.cpp's progress callback again after something else (the
+     * model load's progress) borrowed it, if any thread still has one
+     */
+    static void resume_progress_callback();
+
+    /**
+     * Ignore sd.cpp progress callbacks raised on the calling thread. For
+     * work that runs alongside a generation and reports its own progress;
+     * scoped by the caller.
+     */
+    static void set_thread_progress_muted(bool muted);
+
+    /**
+     * Set the calling thread's preview callback for live preview images.
+     * sd.cpp's preview settings are process-global: with generations on
+     * several threads, a step is decoded when any of them wants it and the
+     * others drop previews they did not ask for.
+     *
+     * With `demand` or `max_overhead_percent`, previews are paced per step:
+     * sd.cpp only decodes one for a step when `demand` says someone is
+     * watching, at least `interval` steps after the last, and far enough
+     * apart that the measured preview cost (step time with a preview minus
+     * step time without) stays within max_overhead_percent of the step time.
+     *
      * @param callback Preview callback function
      * @param mode Preview mode (None, Proj, Tae, Vae)
-     * @param interval Generate preview every N steps (default: 1)
+     * @param interval Generate preview every N steps (default: 1); the minimum when paced
      * @param max_size Maximum preview dimension in pixels (default: 256)
      * @param quality JPEG quality 1-100 (default: 75)
+     * @param demand Watcher check; null = always wanted
+     * @param max_overhead_percent Preview cost budget per step; 0 = fixed interval
      */
     static void set_preview_callback(PreviewCallback callback,
                                      PreviewMode mode = PreviewMode::Tae,
                                      int interval = 1,
                                      int max_size = 256,
-                                     int quality = 75);
+                                     int quality = 75,
+                                     PreviewDemandFn demand = nullptr,
+                                     int max_overhead_percent = 0);
+
+    /**
+     * Preview pacing counters since startup: {previews, steps_unwatched,
+     * steps_throttled, interval (current effective), step_ms, preview_ms}
+     */
+    static nlohmann::json preview_pacing_json();
 
     /**
-     * Clear preview callback
+     * Clear the calling thread's preview callback
      */
     static void clear_preview_callback();
+
+    /**
+     * Cache for sd.cpp's prompt encodes (null or disabled = off). Only
+     * effective when built with the sd.cpp hook (SDCPP_COND_CACHE).
+     */
+    static void set_conditioning_cache(ConditioningCache* cache);
+
+    /**
+     * What a context's encodes depend on besides the generate call: its
+     * components and their hashes. The generate calls on `ctx` use the
+     * cache only while it has a scope; empty forgets `ctx` (set it before
+     * the context is freed).
+     */
+    static void set_conditioning_scope(const sd_ctx_t* ctx, const std::string& scope);
+
+    /** Whether this build has the sd.cpp conditioning hook */
+    static bool conditioning_cache_available();
     
     /**
      * Generate images from text
@@ -498,6 +605,15 @@ public:
      * @param lora_dir Directory containing LoRA files
      * @param output_dir Directory to save output
      * @param job_id Job ID for output naming
+     * @param outputs_batch If set, images are handed to the output pipeline
+     *        instead of being written before returning
+     * @param shares If set, the call generates for several jobs at once
+     *        (params.batch_count is their total) and each image goes to its
+     *        share's directory and batch instead of job_id/outputs_batch
+     * @param images_out If set, the images are also returned decoded. With
+     *        an empty job_id nothing is written to disk at all
+     * @param first_index Number of the first output file (output_<n>), for
+     *        a batch generated over several calls. Ignored with shares.
      * @return List of output file paths (relative to output_dir)
      */
     static std::vector<std::string> generate_txt2img(
@@ -505,7 +621,11 @@ public:
         const Txt2ImgParams& params,
         const std::string& lora_dir,
         const std::string& output_dir,
-        const std::string& job_id
+        const std::string& job_id,
+        OutputBatch* outputs_batch = nullptr,
+        std::vector<Txt2ImgShare>* shares = nullptr,
+        std::vector<StageImage>* images_out = nullptr,
+        int first_index = 0
     );
     
     /**
@@ -515,6 +635,10 @@ public:
      * @param lora_dir Directory containing LoRA files
      * @param output_dir Directory to save output
      * @param job_id Job ID for output naming
+     * @param outputs_batch If set, images are handed to the output pipeline
+     *        instead of being written before returning
+     * @param images_out As for generate_txt2img
+     * @param first_index As for generate_txt2img
      * @return List of output file paths (relative to output_dir)
      */
     static std::vector<std::string> generate_img2img(
@@ -522,7 +646,10 @@ public:
         const Img2ImgParams& params,
         const std::string& lora_dir,
         const std::string& output_dir,
-        const std::string& job_id
+        const std::string& job_id,
+        OutputBatch* outputs_batch = nullptr,
+        std::vector<StageImage>* images_out = nullptr,
+        int first_index = 0
     );
     
     /**
@@ -532,6 +659,8 @@ public:
      * @param lora_dir Directory containing LoRA files
      * @param output_dir Directory to save output
      * @param job_id Job ID for output naming
+     * @param thumbnails When set, also writes poster.jpg and preview.jpg
+     *                   from the in-memory frames (see ThumbnailCache)
      * @return List of output file paths (relative to output_dir)
      */
     static std::vector<std::string> generate_txt2vid(
@@ -539,7 +668,8 @@ public:
         const Txt2VidParams& params,
         const std::string& lora_dir,
         const std::string& output_dir,
-        const std::string& job_id
+        const std::string& job_id,
+        ThumbnailCache* thumbnails = nullptr
     );
     
     /**
@@ -549,6 +679,7 @@ public:
      * @param params ADetailer request params
      * @param output_dir Directory to save output
      * @param job_id Job ID for output naming
+     * @param images_out As for generate_txt2img
      * @return List of output file paths (relative to output_dir)
      */
     static std::vector<std::string> run_adetailer(
@@ -556,7 +687,8 @@ public:
         sd_ctx_t* sd_ctx,
         const AdetailerParams& params,
         const std::string& output_dir,
-        const std::string& job_id
+        const std::string& job_id,
+        std::vector<StageImage>* images_out = nullptr
     );
 
     /**
@@ -565,13 +697,16 @@ public:
      * @param params Upscale parameters
      * @param output_dir Directory to save output
      * @param job_id Job ID for output naming
+     * @param outputs_batch If set, the result is handed to the output pipeline
      * @return List of output file paths (relative to output_dir)
      */
     static std::vector<std::string> upscale_image(
         upscaler_ctx_t* upscaler_ctx,
         const UpscaleParams& params,
         const std::string& output_dir,
-        const std::string& job_id
+        const std::string& job_id,
+        OutputBatch* outputs_batch = nullptr,
+        const ProgressCallback& on_pass = nullptr
     );
     
     /**
@@ -583,6 +718,7 @@ public:
      * @param channels Image channels
      * @param out_width Output width (set by function)
      * @param out_height Output height (set by function)
+     * @param options Pass tiling, overlap and repeats (see tiled_upscaler.hpp)
      * @return Upscaled image data
      */
     static std::vector<uint8_t> upscale_image_data(
@@ -592,7 +728,8 @@ public:
         int height,
         int channels,
         int& out_width,
-        int& out_height
+        int& out_height,
+        const TiledUpscaleOptions& options = {}
     );
     
     /**
@@ -612,7 +749,7 @@ public:
     
     /**
      * Decode base64 image data and load
-     * @param base64_data Base64 encoded image
+     * @param base64_data Base64 encoded image, or an "output:" image reference (image_input.hpp)
      * @param width Output width
      * @param height Output height
      * @param channels Output channels
@@ -681,14 +818,17 @@ public:
     );
 
 private:
-    static ProgressCallback progress_callback_;
-    static int expected_diffusion_steps_;  // Track expected steps to identify phases
+    // Per thread, like the preview state below: each generation worker's
+    // sd.cpp callbacks run on its own thread
+    static thread_local ProgressCallback progress_callback_;
+    static thread_local int expected_diffusion_steps_;  // Track expected steps to identify phases
+    static thread_local bool progress_muted_;
     static void internal_progress_callback(int step, int steps, float time, void* data);
 
     // Preview callback support
-    static PreviewCallback preview_callback_;
-    static int preview_max_size_;
-    static int preview_quality_;
+    static thread_local PreviewCallback preview_callback_;
+    static thread_local int preview_max_size_;
+    static thread_local int preview_quality_;
     static void internal_preview_callback(int step, int frame_count, sd_image_t* frames, bool is_noisy, void* data);
 
     // Helper functions for preview
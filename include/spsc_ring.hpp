@@ -0,0 +1,59 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+namespace sdcpp {
+
+/**
+ * Bounded single-producer / single-consumer ring buffer.
+ *
+ * Neither side blocks or takes a lock: the producer only writes tail_, the
+ * consumer only writes head_, each publishing with release and reading the
+ * other with acquire. Capacity must be a power of two; one slot is not kept
+ * free, indices run freely and are masked on access.
+ */
+template <typename T, size_t Capacity>
+class SpscRing {
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0,
+                  "SpscRing capacity must be a power of two");
+
+public:
+    /**
+     * Producer side. Returns false (and leaves `value` untouched) when full.
+     */
+    bool try_push(T&& value) {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) == Capacity) {
+            return false;
+        }
+        slots_[tail & (Capacity - 1)] = std::move(value);
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Consumer side. Returns false when empty.
+     */
+    bool try_pop(T& out) {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_acquire)) {
+            return false;
+        }
+        out = std::move(slots_[head & (Capacity - 1)]);
+        slots_[head & (Capacity - 1)] = T{};  // release payload memory on the consumer side
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    static constexpr size_t capacity() { return Capacity; }
+
+private:
+    std::array<T, Capacity> slots_{};
+    alignas(64) std::atomic<size_t> head_{0};
+    alignas(64) std::atomic<size_t> tail_{0};
+};
+
+} // namespace sdcpp
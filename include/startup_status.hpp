@@ -0,0 +1,63 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+namespace sdcpp {
+
+/**
+ * Readiness of the startup stages that run after the HTTP listener is up
+ * (model scan, queue workers, cluster poll, model auto-reload), for
+ * /health and /health/ready. A server that answers at all is alive;
+ * ready() once every gating stage has finished. Thread-safe.
+ */
+class StartupStatus {
+public:
+    StartupStatus();
+
+    /**
+     * Register a stage, in display order. Stages with `gates_ready` false
+     * (the model reload) are reported but do not hold back ready().
+     */
+    void add(const std::string& stage, bool gates_ready = true);
+
+    void begin(const std::string& stage);
+    void done(const std::string& stage, const std::string& note = "");
+    void skip(const std::string& stage, const std::string& note);
+    void fail(const std::string& stage, const std::string& error);
+
+    /** begin(), `fn`, then done() - or fail() with what it threw */
+    void run(const std::string& stage, const std::function<void()>& fn);
+
+    /** Every gating stage is done or skipped */
+    bool ready() const;
+
+    /** {ready, uptime_ms, stages: [{name, state, gates_ready, started_ms, duration_ms, note}]} */
+    nlohmann::json to_json() const;
+
+private:
+    enum class State { Pending, Running, Done, Skipped, Failed };
+
+    struct Stage {
+        std::string name;
+        bool gates_ready = true;
+        State state = State::Pending;
+        std::chrono::steady_clock::time_point started{};
+        std::chrono::steady_clock::time_point finished{};
+        std::string note;                   // Error for a failed stage
+    };
+
+    Stage* find_locked(const std::string& stage);
+    void finish(const std::string& stage, State state, const std::string& note);
+
+    const std::chrono::steady_clock::time_point created_;
+    mutable std::mutex mutex_;
+    std::vector<Stage> stages_;
+};
+
+} // namespace sdcpp
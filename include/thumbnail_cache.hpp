@@ -0,0 +1,194 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <unordered_set>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstdint>
+
+#include <nlohmann/json.hpp>
+#include "config.hpp"
+#include "image_encoder.hpp"
+
+namespace sdcpp {
+
+/**
+ * One encoded thumbnail. Shared between the memory cache and responses
+ * that are still streaming it, so eviction never invalidates a transfer.
+ */
+struct Thumbnail {
+    std::vector<uint8_t> data;
+    std::string mime;
+    std::string etag;               // Source size + mtime + edge length
+    std::string last_modified;      // Source mtime, RFC 1123
+};
+
+/**
+ * Borrowed pixels of one video frame
+ */
+struct FrameView {
+    const uint8_t* pixels = nullptr;
+    int width = 0;
+    int height = 0;
+    int channels = 3;
+};
+
+/**
+ * Multi-size gallery thumbnails.
+ *
+ * generate() is called by the output pipeline with the pixels it is about
+ * to encode, so every configured size exists on disk (<dir>/.thumbs/) before
+ * a client asks for one. get() serves from, in order:
+ *
+ *   1. An LRU of encoded thumbnails bounded by memory_cache_mb
+ *   2. The manifest: sources this process has already seen, with the
+ *      source's size/mtime and which sizes are on disk. A manifest hit
+ *      reads the thumbnail file without stat()ing anything.
+ *   3. The filesystem: one stat of the source and thumbnail, then either
+ *      the existing file or a fresh render from the decoded source
+ *
+ * Renders of the same source are coalesced and the number of concurrent
+ * decodes is capped, so opening a page of 100 new images costs at most a
+ * few full-size decodes at a time instead of one per HTTP thread.
+ *
+ * The manifest trusts that sources don't change behind its back: outputs
+ * are write-once, and the WebDAV write paths call invalidate().
+ */
+class ThumbnailCache {
+public:
+    static constexpr const char* VIDEO_POSTER_NAME = "poster.jpg";
+    static constexpr const char* VIDEO_PREVIEW_NAME = "preview.jpg";
+    static constexpr int VIDEO_PREVIEW_FRAMES = 8;
+
+    enum class Status {
+        Ok,
+        NotFound,       // Source missing or not a regular file
+        Failed          // Source could not be decoded
+    };
+
+    struct Result {
+        Status status = Status::Failed;
+        std::shared_ptr<const Thumbnail> thumbnail;
+    };
+
+    explicit ThumbnailCache(const ThumbnailConfig& config);
+
+    ThumbnailCache(const ThumbnailCache&) = delete;
+    ThumbnailCache& operator=(const ThumbnailCache&) = delete;
+
+    /** Configured edge lengths, ascending */
+    const std::vector<int>& sizes() const { return sizes_; }
+
+    /**
+     * Snap a requested edge length to a configured one: the smallest size
+     * >= requested, else the largest. <= 0 selects the default
+     * (utils::THUMBNAIL_SIZE when configured, else the smallest).
+     */
+    int resolve_size(int requested) const;
+
+    /**
+     * Write every configured size for `source_path` from its in-memory
+     * pixels and remember them. Called after the source file is written.
+     * @return Number of sizes written
+     */
+    int generate(const std::string& source_path, const uint8_t* pixels,
+                 int width, int height, int channels);
+
+    /**
+     * Previews for a frame sequence, written into `dir` next to the frames:
+     *
+     *   poster.jpg   The middle frame at full size. Every thumbnail size is
+     *                generated for it too, and /thumb/ serves it for any
+     *                video file in the same directory.
+     *   preview.jpg  VIDEO_PREVIEW_FRAMES evenly spaced frames as square
+     *                tiles of the default thumbnail size, side by side (a
+     *                sprite the UI animates by shifting background-position)
+     *
+     * @return false if the poster could not be written
+     */
+    bool generate_video_previews(const std::string& dir, const std::vector<FrameView>& frames);
+
+    /**
+     * Thumbnail of `size` (one of sizes()) for an image file
+     */
+    Result get(const std::string& source_path, int size);
+
+    /**
+     * Forget `path` and, for a directory, everything below it. Use after a
+     * source is overwritten, moved or deleted.
+     */
+    void invalidate(const std::string& path);
+
+    /** Thumbnail files of every configured size for `source_path` (whether or not they exist) */
+    std::vector<std::string> thumbnail_files(const std::string& source_path) const;
+
+    /**
+     * Counters: memory entries/bytes, manifest entries, memory_hits,
+     * disk_hits, renders, render_waits, generated
+     */
+    nlohmann::json stats_json() const;
+
+private:
+    struct SourceInfo {
+        uint64_t size = 0;
+        int64_t mtime = 0;          // Seconds since the epoch (system clock)
+        uint32_t on_disk = 0;       // Bit i set = sizes_[i] exists in .thumbs/
+    };
+
+    struct MemoryEntry {
+        std::shared_ptr<const Thumbnail> thumbnail;
+        std::list<std::string>::iterator lru_it;
+    };
+
+    static std::string normalize(const std::string& path);
+    static std::string memory_key(const std::string& source, int size);
+
+    int size_index(int size) const;
+    std::string path_for(const std::string& source, int size) const;
+    std::shared_ptr<Thumbnail> make_thumbnail(std::vector<uint8_t>&& data, const SourceInfo& info, int size) const;
+
+    /**
+     * Encode all sizes from decoded pixels, write them and cache them.
+     * `out[i]` receives sizes_[i] (null if it could not be encoded).
+     * @return Bit mask of the sizes written
+     */
+    uint32_t render(const std::string& source, const uint8_t* pixels, int width, int height,
+                    int channels, const SourceInfo& info,
+                    std::vector<std::shared_ptr<const Thumbnail>>& out);
+
+    // Read a manifest-listed or freshly validated file into memory
+    std::shared_ptr<const Thumbnail> load_from_disk(const std::string& source, int size, const SourceInfo& info);
+
+    void remember(const std::string& source, const SourceInfo& info);
+    void insert_memory_locked(const std::string& key, std::shared_ptr<const Thumbnail> thumbnail);
+    std::shared_ptr<const Thumbnail> find_memory_locked(const std::string& key);
+
+    std::vector<int> sizes_;
+    EncodeOptions encode_;
+    std::string extension_;
+    std::string mime_;
+    size_t memory_budget_;
+    int max_renders_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable render_cv_;
+    std::unordered_map<std::string, SourceInfo> manifest_;
+    std::unordered_map<std::string, MemoryEntry> memory_;
+    std::list<std::string> lru_;                    // Front = most recently used
+    size_t memory_bytes_ = 0;
+    std::unordered_set<std::string> rendering_;     // Sources being rendered by get()
+    int active_renders_ = 0;
+
+    std::atomic<uint64_t> memory_hits_{0};
+    std::atomic<uint64_t> disk_hits_{0};
+    std::atomic<uint64_t> renders_{0};
+    std::atomic<uint64_t> render_waits_{0};
+    std::atomic<uint64_t> generated_{0};
+};
+
+} // namespace sdcpp
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "stable-diffusion.h"
+
+namespace sdcpp {
+
+/**
+ * Tiled ESRGAN upscaling on top of sd.cpp's upscale().
+ *
+ * sd.cpp splits each upscale() call into tiles of the upscaler context's
+ * tile_size and runs them one after another; everything around that call
+ * (float conversion of the input, the full-size output) scales with the
+ * image. Here a large image is cut into overlapping passes of several model
+ * tiles each, so one upscale() call keeps the GPU busy on a batch of tiles
+ * while the CPU side stays bounded. The seams between passes are
+ * cross-faded over the overlap.
+ *
+ * Pass i runs on the calling thread while a helper thread cuts pass i+1 out
+ * of the source and blends pass i-1 into the output, so the CPU work hides
+ * behind the GPU.
+ */
+struct TiledUpscaleOptions {
+    int upscale_factor = 4;     // Passed to upscale(); the model decides the real factor
+    int pass_tile = 0;          // Source pixels per pass side; 0 = auto from model_tile
+    int overlap = 16;           // Source pixels shared by neighbouring passes
+    int model_tile = 128;       // tile_size the upscaler context was created with
+    int repeats = 1;            // Upscale the result again this many times in total
+};
+
+/**
+ * Largest upscaler tile_size whose ESRGAN activations fit in half of the
+ * free VRAM; 128 (sd.cpp's default) when no GPU is reported
+ */
+int auto_upscaler_tile_size(uint64_t gpu_free_bytes);
+
+/** Estimated peak VRAM of one upscale() call with the given tile_size */
+uint64_t upscaler_vram_estimate(int tile_size);
+
+/**
+ * Upscale an RGB image
+ * @param on_pass Called after each pass with (done, total) across all repeats
+ * @return The upscaled pixels (3 channels); out_width/out_height are set
+ */
+std::vector<uint8_t> tiled_upscale(
+    upscaler_ctx_t* ctx,
+    const uint8_t* data,
+    int width,
+    int height,
+    int channels,
+    const TiledUpscaleOptions& options,
+    int& out_width,
+    int& out_height,
+    const std::function<void(int done, int total)>& on_pass = nullptr
+);
+
+} // namespace sdcpp
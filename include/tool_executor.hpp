@@ -2,6 +2,9 @@
 
 #include <string>
 #include <set>
+#include <vector>
+#include <utility>
+#include <functional>
 #include <nlohmann/json.hpp>
 
 namespace sdcpp {
@@ -53,6 +56,17 @@ public:
     nlohmann::json execute(const std::string& tool_name,
                            const nlohmann::json& parameters);
 
+    /**
+     * Execute several backend tools, as one LLM turn asks for them. They're
+     * all read-only queries, so they run concurrently on up to
+     * MAX_PARALLEL_TOOLS threads; results come back in call order.
+     * @param calls (tool name, parameters) pairs
+     */
+    std::vector<nlohmann::json> execute_all(
+        const std::vector<std::pair<std::string, nlohmann::json>>& calls);
+
+    static constexpr size_t MAX_PARALLEL_TOOLS = 4;
+
     /**
      * Check if a tool should be executed on the backend
      * @param tool_name Name of the tool
@@ -73,11 +87,12 @@ public:
     void set_settings_manager(SettingsManager* settings_manager);
 
     /**
-     * Set the documentation index for the search_docs tool.
-     * Pointer is non-owning; caller (RequestHandlers) keeps the index alive
-     * for the ToolExecutor's lifetime.
+     * Set the documentation index for the search_docs tool. Called on the
+     * first search, so the index can be built lazily; the pointer it
+     * returns is non-owning and the caller (RequestHandlers) keeps the
+     * index alive for the ToolExecutor's lifetime.
      */
-    void set_docs_index(class DocsIndex* docs_index);
+    void set_docs_index(std::function<class DocsIndex*()> docs_index);
 
 private:
     // Tool implementations
@@ -96,7 +111,7 @@ private:
     QueueManager& queue_manager_;
     ArchitectureManager* architecture_manager_;
     SettingsManager* settings_manager_ = nullptr;
-    class DocsIndex* docs_index_ = nullptr;
+    std::function<class DocsIndex*()> docs_index_;
     std::string output_dir_;
 
     // Set of tools that execute on the backend
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "utils.hpp"
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace sdcpp {
+
+/**
+ * Streams an upload to disk as it is received, for /models/upload and
+ * WebDAV PUT.
+ *
+ * Bytes go to a temp file through a fixed 1 MiB buffer and are hashed on
+ * the way, so memory use doesn't depend on the upload size and no second
+ * pass over the file is needed for its SHA256. When the size is known up
+ * front the temp file is reserved with posix_fallocate, which fails fast on
+ * a full disk. commit() syncs the data and renames the temp file into
+ * place; a writer that is destroyed without a successful commit() removes
+ * its temp file, so a dropped connection never leaves a partial model
+ * behind.
+ */
+class UploadWriter {
+public:
+    UploadWriter() = default;
+    ~UploadWriter();
+
+    UploadWriter(const UploadWriter&) = delete;
+    UploadWriter& operator=(const UploadWriter&) = delete;
+
+    /**
+     * Create the temp file <dir>/.<name>.upload.<pid>.<n>
+     * @param dir Directory for the temp file; the same filesystem as the
+     *            destination makes commit() a plain rename
+     * @param expected_size Bytes to reserve (0 if unknown). Only a hint:
+     *            the file is truncated to what was written on commit()
+     * @return false with error() set if the file can't be created or the
+     *         disk doesn't have expected_size bytes free
+     */
+    bool open(const std::string& dir, const std::string& name, uint64_t expected_size = 0);
+
+    /** Append data. @return false with error() set on a write failure */
+    bool write(const char* data, size_t len);
+
+    /**
+     * Flush, sync and move the file to `dest`
+     * @param replace Overwrite an existing file (WebDAV PUT). Without it
+     *        an existing `dest` fails the commit with exists() set
+     * @return false with error() set; the temp file is removed either way
+     */
+    bool commit(const std::string& dest, bool replace);
+
+    /** Remove the temp file (also done by the destructor) */
+    void discard();
+
+    bool is_open() const { return fd_ >= 0; }
+    uint64_t size() const { return written_; }
+    /** True when commit() failed because the destination already exists */
+    bool exists() const { return exists_; }
+    /** True when the last failure was ENOSPC (HTTP 507) */
+    bool out_of_space() const { return out_of_space_; }
+    const std::string& error() const { return error_; }
+    const std::string& temp_path() const { return temp_path_; }
+
+    /** Hex SHA256 of everything written; valid after a successful commit() */
+    const std::string& sha256() const { return sha256_; }
+
+private:
+    bool flush();
+    bool fail(const std::string& what);
+
+    int fd_ = -1;
+    std::string temp_path_;
+    std::vector<char> buffer_;
+    size_t buffered_ = 0;
+    uint64_t written_ = 0;
+    uint64_t reserved_ = 0;
+    utils::Sha256 hasher_;
+    std::string sha256_;
+    std::string error_;
+    bool exists_ = false;
+    bool out_of_space_ = false;
+};
+
+} // namespace sdcpp
@@ -41,12 +41,33 @@ namespace sdcpp {
 bool ip_in_trusted_list(const std::string& ip,
                         const std::vector<std::string>& trusted);
 
+/**
+ * Header the event-loop front end (HttpFrontEnd) stamps on every request
+ * it forwards to httplib: `<token> <client ip>`. httplib itself only sees
+ * the loopback hop.
+ */
+inline constexpr const char* PEER_HEADER = "X-Sdcpp-Peer";
+
+/**
+ * Set the per-process token peer_address() expects in PEER_HEADER.
+ * Called once at startup, before the server accepts connections; empty
+ * (default) means the header is never honored.
+ */
+void set_peer_header_token(const std::string& token);
+
+/**
+ * Address of the client that sent `req`: the PEER_HEADER address when it
+ * carries the front end's token (the front end strips any client-supplied
+ * copy), else `req.remote_addr`.
+ */
+std::string peer_address(const httplib::Request& req);
+
 /**
  * Compute the base URL (`scheme://host[:port]`) the client used to
  * reach the server, for use in response payloads.
  *
  * Honors `X-Forwarded-Proto` / `X-Forwarded-Host` only when
- * `req.remote_addr` is in `trusted_proxies`. Otherwise falls back to the
+ * `peer_address(req)` is in `trusted_proxies`. Otherwise falls back to the
  * literal `Host` header with `http://`. If even that's missing,
  * `"http://localhost"` is returned as a last-resort placeholder.
  */
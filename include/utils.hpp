@@ -4,6 +4,9 @@
 #include <vector>
 #include <cstdint>
 #include <chrono>
+#include <functional>
+
+struct evp_md_ctx_st;   // OpenSSL EVP_MD_CTX
 
 namespace sdcpp {
 namespace utils {
@@ -15,12 +18,43 @@ namespace utils {
 std::string generate_uuid();
 
 /**
- * Compute SHA256 hash of a file
+ * Incremental SHA256 (OpenSSL EVP), for hashing data as it streams past
+ */
+class Sha256 {
+public:
+    Sha256();
+    ~Sha256();
+
+    Sha256(const Sha256&) = delete;
+    Sha256& operator=(const Sha256&) = delete;
+
+    void update(const void* data, size_t len);
+
+    /**
+     * Finish and return the hex digest. The hasher is reset afterwards.
+     */
+    std::string hex_digest();
+
+    void reset();
+
+private:
+    evp_md_ctx_st* ctx_;
+};
+
+/**
+ * Progress callback for long hashes: bytes hashed so far, file size
+ */
+using HashProgressCallback = std::function<void(uint64_t done, uint64_t total)>;
+
+/**
+ * Compute SHA256 hash of a file. Reads sequentially in 4 MiB page-aligned
+ * blocks with POSIX_FADV_SEQUENTIAL readahead.
  * @param filepath Path to file
+ * @param progress Optional progress callback (called about every 64 MiB)
  * @return Hex-encoded SHA256 hash
  * @throws std::runtime_error if file cannot be read
  */
-std::string compute_sha256(const std::string& filepath);
+std::string compute_sha256(const std::string& filepath, const HashProgressCallback& progress = nullptr);
 
 /**
  * Base64 encode binary data
@@ -128,6 +162,19 @@ std::vector<std::string> list_files(
  */
 std::string sanitize_filename(const std::string& filename);
 
+/** Default edge length of the square gallery thumbnails served by /thumb/ */
+inline constexpr int THUMBNAIL_SIZE = 120;
+
+/**
+ * Cached thumbnail location for an output image: <dir>/.thumbs/<stem>.jpg
+ * for the default size, <dir>/.thumbs/<stem>.<size>.<ext> otherwise
+ * @param source_path Path to the full-size image
+ * @param size Edge length in px
+ * @param extension Thumbnail file extension without the dot
+ */
+std::string thumbnail_path(const std::string& source_path, int size = THUMBNAIL_SIZE,
+                           const std::string& extension = "jpg");
+
 /**
  * Check if file is a ZIP archive (by magic bytes)
  * @param filepath Path to file
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <optional>
+#include <cstdint>
+#include <cstddef>
+
+#include <nlohmann/json.hpp>
+#include "config.hpp"
+
+namespace sdcpp {
+
+/**
+ * Video file container for txt2vid outputs
+ */
+enum class VideoContainer {
+    Mp4,        // H.264 or AV1, AAC audio (FFmpeg)
+    Webm,       // VP9 or AV1, Opus audio (FFmpeg)
+    Avi         // Motion JPEG, no audio; built in, always available
+};
+
+/**
+ * Parse "mp4" / "webm" / "avi" (case-insensitive)
+ * @throws std::runtime_error on unknown names
+ */
+VideoContainer video_container_from_string(const std::string& name);
+
+/**
+ * Canonical name, which is also the file extension
+ */
+std::string video_container_to_string(VideoContainer container);
+
+/**
+ * Whether this build can write the container. AVI always can; MP4 and
+ * WebM need FFmpeg (libavformat/libavcodec) at build time.
+ */
+bool video_container_available(VideoContainer container);
+
+/**
+ * Encoder settings for one video
+ */
+struct VideoEncodeOptions {
+    VideoContainer container = VideoContainer::Avi;
+    std::string codec = "mjpeg";    // "h264", "vp9", "av1" or "mjpeg" (AVI)
+    int fps = 16;
+    int crf = 23;                   // Constant quality; MJPEG maps it to JPEG quality
+    bool hardware = true;           // Try NVENC / VideoToolbox before software encoders
+};
+
+/**
+ * Interleaved float PCM in [-1, 1], as produced by sd.cpp's audio VAE
+ */
+struct AudioTrack {
+    const float* samples = nullptr;
+    size_t sample_count = 0;        // Per channel
+    int channels = 0;
+    int sample_rate = 0;
+};
+
+/**
+ * Process-wide defaults (from the "video" config section)
+ */
+void set_default_video_config(const VideoConfig& config);
+
+/**
+ * Resolve per-request video settings on top of the server defaults
+ * @param format Requested container, "none", or empty for the default
+ * @param codec Requested codec; empty = container default
+ * @param fps Frame rate of the job
+ * @return nullopt when no video file should be written
+ * @throws std::runtime_error for unknown or unavailable containers/codecs
+ */
+std::optional<VideoEncodeOptions> resolve_video_options(const std::string& format,
+                                                        const std::string& codec, int fps);
+
+/**
+ * Server default for writing per-frame PNGs next to the video
+ */
+bool default_keep_frames();
+
+/**
+ * Streaming video file writer. Frames are encoded and written as they are
+ * added, so nothing but the current frame is buffered.
+ */
+class VideoWriter {
+public:
+    /**
+     * Create the file and pick an encoder. If `audio` is given and the
+     * container supports it, the track is muxed in (see muxed_audio()).
+     * @throws std::runtime_error if no encoder for the codec is available
+     */
+    static std::unique_ptr<VideoWriter> open(const std::string& path, int width, int height,
+                                             const VideoEncodeOptions& options,
+                                             const AudioTrack* audio = nullptr);
+
+    virtual ~VideoWriter() = default;
+
+    /**
+     * Encode one frame of the opened size (1, 3 or 4 channels)
+     * @throws std::runtime_error on encoder failure
+     */
+    virtual void add_frame(const uint8_t* pixels, int channels) = 0;
+
+    /**
+     * Flush the encoder and finalize the file. Must be called once after
+     * the last frame; a writer destroyed without it leaves a broken file.
+     */
+    virtual void finish() = 0;
+
+    /** Whether the audio track passed to open() is in the file */
+    virtual bool muxed_audio() const = 0;
+
+    /** Encoder actually used, e.g. "h264_nvenc", "libx264", "mjpeg" */
+    virtual const std::string& encoder() const = 0;
+};
+
+/**
+ * What this build can write: {"ffmpeg": "<libavcodec version>" or null,
+ * "containers": ["mp4", "webm", "avi"]}
+ */
+nlohmann::json video_encoder_backends();
+
+} // namespace sdcpp
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <algorithm>
+
+#include <nlohmann/json.hpp>
+
+namespace sdcpp {
+
+/**
+ * What the loaded model keeps on the GPU, as far as the estimator cares
+ */
+struct VramModelInfo {
+    std::string architecture;       // sd.cpp's version name ("SDXL", "Flux", ...)
+    uint64_t weight_bytes = 0;      // Model plus component files
+    bool flash_attn = true;         // Diffusion attention without the tokens² score matrix
+    bool vae_flash_attn = true;     // Same for the VAE mid-block attention
+    float max_vram_gib = 0.0f;      // Segmented offload budget (0 = weights fully resident)
+};
+
+/**
+ * Predicted VRAM of one generation job (see estimate_job_vram)
+ */
+struct VramEstimate {
+    uint64_t weights = 0;           // Resident weights, capped by max_vram
+    uint64_t diffusion = 0;         // Sampler compute buffer plus latents
+    uint64_t vae = 0;               // VAE decode (or img2img encode) compute buffer
+
+    // Sampling and VAE decode run one after the other
+    uint64_t compute() const { return std::max(diffusion, vae); }
+    uint64_t peak() const { return weights + compute(); }
+
+    nlohmann::json to_json() const;
+};
+
+/**
+ * Rough peak VRAM of a txt2img / img2img / txt2vid job: per-architecture
+ * compute-buffer sizes (scaled from sd.cpp's "compute buffer size" log
+ * lines) over the latent area, frames and hi-res fix target, an O(tokens²)
+ * attention term when flash attention is off, and the VAE working set over
+ * the full image or one tile when vae_tiling is on. batch_count only adds
+ * latents: sd.cpp samples the images of a batch one after another.
+ *
+ * Meant for admission decisions, so it errs high rather than low.
+ */
+VramEstimate estimate_job_vram(const nlohmann::json& params, bool video, const VramModelInfo& model);
+
+} // namespace sdcpp
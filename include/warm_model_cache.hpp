@@ -0,0 +1,89 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+#include <cstdint>
+
+#include <nlohmann/json.hpp>
+
+namespace sdcpp {
+
+/**
+ * Host-RAM LRU of recently loaded model files.
+ *
+ * sd.cpp offers no way to park a built sd_ctx_t off-device and re-attach it,
+ * and keeping several contexts alive would hold their VRAM. What dominates a
+ * switch back to a recent 12 GB checkpoint is re-reading it from disk, so
+ * this cache keeps the component files themselves resident: each retained
+ * file is mmap'd read-only (MADV_WILLNEED), optionally mlock'd when `pin` is
+ * set, and kept mapped until evicted under the RAM budget. A later
+ * new_sd_ctx() on the same files then parses from page cache instead of disk.
+ *
+ * Hit/miss is counted per model load: a load is a hit when every component
+ * file was resident. Thread-safe; has its own mutex so /health and /memory
+ * never wait on the context mutex.
+ */
+class WarmModelCache {
+public:
+    WarmModelCache(uint64_t budget_bytes, bool pin);
+    ~WarmModelCache();
+
+    WarmModelCache(const WarmModelCache&) = delete;
+    WarmModelCache& operator=(const WarmModelCache&) = delete;
+
+    bool enabled() const { return budget_bytes_ > 0; }
+
+    /**
+     * Record a model load over `paths`. Counts a hit when all are resident
+     * and refreshes their LRU position.
+     * @return true on hit
+     */
+    bool lookup(const std::vector<std::string>& paths);
+
+    /**
+     * Keep `paths` resident after a successful load, evicting least recently
+     * used files to stay within budget. Files larger than the whole budget
+     * are skipped.
+     */
+    void retain(const std::vector<std::string>& paths);
+
+    /**
+     * Unmap everything (e.g. before a RAM-hungry conversion)
+     */
+    void clear();
+
+    /**
+     * Stats for /health and /memory: budget, used, entries, hits, misses,
+     * evictions
+     */
+    nlohmann::json stats_json() const;
+
+private:
+    struct Entry {
+        std::string path;
+        void* addr = nullptr;
+        uint64_t size = 0;
+        bool pinned = false;
+    };
+
+    bool map_locked(const std::string& path, Entry& out);
+    void unmap(Entry& e);
+    void evict_until_locked(uint64_t needed);
+
+    uint64_t budget_bytes_;
+    bool pin_;
+
+    mutable std::mutex mutex_;
+    std::list<Entry> lru_;      // front = most recently used
+    std::unordered_map<std::string, std::list<Entry>::iterator> index_;
+    uint64_t used_bytes_ = 0;
+
+    uint64_t hits_ = 0;
+    uint64_t misses_ = 0;
+    uint64_t evictions_ = 0;
+};
+
+} // namespace sdcpp
@@ -6,11 +6,16 @@
 #include <vector>
 #include <chrono>
 #include <functional>
+#include <memory>
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
 #include <nlohmann/json.hpp>
 
 // Forward declare httplib types
 namespace httplib {
 class Server;
+struct Request;
 }
 
 namespace sdcpp {
@@ -66,7 +71,17 @@ struct ClientConnection;
  * Uses cpp-httplib's built-in WebSocket support (v0.33+).
  * Runs on the same port as HTTP via server.WebSocket("/ws", handler).
  * Each client connection runs in its own thread (httplib's thread pool).
- * Thread-safe broadcasting via per-client send mutexes.
+ * broadcast() never sends inline: it serializes the event once into a
+ * shared buffer and appends a reference to the bounded outbox (drop-oldest,
+ * progress/preview first) of every client subscribed to the event's topic
+ * and job; a per-client sender thread drains it, so the caller never waits
+ * on a slow client.
+ *
+ * With the event-loop front end (server.event_loop), /ws never reaches
+ * httplib: the front end owns the socket and drives the client through
+ * open_client() / client_message() / next_message() / close_client(), with
+ * no thread per connection. Subscriptions, outbox and drop policy are the
+ * same for both kinds of client.
  */
 class WebSocketServer {
 public:
@@ -120,18 +135,72 @@ public:
 
     /**
      * Broadcast an event to all connected clients
-     * Thread-safe - can be called from any thread
+     * Thread-safe - can be called from any thread; only queues the message
      * @param type Event type
      * @param data Event data as JSON
      */
     void broadcast(WSEventType type, const nlohmann::json& data);
 
+    /**
+     * Broadcast a job_preview. Clients that subscribed with
+     * `binary_previews: true` get a binary frame (fixed header + JPEG bytes,
+     * see docs/API.md), everyone else the JSON event with `preview_url`.
+     * @param data job_preview event data (job_id, step, frame_count, width, height, is_noisy, preview_url)
+     * @param jpeg Encoded preview image
+     */
+    void broadcast_preview(const nlohmann::json& data,
+                           const std::shared_ptr<const std::vector<uint8_t>>& jpeg);
+
+    /**
+     * Whether any client would receive job_preview events for `job_id`
+     * (progress topic, and the job in its job_ids or no job filter)
+     */
+    bool wants_previews(const std::string& job_id) const;
+
     /**
      * Get the number of connected clients
      * @return Number of connected clients
      */
     size_t get_client_count() const { return client_count_.load(); }
 
+    /**
+     * Messages evicted from full client outboxes since startup
+     */
+    static uint64_t dropped_messages_total();
+
+    /**
+     * Authenticate a /ws handshake: ?token=, Authorization: Bearer, or the
+     * sdcpp_auth cookie
+     * @return Username ("" when auth is disabled), or nullopt if rejected
+     */
+    std::optional<std::string> authenticate(const httplib::Request& req) const;
+
+    /**
+     * Register a client whose socket is owned by the event-loop front end.
+     * The current server status is queued as its first message.
+     * @param handshake The upgrade request (for authentication)
+     * @param wake Called, from any thread, whenever a message is queued
+     * @return Client id, or nullopt if the handshake isn't authenticated
+     */
+    std::optional<size_t> open_client(const httplib::Request& handshake, std::function<void()> wake);
+
+    /**
+     * Handle a text message from a front-end client; any reply is queued.
+     * Must be called from the thread that calls close_client().
+     */
+    void client_message(size_t id, const std::string& text);
+
+    /**
+     * Pop the next queued message for a front-end client
+     * @return false if there is none
+     */
+    bool next_message(size_t id, std::shared_ptr<const std::string>& payload, bool& binary);
+
+    /**
+     * Unregister a front-end client
+     */
+    void close_client(size_t id);
+
 private:
     /**
      * Handle a new WebSocket connection (runs in httplib's thread per connection)
@@ -140,6 +209,16 @@ private:
      */
     void handle_connection(void* ws, const std::string& username);
 
+    /**
+     * Reply to a client message (ping, get_status, subscribe); "" if none
+     */
+    std::string reply_to(ClientConnection& client, const std::string& text);
+
+    /**
+     * server_status event for a new client; "" without a status provider
+     */
+    static std::string status_message();
+
     /**
      * Convert event type to string for JSON serialization
      */
@@ -160,6 +239,7 @@ private:
     // Client registry
     mutable std::mutex clients_mutex_;
     std::vector<ClientConnection*> clients_;
+    std::unordered_map<size_t, std::unique_ptr<ClientConnection>> front_end_clients_;  // Owned; also in clients_
     std::atomic<size_t> client_count_{0};
     size_t next_client_id_{0};
 
@@ -218,6 +298,10 @@ nlohmann::json get_server_status();
 #ifndef SDCPP_WEBSOCKET_ENABLED
 inline WebSocketServer* get_websocket_server() { return nullptr; }
 inline void WebSocketServer::broadcast(WSEventType, const nlohmann::json&) {}
+inline void WebSocketServer::broadcast_preview(const nlohmann::json&,
+                                               const std::shared_ptr<const std::vector<uint8_t>>&) {}
+inline uint64_t WebSocketServer::dropped_messages_total() { return 0; }
+inline bool WebSocketServer::wants_previews(const std::string&) const { return false; }
 #endif
 
 } // namespace sdcpp
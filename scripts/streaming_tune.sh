@@ -167,16 +167,17 @@ run_one_gen() {
     job_id=$(echo "$resp" | jq -r '.job_id')
     [[ -z "$job_id" || "$job_id" == "null" ]] && return 1
 
-    local waited=0 max=900
+    # Long-poll: the server holds each request until the job finishes or
+    # queue.max_wait_seconds pass, whichever is first
+    local waited=0 max=900 step=60
     while (( waited < max )); do
         local s
-        s=$(curl -fsS "${API_URL}/queue/${job_id}" | jq -r '.status // "unknown"')
+        s=$(curl -fsS "${API_URL}/queue/${job_id}/wait?timeout=${step}" | jq -r '.status // "unknown"')
         case "$s" in
             completed) echo "$job_id"; return 0 ;;
-            failed|cancelled) return 1 ;;
+            failed|cancelled|unknown) return 1 ;;
         esac
-        sleep 1
-        waited=$((waited+1))
+        waited=$((waited+step))
     done
     return 1
 }
@@ -1,4 +1,8 @@
 #include "api_registry.hpp"
+#include "file_server.hpp"
+#include "metrics.hpp"
+#include "job_trace.hpp"
+#include <chrono>
 #include <regex>
 #include <iostream>
 
@@ -44,9 +48,32 @@ std::vector<std::string> ApiRegistry::extract_path_params(const std::string& pat
     return params;
 }
 
+namespace {
+
+// Handler time and status code per registered route. The histogram series
+// is resolved once here; the response counter needs the code, so it's
+// looked up per request (a shared-lock map find). With queue.trace_jobs on,
+// a job the handler submits also gets the handler as a trace span.
+template<typename Handler>
+auto timed(const std::string& method, const std::string& path, Handler handler) {
+    auto& latency = metrics::registry().http_request_duration.with({method, path});
+    return [&latency, method, path, handler = std::move(handler)](const httplib::Request& req,
+                                                                   httplib::Response& res,
+                                                                   auto&&... rest) {
+        const auto t0 = std::chrono::steady_clock::now();
+        JobTrace::RequestScope trace_scope(method, path);
+        handler(req, res, rest...);
+        latency.observe(std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count());
+        metrics::registry().http_responses.inc({method, path, std::to_string(res.status > 0 ? res.status : 200)});
+    };
+}
+
+} // namespace
+
 void ApiRegistry::register_route(httplib::Server& server, const std::string& method,
-                                  const std::string& pattern,
-                                  std::function<void(const httplib::Request&, httplib::Response&)> handler) {
+                                  const std::string& path, const std::string& pattern,
+                                  std::function<void(const httplib::Request&, httplib::Response&)> raw_handler) {
+    std::function<void(const httplib::Request&, httplib::Response&)> handler = timed(method, path, std::move(raw_handler));
     if (method == "GET") {
         server.Get(pattern, handler);
     } else if (method == "POST") {
@@ -62,6 +89,23 @@ void ApiRegistry::register_route(httplib::Server& server, const std::string& met
     }
 }
 
+void ApiRegistry::register_streaming_route(httplib::Server& server, const std::string& method,
+                                           const std::string& path, const std::string& pattern,
+                                           ContentReaderHandler raw_handler) {
+    ContentReaderHandler handler = timed(method, path, std::move(raw_handler));
+    if (method == "POST") {
+        server.Post(pattern, handler);
+    } else if (method == "PUT") {
+        server.Put(pattern, handler);
+    } else if (method == "PATCH") {
+        server.Patch(pattern, handler);
+    } else if (method == "DELETE") {
+        server.Delete(pattern, handler);
+    } else {
+        std::cerr << "[ApiRegistry] Method " << method << " can't stream a request body: " << pattern << std::endl;
+    }
+}
+
 EndpointBuilder ApiRegistry::addEndpointRaw(
     httplib::Server& server,
     const std::string& method,
@@ -80,7 +124,7 @@ EndpointBuilder ApiRegistry::addEndpointRaw(
     entry.tag = tag;
     entry.response_code = response_code;
 
-    register_route(server, method, httplib_pattern, handler);
+    register_route(server, method, path, httplib_pattern, handler);
 
     endpoints_.push_back(entry);
     return EndpointBuilder(endpoints_.back());
@@ -251,9 +295,11 @@ nlohmann::json ApiRegistry::generateOpenApiSpec() const {
 }
 
 void ApiRegistry::serveOpenApiSpec(httplib::Server& server, const std::string& path) {
-    server.Get(path, [this](const httplib::Request& /*req*/, httplib::Response& res) {
-        auto spec = generateOpenApiSpec();
-        res.set_content(spec.dump(2), "application/json");
+    server.Get(path, [this](const httplib::Request& req, httplib::Response& res) {
+        std::call_once(spec_once_, [this] {
+            spec_ = std::make_shared<const CachedDocument>(generateOpenApiSpec().dump(2), "application/json");
+        });
+        spec_->serve(req, res);
     });
 }
 
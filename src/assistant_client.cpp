@@ -10,7 +10,9 @@
 #include <sstream>
 #include <filesystem>
 #include <algorithm>
+#include <cstring>
 #include <regex>
+#include <string_view>
 #include <thread>
 #include <chrono>
 
@@ -170,6 +172,91 @@ RetryResult post_with_retry(
     return rr;
 }
 
+// Name and parameters of each tool call in an Ollama chat message.
+// Arguments arrive as an object or as a JSON-encoded string.
+std::vector<std::pair<std::string, nlohmann::json>> parse_tool_calls(const nlohmann::json& message) {
+    std::vector<std::pair<std::string, nlohmann::json>> calls;
+    for (const auto& tool_call : message["tool_calls"]) {
+        if (!tool_call.contains("function")) continue;
+
+        const auto& func = tool_call["function"];
+        std::string tool_name = func.value("name", "");
+        if (tool_name.empty()) continue;
+
+        nlohmann::json params = nlohmann::json::object();
+        if (func.contains("arguments")) {
+            if (func["arguments"].is_string()) {
+                try {
+                    params = nlohmann::json::parse(func["arguments"].get<std::string>());
+                } catch (...) {
+                    params = nlohmann::json::object();
+                }
+            } else if (func["arguments"].is_object()) {
+                params = func["arguments"];
+            }
+        }
+        calls.emplace_back(std::move(tool_name), std::move(params));
+    }
+    return calls;
+}
+
+// Incremental line splitter for the streamed chat response. Ollama sends
+// NDJSON; OpenAI-style gateways send SSE ("data: {...}", blank lines,
+// ": keepalive" comments, "data: [DONE]"), so both are accepted. Complete
+// lines are handed to `on_line` as views into the received chunk - only a
+// line that straddles a chunk boundary is copied, into partial_.
+class StreamLineParser {
+public:
+    template<typename OnLine>
+    bool feed(const char* data, size_t length, OnLine&& on_line) {
+        size_t start = 0;
+        while (start < length) {
+            const void* nl = std::memchr(data + start, '\n', length - start);
+            if (!nl) {
+                partial_.append(data + start, length - start);
+                return true;
+            }
+            const size_t end = static_cast<size_t>(static_cast<const char*>(nl) - data);
+            bool ok;
+            if (partial_.empty()) {
+                ok = emit(std::string_view(data + start, end - start), on_line);
+            } else {
+                partial_.append(data + start, end - start);
+                ok = emit(partial_, on_line);
+                partial_.clear();
+            }
+            if (!ok) return false;
+            start = end + 1;
+        }
+        return true;
+    }
+
+    // A last line the server didn't terminate
+    template<typename OnLine>
+    bool finish(OnLine&& on_line) {
+        std::string line;
+        line.swap(partial_);
+        return line.empty() || emit(line, on_line);
+    }
+
+    void reset() { partial_.clear(); }
+
+private:
+    template<typename OnLine>
+    static bool emit(std::string_view line, OnLine& on_line) {
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        if (line.substr(0, 5) == "data:") {
+            line.remove_prefix(line.size() > 5 && line[5] == ' ' ? 6 : 5);
+        } else if (!line.empty() && line.front() != '{') {
+            return true;    // SSE comment or event:/id:/retry: field
+        }
+        if (line.empty() || line == "[DONE]") return true;
+        return on_line(line);
+    }
+
+    std::string partial_;
+};
+
 } // anonymous namespace
 
 // ConversationMessage JSON serialization
@@ -326,6 +413,50 @@ AssistantClient::~AssistantClient() {
     // History is saved after each modification
 }
 
+std::vector<nlohmann::json> AssistantClient::execute_backend_tools(
+    const std::vector<std::pair<std::string, nlohmann::json>>& calls) {
+    std::vector<std::pair<std::string, nlohmann::json>> backend;
+    for (const auto& call : calls) {
+        if (tool_executor_ && tool_executor_->is_backend_tool(call.first)) {
+            std::cout << "[AssistantClient] Executing backend tool: " << call.first << std::endl;
+            backend.push_back(call);
+        }
+    }
+    if (backend.empty()) return {};
+    return tool_executor_->execute_all(backend);
+}
+
+AssistantClient::ClientLease AssistantClient::acquire_client(const std::string& host, int port,
+                                                             int timeout_seconds) {
+    const std::string key = host + ":" + std::to_string(port);
+    std::unique_ptr<httplib::Client> client;
+    {
+        std::lock_guard<std::mutex> lock(client_pool_mutex_);
+        auto it = client_pool_.find(key);
+        if (it != client_pool_.end() && !it->second.empty()) {
+            client = std::move(it->second.back());
+            it->second.pop_back();
+        }
+    }
+    if (client) {
+        connections_reused_++;
+    } else {
+        client = std::make_unique<httplib::Client>(host, port);
+        client->set_keep_alive(true);
+        connections_opened_++;
+    }
+    client->set_connection_timeout(timeout_seconds);
+    client->set_read_timeout(timeout_seconds);
+    client->set_write_timeout(timeout_seconds);
+
+    return ClientLease(client.release(), [this, key](httplib::Client* c) {
+        std::unique_ptr<httplib::Client> owned(c);
+        std::lock_guard<std::mutex> lock(client_pool_mutex_);
+        auto& idle = client_pool_[key];
+        if (idle.size() < MAX_IDLE_CLIENTS) idle.push_back(std::move(owned));
+    });
+}
+
 bool AssistantClient::parse_url(const std::string& url, std::string& host, int& port,
                                  std::string& path, bool& is_ssl) {
     std::regex url_regex(R"(^(https?)://([^:/]+)(?::(\d+))?(/.*)?$)", std::regex::icase);
@@ -1011,11 +1142,8 @@ AssistantResponse AssistantClient::chat(const std::string& user_message,
         return response;
     }
 
-    // Create HTTP client
-    httplib::Client client(host, port);
-    client.set_connection_timeout(config_.timeout_seconds);
-    client.set_read_timeout(config_.timeout_seconds);
-    client.set_write_timeout(config_.timeout_seconds);
+    // Pooled keep-alive connection, reused by every tool-loop iteration
+    auto client = acquire_client(host, port, config_.timeout_seconds);
 
     // Prepare headers
     httplib::Headers headers;
@@ -1052,7 +1180,7 @@ AssistantResponse AssistantClient::chat(const std::string& user_message,
         std::cout << "[AssistantClient] Sending chat request (iteration " << iteration + 1
                   << ") to " << config_.endpoint << "/api/chat" << std::endl;
 
-        auto rr = post_with_retry(client, "/api/chat", headers,
+        auto rr = post_with_retry(*client, "/api/chat", headers,
                                    request_body.dump(), "application/json");
 
         if (!rr.outcome.ok) {
@@ -1112,29 +1240,14 @@ AssistantResponse AssistantClient::chat(const std::string& user_message,
         // Add assistant message with tool_calls to conversation
         messages.push_back(message);
 
-        // Process each tool call
-        bool executed_backend_tool = false;
-        for (const auto& tool_call : message["tool_calls"]) {
-            if (!tool_call.contains("function")) continue;
-
-            const auto& func = tool_call["function"];
-            std::string tool_name = func.value("name", "");
-            if (tool_name.empty()) continue;
-
-            // Parse arguments
-            nlohmann::json params = nlohmann::json::object();
-            if (func.contains("arguments")) {
-                if (func["arguments"].is_string()) {
-                    try {
-                        params = nlohmann::json::parse(func["arguments"].get<std::string>());
-                    } catch (...) {
-                        params = nlohmann::json::object();
-                    }
-                } else if (func["arguments"].is_object()) {
-                    params = func["arguments"];
-                }
-            }
+        // The turn's backend tools run together, then every call is
+        // processed in the order the model made them
+        auto calls = parse_tool_calls(message);
+        auto backend_results = execute_backend_tools(calls);
+        size_t next_result = 0;
 
+        bool executed_backend_tool = false;
+        for (const auto& [tool_name, params] : calls) {
             total_tool_calls++;
 
             // Track tool call info
@@ -1144,9 +1257,7 @@ AssistantResponse AssistantClient::chat(const std::string& user_message,
 
             // Check if this is a backend tool
             if (tool_executor_ && tool_executor_->is_backend_tool(tool_name)) {
-                // Execute on backend
-                std::cout << "[AssistantClient] Executing backend tool: " << tool_name << std::endl;
-                nlohmann::json result = tool_executor_->execute(tool_name, params);
+                nlohmann::json result = std::move(backend_results[next_result++]);
 
                 // Store result in tool call info
                 tc_info.result = result.dump();
@@ -1306,11 +1417,8 @@ bool AssistantClient::chat_stream(
         return false;
     }
 
-    // Create HTTP client (same as chat() method)
-    httplib::Client client(host, port);
-    client.set_connection_timeout(config_.timeout_seconds);
-    client.set_read_timeout(config_.timeout_seconds);
-    client.set_write_timeout(config_.timeout_seconds);
+    // Pooled keep-alive connection (same as chat() method)
+    auto client = acquire_client(host, port, config_.timeout_seconds);
 
     httplib::Headers headers;
     if (!config_.api_key.empty()) {
@@ -1344,7 +1452,7 @@ bool AssistantClient::chat_stream(
 
         std::cout << "[AssistantClient] Stream: tool iteration " << iteration + 1 << std::endl;
 
-        auto rr = post_with_retry(client, "/api/chat", headers,
+        auto rr = post_with_retry(*client, "/api/chat", headers,
                                    request_body.dump(), "application/json");
         if (!rr.outcome.ok) {
             std::cerr << "[AssistantClient] Stream: tool POST failed after "
@@ -1401,33 +1509,19 @@ bool AssistantClient::chat_stream(
         // Add assistant message with tool_calls to conversation
         messages.push_back(message);
 
-        // Process tool calls
-        bool executed_backend_tool = false;
-        for (const auto& tool_call : message["tool_calls"]) {
-            if (!tool_call.contains("function")) continue;
-
-            const auto& func = tool_call["function"];
-            std::string tool_name = func.value("name", "");
-            if (tool_name.empty()) continue;
-
-            nlohmann::json params = nlohmann::json::object();
-            if (func.contains("arguments")) {
-                if (func["arguments"].is_string()) {
-                    try {
-                        params = nlohmann::json::parse(func["arguments"].get<std::string>());
-                    } catch (...) {}
-                } else if (func["arguments"].is_object()) {
-                    params = func["arguments"];
-                }
-            }
+        // Backend tools of this turn run together (see chat())
+        auto calls = parse_tool_calls(message);
+        auto backend_results = execute_backend_tools(calls);
+        size_t next_result = 0;
 
+        bool executed_backend_tool = false;
+        for (const auto& [tool_name, params] : calls) {
             ToolCallInfo tc_info;
             tc_info.name = tool_name;
             tc_info.parameters = params;
 
             if (tool_executor_ && tool_executor_->is_backend_tool(tool_name)) {
-                std::cout << "[AssistantClient] Stream: executing backend tool: " << tool_name << std::endl;
-                nlohmann::json result = tool_executor_->execute(tool_name, params);
+                nlohmann::json result = std::move(backend_results[next_result++]);
 
                 tc_info.result = result.dump();
                 tc_info.executed_on_backend = true;
@@ -1512,72 +1606,69 @@ bool AssistantClient::chat_stream(
     LlmAttemptOutcome stream_outcome;
     int stream_attempts = 0;
 
+    StreamLineParser parser;
+    bool had_emitted = false;  // any thinking/content delivered to caller?
+
+    // One NDJSON object (or SSE data payload), parsed in place
+    auto handle_line = [&](std::string_view line) -> bool {
+        try {
+            auto json = nlohmann::json::parse(line.begin(), line.end());
+
+            if (json.contains("message")) {
+                const auto& msg = json["message"];
+
+                // Check for thinking content (ensure it's a non-empty string)
+                if (msg.contains("thinking") && msg["thinking"].is_string()) {
+                    const auto& thinking = msg["thinking"].get_ref<const std::string&>();
+                    if (!thinking.empty()) {
+                        accumulated_thinking += thinking;
+                        had_emitted = true;
+                        std::cout << "[AssistantClient] Stream: emitting thinking chunk (" << thinking.size() << " bytes)" << std::endl;
+                        if (!callback("thinking", {{"content", thinking}})) {
+                            std::cerr << "[AssistantClient] Stream: callback failed for thinking" << std::endl;
+                            return false;
+                        }
+                    }
+                }
+
+                // Check for regular content (ensure it's a non-empty string)
+                if (msg.contains("content") && msg["content"].is_string()) {
+                    const auto& content = msg["content"].get_ref<const std::string&>();
+                    if (!content.empty()) {
+                        accumulated_content += content;
+                        had_emitted = true;
+                        std::cout << "[AssistantClient] Stream: emitting content chunk (" << content.size() << " bytes)" << std::endl;
+                        if (!callback("content", {{"content", content}})) {
+                            std::cerr << "[AssistantClient] Stream: callback failed for content" << std::endl;
+                            return false;
+                        }
+                    }
+                }
+            }
+        } catch (const nlohmann::json::exception& e) {
+            // Skip malformed lines
+            std::cerr << "[AssistantClient] Stream: JSON parse error on line: " << line << " - " << e.what() << std::endl;
+        }
+        return true;
+    };
+
     for (int attempt = 1; attempt <= kStreamMaxAttempts; ++attempt) {
         stream_attempts = attempt;
-        bool had_emitted = false;  // any thinking/content delivered to caller?
+        had_emitted = false;
+        parser.reset();
 
-        stream_res = client.Post(
+        // Ollama returns NDJSON; a JSON line can be split across chunks,
+        // which the parser holds until its newline arrives
+        stream_res = client->Post(
             "/api/chat",
             headers,
             stream_request.dump(),
             "application/json",
             [&](const char* data, size_t data_length) {
-                std::string chunk(data, data_length);
-
-                // Ollama returns NDJSON - multiple JSON objects separated by newlines
-                std::istringstream stream(chunk);
-                std::string line;
-                while (std::getline(stream, line)) {
-                    if (line.empty()) continue;
-
-                    try {
-                        auto json = nlohmann::json::parse(line);
-
-                        if (json.contains("message")) {
-                            const auto& msg = json["message"];
-
-                            // Check for thinking content (ensure it's a non-empty string)
-                            if (msg.contains("thinking") && msg["thinking"].is_string()) {
-                                std::string thinking = msg["thinking"].get<std::string>();
-                                if (!thinking.empty()) {
-                                    accumulated_thinking += thinking;
-                                    had_emitted = true;
-                                    std::cout << "[AssistantClient] Stream: emitting thinking chunk (" << thinking.size() << " bytes)" << std::endl;
-                                    if (!callback("thinking", {{"content", thinking}})) {
-                                        std::cerr << "[AssistantClient] Stream: callback failed for thinking" << std::endl;
-                                        return false;
-                                    }
-                                }
-                            }
-
-                            // Check for regular content (ensure it's a non-empty string)
-                            if (msg.contains("content") && msg["content"].is_string()) {
-                                std::string content = msg["content"].get<std::string>();
-                                if (!content.empty()) {
-                                    accumulated_content += content;
-                                    had_emitted = true;
-                                    std::cout << "[AssistantClient] Stream: emitting content chunk (" << content.size() << " bytes)" << std::endl;
-                                    if (!callback("content", {{"content", content}})) {
-                                        std::cerr << "[AssistantClient] Stream: callback failed for content" << std::endl;
-                                        return false;
-                                    }
-                                }
-                            }
-                        }
-
-                        // Check if done
-                        if (json.value("done", false)) {
-                            // Done streaming
-                            return true;
-                        }
-                    } catch (const nlohmann::json::exception& e) {
-                        // Skip malformed lines
-                        std::cerr << "[AssistantClient] Stream: JSON parse error on line: " << line << " - " << e.what() << std::endl;
-                    }
-                }
-                return true;
+                return parser.feed(data, data_length, handle_line);
             }
         );
+        if (stream_res && stream_res->status == 200) parser.finish(handle_line);
 
         stream_outcome = classify_attempt(stream_res);
         if (stream_outcome.ok) break;
@@ -1692,11 +1783,8 @@ bool AssistantClient::test_connection() {
         return false;
     }
 
-    httplib::Client client(host, port);
-    client.set_connection_timeout(5);
-    client.set_read_timeout(5);
-
-    auto res = client.Get("/api/tags");
+    auto client = acquire_client(host, port, 5);
+    auto res = client->Get("/api/tags");
     return res && res->status == 200;
 }
 
@@ -1715,16 +1803,14 @@ std::vector<std::string> AssistantClient::get_available_models() {
         return models;
     }
 
-    httplib::Client client(host, port);
-    client.set_connection_timeout(config_.timeout_seconds);
-    client.set_read_timeout(config_.timeout_seconds);
+    auto client = acquire_client(host, port, config_.timeout_seconds);
 
     httplib::Headers headers;
     if (!config_.api_key.empty()) {
         headers.emplace("Authorization", "Bearer " + config_.api_key);
     }
 
-    auto res = client.Get("/api/tags", headers);
+    auto res = client->Get("/api/tags", headers);
 
     if (res && res->status == 200) {
         try {
@@ -1755,7 +1841,11 @@ nlohmann::json AssistantClient::get_status() const {
         {"endpoint", config_.endpoint},
         {"model", config_.model},
         {"available_models", models},
-        {"proactive_suggestions", config_.proactive_suggestions}
+        {"proactive_suggestions", config_.proactive_suggestions},
+        {"connections", {
+            {"opened", connections_opened_.load()},
+            {"reused", connections_reused_.load()}
+        }}
     };
 }
 
@@ -1858,10 +1948,7 @@ ModelCapabilities AssistantClient::get_model_info(const std::string& model_name)
         return caps;
     }
 
-    // Create HTTP client
-    httplib::Client client(host, port);
-    client.set_connection_timeout(10);  // Short timeout for info endpoint
-    client.set_read_timeout(10);
+    auto client = acquire_client(host, port, 10);  // Short timeout for info endpoint
 
     // Prepare headers
     httplib::Headers headers;
@@ -1872,7 +1959,7 @@ ModelCapabilities AssistantClient::get_model_info(const std::string& model_name)
 
     // POST to /api/show
     nlohmann::json request_body = {{"name", target_model}};
-    auto res = client.Post("/api/show", headers, request_body.dump(), "application/json");
+    auto res = client->Post("/api/show", headers, request_body.dump(), "application/json");
 
     if (!res) {
         std::cerr << "[AssistantClient] get_model_info: failed to connect" << std::endl;
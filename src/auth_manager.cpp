@@ -51,6 +51,52 @@ std::string env_or_empty(const char* name) {
     return std::string();
 }
 
+// Byte trie over the public paths: a lookup is one pass over the request
+// path, with no hashing, allocation or per-prefix compares
+class PathTrie {
+public:
+    void add(std::string_view path, bool is_prefix) {
+        size_t node = 0;
+        for (char c : path) {
+            size_t next = child(node, c);
+            if (next == 0) {
+                next = nodes_.size();
+                nodes_.emplace_back();
+                nodes_[node].next.emplace_back(c, next);
+            }
+            node = next;
+        }
+        (is_prefix ? nodes_[node].prefix : nodes_[node].exact) = true;
+    }
+
+    bool match(std::string_view path) const {
+        size_t node = 0;
+        for (char c : path) {
+            if (nodes_[node].prefix) return true;
+            node = child(node, c);
+            if (node == 0) return false;
+        }
+        return nodes_[node].exact || nodes_[node].prefix;
+    }
+
+private:
+    struct Node {
+        std::vector<std::pair<char, size_t>> next;
+        bool exact = false;
+        bool prefix = false;     // Everything below matches too
+    };
+
+    // 0 (the root, never a child) when there is none
+    size_t child(size_t node, char c) const {
+        for (const auto& [ch, idx] : nodes_[node].next) {
+            if (ch == c) return idx;
+        }
+        return 0;
+    }
+
+    std::vector<Node> nodes_{1};
+};
+
 } // namespace
 
 AuthManager::AuthManager(const Config& config)
@@ -90,6 +136,25 @@ AuthManager::AuthManager(const Config& config)
 
     std::cout << "[Auth] Authentication enabled (user='" << username_
               << "', token TTL=" << token_ttl_minutes_ << " min)" << std::endl;
+
+    expiry_thread_ = std::thread(&AuthManager::expiry_loop, this);
+}
+
+AuthManager::~AuthManager() {
+    {
+        std::lock_guard<std::mutex> lock(expiry_mutex_);
+        stopping_ = true;
+    }
+    expiry_cv_.notify_all();
+    if (expiry_thread_.joinable()) expiry_thread_.join();
+}
+
+AuthManager::TokenShard& AuthManager::shard_for(const std::string& token) {
+    return shards_[std::hash<std::string>{}(token) % TOKEN_SHARDS];
+}
+
+const AuthManager::TokenShard& AuthManager::shard_for(const std::string& token) const {
+    return shards_[std::hash<std::string>{}(token) % TOKEN_SHARDS];
 }
 
 bool AuthManager::secure_compare(const std::string& a, const std::string& b) {
@@ -135,18 +200,22 @@ std::string AuthManager::issue_token(const std::string& username) {
     auto now = std::chrono::steady_clock::now();
     auto expires = now + std::chrono::minutes(token_ttl_minutes_);
 
-    std::unique_lock<std::shared_mutex> lock(tokens_mutex_);
-    cleanup_expired_locked();
-
     // Retry if (astronomically unlikely) collision occurs.
     std::string token;
     for (int i = 0; i < 5; ++i) {
         token = generate_token();
-        if (tokens_.find(token) == tokens_.end()) {
+        auto& shard = shard_for(token);
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        if (shard.tokens.emplace(token, TokenEntry{username, expires}).second) {
             break;
         }
     }
-    tokens_[token] = TokenEntry{username, expires};
+
+    {
+        std::lock_guard<std::mutex> lock(expiry_mutex_);
+        expiry_queue_.emplace_back(expires, token);
+    }
+    expiry_cv_.notify_one();
     return token;
 }
 
@@ -156,46 +225,56 @@ std::optional<std::string> AuthManager::verify_token(const std::string& token) c
     }
     auto now = std::chrono::steady_clock::now();
 
-    // Fast path under shared lock — read-only check.
-    {
-        std::shared_lock<std::shared_mutex> lock(tokens_mutex_);
-        auto it = tokens_.find(token);
-        if (it == tokens_.end()) {
-            return std::nullopt;
-        }
-        if (it->second.expires_at > now) {
-            return it->second.username;
-        }
-    }
-
-    // Expired — upgrade to exclusive to evict.
-    std::unique_lock<std::shared_mutex> lock(tokens_mutex_);
-    auto it = tokens_.find(token);
-    if (it != tokens_.end() && it->second.expires_at <= now) {
-        tokens_.erase(it);
+    const auto& shard = shard_for(token);
+    std::shared_lock<std::shared_mutex> lock(shard.mutex);
+    auto it = shard.tokens.find(token);
+    if (it == shard.tokens.end() || it->second.expires_at <= now) {
+        return std::nullopt;
     }
-    return std::nullopt;
+    return it->second.username;
 }
 
 void AuthManager::revoke_token(const std::string& token) {
-    std::unique_lock<std::shared_mutex> lock(tokens_mutex_);
-    tokens_.erase(token);
+    auto& shard = shard_for(token);
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    shard.tokens.erase(token);
 }
 
-void AuthManager::cleanup_expired_locked() const {
-    auto now = std::chrono::steady_clock::now();
-    for (auto it = tokens_.begin(); it != tokens_.end(); ) {
-        if (it->second.expires_at <= now) {
-            it = tokens_.erase(it);
-        } else {
-            ++it;
+void AuthManager::expiry_loop() {
+    std::unique_lock<std::mutex> lock(expiry_mutex_);
+    while (!stopping_) {
+        if (expiry_queue_.empty()) {
+            expiry_cv_.wait(lock, [&] { return stopping_ || !expiry_queue_.empty(); });
+            continue;
+        }
+        // New tokens expire later than the front one: only stop() wakes us early
+        const auto due = expiry_queue_.front().first;
+        if (expiry_cv_.wait_until(lock, due, [&] { return stopping_; })) break;
+
+        const auto now = std::chrono::steady_clock::now();
+        std::vector<std::string> expired;
+        while (!expiry_queue_.empty() && expiry_queue_.front().first <= now) {
+            expired.push_back(std::move(expiry_queue_.front().second));
+            expiry_queue_.pop_front();
         }
+        lock.unlock();
+        for (const auto& token : expired) {
+            auto& shard = shard_for(token);
+            std::unique_lock<std::shared_mutex> slock(shard.mutex);
+            auto it = shard.tokens.find(token);
+            if (it != shard.tokens.end() && it->second.expires_at <= now) {
+                shard.tokens.erase(it);
+            }
+        }
+        lock.lock();
     }
 }
 
 const std::unordered_set<std::string>& AuthManager::always_allowed_exact_paths() {
     static const std::unordered_set<std::string> paths = {
         "/health",
+        "/health/live",
+        "/health/ready",
         "/auth/login",
         "/openapi.json",
         "/",
@@ -214,6 +293,12 @@ const std::unordered_set<std::string>& AuthManager::always_allowed_exact_paths()
         // in the project repo + /docs.
         "/options/descriptions",
         "/options/generation",
+        // The login page and what it references
+        "/login",
+        "/login.css",
+        "/login.html",
+        "/favicon.ico",
+        "/favicon.svg",
     };
     return paths;
 }
@@ -233,18 +318,14 @@ const std::vector<std::string>& AuthManager::always_allowed_path_prefixes() {
     return prefixes;
 }
 
-bool AuthManager::is_always_allowed(const std::string& path) {
-    const auto& exact = always_allowed_exact_paths();
-    if (exact.find(path) != exact.end()) {
-        return true;
-    }
-    const auto& prefixes = always_allowed_path_prefixes();
-    for (const auto& p : prefixes) {
-        if (path.size() >= p.size() && path.compare(0, p.size(), p) == 0) {
-            return true;
-        }
-    }
-    return false;
+bool AuthManager::is_always_allowed(std::string_view path) {
+    static const PathTrie trie = [] {
+        PathTrie t;
+        for (const auto& p : always_allowed_exact_paths()) t.add(p, false);
+        for (const auto& p : always_allowed_path_prefixes()) t.add(p, true);
+        return t;
+    }();
+    return trie.match(path);
 }
 
 } // namespace sdcpp
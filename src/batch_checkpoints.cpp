@@ -0,0 +1,52 @@
+#include "batch_checkpoints.hpp"
+
+#include <algorithm>
+
+namespace sdcpp {
+
+std::string BatchCheckpoints::key(const std::string& model, int width, int height) {
+    return model + "@" + std::to_string(width) + "x" + std::to_string(height);
+}
+
+int BatchCheckpoints::next_call(int remaining, double per_image_seconds, double interval_seconds) {
+    if (remaining <= 1 || per_image_seconds <= 0.0 || per_image_seconds * remaining <= interval_seconds) {
+        return std::max(remaining, 0);
+    }
+    return std::clamp(static_cast<int>(interval_seconds / per_image_seconds), 1, remaining);
+}
+
+int BatchCheckpoints::resume_point(const std::vector<std::string>& outputs, int recorded,
+                                   const std::function<bool(const std::string&)>& exists) {
+    const size_t limit = std::min(outputs.size(), static_cast<size_t>(std::max(recorded, 0)));
+    size_t on_disk = 0;
+    while (on_disk < limit && exists(outputs[on_disk])) ++on_disk;
+    return static_cast<int>(on_disk);
+}
+
+double BatchCheckpoints::seconds_per_step(const std::string& key) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = seconds_per_step_.find(key);
+    return it != seconds_per_step_.end() ? it->second : 0.0;
+}
+
+void BatchCheckpoints::record(const std::string& key, double seconds, int images, int steps) {
+    if (images <= 0 || steps <= 0 || seconds <= 0.0) return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    seconds_per_step_[key] = seconds / (static_cast<double>(images) * steps);
+    recorded_at_[key] = ++sequence_;
+    if (seconds_per_step_.size() <= MAX_KEYS) return;
+
+    auto oldest = std::min_element(recorded_at_.begin(), recorded_at_.end(),
+                                   [](const auto& a, const auto& b) { return a.second < b.second; });
+    seconds_per_step_.erase(oldest->first);
+    recorded_at_.erase(oldest);
+}
+
+nlohmann::json BatchCheckpoints::stats_json() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    nlohmann::json out = nlohmann::json::object();
+    for (const auto& [k, v] : seconds_per_step_) out[k] = v;
+    return out;
+}
+
+} // namespace sdcpp
@@ -0,0 +1,413 @@
+/**
+ * sdcpp-bench - In-process benchmark harness
+ *
+ * Runs a matrix of model loads and txt2img settings through the same
+ * ModelManager / QueueManager / SDWrapper code the server uses, without
+ * HTTP, and reports per-phase p50/p95 (from the job's metadata.timings),
+ * peak VRAM/RSS and throughput. The result file keys every case by a
+ * stable id so two runs (e.g. two commits) can be compared with --baseline.
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <cmath>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include <filesystem>
+#include <unistd.h>
+
+#include <nlohmann/json.hpp>
+
+#include "config.hpp"
+#include "model_manager.hpp"
+#include "queue_manager.hpp"
+#include "memory_utils.hpp"
+#include "lora_cache.hpp"
+#include "job_timings.hpp"
+#include "job_trace.hpp"
+#include "sd_error_capture.hpp"
+#include "utils.hpp"
+#include "version.hpp"
+#include "stable-diffusion.h"
+
+#include <curl/curl.h>
+
+namespace fs = std::filesystem;
+using json = nlohmann::json;
+
+namespace {
+
+// Same feeds as the server's callback; only warnings and errors are printed
+void bench_log_callback(sd_log_level_t level, const char* text, void* /*data*/) {
+    std::string msg(text);
+    while (!msg.empty() && (msg.back() == '\n' || msg.back() == '\r')) {
+        msg.pop_back();
+    }
+    if (level == SD_LOG_ERROR) {
+        sdcpp::capture_sd_error(msg);
+    }
+    if (level == SD_LOG_INFO) {
+        sdcpp::LoraCache::note_sd_log(msg);
+        sdcpp::JobTimings::note_sd_log(msg);
+    }
+    if (level >= SD_LOG_WARN) {
+        std::cerr << "[SD:" << (level == SD_LOG_ERROR ? "ERROR" : "WARN") << "] " << msg << std::endl;
+    }
+}
+
+struct Args {
+    std::string config_path;
+    std::string matrix_path;
+    std::string output_path;
+    std::string baseline_path;
+    std::string work_dir;
+    bool keep_outputs = false;
+};
+
+void print_usage(const char* prog) {
+    std::cout << "Usage: " << prog << " -c <config.json> -m <matrix.json> [options]\n\n"
+              << "Options:\n"
+              << "  -c, --config <path>     Server configuration (model paths, model_cache, ...)\n"
+              << "  -m, --matrix <path>     Benchmark matrix (see benchmark_results/matrix.example.json)\n"
+              << "  -o, --output <path>     Result file (default: benchmark_results/bench_<timestamp>.json)\n"
+              << "  -b, --baseline <path>   Earlier result file to compare against\n"
+              << "      --work-dir <path>   Queue state and outputs (default: a temporary directory)\n"
+              << "      --keep-outputs      Do not delete the work directory afterwards\n"
+              << "  -h, --help              Show this help\n";
+}
+
+Args parse_args(int argc, char* argv[]) {
+    Args args;
+    auto value = [&](int& i, const std::string& flag) -> std::string {
+        if (i + 1 >= argc) {
+            std::cerr << "Error: " << flag << " requires a path argument\n";
+            std::exit(1);
+        }
+        return argv[++i];
+    };
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-h" || arg == "--help") { print_usage(argv[0]); std::exit(0); }
+        else if (arg == "-c" || arg == "--config") args.config_path = value(i, arg);
+        else if (arg == "-m" || arg == "--matrix") args.matrix_path = value(i, arg);
+        else if (arg == "-o" || arg == "--output") args.output_path = value(i, arg);
+        else if (arg == "-b" || arg == "--baseline") args.baseline_path = value(i, arg);
+        else if (arg == "--work-dir") args.work_dir = value(i, arg);
+        else if (arg == "--keep-outputs") args.keep_outputs = true;
+        else {
+            std::cerr << "Error: Unknown option: " << arg << "\n";
+            print_usage(argv[0]);
+            std::exit(1);
+        }
+    }
+    if (args.config_path.empty() || args.matrix_path.empty()) {
+        print_usage(argv[0]);
+        std::exit(1);
+    }
+    return args;
+}
+
+json read_json_file(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) throw std::runtime_error("Cannot open " + path);
+    return json::parse(in);
+}
+
+// Nearest-rank percentile of an unsorted sample
+double percentile(std::vector<double> v, double p) {
+    if (v.empty()) return 0.0;
+    std::sort(v.begin(), v.end());
+    size_t rank = static_cast<size_t>(std::ceil(p * static_cast<double>(v.size())));
+    return v[std::min(v.size(), std::max<size_t>(rank, 1)) - 1];
+}
+
+json summarize(const std::vector<double>& v) {
+    if (v.empty()) return json::object();
+    return {
+        {"p50", percentile(v, 0.50)},
+        {"p95", percentile(v, 0.95)},
+        {"min", *std::min_element(v.begin(), v.end())},
+        {"max", *std::max_element(v.begin(), v.end())}
+    };
+}
+
+// A matrix axis: the listed values, or a single default
+json axis(const json& matrix, const char* key, const json& fallback) {
+    if (matrix.contains(key) && matrix[key].is_array() && !matrix[key].empty()) return matrix[key];
+    return json::array({fallback});
+}
+
+std::string load_label(const json& model, const json& options, const std::string& weight_type) {
+    std::string label = model.value("model_name", "?");
+    for (auto it = options.begin(); it != options.end(); ++it) {
+        label += " " + it.key() + "=" + (it->is_string() ? it->get<std::string>() : it->dump());
+    }
+    if (!weight_type.empty()) label += " weight_type=" + weight_type;
+    return label;
+}
+
+struct Run {
+    bool ok = false;
+    std::string error;
+    json timings;
+};
+
+// Submit one txt2img job to the queue and wait for its final status
+Run run_job(sdcpp::QueueManager& queue, const json& params, int timeout_s) {
+    Run run;
+    auto submitted = queue.submit_job(sdcpp::GenerationType::Text2Image, params, "sdcpp-bench", false);
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(timeout_s);
+    while (true) {
+        auto job = queue.get_job(submitted.job_id);
+        if (!job) {
+            run.error = "job disappeared";
+            return run;
+        }
+        if (job->status == sdcpp::QueueStatus::Completed) {
+            run.ok = true;
+            run.timings = job->metadata.value("timings", json::object());
+            return run;
+        }
+        if (job->status == sdcpp::QueueStatus::Failed || job->status == sdcpp::QueueStatus::Cancelled) {
+            run.error = job->error_message.empty() ? sdcpp::queue_status_to_string(job->status)
+                                                   : job->error_message;
+            return run;
+        }
+        if (std::chrono::steady_clock::now() > deadline) {
+            queue.cancel_job(submitted.job_id);
+            run.error = "timed out after " + std::to_string(timeout_s) + "s";
+            return run;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+}
+
+// p50/p95 of run time, of each phase (summed per run) and the memory peaks
+json summarize_runs(const std::vector<Run>& runs, int batch) {
+    std::vector<double> run_ms, vram, rss;
+    std::map<std::string, std::vector<double>> phase_ms;
+    for (const auto& r : runs) {
+        run_ms.push_back(r.timings.value("run_ms", 0.0));
+        vram.push_back(r.timings.value("peak_vram_bytes", 0.0));
+        rss.push_back(r.timings.value("peak_rss_bytes", 0.0));
+        std::map<std::string, double> per_run;
+        for (const auto& p : r.timings.value("phases", json::array())) {
+            per_run[p.value("name", "")] += p.value("ms", 0.0);
+        }
+        for (const auto& [name, ms] : per_run) phase_ms[name].push_back(ms);
+    }
+
+    json phases = json::object();
+    for (const auto& [name, v] : phase_ms) phases[name] = summarize(v);
+
+    const double p50 = percentile(run_ms, 0.50);
+    json out = {
+        {"runs", runs.size()},
+        {"run_ms", summarize(run_ms)},
+        {"phases", phases},
+        {"peak_vram_bytes", *std::max_element(vram.begin(), vram.end())},
+        {"peak_rss_bytes", *std::max_element(rss.begin(), rss.end())},
+        {"images_per_minute", p50 > 0 ? batch * 60000.0 / p50 : 0.0}
+    };
+    return out;
+}
+
+void print_case(const json& c) {
+    std::cout << std::left << std::setw(64) << c["id"].get<std::string>().substr(0, 63) << " ";
+    if (c["status"] != "ok") {
+        std::cout << c["status"].get<std::string>() << ": " << c.value("error", "") << std::endl;
+        return;
+    }
+    std::cout << std::right << std::fixed << std::setprecision(0)
+              << std::setw(8) << c["run_ms"]["p50"].get<double>() << " "
+              << std::setw(8) << c["run_ms"]["p95"].get<double>() << " "
+              << std::setw(8) << c["peak_vram_bytes"].get<double>() / (1024.0 * 1024.0) << " "
+              << std::setprecision(2) << std::setw(8) << c["images_per_minute"].get<double>()
+              << std::endl;
+}
+
+// Per-case p50 change against an earlier result file, matched by id
+void compare(const json& results, const json& baseline) {
+    std::map<std::string, json> before;
+    for (const auto& c : baseline.value("cases", json::array())) before[c.value("id", "")] = c;
+
+    std::cout << "\nCompared with " << baseline.value("git_commit", "?")
+              << " (" << baseline.value("started_at", "?") << "):\n";
+    for (const auto& c : results["cases"]) {
+        auto it = before.find(c["id"].get<std::string>());
+        if (it == before.end() || c["status"] != "ok" || it->second.value("status", "") != "ok") continue;
+        const double old_ms = it->second["run_ms"].value("p50", 0.0);
+        const double new_ms = c["run_ms"].value("p50", 0.0);
+        if (old_ms <= 0) continue;
+        std::cout << std::left << std::setw(64) << c["id"].get<std::string>().substr(0, 63) << " "
+                  << std::right << std::fixed << std::setprecision(0)
+                  << std::setw(8) << old_ms << " -> " << std::setw(8) << new_ms << " ms  "
+                  << std::showpos << std::setprecision(1) << (new_ms - old_ms) * 100.0 / old_ms
+                  << std::noshowpos << "%" << std::endl;
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Args args = parse_args(argc, argv);
+
+    if (curl_global_init(CURL_GLOBAL_DEFAULT) != 0) {
+        std::cerr << "Warning: curl_global_init failed" << std::endl;
+    }
+
+    bool temp_work_dir = args.work_dir.empty();
+    if (temp_work_dir) {
+        args.work_dir = (fs::temp_directory_path() / ("sdcpp-bench-" + std::to_string(getpid()))).string();
+    }
+
+    int exit_code = 0;
+    try {
+        sd_set_log_callback(bench_log_callback, nullptr);
+
+        sdcpp::Config config = sdcpp::Config::load(args.config_path);
+        config.validate();
+        const json matrix = read_json_file(args.matrix_path);
+
+        const int warmup = matrix.value("warmup", 1);
+        const int repetitions = std::max(1, matrix.value("repetitions", 5));
+        const int timeout_s = matrix.value("timeout_s", 1800);
+        const json generation = matrix.value("generation", json{{"prompt", "a cat"}, {"seed", 42}});
+        if (!matrix.contains("models") || !matrix["models"].is_array() || matrix["models"].empty()) {
+            throw std::runtime_error("matrix.models must list at least one /models/load body");
+        }
+
+        fs::create_directories(args.work_dir);
+
+        sdcpp::ModelManager model_manager(config);
+        model_manager.scan_models();
+
+        // Its own queue state and outputs so the server's queue is never touched
+        sdcpp::JobTrace::set_enabled(config.queue.trace_jobs);
+        sdcpp::RecycleBinConfig recycle_bin;
+        recycle_bin.enabled = false;
+        sdcpp::QueueManager queue(model_manager, args.work_dir,
+                                  (fs::path(args.work_dir) / "queue_state.json").string(),
+                                  recycle_bin, config.queue);
+        queue.start();
+
+        const sdcpp::MemoryInfo host = sdcpp::get_memory_info();
+        json results = {
+            {"version", sdcpp::get_version()},
+            {"git_commit", sdcpp::get_git_commit()},
+            {"started_at", sdcpp::utils::get_timestamp()},
+            {"host", {
+                {"gpu_name", host.gpu_available ? host.gpu_name : ""},
+                {"gpu_total_bytes", host.gpu_total},
+                {"system_total_bytes", host.system_total}
+            }},
+            {"matrix", matrix},
+            {"cases", json::array()}
+        };
+
+        std::cout << std::left << std::setw(64) << "case" << " "
+                  << std::right << std::setw(8) << "p50 ms" << " " << std::setw(8) << "p95 ms" << " "
+                  << std::setw(8) << "VRAM MB" << " " << std::setw(8) << "img/min" << std::endl;
+
+        for (const auto& model : matrix["models"]) {
+            for (const auto& options : axis(matrix, "load_options", json::object())) {
+                for (const auto& wt : axis(matrix, "weight_types", "")) {
+                    const std::string weight_type = wt.get<std::string>();
+                    json body = model;
+                    body["options"] = model.value("options", json::object());
+                    body["options"].update(options);
+                    if (!weight_type.empty()) body["options"]["weight_type"] = weight_type;
+                    const std::string label = load_label(model, options, weight_type);
+
+                    // Every load starts cold so load_ms is comparable
+                    json load_case = {{"load", body}};
+                    std::string load_error;
+                    try {
+                        model_manager.unload_model();
+                        auto t0 = std::chrono::steady_clock::now();
+                        if (!model_manager.load_model(sdcpp::ModelLoadParams::from_json(body))) {
+                            load_error = "load_model returned false";
+                        }
+                        load_case["load_ms"] = std::chrono::duration_cast<std::chrono::milliseconds>(
+                            std::chrono::steady_clock::now() - t0).count();
+                    } catch (const std::exception& e) {
+                        load_error = e.what();
+                    }
+
+                    for (const auto& res : axis(matrix, "resolutions", json::array({1024, 1024}))) {
+                        for (const auto& steps : axis(matrix, "steps", 20)) {
+                            for (const auto& batch : axis(matrix, "batch_sizes", 1)) {
+                                json params = generation;
+                                params["width"] = res.at(0);
+                                params["height"] = res.at(1);
+                                params["steps"] = steps;
+                                params["batch_count"] = batch;
+
+                                json c = load_case;
+                                c["id"] = label + " " + res.at(0).dump() + "x" + res.at(1).dump() +
+                                          " steps=" + steps.dump() + " batch=" + batch.dump();
+                                c["params"] = params;
+
+                                if (!load_error.empty()) {
+                                    c["status"] = "load_failed";
+                                    c["error"] = load_error;
+                                } else {
+                                    std::vector<Run> runs;
+                                    std::string error;
+                                    for (int i = 0; i < warmup + repetitions && error.empty(); ++i) {
+                                        Run r = run_job(queue, params, timeout_s);
+                                        if (!r.ok) error = r.error;
+                                        else if (i >= warmup) runs.push_back(std::move(r));
+                                    }
+                                    if (!error.empty()) {
+                                        c["status"] = "failed";
+                                        c["error"] = error;
+                                    } else {
+                                        c["status"] = "ok";
+                                        c.update(summarize_runs(runs, batch.get<int>()));
+                                    }
+                                }
+                                print_case(c);
+                                results["cases"].push_back(std::move(c));
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        queue.stop();
+        model_manager.unload_model();
+
+        if (args.output_path.empty()) {
+            std::string stamp = sdcpp::utils::get_timestamp();
+            std::replace(stamp.begin(), stamp.end(), ':', '-');
+            args.output_path = "benchmark_results/bench_" + stamp + ".json";
+        }
+        fs::path out_path(args.output_path);
+        if (out_path.has_parent_path()) fs::create_directories(out_path.parent_path());
+        std::ofstream out(out_path);
+        out << results.dump(2) << std::endl;
+        std::cout << "\nResults written to " << out_path.string() << std::endl;
+
+        if (!args.baseline_path.empty()) {
+            compare(results, read_json_file(args.baseline_path));
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        exit_code = 1;
+    }
+
+    if (temp_work_dir && !args.keep_outputs) {
+        std::error_code ec;
+        fs::remove_all(args.work_dir, ec);
+    }
+    curl_global_cleanup();
+    return exit_code;
+}
@@ -0,0 +1,461 @@
+#include "cluster_coordinator.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+#include <httplib.h>
+
+namespace sdcpp {
+
+namespace {
+
+// Params the coordinator adds that a node's strict validator would refuse
+const char* const COORDINATOR_ONLY_KEYS[] = {
+    "model", "variation_group_id", "variation_index", "variation_total", "variation_template",
+};
+
+std::string base_url(const std::string& url) {
+    std::string u = url;
+    while (!u.empty() && u.back() == '/') u.pop_back();
+    return u;
+}
+
+// Model names compare by file stem, so "sdxl/juggernaut.safetensors"
+// matches "juggernaut"
+std::string model_stem(const std::string& name) {
+    return std::filesystem::path(name).stem().string();
+}
+
+int json_int(const nlohmann::json& j, const char* key) {
+    auto it = j.find(key);
+    return (it != j.end() && it->is_number()) ? it->get<int>() : 0;
+}
+
+int header_int(const httplib::Result& res, const char* key) {
+    try {
+        return res->has_header(key) ? std::stoi(res->get_header_value(key)) : 0;
+    } catch (...) {
+        return 0;
+    }
+}
+
+} // namespace
+
+ClusterCoordinator::ClusterCoordinator(const ClusterConfig& config) : config_(config) {
+    for (const auto& node_config : config_.nodes) {
+        Node node;
+        node.config = node_config;
+        node.config.url = base_url(node_config.url);
+        if (node.config.name.empty()) node.config.name = node.config.url;
+        nodes_.push_back(std::move(node));
+    }
+}
+
+ClusterCoordinator::~ClusterCoordinator() {
+    stop();
+}
+
+int ClusterCoordinator::slot_count() const {
+    int slots = 0;
+    for (const auto& node : nodes_) slots += node.config.max_jobs;
+    return slots;
+}
+
+void ClusterCoordinator::start() {
+    if (!enabled() || running_) return;
+    running_ = true;
+    poll_all();
+    poller_ = std::thread(&ClusterCoordinator::poller_thread, this);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& node : nodes_) {
+        std::cout << "[Cluster] Node " << node.config.name << " (" << node.config.url << "): "
+                  << (node.healthy ? (node.model_loaded ? "up, model " + node.model_name : std::string("up, no model"))
+                                   : "down (" + node.last_error + ")")
+                  << " | max_jobs=" << node.config.max_jobs << std::endl;
+    }
+}
+
+void ClusterCoordinator::stop() {
+    if (!running_) return;
+    {
+        std::lock_guard<std::mutex> lock(poller_mutex_);
+        running_ = false;
+    }
+    poller_cv_.notify_all();
+    if (poller_.joinable()) poller_.join();
+}
+
+const std::string& ClusterCoordinator::node_label(int index) const {
+    // config is fixed after construction
+    return nodes_[static_cast<size_t>(index)].config.name;
+}
+
+bool ClusterCoordinator::model_matches(const std::string& loaded, const std::string& wanted) {
+    if (wanted.empty()) return true;
+    return loaded == wanted || model_stem(loaded) == model_stem(wanted);
+}
+
+int ClusterCoordinator::acquire(const std::string& model, const std::string& affinity_key) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    int best = -1;
+    auto better = [&](const Node& a, const Node& b) {
+        const bool a_affine = !affinity_key.empty() && a.last_affinity == affinity_key;
+        const bool b_affine = !affinity_key.empty() && b.last_affinity == affinity_key;
+        if (a_affine != b_affine) return a_affine;
+        // The node's own queue lags a poll behind our dispatches
+        const int a_load = std::max(a.queued, a.in_flight);
+        const int b_load = std::max(b.queued, b.in_flight);
+        if (a_load != b_load) return a_load < b_load;
+        return a.gpu_free > b.gpu_free;
+    };
+    for (size_t i = 0; i < nodes_.size(); ++i) {
+        const Node& n = nodes_[i];
+        if (!n.healthy || !n.model_loaded || n.model_loading) continue;
+        if (n.in_flight >= n.config.max_jobs) continue;
+        if (!model_matches(n.model_name, model)) continue;
+        if (best < 0 || better(n, nodes_[static_cast<size_t>(best)])) best = static_cast<int>(i);
+    }
+    if (best >= 0) {
+        Node& n = nodes_[static_cast<size_t>(best)];
+        n.in_flight++;
+        n.dispatched++;
+        n.last_affinity = affinity_key;
+    }
+    return best;
+}
+
+void ClusterCoordinator::release(int node, bool success) {
+    if (node < 0 || node >= static_cast<int>(nodes_.size())) return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    Node& n = nodes_[static_cast<size_t>(node)];
+    n.in_flight = std::max(0, n.in_flight - 1);
+    if (!success) n.failed++;
+}
+
+bool ClusterCoordinator::serves(const std::string& model) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& n : nodes_) {
+        if (n.healthy && n.model_loaded && model_matches(n.model_name, model)) return true;
+    }
+    return false;
+}
+
+bool ClusterCoordinator::login(int index) {
+    const ClusterNodeConfig& nc = nodes_[static_cast<size_t>(index)].config;
+    if (nc.username.empty()) return false;
+
+    httplib::Client client(nc.url);
+    client.set_connection_timeout(config_.timeout_seconds);
+    client.set_read_timeout(config_.timeout_seconds);
+    const nlohmann::json body = {{"username", nc.username}, {"password", nc.password}};
+    auto res = client.Post("/auth/login", body.dump(), "application/json");
+    if (!res || res->status != 200) {
+        std::cerr << "[Cluster] Login to node " << nc.name << " failed"
+                  << (res ? " (HTTP " + std::to_string(res->status) + ")" : "") << std::endl;
+        return false;
+    }
+    try {
+        auto j = nlohmann::json::parse(res->body);
+        std::lock_guard<std::mutex> lock(mutex_);
+        nodes_[static_cast<size_t>(index)].token = j.value("token", "");
+    } catch (const std::exception&) {
+        return false;
+    }
+    return true;
+}
+
+ClusterCoordinator::Response ClusterCoordinator::request(int index, const std::string& method,
+                                                         const std::string& path, const std::string& body) {
+    const ClusterNodeConfig& nc = nodes_[static_cast<size_t>(index)].config;
+    Response out;
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        httplib::Headers headers;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            const std::string& token = nodes_[static_cast<size_t>(index)].token;
+            if (!token.empty()) headers.emplace("Authorization", "Bearer " + token);
+        }
+
+        httplib::Client client(nc.url);
+        client.set_connection_timeout(config_.timeout_seconds);
+        client.set_read_timeout(config_.timeout_seconds);
+        client.set_write_timeout(config_.timeout_seconds);
+        auto res = method == "POST" ? client.Post(path, headers, body, "application/json")
+                                    : client.Get(path, headers);
+        if (!res) {
+            out.status = 0;
+            out.error = httplib::to_string(res.error());
+            return out;
+        }
+        out.status = res->status;
+        out.body = res->body;
+        out.content_type = res->get_header_value("Content-Type");
+        out.width = header_int(res, "X-Preview-Width");
+        out.height = header_int(res, "X-Preview-Height");
+        out.step = header_int(res, "X-Preview-Step");
+        if (res->status != 401 || attempt > 0 || !login(index)) break;
+    }
+    if (out.status >= 400) {
+        out.error = "HTTP " + std::to_string(out.status);
+        try {
+            auto j = nlohmann::json::parse(out.body);
+            if (j.contains("error") && j["error"].is_string()) out.error += ": " + j["error"].get<std::string>();
+        } catch (...) {
+        }
+    }
+    return out;
+}
+
+bool ClusterCoordinator::download(int index, const std::string& path, const std::string& local_path,
+                                  std::string& error) {
+    const ClusterNodeConfig& nc = nodes_[static_cast<size_t>(index)].config;
+    httplib::Headers headers;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const std::string& token = nodes_[static_cast<size_t>(index)].token;
+        if (!token.empty()) headers.emplace("Authorization", "Bearer " + token);
+    }
+
+    std::filesystem::create_directories(std::filesystem::path(local_path).parent_path());
+    const std::string tmp_path = local_path + ".part";
+    std::ofstream file(tmp_path, std::ios::binary);
+    if (!file) {
+        error = "cannot write " + tmp_path;
+        return false;
+    }
+
+    httplib::Client client(nc.url);
+    client.set_connection_timeout(config_.timeout_seconds);
+    client.set_read_timeout(config_.timeout_seconds);
+    auto res = client.Get(path, headers, [&](const char* data, size_t len) {
+        file.write(data, static_cast<std::streamsize>(len));
+        return static_cast<bool>(file);
+    });
+    file.close();
+
+    std::error_code ec;
+    if (!res || res->status != 200 || !file) {
+        error = !res ? httplib::to_string(res.error()) : "HTTP " + std::to_string(res->status);
+        std::filesystem::remove(tmp_path, ec);
+        return false;
+    }
+    std::filesystem::rename(tmp_path, local_path, ec);
+    if (ec) {
+        error = ec.message();
+        return false;
+    }
+    return true;
+}
+
+ClusterCoordinator::Poll ClusterCoordinator::poll_node(int index) {
+    Poll poll;
+    Response health = request(index, "GET", "/health");
+    if (health.status != 200) {
+        poll.error = health.error.empty() ? "HTTP " + std::to_string(health.status) : health.error;
+        return poll;
+    }
+    Response queue = request(index, "GET", "/queue?limit=1");
+    try {
+        poll.health = nlohmann::json::parse(health.body);
+        if (queue.status == 200) {
+            auto q = nlohmann::json::parse(queue.body);
+            poll.queued = json_int(q, "pending_count") + json_int(q, "processing_count");
+        }
+        poll.ok = true;
+    } catch (const std::exception& e) {
+        poll.error = std::string("bad /health response: ") + e.what();
+    }
+    return poll;
+}
+
+void ClusterCoordinator::poll_all() {
+    // Outside mutex_: a slow node must not stall acquire()
+    std::vector<Poll> polls;
+    for (size_t i = 0; i < nodes_.size(); ++i) polls.push_back(poll_node(static_cast<int>(i)));
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < nodes_.size(); ++i) {
+        Node& n = nodes_[i];
+        const Poll& p = polls[i];
+        const bool was_healthy = n.healthy;
+        n.healthy = p.ok;
+        if (!p.ok) {
+            n.last_error = p.error;
+            if (was_healthy) {
+                std::cerr << "[Cluster] Node " << n.config.name << " down: " << p.error << std::endl;
+            }
+            continue;
+        }
+        const auto& h = p.health;
+        const std::string previous_model = n.model_name;
+        n.model_loaded = h.value("model_loaded", false);
+        n.model_loading = h.value("model_loading", false);
+        n.model_name = h.contains("model_name") && h["model_name"].is_string() ? h["model_name"].get<std::string>() : "";
+        n.model_architecture = h.contains("model_architecture") && h["model_architecture"].is_string()
+            ? h["model_architecture"].get<std::string>() : "";
+        const auto gpu = h.contains("memory") ? h["memory"].value("gpu", nlohmann::json::object()) : nlohmann::json::object();
+        n.gpu_available = gpu.value("available", false);
+        n.gpu_free = gpu.value("free_bytes", uint64_t{0});
+        n.gpu_total = gpu.value("total_bytes", uint64_t{0});
+        n.queued = p.queued;
+        n.last_error.clear();
+        n.last_seen = std::chrono::steady_clock::now();
+        if (!was_healthy || previous_model != n.model_name) {
+            std::cout << "[Cluster] Node " << n.config.name << " up"
+                      << (n.model_loaded ? " | model=" + n.model_name : std::string(" | no model loaded"))
+                      << " | queued=" << n.queued << std::endl;
+        }
+    }
+}
+
+void ClusterCoordinator::poller_thread() {
+    while (running_) {
+        {
+            std::unique_lock<std::mutex> lock(poller_mutex_);
+            poller_cv_.wait_for(lock, health_interval(), [this] { return !running_; });
+        }
+        if (!running_) break;
+        poll_all();
+    }
+}
+
+std::vector<std::string> ClusterCoordinator::run_job(int node, const std::string& endpoint,
+                                                     const nlohmann::json& params,
+                                                     const std::string& output_dir, const std::string& subpath,
+                                                     const JobHooks& hooks) {
+    const std::string& name = node_label(node);
+
+    nlohmann::json body = params;
+    for (const char* key : COORDINATOR_ONLY_KEYS) body.erase(key);
+    // What the coordinator queued is what runs: never attach to an older job
+    body["dedup"] = false;
+
+    Response submitted = request(node, "POST", endpoint, body.dump());
+    std::string remote_id;
+    if (submitted.status == 200 || submitted.status == 202) {
+        try {
+            remote_id = nlohmann::json::parse(submitted.body).value("job_id", "");
+        } catch (...) {
+        }
+    }
+    if (remote_id.empty()) {
+        throw std::runtime_error("Node " + name + ": submit failed (" +
+                                 (submitted.error.empty() ? "no job_id in response" : submitted.error) + ")");
+    }
+    if (hooks.on_submitted) {
+        hooks.on_submitted({{"name", name}, {"url", nodes_[static_cast<size_t>(node)].config.url},
+                            {"job_id", remote_id}});
+    }
+
+    // Follow the job. Progress and previews come from the node's REST API,
+    // relayed through the hooks into the coordinator's own WebSocket events.
+    const auto poll_interval = std::chrono::milliseconds(config_.job_poll_ms);
+    const auto contact_timeout = std::chrono::seconds(config_.timeout_seconds);
+    auto last_contact = std::chrono::steady_clock::now();
+    int last_step = -1;
+    int last_preview_step = -1;
+    nlohmann::json job;
+    while (true) {
+        std::this_thread::sleep_for(poll_interval);
+        Response r = request(node, "GET", "/queue/" + remote_id);
+        if (r.status != 200) {
+            if (r.status == 404) throw std::runtime_error("Node " + name + ": job " + remote_id + " disappeared");
+            if (std::chrono::steady_clock::now() - last_contact > contact_timeout) {
+                throw std::runtime_error("Node " + name + ": lost contact while running job " + remote_id +
+                                         " (" + r.error + ")");
+            }
+            continue;
+        }
+        last_contact = std::chrono::steady_clock::now();
+        try {
+            job = nlohmann::json::parse(r.body);
+        } catch (const std::exception&) {
+            continue;
+        }
+
+        const std::string status = job.value("status", "");
+        if (status == "completed") break;
+        if (status == "failed" || status == "cancelled" || status == "deleted") {
+            throw std::runtime_error("Node " + name + ": " +
+                                     (job.contains("error") && job["error"].is_string()
+                                          ? job["error"].get<std::string>() : "job " + status));
+        }
+
+        const auto progress = job.value("progress", nlohmann::json::object());
+        const int step = json_int(progress, "step");
+        if (step != last_step) {
+            last_step = step;
+            if (hooks.on_progress) hooks.on_progress(step, json_int(progress, "total_steps"));
+            if (hooks.on_preview && status == "processing") {
+                Response preview = request(node, "GET", "/jobs/" + remote_id + "/preview");
+                if (preview.status == 200 && !preview.body.empty() && preview.step != last_preview_step) {
+                    last_preview_step = preview.step;
+                    hooks.on_preview(preview.step,
+                                     std::vector<uint8_t>(preview.body.begin(), preview.body.end()),
+                                     preview.width, preview.height);
+                }
+            }
+        }
+    }
+
+    // Outputs are "<subpath on the node>/<file>"; keep what follows the
+    // node's job id so multi-file layouts survive
+    std::vector<std::string> outputs;
+    for (const auto& remote : job.value("outputs", std::vector<std::string>{})) {
+        const std::string marker = remote_id + "/";
+        const size_t pos = remote.find(marker);
+        const std::string rel = pos != std::string::npos
+            ? remote.substr(pos + marker.size())
+            : std::filesystem::path(remote).filename().string();
+        if (rel.empty() || rel.find("..") != std::string::npos) continue;
+
+        const std::string local = subpath + "/" + rel;
+        std::string error;
+        if (!download(node, "/output/" + remote, (std::filesystem::path(output_dir) / local).string(), error)) {
+            throw std::runtime_error("Node " + name + ": downloading " + remote + " failed (" + error + ")");
+        }
+        outputs.push_back(local);
+    }
+    if (outputs.empty()) {
+        throw std::runtime_error("Node " + name + ": job " + remote_id + " completed without outputs");
+    }
+    return outputs;
+}
+
+nlohmann::json ClusterCoordinator::status_json() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto now = std::chrono::steady_clock::now();
+    nlohmann::json nodes = nlohmann::json::array();
+    for (const auto& n : nodes_) {
+        nlohmann::json j = {
+            {"name", n.config.name},
+            {"url", n.config.url},
+            {"healthy", n.healthy},
+            {"model_loaded", n.model_loaded},
+            {"model_loading", n.model_loading},
+            {"model_name", n.model_name},
+            {"model_architecture", n.model_architecture},
+            {"gpu", {{"available", n.gpu_available}, {"free_bytes", n.gpu_free}, {"total_bytes", n.gpu_total}}},
+            {"queued", n.queued},
+            {"in_flight", n.in_flight},
+            {"max_jobs", n.config.max_jobs},
+            {"dispatched", n.dispatched},
+            {"failed", n.failed},
+            {"last_seen_ms_ago", n.last_seen.time_since_epoch().count() == 0 ? nlohmann::json(nullptr)
+                : nlohmann::json(std::chrono::duration_cast<std::chrono::milliseconds>(now - n.last_seen).count())}
+        };
+        if (!n.last_error.empty()) j["last_error"] = n.last_error;
+        nodes.push_back(std::move(j));
+    }
+    return {
+        {"role", config_.role},
+        {"health_interval_ms", config_.health_interval_ms},
+        {"nodes", nodes}
+    };
+}
+
+} // namespace sdcpp
@@ -0,0 +1,67 @@
+#include "conditioning_cache.hpp"
+
+namespace sdcpp {
+
+ConditioningCache::ConditioningCache(uint64_t budget_bytes)
+    : budget_bytes_(budget_bytes) {}
+
+std::shared_ptr<const std::string> ConditioningCache::find(const std::string& key) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(key);
+    if (it == entries_.end()) {
+        misses_++;
+        return nullptr;
+    }
+    lru_.splice(lru_.begin(), lru_, it->second.lru_it);
+    hits_++;
+    return it->second.blob;
+}
+
+void ConditioningCache::insert(const std::string& key, std::string blob) {
+    const uint64_t size = key.size() + blob.size();
+    if (!enabled() || size > budget_bytes_) return;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto existing = entries_.find(key);
+    if (existing != entries_.end()) erase_locked(existing);
+
+    while (used_bytes_ + size > budget_bytes_ && !lru_.empty()) {
+        erase_locked(entries_.find(lru_.back()));
+        evictions_++;
+    }
+    lru_.push_front(key);
+    entries_.emplace(key, Entry{std::make_shared<const std::string>(std::move(blob)), lru_.begin()});
+    used_bytes_ += size;
+    stores_++;
+}
+
+void ConditioningCache::erase_locked(std::unordered_map<std::string, Entry>::iterator it) {
+    used_bytes_ -= it->first.size() + it->second.blob->size();
+    lru_.erase(it->second.lru_it);
+    entries_.erase(it);
+}
+
+void ConditioningCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.clear();
+    lru_.clear();
+    used_bytes_ = 0;
+}
+
+nlohmann::json ConditioningCache::stats_json() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const uint64_t lookups = hits_ + misses_;
+    return {
+        {"enabled", enabled()},
+        {"budget_bytes", budget_bytes_},
+        {"used_bytes", used_bytes_},
+        {"entries", entries_.size()},
+        {"hits", hits_},
+        {"misses", misses_},
+        {"hit_rate", lookups ? static_cast<double>(hits_) / lookups : 0.0},
+        {"stores", stores_},
+        {"evictions", evictions_}
+    };
+}
+
+} // namespace sdcpp
@@ -1,4 +1,6 @@
 #include "config.hpp"
+#include "image_encoder.hpp"
+#include "video_encoder.hpp"
 
 #include <fstream>
 #include <iostream>
@@ -17,7 +19,12 @@ void to_json(nlohmann::json& j, const ServerConfig& c) {
         {"ws_port", c.ws_port},
         {"threads", c.threads},
         {"sd_log_level", c.sd_log_level},
-        {"trusted_proxies", c.trusted_proxies}
+        {"trusted_proxies", c.trusted_proxies},
+        {"static_cache_mb", c.static_cache_mb},
+        {"event_loop", c.event_loop},
+        {"max_connections", c.max_connections},
+        {"keep_alive_timeout", c.keep_alive_timeout},
+        {"webdav_max_depth", c.webdav_max_depth}
     };
 }
 
@@ -27,6 +34,11 @@ void from_json(const nlohmann::json& j, ServerConfig& c) {
     c.ws_port = j.value("ws_port", 0);  // deprecated, kept for backward compat
     c.threads = j.value("threads", 8);
     c.sd_log_level = j.value("sd_log_level", std::string{"warn"});
+    c.static_cache_mb = j.value("static_cache_mb", 32);
+    c.event_loop = j.value("event_loop", false);
+    c.max_connections = j.value("max_connections", 10000);
+    c.keep_alive_timeout = j.value("keep_alive_timeout", 60);
+    c.webdav_max_depth = j.value("webdav_max_depth", 1);
     if (j.contains("trusted_proxies") && j["trusted_proxies"].is_array()) {
         c.trusted_proxies.clear();
         for (const auto& v : j["trusted_proxies"]) {
@@ -94,7 +106,9 @@ void to_json(nlohmann::json& j, const PreviewConfig& c) {
         {"mode", c.mode},
         {"interval", c.interval},
         {"max_size", c.max_size},
-        {"quality", c.quality}
+        {"quality", c.quality},
+        {"on_demand", c.on_demand},
+        {"max_overhead_percent", c.max_overhead_percent}
     };
 }
 
@@ -104,6 +118,8 @@ void from_json(const nlohmann::json& j, PreviewConfig& c) {
     c.interval = j.value("interval", 1);
     c.max_size = j.value("max_size", 256);
     c.quality = j.value("quality", 75);
+    c.on_demand = j.value("on_demand", true);
+    c.max_overhead_percent = j.value("max_overhead_percent", 10);
 }
 
 // AssistantConfig JSON serialization
@@ -145,7 +161,8 @@ void to_json(nlohmann::json& j, const AuthConfig& c) {
         // settings endpoint) MUST scrub or omit `auth.password` before sending.
         {"password", c.password},
         {"token_ttl_minutes", c.token_ttl_minutes},
-        {"allow_public_outputs", c.allow_public_outputs}
+        {"allow_public_outputs", c.allow_public_outputs},
+        {"allow_public_metrics", c.allow_public_metrics}
     };
 }
 
@@ -155,19 +172,252 @@ void from_json(const nlohmann::json& j, AuthConfig& c) {
     c.password = j.value("password", "");
     c.token_ttl_minutes = j.value("token_ttl_minutes", 1440);
     c.allow_public_outputs = j.value("allow_public_outputs", true);
+    c.allow_public_metrics = j.value("allow_public_metrics", false);
 }
 
 // RecycleBinConfig JSON serialization
 void to_json(nlohmann::json& j, const RecycleBinConfig& c) {
     j = nlohmann::json{
         {"enabled", c.enabled},
-        {"retention_minutes", c.retention_minutes}
+        {"retention_minutes", c.retention_minutes},
+        {"delete_outputs", c.delete_outputs},
+        {"output_quota_mb", c.output_quota_mb},
+        {"sweep_interval_seconds", c.sweep_interval_seconds},
+        {"reap_files_per_second", c.reap_files_per_second}
     };
 }
 
 void from_json(const nlohmann::json& j, RecycleBinConfig& c) {
     c.enabled = j.value("enabled", true);
     c.retention_minutes = j.value("retention_minutes", 10080);
+    c.delete_outputs = j.value("delete_outputs", false);
+    c.output_quota_mb = j.value("output_quota_mb", 0);
+    c.sweep_interval_seconds = j.value("sweep_interval_seconds", 60);
+    c.reap_files_per_second = j.value("reap_files_per_second", 200);
+}
+
+// QueueConfig JSON serialization
+void to_json(nlohmann::json& j, const QueueConfig& c) {
+    j = nlohmann::json{
+        {"generation_devices", c.generation_devices},
+        {"io_workers", c.io_workers},
+        {"work_stealing", c.work_stealing},
+        {"scheduler", c.scheduler},
+        {"affinity_lookahead", c.affinity_lookahead},
+        {"affinity_max_skips", c.affinity_max_skips},
+        {"affinity_max_wait_seconds", c.affinity_max_wait_seconds},
+        {"priority_aging_seconds", c.priority_aging_seconds},
+        {"fair_share_half_life_seconds", c.fair_share_half_life_seconds},
+        {"max_pending_per_user", c.max_pending_per_user},
+        {"preempt_sweeps", c.preempt_sweeps},
+        {"checkpoint_interval_seconds", c.checkpoint_interval_seconds},
+        {"journal_compact_records", c.journal_compact_records},
+        {"output_workers", c.output_workers},
+        {"output_buffer_mb", c.output_buffer_mb},
+        {"max_batch_images", c.max_batch_images},
+        {"post_worker", c.post_worker},
+        {"post_vram_reserve_mb", c.post_vram_reserve_mb},
+        {"dedup_results", c.dedup_results},
+        {"trace_jobs", c.trace_jobs},
+        {"max_job_waiters", c.max_job_waiters},
+        {"max_wait_seconds", c.max_wait_seconds},
+        {"vram_admission", c.vram_admission},
+        {"vram_headroom_mb", c.vram_headroom_mb}
+    };
+}
+
+void from_json(const nlohmann::json& j, QueueConfig& c) {
+    c.generation_devices = j.value("generation_devices", std::vector<std::string>{});
+    c.io_workers = j.value("io_workers", 1);
+    c.work_stealing = j.value("work_stealing", true);
+    c.scheduler = j.value("scheduler", "affinity");
+    c.affinity_lookahead = j.value("affinity_lookahead", 32);
+    c.affinity_max_skips = j.value("affinity_max_skips", 4);
+    c.affinity_max_wait_seconds = j.value("affinity_max_wait_seconds", 300);
+    c.priority_aging_seconds = j.value("priority_aging_seconds", 600);
+    c.fair_share_half_life_seconds = j.value("fair_share_half_life_seconds", 600);
+    c.max_pending_per_user = j.value("max_pending_per_user", 0);
+    c.preempt_sweeps = j.value("preempt_sweeps", true);
+    c.checkpoint_interval_seconds = j.value("checkpoint_interval_seconds", 0);
+    c.journal_compact_records = j.value("journal_compact_records", 2000);
+    c.output_workers = j.value("output_workers", 2);
+    c.output_buffer_mb = j.value("output_buffer_mb", 1024);
+    c.max_batch_images = j.value("max_batch_images", 8);
+    c.post_worker = j.value("post_worker", true);
+    c.post_vram_reserve_mb = j.value("post_vram_reserve_mb", 1024);
+    c.dedup_results = j.value("dedup_results", true);
+    c.trace_jobs = j.value("trace_jobs", false);
+    c.max_job_waiters = j.value("max_job_waiters", 16);
+    c.max_wait_seconds = j.value("max_wait_seconds", 300);
+    c.vram_admission = j.value("vram_admission", "off");
+    c.vram_headroom_mb = j.value("vram_headroom_mb", 512);
+}
+
+// ModelCacheConfig JSON serialization
+void to_json(nlohmann::json& j, const ModelCacheConfig& c) {
+    j = nlohmann::json{
+        {"ram_budget_mb", c.ram_budget_mb},
+        {"pin", c.pin},
+        {"prefetch_min_free_mb", c.prefetch_min_free_mb},
+        {"parallel_preread", c.parallel_preread}
+    };
+}
+
+void from_json(const nlohmann::json& j, ModelCacheConfig& c) {
+    c.ram_budget_mb = j.value("ram_budget_mb", 0);
+    c.pin = j.value("pin", false);
+    c.prefetch_min_free_mb = j.value("prefetch_min_free_mb", 2048);
+    c.parallel_preread = j.value("parallel_preread", true);
+}
+
+// LoraCacheConfig JSON serialization
+void to_json(nlohmann::json& j, const LoraCacheConfig& c) {
+    j = nlohmann::json{
+        {"ram_budget_mb", c.ram_budget_mb},
+        {"pin", c.pin}
+    };
+}
+
+void from_json(const nlohmann::json& j, LoraCacheConfig& c) {
+    c.ram_budget_mb = j.value("ram_budget_mb", 0);
+    c.pin = j.value("pin", false);
+}
+
+// ConditioningCacheConfig JSON serialization
+void to_json(nlohmann::json& j, const ConditioningCacheConfig& c) {
+    j = nlohmann::json{
+        {"ram_budget_mb", c.ram_budget_mb}
+    };
+}
+
+void from_json(const nlohmann::json& j, ConditioningCacheConfig& c) {
+    c.ram_budget_mb = j.value("ram_budget_mb", 256);
+}
+
+// QuantCacheConfig JSON serialization
+void to_json(nlohmann::json& j, const QuantCacheClass& c) {
+    j = nlohmann::json{
+        {"max_vram_mb", c.max_vram_mb},
+        {"weight_type", c.weight_type}
+    };
+}
+
+void from_json(const nlohmann::json& j, QuantCacheClass& c) {
+    c.max_vram_mb = j.value("max_vram_mb", 0);
+    c.weight_type = j.value("weight_type", "");
+}
+
+void to_json(nlohmann::json& j, const QuantCacheConfig& c) {
+    j = nlohmann::json{
+        {"enabled", c.enabled},
+        {"dir", c.dir},
+        {"min_loads", c.min_loads},
+        {"idle_seconds", c.idle_seconds},
+        {"tensor_type_rules", c.tensor_type_rules},
+        {"vram_classes", c.vram_classes}
+    };
+}
+
+void from_json(const nlohmann::json& j, QuantCacheConfig& c) {
+    c.enabled = j.value("enabled", false);
+    c.dir = j.value("dir", "");
+    c.min_loads = j.value("min_loads", 3);
+    c.idle_seconds = j.value("idle_seconds", 300);
+    c.tensor_type_rules = j.value("tensor_type_rules", "");
+    c.vram_classes = j.value("vram_classes", QuantCacheConfig{}.vram_classes);
+}
+
+// NumaConfig JSON serialization
+void to_json(nlohmann::json& j, const NumaConfig& c) {
+    j = nlohmann::json{
+        {"policy", c.policy},
+        {"nodes", c.nodes},
+        {"pin_threads", c.pin_threads},
+        {"hugepages", c.hugepages},
+        {"mlock", c.mlock}
+    };
+}
+
+void from_json(const nlohmann::json& j, NumaConfig& c) {
+    c.policy = j.value("policy", "off");
+    c.nodes = j.value("nodes", std::vector<int>{});
+    c.pin_threads = j.value("pin_threads", true);
+    c.hugepages = j.value("hugepages", "off");
+    c.mlock = j.value("mlock", false);
+}
+
+// OutputConfig JSON serialization
+void to_json(nlohmann::json& j, const OutputConfig& c) {
+    j = nlohmann::json{
+        {"format", c.format},
+        {"png_compression", c.png_compression},
+        {"jpeg_quality", c.jpeg_quality},
+        {"webp_quality", c.webp_quality},
+        {"webp_lossless", c.webp_lossless}
+    };
+}
+
+void from_json(const nlohmann::json& j, OutputConfig& c) {
+    c.format = j.value("format", "png");
+    c.png_compression = j.value("png_compression", 6);
+    c.jpeg_quality = j.value("jpeg_quality", 92);
+    c.webp_quality = j.value("webp_quality", 90);
+    c.webp_lossless = j.value("webp_lossless", false);
+}
+
+// ThumbnailConfig JSON serialization
+void to_json(nlohmann::json& j, const ThumbnailConfig& c) {
+    j = nlohmann::json{
+        {"sizes", c.sizes},
+        {"format", c.format},
+        {"quality", c.quality},
+        {"memory_cache_mb", c.memory_cache_mb}
+    };
+}
+
+void from_json(const nlohmann::json& j, ThumbnailConfig& c) {
+    c.sizes = j.value("sizes", std::vector<int>{120, 256, 512});
+    c.format = j.value("format", "jpeg");
+    c.quality = j.value("quality", 85);
+    c.memory_cache_mb = j.value("memory_cache_mb", 64);
+}
+
+// VideoConfig JSON serialization
+void to_json(nlohmann::json& j, const VideoConfig& c) {
+    j = nlohmann::json{
+        {"format", c.format},
+        {"codec", c.codec},
+        {"crf", c.crf},
+        {"hardware", c.hardware},
+        {"keep_frames", c.keep_frames}
+    };
+}
+
+void from_json(const nlohmann::json& j, VideoConfig& c) {
+    c.format = j.value("format", "auto");
+    c.codec = j.value("codec", "");
+    c.crf = j.value("crf", 23);
+    c.hardware = j.value("hardware", true);
+    c.keep_frames = j.value("keep_frames", true);
+}
+
+// DownloadConfig JSON serialization
+void to_json(nlohmann::json& j, const DownloadConfig& c) {
+    j = nlohmann::json{
+        {"connections", c.connections},
+        {"min_segment_mb", c.min_segment_mb},
+        {"max_speed_kbps", c.max_speed_kbps},
+        {"max_retries", c.max_retries},
+        {"resume", c.resume}
+    };
+}
+
+void from_json(const nlohmann::json& j, DownloadConfig& c) {
+    c.connections = j.value("connections", 4);
+    c.min_segment_mb = j.value("min_segment_mb", 16);
+    c.max_speed_kbps = j.value("max_speed_kbps", 0);
+    c.max_retries = j.value("max_retries", 5);
+    c.resume = j.value("resume", true);
 }
 
 // McpConfig JSON serialization
@@ -187,6 +437,44 @@ void from_json(const nlohmann::json& j, McpConfig& c) {
     c.image_jpeg_quality = j.value("image_jpeg_quality", 85);
 }
 
+// ClusterConfig JSON serialization
+void to_json(nlohmann::json& j, const ClusterNodeConfig& c) {
+    j = nlohmann::json{
+        {"name", c.name},
+        {"url", c.url},
+        {"username", c.username},
+        // Serialized for a lossless round-trip, like auth.password
+        {"password", c.password},
+        {"max_jobs", c.max_jobs}
+    };
+}
+
+void from_json(const nlohmann::json& j, ClusterNodeConfig& c) {
+    c.name = j.value("name", "");
+    c.url = j.value("url", "");
+    c.username = j.value("username", "");
+    c.password = j.value("password", "");
+    c.max_jobs = j.value("max_jobs", 2);
+}
+
+void to_json(nlohmann::json& j, const ClusterConfig& c) {
+    j = nlohmann::json{
+        {"role", c.role},
+        {"nodes", c.nodes},
+        {"health_interval_ms", c.health_interval_ms},
+        {"job_poll_ms", c.job_poll_ms},
+        {"timeout_seconds", c.timeout_seconds}
+    };
+}
+
+void from_json(const nlohmann::json& j, ClusterConfig& c) {
+    c.role = j.value("role", "standalone");
+    c.nodes = j.value("nodes", std::vector<ClusterNodeConfig>{});
+    c.health_interval_ms = j.value("health_interval_ms", 2000);
+    c.job_poll_ms = j.value("job_poll_ms", 250);
+    c.timeout_seconds = j.value("timeout_seconds", 30);
+}
+
 // Config JSON serialization
 void to_json(nlohmann::json& j, const Config& c) {
     j = nlohmann::json{
@@ -196,8 +484,19 @@ void to_json(nlohmann::json& j, const Config& c) {
         {"preview", c.preview},
         {"assistant", c.assistant},
         {"recycle_bin", c.recycle_bin},
+        {"queue", c.queue},
+        {"model_cache", c.model_cache},
+        {"lora_cache", c.lora_cache},
+        {"conditioning_cache", c.conditioning_cache},
+        {"quant_cache", c.quant_cache},
+        {"numa", c.numa},
+        {"output", c.output},
+        {"thumbnails", c.thumbnails},
+        {"video", c.video},
+        {"download", c.download},
         {"auth", c.auth},
         {"mcp", c.mcp},
+        {"cluster", c.cluster},
         {"output_group_folders", c.output_group_folders}
     };
 }
@@ -221,12 +520,45 @@ void from_json(const nlohmann::json& j, Config& c) {
     if (j.contains("recycle_bin")) {
         c.recycle_bin = j["recycle_bin"].get<RecycleBinConfig>();
     }
+    if (j.contains("queue")) {
+        c.queue = j["queue"].get<QueueConfig>();
+    }
+    if (j.contains("model_cache")) {
+        c.model_cache = j["model_cache"].get<ModelCacheConfig>();
+    }
+    if (j.contains("lora_cache")) {
+        c.lora_cache = j["lora_cache"].get<LoraCacheConfig>();
+    }
+    if (j.contains("conditioning_cache")) {
+        c.conditioning_cache = j["conditioning_cache"].get<ConditioningCacheConfig>();
+    }
+    if (j.contains("quant_cache")) {
+        c.quant_cache = j["quant_cache"].get<QuantCacheConfig>();
+    }
+    if (j.contains("numa")) {
+        c.numa = j["numa"].get<NumaConfig>();
+    }
+    if (j.contains("output")) {
+        c.output = j["output"].get<OutputConfig>();
+    }
+    if (j.contains("thumbnails")) {
+        c.thumbnails = j["thumbnails"].get<ThumbnailConfig>();
+    }
+    if (j.contains("video")) {
+        c.video = j["video"].get<VideoConfig>();
+    }
+    if (j.contains("download")) {
+        c.download = j["download"].get<DownloadConfig>();
+    }
     if (j.contains("auth")) {
         c.auth = j["auth"].get<AuthConfig>();
     }
     if (j.contains("mcp")) {
         c.mcp = j["mcp"].get<McpConfig>();
     }
+    if (j.contains("cluster")) {
+        c.cluster = j["cluster"].get<ClusterConfig>();
+    }
     if (j.contains("output_group_folders")) {
         c.output_group_folders = j["output_group_folders"].get<bool>();
     }
@@ -302,6 +634,189 @@ void Config::validate() const {
     if (server.threads < 1) {
         throw std::runtime_error("Server threads must be at least 1");
     }
+    if (server.static_cache_mb < 0) {
+        throw std::runtime_error("server.static_cache_mb must be >= 0");
+    }
+    if (server.max_connections < 1) {
+        throw std::runtime_error("server.max_connections must be at least 1");
+    }
+    if (server.keep_alive_timeout < 1) {
+        throw std::runtime_error("server.keep_alive_timeout must be at least 1");
+    }
+    if (server.webdav_max_depth < 1 || server.webdav_max_depth > 64) {
+        throw std::runtime_error("server.webdav_max_depth must be between 1 and 64");
+    }
+    if (preview.max_overhead_percent < 0 || preview.max_overhead_percent > 100) {
+        throw std::runtime_error("preview.max_overhead_percent must be between 0 and 100");
+    }
+    if (recycle_bin.output_quota_mb < 0) {
+        throw std::runtime_error("recycle_bin.output_quota_mb must be >= 0");
+    }
+    if (recycle_bin.sweep_interval_seconds < 1) {
+        throw std::runtime_error("recycle_bin.sweep_interval_seconds must be at least 1");
+    }
+    if (recycle_bin.reap_files_per_second < 0) {
+        throw std::runtime_error("recycle_bin.reap_files_per_second must be >= 0");
+    }
+    if (queue.generation_devices.size() > 16) {
+        throw std::runtime_error("queue.generation_devices may list at most 16 devices");
+    }
+    for (const auto& device : queue.generation_devices) {
+        if (device.empty()) throw std::runtime_error("queue.generation_devices entries must not be empty");
+    }
+    if (queue.io_workers < 0 || queue.io_workers > 16) {
+        throw std::runtime_error("queue.io_workers must be between 0 and 16");
+    }
+    if (model_cache.ram_budget_mb < 0) {
+        throw std::runtime_error("model_cache.ram_budget_mb must be >= 0");
+    }
+    if (model_cache.prefetch_min_free_mb < 0) {
+        throw std::runtime_error("model_cache.prefetch_min_free_mb must be >= 0");
+    }
+    if (lora_cache.ram_budget_mb < 0) {
+        throw std::runtime_error("lora_cache.ram_budget_mb must be >= 0");
+    }
+    if (conditioning_cache.ram_budget_mb < 0) {
+        throw std::runtime_error("conditioning_cache.ram_budget_mb must be >= 0");
+    }
+    if (quant_cache.min_loads < 1) {
+        throw std::runtime_error("quant_cache.min_loads must be at least 1");
+    }
+    if (quant_cache.idle_seconds < 0) {
+        throw std::runtime_error("quant_cache.idle_seconds must be >= 0");
+    }
+    for (size_t i = 0; i < quant_cache.vram_classes.size(); ++i) {
+        const auto& c = quant_cache.vram_classes[i];
+        if (c.max_vram_mb <= 0 || c.weight_type.empty()) {
+            throw std::runtime_error("quant_cache.vram_classes entries need max_vram_mb > 0 and a weight_type");
+        }
+        if (i > 0 && c.max_vram_mb <= quant_cache.vram_classes[i - 1].max_vram_mb) {
+            throw std::runtime_error("quant_cache.vram_classes must be in ascending max_vram_mb order");
+        }
+    }
+    if (numa.policy != "off" && numa.policy != "interleave" && numa.policy != "bind") {
+        throw std::runtime_error("numa.policy must be \"off\", \"interleave\" or \"bind\", got: " + numa.policy);
+    }
+    if (numa.hugepages != "off" && numa.hugepages != "madvise") {
+        throw std::runtime_error("numa.hugepages must be \"off\" or \"madvise\", got: " + numa.hugepages);
+    }
+    for (int node : numa.nodes) {
+        if (node < 0) {
+            throw std::runtime_error("numa.nodes must be NUMA node ids >= 0");
+        }
+    }
+    if (queue.scheduler != "fifo" && queue.scheduler != "affinity") {
+        throw std::runtime_error("queue.scheduler must be \"fifo\" or \"affinity\", got: " + queue.scheduler);
+    }
+    if (queue.priority_aging_seconds < 0 || queue.fair_share_half_life_seconds < 0 ||
+        queue.max_pending_per_user < 0) {
+        throw std::runtime_error(
+            "queue.priority_aging_seconds, fair_share_half_life_seconds and max_pending_per_user must be >= 0");
+    }
+    if (queue.checkpoint_interval_seconds < 0) {
+        throw std::runtime_error("queue.checkpoint_interval_seconds must be >= 0");
+    }
+    if (queue.journal_compact_records < 1) {
+        throw std::runtime_error("queue.journal_compact_records must be at least 1");
+    }
+    if (queue.post_vram_reserve_mb < 0) {
+        throw std::runtime_error("queue.post_vram_reserve_mb must be >= 0");
+    }
+    if (queue.vram_admission != "off" && queue.vram_admission != "reject" &&
+        queue.vram_admission != "wait" && queue.vram_admission != "auto") {
+        throw std::runtime_error("queue.vram_admission must be \"off\", \"reject\", \"wait\" or \"auto\", got: " +
+                                 queue.vram_admission);
+    }
+    if (queue.vram_headroom_mb < 0) {
+        throw std::runtime_error("queue.vram_headroom_mb must be >= 0");
+    }
+    if (cluster.role != "standalone" && cluster.role != "coordinator") {
+        throw std::runtime_error("cluster.role must be \"standalone\" or \"coordinator\", got: " + cluster.role);
+    }
+    if (cluster.role == "coordinator" && cluster.nodes.empty()) {
+        throw std::runtime_error("cluster.role is \"coordinator\" but cluster.nodes is empty");
+    }
+    for (const auto& node : cluster.nodes) {
+        if (node.url.rfind("http://", 0) != 0 && node.url.rfind("https://", 0) != 0) {
+            throw std::runtime_error("cluster.nodes[].url must start with http:// or https://, got: " + node.url);
+        }
+        if (node.max_jobs < 1) {
+            throw std::runtime_error("cluster.nodes[].max_jobs must be at least 1");
+        }
+    }
+    if (cluster.health_interval_ms < 100 || cluster.job_poll_ms < 50 || cluster.timeout_seconds < 1) {
+        throw std::runtime_error("cluster: health_interval_ms must be >= 100, job_poll_ms >= 50, timeout_seconds >= 1");
+    }
+    if (queue.output_workers < 0) {
+        throw std::runtime_error("queue.output_workers must be >= 0");
+    }
+    if (queue.output_buffer_mb < 1) {
+        throw std::runtime_error("queue.output_buffer_mb must be at least 1");
+    }
+    if (queue.max_batch_images < 1) {
+        throw std::runtime_error("queue.max_batch_images must be at least 1");
+    }
+    if (queue.max_job_waiters < 0) {
+        throw std::runtime_error("queue.max_job_waiters must be >= 0");
+    }
+    if (queue.max_wait_seconds < 1) {
+        throw std::runtime_error("queue.max_wait_seconds must be at least 1");
+    }
+    ImageFormat output_format = image_format_from_string(output.format);
+    if (!image_format_available(output_format)) {
+        throw std::runtime_error("output.format \"" + output.format + "\" is not available in this build");
+    }
+    if (output.png_compression < 0 || output.png_compression > 9) {
+        throw std::runtime_error("output.png_compression must be between 0 and 9");
+    }
+    if (output.jpeg_quality < 1 || output.jpeg_quality > 100) {
+        throw std::runtime_error("output.jpeg_quality must be between 1 and 100");
+    }
+    if (output.webp_quality < 1 || output.webp_quality > 100) {
+        throw std::runtime_error("output.webp_quality must be between 1 and 100");
+    }
+    if (thumbnails.sizes.empty()) {
+        throw std::runtime_error("thumbnails.sizes must list at least one size");
+    }
+    for (int size : thumbnails.sizes) {
+        if (size < 16 || size > 2048) {
+            throw std::runtime_error("thumbnails.sizes entries must be between 16 and 2048");
+        }
+    }
+    ImageFormat thumbnail_format = image_format_from_string(thumbnails.format);
+    if (thumbnail_format == ImageFormat::Png || !image_format_available(thumbnail_format)) {
+        throw std::runtime_error("thumbnails.format must be \"jpeg\" or an available \"webp\"");
+    }
+    if (thumbnails.quality < 1 || thumbnails.quality > 100) {
+        throw std::runtime_error("thumbnails.quality must be between 1 and 100");
+    }
+    if (thumbnails.memory_cache_mb < 0) {
+        throw std::runtime_error("thumbnails.memory_cache_mb must be >= 0");
+    }
+    if (video.crf < 0 || video.crf > 51) {
+        throw std::runtime_error("video.crf must be between 0 and 51");
+    }
+    if (video.format != "auto" && video.format != "none") {
+        VideoContainer container = video_container_from_string(video.format);
+        if (!video_container_available(container)) {
+            throw std::runtime_error("video.format \"" + video.format + "\" needs a build with FFmpeg");
+        }
+    }
+    if (!video.codec.empty() && video.codec != "h264" && video.codec != "vp9" && video.codec != "av1") {
+        throw std::runtime_error("video.codec must be \"h264\", \"vp9\" or \"av1\"");
+    }
+    if (download.connections < 1 || download.connections > 16) {
+        throw std::runtime_error("download.connections must be between 1 and 16");
+    }
+    if (download.min_segment_mb < 1) {
+        throw std::runtime_error("download.min_segment_mb must be at least 1");
+    }
+    if (download.max_speed_kbps < 0) {
+        throw std::runtime_error("download.max_speed_kbps must be >= 0");
+    }
+    if (download.max_retries < 0) {
+        throw std::runtime_error("download.max_retries must be >= 0");
+    }
 }
 
 nlohmann::json Config::to_json() const {
@@ -2,12 +2,23 @@
 
 #include <algorithm>
 #include <cctype>
+#include <chrono>
 #include <cmath>
+#include <cstring>
+#include <deque>
 #include <fstream>
 #include <iostream>
+#include <map>
 #include <sstream>
 #include <unordered_set>
 
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 namespace sdcpp {
 
 namespace fs = std::filesystem;
@@ -68,26 +79,191 @@ std::string clean_markdown_line(std::string line) {
     return line;
 }
 
+// Cache file layout (native byte order; the cache never leaves the host):
+//   "SDDOCIX1" | u32 record count | records...
+//   record: u64 byte length (including itself) | str file name |
+//           u64 size | i64 mtime_ns | u32 chunk count | chunks...
+//   chunk:  str section | str section_path | str content |
+//           u32 token count | u32 term count | (str term, u32 tf)...
+//   str:    u32 length | bytes
+constexpr char kCacheMagic[8] = {'S', 'D', 'D', 'O', 'C', 'I', 'X', '1'};
+
+void put_u32(std::string& out, uint32_t v) { out.append(reinterpret_cast<const char*>(&v), sizeof(v)); }
+void put_u64(std::string& out, uint64_t v) { out.append(reinterpret_cast<const char*>(&v), sizeof(v)); }
+void put_str(std::string& out, std::string_view s) {
+    put_u32(out, static_cast<uint32_t>(s.size()));
+    out.append(s.data(), s.size());
+}
+
+// Bounds-checked cursor over cache bytes; any overrun sets ok = false
+struct Reader {
+    const char* p;
+    const char* end;
+    bool ok = true;
+
+    template<typename T>
+    T get() {
+        T v{};
+        if (static_cast<size_t>(end - p) < sizeof(T)) { ok = false; return v; }
+        std::memcpy(&v, p, sizeof(T));
+        p += sizeof(T);
+        return v;
+    }
+    std::string_view str() {
+        const uint32_t n = get<uint32_t>();
+        if (!ok || static_cast<size_t>(end - p) < n) { ok = false; return {}; }
+        std::string_view s(p, n);
+        p += n;
+        return s;
+    }
+};
+
+struct DiskFile {
+    fs::path path;
+    uint64_t size = 0;
+    int64_t mtime_ns = 0;
+};
+
 } // namespace
 
-DocsIndex::DocsIndex(const std::string& docs_dir)
+// The mapped cache file plus the records built this run; every Chunk and
+// postings key views into one of the two
+struct DocsIndex::Storage {
+    const char* mapped = nullptr;
+    size_t mapped_size = 0;
+    std::string read_fallback;          // No mmap (Windows)
+    std::deque<std::string> built;      // Stable addresses
+
+    std::string_view cache() const {
+        return mapped ? std::string_view(mapped, mapped_size) : std::string_view(read_fallback);
+    }
+
+    void open(const std::string& path) {
+#ifndef _WIN32
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return;
+        struct stat st{};
+        if (::fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+            void* p = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) {
+                mapped = static_cast<const char*>(p);
+                mapped_size = static_cast<size_t>(st.st_size);
+            }
+        }
+        ::close(fd);
+#else
+        std::ifstream in(path, std::ios::binary);
+        if (in) read_fallback.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+#endif
+    }
+
+    ~Storage() {
+#ifndef _WIN32
+        if (mapped) ::munmap(const_cast<char*>(mapped), mapped_size);
+#endif
+    }
+};
+
+DocsIndex::~DocsIndex() = default;
+
+DocsIndex::DocsIndex(const std::string& docs_dir, const std::string& cache_file)
     : docs_dir_(docs_dir) {
     if (docs_dir_.empty() || !fs::exists(docs_dir_) || !fs::is_directory(docs_dir_)) {
         std::cout << "[DocsIndex] No docs directory configured; assistant won't have docs context." << std::endl;
         return;
     }
 
+    const auto started = std::chrono::steady_clock::now();
+    storage_ = std::make_unique<Storage>();
+
     // Walk *.md files in the directory (non-recursive — keeps URLs in
     // search results predictable; if you want sub-dirs later, enable
     // recursive_directory_iterator and reflect the relative path in
     // doc_filename).
+    std::vector<DiskFile> files;
     std::error_code ec;
     for (auto& entry : fs::directory_iterator(docs_dir_, ec)) {
         if (ec) break;
         if (!entry.is_regular_file()) continue;
         auto p = entry.path();
         if (p.extension() != ".md" && p.extension() != ".MD") continue;
-        index_file(p);
+        DiskFile f;
+        f.path = p;
+        f.size = entry.file_size(ec);
+        auto mtime = entry.last_write_time(ec);
+        f.mtime_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(mtime.time_since_epoch()).count();
+        files.push_back(std::move(f));
+    }
+    std::sort(files.begin(), files.end(),
+              [](const DiskFile& a, const DiskFile& b) { return a.path.filename() < b.path.filename(); });
+
+    // Records of the previous run, by file name
+    struct CachedRecord {
+        std::string_view bytes;
+        uint64_t size;
+        int64_t mtime_ns;
+    };
+    std::map<std::string, CachedRecord, std::less<>> cached;
+    if (!cache_file.empty()) {
+        storage_->open(cache_file);
+        const std::string_view data = storage_->cache();
+        Reader r{data.data(), data.data() + data.size()};
+        if (data.size() >= sizeof(kCacheMagic) && std::memcmp(data.data(), kCacheMagic, sizeof(kCacheMagic)) == 0) {
+            r.p += sizeof(kCacheMagic);
+            const uint32_t count = r.get<uint32_t>();
+            for (uint32_t i = 0; i < count && r.ok; ++i) {
+                const char* start = r.p;
+                const uint64_t len = r.get<uint64_t>();
+                if (!r.ok || len < sizeof(uint64_t) || len > static_cast<uint64_t>(r.end - start)) break;
+                Reader rec{r.p, start + len};
+                const std::string_view name = rec.str();
+                const uint64_t size = rec.get<uint64_t>();
+                const int64_t mtime_ns = rec.get<int64_t>();
+                if (!rec.ok) break;
+                cached.emplace(std::string(name), CachedRecord{std::string_view(start, len), size, mtime_ns});
+                r.p = start + len;
+            }
+        }
+    }
+
+    // Unchanged files come from the cache; the rest are tokenized again
+    std::vector<std::string_view> records;
+    size_t rebuilt = 0;
+    bool changed = cached.size() != files.size();
+    for (const auto& f : files) {
+        auto it = cached.find(f.path.filename().string());
+        if (it != cached.end() && it->second.size == f.size && it->second.mtime_ns == f.mtime_ns) {
+            records.push_back(it->second.bytes);
+            continue;
+        }
+        storage_->built.push_back(build_record(f.path, f.size, f.mtime_ns));
+        records.push_back(storage_->built.back());
+        rebuilt++;
+        changed = true;
+    }
+    for (auto record : records) {
+        if (!load_record(record)) {
+            std::cerr << "[DocsIndex] Skipping a malformed index record" << std::endl;
+        }
+    }
+
+    if (changed && !cache_file.empty()) {
+        std::string out(kCacheMagic, sizeof(kCacheMagic));
+        put_u32(out, static_cast<uint32_t>(records.size()));
+        for (auto record : records) out.append(record.data(), record.size());
+        // Written aside and renamed over, so the mapping above stays valid
+        const std::string tmp = cache_file + ".tmp";
+        bool written;
+        {
+            std::ofstream f(tmp, std::ios::binary | std::ios::trunc);
+            written = f && f.write(out.data(), static_cast<std::streamsize>(out.size()));
+        }
+        std::error_code wec;
+        if (written) fs::rename(tmp, cache_file, wec);
+        if (!written || wec) {
+            std::cerr << "[DocsIndex] Could not write index cache " << cache_file << std::endl;
+            fs::remove(tmp, wec);
+        }
     }
 
     // Compute avg chunk length for BM25's length-normalization term.
@@ -97,16 +273,18 @@ DocsIndex::DocsIndex(const std::string& docs_dir)
         avg_chunk_length_ = static_cast<double>(total) / chunk_lengths_.size();
     }
 
+    const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - started).count();
     std::cout << "[DocsIndex] Indexed " << chunks_.size()
-              << " chunks across " << "*.md in " << docs_dir_
+              << " chunks across " << files.size() << " *.md in " << docs_dir_
               << " (avg " << static_cast<int>(avg_chunk_length_)
-              << " tokens/chunk)." << std::endl;
+              << " tokens/chunk, " << rebuilt << " file(s) re-read, " << ms << " ms)." << std::endl;
 }
 
-void DocsIndex::index_file(const fs::path& path) {
+std::string DocsIndex::build_record(const fs::path& path, uint64_t size, int64_t mtime_ns) {
+    std::string chunks_bytes;
+    uint32_t chunk_count = 0;
     std::ifstream f(path);
-    if (!f) return;
-    std::string filename = path.filename().string();
 
     // Heading hierarchy as we walk. Index 0 = H1, 1 = H2, 2 = H3, etc.
     std::vector<std::string> heading_stack;
@@ -116,31 +294,33 @@ void DocsIndex::index_file(const fs::path& path) {
         trim(trimmed);
         if (trimmed.empty()) return;
 
-        Chunk c;
-        c.doc_filename = filename;
-        c.section = heading_stack.empty() ? std::string{} : heading_stack.back();
+        const std::string section = heading_stack.empty() ? std::string{} : heading_stack.back();
         // Build path string from the stack ("A > B > C")
+        std::string section_path;
         for (std::size_t i = 0; i < heading_stack.size(); ++i) {
-            if (i) c.section_path += " > ";
-            c.section_path += heading_stack[i];
+            if (i) section_path += " > ";
+            section_path += heading_stack[i];
         }
-        c.content = trimmed;
-        c.tokens  = tokenize(trimmed + " " + c.section_path);
+        auto tokens = tokenize(trimmed + " " + section_path);
 
         // Empty-token chunks (e.g. just a code block of unique symbols) are
         // useless for BM25. Skip them.
-        if (c.tokens.empty()) return;
-
-        const std::size_t chunk_idx = chunks_.size();
-        chunk_lengths_.push_back(c.tokens.size());
+        if (tokens.empty()) return;
 
         // Term-frequency map for this chunk
-        std::unordered_map<std::string, int> tf;
-        for (auto& t : c.tokens) ++tf[t];
+        std::unordered_map<std::string, uint32_t> tf;
+        for (auto& t : tokens) ++tf[t];
+
+        put_str(chunks_bytes, section);
+        put_str(chunks_bytes, section_path);
+        put_str(chunks_bytes, trimmed);
+        put_u32(chunks_bytes, static_cast<uint32_t>(tokens.size()));
+        put_u32(chunks_bytes, static_cast<uint32_t>(tf.size()));
         for (auto& [term, count] : tf) {
-            postings_[term].emplace_back(chunk_idx, count);
+            put_str(chunks_bytes, term);
+            put_u32(chunks_bytes, count);
         }
-        chunks_.push_back(std::move(c));
+        chunk_count++;
     };
 
     std::string line;
@@ -148,7 +328,7 @@ void DocsIndex::index_file(const fs::path& path) {
     bool in_code_fence = false;
     std::size_t buf_token_estimate = 0;
 
-    while (std::getline(f, line)) {
+    while (f && std::getline(f, line)) {
         // Code fences: copy verbatim and don't try to parse markdown inside.
         if (starts_with(line, "```")) {
             in_code_fence = !in_code_fence;
@@ -197,6 +377,49 @@ void DocsIndex::index_file(const fs::path& path) {
         buf_token_estimate += static_cast<std::size_t>(cleaned.size() / 5 + 1);
     }
     flush_chunk(buf.str());
+
+    std::string record;
+    put_u64(record, 0);     // Length, patched below
+    put_str(record, path.filename().string());
+    put_u64(record, size);
+    put_u64(record, static_cast<uint64_t>(mtime_ns));
+    put_u32(record, chunk_count);
+    record += chunks_bytes;
+    const uint64_t len = record.size();
+    std::memcpy(record.data(), &len, sizeof(len));
+    return record;
+}
+
+bool DocsIndex::load_record(std::string_view record) {
+    Reader r{record.data(), record.data() + record.size()};
+    r.get<uint64_t>();
+    const std::string_view filename = r.str();
+    r.get<uint64_t>();
+    r.get<int64_t>();
+    const uint32_t count = r.get<uint32_t>();
+    if (!r.ok) return false;
+
+    for (uint32_t i = 0; i < count; ++i) {
+        Chunk c;
+        c.doc_filename = filename;
+        c.section = r.str();
+        c.section_path = r.str();
+        c.content = r.str();
+        const uint32_t length = r.get<uint32_t>();
+        const uint32_t terms = r.get<uint32_t>();
+        if (!r.ok) return false;
+
+        const auto chunk_idx = static_cast<uint32_t>(chunks_.size());
+        for (uint32_t t = 0; t < terms; ++t) {
+            const std::string_view term = r.str();
+            const uint32_t tf = r.get<uint32_t>();
+            if (!r.ok) return false;
+            postings_[term].emplace_back(chunk_idx, tf);
+        }
+        chunks_.push_back(c);
+        chunk_lengths_.push_back(length);
+    }
+    return true;
 }
 
 std::vector<std::string> DocsIndex::tokenize(const std::string& text) {
@@ -233,9 +456,16 @@ std::vector<DocSearchResult> DocsIndex::search(const std::string& query,
     constexpr double b  = 0.75;
     const double N      = static_cast<double>(chunks_.size());
 
-    std::unordered_map<std::size_t, double> scores;
+    // Per-thread scratch: a score slot per chunk plus the chunks touched,
+    // reset after each query, so scoring allocates nothing once warm
+    thread_local std::vector<double> scores;
+    thread_local std::vector<uint32_t> touched;
+    thread_local std::vector<std::pair<double, uint32_t>> heap;
+    if (scores.size() < chunks_.size()) scores.resize(chunks_.size(), 0.0);
+    touched.clear();
+
     for (const auto& term : q_tokens) {
-        auto it = postings_.find(term);
+        auto it = postings_.find(std::string_view(term));
         if (it == postings_.end()) continue;
         const auto& posting_list = it->second;
         const double df  = static_cast<double>(posting_list.size());
@@ -245,32 +475,46 @@ std::vector<DocSearchResult> DocsIndex::search(const std::string& query,
             const double tf = static_cast<double>(tf_int);
             const double dl = static_cast<double>(chunk_lengths_[chunk_idx]);
             const double norm = 1.0 - b + b * (dl / std::max(1.0, avg_chunk_length_));
+            if (scores[chunk_idx] == 0.0) touched.push_back(chunk_idx);
             scores[chunk_idx] += idf * (tf * (k1 + 1.0)) / (tf + k1 * norm);
         }
     }
-    if (scores.empty()) return {};
+    if (touched.empty()) return {};
 
-    // Top-K selection.
-    std::vector<std::pair<std::size_t, double>> ranked(scores.begin(), scores.end());
-    const std::size_t take = std::min(max_results, ranked.size());
-    std::partial_sort(
-        ranked.begin(), ranked.begin() + take, ranked.end(),
-        [](const auto& a, const auto& b) { return a.second > b.second; });
-    ranked.resize(take);
+    // Top-K selection: a min-heap of the best `max_results` seen so far.
+    // Ties go to the earlier chunk, so results are stable across runs.
+    auto worse = [](const std::pair<double, uint32_t>& a, const std::pair<double, uint32_t>& b) {
+        return a.first != b.first ? a.first > b.first : a.second < b.second;
+    };
+    heap.clear();
+    for (uint32_t idx : touched) {
+        const std::pair<double, uint32_t> cand{scores[idx], idx};
+        scores[idx] = 0.0;
+        if (heap.size() < max_results) {
+            heap.push_back(cand);
+            std::push_heap(heap.begin(), heap.end(), worse);
+        } else if (max_results > 0 && worse(cand, heap.front())) {
+            std::pop_heap(heap.begin(), heap.end(), worse);
+            heap.back() = cand;
+            std::push_heap(heap.begin(), heap.end(), worse);
+        }
+    }
+    std::sort_heap(heap.begin(), heap.end(), worse);
+    const std::size_t take = heap.size();
 
     std::vector<DocSearchResult> out;
     out.reserve(take);
-    for (auto& [idx, score] : ranked) {
+    for (const auto& [score, idx] : heap) {
         const auto& c = chunks_[idx];
         DocSearchResult r;
-        r.doc_filename = c.doc_filename;
-        r.section      = c.section;
-        r.section_path = c.section_path;
+        r.doc_filename = std::string(c.doc_filename);
+        r.section      = std::string(c.section);
+        r.section_path = std::string(c.section_path);
         r.score        = score;
         if (c.content.size() > kReturnedContentBytes) {
-            r.content = c.content.substr(0, kReturnedContentBytes) + "\n...[truncated]";
+            r.content = std::string(c.content.substr(0, kReturnedContentBytes)) + "\n...[truncated]";
         } else {
-            r.content = c.content;
+            r.content = std::string(c.content);
         }
         out.push_back(std::move(r));
     }
@@ -6,7 +6,13 @@
 #include <algorithm>
 #include <chrono>
 #include <cstring>
+#include <cerrno>
+#include <memory>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
 #include <curl/curl.h>
+#include "utils.hpp"
 
 namespace fs = std::filesystem;
 
@@ -29,8 +35,8 @@ DownloadSource string_to_download_source(const std::string& str) {
     return DownloadSource::DirectURL;
 }
 
-DownloadManager::DownloadManager(const nlohmann::json& paths_config)
-    : paths_config_(paths_config) {
+DownloadManager::DownloadManager(const nlohmann::json& paths_config, const DownloadConfig& options)
+    : paths_config_(paths_config), options_(options) {
 }
 
 bool DownloadManager::is_supported_extension(const std::string& extension) {
@@ -155,88 +161,505 @@ size_t curl_write_string(void* data, size_t size, size_t nmemb, void* userp) {
     return bytes;
 }
 
-// State carried through the streaming write callback for file downloads
-struct StreamState {
-    std::ofstream* ofs = nullptr;
-    size_t downloaded = 0;
-    size_t total = 0;
-    DownloadProgressCallback progress_callback;
-    std::chrono::steady_clock::time_point start_time;
+// Apply common cURL options used by every request the manager makes.
+void apply_common_curl_options(CURL* curl, long connect_timeout, long total_timeout) {
+    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+    curl_easy_setopt(curl, CURLOPT_MAXREDIRS, 10L);
+    curl_easy_setopt(curl, CURLOPT_USERAGENT, "SDCpp-RestAPI/1.0");
+    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, connect_timeout);
+    if (total_timeout > 0) {
+        curl_easy_setopt(curl, CURLOPT_TIMEOUT, total_timeout);
+    }
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(curl, CURLOPT_FAILONERROR, 1L);
+    // Use system CA bundle (default). TLS verification stays ON — cpp-httplib's
+    // disabled-verification path was a security hole; libcurl + system CAs
+    // validates HuggingFace's CloudFront cert correctly.
+    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 1L);
+    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 2L);
+}
+
+// Response headers the HEAD probe needs. Content-Length and Content-Type
+// are read via CURLINFO_* after the transfer; these have no CURLINFO_.
+struct ProbeHeaders {
+    std::string disposition;
+    std::string etag;
+    std::string last_modified;
+    bool accept_ranges = false;
 };
 
-// Write callback for libcurl: writes chunks to disk and reports progress
-size_t curl_write_stream(void* data, size_t size, size_t nmemb, void* userp) {
-    auto* state = static_cast<StreamState*>(userp);
+// Case-insensitive "name:" match on a raw header line; trims the value
+bool match_header(const char* buffer, size_t bytes, const char* name, std::string& value) {
+    const size_t name_len = std::strlen(name);
+    if (bytes <= name_len || buffer[name_len] != ':') return false;
+    for (size_t i = 0; i < name_len; ++i) {
+        char c = buffer[i];
+        if (c >= 'A' && c <= 'Z') c = static_cast<char>(c - 'A' + 'a');
+        if (c != name[i]) return false;
+    }
+    std::string raw(buffer + name_len + 1, bytes - name_len - 1);
+    size_t start = raw.find_first_not_of(" \t");
+    size_t end = raw.find_last_not_of(" \t\r\n");
+    value = (start == std::string::npos) ? std::string() : raw.substr(start, end - start + 1);
+    return true;
+}
+
+// Header callback for the HEAD probe
+size_t curl_capture_headers(char* buffer, size_t size, size_t nitems, void* userp) {
+    auto* headers = static_cast<ProbeHeaders*>(userp);
+    size_t bytes = size * nitems;
+
+    // Each redirect hop starts with a status line; only the last hop counts
+    if (bytes >= 5 && std::strncmp(buffer, "HTTP/", 5) == 0) {
+        *headers = ProbeHeaders{};
+        return bytes;
+    }
+
+    std::string value;
+    if (match_header(buffer, bytes, "content-disposition", value)) {
+        headers->disposition = value;
+    } else if (match_header(buffer, bytes, "etag", value)) {
+        headers->etag = value;
+    } else if (match_header(buffer, bytes, "last-modified", value)) {
+        headers->last_modified = value;
+    } else if (match_header(buffer, bytes, "accept-ranges", value)) {
+        headers->accept_ranges = value.find("bytes") != std::string::npos;
+    }
+    return bytes;
+}
+
+// One byte range of the destination file. `done` counts bytes already
+// written from `start`; `end` is exclusive.
+struct Segment {
+    uint64_t start = 0;
+    uint64_t end = 0;
+    uint64_t done = 0;
+    bool active = false;        // a connection is fetching it
+    bool complete = false;
+    int failures = 0;
+    std::chrono::steady_clock::time_point not_before{};  // retry backoff
+
+    uint64_t remaining() const {
+        return end > start + done ? end - (start + done) : 0;
+    }
+};
+
+// Layout of one download. With `ranged` false the file is a single
+// unbounded segment fetched with a plain GET.
+struct TransferPlan {
+    int fd = -1;
+    bool ranged = false;
+    uint64_t total = 0;
+    std::string etag;
+    std::string last_modified;
+    std::vector<Segment> segments;
+
+    // SHA256 of the file is computed during the transfer: bytes landing at
+    // the hash frontier are hashed straight from curl's buffer, the rest is
+    // read back from page cache once the gap before it fills (advance_hash)
+    utils::Sha256 hasher;
+    uint64_t hashed = 0;
+    bool hash_failed = false;
+
+    uint64_t downloaded() const {
+        uint64_t sum = 0;
+        for (const auto& s : segments) sum += s.done;
+        return sum;
+    }
+};
+
+// One in-flight GET on the multi handle
+struct Connection {
+    CURL* easy = nullptr;
+    TransferPlan* plan = nullptr;
+    size_t segment = 0;
+    bool status_checked = false;
+    bool range_ignored = false;     // server answered a Range request with 200
+    int write_errno = 0;
+    char errbuf[CURL_ERROR_SIZE] = {0};
+};
+
+// Write callback for ranged and single-stream GETs: pwrite()s at the
+// segment's cursor, so connections never share a file position
+size_t curl_write_segment(void* data, size_t size, size_t nmemb, void* userp) {
+    auto* conn = static_cast<Connection*>(userp);
+    TransferPlan& plan = *conn->plan;
+    Segment& seg = plan.segments[conn->segment];
     size_t bytes = size * nmemb;
 
-    if (state->ofs) {
-        state->ofs->write(static_cast<const char*>(data), bytes);
-        if (!*state->ofs) {
-            // Returning fewer bytes than received tells libcurl to abort
-            // (CURLE_WRITE_ERROR), which propagates as a download failure.
+    if (!conn->status_checked) {
+        conn->status_checked = true;
+        long code = 0;
+        curl_easy_getinfo(conn->easy, CURLINFO_RESPONSE_CODE, &code);
+        if (plan.ranged && code != 206) {
+            conn->range_ignored = true;
             return 0;
         }
     }
 
-    state->downloaded += bytes;
+    // The segment may have been split since this request started; stop at
+    // its (new) end. Returning short ends the transfer with CURLE_WRITE_ERROR,
+    // and completion is judged by remaining() rather than the result code.
+    size_t writable = bytes;
+    if (plan.ranged) {
+        writable = static_cast<size_t>(std::min<uint64_t>(bytes, seg.remaining()));
+    }
 
-    if (state->progress_callback) {
-        auto now = std::chrono::steady_clock::now();
-        auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(now - state->start_time).count();
-        size_t speed = elapsed > 0 ? state->downloaded / static_cast<size_t>(elapsed) : state->downloaded;
-        state->progress_callback(state->downloaded, state->total, speed);
+    const char* p = static_cast<const char*>(data);
+    size_t left = writable;
+    uint64_t offset = seg.start + seg.done;
+    if (offset == plan.hashed && !plan.hash_failed) {
+        plan.hasher.update(p, writable);
+        plan.hashed += writable;
+    }
+    while (left > 0) {
+        ssize_t n = ::pwrite(plan.fd, p, left, static_cast<off_t>(offset));
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            conn->write_errno = errno;
+            return 0;
+        }
+        p += n;
+        left -= static_cast<size_t>(n);
+        offset += static_cast<uint64_t>(n);
+        seg.done += static_cast<uint64_t>(n);
     }
 
-    return bytes;
+    return writable == bytes ? bytes : 0;
 }
 
-// Header callback: captures Content-Disposition (Content-Length and Content-Type
-// are read via CURLINFO_* after the transfer; only Content-Disposition needs a
-// header callback because there's no dedicated CURLINFO_ for it).
-size_t curl_capture_disposition(char* buffer, size_t size, size_t nitems, void* userp) {
-    auto* disposition = static_cast<std::string*>(userp);
-    size_t bytes = size * nitems;
-    constexpr const char* kPrefix = "content-disposition:";
-    constexpr size_t kPrefixLen = 20; // strlen("content-disposition:")
-
-    if (bytes >= kPrefixLen) {
-        // Case-insensitive prefix match
-        bool match = true;
-        for (size_t i = 0; i < kPrefixLen; ++i) {
-            char c = buffer[i];
-            if (c >= 'A' && c <= 'Z') c = static_cast<char>(c - 'A' + 'a');
-            if (c != kPrefix[i]) { match = false; break; }
-        }
-        if (match) {
-            std::string value(buffer + kPrefixLen, bytes - kPrefixLen);
-            // Trim leading whitespace and trailing CRLF
-            size_t start = value.find_first_not_of(" \t");
-            size_t end = value.find_last_not_of(" \t\r\n");
-            if (start != std::string::npos && end != std::string::npos) {
-                *disposition = value.substr(start, end - start + 1);
-            }
+// End of the gap-free written prefix of the file
+uint64_t contiguous_prefix(const TransferPlan& plan) {
+    std::vector<const Segment*> ordered;
+    for (const auto& s : plan.segments) ordered.push_back(&s);
+    std::sort(ordered.begin(), ordered.end(),
+              [](const Segment* a, const Segment* b) { return a->start < b->start; });
+
+    uint64_t pos = 0;
+    for (const Segment* s : ordered) {
+        if (s->start > pos) break;
+        pos = std::max(pos, s->start + s->done);
+        if (s->remaining() > 0) break;
+    }
+    return pos;
+}
+
+// Move the hash frontier up to the contiguous prefix, reading at most
+// `budget` bytes back from the file so the transfer loop stays responsive
+void advance_hash(TransferPlan& plan, uint64_t budget) {
+    if (plan.hash_failed) return;
+    const uint64_t prefix = contiguous_prefix(plan);
+
+    static thread_local std::vector<unsigned char> buffer(4 * 1024 * 1024);
+    while (plan.hashed < prefix && budget > 0) {
+        size_t want = static_cast<size_t>(std::min<uint64_t>({buffer.size(), prefix - plan.hashed, budget}));
+        ssize_t n = ::pread(plan.fd, buffer.data(), want, static_cast<off_t>(plan.hashed));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            plan.hash_failed = true;   // fall back to hashing the finished file
+            return;
         }
+        plan.hasher.update(buffer.data(), static_cast<size_t>(n));
+        plan.hashed += static_cast<uint64_t>(n);
+        budget -= static_cast<uint64_t>(n);
     }
+}
 
-    return bytes;
+// Sidecar (<file>.part.json) persistence. Written to a temp file and
+// renamed, so a crash mid-save leaves the previous copy intact.
+void save_plan(const std::string& meta_path, const TransferPlan& plan) {
+    nlohmann::json segments = nlohmann::json::array();
+    for (const auto& s : plan.segments) {
+        segments.push_back({s.start, s.end, s.done});
+    }
+    nlohmann::json j = {
+        {"version", 1},
+        {"total_size", plan.total},
+        {"etag", plan.etag},
+        {"last_modified", plan.last_modified},
+        {"segments", segments}
+    };
+
+    std::string tmp = meta_path + ".tmp";
+    {
+        std::ofstream ofs(tmp, std::ios::trunc);
+        if (!ofs) return;
+        ofs << j.dump();
+        if (!ofs) return;
+    }
+    std::error_code ec;
+    fs::rename(tmp, meta_path, ec);
+    if (ec) {
+        std::cerr << "[DownloadManager] Failed to save resume state " << meta_path << ": " << ec.message() << std::endl;
+    }
 }
 
-// Apply common cURL options used by every request the manager makes.
-void apply_common_curl_options(CURL* curl, long connect_timeout, long total_timeout) {
-    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
-    curl_easy_setopt(curl, CURLOPT_MAXREDIRS, 10L);
-    curl_easy_setopt(curl, CURLOPT_USERAGENT, "SDCpp-RestAPI/1.0");
-    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, connect_timeout);
-    if (total_timeout > 0) {
-        curl_easy_setopt(curl, CURLOPT_TIMEOUT, total_timeout);
+bool load_plan(const std::string& meta_path, TransferPlan& plan) {
+    try {
+        std::ifstream ifs(meta_path);
+        if (!ifs) return false;
+        auto j = nlohmann::json::parse(ifs);
+        if (j.value("version", 0) != 1) return false;
+
+        plan.total = j.value("total_size", uint64_t{0});
+        plan.etag = j.value("etag", "");
+        plan.last_modified = j.value("last_modified", "");
+        plan.segments.clear();
+        for (const auto& s : j.at("segments")) {
+            Segment seg;
+            seg.start = s.at(0).get<uint64_t>();
+            seg.end = s.at(1).get<uint64_t>();
+            seg.done = std::min(s.at(2).get<uint64_t>(), seg.end - seg.start);
+            seg.complete = seg.remaining() == 0;
+            plan.segments.push_back(seg);
+        }
+        return !plan.segments.empty();
+    } catch (const std::exception& e) {
+        std::cerr << "[DownloadManager] Ignoring unreadable resume state " << meta_path << ": " << e.what() << std::endl;
+        return false;
     }
-    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
-    curl_easy_setopt(curl, CURLOPT_FAILONERROR, 1L);
-    // Use system CA bundle (default). TLS verification stays ON — cpp-httplib's
-    // disabled-verification path was a security hole; libcurl + system CAs
-    // validates HuggingFace's CloudFront cert correctly.
-    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 1L);
-    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 2L);
+}
+
+// Split [0, total) into up to `connections` equal ranges of at least min_bytes
+std::vector<Segment> initial_segments(uint64_t total, int connections, uint64_t min_bytes) {
+    uint64_t count = std::clamp<uint64_t>(total / std::max<uint64_t>(min_bytes, 1), 1,
+                                          static_cast<uint64_t>(std::max(connections, 1)));
+    uint64_t size = (total + count - 1) / count;
+    std::vector<Segment> segments;
+    for (uint64_t start = 0; start < total; start += size) {
+        Segment seg;
+        seg.start = start;
+        seg.end = std::min(total, start + size);
+        segments.push_back(seg);
+    }
+    return segments;
+}
+
+enum class TransferOutcome { Ok, Failed, RangeIgnored };
+
+// Drive all segments of `plan` to completion on one multi handle. Runs on
+// the caller's thread; progress_callback and sidecar saves happen here too.
+TransferOutcome run_transfers(
+    const std::string& url,
+    TransferPlan& plan,
+    const DownloadConfig& options,
+    const std::string& meta_path,
+    const DownloadProgressCallback& progress_callback,
+    std::string& error_message,
+    std::string& content_type
+) {
+    using Clock = std::chrono::steady_clock;
+
+    CURLM* multi = curl_multi_init();
+    if (!multi) {
+        error_message = "Download failed: curl_multi_init returned null";
+        return TransferOutcome::Failed;
+    }
+
+    const int max_connections = plan.ranged ? std::max(1, options.connections) : 1;
+    const uint64_t min_split = static_cast<uint64_t>(std::max(1, options.min_segment_mb)) * 1024 * 1024;
+    // The cap is per job; split it evenly over the connections
+    const curl_off_t per_connection_cap = options.max_speed_kbps > 0
+        ? static_cast<curl_off_t>(options.max_speed_kbps) * 1024 / max_connections
+        : 0;
+    const bool persist = plan.ranged && options.resume;
+
+    std::vector<std::unique_ptr<Connection>> active;
+    TransferOutcome outcome = TransferOutcome::Ok;
+
+    auto start_connection = [&](size_t index) -> bool {
+        auto conn = std::make_unique<Connection>();
+        conn->easy = curl_easy_init();
+        if (!conn->easy) {
+            error_message = "Download failed: curl_easy_init returned null";
+            return false;
+        }
+        conn->plan = &plan;
+        conn->segment = index;
+
+        Segment& seg = plan.segments[index];
+        if (!plan.ranged) {
+            seg.done = 0;   // no ranges: a retry starts over
+            plan.hasher.reset();
+            plan.hashed = 0;
+        }
+
+        curl_easy_setopt(conn->easy, CURLOPT_URL, url.c_str());
+        curl_easy_setopt(conn->easy, CURLOPT_WRITEFUNCTION, curl_write_segment);
+        curl_easy_setopt(conn->easy, CURLOPT_WRITEDATA, conn.get());
+        curl_easy_setopt(conn->easy, CURLOPT_ERRORBUFFER, conn->errbuf);
+        // No CURLOPT_TIMEOUT for the body transfer — large model files (10+ GB)
+        // can legitimately take hours on slow links. We rely on LOW_SPEED_LIMIT
+        // to abort genuinely-stalled connections.
+        apply_common_curl_options(conn->easy, 30L, 0L);
+        curl_easy_setopt(conn->easy, CURLOPT_LOW_SPEED_TIME, 60L);   // abort if <10 B/s for 60s
+        curl_easy_setopt(conn->easy, CURLOPT_LOW_SPEED_LIMIT, 10L);
+        if (plan.ranged) {
+            std::string range = std::to_string(seg.start + seg.done) + "-" + std::to_string(seg.end - 1);
+            curl_easy_setopt(conn->easy, CURLOPT_RANGE, range.c_str());
+        }
+        if (per_connection_cap > 0) {
+            curl_easy_setopt(conn->easy, CURLOPT_MAX_RECV_SPEED_LARGE, per_connection_cap);
+        }
+
+        curl_multi_add_handle(multi, conn->easy);
+        seg.active = true;
+        active.push_back(std::move(conn));
+        return true;
+    };
+
+    // Next segment to (re)start, splitting the largest in-flight range when
+    // nothing is queued so the tail of the file doesn't run on one connection
+    auto pick_segment = [&](Clock::time_point now) -> std::optional<size_t> {
+        for (size_t i = 0; i < plan.segments.size(); ++i) {
+            const Segment& s = plan.segments[i];
+            if (!s.active && !s.complete && s.not_before <= now) return i;
+        }
+        if (!plan.ranged) return std::nullopt;
+
+        size_t largest = plan.segments.size();
+        for (size_t i = 0; i < plan.segments.size(); ++i) {
+            const Segment& s = plan.segments[i];
+            if (s.active && s.remaining() >= 2 * min_split &&
+                (largest == plan.segments.size() || s.remaining() > plan.segments[largest].remaining())) {
+                largest = i;
+            }
+        }
+        if (largest == plan.segments.size()) return std::nullopt;
+
+        Segment& victim = plan.segments[largest];
+        Segment tail;
+        tail.start = victim.start + victim.done + victim.remaining() / 2;
+        tail.end = victim.end;
+        victim.end = tail.start;
+        plan.segments.push_back(tail);
+        return plan.segments.size() - 1;
+    };
+
+    auto all_complete = [&] {
+        for (const auto& s : plan.segments) {
+            if (!s.complete) return false;
+        }
+        return true;
+    };
+
+    const uint64_t resumed_bytes = plan.downloaded();
+    const auto start_time = Clock::now();
+    auto last_progress = Clock::time_point{};
+    auto last_save = start_time;
+
+    while (outcome == TransferOutcome::Ok) {
+        auto now = Clock::now();
+        while (static_cast<int>(active.size()) < max_connections) {
+            auto index = pick_segment(now);
+            if (!index) break;
+            if (!start_connection(*index)) {
+                outcome = TransferOutcome::Failed;
+                break;
+            }
+        }
+        if (outcome != TransferOutcome::Ok) break;
+
+        if (active.empty()) {
+            if (all_complete()) break;
+            // Everything left is waiting out a retry backoff
+            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+            continue;
+        }
+
+        int running = 0;
+        curl_multi_perform(multi, &running);
+
+        int queued = 0;
+        while (CURLMsg* msg = curl_multi_info_read(multi, &queued)) {
+            if (msg->msg != CURLMSG_DONE) continue;
+
+            auto it = std::find_if(active.begin(), active.end(),
+                [&](const auto& c) { return c->easy == msg->easy_handle; });
+            if (it == active.end()) continue;
+            Connection& conn = **it;
+            Segment& seg = plan.segments[conn.segment];
+            seg.active = false;
+
+            CURLcode rc = msg->data.result;
+            long http_code = 0;
+            curl_easy_getinfo(conn.easy, CURLINFO_RESPONSE_CODE, &http_code);
+            if (content_type.empty()) {
+                char* ct = nullptr;
+                if (curl_easy_getinfo(conn.easy, CURLINFO_CONTENT_TYPE, &ct) == CURLE_OK && ct) {
+                    content_type = ct;
+                }
+            }
+
+            if (conn.range_ignored) {
+                outcome = TransferOutcome::RangeIgnored;
+            } else if (conn.write_errno != 0) {
+                error_message = "Failed to write file: " + std::string(std::strerror(conn.write_errno));
+                outcome = TransferOutcome::Failed;
+            } else if (plan.ranged ? seg.remaining() == 0 : rc == CURLE_OK) {
+                seg.complete = true;
+                if (!plan.ranged) {
+                    plan.total = seg.done;
+                }
+            } else {
+                std::string msg_text = rc == CURLE_OK
+                    ? std::string("connection closed before the range was complete")
+                    : (conn.errbuf[0] ? std::string(conn.errbuf) : std::string(curl_easy_strerror(rc)));
+                // 4xx other than timeout/rate limit won't get better by retrying
+                bool permanent = http_code >= 400 && http_code < 500 && http_code != 408 && http_code != 429;
+                if (permanent || ++seg.failures > options.max_retries) {
+                    error_message = "Download failed: " + msg_text;
+                    if (http_code) {
+                        error_message += " (HTTP " + std::to_string(http_code) + ")";
+                    }
+                    outcome = TransferOutcome::Failed;
+                } else {
+                    auto backoff = std::chrono::seconds(std::min(30, 1 << std::min(seg.failures - 1, 5)));
+                    seg.not_before = Clock::now() + backoff;
+                    std::cerr << "[DownloadManager] Range " << seg.start + seg.done << "-" << seg.end
+                              << " failed (" << msg_text << "), retry " << seg.failures << "/"
+                              << options.max_retries << " in " << backoff.count() << "s" << std::endl;
+                }
+            }
+
+            curl_multi_remove_handle(multi, conn.easy);
+            curl_easy_cleanup(conn.easy);
+            active.erase(it);
+        }
+
+        advance_hash(plan, 64ull * 1024 * 1024);
+
+        now = Clock::now();
+        if (progress_callback && now - last_progress >= std::chrono::milliseconds(250)) {
+            last_progress = now;
+            uint64_t downloaded = plan.downloaded();
+            auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(now - start_time).count();
+            uint64_t fresh = downloaded - resumed_bytes;
+            size_t speed = elapsed > 0 ? static_cast<size_t>(fresh / static_cast<uint64_t>(elapsed))
+                                       : static_cast<size_t>(fresh);
+            progress_callback(static_cast<size_t>(downloaded), static_cast<size_t>(plan.total), speed);
+        }
+        if (persist && now - last_save >= std::chrono::seconds(2)) {
+            last_save = now;
+            save_plan(meta_path, plan);
+        }
+
+        if (outcome == TransferOutcome::Ok && !active.empty()) {
+            curl_multi_wait(multi, nullptr, 0, 200, nullptr);
+        }
+    }
+
+    for (auto& conn : active) {
+        plan.segments[conn->segment].active = false;
+        curl_multi_remove_handle(multi, conn->easy);
+        curl_easy_cleanup(conn->easy);
+    }
+    curl_multi_cleanup(multi);
+
+    if (outcome == TransferOutcome::Ok && progress_callback) {
+        progress_callback(static_cast<size_t>(plan.downloaded()), static_cast<size_t>(plan.total), 0);
+    }
+    return outcome;
 }
 
 } // anonymous namespace
@@ -305,10 +728,11 @@ DownloadResult DownloadManager::download_file(
 ) {
     DownloadResult result;
 
-    // ----- HEAD request: probe size, content-type, content-disposition -----
+    // ----- HEAD request: probe size, content-type, ranges, validators -----
     size_t total_size = 0;
     std::string content_type;
-    std::string content_disposition;
+    std::string transfer_url = url;
+    ProbeHeaders probe;
     {
         CURL* curl = curl_easy_init();
         if (!curl) {
@@ -319,8 +743,8 @@ DownloadResult DownloadManager::download_file(
         char errbuf[CURL_ERROR_SIZE] = {0};
         curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
         curl_easy_setopt(curl, CURLOPT_NOBODY, 1L); // HEAD
-        curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, curl_capture_disposition);
-        curl_easy_setopt(curl, CURLOPT_HEADERDATA, &content_disposition);
+        curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, curl_capture_headers);
+        curl_easy_setopt(curl, CURLOPT_HEADERDATA, &probe);
         curl_easy_setopt(curl, CURLOPT_ERRORBUFFER, errbuf);
         // HEAD uses a shorter total timeout — the body is empty so 30s is plenty.
         apply_common_curl_options(curl, 30L, 60L);
@@ -335,6 +759,14 @@ DownloadResult DownloadManager::download_file(
             if (curl_easy_getinfo(curl, CURLINFO_CONTENT_TYPE, &ct) == CURLE_OK && ct) {
                 content_type = ct;
             }
+            // Ranged GETs go straight to the final (e.g. signed CDN) URL
+            // instead of replaying the redirect chain once per connection
+            char* effective = nullptr;
+            if (curl_easy_getinfo(curl, CURLINFO_EFFECTIVE_URL, &effective) == CURLE_OK && effective) {
+                transfer_url = effective;
+            }
+        } else {
+            probe = ProbeHeaders{};
         }
         // HEAD failure isn't fatal — some servers/CDNs reject HEAD on signed
         // URLs. We still attempt the GET below.
@@ -352,7 +784,7 @@ DownloadResult DownloadManager::download_file(
     // Determine filename
     std::string filename = expected_filename;
     if (filename.empty()) {
-        filename = extract_filename(url, content_disposition);
+        filename = extract_filename(url, probe.disposition);
     }
 
     // Validate extension
@@ -364,6 +796,8 @@ DownloadResult DownloadManager::download_file(
 
     // Create full destination path
     std::string full_path = (fs::path(dest_path) / filename).string();
+    const std::string part_path = full_path + ".part";
+    const std::string meta_path = part_path + ".json";
 
     // Check if file already exists
     if (fs::exists(full_path)) {
@@ -371,82 +805,145 @@ DownloadResult DownloadManager::download_file(
         return result;
     }
 
-    // ----- Streaming GET to disk -----
-    std::ofstream ofs(full_path, std::ios::binary);
-    if (!ofs) {
-        result.error_message = "Failed to create file: " + full_path;
-        return result;
+    // ----- Plan: resume a matching partial download, or start fresh -----
+    TransferPlan plan;
+    plan.total = total_size;
+    plan.ranged = total_size > 0 && probe.accept_ranges;
+    plan.etag = probe.etag;
+    plan.last_modified = probe.last_modified;
+
+    std::error_code ec;
+    bool resumed = false;
+    if (plan.ranged && options_.resume) {
+        TransferPlan saved;
+        if (load_plan(meta_path, saved) &&
+            saved.total == plan.total &&
+            (saved.etag.empty() || plan.etag.empty() || saved.etag == plan.etag) &&
+            (saved.last_modified.empty() || plan.last_modified.empty() || saved.last_modified == plan.last_modified) &&
+            fs::exists(part_path, ec) && fs::file_size(part_path, ec) == plan.total) {
+            plan.segments = std::move(saved.segments);
+            resumed = true;
+        }
+    }
+    if (!resumed) {
+        fs::remove(part_path, ec);
+        fs::remove(meta_path, ec);
+        if (plan.ranged) {
+            plan.segments = initial_segments(plan.total, options_.connections,
+                static_cast<uint64_t>(std::max(1, options_.min_segment_mb)) * 1024 * 1024);
+        } else {
+            plan.segments.assign(1, Segment{});
+        }
     }
 
-    StreamState state;
-    state.ofs = &ofs;
-    state.total = total_size;
-    state.progress_callback = progress_callback;
-    state.start_time = std::chrono::steady_clock::now();
-
-    CURL* curl = curl_easy_init();
-    if (!curl) {
-        ofs.close();
-        fs::remove(full_path);
-        result.error_message = "Download failed: curl_easy_init returned null";
+    plan.fd = ::open(part_path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (plan.fd < 0) {
+        result.error_message = "Failed to create file: " + part_path + " (" + std::strerror(errno) + ")";
         return result;
     }
 
-    char errbuf[CURL_ERROR_SIZE] = {0};
-    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, curl_write_stream);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &state);
-    curl_easy_setopt(curl, CURLOPT_ERRORBUFFER, errbuf);
-    // No CURLOPT_TIMEOUT for the body transfer — large model files (10+ GB)
-    // can legitimately take hours on slow links. We rely on LOW_SPEED_LIMIT
-    // to abort genuinely-stalled connections.
-    apply_common_curl_options(curl, 30L, 0L);
-    curl_easy_setopt(curl, CURLOPT_LOW_SPEED_TIME, 60L);   // abort if <10 B/s for 60s
-    curl_easy_setopt(curl, CURLOPT_LOW_SPEED_LIMIT, 10L);
+    if (resumed) {
+        result.resumed_bytes = static_cast<size_t>(plan.downloaded());
+        std::cout << "[DownloadManager] Resuming " << filename << " at "
+                  << (result.resumed_bytes / (1024 * 1024)) << " / " << (plan.total / (1024 * 1024))
+                  << " MB" << std::endl;
+    } else if (plan.ranged) {
+        // Reserve the whole file up front: fails fast on a full disk and keeps
+        // the parallel ranges from fragmenting it
+        int err = ::posix_fallocate(plan.fd, 0, static_cast<off_t>(plan.total));
+        if (err == ENOSPC) {
+            ::close(plan.fd);
+            fs::remove(part_path, ec);
+            result.error_message = "Not enough disk space for " + filename;
+            return result;
+        }
+        if (err != 0 && ::ftruncate(plan.fd, static_cast<off_t>(plan.total)) != 0) {
+            ::close(plan.fd);
+            fs::remove(part_path, ec);
+            result.error_message = "Failed to allocate file: " + part_path + " (" + std::strerror(errno) + ")";
+            return result;
+        }
+    }
 
-    CURLcode rc = curl_easy_perform(curl);
-    long http_code = 0;
-    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
+    if (plan.ranged) {
+        std::cout << "[DownloadManager] Downloading " << filename << " (" << (plan.total / (1024 * 1024))
+                  << " MB) over up to " << options_.connections << " connection(s)";
+        if (options_.max_speed_kbps > 0) {
+            std::cout << ", capped at " << options_.max_speed_kbps << " KiB/s";
+        }
+        std::cout << std::endl;
+    }
 
-    // If we didn't have a Content-Length up front, populate content_type from
-    // the GET response (some servers omit it on HEAD).
-    if (content_type.empty()) {
-        char* ct = nullptr;
-        if (curl_easy_getinfo(curl, CURLINFO_CONTENT_TYPE, &ct) == CURLE_OK && ct) {
-            content_type = ct;
+    // ----- Transfer -----
+    std::string get_content_type;
+    TransferOutcome outcome = run_transfers(transfer_url, plan, options_, meta_path,
+                                            progress_callback, result.error_message, get_content_type);
+    if (outcome == TransferOutcome::RangeIgnored) {
+        std::cerr << "[DownloadManager] Server ignored Range requests, falling back to a single stream" << std::endl;
+        plan.ranged = false;
+        plan.segments.assign(1, Segment{});
+        result.resumed_bytes = 0;
+        if (::ftruncate(plan.fd, 0) != 0) {
+            result.error_message = "Failed to reset file: " + part_path;
+            outcome = TransferOutcome::Failed;
+        } else {
+            outcome = run_transfers(transfer_url, plan, options_, meta_path,
+                                    progress_callback, result.error_message, get_content_type);
         }
     }
+    if (content_type.empty()) {
+        content_type = get_content_type;
+    }
 
-    curl_easy_cleanup(curl);
-    ofs.close();
+    if (outcome == TransferOutcome::Ok) {
+        advance_hash(plan, UINT64_MAX);
+        if (!plan.hash_failed && plan.hashed == plan.total) {
+            result.sha256 = plan.hasher.hex_digest();
+        }
+    }
 
-    if (rc != CURLE_OK) {
-        fs::remove(full_path); // Clean up partial file
-        std::string msg = errbuf[0] ? std::string(errbuf) : std::string(curl_easy_strerror(rc));
-        result.error_message = "Download failed: " + msg;
-        if (http_code) {
-            result.error_message += " (HTTP " + std::to_string(http_code) + ")";
+    if (outcome == TransferOutcome::Ok && ::fdatasync(plan.fd) != 0) {
+        result.error_message = "Failed to flush file: " + part_path + " (" + std::strerror(errno) + ")";
+        outcome = TransferOutcome::Failed;
+    }
+    ::close(plan.fd);
+
+    if (outcome != TransferOutcome::Ok) {
+        if (plan.ranged && options_.resume) {
+            // Keep what we have; the next attempt for this file continues here
+            save_plan(meta_path, plan);
+            result.error_message += " (partial download kept, " +
+                std::to_string(plan.downloaded() / (1024 * 1024)) + " MB; retry to resume)";
+        } else {
+            fs::remove(part_path, ec);
+            fs::remove(meta_path, ec);
+        }
+        if (result.error_message.empty()) {
+            result.error_message = "Download failed";
         }
         return result;
     }
 
-    if (http_code != 0 && http_code != 200) {
-        fs::remove(full_path);
-        result.error_message = "Download failed with HTTP " + std::to_string(http_code);
+    // Verify downloaded file
+    uint64_t written = fs::file_size(part_path, ec);
+    if (ec || written == 0 || (plan.total > 0 && written != plan.total)) {
+        fs::remove(part_path, ec);
+        fs::remove(meta_path, ec);
+        result.error_message = "Downloaded file is empty or incomplete";
         return result;
     }
 
-    // Verify downloaded file
-    if (!fs::exists(full_path) || fs::file_size(full_path) == 0) {
-        fs::remove(full_path);
-        result.error_message = "Downloaded file is empty or missing";
+    fs::rename(part_path, full_path, ec);
+    if (ec) {
+        result.error_message = "Failed to move " + part_path + " into place: " + ec.message();
         return result;
     }
+    fs::remove(meta_path, ec);
 
     result.success = true;
     result.file_path = full_path;
     result.file_name = filename;
-    result.file_size = fs::file_size(full_path);
+    result.file_size = static_cast<size_t>(written);
     result.content_type = content_type;
 
     return result;
@@ -658,6 +1155,21 @@ DownloadResult DownloadManager::download_from_civitai(
         // Download file
         result = download_file(info->download_url, dest_dir, info->filename, progress_callback);
 
+        // CivitAI publishes the file's SHA256; a mismatch means a corrupt or
+        // substituted file, which is worse than no file
+        if (result.success && !info->sha256.empty() && !result.sha256.empty()) {
+            std::string expected = info->sha256;
+            std::transform(expected.begin(), expected.end(), expected.begin(), ::tolower);
+            if (expected != result.sha256) {
+                std::error_code ec;
+                fs::remove(result.file_path, ec);
+                result.success = false;
+                result.error_message = "SHA256 mismatch for " + result.file_name + ": expected " +
+                                       expected + ", got " + result.sha256;
+                return result;
+            }
+        }
+
         if (result.success) {
             result.metadata = {
                 {"source", "civitai"},
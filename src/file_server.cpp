@@ -0,0 +1,712 @@
+#include "file_server.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef SDCPP_HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef SDCPP_HAVE_BROTLI
+#include <brotli/encode.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace sdcpp {
+
+namespace {
+
+// Slices handed to the socket writer per provider call; keeps a dropped
+// connection from being noticed only after a multi-GB write
+constexpr size_t WRITE_SLICE = 4 * 1024 * 1024;
+
+// Assets smaller than this aren't worth a Content-Encoding
+constexpr size_t MIN_COMPRESS_BYTES = 512;
+
+std::string normalize(const std::string& path) {
+    return fs::path(path).lexically_normal().string();
+}
+
+int64_t to_unix_seconds(fs::file_time_type t) {
+    auto sys = std::chrono::file_clock::to_sys(t);
+    return std::chrono::duration_cast<std::chrono::seconds>(sys.time_since_epoch()).count();
+}
+
+std::string http_date(int64_t unix_seconds) {
+    std::time_t t = static_cast<std::time_t>(unix_seconds);
+    std::tm tm{};
+#ifdef _WIN32
+    gmtime_s(&tm, &t);
+#else
+    gmtime_r(&t, &tm);
+#endif
+    char buf[64];
+    std::strftime(buf, sizeof(buf), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+    return buf;
+}
+
+// RFC 1123 date → unix seconds, -1 if unparseable
+int64_t parse_http_date(const std::string& s) {
+    std::tm tm{};
+    std::istringstream in(s);
+    in.imbue(std::locale::classic());
+    in >> std::get_time(&tm, "%a, %d %b %Y %H:%M:%S");
+    if (in.fail()) return -1;
+#ifdef _WIN32
+    return static_cast<int64_t>(_mkgmtime(&tm));
+#else
+    return static_cast<int64_t>(timegm(&tm));
+#endif
+}
+
+std::string trim(const std::string& s) {
+    size_t b = s.find_first_not_of(" \t");
+    if (b == std::string::npos) return "";
+    size_t e = s.find_last_not_of(" \t");
+    return s.substr(b, e - b + 1);
+}
+
+// If-None-Match: comma-separated entity tags or "*", weak comparison
+bool etag_list_matches(const std::string& header, const std::string& etag) {
+    std::string ours = etag.rfind("W/", 0) == 0 ? etag.substr(2) : etag;
+    std::stringstream ss(header);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        item = trim(item);
+        if (item == "*") return true;
+        if (item.rfind("W/", 0) == 0) item = item.substr(2);
+        if (item == ours) return true;
+    }
+    return false;
+}
+
+// Accept-Encoding token check; honours "q=0" as a refusal
+bool accepts_encoding(const std::string& header, const std::string& coding) {
+    std::stringstream ss(header);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        std::string name = item;
+        std::string params;
+        size_t semi = item.find(';');
+        if (semi != std::string::npos) {
+            name = item.substr(0, semi);
+            params = item.substr(semi + 1);
+        }
+        name = trim(name);
+        std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return std::tolower(c); });
+        if (name != coding && name != "*") continue;
+        size_t q = params.find("q=");
+        if (q != std::string::npos) {
+            try {
+                if (std::stod(params.substr(q + 2)) <= 0.0) return false;
+            } catch (...) {
+                return false;
+            }
+        }
+        return true;
+    }
+    return false;
+}
+
+// Per-encoding entity tag: "123-456" → "123-456-br"
+std::string encoded_etag(const std::string& etag, const char* suffix) {
+    if (etag.size() < 2) return etag;
+    return etag.substr(0, etag.size() - 1) + "-" + suffix + "\"";
+}
+
+bool is_compressible(const std::string& mime) {
+    return mime.rfind("text/", 0) == 0
+        || mime.find("javascript") != std::string::npos
+        || mime.find("json") != std::string::npos
+        || mime.find("xml") != std::string::npos
+        || mime.find("svg") != std::string::npos
+        || mime.find("wasm") != std::string::npos;
+}
+
+bool read_whole(const std::string& path, std::string& out) {
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in) return false;
+    auto size = in.tellg();
+    if (size < 0) return false;
+    out.resize(static_cast<size_t>(size));
+    in.seekg(0);
+    in.read(out.data(), size);
+    return static_cast<bool>(in) || size == 0;
+}
+
+// A precompressed sibling (app.js.br next to app.js) written by the build
+std::shared_ptr<const std::string> load_sibling(const std::string& path, const char* ext,
+                                                fs::file_time_type source_mtime) {
+    std::error_code ec;
+    const std::string sibling = path + ext;
+    auto mtime = fs::last_write_time(sibling, ec);
+    if (ec || mtime < source_mtime) return nullptr;
+    auto data = std::make_shared<std::string>();
+    if (!read_whole(sibling, *data) || data->empty()) return nullptr;
+    return data;
+}
+
+std::shared_ptr<const std::string> gzip_encode(const std::string& in) {
+#ifdef SDCPP_HAVE_ZLIB
+    z_stream zs{};
+    // windowBits 15 + 16 = gzip wrapper instead of raw zlib
+    if (deflateInit2(&zs, 9, Z_DEFLATED, 15 + 16, 9, Z_DEFAULT_STRATEGY) != Z_OK) return nullptr;
+    auto out = std::make_shared<std::string>();
+    out->resize(deflateBound(&zs, static_cast<uLong>(in.size())));
+    zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(in.data()));
+    zs.avail_in = static_cast<uInt>(in.size());
+    zs.next_out = reinterpret_cast<Bytef*>(out->data());
+    zs.avail_out = static_cast<uInt>(out->size());
+    int ret = deflate(&zs, Z_FINISH);
+    out->resize(zs.total_out);
+    deflateEnd(&zs);
+    if (ret != Z_STREAM_END) return nullptr;
+    return out;
+#else
+    (void)in;
+    return nullptr;
+#endif
+}
+
+std::shared_ptr<const std::string> brotli_encode(const std::string& in) {
+#ifdef SDCPP_HAVE_BROTLI
+    auto out = std::make_shared<std::string>();
+    size_t out_size = BrotliEncoderMaxCompressedSize(in.size());
+    if (out_size == 0) return nullptr;
+    out->resize(out_size);
+    // Quality 9 rather than 11: within a few percent of max on JS/CSS at a
+    // fraction of the time, and this runs on the first request for the file
+    if (!BrotliEncoderCompress(9, BROTLI_DEFAULT_WINDOW, BROTLI_MODE_TEXT, in.size(),
+                               reinterpret_cast<const uint8_t*>(in.data()), &out_size,
+                               reinterpret_cast<uint8_t*>(out->data()))) {
+        return nullptr;
+    }
+    out->resize(out_size);
+    return out;
+#else
+    (void)in;
+    return nullptr;
+#endif
+}
+
+// Read-only mapping of a whole file; unmapped when the last response using
+// it is done. Outputs and WebDAV PUTs are replaced by rename, so a mapping
+// keeps seeing the old contents instead of being truncated under us.
+class MappedFile {
+public:
+    static std::shared_ptr<MappedFile> open(const std::string& path) {
+#ifndef _WIN32
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return nullptr;
+        struct stat st{};
+        if (::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+            ::close(fd);
+            return nullptr;
+        }
+        auto file = std::shared_ptr<MappedFile>(new MappedFile());
+        file->size_ = static_cast<size_t>(st.st_size);
+        if (file->size_ > 0) {
+            void* p = ::mmap(nullptr, file->size_, PROT_READ, MAP_SHARED, fd, 0);
+            if (p == MAP_FAILED) {
+                ::close(fd);
+                return nullptr;
+            }
+            ::madvise(p, file->size_, MADV_SEQUENTIAL);
+            file->data_ = static_cast<const char*>(p);
+        }
+        ::close(fd);    // The mapping holds its own reference
+        return file;
+#else
+        (void)path;
+        return nullptr;
+#endif
+    }
+
+    ~MappedFile() {
+#ifndef _WIN32
+        if (data_) ::munmap(const_cast<char*>(data_), size_);
+#endif
+    }
+
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    MappedFile() = default;
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+} // namespace
+
+FileServer::FileServer(size_t asset_cache_bytes)
+    : asset_budget_(asset_cache_bytes) {}
+
+bool FileServer::validators_for(const std::string& path, Validators& out) {
+    const auto now = std::chrono::steady_clock::now();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = validators_.find(path);
+        if (it != validators_.end() && now - it->second.checked < REVALIDATE_INTERVAL) {
+            out = it->second;
+            return true;
+        }
+    }
+
+    std::error_code ec;
+    fs::directory_entry entry(path, ec);       // One stat(), cached by the entry
+    if (ec || !entry.is_regular_file(ec)) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        validators_.erase(path);
+        return false;
+    }
+    Validators v;
+    v.size = entry.file_size(ec);
+    if (ec) return false;
+    auto mtime = entry.last_write_time(ec);
+    if (ec) return false;
+    v.mtime_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(mtime.time_since_epoch()).count();
+    const int64_t unix_seconds = to_unix_seconds(mtime);
+    // Same "size-mtime" form as before, so existing browser caches stay valid
+    v.etag = "\"" + std::to_string(v.size) + "-" + std::to_string(unix_seconds) + "\"";
+    v.last_modified = http_date(unix_seconds);
+    v.checked = now;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    // Bounded by clearing: entries are cheap to rebuild and a gallery crawl
+    // that fills the map is exactly the case where old entries are cold
+    if (validators_.size() >= 8192) validators_.clear();
+    validators_[path] = v;
+    out = v;
+    return true;
+}
+
+bool FileServer::not_modified(const httplib::Request& req, httplib::Response& res,
+                              const std::string& etag, const std::string& last_modified) {
+    // If-None-Match wins over If-Modified-Since when both are present
+    const std::string inm = req.get_header_value("If-None-Match");
+    bool match;
+    if (!inm.empty()) {
+        match = etag_list_matches(inm, etag);
+    } else {
+        const std::string ims = req.get_header_value("If-Modified-Since");
+        if (ims.empty()) return false;
+        if (ims == last_modified) {
+            match = true;
+        } else {
+            const int64_t since = parse_http_date(ims);
+            const int64_t modified = parse_http_date(last_modified);
+            match = since >= 0 && modified >= 0 && modified <= since;
+        }
+    }
+    if (match) {
+        res.status = 304;
+        not_modified_++;
+    }
+    return match;
+}
+
+bool FileServer::serve(const httplib::Request& req, httplib::Response& res,
+                       const std::string& path_in, const std::string& mime,
+                       const std::string& cache_control, bool head_only) {
+    const std::string path = normalize(path_in);
+    Validators v;
+    if (!validators_for(path, v)) return false;
+
+    std::shared_ptr<MappedFile> file;
+    std::shared_ptr<std::ifstream> stream;     // No mmap (Windows, odd filesystems)
+    if (!head_only) {
+        file = MappedFile::open(path);
+        if (file && file->size() != v.size) {
+            // Replaced since the validators were cached: refresh them so the
+            // ETag describes the bytes we're about to send
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                validators_.erase(path);
+            }
+            if (!validators_for(path, v)) return false;
+        }
+        if (!file) {
+            stream = std::make_shared<std::ifstream>(path, std::ios::binary);
+            if (!stream->is_open()) return false;
+        }
+    }
+
+    res.set_header("ETag", v.etag);
+    res.set_header("Last-Modified", v.last_modified);
+    if (!cache_control.empty()) res.set_header("Cache-Control", cache_control);
+    if (not_modified(req, res, v.etag, v.last_modified)) return true;
+    res.set_header("Accept-Ranges", "bytes");
+
+    if (head_only) {
+        res.status = 200;
+        res.set_header("Content-Length", std::to_string(v.size));
+        res.set_header("Content-Type", mime);
+        return true;
+    }
+
+    // If-Range: a stale validator means the client's partial copy is of an
+    // older file; send the whole thing (explicit 200 stops httplib from
+    // applying the Range on top of the provider)
+    if (req.has_header("Range") && req.has_header("If-Range")) {
+        const std::string if_range = req.get_header_value("If-Range");
+        const bool fresh = (!if_range.empty() && if_range.front() == '"') ? if_range == v.etag
+                                                                         : if_range == v.last_modified;
+        if (!fresh) res.status = 200;
+    }
+
+    if (file) {
+        mapped_++;
+        res.set_content_provider(
+            file->size(), mime,
+            [file](size_t offset, size_t length, httplib::DataSink& sink) -> bool {
+                // Fixed-length provider: write exactly `length` bytes from
+                // `offset`, no sink.done() (see httplib's provider contract)
+                const char* p = file->data() + offset;
+                while (length > 0) {
+                    const size_t n = std::min(length, WRITE_SLICE);
+                    if (!sink.write(p, n)) return false;   // Client went away
+                    p += n;
+                    length -= n;
+                }
+                return true;
+            });
+        return true;
+    }
+
+    // Chunked reads through the stream opened above
+    res.set_content_provider(
+        static_cast<size_t>(v.size), mime,
+        [ifs = stream](size_t offset, size_t length, httplib::DataSink& sink) -> bool {
+            ifs->seekg(static_cast<std::streamoff>(offset), std::ios::beg);
+            std::vector<char> buf(std::min<size_t>(length, 256 * 1024));
+            size_t remaining = length;
+            while (remaining > 0 && *ifs) {
+                ifs->read(buf.data(), static_cast<std::streamsize>(std::min(remaining, buf.size())));
+                auto n = ifs->gcount();
+                if (n <= 0) break;
+                if (!sink.write(buf.data(), static_cast<size_t>(n))) return false;
+                remaining -= static_cast<size_t>(n);
+            }
+            return remaining == 0;
+        });
+    return true;
+}
+
+std::shared_ptr<const FileServer::Asset> FileServer::load_asset(const std::string& path,
+                                                               const std::string& mime,
+                                                               const Validators& validators) {
+    auto identity = std::make_shared<std::string>();
+    if (!read_whole(path, *identity)) return nullptr;
+
+    auto asset = std::make_shared<Asset>();
+    asset->validators = validators;
+    asset->mime = mime;
+    asset->identity = identity;
+
+    if (is_compressible(mime) && identity->size() >= MIN_COMPRESS_BYTES) {
+        std::error_code ec;
+        auto mtime = fs::last_write_time(path, ec);
+        if (!ec) {
+            asset->brotli = load_sibling(path, ".br", mtime);
+            asset->gzip = load_sibling(path, ".gz", mtime);
+        }
+        if (!asset->brotli) asset->brotli = brotli_encode(*identity);
+        if (!asset->gzip) asset->gzip = gzip_encode(*identity);
+
+        // An encoding that doesn't save at least 10% isn't worth the Vary
+        auto worth = [&](const std::shared_ptr<const std::string>& enc) {
+            return enc && enc->size() < identity->size() - identity->size() / 10;
+        };
+        if (!worth(asset->brotli)) asset->brotli.reset();
+        if (!worth(asset->gzip)) asset->gzip.reset();
+    }
+
+    asset->bytes = identity->size()
+                 + (asset->gzip ? asset->gzip->size() : 0)
+                 + (asset->brotli ? asset->brotli->size() : 0);
+    asset_loads_++;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    insert_asset_locked(path, asset);
+    return asset;
+}
+
+void FileServer::insert_asset_locked(const std::string& path, std::shared_ptr<Asset> asset) {
+    auto existing = assets_.find(path);
+    if (existing != assets_.end()) {
+        asset_bytes_ -= existing->second->bytes;
+        asset_lru_.erase(existing->second->lru_it);
+        assets_.erase(existing);
+    }
+    if (asset->bytes > asset_budget_) return;
+    while (asset_bytes_ + asset->bytes > asset_budget_ && !asset_lru_.empty()) {
+        auto victim = assets_.find(asset_lru_.back());
+        if (victim != assets_.end()) {
+            asset_bytes_ -= victim->second->bytes;
+            assets_.erase(victim);
+        }
+        asset_lru_.pop_back();
+    }
+    asset_lru_.push_front(path);
+    asset->lru_it = asset_lru_.begin();
+    asset_bytes_ += asset->bytes;
+    assets_[path] = std::move(asset);
+}
+
+bool FileServer::serve_asset(const httplib::Request& req, httplib::Response& res,
+                             const std::string& path_in, const std::string& mime,
+                             const std::string& cache_control) {
+    const std::string path = normalize(path_in);
+    Validators v;
+    if (!validators_for(path, v)) return false;
+    if (v.size > asset_budget_ / 4) {
+        return serve(req, res, path, mime, cache_control);
+    }
+
+    std::shared_ptr<const Asset> asset;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = assets_.find(path);
+        if (it != assets_.end() && it->second->validators.size == v.size
+                && it->second->validators.mtime_ns == v.mtime_ns) {
+            asset_lru_.splice(asset_lru_.begin(), asset_lru_, it->second->lru_it);
+            asset = it->second;
+        }
+    }
+    if (asset) {
+        asset_hits_++;
+    } else {
+        // Concurrent first requests may both load; the later insert wins
+        asset = load_asset(path, mime, v);
+        if (!asset) return false;
+    }
+
+    const std::string accept = req.get_header_value("Accept-Encoding");
+    std::shared_ptr<const std::string> body = asset->identity;
+    std::string etag = v.etag;
+    const char* coding = nullptr;
+    if (asset->brotli && accepts_encoding(accept, "br")) {
+        body = asset->brotli;
+        coding = "br";
+        etag = encoded_etag(v.etag, "br");
+    } else if (asset->gzip && accepts_encoding(accept, "gzip")) {
+        body = asset->gzip;
+        coding = "gzip";
+        etag = encoded_etag(v.etag, "gz");
+    }
+
+    if (asset->brotli || asset->gzip) res.set_header("Vary", "Accept-Encoding");
+    res.set_header("ETag", etag);
+    res.set_header("Last-Modified", v.last_modified);
+    if (!cache_control.empty()) res.set_header("Cache-Control", cache_control);
+    if (not_modified(req, res, etag, v.last_modified)) return true;
+
+    if (coding) {
+        res.set_header("Content-Encoding", coding);
+        (coding[0] == 'b' ? brotli_responses_ : gzip_responses_)++;
+    }
+    res.set_header("Accept-Ranges", "bytes");
+    if (req.has_header("Range") && req.has_header("If-Range")) {
+        const std::string if_range = req.get_header_value("If-Range");
+        const bool fresh = (!if_range.empty() && if_range.front() == '"') ? if_range == etag
+                                                                         : if_range == v.last_modified;
+        if (!fresh) res.status = 200;
+    }
+
+    // The response shares the cached buffer; eviction can't pull it out
+    // from under a transfer in progress
+    res.set_content_provider(
+        body->size(), asset->mime,
+        [body](size_t offset, size_t length, httplib::DataSink& sink) -> bool {
+            return sink.write(body->data() + offset, length);
+        });
+    return true;
+}
+
+CachedDocument::CachedDocument(std::string body, std::string mime)
+    : mime_(std::move(mime)),
+      identity_(std::make_shared<const std::string>(std::move(body))) {
+    char hash[17];
+    std::snprintf(hash, sizeof(hash), "%016zx", std::hash<std::string>{}(*identity_));
+    etag_ = "\"" + std::string(hash) + "-" + std::to_string(identity_->size()) + "\"";
+
+    if (is_compressible(mime_) && identity_->size() >= MIN_COMPRESS_BYTES) {
+        const size_t limit = identity_->size() - identity_->size() / 10;
+        brotli_ = brotli_encode(*identity_);
+        gzip_ = gzip_encode(*identity_);
+        if (brotli_ && brotli_->size() >= limit) brotli_.reset();
+        if (gzip_ && gzip_->size() >= limit) gzip_.reset();
+    }
+}
+
+void CachedDocument::serve(const httplib::Request& req, httplib::Response& res,
+                           const std::string& cache_control) const {
+    const std::string accept = req.get_header_value("Accept-Encoding");
+    std::shared_ptr<const std::string> body = identity_;
+    std::string etag = etag_;
+    const char* coding = nullptr;
+    if (brotli_ && accepts_encoding(accept, "br")) {
+        body = brotli_;
+        coding = "br";
+        etag = encoded_etag(etag_, "br");
+    } else if (gzip_ && accepts_encoding(accept, "gzip")) {
+        body = gzip_;
+        coding = "gzip";
+        etag = encoded_etag(etag_, "gz");
+    }
+
+    if (brotli_ || gzip_) res.set_header("Vary", "Accept-Encoding");
+    res.set_header("ETag", etag);
+    if (!cache_control.empty()) res.set_header("Cache-Control", cache_control);
+    const std::string inm = req.get_header_value("If-None-Match");
+    if (!inm.empty() && etag_list_matches(inm, etag)) {
+        res.status = 304;
+        return;
+    }
+
+    if (coding) res.set_header("Content-Encoding", coding);
+    res.set_content_provider(
+        body->size(), mime_,
+        [body](size_t offset, size_t length, httplib::DataSink& sink) -> bool {
+            return sink.write(body->data() + offset, length);
+        });
+}
+
+std::shared_ptr<const FileServer::DirListing> FileServer::list_directory(const std::string& path_in) {
+    std::string path = normalize(path_in);
+    if (path.size() > 1 && path.back() == '/') path.pop_back();
+    const auto now = std::chrono::steady_clock::now();
+    std::shared_ptr<const DirListing> cached;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = listings_.find(path);
+        if (it != listings_.end()) {
+            if (now - it->second->checked < REVALIDATE_INTERVAL) {
+                listing_hits_++;
+                return it->second;
+            }
+            cached = it->second;
+        }
+    }
+
+    std::error_code ec;
+    auto dir_mtime = fs::last_write_time(path, ec);
+    if (ec || !fs::is_directory(path, ec)) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        listings_.erase(path);
+        return nullptr;
+    }
+    const int64_t mtime_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        dir_mtime.time_since_epoch()).count();
+
+    auto listing = std::make_shared<DirListing>();
+    listing->checked = now;
+    listing->mtime_ns = mtime_ns;
+    if (cached && cached->mtime_ns == mtime_ns) {
+        // Unchanged: keep the entries, restart the revalidation clock
+        listing_hits_++;
+        listing->entries = cached->entries;
+        listing->truncated = cached->truncated;
+    } else {
+        listing_loads_++;
+        for (const auto& de : fs::directory_iterator(path, fs::directory_options::skip_permission_denied, ec)) {
+            if (listing->entries.size() >= MAX_LISTING_ENTRIES) {
+                listing->truncated = true;
+                break;
+            }
+            std::error_code ec2;
+            DirEntry e;
+            e.name = de.path().filename().string();
+            e.is_dir = de.is_directory(ec2);
+            if (!e.is_dir) e.size = de.file_size(ec2);
+            auto mtime = de.last_write_time(ec2);
+            if (!ec2) e.last_modified = http_date(to_unix_seconds(mtime));
+            listing->entries.push_back(std::move(e));
+        }
+        if (ec && listing->entries.empty()) return nullptr;
+        std::sort(listing->entries.begin(), listing->entries.end(),
+                  [](const DirEntry& a, const DirEntry& b) { return a.name < b.name; });
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (listings_.size() >= 1024) listings_.clear();
+    listings_[path] = listing;
+    return listing;
+}
+
+void FileServer::invalidate(const std::string& path_in) {
+    const std::string path = normalize(path_in);
+    std::string prefix = path;
+    if (!prefix.empty() && prefix.back() != '/') prefix += '/';
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    const std::string dir = prefix.substr(0, prefix.size() - 1);
+    listings_.erase(fs::path(dir).parent_path().string());
+    for (auto it = listings_.begin(); it != listings_.end();) {
+        if (it->first == dir || it->first.rfind(prefix, 0) == 0) it = listings_.erase(it);
+        else ++it;
+    }
+    for (auto it = validators_.begin(); it != validators_.end();) {
+        if (it->first == path || it->first.rfind(prefix, 0) == 0) it = validators_.erase(it);
+        else ++it;
+    }
+    for (auto it = assets_.begin(); it != assets_.end();) {
+        if (it->first == path || it->first.rfind(prefix, 0) == 0) {
+            asset_bytes_ -= it->second->bytes;
+            asset_lru_.erase(it->second->lru_it);
+            it = assets_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+nlohmann::json FileServer::stats_json() const {
+    nlohmann::json j;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        j["validator_entries"] = validators_.size();
+        j["asset_entries"] = assets_.size();
+        j["asset_bytes"] = asset_bytes_;
+        j["listing_entries"] = listings_.size();
+    }
+    j["listing_hits"] = listing_hits_.load();
+    j["listing_loads"] = listing_loads_.load();
+    j["asset_budget_bytes"] = asset_budget_;
+    j["mapped"] = mapped_.load();
+    j["not_modified"] = not_modified_.load();
+    j["asset_hits"] = asset_hits_.load();
+    j["asset_loads"] = asset_loads_.load();
+    j["gzip"] = gzip_responses_.load();
+    j["brotli"] = brotli_responses_.load();
+#ifdef SDCPP_HAVE_ZLIB
+    const bool have_gzip = true;
+#else
+    const bool have_gzip = false;
+#endif
+#ifdef SDCPP_HAVE_BROTLI
+    const bool have_brotli = true;
+#else
+    const bool have_brotli = false;
+#endif
+    j["codecs"] = {{"gzip", have_gzip}, {"brotli", have_brotli}};
+    return j;
+}
+
+} // namespace sdcpp
@@ -0,0 +1,1385 @@
+#include "http_front_end.hpp"
+#include "url_utils.hpp"
+
+#include <iostream>
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <chrono>
+#include <cstring>
+#include <string_view>
+#include <stdexcept>
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <cerrno>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+#endif
+
+namespace sdcpp {
+
+#ifdef __linux__
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr size_t MAX_HEAD_BYTES = 64 * 1024;
+constexpr size_t READ_CHUNK = 64 * 1024;
+// Stop reading from one side while this much is waiting to go out the other
+constexpr size_t HIGH_WATER = 1024 * 1024;
+// Frames are pulled from a WebSocket client's outbox only while less than
+// this is queued for its socket, so the outbox's drop policy still applies
+constexpr size_t WS_HIGH_WATER = 256 * 1024;
+constexpr size_t WS_MAX_MESSAGE = 1024 * 1024;
+constexpr auto WS_PING_INTERVAL = std::chrono::seconds(30);
+constexpr auto WS_IDLE_LIMIT = std::chrono::seconds(120);
+constexpr auto SWEEP_INTERVAL = std::chrono::seconds(1);
+constexpr int MAX_EVENTS = 256;
+
+// epoll tags: connection keys start at 1, so (key << 1) | backend never
+// collides with these
+constexpr uint64_t TAG_LISTENER = 0;
+constexpr uint64_t TAG_WAKE = 1;
+
+constexpr const char* WS_GUID = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+char ascii_lower(char c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+bool iequals(const std::string& a, const char* b) {
+    const size_t n = std::strlen(b);
+    if (a.size() != n) return false;
+    for (size_t i = 0; i < n; ++i) {
+        if (ascii_lower(a[i]) != ascii_lower(b[i])) return false;
+    }
+    return true;
+}
+
+std::string trim(const std::string& s) {
+    const size_t a = s.find_first_not_of(" \t");
+    if (a == std::string::npos) return "";
+    const size_t b = s.find_last_not_of(" \t");
+    return s.substr(a, b - a + 1);
+}
+
+// Case-insensitive token match in a comma-separated header value
+bool has_token(const std::string& list, const char* token) {
+    size_t pos = 0;
+    while (pos <= list.size()) {
+        size_t end = list.find(',', pos);
+        if (end == std::string::npos) end = list.size();
+        if (iequals(trim(list.substr(pos, end - pos)), token)) return true;
+        pos = end + 1;
+    }
+    return false;
+}
+
+std::string url_decode(const std::string& s, bool plus_as_space) {
+    std::string out;
+    out.reserve(s.size());
+    auto hex = [](char c) -> int {
+        if (c >= '0' && c <= '9') return c - '0';
+        c = ascii_lower(c);
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        return -1;
+    };
+    for (size_t i = 0; i < s.size(); ++i) {
+        if (s[i] == '%' && i + 2 < s.size() && hex(s[i + 1]) >= 0 && hex(s[i + 2]) >= 0) {
+            out.push_back(static_cast<char>(hex(s[i + 1]) * 16 + hex(s[i + 2])));
+            i += 2;
+        } else if (s[i] == '+' && plus_as_space) {
+            out.push_back(' ');
+        } else {
+            out.push_back(s[i]);
+        }
+    }
+    return out;
+}
+
+std::string websocket_accept(const std::string& key) {
+    const std::string input = key + WS_GUID;
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned int digest_len = 0;
+    EVP_Digest(input.data(), input.size(), digest, &digest_len, EVP_sha1(), nullptr);
+    unsigned char encoded[64];
+    const int n = EVP_EncodeBlock(encoded, digest, static_cast<int>(digest_len));
+    return std::string(reinterpret_cast<const char*>(encoded), n > 0 ? static_cast<size_t>(n) : 0);
+}
+
+struct Header {
+    std::string name;
+    std::string value;
+};
+
+struct RequestHead {
+    std::string method;
+    std::string target;
+    std::string version;
+    std::vector<Header> headers;
+
+    const std::string* get(const char* name) const {
+        for (const auto& h : headers) {
+            if (iequals(h.name, name)) return &h.value;
+        }
+        return nullptr;
+    }
+    size_t count(const char* name) const {
+        size_t n = 0;
+        for (const auto& h : headers) {
+            if (iequals(h.name, name)) ++n;
+        }
+        return n;
+    }
+};
+
+// Parse a request head (without the terminating blank line). Obsolete line
+// folding and header names with whitespace are rejected, like httplib does.
+bool parse_request_head(const std::string& raw, RequestHead& out) {
+    size_t line_end = raw.find("\r\n");
+    const std::string line = raw.substr(0, line_end);
+    const size_t sp1 = line.find(' ');
+    const size_t sp2 = sp1 == std::string::npos ? std::string::npos : line.find(' ', sp1 + 1);
+    if (sp1 == std::string::npos || sp2 == std::string::npos || sp1 == 0 || sp2 == sp1 + 1) return false;
+    out.method = line.substr(0, sp1);
+    out.target = line.substr(sp1 + 1, sp2 - sp1 - 1);
+    out.version = line.substr(sp2 + 1);
+    if (out.version.compare(0, 5, "HTTP/") != 0) return false;
+
+    size_t pos = line_end == std::string::npos ? raw.size() : line_end + 2;
+    while (pos < raw.size()) {
+        line_end = raw.find("\r\n", pos);
+        if (line_end == std::string::npos) line_end = raw.size();
+        const std::string h = raw.substr(pos, line_end - pos);
+        pos = line_end + 2;
+        if (h.empty()) continue;
+        const size_t colon = h.find(':');
+        if (colon == std::string::npos || colon == 0) return false;
+        if (h[0] == ' ' || h[0] == '\t' || h.find_first_of(" \t") < colon) return false;
+        out.headers.push_back({h.substr(0, colon), trim(h.substr(colon + 1))});
+    }
+    return true;
+}
+
+int parse_status(const std::string& head) {
+    // "HTTP/1.1 200 OK"
+    const size_t sp = head.find(' ');
+    if (sp == std::string::npos || head.size() < sp + 4) return 0;
+    int status = 0;
+    for (size_t i = sp + 1; i < sp + 4; ++i) {
+        if (head[i] < '0' || head[i] > '9') return 0;
+        status = status * 10 + (head[i] - '0');
+    }
+    return status;
+}
+
+// Replace the backend's Connection header (always "close", because that's
+// what we asked for) with what the client connection will actually do.
+// Returns whether the client connection can stay open after this response.
+bool rewrite_response_head(const std::string& head, int status, bool head_request,
+                           bool keep_alive, std::string& out) {
+    bool delimited = head_request || status == 204 || status == 304;
+    std::string kept;
+    size_t pos = head.find("\r\n");
+    const std::string status_line = head.substr(0, pos);
+    pos += 2;
+    while (pos < head.size()) {
+        size_t end = head.find("\r\n", pos);
+        if (end == std::string::npos) end = head.size();
+        const std::string line = head.substr(pos, end - pos);
+        pos = end + 2;
+        if (line.empty()) continue;
+        const size_t colon = line.find(':');
+        const std::string name = colon == std::string::npos ? line : line.substr(0, colon);
+        if (iequals(name, "Connection") || iequals(name, "Keep-Alive")) continue;
+        if (iequals(name, "Content-Length")) delimited = true;
+        if (iequals(name, "Transfer-Encoding") && colon != std::string::npos &&
+            has_token(line.substr(colon + 1), "chunked")) {
+            delimited = true;
+        }
+        kept += line;
+        kept += "\r\n";
+    }
+    const bool keep = keep_alive && delimited && status != 101;
+    out = status_line + "\r\n" + kept +
+          (keep ? "Connection: keep-alive\r\n\r\n" : "Connection: close\r\n\r\n");
+    return keep;
+}
+
+std::string plain_response(int status, const char* reason, const std::string& json_body,
+                           const char* extra_headers = "") {
+    return "HTTP/1.1 " + std::to_string(status) + " " + reason + "\r\n"
+           "Content-Type: application/json\r\n"
+           "Content-Length: " + std::to_string(json_body.size()) + "\r\n" +
+           extra_headers +
+           "Connection: close\r\n\r\n" + json_body;
+}
+
+std::string error_body(const std::string& message) {
+    return nlohmann::json{{"error", message}}.dump();
+}
+
+/**
+ * Byte queue with a read offset, so consuming from the front is O(1)
+ */
+struct Buffer {
+    std::string data;
+    size_t off = 0;
+
+    size_t size() const { return data.size() - off; }
+    bool empty() const { return off == data.size(); }
+    const char* ptr() const { return data.data() + off; }
+    std::string_view view() const { return std::string_view(data).substr(off); }
+    void append(const char* p, size_t n) { data.append(p, n); }
+    void append(const std::string& s) { data.append(s); }
+    void consume(size_t n) {
+        off += n;
+        if (off >= data.size()) {
+            data.clear();
+            off = 0;
+        } else if (off > READ_CHUNK && off * 2 > data.size()) {
+            data.erase(0, off);
+            off = 0;
+        }
+    }
+    void clear() { data.clear(); off = 0; }
+};
+
+/**
+ * Finds the end of a chunked request body without decoding it
+ */
+struct ChunkScanner {
+    enum class State { Size, Data, DataEnd, Trailer, Done };
+    State state = State::Size;
+    uint64_t remaining = 0;
+    std::string line;
+
+    static constexpr size_t MALFORMED = static_cast<size_t>(-1);
+
+    // Returns how many bytes of `data` belong to the body (state Done once
+    // the last one is seen), or MALFORMED
+    size_t feed(const char* data, size_t len) {
+        size_t i = 0;
+        while (i < len && state != State::Done) {
+            switch (state) {
+                case State::Size:
+                case State::Trailer: {
+                    const char c = data[i++];
+                    if (c != '\n') {
+                        if (line.size() > 4096) return MALFORMED;
+                        line.push_back(c);
+                        break;
+                    }
+                    if (!line.empty() && line.back() == '\r') line.pop_back();
+                    if (state == State::Trailer) {
+                        if (line.empty()) state = State::Done;
+                        line.clear();
+                        break;
+                    }
+                    const std::string digits = trim(line.substr(0, line.find(';')));
+                    line.clear();
+                    if (digits.empty() || digits.size() > 15) return MALFORMED;
+                    uint64_t size = 0;
+                    for (char d : digits) {
+                        d = ascii_lower(d);
+                        int v = (d >= '0' && d <= '9') ? d - '0' : (d >= 'a' && d <= 'f') ? d - 'a' + 10 : -1;
+                        if (v < 0) return MALFORMED;
+                        size = size * 16 + static_cast<uint64_t>(v);
+                    }
+                    if (size == 0) {
+                        state = State::Trailer;
+                    } else {
+                        remaining = size;
+                        state = State::Data;
+                    }
+                    break;
+                }
+                case State::Data: {
+                    const size_t n = static_cast<size_t>(std::min<uint64_t>(remaining, len - i));
+                    i += n;
+                    remaining -= n;
+                    if (remaining == 0) state = State::DataEnd;
+                    break;
+                }
+                case State::DataEnd: {
+                    const char c = data[i++];
+                    if (c == '\n') state = State::Size;
+                    else if (c != '\r') return MALFORMED;
+                    break;
+                }
+                case State::Done:
+                    break;
+            }
+        }
+        return i;
+    }
+};
+
+void append_frame(Buffer& out, uint8_t opcode, const char* payload, size_t len) {
+    char hdr[10];
+    size_t n = 2;
+    hdr[0] = static_cast<char>(0x80 | opcode);
+    if (len < 126) {
+        hdr[1] = static_cast<char>(len);
+    } else if (len <= 0xffff) {
+        hdr[1] = 126;
+        hdr[2] = static_cast<char>((len >> 8) & 0xff);
+        hdr[3] = static_cast<char>(len & 0xff);
+        n = 4;
+    } else {
+        hdr[1] = 127;
+        for (int i = 0; i < 8; ++i) {
+            hdr[2 + i] = static_cast<char>((static_cast<uint64_t>(len) >> (56 - 8 * i)) & 0xff);
+        }
+        n = 10;
+    }
+    out.append(hdr, n);
+    out.append(payload, len);
+}
+
+void append_close_frame(Buffer& out, uint16_t code) {
+    const char payload[2] = {static_cast<char>(code >> 8), static_cast<char>(code & 0xff)};
+    append_frame(out, 0x8, payload, sizeof(payload));
+}
+
+std::string peer_string(const sockaddr_storage& ss) {
+    char buf[INET6_ADDRSTRLEN] = {0};
+    if (ss.ss_family == AF_INET) {
+        inet_ntop(AF_INET, &reinterpret_cast<const sockaddr_in&>(ss).sin_addr, buf, sizeof(buf));
+    } else if (ss.ss_family == AF_INET6) {
+        inet_ntop(AF_INET6, &reinterpret_cast<const sockaddr_in6&>(ss).sin6_addr, buf, sizeof(buf));
+    }
+    std::string s = buf;
+    // Dual-stack sockets report IPv4 peers as ::ffff:a.b.c.d
+    if (s.compare(0, 7, "::ffff:") == 0 && s.find('.') != std::string::npos) s = s.substr(7);
+    return s;
+}
+
+enum class ConnState { Head, Proxy, WebSocket };
+enum class BodyFraming { None, Length, Chunked };
+
+struct Conn {
+    uint64_t key = 0;
+    int fd = -1;
+    std::string peer;
+    ConnState state = ConnState::Head;
+    Buffer in;
+    Buffer out;
+    uint32_t events = 0;                // Current epoll interest
+    bool client_eof = false;
+    bool close_after = false;           // Close once `out` is flushed
+    bool served = false;                // Finished at least one request
+    Clock::time_point since;            // Head: idle/head wait start; WebSocket: last frame in
+
+    // Proxy
+    int backend = -1;
+    uint32_t backend_events = 0;
+    bool backend_connected = false;
+    bool backend_write_failed = false;
+    Buffer to_backend;
+    BodyFraming body = BodyFraming::None;
+    uint64_t body_remaining = 0;
+    ChunkScanner chunks;
+    bool request_done = false;
+    bool queued = false;                // Waiting for a handler slot
+    bool keep_alive = true;
+    bool head_request = false;
+    bool response_started = false;
+    std::string response_head;          // Backend bytes until the final head is complete
+
+    // WebSocket
+    size_t ws_id = 0;
+    bool ws_registered = false;
+    bool ws_closing = false;
+    uint8_t ws_opcode = 0;              // Opcode of a fragmented message in progress
+    std::string ws_message;
+    Clock::time_point ws_last_ping;
+};
+
+} // namespace
+
+struct HttpFrontEnd::Loop {
+    HttpFrontEnd& fe;
+    int epoll_fd = -1;
+    int listen_fd = -1;
+    int wake_fd = -1;
+    bool listening = false;
+    sockaddr_in backend_addr{};
+
+    std::unordered_map<uint64_t, std::unique_ptr<Conn>> conns;
+    std::deque<uint64_t> waiting;       // Requests queued for a handler slot
+    uint64_t next_key = 1;
+    std::vector<char> read_buf = std::vector<char>(READ_CHUNK);
+    Clock::time_point last_sweep = Clock::now();
+
+    std::atomic<bool> stopping{false};
+    std::atomic<bool> quit{false};
+    bool stop_handled = false;
+
+    std::mutex woken_mutex;
+    std::vector<uint64_t> woken;        // Guarded by woken_mutex
+
+    explicit Loop(HttpFrontEnd& owner) : fe(owner) {}
+
+    ~Loop() {
+        if (listen_fd >= 0) ::close(listen_fd);
+        if (wake_fd >= 0) ::close(wake_fd);
+        if (epoll_fd >= 0) ::close(epoll_fd);
+    }
+
+    void signal() {
+        const uint64_t one = 1;
+        if (::write(wake_fd, &one, sizeof(one)) < 0) { /* counter saturated - already pending */ }
+    }
+
+    // Called by the WebSocketServer from any thread
+    void wake(uint64_t key) {
+        bool first;
+        {
+            std::lock_guard<std::mutex> lock(woken_mutex);
+            first = woken.empty();
+            woken.push_back(key);
+        }
+        if (first) signal();
+    }
+
+    void bind_listener() {
+        addrinfo hints{};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        hints.ai_flags = AI_PASSIVE;
+        addrinfo* res = nullptr;
+        const std::string port = std::to_string(fe.options_.port);
+        const char* host = fe.options_.host.empty() ? nullptr : fe.options_.host.c_str();
+        if (int rc = getaddrinfo(host, port.c_str(), &hints, &res); rc != 0) {
+            throw std::runtime_error("Cannot resolve " + fe.options_.host + ": " + gai_strerror(rc));
+        }
+        std::string error = "no usable address";
+        for (addrinfo* ai = res; ai; ai = ai->ai_next) {
+            int fd = ::socket(ai->ai_family, ai->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, ai->ai_protocol);
+            if (fd < 0) continue;
+            int one = 1;
+            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+            if (::bind(fd, ai->ai_addr, ai->ai_addrlen) == 0 && ::listen(fd, SOMAXCONN) == 0) {
+                listen_fd = fd;
+                break;
+            }
+            error = std::strerror(errno);
+            ::close(fd);
+        }
+        freeaddrinfo(res);
+        if (listen_fd < 0) {
+            throw std::runtime_error("Failed to bind " + fe.options_.host + ":" +
+                                     std::to_string(fe.options_.port) + ": " + error);
+        }
+    }
+
+    void setup() {
+        epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (epoll_fd < 0 || wake_fd < 0) {
+            throw std::runtime_error(std::string("epoll setup failed: ") + std::strerror(errno));
+        }
+        bind_listener();
+
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.u64 = TAG_WAKE;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wake_fd, &ev);
+        resume_listening();
+
+        backend_addr.sin_family = AF_INET;
+        backend_addr.sin_port = htons(static_cast<uint16_t>(fe.options_.backend_port));
+        backend_addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    }
+
+    void resume_listening() {
+        if (listening || listen_fd < 0) return;
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.u64 = TAG_LISTENER;
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &ev) == 0) listening = true;
+    }
+
+    void pause_listening() {
+        if (!listening) return;
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, listen_fd, nullptr);
+        listening = false;
+    }
+
+    // ── Main loop ───────────────────────────────────────────────────────
+
+    void run() {
+        std::vector<epoll_event> events(MAX_EVENTS);
+        while (!quit.load()) {
+            const int n = epoll_wait(epoll_fd, events.data(), MAX_EVENTS, 1000);
+            if (n < 0 && errno != EINTR) {
+                std::cerr << "[FrontEnd] epoll_wait failed: " << std::strerror(errno) << std::endl;
+                break;
+            }
+            for (int i = 0; i < n; ++i) {
+                const uint64_t tag = events[i].data.u64;
+                if (tag == TAG_LISTENER) {
+                    accept_all();
+                } else if (tag == TAG_WAKE) {
+                    on_wake();
+                } else {
+                    auto it = conns.find(tag >> 1);
+                    if (it == conns.end()) continue;    // Closed earlier in this batch
+                    if (tag & 1) on_backend(*it->second, events[i].events);
+                    else on_client(*it->second, events[i].events);
+                }
+            }
+            if (stopping.load() && !stop_handled) begin_stop();
+            dispatch_waiting();
+            const auto now = Clock::now();
+            if (now - last_sweep >= SWEEP_INTERVAL) {
+                last_sweep = now;
+                sweep(now);
+            }
+        }
+        shutdown_all();
+    }
+
+    void begin_stop() {
+        stop_handled = true;
+        pause_listening();
+        ::close(listen_fd);
+        listen_fd = -1;
+        std::vector<Conn*> idle;
+        for (auto& [key, c] : conns) {
+            if (c->state == ConnState::Head && c->in.empty() && c->out.empty()) idle.push_back(c.get());
+        }
+        for (auto* c : idle) close_conn(*c);
+    }
+
+    void shutdown_all() {
+        std::vector<Conn*> all;
+        for (auto& [key, c] : conns) all.push_back(c.get());
+        for (auto* c : all) {
+            if (c->state == ConnState::WebSocket && !c->ws_closing) {
+                ws_pull(*c, SIZE_MAX);
+                append_close_frame(c->out, 1001);
+                while (!c->out.empty()) {
+                    const ssize_t n = ::send(c->fd, c->out.ptr(), c->out.size(), MSG_NOSIGNAL);
+                    if (n <= 0) break;          // Best effort, it's non-blocking
+                    c->out.consume(static_cast<size_t>(n));
+                }
+            }
+            close_conn(*c);
+        }
+    }
+
+    void on_wake() {
+        uint64_t counter;
+        while (::read(wake_fd, &counter, sizeof(counter)) > 0) {}
+        std::vector<uint64_t> keys;
+        {
+            std::lock_guard<std::mutex> lock(woken_mutex);
+            keys.swap(woken);
+        }
+        std::sort(keys.begin(), keys.end());
+        keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+        for (uint64_t key : keys) {
+            auto it = conns.find(key);
+            if (it == conns.end()) continue;
+            Conn& c = *it->second;
+            // A non-empty buffer means EPOLLOUT is armed and will pull more
+            if (c.state == ConnState::WebSocket && c.out.empty()) write_client(c);
+        }
+    }
+
+    void sweep(Clock::time_point now) {
+        const auto header_timeout = std::chrono::seconds(fe.options_.header_timeout_sec);
+        const auto keep_alive = std::chrono::seconds(fe.options_.keep_alive_timeout_sec);
+        std::vector<Conn*> expired;
+        std::vector<Conn*> ping;
+        for (auto& [key, cp] : conns) {
+            Conn& c = *cp;
+            if (c.state == ConnState::Head) {
+                const auto limit = (c.in.empty() && c.served && !c.close_after) ? keep_alive : header_timeout;
+                if (now - c.since > limit) expired.push_back(&c);
+            } else if (c.state == ConnState::WebSocket) {
+                if (now - c.since > WS_IDLE_LIMIT) {
+                    expired.push_back(&c);
+                } else if (now - c.ws_last_ping >= WS_PING_INTERVAL && !c.ws_closing) {
+                    c.ws_last_ping = now;
+                    append_frame(c.out, 0x9, "", 0);
+                    ping.push_back(&c);
+                }
+            }
+        }
+        for (auto* c : expired) close_conn(*c);
+        for (auto* c : ping) write_client(*c);
+        if (!listening && !stopping.load() && conns.size() < fe.options_.max_connections) resume_listening();
+    }
+
+    // ── Connections ─────────────────────────────────────────────────────
+
+    void accept_all() {
+        while (conns.size() < fe.options_.max_connections) {
+            sockaddr_storage ss{};
+            socklen_t len = sizeof(ss);
+            const int fd = accept4(listen_fd, reinterpret_cast<sockaddr*>(&ss), &len,
+                                   SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) {
+                if (errno == EINTR || errno == ECONNABORTED) continue;
+                if (errno == EMFILE || errno == ENFILE) {
+                    // Out of descriptors: stop accepting until something closes
+                    std::cerr << "[FrontEnd] accept: " << std::strerror(errno)
+                              << " (" << conns.size() << " connections)" << std::endl;
+                    pause_listening();
+                }
+                return;
+            }
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+            auto c = std::make_unique<Conn>();
+            c->key = next_key++;
+            c->fd = fd;
+            c->peer = peer_string(ss);
+            c->since = Clock::now();
+            c->events = EPOLLIN | EPOLLRDHUP;
+            epoll_event ev{};
+            ev.events = c->events;
+            ev.data.u64 = c->key << 1;
+            if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+                ::close(fd);
+                continue;
+            }
+            conns.emplace(c->key, std::move(c));
+
+            fe.accepted_.fetch_add(1);
+            const uint64_t open = fe.connections_.fetch_add(1) + 1;
+            uint64_t peak = fe.peak_.load();
+            while (open > peak && !fe.peak_.compare_exchange_weak(peak, open)) {}
+        }
+        pause_listening();
+    }
+
+    void close_conn(Conn& c) {
+        if (c.backend >= 0) close_backend(c);
+        if (c.queued) {
+            c.queued = false;
+            fe.queued_.fetch_sub(1);
+        }
+        if (c.ws_registered) {
+            c.ws_registered = false;
+            fe.websocket_.fetch_sub(1);
+            if (fe.ws_hooks_.close) fe.ws_hooks_.close(c.ws_id);
+        }
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, c.fd, nullptr);
+        ::close(c.fd);
+        fe.connections_.fetch_sub(1);
+        conns.erase(c.key);     // `c` is gone after this
+        if (!listening && !stopping.load() && conns.size() < fe.options_.max_connections) resume_listening();
+    }
+
+    // Hand queued requests to httplib as handler slots free up. Runs once
+    // per loop iteration, never from inside another connection's callback.
+    void dispatch_waiting() {
+        while (!waiting.empty() &&
+               (!fe.options_.max_in_flight || fe.in_flight_.load() < fe.options_.max_in_flight)) {
+            const uint64_t key = waiting.front();
+            waiting.pop_front();
+            auto it = conns.find(key);
+            if (it == conns.end() || !it->second->queued) continue;
+            it->second->queued = false;
+            fe.queued_.fetch_sub(1);
+            open_backend(*it->second);
+        }
+    }
+
+    void close_backend(Conn& c) {
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, c.backend, nullptr);
+        ::close(c.backend);
+        c.backend = -1;
+        c.backend_events = 0;
+        fe.in_flight_.fetch_sub(1);
+    }
+
+    void update_interest(Conn& c) {
+        bool want_in = false;
+        if (!c.client_eof) {
+            switch (c.state) {
+                case ConnState::Head:
+                    want_in = !c.close_after && c.in.size() <= MAX_HEAD_BYTES;
+                    break;
+                case ConnState::Proxy:
+                    want_in = !c.request_done && !c.backend_write_failed &&
+                              c.to_backend.size() < HIGH_WATER && c.in.size() < HIGH_WATER;
+                    break;
+                case ConnState::WebSocket:
+                    want_in = !c.ws_closing;
+                    break;
+            }
+        }
+        // EPOLLRDHUP stays armed while we're not reading, so a client that
+        // goes away mid-response is still noticed
+        const uint32_t events = (want_in ? EPOLLIN : 0u) |
+                                (c.client_eof ? 0u : static_cast<uint32_t>(EPOLLRDHUP)) |
+                                (c.out.empty() ? 0u : static_cast<uint32_t>(EPOLLOUT));
+        if (events != c.events) {
+            epoll_event ev{};
+            ev.events = events;
+            ev.data.u64 = c.key << 1;
+            epoll_ctl(epoll_fd, EPOLL_CTL_MOD, c.fd, &ev);
+            c.events = events;
+        }
+        if (c.backend >= 0) {
+            uint32_t bev = 0;
+            if (!c.backend_connected || (!c.to_backend.empty() && !c.backend_write_failed)) bev |= EPOLLOUT;
+            if (c.backend_connected && c.out.size() < HIGH_WATER) bev |= EPOLLIN | EPOLLRDHUP;
+            if (bev != c.backend_events) {
+                epoll_event ev{};
+                ev.events = bev;
+                ev.data.u64 = (c.key << 1) | 1;
+                epoll_ctl(epoll_fd, EPOLL_CTL_MOD, c.backend, &ev);
+                c.backend_events = bev;
+            }
+        }
+    }
+
+    void on_client(Conn& c, uint32_t events) {
+        if (events & (EPOLLHUP | EPOLLERR)) {
+            // Both directions are gone; nothing left to deliver
+            close_conn(c);
+            return;
+        }
+        if ((events & (EPOLLIN | EPOLLRDHUP)) && !read_client(c)) return;
+        if (events & EPOLLOUT) write_client(c);
+    }
+
+    // Returns false if `c` was closed
+    bool read_client(Conn& c) {
+        const size_t cap = c.state == ConnState::Head ? MAX_HEAD_BYTES + 1
+                         : c.state == ConnState::Proxy ? HIGH_WATER
+                         : WS_MAX_MESSAGE + 14;
+        if (c.state == ConnState::Head && c.in.empty()) c.since = Clock::now();
+        while (!c.client_eof && c.in.size() < cap) {
+            const ssize_t n = ::recv(c.fd, read_buf.data(), read_buf.size(), 0);
+            if (n > 0) {
+                c.in.append(read_buf.data(), static_cast<size_t>(n));
+            } else if (n == 0) {
+                c.client_eof = true;
+            } else if (errno == EINTR) {
+                continue;
+            } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            } else {
+                close_conn(c);
+                return false;
+            }
+        }
+        switch (c.state) {
+            case ConnState::Head:
+                return process_head(c);
+            case ConnState::Proxy:
+                if (c.client_eof && !c.request_done) {
+                    close_conn(c);      // Truncated request body
+                    return false;
+                }
+                if (c.client_eof) c.close_after = true;
+                if (!pump_request(c)) return false;
+                update_interest(c);
+                return true;
+            case ConnState::WebSocket:
+                return process_ws(c);
+        }
+        return true;
+    }
+
+    // Returns false if `c` was closed
+    bool write_client(Conn& c) {
+        for (;;) {
+            while (!c.out.empty()) {
+                const ssize_t n = ::send(c.fd, c.out.ptr(), c.out.size(), MSG_NOSIGNAL);
+                if (n > 0) {
+                    c.out.consume(static_cast<size_t>(n));
+                } else if (n < 0 && errno == EINTR) {
+                    continue;
+                } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                    update_interest(c);
+                    return true;
+                } else {
+                    close_conn(c);
+                    return false;
+                }
+            }
+            if (c.close_after && c.state != ConnState::Proxy) {
+                close_conn(c);
+                return false;
+            }
+            if (c.state == ConnState::WebSocket && !c.ws_closing && ws_pull(c, WS_HIGH_WATER)) continue;
+            break;
+        }
+        update_interest(c);
+        return true;
+    }
+
+    // Answer with an error and close. Returns false if `c` was closed.
+    bool reject(Conn& c, int status, const char* reason, const std::string& message) {
+        fe.rejected_.fetch_add(1);
+        c.out.append(plain_response(status, reason, error_body(message)));
+        c.in.clear();
+        c.close_after = true;
+        return write_client(c);
+    }
+
+    // ── HTTP ────────────────────────────────────────────────────────────
+
+    // Returns false if `c` was closed
+    bool process_head(Conn& c) {
+        if (c.close_after) {
+            update_interest(c);
+            return true;
+        }
+        // Tolerate stray CRLFs between requests (RFC 9112 2.2)
+        size_t skip = 0;
+        const std::string_view pending = c.in.view();
+        while (skip < pending.size() && (pending[skip] == '\r' || pending[skip] == '\n')) ++skip;
+        if (skip) c.in.consume(skip);
+
+        const size_t end = c.in.view().find("\r\n\r\n");
+        if (end == std::string_view::npos) {
+            if (c.in.size() > MAX_HEAD_BYTES) {
+                return reject(c, 431, "Request Header Fields Too Large", "Request head too large");
+            }
+            if (c.client_eof) {
+                if (c.out.empty()) {
+                    close_conn(c);
+                    return false;
+                }
+                c.close_after = true;
+            }
+            update_interest(c);
+            return true;
+        }
+
+        RequestHead head;
+        if (!parse_request_head(std::string(c.in.view().substr(0, end)), head)) {
+            return reject(c, 400, "Bad Request", "Malformed request head");
+        }
+        c.in.consume(end + 4);
+
+        if (fe.ws_hooks_.open && head.method == "GET" &&
+            head.target.substr(0, head.target.find('?')) == "/ws" &&
+            head.get("Upgrade") && has_token(*head.get("Upgrade"), "websocket")) {
+            return start_websocket(c, head);
+        }
+        return start_proxy(c, head);
+    }
+
+    // Returns false if `c` was closed
+    bool start_proxy(Conn& c, const RequestHead& head) {
+        if (head.version != "HTTP/1.1" && head.version != "HTTP/1.0") {
+            return reject(c, 505, "HTTP Version Not Supported", "Unsupported HTTP version");
+        }
+        const std::string* te = head.get("Transfer-Encoding");
+        c.body = BodyFraming::None;
+        c.body_remaining = 0;
+        c.chunks = ChunkScanner{};
+        if (te) {
+            // A chunked body with Content-Length too is a smuggling vector
+            if (head.get("Content-Length") || head.count("Transfer-Encoding") > 1) {
+                return reject(c, 400, "Bad Request", "Ambiguous request body framing");
+            }
+            const size_t comma = te->rfind(',');
+            if (!iequals(trim(comma == std::string::npos ? *te : te->substr(comma + 1)), "chunked")) {
+                return reject(c, 501, "Not Implemented", "Unsupported Transfer-Encoding");
+            }
+            c.body = BodyFraming::Chunked;
+        } else if (const std::string* cl = head.get("Content-Length")) {
+            for (const auto& h : head.headers) {
+                if (iequals(h.name, "Content-Length") && h.value != *cl) {
+                    return reject(c, 400, "Bad Request", "Conflicting Content-Length");
+                }
+            }
+            if (cl->empty() || cl->size() > 18 ||
+                cl->find_first_not_of("0123456789") != std::string::npos) {
+                return reject(c, 400, "Bad Request", "Invalid Content-Length");
+            }
+            c.body_remaining = std::stoull(*cl);
+            if (c.body_remaining > 0) c.body = BodyFraming::Length;
+        }
+
+        const std::string* connection = head.get("Connection");
+        c.keep_alive = head.version == "HTTP/1.1"
+            ? !(connection && has_token(*connection, "close"))
+            : (connection && has_token(*connection, "keep-alive"));
+        if (stopping.load()) c.keep_alive = false;
+        c.head_request = head.method == "HEAD";
+
+        // Hop-by-hop headers are ours to set; PEER_HEADER only ever comes from us
+        std::string fwd = head.method + " " + head.target + " " + head.version + "\r\n";
+        for (const auto& h : head.headers) {
+            if (iequals(h.name, "Connection") || iequals(h.name, "Keep-Alive") ||
+                iequals(h.name, "Proxy-Connection") || iequals(h.name, "Upgrade") ||
+                iequals(h.name, PEER_HEADER)) {
+                continue;
+            }
+            fwd += h.name + ": " + h.value + "\r\n";
+        }
+        fwd += "Connection: close\r\n";
+        fwd += std::string(PEER_HEADER) + ": " + fe.peer_token_ + " " + c.peer + "\r\n\r\n";
+
+        c.to_backend.clear();
+        c.to_backend.append(fwd);
+        c.state = ConnState::Proxy;
+        c.request_done = c.body == BodyFraming::None;
+        c.backend_write_failed = false;
+        c.response_started = false;
+        c.response_head.clear();
+        fe.requests_.fetch_add(1);
+
+        if (fe.options_.max_in_flight && fe.in_flight_.load() >= fe.options_.max_in_flight) {
+            // Every handler is busy: wait here (the body buffers meanwhile)
+            // rather than in httplib's accept backlog
+            c.queued = true;
+            waiting.push_back(c.key);
+            fe.queued_.fetch_add(1);
+            if (!pump_request(c)) return false;
+            update_interest(c);
+            return true;
+        }
+        return open_backend(c);
+    }
+
+    // Returns false if `c` was closed
+    bool open_backend(Conn& c) {
+        c.backend = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (c.backend < 0) {
+            fe.backend_errors_.fetch_add(1);
+            c.state = ConnState::Head;
+            return reject(c, 503, "Service Unavailable", "Out of sockets");
+        }
+        fe.in_flight_.fetch_add(1);
+        int one = 1;
+        setsockopt(c.backend, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        const int rc = ::connect(c.backend, reinterpret_cast<const sockaddr*>(&backend_addr),
+                                 sizeof(backend_addr));
+        if (rc != 0 && errno != EINPROGRESS) return finish_proxy(c);
+        c.backend_connected = rc == 0;
+        c.backend_events = EPOLLOUT;
+        epoll_event ev{};
+        ev.events = c.backend_events;
+        ev.data.u64 = (c.key << 1) | 1;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, c.backend, &ev);
+
+        if (!pump_request(c)) return false;
+        update_interest(c);
+        return true;
+    }
+
+    // Move request body bytes from the client buffer towards the backend.
+    // Returns false if `c` was closed.
+    bool pump_request(Conn& c) {
+        while (!c.request_done && !c.in.empty() && c.to_backend.size() < HIGH_WATER) {
+            size_t n;
+            if (c.body == BodyFraming::Length) {
+                n = static_cast<size_t>(std::min<uint64_t>(c.in.size(), c.body_remaining));
+                c.body_remaining -= n;
+                c.request_done = c.body_remaining == 0;
+            } else {
+                n = c.chunks.feed(c.in.ptr(), c.in.size());
+                if (n == ChunkScanner::MALFORMED) {
+                    close_conn(c);
+                    return false;
+                }
+                c.request_done = c.chunks.state == ChunkScanner::State::Done;
+            }
+            if (c.backend_write_failed) {
+                c.close_after = true;   // Discarded, so the connection can't be reused
+            } else {
+                c.to_backend.append(c.in.ptr(), n);
+            }
+            c.in.consume(n);
+        }
+        if (c.backend_connected && !c.to_backend.empty()) flush_backend(c);
+        return true;
+    }
+
+    void flush_backend(Conn& c) {
+        while (!c.to_backend.empty() && !c.backend_write_failed) {
+            const ssize_t n = ::send(c.backend, c.to_backend.ptr(), c.to_backend.size(), MSG_NOSIGNAL);
+            if (n > 0) {
+                c.to_backend.consume(static_cast<size_t>(n));
+            } else if (n < 0 && errno == EINTR) {
+                continue;
+            } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                break;
+            } else {
+                // The handler answered without reading the whole body (401,
+                // 413, ...). Keep reading its response; the client's
+                // leftover body means this connection ends with it.
+                c.backend_write_failed = true;
+                c.to_backend.clear();
+                c.close_after = true;
+            }
+        }
+    }
+
+    void on_backend(Conn& c, uint32_t events) {
+        if (!c.backend_connected) {
+            int err = 0;
+            socklen_t len = sizeof(err);
+            getsockopt(c.backend, SOL_SOCKET, SO_ERROR, &err, &len);
+            if (err != 0) {
+                finish_proxy(c);
+                return;
+            }
+            c.backend_connected = true;
+        }
+        if (events & EPOLLOUT) {
+            flush_backend(c);
+            if (!pump_request(c)) return;
+        }
+        if (events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+            if (!read_backend(c)) return;
+        }
+        update_interest(c);
+    }
+
+    // Returns false if `c` was closed
+    bool read_backend(Conn& c) {
+        while (c.out.size() < HIGH_WATER) {
+            const ssize_t n = ::recv(c.backend, read_buf.data(), read_buf.size(), 0);
+            if (n > 0) {
+                on_backend_data(c, read_buf.data(), static_cast<size_t>(n));
+            } else if (n < 0 && errno == EINTR) {
+                continue;
+            } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                break;
+            } else {
+                return finish_proxy(c);     // EOF (or reset) ends the response
+            }
+        }
+        return write_client(c);
+    }
+
+    void on_backend_data(Conn& c, const char* data, size_t len) {
+        if (c.response_started) {
+            c.out.append(data, len);
+            return;
+        }
+        c.response_head.append(data, len);
+        for (;;) {
+            const size_t end = c.response_head.find("\r\n\r\n");
+            if (end == std::string::npos) return;
+            const std::string head = c.response_head.substr(0, end + 4);
+            const int status = parse_status(head);
+            if (status >= 100 && status < 200 && status != 101) {
+                // 100 Continue and friends pass through untouched
+                c.out.append(head);
+                c.response_head.erase(0, end + 4);
+                continue;
+            }
+            std::string rewritten;
+            if (!rewrite_response_head(head, status, c.head_request,
+                                       c.keep_alive && !c.close_after, rewritten)) {
+                c.close_after = true;
+            }
+            c.out.append(rewritten);
+            c.out.append(c.response_head.data() + end + 4, c.response_head.size() - end - 4);
+            c.response_head.clear();
+            c.response_started = true;
+            return;
+        }
+    }
+
+    // The backend closed (or never connected). Returns false if `c` was closed.
+    bool finish_proxy(Conn& c) {
+        close_backend(c);
+        if (!c.response_started) {
+            fe.backend_errors_.fetch_add(1);
+            c.out.append(plain_response(502, "Bad Gateway", error_body("Request handler unavailable")));
+            c.close_after = true;
+        }
+        if (!c.request_done) c.close_after = true;
+        c.state = ConnState::Head;
+        c.served = true;
+        c.since = Clock::now();
+        c.backend_connected = false;
+        c.to_backend.clear();
+        c.response_head.clear();
+        if (c.close_after) c.in.clear();
+        if (!write_client(c)) return false;
+        return c.close_after ? true : process_head(c);     // Pipelined request
+    }
+
+    // ── WebSocket ───────────────────────────────────────────────────────
+
+    // Returns false if `c` was closed
+    bool start_websocket(Conn& c, const RequestHead& head) {
+        const std::string* key = head.get("Sec-WebSocket-Key");
+        const std::string* version = head.get("Sec-WebSocket-Version");
+        if (!key || key->empty() || !version || *version != "13") {
+            return reject(c, 400, "Bad Request", "Invalid WebSocket handshake");
+        }
+
+        httplib::Request req;
+        req.method = head.method;
+        req.target = head.target;
+        req.version = head.version;
+        req.remote_addr = c.peer;
+        const size_t q = head.target.find('?');
+        req.path = url_decode(head.target.substr(0, q), false);
+        if (q != std::string::npos) {
+            const std::string query = head.target.substr(q + 1);
+            size_t pos = 0;
+            while (pos <= query.size()) {
+                size_t amp = query.find('&', pos);
+                if (amp == std::string::npos) amp = query.size();
+                const std::string pair = query.substr(pos, amp - pos);
+                if (!pair.empty()) {
+                    const size_t eq = pair.find('=');
+                    req.params.emplace(url_decode(pair.substr(0, eq), true),
+                                       eq == std::string::npos ? "" : url_decode(pair.substr(eq + 1), true));
+                }
+                pos = amp + 1;
+            }
+        }
+        for (const auto& h : head.headers) req.headers.emplace(h.name, h.value);
+
+        const uint64_t conn_key = c.key;
+        auto id = fe.ws_hooks_.open(req, [this, conn_key] { wake(conn_key); });
+        if (!id) {
+            fe.rejected_.fetch_add(1);
+            c.out.append(plain_response(401, "Unauthorized",
+                nlohmann::json{{"error", "unauthorized"},
+                               {"message", "Authentication required. POST credentials to /auth/login to obtain a bearer token."}}.dump(),
+                "WWW-Authenticate: Bearer realm=\"sdcpp-restapi\"\r\n"));
+            c.in.clear();
+            c.close_after = true;
+            return write_client(c);
+        }
+
+        c.out.append("HTTP/1.1 101 Switching Protocols\r\n"
+                     "Upgrade: websocket\r\n"
+                     "Connection: Upgrade\r\n"
+                     "Sec-WebSocket-Accept: " + websocket_accept(*key) + "\r\n\r\n");
+        c.state = ConnState::WebSocket;
+        c.ws_id = *id;
+        c.ws_registered = true;
+        c.since = Clock::now();
+        c.ws_last_ping = c.since;
+        fe.websocket_.fetch_add(1);
+        fe.websocket_sessions_.fetch_add(1);
+        return process_ws(c);
+    }
+
+    // Queue frames from the client's outbox until `limit` bytes are pending.
+    // Returns whether anything was queued.
+    bool ws_pull(Conn& c, size_t limit) {
+        if (!c.ws_registered || !fe.ws_hooks_.next) return false;
+        bool pulled = false;
+        std::shared_ptr<const std::string> payload;
+        bool binary = false;
+        while (c.out.size() < limit && fe.ws_hooks_.next(c.ws_id, payload, binary)) {
+            append_frame(c.out, binary ? 0x2 : 0x1, payload->data(), payload->size());
+            pulled = true;
+        }
+        return pulled;
+    }
+
+    bool ws_fail(Conn& c, uint16_t code) {
+        append_close_frame(c.out, code);
+        c.ws_closing = true;
+        c.close_after = true;
+        c.in.clear();
+        return write_client(c);
+    }
+
+    // Parse and handle complete frames. Returns false if `c` was closed.
+    bool process_ws(Conn& c) {
+        while (!c.ws_closing) {
+            const std::string_view v = c.in.view();
+            if (v.size() < 2) break;
+            const auto b0 = static_cast<uint8_t>(v[0]);
+            const auto b1 = static_cast<uint8_t>(v[1]);
+            const bool fin = b0 & 0x80;
+            const uint8_t opcode = b0 & 0x0f;
+            uint64_t len = b1 & 0x7f;
+            size_t pos = 2;
+            if (len == 126) {
+                if (v.size() < 4) break;
+                len = (static_cast<uint64_t>(static_cast<uint8_t>(v[2])) << 8) | static_cast<uint8_t>(v[3]);
+                pos = 4;
+            } else if (len == 127) {
+                if (v.size() < 10) break;
+                len = 0;
+                for (int i = 0; i < 8; ++i) len = (len << 8) | static_cast<uint8_t>(v[2 + i]);
+                pos = 10;
+            }
+            if (!(b1 & 0x80) || (b0 & 0x70)) return ws_fail(c, 1002);   // Unmasked, or reserved bits
+            if (opcode >= 0x8 && (len > 125 || !fin)) return ws_fail(c, 1002);
+            if (len > WS_MAX_MESSAGE) return ws_fail(c, 1009);
+            if (v.size() < pos + 4 + len) break;
+
+            const char* mask = v.data() + pos;
+            std::string payload(v.data() + pos + 4, static_cast<size_t>(len));
+            for (size_t i = 0; i < payload.size(); ++i) payload[i] ^= mask[i & 3];
+            c.in.consume(pos + 4 + static_cast<size_t>(len));
+            c.since = Clock::now();
+
+            switch (opcode) {
+                case 0x8: {     // Close: echo the status code, then hang up
+                    const uint16_t code = payload.size() >= 2
+                        ? static_cast<uint16_t>((static_cast<uint8_t>(payload[0]) << 8) | static_cast<uint8_t>(payload[1]))
+                        : 1000;
+                    return ws_fail(c, code);
+                }
+                case 0x9:
+                    append_frame(c.out, 0xA, payload.data(), payload.size());
+                    break;
+                case 0xA:
+                    break;
+                case 0x1:
+                case 0x2:
+                    if (c.ws_opcode != 0) return ws_fail(c, 1002);
+                    if (fin) {
+                        deliver(c, opcode, payload);
+                    } else {
+                        c.ws_opcode = opcode;
+                        c.ws_message = std::move(payload);
+                    }
+                    break;
+                case 0x0:
+                    if (c.ws_opcode == 0) return ws_fail(c, 1002);
+                    c.ws_message += payload;
+                    if (c.ws_message.size() > WS_MAX_MESSAGE) return ws_fail(c, 1009);
+                    if (fin) {
+                        deliver(c, c.ws_opcode, c.ws_message);
+                        c.ws_opcode = 0;
+                        c.ws_message.clear();
+                    }
+                    break;
+                default:
+                    return ws_fail(c, 1002);
+            }
+        }
+        if (c.client_eof && !c.ws_closing) {
+            close_conn(c);
+            return false;
+        }
+        return write_client(c);
+    }
+
+    void deliver(Conn& c, uint8_t opcode, const std::string& message) {
+        // Binary messages from clients are ignored, as before
+        if (opcode == 0x1 && fe.ws_hooks_.message) fe.ws_hooks_.message(c.ws_id, message);
+    }
+};
+
+bool HttpFrontEnd::supported() {
+    return true;
+}
+
+HttpFrontEnd::HttpFrontEnd(FrontEndOptions options, WebSocketHooks ws_hooks)
+    : options_(std::move(options)), ws_hooks_(std::move(ws_hooks))
+{
+    unsigned char bytes[16];
+    if (RAND_bytes(bytes, sizeof(bytes)) != 1) {
+        throw std::runtime_error("Failed to generate front end token");
+    }
+    static const char* hex = "0123456789abcdef";
+    for (unsigned char b : bytes) {
+        peer_token_.push_back(hex[b >> 4]);
+        peer_token_.push_back(hex[b & 0xf]);
+    }
+}
+
+HttpFrontEnd::~HttpFrontEnd() {
+    stop();
+}
+
+void HttpFrontEnd::start() {
+    if (loop_) return;
+    auto loop = std::make_unique<Loop>(*this);
+    loop->setup();
+    loop_ = std::move(loop);
+    thread_ = std::thread([this] { loop_->run(); });
+    std::cout << "[FrontEnd] Event loop listening on " << options_.host << ":" << options_.port
+              << " (handlers on 127.0.0.1:" << options_.backend_port
+              << ", max " << options_.max_connections << " connections, keep-alive "
+              << options_.keep_alive_timeout_sec << "s"
+              << (ws_hooks_.open ? ", WebSocket native" : "") << ")" << std::endl;
+}
+
+void HttpFrontEnd::request_stop() {
+    if (!loop_) return;
+    loop_->stopping.store(true);
+    loop_->signal();
+}
+
+void HttpFrontEnd::stop() {
+    if (!loop_) return;
+    loop_->stopping.store(true);
+    loop_->quit.store(true);
+    loop_->signal();
+    if (thread_.joinable()) thread_.join();
+    loop_.reset();
+    std::cout << "[FrontEnd] Stopped" << std::endl;
+}
+
+#else // !__linux__
+
+struct HttpFrontEnd::Loop {};
+
+bool HttpFrontEnd::supported() {
+    return false;
+}
+
+HttpFrontEnd::HttpFrontEnd(FrontEndOptions options, WebSocketHooks ws_hooks)
+    : options_(std::move(options)), ws_hooks_(std::move(ws_hooks))
+{
+}
+
+HttpFrontEnd::~HttpFrontEnd() = default;
+
+void HttpFrontEnd::start() {
+    throw std::runtime_error("The event-loop front end needs epoll (Linux)");
+}
+
+void HttpFrontEnd::request_stop() {}
+
+void HttpFrontEnd::stop() {}
+
+#endif
+
+nlohmann::json HttpFrontEnd::stats_json() const {
+    const uint64_t open = connections_.load();
+    const uint64_t ws = websocket_.load();
+    const uint64_t in_flight = in_flight_.load();
+    const uint64_t busy = ws + in_flight + queued_.load();
+    return {
+        {"connections", open},
+        {"websocket", ws},
+        {"idle", open > busy ? open - busy : 0},
+        {"in_flight", in_flight},
+        {"queued", queued_.load()},
+        {"peak", peak_.load()},
+        {"accepted", accepted_.load()},
+        {"requests", requests_.load()},
+        {"websocket_sessions", websocket_sessions_.load()},
+        {"rejected", rejected_.load()},
+        {"backend_errors", backend_errors_.load()},
+        {"max_connections", options_.max_connections},
+        {"max_in_flight", options_.max_in_flight},
+        {"keep_alive_timeout", options_.keep_alive_timeout_sec}
+    };
+}
+
+} // namespace sdcpp
@@ -0,0 +1,348 @@
+#include "image_encoder.hpp"
+#include "utils.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+
+#include "stb_image.h"
+#include "stb_image_write.h"
+
+#ifdef SDCPP_HAVE_TURBOJPEG
+#include <turbojpeg.h>
+#endif
+#ifdef SDCPP_HAVE_LIBPNG
+#include <png.h>
+#endif
+#ifdef SDCPP_HAVE_WEBP
+#include <webp/encode.h>
+#include <webp/decode.h>
+#endif
+
+namespace sdcpp {
+
+namespace {
+
+struct Defaults {
+    std::mutex mutex;
+    EncodeOptions options;
+    int jpeg_quality = 92;
+    int webp_quality = 90;
+};
+
+Defaults& defaults() {
+    static Defaults d;
+    return d;
+}
+
+void append_bytes(void* context, void* data, int size) {
+    auto* out = static_cast<std::vector<uint8_t>*>(context);
+    auto* bytes = static_cast<uint8_t*>(data);
+    out->insert(out->end(), bytes, bytes + size);
+}
+
+#ifdef SDCPP_HAVE_WEBP
+// WebP wants 3/4 channel input; widen grayscale
+std::vector<uint8_t> gray_to_rgb(const uint8_t* data, int width, int height) {
+    std::vector<uint8_t> rgb(static_cast<size_t>(width) * height * 3);
+    for (size_t i = 0, n = static_cast<size_t>(width) * height; i < n; ++i) {
+        rgb[i * 3] = rgb[i * 3 + 1] = rgb[i * 3 + 2] = data[i];
+    }
+    return rgb;
+}
+#endif
+
+// ── JPEG ────────────────────────────────────────────────────────────────────
+
+std::vector<uint8_t> encode_jpeg(const uint8_t* data, int width, int height, int channels, int quality) {
+    quality = std::clamp(quality, 1, 100);
+#ifdef SDCPP_HAVE_TURBOJPEG
+    // One compressor per thread: tjhandle is not thread-safe, and creating
+    // one per call costs more than encoding a 256px preview
+    struct HandleDeleter { void operator()(void* h) const { tjDestroy(h); } };
+    thread_local std::unique_ptr<void, HandleDeleter> handle(tjInitCompress());
+
+    if (handle && channels != 2) {
+        int pixel_format = channels == 1 ? TJPF_GRAY : (channels == 4 ? TJPF_RGBA : TJPF_RGB);
+        int subsamp = channels == 1 ? TJSAMP_GRAY : (quality >= 90 ? TJSAMP_444 : TJSAMP_420);
+        unsigned char* jpeg = nullptr;
+        unsigned long jpeg_size = 0;
+        if (tjCompress2(handle.get(), data, width, width * channels, height, pixel_format,
+                        &jpeg, &jpeg_size, subsamp, quality, TJFLAG_FASTDCT) == 0) {
+            std::vector<uint8_t> out(jpeg, jpeg + jpeg_size);
+            tjFree(jpeg);
+            return out;
+        }
+        std::cerr << "[ImageEncoder] libjpeg-turbo failed (" << tjGetErrorStr2(handle.get())
+                  << "), falling back to stb" << std::endl;
+        if (jpeg) tjFree(jpeg);
+    }
+#endif
+    std::vector<uint8_t> out;
+    if (!stbi_write_jpg_to_func(append_bytes, &out, width, height, channels, data, quality)) {
+        throw std::runtime_error("JPEG encoding failed");
+    }
+    return out;
+}
+
+// ── PNG ─────────────────────────────────────────────────────────────────────
+
+#ifdef SDCPP_HAVE_LIBPNG
+std::vector<uint8_t> encode_png_libpng(const uint8_t* data, int width, int height, int channels, int level) {
+    std::vector<uint8_t> out;
+    std::vector<png_bytep> rows(height);
+    for (int y = 0; y < height; ++y) {
+        rows[y] = const_cast<png_bytep>(data + static_cast<size_t>(y) * width * channels);
+    }
+
+    png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+    if (!png) {
+        throw std::runtime_error("png_create_write_struct failed");
+    }
+    png_infop info = png_create_info_struct(png);
+    if (!info || setjmp(png_jmpbuf(png))) {
+        png_destroy_write_struct(&png, &info);
+        throw std::runtime_error("PNG encoding failed");
+    }
+
+    png_set_write_fn(png, &out,
+        [](png_structp p, png_bytep bytes, png_size_t size) {
+            auto* vec = static_cast<std::vector<uint8_t>*>(png_get_io_ptr(p));
+            vec->insert(vec->end(), bytes, bytes + size);
+        },
+        nullptr);
+
+    const int color_type = channels == 1 ? PNG_COLOR_TYPE_GRAY
+                         : channels == 2 ? PNG_COLOR_TYPE_GRAY_ALPHA
+                         : channels == 4 ? PNG_COLOR_TYPE_RGBA
+                         : PNG_COLOR_TYPE_RGB;
+    png_set_IHDR(png, info, width, height, 8, color_type,
+                 PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+    png_set_compression_level(png, level);
+    // Adaptive filter selection tries all five filters per row; at the fast
+    // levels that search costs more than it saves
+    png_set_filter(png, PNG_FILTER_TYPE_BASE,
+                   level <= 3 ? (PNG_FILTER_SUB | PNG_FILTER_UP) : PNG_ALL_FILTERS);
+
+    png_write_info(png, info);
+    png_write_image(png, rows.data());
+    png_write_end(png, nullptr);
+    png_destroy_write_struct(&png, &info);
+    return out;
+}
+#endif
+
+std::vector<uint8_t> encode_png(const uint8_t* data, int width, int height, int channels, int level) {
+    level = std::clamp(level, 0, 9);
+#ifdef SDCPP_HAVE_LIBPNG
+    return encode_png_libpng(data, width, height, channels, level);
+#else
+    // stb reads its level from a global, set in set_default_encode_options()
+    std::vector<uint8_t> out;
+    if (!stbi_write_png_to_func(append_bytes, &out, width, height, channels, data, width * channels)) {
+        throw std::runtime_error("PNG encoding failed");
+    }
+    return out;
+#endif
+}
+
+// ── WebP ────────────────────────────────────────────────────────────────────
+
+std::vector<uint8_t> encode_webp(const uint8_t* data, int width, int height, int channels,
+                                 int quality, bool lossless) {
+#ifdef SDCPP_HAVE_WEBP
+    std::vector<uint8_t> widened;
+    if (channels == 1) {
+        widened = gray_to_rgb(data, width, height);
+        data = widened.data();
+        channels = 3;
+    }
+    if (channels != 3 && channels != 4) {
+        throw std::runtime_error("WebP encoding supports 1, 3 or 4 channels");
+    }
+
+    const int stride = width * channels;
+    const float q = static_cast<float>(std::clamp(quality, 1, 100));
+    uint8_t* webp = nullptr;
+    size_t size = 0;
+    if (lossless) {
+        size = channels == 4 ? WebPEncodeLosslessRGBA(data, width, height, stride, &webp)
+                             : WebPEncodeLosslessRGB(data, width, height, stride, &webp);
+    } else {
+        size = channels == 4 ? WebPEncodeRGBA(data, width, height, stride, q, &webp)
+                             : WebPEncodeRGB(data, width, height, stride, q, &webp);
+    }
+    if (size == 0 || !webp) {
+        if (webp) WebPFree(webp);
+        throw std::runtime_error("WebP encoding failed");
+    }
+    std::vector<uint8_t> out(webp, webp + size);
+    WebPFree(webp);
+    return out;
+#else
+    (void)data; (void)width; (void)height; (void)channels; (void)quality; (void)lossless;
+    throw std::runtime_error("WebP output is not available in this build (libwebp not found)");
+#endif
+}
+
+} // namespace
+
+ImageFormat image_format_from_string(const std::string& name) {
+    std::string n = name;
+    std::transform(n.begin(), n.end(), n.begin(), ::tolower);
+    if (n == "png") return ImageFormat::Png;
+    if (n == "jpeg" || n == "jpg") return ImageFormat::Jpeg;
+    if (n == "webp") return ImageFormat::Webp;
+    throw std::runtime_error("Unknown output_format: " + name + " (expected png, jpeg or webp)");
+}
+
+std::string image_format_to_string(ImageFormat format) {
+    switch (format) {
+        case ImageFormat::Jpeg: return "jpeg";
+        case ImageFormat::Webp: return "webp";
+        case ImageFormat::Png:
+        default:                return "png";
+    }
+}
+
+std::string image_format_extension(ImageFormat format) {
+    return format == ImageFormat::Jpeg ? "jpg" : image_format_to_string(format);
+}
+
+bool image_format_available(ImageFormat format) {
+#ifdef SDCPP_HAVE_WEBP
+    (void)format;
+    return true;
+#else
+    return format != ImageFormat::Webp;
+#endif
+}
+
+void set_default_encode_options(const EncodeOptions& options,
+                                int default_jpeg_quality, int default_webp_quality) {
+    auto& d = defaults();
+    std::lock_guard<std::mutex> lock(d.mutex);
+    d.options = options;
+    d.jpeg_quality = default_jpeg_quality;
+    d.webp_quality = default_webp_quality;
+#ifndef SDCPP_HAVE_LIBPNG
+    stbi_write_png_compression_level = std::clamp(options.png_compression, 0, 9);
+#endif
+}
+
+EncodeOptions default_encode_options() {
+    auto& d = defaults();
+    std::lock_guard<std::mutex> lock(d.mutex);
+    return d.options;
+}
+
+EncodeOptions resolve_encode_options(const std::string& format, int quality) {
+    auto& d = defaults();
+    EncodeOptions opts;
+    int jpeg_quality, webp_quality;
+    {
+        std::lock_guard<std::mutex> lock(d.mutex);
+        opts = d.options;
+        jpeg_quality = d.jpeg_quality;
+        webp_quality = d.webp_quality;
+    }
+
+    if (!format.empty()) {
+        opts.format = image_format_from_string(format);
+    }
+    if (!image_format_available(opts.format)) {
+        throw std::runtime_error("output_format '" + image_format_to_string(opts.format) +
+                                 "' is not available in this build");
+    }
+
+    if (quality > 0) {
+        opts.quality = std::min(quality, 100);
+    } else {
+        opts.quality = opts.format == ImageFormat::Webp ? webp_quality : jpeg_quality;
+    }
+    return opts;
+}
+
+std::vector<uint8_t> encode_image(const uint8_t* data, int width, int height, int channels,
+                                  const EncodeOptions& options) {
+    if (!data || width <= 0 || height <= 0 || channels < 1 || channels > 4) {
+        throw std::runtime_error("encode_image: invalid image");
+    }
+    switch (options.format) {
+        case ImageFormat::Jpeg:
+            return encode_jpeg(data, width, height, channels, options.quality);
+        case ImageFormat::Webp:
+            return encode_webp(data, width, height, channels, options.quality, options.lossless);
+        case ImageFormat::Png:
+        default:
+            return encode_png(data, width, height, channels, options.png_compression);
+    }
+}
+
+bool write_image_file(const std::string& path, const uint8_t* data, int width, int height,
+                      int channels, const EncodeOptions& options) {
+    try {
+        std::vector<uint8_t> bytes = encode_image(data, width, height, channels, options);
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            std::cerr << "[ImageEncoder] Cannot open " << path << " for writing" << std::endl;
+            return false;
+        }
+        out.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+        if (!out) {
+            std::cerr << "[ImageEncoder] Short write to " << path << std::endl;
+            return false;
+        }
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "[ImageEncoder] " << path << ": " << e.what() << std::endl;
+        return false;
+    }
+}
+
+std::vector<uint8_t> load_image_file_rgb(const std::string& path, int& width, int& height) {
+    int channels = 0;
+    if (unsigned char* data = stbi_load(path.c_str(), &width, &height, &channels, 3)) {
+        std::vector<uint8_t> rgb(data, data + static_cast<size_t>(width) * height * 3);
+        stbi_image_free(data);
+        return rgb;
+    }
+
+#ifdef SDCPP_HAVE_WEBP
+    if (utils::get_file_extension(path) == "webp") {
+        std::ifstream in(path, std::ios::binary);
+        std::vector<uint8_t> file((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        if (uint8_t* data = WebPDecodeRGB(file.data(), file.size(), &width, &height)) {
+            std::vector<uint8_t> rgb(data, data + static_cast<size_t>(width) * height * 3);
+            WebPFree(data);
+            return rgb;
+        }
+    }
+#endif
+    return {};
+}
+
+nlohmann::json image_encoder_backends() {
+    return {
+#ifdef SDCPP_HAVE_LIBPNG
+        {"png", "libpng"},
+#else
+        {"png", "stb"},
+#endif
+#ifdef SDCPP_HAVE_TURBOJPEG
+        {"jpeg", "libjpeg-turbo"},
+#else
+        {"jpeg", "stb"},
+#endif
+#ifdef SDCPP_HAVE_WEBP
+        {"webp", "libwebp"}
+#else
+        {"webp", nullptr}
+#endif
+    };
+}
+
+} // namespace sdcpp
@@ -0,0 +1,249 @@
+#include "image_input.hpp"
+#include "image_encoder.hpp"
+#include "utils.hpp"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+
+#include "stb_image.h"
+
+#ifdef SDCPP_HAVE_WEBP
+#include <webp/decode.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace sdcpp {
+
+namespace {
+
+constexpr const char* UPLOAD_DIR = "uploads";
+
+struct Root {
+    std::mutex mutex;
+    fs::path path;
+};
+
+Root& root() {
+    static Root r;
+    return r;
+}
+
+fs::path input_root() {
+    auto& r = root();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    if (r.path.empty()) {
+        throw std::runtime_error("Image references are not available (no output directory configured)");
+    }
+    return r.path;
+}
+
+// Relative to `base` without leaving it, or empty
+fs::path contained_relative(const fs::path& base, const fs::path& path) {
+    std::error_code ec;
+    fs::path rel = fs::weakly_canonical(path, ec).lexically_relative(base);
+    if (ec || rel.empty() || *rel.begin() == "..") return {};
+    return rel;
+}
+
+bool is_webp(std::string_view data) {
+    return data.size() >= 12 && data.compare(0, 4, "RIFF") == 0 && data.compare(8, 4, "WEBP") == 0;
+}
+
+const char* sniff_extension(std::string_view data) {
+    if (data.size() >= 8 && std::memcmp(data.data(), "\x89PNG\r\n\x1a\n", 8) == 0) return "png";
+    if (data.size() >= 3 && std::memcmp(data.data(), "\xff\xd8\xff", 3) == 0) return "jpg";
+    if (is_webp(data)) return "webp";
+    if (data.size() >= 2 && data.compare(0, 2, "BM") == 0) return "bmp";
+    return "img";
+}
+
+bool readable_header(std::string_view data) {
+    if (is_webp(data)) {
+#ifdef SDCPP_HAVE_WEBP
+        return WebPGetInfo(reinterpret_cast<const uint8_t*>(data.data()), data.size(), nullptr, nullptr) != 0;
+#else
+        return false;
+#endif
+    }
+    int w = 0, h = 0, c = 0;
+    return stbi_info_from_memory(reinterpret_cast<const unsigned char*>(data.data()),
+                                 static_cast<int>(data.size()), &w, &h, &c) != 0;
+}
+
+std::vector<uint8_t> decode_memory_rgb(const uint8_t* data, size_t size, int& width, int& height) {
+    int channels = 0;
+    if (uint8_t* pixels = stbi_load_from_memory(data, static_cast<int>(size), &width, &height, &channels, 3)) {
+        std::vector<uint8_t> rgb(pixels, pixels + static_cast<size_t>(width) * height * 3);
+        stbi_image_free(pixels);
+        return rgb;
+    }
+#ifdef SDCPP_HAVE_WEBP
+    if (uint8_t* pixels = WebPDecodeRGB(data, size, &width, &height)) {
+        std::vector<uint8_t> rgb(pixels, pixels + static_cast<size_t>(width) * height * 3);
+        WebPFree(pixels);
+        return rgb;
+    }
+#endif
+    return {};
+}
+
+} // namespace
+
+void set_image_input_root(const std::string& output_dir) {
+    std::error_code ec;
+    fs::path path = fs::weakly_canonical(output_dir, ec);
+    auto& r = root();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.path = ec ? fs::path(output_dir) : path;
+}
+
+bool is_image_ref(std::string_view value) {
+    return value.substr(0, IMAGE_REF_OUTPUT.size()) == IMAGE_REF_OUTPUT;
+}
+
+std::string image_ref_for_path(const std::string& path) {
+    const fs::path base = input_root();
+    fs::path rel = contained_relative(base, fs::path(path).is_absolute() ? fs::path(path) : base / path);
+    if (rel.empty()) {
+        throw std::runtime_error("Image path is outside the output directory: " + path);
+    }
+    return std::string(IMAGE_REF_OUTPUT) + rel.generic_string();
+}
+
+std::string image_ref_path(std::string_view ref) {
+    const fs::path base = input_root();
+    const std::string rel(ref.substr(IMAGE_REF_OUTPUT.size()));
+    const fs::path full = base / rel;
+    if (rel.empty() || fs::path(rel).is_absolute() || contained_relative(base, full).empty()) {
+        throw std::runtime_error("Image reference is outside the output directory: " + std::string(ref));
+    }
+    std::error_code ec;
+    if (!fs::is_regular_file(full, ec)) {
+        throw std::runtime_error("Referenced image not found: " + rel);
+    }
+    return full.string();
+}
+
+std::vector<uint8_t> decode_image_input(const std::string& value, int& width, int& height) {
+    if (is_image_ref(value)) {
+        std::vector<uint8_t> rgb = load_image_file_rgb(image_ref_path(value), width, height);
+        if (rgb.empty()) {
+            throw std::runtime_error("Failed to decode referenced image: " + value.substr(IMAGE_REF_OUTPUT.size()));
+        }
+        return rgb;
+    }
+    if (value.compare(0, IMAGE_REF_JOB.size(), IMAGE_REF_JOB) == 0) {
+        // Only the request handlers can look jobs up
+        throw std::runtime_error("Unresolved job image reference: " + value);
+    }
+    std::vector<uint8_t> binary = utils::base64_decode(value);
+    std::vector<uint8_t> rgb = decode_memory_rgb(binary.data(), binary.size(), width, height);
+    if (rgb.empty()) {
+        throw std::runtime_error("Failed to decode base64 image");
+    }
+    return rgb;
+}
+
+std::string image_field_for_part(const std::string& part_name) {
+    for (const char* field : IMAGE_SCALAR_FIELDS) {
+        if (part_name == field || part_name + "_base64" == field) return field;
+    }
+    for (const char* field : IMAGE_ARRAY_FIELDS) {
+        if (part_name == field) return field;
+    }
+    return "";
+}
+
+bool is_image_array_field(const std::string& field) {
+    for (const char* f : IMAGE_ARRAY_FIELDS) {
+        if (field == f) return true;
+    }
+    return false;
+}
+
+std::vector<std::string> strip_image_blobs(nlohmann::json& params) {
+    std::vector<std::string> stripped;
+    if (!params.is_object()) return stripped;
+
+    auto inline_image = [](const nlohmann::json& v) {
+        if (!v.is_string()) return false;
+        const auto& s = v.get_ref<const std::string&>();
+        return !s.empty() && !is_image_ref(s) && s.compare(0, IMAGE_REF_JOB.size(), IMAGE_REF_JOB) != 0;
+    };
+    auto strip = [&](nlohmann::json& obj, const std::string& prefix) {
+        for (const char* field : IMAGE_SCALAR_FIELDS) {
+            auto it = obj.find(field);
+            if (it != obj.end() && inline_image(*it)) {
+                obj.erase(it);
+                stripped.push_back(prefix + field);
+            }
+        }
+        for (const char* field : IMAGE_ARRAY_FIELDS) {
+            auto it = obj.find(field);
+            if (it == obj.end() || !it->is_array()) continue;
+            nlohmann::json kept = nlohmann::json::array();
+            for (auto& v : *it) {
+                if (!inline_image(v)) kept.push_back(std::move(v));
+            }
+            if (kept.size() == it->size()) continue;
+            stripped.push_back(prefix + field);
+            if (kept.empty()) {
+                obj.erase(it);
+            } else {
+                *it = std::move(kept);
+            }
+        }
+    };
+
+    strip(params, "");
+    if (params.contains("stages") && params["stages"].is_array()) {
+        auto& stages = params["stages"];
+        for (size_t i = 0; i < stages.size(); ++i) {
+            if (stages[i].is_object()) strip(stages[i], "stages[" + std::to_string(i) + "].");
+        }
+    }
+    return stripped;
+}
+
+std::string spool_image_upload(std::string_view data) {
+    if (data.empty()) {
+        throw std::runtime_error("Empty image upload");
+    }
+    if (!readable_header(data)) {
+        throw std::runtime_error("Uploaded data is not a supported image");
+    }
+
+    // SHA256 of the bytes: collisions are not a practical concern, so an
+    // existing file of that name and size holds this upload
+    const fs::path dir = input_root() / UPLOAD_DIR;
+    utils::Sha256 sha;
+    sha.update(data.data(), data.size());
+    const std::string name = sha.hex_digest() + "." + sniff_extension(data);
+    const fs::path path = dir / name;
+
+    std::error_code ec;
+    if (fs::is_regular_file(path, ec) && fs::file_size(path, ec) == data.size()) {
+        return std::string(IMAGE_REF_OUTPUT) + UPLOAD_DIR + "/" + name;
+    }
+    fs::create_directories(dir, ec);
+    const fs::path tmp = dir / (name + "." + utils::generate_uuid() + ".tmp");
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        if (!out || !out.write(data.data(), static_cast<std::streamsize>(data.size()))) {
+            fs::remove(tmp, ec);
+            throw std::runtime_error("Failed to store uploaded image in " + dir.string());
+        }
+    }
+    fs::rename(tmp, path, ec);
+    if (ec) {
+        fs::remove(tmp, ec);
+        throw std::runtime_error("Failed to store uploaded image: " + ec.message());
+    }
+    return std::string(IMAGE_REF_OUTPUT) + UPLOAD_DIR + "/" + name;
+}
+
+} // namespace sdcpp
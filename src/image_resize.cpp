@@ -0,0 +1,326 @@
+#include "image_resize.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SDCPP_RESIZE_X86 1
+#endif
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#define SDCPP_RESIZE_NEON 1
+#endif
+
+namespace sdcpp {
+
+ResizeFilter resize_filter_from_string(const std::string& name) {
+    std::string n = name;
+    std::transform(n.begin(), n.end(), n.begin(), ::tolower);
+    if (n == "bilinear" || n == "linear" || n == "triangle") return ResizeFilter::Bilinear;
+    if (n == "lanczos" || n == "lanczos3") return ResizeFilter::Lanczos3;
+    if (n == "area" || n == "box") return ResizeFilter::Area;
+    throw std::runtime_error("Unknown resize filter: " + name + " (expected bilinear, lanczos or area)");
+}
+
+namespace {
+
+double filter_support(ResizeFilter filter) {
+    switch (filter) {
+        case ResizeFilter::Lanczos3: return 3.0;
+        case ResizeFilter::Area:     return 0.5;
+        case ResizeFilter::Bilinear:
+        default:                     return 1.0;
+    }
+}
+
+double sinc(double x) {
+    if (x == 0.0) return 1.0;
+    x *= M_PI;
+    return std::sin(x) / x;
+}
+
+double filter_eval(ResizeFilter filter, double x) {
+    switch (filter) {
+        case ResizeFilter::Lanczos3:
+            return (x > -3.0 && x < 3.0) ? sinc(x) * sinc(x / 3.0) : 0.0;
+        case ResizeFilter::Area:
+            return (x > -0.5 && x <= 0.5) ? 1.0 : 0.0;
+        case ResizeFilter::Bilinear:
+        default:
+            x = std::fabs(x);
+            return x < 1.0 ? 1.0 - x : 0.0;
+    }
+}
+
+/**
+ * Per-axis contributions: output i reads `count[i]` inputs from `start[i]`
+ * with weights[i * taps ...], normalized to sum to 1
+ */
+struct Axis {
+    int taps = 0;
+    std::vector<int> start;
+    std::vector<int> count;
+    std::vector<float> weights;
+};
+
+Axis compute_axis(int in_size, int out_size, ResizeFilter filter) {
+    const double scale = static_cast<double>(in_size) / out_size;
+    const double filter_scale = std::max(scale, 1.0);
+    const double support = filter_support(filter) * filter_scale;
+
+    Axis axis;
+    axis.taps = static_cast<int>(std::ceil(support)) * 2 + 1;
+    axis.start.resize(out_size);
+    axis.count.resize(out_size);
+    axis.weights.assign(static_cast<size_t>(out_size) * axis.taps, 0.0f);
+
+    std::vector<double> w(axis.taps);
+    for (int i = 0; i < out_size; ++i) {
+        const double center = (i + 0.5) * scale;
+        int lo = std::max(static_cast<int>(center - support + 0.5), 0);
+        int hi = std::min(static_cast<int>(center + support + 0.5), in_size);
+        int n = std::min(hi - lo, axis.taps);
+
+        double total = 0.0;
+        for (int k = 0; k < n; ++k) {
+            w[k] = filter_eval(filter, (k + lo - center + 0.5) / filter_scale);
+            total += w[k];
+        }
+        if (n <= 0 || total == 0.0) {
+            // Degenerate footprint: nearest sample
+            lo = std::clamp(static_cast<int>(center), 0, in_size - 1);
+            n = 1;
+            w[0] = total = 1.0;
+        }
+
+        axis.start[i] = lo;
+        axis.count[i] = n;
+        float* dst = &axis.weights[static_cast<size_t>(i) * axis.taps];
+        for (int k = 0; k < n; ++k) {
+            dst[k] = static_cast<float>(w[k] / total);
+        }
+    }
+    return axis;
+}
+
+// ── Row kernels ─────────────────────────────────────────────────────────────
+
+// acc[i] += w * x[i]
+using AxpyFn = void (*)(float* acc, const float* x, float w, size_t n);
+// dst[i] = clamp(round(src[i]), 0, 255)
+using StoreFn = void (*)(uint8_t* dst, const float* src, size_t n);
+
+void axpy_scalar(float* acc, const float* x, float w, size_t n) {
+    for (size_t i = 0; i < n; ++i) acc[i] += w * x[i];
+}
+
+void store_scalar(uint8_t* dst, const float* src, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        float v = src[i] + 0.5f;
+        dst[i] = static_cast<uint8_t>(v <= 0.0f ? 0.0f : (v >= 255.0f ? 255.0f : v));
+    }
+}
+
+#ifdef SDCPP_RESIZE_X86
+__attribute__((target("avx2,fma")))
+void axpy_avx2(float* acc, const float* x, float w, size_t n) {
+    const __m256 vw = _mm256_set1_ps(w);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 a = _mm256_loadu_ps(acc + i);
+        a = _mm256_fmadd_ps(vw, _mm256_loadu_ps(x + i), a);
+        _mm256_storeu_ps(acc + i, a);
+    }
+    for (; i < n; ++i) acc[i] += w * x[i];
+}
+
+__attribute__((target("avx2")))
+void store_avx2(uint8_t* dst, const float* src, size_t n) {
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 max = _mm256_set1_ps(255.0f);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 v = _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(src + i), zero), max);
+        __m256i i32 = _mm256_cvtps_epi32(v);
+        __m128i u16 = _mm_packus_epi32(_mm256_castsi256_si128(i32), _mm256_extracti128_si256(i32, 1));
+        __m128i u8 = _mm_packus_epi16(u16, u16);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + i), u8);
+    }
+    store_scalar(dst + i, src + i, n - i);
+}
+#endif
+
+#ifdef SDCPP_RESIZE_NEON
+void axpy_neon(float* acc, const float* x, float w, size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        vst1q_f32(acc + i, vfmaq_n_f32(vld1q_f32(acc + i), vld1q_f32(x + i), w));
+    }
+    for (; i < n; ++i) acc[i] += w * x[i];
+}
+
+void store_neon(uint8_t* dst, const float* src, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        uint32x4_t a = vcvtnq_u32_f32(vmaxq_f32(vld1q_f32(src + i), vdupq_n_f32(0.0f)));
+        uint32x4_t b = vcvtnq_u32_f32(vmaxq_f32(vld1q_f32(src + i + 4), vdupq_n_f32(0.0f)));
+        uint16x8_t u16 = vcombine_u16(vqmovn_u32(a), vqmovn_u32(b));
+        vst1_u8(dst + i, vqmovn_u16(u16));
+    }
+    store_scalar(dst + i, src + i, n - i);
+}
+#endif
+
+struct Kernels {
+    AxpyFn axpy = axpy_scalar;
+    StoreFn store = store_scalar;
+};
+
+const Kernels& kernels() {
+    static const Kernels k = [] {
+        Kernels r;
+#ifdef SDCPP_RESIZE_X86
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+            r.axpy = axpy_avx2;
+            r.store = store_avx2;
+        }
+#endif
+#ifdef SDCPP_RESIZE_NEON
+        r.axpy = axpy_neon;
+        r.store = store_neon;
+#endif
+        return r;
+    }();
+    return k;
+}
+
+// Horizontal pass over one source row into dst_w * C floats
+template <int C>
+void resample_row_fixed(const uint8_t* src, float* out, const Axis& ax, int dst_w) {
+    for (int x = 0; x < dst_w; ++x) {
+        const float* w = &ax.weights[static_cast<size_t>(x) * ax.taps];
+        const uint8_t* p = src + static_cast<size_t>(ax.start[x]) * C;
+        float acc[C] = {};
+        for (int k = 0; k < ax.count[x]; ++k, p += C) {
+            for (int c = 0; c < C; ++c) acc[c] += w[k] * p[c];
+        }
+        for (int c = 0; c < C; ++c) out[x * C + c] = acc[c];
+    }
+}
+
+void resample_row(const uint8_t* src, float* out, const Axis& ax, int dst_w, int channels) {
+    switch (channels) {
+        case 1: resample_row_fixed<1>(src, out, ax, dst_w); return;
+        case 3: resample_row_fixed<3>(src, out, ax, dst_w); return;
+        case 4: resample_row_fixed<4>(src, out, ax, dst_w); return;
+        default: break;
+    }
+    for (int x = 0; x < dst_w; ++x) {
+        const float* w = &ax.weights[static_cast<size_t>(x) * ax.taps];
+        for (int c = 0; c < channels; ++c) {
+            float acc = 0.0f;
+            for (int k = 0; k < ax.count[x]; ++k) {
+                acc += w[k] * src[static_cast<size_t>(ax.start[x] + k) * channels + c];
+            }
+            out[static_cast<size_t>(x) * channels + c] = acc;
+        }
+    }
+}
+
+// Run fn(begin, end) over [0, n) on up to hardware_concurrency threads when
+// `work` (roughly multiply-adds) is large enough to amortize thread start
+template <typename Fn>
+void parallel_rows(int n, size_t work, Fn&& fn) {
+    constexpr size_t MIN_WORK_PER_THREAD = 1u << 20;
+    unsigned hw = std::max(1u, std::thread::hardware_concurrency());
+    size_t threads = std::min<size_t>({hw, static_cast<size_t>(n), std::max<size_t>(1, work / MIN_WORK_PER_THREAD)});
+    if (threads <= 1) {
+        fn(0, n);
+        return;
+    }
+
+    std::vector<std::thread> pool;
+    pool.reserve(threads - 1);
+    const int chunk = static_cast<int>((n + threads - 1) / threads);
+    for (size_t t = 1; t < threads; ++t) {
+        int begin = static_cast<int>(t) * chunk;
+        int end = std::min(n, begin + chunk);
+        if (begin >= end) break;
+        pool.emplace_back([&fn, begin, end] { fn(begin, end); });
+    }
+    fn(0, std::min(n, chunk));
+    for (auto& th : pool) th.join();
+}
+
+} // namespace
+
+void resize_image(const uint8_t* src, int src_w, int src_h, size_t src_stride, int channels,
+                  uint8_t* dst, int dst_w, int dst_h, ResizeFilter filter) {
+    if (!src || !dst || src_w <= 0 || src_h <= 0 || dst_w <= 0 || dst_h <= 0 || channels <= 0) {
+        throw std::runtime_error("resize_image: invalid dimensions");
+    }
+
+    const size_t dst_row = static_cast<size_t>(dst_w) * channels;
+    if (src_w == dst_w && src_h == dst_h) {
+        for (int y = 0; y < src_h; ++y) {
+            std::copy_n(src + y * src_stride, dst_row, dst + y * dst_row);
+        }
+        return;
+    }
+
+    const Axis ax = compute_axis(src_w, dst_w, filter);
+    const Axis ay = compute_axis(src_h, dst_h, filter);
+    const Kernels& k = kernels();
+
+    // Only source rows some output row reads need the horizontal pass
+    const int row_lo = ay.start.front();
+    const int row_hi = ay.start.back() + ay.count.back();
+
+    std::vector<float> tmp(static_cast<size_t>(row_hi - row_lo) * dst_row);
+    parallel_rows(row_hi - row_lo, static_cast<size_t>(row_hi - row_lo) * dst_row * ax.taps,
+        [&](int begin, int end) {
+            for (int r = begin; r < end; ++r) {
+                resample_row(src + static_cast<size_t>(row_lo + r) * src_stride,
+                             &tmp[static_cast<size_t>(r) * dst_row], ax, dst_w, channels);
+            }
+        });
+
+    parallel_rows(dst_h, static_cast<size_t>(dst_h) * dst_row * ay.taps,
+        [&](int begin, int end) {
+            std::vector<float> acc(dst_row);
+            for (int y = begin; y < end; ++y) {
+                std::fill(acc.begin(), acc.end(), 0.0f);
+                const float* w = &ay.weights[static_cast<size_t>(y) * ay.taps];
+                for (int t = 0; t < ay.count[y]; ++t) {
+                    const float* row = &tmp[static_cast<size_t>(ay.start[y] - row_lo + t) * dst_row];
+                    k.axpy(acc.data(), row, w[t], dst_row);
+                }
+                k.store(dst + static_cast<size_t>(y) * dst_row, acc.data(), dst_row);
+            }
+        });
+}
+
+std::vector<uint8_t> resize_image(const uint8_t* src, int src_w, int src_h, int channels,
+                                  int dst_w, int dst_h, ResizeFilter filter) {
+    std::vector<uint8_t> out(static_cast<size_t>(dst_w) * dst_h * channels);
+    resize_image(src, src_w, src_h, static_cast<size_t>(src_w) * channels, channels,
+                 out.data(), dst_w, dst_h, filter);
+    return out;
+}
+
+std::vector<uint8_t> make_square_thumbnail(const uint8_t* src, int src_w, int src_h, int channels, int size) {
+    const int crop = std::min(src_w, src_h);
+    const int crop_x = (src_w - crop) / 2;
+    const int crop_y = (src_h - crop) / 2;
+    const size_t stride = static_cast<size_t>(src_w) * channels;
+
+    std::vector<uint8_t> out(static_cast<size_t>(size) * size * channels);
+    resize_image(src + crop_y * stride + static_cast<size_t>(crop_x) * channels,
+                 crop, crop, stride, channels, out.data(), size, size, ResizeFilter::Area);
+    return out;
+}
+
+} // namespace sdcpp
@@ -0,0 +1,121 @@
+#include "job_events.hpp"
+
+#include <algorithm>
+
+namespace sdcpp {
+
+namespace {
+
+// Events a watcher may fall behind by; the oldest go first
+constexpr size_t MAX_QUEUED_EVENTS = 256;
+
+bool is_terminal(const std::string& name, const nlohmann::json& data) {
+    if (name == "cancelled" || name == "deleted") return true;
+    if (name != "status" || !data.is_object()) return false;
+    const std::string status = data.value("status", "");
+    return status == "completed" || status == "failed" || status == "cancelled";
+}
+
+} // namespace
+
+JobEvents::Watch::~Watch() {
+    owner_.remove(job_id_, this);
+}
+
+std::optional<JobEvents::Event> JobEvents::Watch::next(std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!cv_.wait_for(lock, timeout, [this] { return !events_.empty() || closed_; }) || events_.empty()) {
+        return std::nullopt;
+    }
+    Event event = std::move(events_.front());
+    events_.pop_front();
+    return event;
+}
+
+bool JobEvents::Watch::finished() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return finished_ && events_.empty();
+}
+
+bool JobEvents::Watch::closed() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return closed_;
+}
+
+void JobEvents::Watch::push(const Event& event, bool terminal) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (finished_) return;
+        // A watcher that hasn't read the last progress only needs the newest
+        if (event.name == "progress" && !events_.empty() && events_.back().name == "progress") {
+            events_.back() = event;
+        } else {
+            if (events_.size() >= MAX_QUEUED_EVENTS) events_.pop_front();
+            events_.push_back(event);
+        }
+        finished_ = terminal;
+    }
+    cv_.notify_all();
+}
+
+void JobEvents::Watch::close() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+    }
+    cv_.notify_all();
+}
+
+JobEvents::JobEvents(size_t max_watches) : max_watches_(max_watches) {}
+
+std::shared_ptr<JobEvents::Watch> JobEvents::watch(const std::string& job_id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (closed_ || open_ >= max_watches_) {
+        rejected_++;
+        return nullptr;
+    }
+    std::shared_ptr<Watch> w(new Watch(*this, job_id));
+    watches_[job_id].push_back(w.get());
+    open_++;
+    return w;
+}
+
+void JobEvents::publish(const std::string& job_id, const std::string& name, const nlohmann::json& data) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = watches_.find(job_id);
+    if (it == watches_.end()) return;
+    const bool terminal = is_terminal(name, data);
+    const Event event{name, data};
+    for (auto* w : it->second) w->push(event, terminal);
+    published_++;
+}
+
+void JobEvents::close() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    closed_ = true;
+    for (auto& [job_id, list] : watches_) {
+        for (auto* w : list) w->close();
+    }
+}
+
+nlohmann::json JobEvents::stats_json() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return {
+        {"watches", open_},
+        {"max_watches", max_watches_},
+        {"rejected", rejected_},
+        {"published", published_}
+    };
+}
+
+void JobEvents::remove(const std::string& job_id, Watch* watch) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = watches_.find(job_id);
+    if (it == watches_.end()) return;
+    auto& list = it->second;
+    list.erase(std::remove(list.begin(), list.end(), watch), list.end());
+    if (list.empty()) watches_.erase(it);
+    open_--;
+}
+
+} // namespace sdcpp
@@ -0,0 +1,293 @@
+#include "job_scheduler.hpp"
+#include "utils.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <regex>
+#include <stdexcept>
+
+namespace sdcpp {
+
+namespace {
+
+// Charged time below this is dropped rather than kept decaying forever
+constexpr double USAGE_FLOOR_SECONDS = 0.01;
+
+} // namespace
+
+const char* job_priority_to_string(JobPriority priority) {
+    switch (priority) {
+        case JobPriority::Interactive: return "interactive";
+        case JobPriority::Batch:       return "batch";
+        default:                       return "normal";
+    }
+}
+
+JobPriority string_to_job_priority(const std::string& str) {
+    if (str == "interactive") return JobPriority::Interactive;
+    if (str == "normal") return JobPriority::Normal;
+    if (str == "batch") return JobPriority::Batch;
+    throw std::runtime_error("priority must be \"interactive\", \"normal\" or \"batch\", got: " + str);
+}
+
+JobScheduler::JobScheduler(const QueueConfig& config) : config_(config) {}
+
+const char* JobScheduler::reason_to_string(Reason reason) {
+    switch (reason) {
+        case Reason::Affinity:  return "affinity";
+        case Reason::Fairness:  return "fairness";
+        case Reason::Priority:  return "priority";
+        case Reason::FairShare: return "fair_share";
+        default:                return "fifo";
+    }
+}
+
+std::string JobScheduler::affinity_key(const nlohmann::json& params,
+                                       const nlohmann::json& model_settings) {
+    std::string key = "model=";
+    if (model_settings.is_object() && model_settings.contains("model_name") &&
+        model_settings["model_name"].is_string()) {
+        key += model_settings["model_name"].get<std::string>();
+    }
+    if (!params.is_object()) {
+        return key;
+    }
+
+    // Same tag grammar as SDWrapper::parse_loras_from_prompt. Names are not
+    // resolved against the LoRA dir here — the raw tag is enough to tell two
+    // jobs' LoRA sets apart, and this runs under queue_mutex_.
+    static const std::regex lora_re(R"(<lora:([^:>]+):([^>]+)>)");
+    std::vector<std::string> loras;
+    auto collect = [&](const nlohmann::json& obj) {
+        for (const char* field : {"prompt", "negative_prompt"}) {
+            if (!obj.contains(field) || !obj[field].is_string()) continue;
+            const std::string& text = obj[field].get_ref<const std::string&>();
+            if (text.find("<lora:") == std::string::npos) continue;
+            for (auto it = std::sregex_iterator(text.begin(), text.end(), lora_re);
+                 it != std::sregex_iterator(); ++it) {
+                loras.push_back((*it)[1].str() + ":" + (*it)[2].str());
+            }
+        }
+    };
+    collect(params);
+    if (params.contains("inpaint_params") && params["inpaint_params"].is_object()) {
+        collect(params["inpaint_params"]);
+    }
+    if (!loras.empty()) {
+        std::sort(loras.begin(), loras.end());
+        key += "|lora=";
+        for (size_t i = 0; i < loras.size(); ++i) {
+            if (i) key += ",";
+            key += loras[i];
+        }
+    }
+
+    if (params.contains("detector") && params["detector"].is_string()) {
+        key += "|detector=" + params["detector"].get<std::string>();
+    }
+    return key;
+}
+
+size_t JobScheduler::lookahead() const {
+    if (!affinity_enabled()) return 1;
+    return static_cast<size_t>(std::max(1, config_.affinity_lookahead));
+}
+
+JobPriority JobScheduler::effective_priority(JobPriority priority,
+                                             std::chrono::system_clock::time_point created_at,
+                                             std::chrono::system_clock::time_point now) const {
+    int level = static_cast<int>(priority);
+    if (config_.priority_aging_seconds > 0 && now > created_at) {
+        const auto waited = std::chrono::duration_cast<std::chrono::seconds>(now - created_at).count();
+        level -= static_cast<int>(std::min<int64_t>(level, waited / config_.priority_aging_seconds));
+    }
+    return static_cast<JobPriority>(level);
+}
+
+double JobScheduler::usage_of(const std::string& owner, std::chrono::steady_clock::time_point now) const {
+    auto it = usage_.find(owner);
+    if (it == usage_.end()) return 0.0;
+    const double elapsed = std::chrono::duration<double>(now - it->second.at).count();
+    return it->second.seconds * std::exp2(-elapsed / config_.fair_share_half_life_seconds);
+}
+
+void JobScheduler::charge(const std::string& owner, double seconds) {
+    if (config_.fair_share_half_life_seconds <= 0 || seconds <= 0.0) return;
+    const auto now = std::chrono::steady_clock::now();
+    const double total = usage_of(owner, now) + seconds;
+    usage_[owner] = Usage{total, now};
+
+    // Forget users whose share has decayed away
+    for (auto it = usage_.begin(); it != usage_.end(); ) {
+        if (usage_of(it->first, now) < USAGE_FLOOR_SECONDS) {
+            it = usage_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void JobScheduler::rank(std::vector<Candidate>& candidates) {
+    rank_reason_ = Reason::Fifo;
+    if (candidates.empty()) return;
+
+    const auto now = std::chrono::system_clock::now();
+    const auto steady_now = std::chrono::steady_clock::now();
+    const bool fair_share = config_.fair_share_half_life_seconds > 0 && !usage_.empty();
+
+    struct Ranked {
+        int level;
+        double usage;
+        size_t order;
+    };
+    std::vector<Ranked> keys;
+    keys.reserve(candidates.size());
+    std::unordered_map<std::string, double> shares;
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        const auto& c = candidates[i];
+        double usage = 0.0;
+        if (fair_share) {
+            auto [it, inserted] = shares.try_emplace(c.owner, 0.0);
+            if (inserted) it->second = usage_of(c.owner, steady_now);
+            usage = it->second;
+        }
+        keys.push_back({static_cast<int>(effective_priority(c.priority, c.created_at, now)), usage, i});
+    }
+
+    std::vector<size_t> order(candidates.size());
+    for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+    const size_t keep = std::min(lookahead(), candidates.size());
+    auto better = [&](size_t a, size_t b) {
+        const Ranked& x = keys[a];
+        const Ranked& y = keys[b];
+        if (x.level != y.level) return x.level < y.level;
+        if (x.usage != y.usage) return x.usage < y.usage;
+        return x.order < y.order;
+    };
+    std::partial_sort(order.begin(), order.begin() + keep, order.end(), better);
+
+    if (order[0] != 0) {
+        rank_reason_ = keys[order[0]].level < keys[0].level ? Reason::Priority : Reason::FairShare;
+    }
+
+    std::vector<Candidate> ranked;
+    ranked.reserve(keep);
+    for (size_t i = 0; i < keep; ++i) ranked.push_back(std::move(candidates[order[i]]));
+    candidates = std::move(ranked);
+}
+
+size_t JobScheduler::pick(const std::vector<Candidate>& candidates, Reason* reason_out, int worker) {
+    if (candidates.empty()) return 0;
+
+    size_t chosen = 0;
+    Reason reason = Reason::Fifo;
+    // Each worker keeps its own context warm: its LoRA set and detector
+    std::string& last_key = last_keys_[worker];
+
+    if (affinity_enabled() && candidates.size() > 1 && !last_key.empty() &&
+        candidates[0].affinity_key != last_key) {
+        const auto& head = candidates[0];
+        const auto now = std::chrono::system_clock::now();
+        const auto waited = std::chrono::duration_cast<std::chrono::seconds>(now - head.created_at).count();
+        auto skip_it = skip_counts_.find(head.job_id);
+        const int skips = skip_it == skip_counts_.end() ? 0 : skip_it->second;
+
+        if (skips >= config_.affinity_max_skips || waited >= config_.affinity_max_wait_seconds) {
+            reason = Reason::Fairness;
+        } else {
+            // Affinity never lets a job past one of a better class
+            const JobPriority head_level = effective_priority(head.priority, head.created_at, now);
+            for (size_t i = 1; i < candidates.size(); ++i) {
+                if (effective_priority(candidates[i].priority, candidates[i].created_at, now) != head_level) {
+                    break;  // Ranked: every later candidate is of a worse class too
+                }
+                if (candidates[i].affinity_key == last_key) {
+                    chosen = i;
+                    reason = Reason::Affinity;
+                    break;
+                }
+            }
+        }
+    } else if (affinity_enabled() && !last_key.empty() &&
+               candidates[0].affinity_key == last_key) {
+        reason = Reason::Affinity;
+    }
+
+    // The head got there by rank(), ahead of older jobs
+    if (chosen == 0 && reason == Reason::Fifo) reason = rank_reason_;
+    rank_reason_ = Reason::Fifo;
+
+    // Every job ahead of the chosen one was passed over once more
+    for (size_t i = 0; i < chosen; ++i) {
+        skip_counts_[candidates[i].job_id]++;
+    }
+    skip_counts_.erase(candidates[chosen].job_id);
+
+    switch (reason) {
+        case Reason::Fifo:     fifo_picks_++; break;
+        case Reason::Affinity: affinity_picks_++; break;
+        case Reason::Fairness: fairness_picks_++; break;
+        case Reason::Priority: priority_picks_++; break;
+        case Reason::FairShare: fair_share_picks_++; break;
+    }
+    if (chosen > 0 || reason == Reason::Priority || reason == Reason::FairShare) jobs_reordered_++;
+
+    last_key = candidates[chosen].affinity_key;
+    last_key_ = last_key;
+
+    Decision d;
+    d.job_id = candidates[chosen].job_id;
+    d.worker = worker;
+    d.affinity_key = last_key;
+    d.reason = reason;
+    d.passed_over = chosen;
+    d.at = std::chrono::system_clock::now();
+    recent_.push_front(std::move(d));
+    if (recent_.size() > RECENT_DECISIONS) recent_.pop_back();
+
+    if (reason_out) *reason_out = reason;
+    return chosen;
+}
+
+void JobScheduler::forget(const std::string& job_id) {
+    skip_counts_.erase(job_id);
+}
+
+nlohmann::json JobScheduler::status_json() const {
+    nlohmann::json recent = nlohmann::json::array();
+    for (const auto& d : recent_) {
+        recent.push_back({
+            {"job_id", d.job_id},
+            {"worker", d.worker},
+            {"affinity_key", d.affinity_key},
+            {"reason", reason_to_string(d.reason)},
+            {"passed_over", d.passed_over},
+            {"at", utils::time_to_string(d.at)}
+        });
+    }
+    nlohmann::json shares = nlohmann::json::object();
+    const auto now = std::chrono::steady_clock::now();
+    for (const auto& [owner, usage] : usage_) {
+        shares[owner.empty() ? "(anonymous)" : owner] = usage_of(owner, now);
+    }
+    return {
+        {"policy", config_.scheduler},
+        {"last_affinity_key", last_key_.empty() ? nlohmann::json(nullptr) : nlohmann::json(last_key_)},
+        {"picks", {
+            {"fifo", fifo_picks_},
+            {"affinity", affinity_picks_},
+            {"fairness", fairness_picks_},
+            {"priority", priority_picks_},
+            {"fair_share", fair_share_picks_}
+        }},
+        {"jobs_reordered", jobs_reordered_},
+        {"max_skips", config_.affinity_max_skips},
+        {"max_wait_seconds", config_.affinity_max_wait_seconds},
+        {"priority_aging_seconds", config_.priority_aging_seconds},
+        {"fair_share_half_life_seconds", config_.fair_share_half_life_seconds},
+        {"fair_share_seconds", shares},
+        {"recent_decisions", recent}
+    };
+}
+
+} // namespace sdcpp
@@ -0,0 +1,163 @@
+#include "job_timings.hpp"
+#include "memory_utils.hpp"
+#include "job_trace.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+
+namespace sdcpp {
+
+namespace {
+
+thread_local JobTimings* current_timings = nullptr;
+
+std::mutex split_mutex;
+std::shared_ptr<const std::vector<JobTimings::DeviceShare>> device_split;
+
+int64_t ms_since(std::chrono::steady_clock::time_point t) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - t).count();
+}
+
+// sd.cpp's names for what it reports, in API terms
+std::string phase_name(const std::string& sd_name) {
+    if (sd_name == "apply_loras") return "lora_apply";
+    if (sd_name == "get_learned_condition") return "conditioning";
+    if (sd_name == "decode_first_stage") return "vae_decode";
+    if (sd_name == "encode_first_stage") return "vae_encode";
+    if (sd_name == "loading tensors") return "model_load";
+    return sd_name;
+}
+
+} // namespace
+
+JobTimings::JobTimings()
+    : start_(std::chrono::steady_clock::now()), last_tick_(start_) {
+    {
+        std::lock_guard<std::mutex> lock(split_mutex);
+        if (device_split) devices_ = *device_split;
+    }
+    sample_memory();
+}
+
+void JobTimings::set_device_split(std::vector<DeviceShare> devices) {
+    std::lock_guard<std::mutex> lock(split_mutex);
+    device_split = devices.empty() ? nullptr
+                                   : std::make_shared<const std::vector<DeviceShare>>(std::move(devices));
+}
+
+JobTimings::Scope::Scope(JobTimings& timings) : previous_(current_timings) {
+    current_timings = &timings;
+}
+
+JobTimings::Scope::~Scope() {
+    current_timings = previous_;
+}
+
+JobTimings::Span::Span(const char* name)
+    : name_(name), start_(std::chrono::steady_clock::now()) {
+}
+
+JobTimings::Span::~Span() {
+    if (current_timings) current_timings->add_phase(name_, ms_since(start_));
+}
+
+JobTimings* JobTimings::current() {
+    return current_timings;
+}
+
+void JobTimings::note_sd_log(const std::string& message) {
+    JobTimings* t = current_timings;
+    if (!t) return;
+
+    // "sampling completed, taking 12.34s" / "get_learned_condition completed, taking 51 ms"
+    static const std::string marker = " completed, taking ";
+    auto pos = message.find(marker);
+    if (pos == std::string::npos || pos == 0) return;
+    const char* begin = message.c_str() + pos + marker.size();
+    char* end = nullptr;
+    double value = std::strtod(begin, &end);
+    if (end == begin) return;
+    while (*end == ' ') ++end;
+    const bool millis = end[0] == 'm' && end[1] == 's';
+
+    std::string name = phase_name(message.substr(0, pos));
+    if (name == "sampling" && t->samplings_++ > 0) name = "hires_sampling";
+    t->add_phase(name, static_cast<int64_t>(millis ? value + 0.5 : value * 1000.0 + 0.5));
+}
+
+void JobTimings::note_step() {
+    JobTimings* t = current_timings;
+    if (!t) return;
+    auto now = std::chrono::steady_clock::now();
+    t->window_steps_.push_back(
+        std::chrono::duration_cast<std::chrono::milliseconds>(now - t->last_tick_).count());
+    t->last_tick_ = now;
+    t->sample_memory();
+}
+
+void JobTimings::sample_memory() {
+    MemoryInfo mem = get_memory_info();
+    window_rss_ = std::max<uint64_t>(window_rss_, mem.process_rss);
+    if (mem.gpu_available) window_vram_ = std::max<uint64_t>(window_vram_, mem.gpu_used);
+    peak_rss_ = std::max(peak_rss_, window_rss_);
+    peak_vram_ = std::max(peak_vram_, window_vram_);
+}
+
+void JobTimings::add_phase(const std::string& name, int64_t ms) {
+    JobTrace::note_phase(name, ms);
+    sample_memory();
+    Phase p;
+    p.name = name;
+    p.ms = ms;
+    p.peak_rss = window_rss_;
+    p.peak_vram = window_vram_;
+    p.step_ms = std::move(window_steps_);
+    phases_.push_back(std::move(p));
+
+    window_steps_.clear();
+    window_rss_ = 0;
+    window_vram_ = 0;
+    last_tick_ = std::chrono::steady_clock::now();
+}
+
+nlohmann::json JobTimings::to_json() const {
+    nlohmann::json phases = nlohmann::json::array();
+    for (const auto& p : phases_) {
+        nlohmann::json j = {
+            {"name", p.name},
+            {"ms", p.ms},
+            {"peak_rss_bytes", p.peak_rss}
+        };
+        if (p.peak_vram > 0) j["peak_vram_bytes"] = p.peak_vram;
+        if (!p.step_ms.empty()) j["step_ms"] = p.step_ms;
+        if (!devices_.empty()) {
+            // A layer split runs the devices one after another within a
+            // graph, with two link crossings per remote device. Sampling
+            // evaluates one graph per step; other phases count as one.
+            const double graphs = p.step_ms.empty() ? 1.0 : static_cast<double>(p.step_ms.size());
+            nlohmann::json devs = nlohmann::json::array();
+            for (const auto& d : devices_) {
+                devs.push_back({
+                    {"device", d.device},
+                    {"busy_ms", static_cast<int64_t>(p.ms * d.share + 0.5)},
+                    {"transfer_ms", static_cast<int64_t>(graphs * 2.0 * d.rtt_ms + 0.5)}
+                });
+            }
+            j["devices"] = std::move(devs);
+        }
+        phases.push_back(std::move(j));
+    }
+    nlohmann::json j = {
+        {"run_ms", ms_since(start_)},
+        {"phases", phases},
+        {"peak_rss_bytes", peak_rss_}
+    };
+    if (queue_wait_ms_ >= 0) j["queue_wait_ms"] = queue_wait_ms_;
+    if (peak_vram_ > 0) j["peak_vram_bytes"] = peak_vram_;
+    return j;
+}
+
+} // namespace sdcpp
@@ -0,0 +1,253 @@
+#include "job_trace.hpp"
+
+#include <chrono>
+#include <shared_mutex>
+#include <unordered_map>
+
+namespace sdcpp {
+
+std::atomic<bool> JobTrace::enabled_{false};
+
+namespace {
+
+std::shared_mutex registry_mutex;
+std::unordered_map<std::string, std::shared_ptr<JobTrace>> registry;
+std::atomic<uint64_t> next_serial{1};
+
+const std::chrono::steady_clock::time_point clock_origin = std::chrono::steady_clock::now();
+
+thread_local JobTrace* current_trace = nullptr;
+thread_local std::string thread_name;
+thread_local int64_t last_step_us = 0;
+
+// Buffer of the trace this thread wrote to last; keyed by serial, not by
+// pointer, so a new trace reusing a freed address never hits
+thread_local uint64_t cached_serial = 0;
+thread_local void* cached_buffer = nullptr;
+
+// Set by RequestScope; start() binds the new trace to it
+struct RequestState {
+    bool active = false;
+    int64_t start_us = 0;
+    std::string name;
+    std::shared_ptr<JobTrace> trace;
+};
+thread_local RequestState request;
+
+} // namespace
+
+JobTrace::ThreadBuffer::~ThreadBuffer() {
+    for (auto& chunk : chunks) delete[] chunk.load(std::memory_order_relaxed);
+}
+
+JobTrace::JobTrace(std::string job_id)
+    : job_id_(std::move(job_id)), serial_(next_serial.fetch_add(1)), created_us_(now_us()) {
+}
+
+JobTrace::~JobTrace() = default;
+
+void JobTrace::set_enabled(bool enabled) {
+    enabled_.store(enabled, std::memory_order_relaxed);
+}
+
+std::shared_ptr<JobTrace> JobTrace::start(const std::string& job_id) {
+    if (!enabled()) return nullptr;
+    auto trace = std::make_shared<JobTrace>(job_id);
+    {
+        std::unique_lock<std::shared_mutex> lock(registry_mutex);
+        registry[job_id] = trace;
+    }
+    if (request.active && !request.trace) request.trace = trace;
+    return trace;
+}
+
+std::shared_ptr<JobTrace> JobTrace::find(const std::string& job_id) {
+    if (!enabled()) return nullptr;
+    std::shared_lock<std::shared_mutex> lock(registry_mutex);
+    auto it = registry.find(job_id);
+    return it != registry.end() ? it->second : nullptr;
+}
+
+std::shared_ptr<JobTrace> JobTrace::take(const std::string& job_id) {
+    if (!enabled()) return nullptr;
+    std::unique_lock<std::shared_mutex> lock(registry_mutex);
+    auto it = registry.find(job_id);
+    if (it == registry.end()) return nullptr;
+    auto trace = std::move(it->second);
+    registry.erase(it);
+    return trace;
+}
+
+JobTrace* JobTrace::current() {
+    return current_trace;
+}
+
+JobTrace::Scope::Scope(JobTrace* trace) : previous_(current_trace) {
+    current_trace = trace;
+    last_step_us = now_us();
+}
+
+JobTrace::Scope::~Scope() {
+    current_trace = previous_;
+}
+
+JobTrace::Span::Span(const char* name, const char* category)
+    : Span(current_trace, name, category) {
+}
+
+JobTrace::Span::Span(JobTrace* trace, const char* name, const char* category)
+    : trace_(trace), name_(name), category_(category) {
+    if (trace_) start_us_ = now_us();
+}
+
+JobTrace::Span::~Span() {
+    if (trace_) trace_->complete(name_, category_, start_us_, now_us());
+}
+
+JobTrace::RequestScope::RequestScope(const std::string& method, const std::string& route) {
+    if (!enabled()) return;
+    active_ = true;
+    request.active = true;
+    request.start_us = now_us();
+    request.name = method + " " + route;
+    request.trace.reset();
+}
+
+JobTrace::RequestScope::~RequestScope() {
+    if (!active_) return;
+    if (request.trace) {
+        request.trace->complete(request.name, "http", request.start_us, now_us());
+    }
+    request.active = false;
+    request.trace.reset();
+}
+
+void JobTrace::set_thread_name(const std::string& name) {
+    thread_name = name;
+}
+
+void JobTrace::note_step(int step, int steps) {
+    JobTrace* t = current_trace;
+    if (!t) return;
+    const int64_t now = now_us();
+    t->complete("step " + std::to_string(step) + "/" + std::to_string(steps), "sampling", last_step_us, now);
+    last_step_us = now;
+}
+
+void JobTrace::note_phase(const std::string& name, int64_t ms) {
+    JobTrace* t = current_trace;
+    if (!t) return;
+    const int64_t now = now_us();
+    t->complete(name, "phase", now - ms * 1000, now);
+    last_step_us = now;
+}
+
+int64_t JobTrace::now_us() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - clock_origin).count();
+}
+
+JobTrace::ThreadBuffer* JobTrace::buffer_for_this_thread() {
+    if (cached_serial == serial_) return static_cast<ThreadBuffer*>(cached_buffer);
+
+    const auto self = std::this_thread::get_id();
+    ThreadBuffer* buffer = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(buffers_mutex_);
+        for (auto& b : buffers_) {
+            if (b->owner == self) {
+                buffer = b.get();
+                break;
+            }
+        }
+        if (!buffer) {
+            auto b = std::make_unique<ThreadBuffer>();
+            b->owner = self;
+            b->tid = static_cast<int>(buffers_.size()) + 1;
+            b->thread_name = thread_name.empty() ? "thread-" + std::to_string(b->tid) : thread_name;
+            buffer = b.get();
+            buffers_.push_back(std::move(b));
+        }
+    }
+    cached_serial = serial_;
+    cached_buffer = buffer;
+    return buffer;
+}
+
+void JobTrace::push(Event&& event) {
+    ThreadBuffer* b = buffer_for_this_thread();
+    const size_t n = b->count.load(std::memory_order_relaxed);
+    const size_t chunk = n / ThreadBuffer::CHUNK;
+    if (chunk >= ThreadBuffer::MAX_CHUNKS) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    Event* events = b->chunks[chunk].load(std::memory_order_relaxed);
+    if (!events) {
+        events = new Event[ThreadBuffer::CHUNK];
+        b->chunks[chunk].store(events, std::memory_order_release);
+    }
+    events[n % ThreadBuffer::CHUNK] = std::move(event);
+    b->count.store(n + 1, std::memory_order_release);
+}
+
+void JobTrace::complete(const std::string& name, const char* category, int64_t start_us, int64_t end_us,
+                        const std::string& detail) {
+    Event e;
+    e.name = name;
+    e.category = category;
+    e.phase = 'X';
+    e.ts_us = start_us;
+    e.dur_us = end_us > start_us ? end_us - start_us : 0;
+    e.detail = detail;
+    push(std::move(e));
+}
+
+void JobTrace::instant(const std::string& name, const char* category, const std::string& detail) {
+    Event e;
+    e.name = name;
+    e.category = category;
+    e.phase = 'i';
+    e.ts_us = now_us();
+    e.detail = detail;
+    push(std::move(e));
+}
+
+nlohmann::json JobTrace::to_chrome_json() const {
+    nlohmann::json events = nlohmann::json::array();
+    events.push_back({{"name", "process_name"}, {"ph", "M"}, {"pid", 1},
+                      {"args", {{"name", "job " + job_id_}}}});
+
+    std::vector<const ThreadBuffer*> buffers;
+    {
+        std::lock_guard<std::mutex> lock(buffers_mutex_);
+        for (const auto& b : buffers_) buffers.push_back(b.get());
+    }
+    for (const ThreadBuffer* b : buffers) {
+        events.push_back({{"name", "thread_name"}, {"ph", "M"}, {"pid", 1}, {"tid", b->tid},
+                          {"args", {{"name", b->thread_name}}}});
+        const size_t n = b->count.load(std::memory_order_acquire);
+        for (size_t i = 0; i < n; ++i) {
+            const Event& e = b->chunks[i / ThreadBuffer::CHUNK].load(std::memory_order_acquire)[i % ThreadBuffer::CHUNK];
+            nlohmann::json j = {
+                {"name", e.name},
+                {"cat", e.category},
+                {"ph", std::string(1, e.phase)},
+                {"ts", e.ts_us},
+                {"pid", 1},
+                {"tid", b->tid}
+            };
+            if (e.phase == 'X') j["dur"] = e.dur_us;
+            if (e.phase == 'i') j["s"] = "t";
+            if (!e.detail.empty()) j["args"] = {{"detail", e.detail}};
+            events.push_back(std::move(j));
+        }
+    }
+    return {
+        {"traceEvents", events},
+        {"displayTimeUnit", "ms"},
+        {"otherData", {{"job_id", job_id_}, {"dropped_events", dropped_.load()}}}
+    };
+}
+
+} // namespace sdcpp
@@ -0,0 +1,103 @@
+#include "lora_cache.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+
+namespace sdcpp {
+
+std::atomic<int64_t> LoraCache::last_apply_ms_{-1};
+
+LoraCache::LoraCache(uint64_t budget_bytes, bool pin)
+    : files_(std::make_unique<WarmModelCache>(budget_bytes, pin)) {
+}
+
+std::string LoraCache::key(const Lora& l) {
+    return l.is_high_noise ? "|high_noise|" + l.path : l.path;
+}
+
+nlohmann::json LoraCache::prepare(const std::vector<Lora>& loras) {
+    auto t0 = std::chrono::steady_clock::now();
+
+    std::vector<std::string> paths;
+    paths.reserve(loras.size());
+    for (const auto& l : loras) paths.push_back(l.path);
+
+    bool resident = false;
+    if (files_->enabled() && !paths.empty()) {
+        resident = files_->lookup(paths);
+        if (!resident) files_->retain(paths);
+    }
+
+    std::map<std::string, float> next;
+    for (const auto& l : loras) next[key(l)] = l.multiplier;
+
+    nlohmann::json added = nlohmann::json::array();
+    nlohmann::json removed = nlohmann::json::array();
+    nlohmann::json changed = nlohmann::json::array();
+    int unchanged = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto& [k, mul] : next) {
+            auto it = applied_.find(k);
+            if (it == applied_.end()) {
+                added.push_back(k);
+            } else if (std::fabs(it->second - mul) > 1e-6f) {
+                changed.push_back(k);
+            } else {
+                unchanged++;
+            }
+        }
+        for (const auto& [k, mul] : applied_) {
+            if (next.find(k) == next.end()) removed.push_back(k);
+        }
+        applied_ = std::move(next);
+    }
+
+    last_apply_ms_.store(-1, std::memory_order_relaxed);
+
+    auto prepare_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - t0).count();
+    return {
+        {"count", loras.size()},
+        {"added", added},
+        {"removed", removed},
+        {"changed", changed},
+        {"unchanged", unchanged},
+        {"resident", resident},
+        {"prepare_ms", prepare_ms}
+    };
+}
+
+void LoraCache::finish(nlohmann::json& info) const {
+    int64_t ms = last_apply_ms_.load(std::memory_order_relaxed);
+    if (ms >= 0) info["apply_ms"] = ms;
+}
+
+void LoraCache::reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    applied_.clear();
+}
+
+nlohmann::json LoraCache::stats_json() const {
+    nlohmann::json j = files_->stats_json();
+    std::lock_guard<std::mutex> lock(mutex_);
+    nlohmann::json applied = nlohmann::json::object();
+    for (const auto& [k, mul] : applied_) applied[k] = mul;
+    j["applied"] = applied;
+    return j;
+}
+
+void LoraCache::note_sd_log(const std::string& message) {
+    // sd.cpp: "apply_loras completed, taking %.2fs"
+    static const std::string marker = "apply_loras completed, taking ";
+    auto pos = message.find(marker);
+    if (pos == std::string::npos) return;
+    const char* begin = message.c_str() + pos + marker.size();
+    char* end = nullptr;
+    double seconds = std::strtod(begin, &end);
+    if (end == begin) return;
+    last_apply_ms_.store(static_cast<int64_t>(seconds * 1000.0 + 0.5), std::memory_order_relaxed);
+}
+
+} // namespace sdcpp
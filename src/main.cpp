@@ -10,6 +10,8 @@
 #include <cstring>
 #include <atomic>
 #include <filesystem>
+#include <future>
+#include <thread>
 #include <unistd.h>
 
 #include "httplib_compat.h"
@@ -19,6 +21,12 @@
 #include "request_handlers.hpp"
 #include "memory_utils.hpp"
 #include "auth_manager.hpp"
+#include "image_encoder.hpp"
+#include "image_input.hpp"
+#include "thumbnail_cache.hpp"
+#include "video_encoder.hpp"
+#include "http_front_end.hpp"
+#include "url_utils.hpp"
 #ifdef SDCPP_WEBSOCKET_ENABLED
 #include "websocket_server.hpp"
 #endif
@@ -26,6 +34,11 @@
 #include "mcp_server.hpp"
 #endif
 #include "sd_error_capture.hpp"
+#include "job_timings.hpp"
+#include "job_trace.hpp"
+#include "cluster_coordinator.hpp"
+#include "startup_status.hpp"
+#include "numa_placement.hpp"
 #include "stable-diffusion.h"
 
 #include <curl/curl.h>
@@ -77,6 +90,10 @@ void sd_log_callback(sd_log_level_t level, const char* text, void* /*data*/) {
     if (level == SD_LOG_ERROR) {
         sdcpp::capture_sd_error(msg);
     }
+    if (level == SD_LOG_INFO) {
+        sdcpp::LoraCache::note_sd_log(msg);
+        sdcpp::JobTimings::note_sd_log(msg);
+    }
 
     if (static_cast<int>(level) < g_sd_log_threshold.load(std::memory_order_relaxed)) {
         return;
@@ -96,6 +113,7 @@ void sd_log_callback(sd_log_level_t level, const char* text, void* /*data*/) {
 static std::atomic<bool> g_running{true};
 static std::atomic<int> g_signal_count{0};
 static httplib::Server* g_server = nullptr;
+static sdcpp::HttpFrontEnd* g_front_end = nullptr;
 #ifdef SDCPP_WEBSOCKET_ENABLED
 static sdcpp::WebSocketServer* g_ws_server = nullptr;
 #endif
@@ -121,6 +139,9 @@ void signal_handler(int signal) {
         if (g_server) {
             g_server->stop();
         }
+        if (g_front_end) {
+            g_front_end->request_stop();
+        }
 
         // Signal WebSocket server to stop (but don't join thread from signal handler)
 #ifdef SDCPP_WEBSOCKET_ENABLED
@@ -136,6 +157,22 @@ void signal_handler(int signal) {
     }
 }
 
+/**
+ * Print the discovered models summary after a scan
+ */
+void print_model_summary(const sdcpp::ModelManager& model_manager) {
+    using sdcpp::ModelType;
+    std::cout << "Found models:\n";
+    std::cout << "  - Checkpoints: " << model_manager.get_models(ModelType::Checkpoint).size() << "\n";
+    std::cout << "  - Diffusion models: " << model_manager.get_models(ModelType::Diffusion).size() << "\n";
+    std::cout << "  - VAE: " << model_manager.get_models(ModelType::VAE).size() << "\n";
+    std::cout << "  - LoRA: " << model_manager.get_models(ModelType::LoRA).size() << "\n";
+    std::cout << "  - CLIP: " << model_manager.get_models(ModelType::CLIP).size() << "\n";
+    std::cout << "  - T5: " << model_manager.get_models(ModelType::T5).size() << "\n";
+    std::cout << "  - ControlNet: " << model_manager.get_models(ModelType::ControlNet).size() << "\n";
+    std::cout << "  - LLM: " << model_manager.get_models(ModelType::LLM).size() << std::endl;
+}
+
 /**
  * Print usage information
  */
@@ -238,6 +275,12 @@ int main(int argc, char* argv[]) {
             std::cout << "Creating output directory: " << config.paths.output << std::endl;
             fs::create_directories(output_path);
         }
+        // "output:" image references in requests resolve against it
+        sdcpp::set_image_input_root(config.paths.output);
+
+        // Memory policy and CPU affinity are inherited by threads created
+        // later, so this has to run before the first one is started
+        sdcpp::apply_numa_process_policy(config.numa);
 
         // Configure CUDA device scheduling for lower CPU usage during generation
 #ifdef SDCPP_USE_CUDA
@@ -277,41 +320,54 @@ int main(int argc, char* argv[]) {
         std::cout << "Initializing auth manager..." << std::endl;
         sdcpp::AuthManager auth_manager(config);
 
+        // Stages that finish behind the listener, reported by /health.
+        // The model reload does not gate readiness: a server without a
+        // model still takes uploads, downloads and queue submissions.
+        sdcpp::StartupStatus startup;
+        startup.add("model_scan");
+        if (config.cluster.role == "coordinator") startup.add("cluster");
+        startup.add("queue");
+        startup.add("model_reload", false);
+
         // Initialize Model Manager
         std::cout << "Initializing model manager..." << std::endl;
         sdcpp::ModelManager model_manager(config);
 
-        // Scan for models
-        std::cout << "Scanning for models..." << std::endl;
-        model_manager.scan_models();
-
-        // Print discovered models summary
-        auto checkpoints = model_manager.get_models(sdcpp::ModelType::Checkpoint);
-        auto diffusion = model_manager.get_models(sdcpp::ModelType::Diffusion);
-        auto vaes = model_manager.get_models(sdcpp::ModelType::VAE);
-        auto loras = model_manager.get_models(sdcpp::ModelType::LoRA);
-        auto clips = model_manager.get_models(sdcpp::ModelType::CLIP);
-        auto t5s = model_manager.get_models(sdcpp::ModelType::T5);
-        auto controlnets = model_manager.get_models(sdcpp::ModelType::ControlNet);
-        auto llms = model_manager.get_models(sdcpp::ModelType::LLM);
-
-        std::cout << "Found models:\n";
-        std::cout << "  - Checkpoints: " << checkpoints.size() << "\n";
-        std::cout << "  - Diffusion models: " << diffusion.size() << "\n";
-        std::cout << "  - VAE: " << vaes.size() << "\n";
-        std::cout << "  - LoRA: " << loras.size() << "\n";
-        std::cout << "  - CLIP: " << clips.size() << "\n";
-        std::cout << "  - T5: " << t5s.size() << "\n";
-        std::cout << "  - ControlNet: " << controlnets.size() << "\n";
-        std::cout << "  - LLM: " << llms.size() << "\n";
+        // Scan for models while the queue state, handlers and routes are
+        // set up; the registry is locked per directory, so /models during
+        // the scan sees what has been found so far
+        std::cout << "Scanning for models (async)..." << std::endl;
+        auto model_scan = std::async(std::launch::async, [&startup, &model_manager]() {
+            startup.run("model_scan", [&model_manager]() {
+                model_manager.scan_models();
+                print_model_summary(model_manager);
+            });
+        });
 
         // Initialize Queue Manager
         std::string state_file = (output_path / "queue_state.json").string();
         std::cout << "Initializing queue manager (state file: " << state_file << ")..." << std::endl;
         std::cout << "  Recycle bin: " << (config.recycle_bin.enabled ? "enabled" : "disabled")
-                  << " (retention: " << config.recycle_bin.retention_minutes << " minutes)" << std::endl;
-        sdcpp::QueueManager queue_manager(model_manager, config.paths.output, state_file, config.recycle_bin);
+                  << " (retention: " << config.recycle_bin.retention_minutes << " minutes"
+                  << (config.recycle_bin.delete_outputs ? ", deletes outputs" : "")
+                  << (config.recycle_bin.output_quota_mb > 0
+                          ? ", output quota: " + std::to_string(config.recycle_bin.output_quota_mb) + " MB" : "")
+                  << ")" << std::endl;
+        // Thumbnail cache: filled by the output pipeline, served by /thumb/.
+        // Declared first so it outlives both.
+        sdcpp::ThumbnailCache thumbnail_cache(config.thumbnails);
+
+        // Coordinator mode: generations go to the cluster's nodes. Declared
+        // before the queue manager, whose remote workers use it.
+        sdcpp::ClusterCoordinator cluster(config.cluster);
+
+        sdcpp::JobTrace::set_enabled(config.queue.trace_jobs);
+        sdcpp::QueueManager queue_manager(model_manager, config.paths.output, state_file,
+                                          config.recycle_bin, config.queue);
+        queue_manager.set_thumbnail_cache(&thumbnail_cache);
         queue_manager.set_group_folders_enabled(config.output_group_folders);
+        queue_manager.set_download_config(config.download);
+        if (cluster.enabled()) queue_manager.set_cluster(&cluster);
 
         // Initialize preview settings from config
         if (config.preview.enabled) {
@@ -325,25 +381,49 @@ int main(int argc, char* argv[]) {
                 preview_mode,
                 config.preview.interval,
                 config.preview.max_size,
-                config.preview.quality
+                config.preview.quality,
+                config.preview.on_demand,
+                config.preview.max_overhead_percent
             );
             std::cout << "Preview enabled: mode=" << config.preview.mode
-                      << ", interval=" << config.preview.interval << std::endl;
+                      << ", interval=" << config.preview.interval
+                      << (config.preview.on_demand ? ", on demand" : "")
+                      << (config.preview.max_overhead_percent > 0
+                              ? ", max overhead " + std::to_string(config.preview.max_overhead_percent) + "%" : "")
+                      << std::endl;
         } else {
             queue_manager.set_preview_settings(sdcpp::PreviewMode::None, 1, 256, 75);
             std::cout << "Preview disabled" << std::endl;
         }
 
+        // Output encoding defaults (per-request output_format overrides)
+        {
+            sdcpp::EncodeOptions encode;
+            encode.format = sdcpp::image_format_from_string(config.output.format);
+            encode.png_compression = config.output.png_compression;
+            encode.lossless = config.output.webp_lossless;
+            encode.quality = encode.format == sdcpp::ImageFormat::Webp ? config.output.webp_quality
+                                                                      : config.output.jpeg_quality;
+            sdcpp::set_default_encode_options(encode, config.output.jpeg_quality, config.output.webp_quality);
+            std::cout << "Output format: " << sdcpp::image_format_to_string(encode.format)
+                      << " (encoders: " << sdcpp::image_encoder_backends().dump() << ")" << std::endl;
+        }
+
+        // Video container/codec defaults for txt2vid
+        sdcpp::set_default_video_config(config.video);
+        std::cout << "Video output: " << config.video.format
+                  << " (backends: " << sdcpp::video_encoder_backends().dump() << ")" << std::endl;
+
         // Initialize HTTP Server
         std::cout << "Initializing HTTP server..." << std::endl;
         httplib::Server server;
         g_server = &server;
 
         // Set server options.
-        // 50 GiB ceiling so multipart model uploads (POST /models/upload) can
-        // accept large checkpoints. Image uploads remain orders of magnitude
-        // smaller; this only sets the upper bound. v1 limitation: cpp-httplib
-        // buffers multipart bodies in memory — keep that in mind when sizing.
+        // 50 GiB ceiling so model uploads (POST /models/upload, WebDAV PUT)
+        // can accept large checkpoints. Those handlers stream the body to
+        // disk through a ContentReader; other endpoints still receive it
+        // buffered in req.body, and their inputs are orders of magnitude smaller.
         server.set_payload_max_length(static_cast<size_t>(50) * 1024 * 1024 * 1024);
 
         // Wire the configured worker pool size. Without this, cpp-httplib
@@ -353,10 +433,12 @@ int main(int argc, char* argv[]) {
         // generation job is also tying up workers with long-poll progress
         // and WS frames. Clamp to a sane range so a misconfigured value
         // doesn't allocate thousands of threads.
+        int pool_threads = config.server.threads;
         {
-            int t = config.server.threads;
+            int t = pool_threads;
             if (t < 4)   t = 4;
             if (t > 256) t = 256;
+            pool_threads = t;
             server.new_task_queue = [t]() { return new httplib::ThreadPool(t); };
             std::cout << "HTTP worker pool size: " << t
                       << (t == config.server.threads ? "" : " (clamped)") << std::endl;
@@ -410,6 +492,9 @@ int main(int argc, char* argv[]) {
                                         config,
                                         config.paths.output, webui_path, config.assistant,
                                         config_path, docs_path);
+        handlers.set_thumbnail_cache(&thumbnail_cache);
+        handlers.set_cluster(&cluster);
+        handlers.set_startup_status(&startup);
         handlers.register_routes(server);
 
         // Initialize MCP server (if enabled at build time)
@@ -478,28 +563,89 @@ int main(int argc, char* argv[]) {
         std::cout << "WebSocket server disabled at build time" << std::endl;
 #endif
 
-        // If a previous run persisted a loaded-model identity, try to
-        // re-load that model now. This used to run synchronously, but bf16
-        // models can take 5+ minutes to load — blocking the HTTP server
-        // from listening for that whole window. Now we spawn a detached
-        // thread; the HTTP server starts listening immediately and the
-        // model loads in parallel. Queued jobs that need a model will
-        // wait via the existing model_loading state machine; new ones
-        // submitted before the load completes will fail with "No model
-        // loaded" same as before, which is honest behavior.
-        std::cout << "Checking for persisted model state (async)..." << std::endl;
-        std::thread([&model_manager]() {
-            try {
-                model_manager.try_auto_reload_from_disk();
-            } catch (const std::exception& e) {
-                std::cerr << "[main] (async) auto-reload threw: "
-                          << e.what() << std::endl;
+        // Event-loop front end: it owns the public port and hands httplib
+        // (moved to a loopback port) one request per connection, so idle
+        // keep-alive and /ws connections don't pin pool threads
+        std::unique_ptr<sdcpp::HttpFrontEnd> front_end;
+        if (config.server.event_loop && !sdcpp::HttpFrontEnd::supported()) {
+            std::cerr << "Warning: server.event_loop needs epoll (Linux); "
+                      << "serving from httplib's thread pool" << std::endl;
+        } else if (config.server.event_loop) {
+            const int backend_port = server.bind_to_any_port("127.0.0.1");
+            if (backend_port < 0) {
+                std::cerr << "Error: Failed to bind a loopback port for the request handlers" << std::endl;
+                return 1;
             }
-        }).detach();
+            sdcpp::FrontEndOptions options;
+            options.host = config.server.host;
+            options.port = config.server.port;
+            options.backend_port = backend_port;
+            options.max_connections = static_cast<size_t>(config.server.max_connections);
+            options.max_in_flight = static_cast<size_t>(pool_threads);
+            options.keep_alive_timeout_sec = config.server.keep_alive_timeout;
+
+            sdcpp::WebSocketHooks ws_hooks;
+#ifdef SDCPP_WEBSOCKET_ENABLED
+            auto* ws = ws_server.get();
+            ws_hooks.open = [ws](const httplib::Request& req, std::function<void()> wake) {
+                return ws->open_client(req, std::move(wake));
+            };
+            ws_hooks.message = [ws](size_t id, const std::string& text) { ws->client_message(id, text); };
+            ws_hooks.next = [ws](size_t id, std::shared_ptr<const std::string>& payload, bool& binary) {
+                return ws->next_message(id, payload, binary);
+            };
+            ws_hooks.close = [ws](size_t id) { ws->close_client(id); };
+#endif
+            front_end = std::make_unique<sdcpp::HttpFrontEnd>(options, std::move(ws_hooks));
+            sdcpp::set_peer_header_token(front_end->peer_token());
+            front_end->start();
+            g_front_end = front_end.get();
+            handlers.set_front_end(front_end.get());
+        }
 
-        // Start the queue worker
-        std::cout << "Starting queue worker..." << std::endl;
-        queue_manager.start();
+        // Everything that needs the model registry runs once the scan is
+        // done, behind the listener: the cluster's first poll, the queue
+        // workers (restored jobs resolve their models) and the model
+        // reload. Submissions before then are queued, not rejected.
+        auto services = std::async(std::launch::async, [&]() {
+            model_scan.wait();
+            if (cluster.enabled()) {
+                std::cout << "Cluster coordinator: " << config.cluster.nodes.size() << " node(s)" << std::endl;
+                startup.run("cluster", [&cluster]() { cluster.start(); });
+            }
+            if (!g_running) return;   // Shutting down before the workers ever started
+
+            std::cout << "Starting queue worker..." << std::endl;
+            startup.run("queue", [&queue_manager]() { queue_manager.start(); });
+
+            // If a previous run persisted a loaded-model identity, try to
+            // re-load that model now. bf16 models can take 5+ minutes to
+            // load, so this is a detached thread that shutdown does not
+            // wait for. Queued jobs that need a model will wait via the
+            // existing model_loading state machine; new ones submitted
+            // before the load completes will fail with "No model loaded"
+            // same as before, which is honest behavior.
+            if (!fs::exists(fs::path(config.paths.output) / "last_loaded_model.json")) {
+                startup.skip("model_reload", "no persisted model");
+                return;
+            }
+            std::cout << "Reloading persisted model (async)..." << std::endl;
+            std::thread([&startup, &model_manager]() {
+                startup.begin("model_reload");
+                try {
+                    if (model_manager.try_auto_reload_from_disk()) {
+                        startup.done("model_reload", model_manager.get_loaded_model_name());
+                    } else {
+                        const std::string error = model_manager.get_last_load_error();
+                        startup.fail("model_reload", error.empty() ? "auto-reload failed" : error);
+                    }
+                } catch (const std::exception& e) {
+                    std::cerr << "[main] (async) auto-reload threw: "
+                              << e.what() << std::endl;
+                    startup.fail("model_reload", e.what());
+                }
+            }).detach();
+        });
 
         // Start HTTP server
         std::cout << "\n========================================" << std::endl;
@@ -516,7 +662,9 @@ int main(int argc, char* argv[]) {
         std::cout << "Auth:         " << (auth_manager.enabled() ? "ENABLED (POST /auth/login to obtain bearer token)" : "DISABLED") << std::endl;
         std::cout << "Press Ctrl+C to stop (twice to force quit)\n" << std::endl;
 
-        if (!server.listen(config.server.host, config.server.port)) {
+        const bool served = front_end ? server.listen_after_bind()
+                                      : server.listen(config.server.host, config.server.port);
+        if (!served) {
             if (g_running) {
                 std::cerr << "Error: Failed to start server on "
                           << config.server.host << ":" << config.server.port << std::endl;
@@ -534,9 +682,19 @@ int main(int argc, char* argv[]) {
             g_ws_server = nullptr;
         }
 #endif
+        // After the WebSocket server queued its shutdown notice, so the
+        // loop can still flush it to front-end clients
+        if (front_end) {
+            std::cout << "Stopping event loop..." << std::endl;
+            g_front_end = nullptr;
+            front_end->stop();
+        }
 
+        // The workers must have started before they can be stopped
+        services.wait();
         std::cout << "Stopping queue worker..." << std::endl;
         queue_manager.stop();
+        cluster.stop();
 
         std::cout << "Unloading model..." << std::endl;
         model_manager.unload_model();
@@ -11,6 +11,8 @@
 
 #include <iostream>
 #include <fstream>
+#include <filesystem>
+#include <future>
 #include <optional>
 #include <set>
 #include <vector>
@@ -24,6 +26,48 @@ namespace sdcpp {
 
 using json = nlohmann::json;
 
+namespace {
+
+// Decode → (downscale to max_dim, aspect preserved, never upscale) → JPEG.
+// This bounds payload size regardless of source resolution, so an 8192px
+// upscale comes back as a small JPEG instead of a multi-MB base64 blob.
+// Returns base64 JPEG, or "" with `err` set. Non-decodable outputs (video,
+// webp — stb can't read those) fail here and are reported as skipped.
+std::string encode_preview_jpeg(const std::string& path, int max_dim, int jpeg_quality,
+                                std::string& err) {
+    int w, h, ch;
+    unsigned char* data = stbi_load(path.c_str(), &w, &h, &ch, 3);  // force RGB
+    if (!data) {
+        const char* reason = stbi_failure_reason();
+        err = std::string("decode failed") + (reason ? std::string(": ") + reason : "");
+        return "";
+    }
+    bool resized = false;
+    if (w > max_dim || h > max_dim) {
+        float scale = std::min(static_cast<float>(max_dim) / w,
+                               static_cast<float>(max_dim) / h);
+        int nw = std::max(1, static_cast<int>(w * scale));
+        int nh = std::max(1, static_cast<int>(h * scale));
+        auto* rz = static_cast<unsigned char*>(malloc(static_cast<size_t>(nw) * nh * 3));
+        if (!rz) { stbi_image_free(data); err = "out of memory"; return ""; }
+        stbir_resize_uint8(data, w, h, 0, rz, nw, nh, 0, 3);
+        stbi_image_free(data);
+        data = rz; w = nw; h = nh; resized = true;
+    }
+    std::vector<unsigned char> jpg;
+    auto cb = [](void* ctx, void* d, int s) {
+        auto* v = static_cast<std::vector<unsigned char>*>(ctx);
+        auto* b = static_cast<unsigned char*>(d);
+        v->insert(v->end(), b, b + s);
+    };
+    int ok = stbi_write_jpg_to_func(cb, &jpg, w, h, 3, data, jpeg_quality);
+    if (resized) free(data); else stbi_image_free(data);
+    if (!ok || jpg.empty()) { err = "JPEG encode failed"; return ""; }
+    return utils::base64_encode(jpg.data(), jpg.size());
+}
+
+} // namespace
+
 // ─── Constructor ─────────────────────────────────────────────────────────────
 
 McpServer::McpServer(httplib::Server& server, ModelManager& model_manager, QueueManager& queue_manager,
@@ -236,6 +280,7 @@ json McpServer::handle_list_tools() {
                 {"steps", {{"type", "integer"}, {"description", "Number of sampling steps"}}},
                 {"cfg_scale", {{"type", "number"}, {"description", "Classifier-free guidance scale"}}},
                 {"seed", {{"type", "integer"}, {"description", "Random seed (-1 for random)"}}},
+                {"dedup", {{"type", "boolean"}, {"description", "Reuse an identical fixed-seed job instead of queueing a new one (default true)"}}},
                 {"batch_count", {{"type", "integer"}, {"description", "Number of images to generate (txt2img only)"}}},
                 {"sampler", {{"type", "string"}, {"description", "Sampler name (e.g., euler, euler_a, dpm++2m)"}}},
                 {"scheduler", {{"type", "string"}, {"description", "Scheduler name (e.g., normal, karras, sgm_uniform)"}}},
@@ -278,6 +323,7 @@ json McpServer::handle_list_tools() {
         {"params_backend", {{"type", "string"}, {"description", "Parameter storage backend. Set to \"*=cpu\" for the global \"keep all weights in RAM\" mode (replaces offload_to_cpu)."}}},
         {"max_vram", {{"type", "number"}, {"description", "GiB budget for graph-cut segmented param offload (0 = disabled)"}}},
         {"stream_layers", {{"type", "boolean"}, {"description", "Engage residency+async-prefetch streaming on top of max_vram (no effect without max_vram > 0)"}}},
+        {"mlock", {{"type", "boolean"}, {"description", "Lock the loaded weight buffers in RAM (default: server numa.mlock)"}}},
         {"eager_load", {{"type", "boolean"}, {"description", "Pre-load all params into the params backend at model-load time instead of lazily on first use (leejet PR #1687). Pairs with stream_layers on a CPU params backend."}}}
 #ifdef SDCPP_EXPERIMENTAL_OFFLOAD
         ,
@@ -308,13 +354,14 @@ json McpServer::handle_list_tools() {
     // 3. job — unified job management tool
     tools.push_back({
         {"name", "job"},
-        {"description", "Manage generation jobs: get status, cancel, delete (soft-delete to recycle bin), or search the queue."},
+        {"description", "Manage generation jobs: get status, wait for a job to finish, cancel, delete (soft-delete to recycle bin), or search the queue."},
         {"inputSchema", {
             {"type", "object"},
             {"required", json::array({"action"})},
             {"properties", {
-                {"action", {{"type", "string"}, {"enum", {"status", "cancel", "delete", "search"}}, {"description", "Action to perform"}}},
-                {"job_id", {{"type", "string"}, {"description", "Job UUID (required for 'status', 'cancel', 'delete')"}}},
+                {"action", {{"type", "string"}, {"enum", {"status", "wait", "cancel", "delete", "search"}}, {"description", "Action to perform. 'wait' returns the job once it has finished, or as it is after timeout seconds"}}},
+                {"job_id", {{"type", "string"}, {"description", "Job UUID (required for 'status', 'wait', 'cancel', 'delete')"}}},
+                {"timeout", {{"type", "integer"}, {"description", "Seconds to wait, default 30 (for 'wait')"}}},
                 {"search", {{"type", "string"}, {"description", "Search in prompt text, case-insensitive (for 'search')"}}},
                 {"status_filter", {{"type", "string"}, {"enum", {"pending", "processing", "completed", "failed", "cancelled"}}, {"description", "Filter by job status (for 'search')"}}},
                 {"type_filter", {{"type", "string"}, {"enum", {"txt2img", "img2img", "txt2vid", "upscale"}}, {"description", "Filter by generation type (for 'search')"}}},
@@ -443,9 +490,18 @@ json McpServer::tool_generate(const json& args) {
 
     json job_args = args;
     job_args.erase("type");
+    bool dedup = !(job_args.contains("dedup") && job_args["dedup"].is_boolean() && !job_args["dedup"].get<bool>());
+    job_args.erase("dedup");
+    if (auto refusal = queue_manager_.check_vram_admission(gen_type, job_args); !refusal.empty()) {
+        return make_tool_result(refusal, true);
+    }
     try {
-        std::string job_id = queue_manager_.add_job(gen_type, job_args);
-        json result = {{"job_id", job_id}, {"status", "pending"}, {"message", message}};
+        // An agent retrying the same fixed-seed call gets the earlier job back
+        auto submitted = queue_manager_.submit_job(gen_type, job_args, "", dedup);
+        json result = {{"job_id", submitted.job_id},
+                       {"status", queue_status_to_string(submitted.status)},
+                       {"message", submitted.deduplicated ? "Identical job already queued or completed" : message}};
+        if (submitted.deduplicated) result["deduplicated"] = true;
         return make_tool_result(result.dump());
     } catch (const std::exception& e) {
         return make_tool_result("Failed to queue job: " + std::string(e.what()), true);
@@ -494,58 +550,31 @@ json McpServer::tool_image(const json& args) {
     if (max_dim < 1) max_dim = 1;
     if (max_dim > mcp_config_.image_max_dim) max_dim = mcp_config_.image_max_dim;
 
-    // Decode → (downscale to max_dim, aspect preserved, never upscale) → JPEG.
-    // This bounds payload size regardless of source resolution, so an 8192px
-    // upscale comes back as a small JPEG instead of a multi-MB base64 blob.
-    // Returns base64 JPEG, or "" with `err` set. Non-decodable outputs (video,
-    // webp — stb can't read those) fail here and are reported as skipped.
-    const int jpeg_quality = mcp_config_.image_jpeg_quality;
-    auto encode_jpeg = [max_dim, jpeg_quality](const std::string& path,
-                                               std::string& err) -> std::string {
-        int w, h, ch;
-        unsigned char* data = stbi_load(path.c_str(), &w, &h, &ch, 3);  // force RGB
-        if (!data) {
-            const char* reason = stbi_failure_reason();
-            err = std::string("decode failed") + (reason ? std::string(": ") + reason : "");
-            return "";
-        }
-        bool resized = false;
-        if (w > max_dim || h > max_dim) {
-            float scale = std::min(static_cast<float>(max_dim) / w,
-                                   static_cast<float>(max_dim) / h);
-            int nw = std::max(1, static_cast<int>(w * scale));
-            int nh = std::max(1, static_cast<int>(h * scale));
-            auto* rz = static_cast<unsigned char*>(malloc(static_cast<size_t>(nw) * nh * 3));
-            if (!rz) { stbi_image_free(data); err = "out of memory"; return ""; }
-            stbir_resize_uint8(data, w, h, 0, rz, nw, nh, 0, 3);
-            stbi_image_free(data);
-            data = rz; w = nw; h = nh; resized = true;
-        }
-        std::vector<unsigned char> jpg;
-        auto cb = [](void* ctx, void* d, int s) {
-            auto* v = static_cast<std::vector<unsigned char>*>(ctx);
-            auto* b = static_cast<unsigned char*>(d);
-            v->insert(v->end(), b, b + s);
-        };
-        int ok = stbi_write_jpg_to_func(cb, &jpg, w, h, 3, data, jpeg_quality);
-        if (resized) free(data); else stbi_image_free(data);
-        if (!ok || jpg.empty()) { err = "JPEG encode failed"; return ""; }
-        return utils::base64_encode(jpg.data(), jpg.size());
-    };
+    // With several outputs, each is decoded, resized and encoded on its own
+    // thread (at most kMaxImages); cached previews come straight back
+    const auto policy = selected.size() > 1 ? std::launch::async : std::launch::deferred;
+    std::vector<std::future<std::pair<std::string, std::string>>> previews;
+    previews.reserve(selected.size());
+    for (const auto& out : selected) {
+        std::string full_path = queue_manager_.output_dir() + "/" + out;
+        previews.push_back(std::async(policy, [this, full_path, max_dim]() {
+            std::string err;
+            std::string b64 = image_preview(full_path, max_dim, err);
+            return std::make_pair(std::move(b64), std::move(err));
+        }));
+    }
 
     json content = json::array();
     std::vector<std::string> skipped;
-    for (const auto& out : selected) {
-        std::string full_path = queue_manager_.output_dir() + "/" + out;
-        std::string err;
-        std::string b64 = encode_jpeg(full_path, err);
+    for (size_t i = 0; i < selected.size(); ++i) {
+        auto [b64, err] = previews[i].get();
         if (b64.empty()) {
-            skipped.push_back(out + " (" + err + ")");
+            skipped.push_back(selected[i] + " (" + err + ")");
             continue;
         }
         content.push_back({
             {"type", "image"},
-            {"data", b64},
+            {"data", std::move(b64)},
             {"mimeType", "image/jpeg"}
         });
     }
@@ -576,6 +605,39 @@ json McpServer::tool_image(const json& args) {
     return {{"content", content}};
 }
 
+std::string McpServer::image_preview(const std::string& path, int max_dim, std::string& err) {
+    const int jpeg_quality = mcp_config_.image_jpeg_quality;
+    std::error_code ec;
+    auto mtime = std::filesystem::last_write_time(path, ec);
+    if (ec) return encode_preview_jpeg(path, max_dim, jpeg_quality, err);     // Reports the failure
+    const std::string key = path + "|" +
+        std::to_string(mtime.time_since_epoch().count()) + "|" +
+        std::to_string(max_dim) + "|" + std::to_string(jpeg_quality);
+    {
+        std::lock_guard<std::mutex> lock(preview_mutex_);
+        auto it = preview_index_.find(key);
+        if (it != preview_index_.end()) {
+            previews_.splice(previews_.begin(), previews_, it->second);
+            return it->second->base64;
+        }
+    }
+
+    std::string b64 = encode_preview_jpeg(path, max_dim, jpeg_quality, err);
+    if (b64.empty() || b64.size() > PREVIEW_CACHE_BYTES / 4) return b64;
+
+    std::lock_guard<std::mutex> lock(preview_mutex_);
+    if (preview_index_.count(key)) return b64;     // A concurrent call got there first
+    previews_.push_front({key, b64});
+    preview_index_[key] = previews_.begin();
+    preview_bytes_ += b64.size();
+    while (preview_bytes_ > PREVIEW_CACHE_BYTES && !previews_.empty()) {
+        preview_bytes_ -= previews_.back().base64.size();
+        preview_index_.erase(previews_.back().key);
+        previews_.pop_back();
+    }
+    return b64;
+}
+
 json McpServer::tool_model(const json& args) {
     if (!args.contains("action") || !args["action"].is_string()) {
         return make_tool_result("Missing required parameter: action (load, unload, list)", true);
@@ -650,7 +712,7 @@ json McpServer::tool_model(const json& args) {
 
 json McpServer::tool_job(const json& args) {
     if (!args.contains("action") || !args["action"].is_string()) {
-        return make_tool_result("Missing required parameter: action (status, cancel, delete, search)", true);
+        return make_tool_result("Missing required parameter: action (status, wait, cancel, delete, search)", true);
     }
 
     std::string action = args["action"].get<std::string>();
@@ -666,6 +728,24 @@ json McpServer::tool_job(const json& args) {
         }
         return make_tool_result(rewrite_job_outputs(job->to_json()).dump());
 
+    } else if (action == "wait") {
+        if (!args.contains("job_id") || !args["job_id"].is_string()) {
+            return make_tool_result("Missing required parameter: job_id", true);
+        }
+        std::string job_id = args["job_id"].get<std::string>();
+        int timeout = 30;
+        if (args.contains("timeout") && args["timeout"].is_number_integer()) {
+            timeout = std::max(0, args["timeout"].get<int>());
+        }
+        bool finished = false;
+        auto job = queue_manager_.wait_job(job_id, std::chrono::seconds(timeout), &finished);
+        if (!job.has_value()) {
+            return make_tool_result("Job not found: " + job_id, true);
+        }
+        json result = rewrite_job_outputs(job->to_json());
+        result["finished"] = finished;
+        return make_tool_result(result.dump());
+
     } else if (action == "cancel") {
         if (!args.contains("job_id") || !args["job_id"].is_string()) {
             return make_tool_result("Missing required parameter: job_id", true);
@@ -753,7 +833,7 @@ json McpServer::tool_job(const json& args) {
         return make_tool_result(response.dump());
     }
 
-    return make_tool_result("Unknown job action: " + action + ". Use: status, cancel, delete, search", true);
+    return make_tool_result("Unknown job action: " + action + ". Use: status, wait, cancel, delete, search", true);
 }
 
 // ─── Resource Definitions ────────────────────────────────────────────────────
@@ -1,10 +1,12 @@
 #include "memory_utils.hpp"
 
+#include <filesystem>
 #include <fstream>
 #include <sstream>
 #include <string>
 #include <cstring>
 #include <iomanip>
+#include <algorithm>
 
 #ifdef __linux__
 #include <unistd.h>
@@ -43,6 +45,24 @@ nlohmann::json MemoryInfo::to_json() const {
         {"virtual_mb", process_virtual / (1024 * 1024)}
     };
 
+    // Per NUMA node
+    if (!numa_nodes.empty()) {
+        j["numa"] = nlohmann::json::array();
+        for (const auto& n : numa_nodes) {
+            const uint64_t used = n.total > n.free ? n.total - n.free : 0;
+            j["numa"].push_back({
+                {"node", n.node},
+                {"total_bytes", n.total},
+                {"used_bytes", used},
+                {"free_bytes", n.free},
+                {"file_bytes", n.file_pages},
+                {"total_mb", n.total / (1024 * 1024)},
+                {"used_mb", used / (1024 * 1024)},
+                {"free_mb", n.free / (1024 * 1024)}
+            });
+        }
+    }
+
     // GPU memory (if available)
     j["gpu"] = {
         {"available", gpu_available},
@@ -111,6 +131,32 @@ static void read_proc_self_status(MemoryInfo& info) {
         }
     }
 }
+
+static void read_numa_meminfo(MemoryInfo& info) {
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator("/sys/devices/system/node", ec)) {
+        const std::string name = entry.path().filename().string();
+        if (name.compare(0, 4, "node") != 0 || name.size() == 4) continue;
+        std::ifstream meminfo(entry.path() / "meminfo");
+        if (!meminfo.is_open()) continue;
+
+        // "Node 0 MemTotal:       65799628 kB"
+        NumaNodeMemory node;
+        std::string line;
+        while (std::getline(meminfo, line)) {
+            std::istringstream iss(line);
+            std::string word, key;
+            uint64_t value = 0;
+            if (!(iss >> word >> node.node >> key >> value)) continue;
+            if (key == "MemTotal:") node.total = value * 1024;
+            else if (key == "MemFree:") node.free = value * 1024;
+            else if (key == "FilePages:") node.file_pages = value * 1024;
+        }
+        info.numa_nodes.push_back(node);
+    }
+    std::sort(info.numa_nodes.begin(), info.numa_nodes.end(),
+              [](const NumaNodeMemory& a, const NumaNodeMemory& b) { return a.node < b.node; });
+}
 #endif
 
 #ifdef SDCPP_USE_CUDA
@@ -206,6 +252,7 @@ MemoryInfo get_memory_info() {
 #ifdef __linux__
     read_proc_meminfo(info);
     read_proc_self_status(info);
+    read_numa_meminfo(info);
 #endif
 
 #ifdef SDCPP_USE_CUDA
@@ -0,0 +1,173 @@
+#include "metrics.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <mutex>
+
+namespace sdcpp {
+namespace metrics {
+
+namespace {
+
+// Jobs run from under a second (small upscales) to tens of minutes (video)
+const std::vector<double> JOB_BUCKETS = {0.5, 1, 2, 5, 10, 20, 30, 60, 120, 300, 600, 1800};
+const std::vector<double> LOAD_BUCKETS = {1, 2, 5, 10, 20, 30, 60, 120, 300, 600};
+const std::vector<double> HTTP_BUCKETS = {0.001, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10, 30};
+
+std::string format_value(double v) {
+    if (std::isinf(v)) return v > 0 ? "+Inf" : "-Inf";
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%.15g", v);
+    return buf;
+}
+
+std::string join_labels(const std::vector<std::string>& names, const std::vector<std::string>& values) {
+    std::string out;
+    for (size_t i = 0; i < names.size() && i < values.size(); ++i) {
+        if (!out.empty()) out += ',';
+        out += label(names[i], values[i]);
+    }
+    return out;
+}
+
+} // namespace
+
+Histogram::Histogram(const std::vector<double>& bounds)
+    : bounds_(bounds), buckets_(std::make_unique<std::atomic<uint64_t>[]>(bounds.size() + 1)) {
+    for (size_t i = 0; i <= bounds_.size(); ++i) buckets_[i].store(0, std::memory_order_relaxed);
+}
+
+void Histogram::observe(double value) {
+    size_t i = 0;
+    while (i < bounds_.size() && value > bounds_[i]) ++i;
+    buckets_[i].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    if (value > 0) {
+        sum_micros_.fetch_add(static_cast<uint64_t>(value * 1e6 + 0.5), std::memory_order_relaxed);
+    }
+}
+
+void Histogram::render(std::string& out, const std::string& name, const std::string& labels) const {
+    const std::string sep = labels.empty() ? "" : ",";
+    uint64_t cumulative = 0;
+    for (size_t i = 0; i <= bounds_.size(); ++i) {
+        cumulative += buckets_[i].load(std::memory_order_relaxed);
+        const std::string le = i < bounds_.size() ? format_value(bounds_[i]) : "+Inf";
+        write_sample(out, name + "_bucket", labels + sep + "le=\"" + le + "\"", static_cast<double>(cumulative));
+    }
+    write_sample(out, name + "_sum", labels, sum_micros_.load(std::memory_order_relaxed) / 1e6);
+    write_sample(out, name + "_count", labels, static_cast<double>(count_.load(std::memory_order_relaxed)));
+}
+
+HistogramFamily::HistogramFamily(std::string name, std::string help, std::vector<double> bounds,
+                                 std::vector<std::string> label_names)
+    : name_(std::move(name)), help_(std::move(help)), bounds_(std::move(bounds)),
+      label_names_(std::move(label_names)) {
+}
+
+Histogram& HistogramFamily::with(const std::vector<std::string>& label_values) {
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        auto it = series_.find(label_values);
+        if (it != series_.end()) return *it->second;
+    }
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    auto& slot = series_[label_values];
+    if (!slot) slot = std::make_unique<Histogram>(bounds_);
+    return *slot;
+}
+
+void HistogramFamily::render(std::string& out) const {
+    write_header(out, name_, help_, "histogram");
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    for (const auto& [values, h] : series_) {
+        h->render(out, name_, join_labels(label_names_, values));
+    }
+}
+
+CounterFamily::CounterFamily(std::string name, std::string help, std::vector<std::string> label_names)
+    : name_(std::move(name)), help_(std::move(help)), label_names_(std::move(label_names)) {
+}
+
+std::atomic<uint64_t>& CounterFamily::with(const std::vector<std::string>& label_values) {
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        auto it = series_.find(label_values);
+        if (it != series_.end()) return *it->second;
+    }
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    auto& slot = series_[label_values];
+    if (!slot) slot = std::make_unique<std::atomic<uint64_t>>(0);
+    return *slot;
+}
+
+void CounterFamily::render(std::string& out) const {
+    write_header(out, name_, help_, "counter");
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    for (const auto& [values, c] : series_) {
+        write_sample(out, name_, join_labels(label_names_, values),
+                     static_cast<double>(c->load(std::memory_order_relaxed)));
+    }
+}
+
+Registry::Registry()
+    : job_duration("sdcpp_job_duration_seconds", "Job run time, from pickup to final status",
+                   JOB_BUCKETS, {"type", "model"}),
+      job_queue_wait("sdcpp_job_queue_wait_seconds", "Time jobs waited in the queue before a worker took them",
+                     JOB_BUCKETS, {"type"}),
+      jobs_finished("sdcpp_jobs_finished_total", "Jobs that reached a final status", {"type", "status"}),
+      model_load("sdcpp_model_load_seconds", "Model load time", LOAD_BUCKETS, {"result"}),
+      http_request_duration("sdcpp_http_request_duration_seconds", "API handler time by registered route",
+                            HTTP_BUCKETS, {"method", "route"}),
+      http_responses("sdcpp_http_responses_total", "API responses by registered route and status code",
+                     {"method", "route", "code"}) {
+}
+
+std::string Registry::render() const {
+    std::string out;
+    out.reserve(16 * 1024);
+    job_duration.render(out);
+    job_queue_wait.render(out);
+    jobs_finished.render(out);
+    model_load.render(out);
+    http_request_duration.render(out);
+    http_responses.render(out);
+    return out;
+}
+
+Registry& registry() {
+    static Registry instance;
+    return instance;
+}
+
+void write_header(std::string& out, const std::string& name, const std::string& help, const char* type) {
+    out += "# HELP " + name + " " + help + "\n";
+    out += "# TYPE " + name + " " + type + "\n";
+}
+
+void write_sample(std::string& out, const std::string& name, const std::string& labels, double value) {
+    out += name;
+    if (!labels.empty()) {
+        out += '{';
+        out += labels;
+        out += '}';
+    }
+    out += ' ';
+    out += format_value(value);
+    out += '\n';
+}
+
+std::string label(const std::string& key, const std::string& value) {
+    std::string out = key + "=\"";
+    for (char c : value) {
+        if (c == '\\') out += "\\\\";
+        else if (c == '"') out += "\\\"";
+        else if (c == '\n') out += "\\n";
+        else out += c;
+    }
+    out += '"';
+    return out;
+}
+
+} // namespace metrics
+} // namespace sdcpp
@@ -0,0 +1,280 @@
+/**
+ * sdcpp-microbench - CPU-side hot paths
+ *
+ * Google Benchmark cases for the work the server does around each job and
+ * request, at production sizes: preview/init-image resizes and encodes,
+ * output saves, base64 of uploaded images, model hashing, queue listing
+ * filters and persistence over a 50k-job history, and prompt templates.
+ * Run with --benchmark_format=json --benchmark_out=<file> to keep a result
+ * set to compare against (e.g. with Google Benchmark's compare.py).
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <string>
+#include <vector>
+#include <random>
+#include <fstream>
+#include <filesystem>
+#include <unistd.h>
+
+#include <nlohmann/json.hpp>
+
+#include "image_resize.hpp"
+#include "image_encoder.hpp"
+#include "sd_wrapper.hpp"
+#include "utils.hpp"
+#include "queue_manager.hpp"
+#include "queue_journal.hpp"
+#include "prompt_template.hpp"
+
+namespace fs = std::filesystem;
+using namespace sdcpp;
+
+namespace {
+
+// Smooth gradients plus noise: compresses like a generated image rather than
+// like flat color or pure noise
+std::vector<uint8_t> make_image(int width, int height, int channels) {
+    std::vector<uint8_t> pixels(static_cast<size_t>(width) * height * channels);
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> noise(-8, 8);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            uint8_t* p = &pixels[(static_cast<size_t>(y) * width + x) * channels];
+            for (int c = 0; c < channels; ++c) {
+                int v = (c == 3) ? 255 : ((x * (c + 1) + y * (3 - c)) * 255) / (width + height) + noise(rng);
+                p[c] = static_cast<uint8_t>(std::clamp(v, 0, 255));
+            }
+        }
+    }
+    return pixels;
+}
+
+fs::path scratch_dir() {
+    static const fs::path dir = [] {
+        fs::path d = fs::temp_directory_path() / ("sdcpp-microbench-" + std::to_string(getpid()));
+        fs::create_directories(d);
+        return d;
+    }();
+    return dir;
+}
+
+const char* const PROMPT_WORDS[] = {
+    "cat", "portrait", "landscape", "cyberpunk", "city", "forest", "oil painting", "watercolor",
+    "highly detailed", "cinematic lighting", "8k", "bokeh", "sunset", "neon", "castle", "dragon"
+};
+
+// A history of `n` finished txt2img jobs with varied prompts and models
+std::vector<QueueItem> make_history(size_t n) {
+    std::vector<QueueItem> items;
+    items.reserve(n);
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<size_t> word(0, std::size(PROMPT_WORDS) - 1);
+    auto now = std::chrono::system_clock::now();
+    for (size_t i = 0; i < n; ++i) {
+        QueueItem item;
+        item.job_id = utils::generate_uuid();
+        item.type = GenerationType::Text2Image;
+        item.status = (i % 10 == 0) ? QueueStatus::Failed : QueueStatus::Completed;
+        std::string prompt;
+        for (int w = 0; w < 12; ++w) prompt += std::string(PROMPT_WORDS[word(rng)]) + ", ";
+        item.params = {
+            {"prompt", prompt}, {"negative_prompt", "blurry, lowres"},
+            {"width", 1024}, {"height", 1024}, {"steps", 20}, {"seed", static_cast<int64_t>(i)}
+        };
+        item.model_settings = std::make_shared<const nlohmann::json>(nlohmann::json{
+            {"model_name", (i % 3 == 0) ? "sdxl_base.safetensors" : "flux1-dev-Q8_0.gguf"},
+            {"model_architecture", (i % 3 == 0) ? "SDXL" : "Flux"}
+        });
+        item.created_at = now - std::chrono::seconds(static_cast<int64_t>(n - i) * 30);
+        item.started_at = item.created_at + std::chrono::seconds(1);
+        item.completed_at = item.started_at + std::chrono::seconds(20);
+        item.outputs = {"2026-10-14/" + item.job_id + "/output_0.png"};
+        items.push_back(std::move(item));
+    }
+    return items;
+}
+
+const std::vector<QueueItem>& history_50k() {
+    static const std::vector<QueueItem> items = make_history(50000);
+    return items;
+}
+
+} // namespace
+
+// Preview downscale (2048² RGBA -> 512²) and init-image upscale (1024² RGB -> 2048²)
+static void BM_ResizeBilinear(benchmark::State& state) {
+    const int src = static_cast<int>(state.range(0));
+    const int dst = static_cast<int>(state.range(1));
+    const int channels = static_cast<int>(state.range(2));
+    auto image = make_image(src, src, channels);
+    for (auto _ : state) {
+        auto out = resize_image(image.data(), src, src, channels, dst, dst, ResizeFilter::Bilinear);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * image.size());
+}
+BENCHMARK(BM_ResizeBilinear)->Args({2048, 512, 4})->Args({2048, 512, 3})->Args({1024, 2048, 3})
+    ->Unit(benchmark::kMillisecond);
+
+// Preview frames (512², q75) and full outputs (1024² / 2048², q90)
+static void BM_EncodeJpegMemory(benchmark::State& state) {
+    const int size = static_cast<int>(state.range(0));
+    auto image = make_image(size, size, 3);
+    EncodeOptions options;
+    options.format = ImageFormat::Jpeg;
+    options.quality = static_cast<int>(state.range(1));
+    for (auto _ : state) {
+        auto out = encode_image(image.data(), size, size, 3, options);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * image.size());
+}
+BENCHMARK(BM_EncodeJpegMemory)->Args({512, 75})->Args({1024, 90})->Args({2048, 90})
+    ->Unit(benchmark::kMillisecond);
+
+// SDWrapper::save_image: PNG encode + write, the default output path
+static void BM_SaveImage(benchmark::State& state) {
+    const int size = static_cast<int>(state.range(0));
+    const int channels = static_cast<int>(state.range(1));
+    auto image = make_image(size, size, channels);
+    const std::string path = (scratch_dir() / "save_image.png").string();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(SDWrapper::save_image(path, image.data(), size, size, channels));
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * image.size());
+}
+BENCHMARK(BM_SaveImage)->Args({1024, 3})->Args({2048, 4})->Unit(benchmark::kMillisecond);
+
+// Uploaded init images arrive as base64 of an encoded file (~1 MB JPEG, ~8 MB PNG)
+static void BM_Base64Encode(benchmark::State& state) {
+    std::vector<uint8_t> data = make_image(static_cast<int>(state.range(0)), 1024, 1);
+    for (auto _ : state) {
+        auto out = utils::base64_encode(data);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * data.size());
+}
+BENCHMARK(BM_Base64Encode)->Arg(1024)->Arg(8 * 1024)->Unit(benchmark::kMillisecond);
+
+static void BM_Base64Decode(benchmark::State& state) {
+    const std::string encoded = utils::base64_encode(make_image(static_cast<int>(state.range(0)), 1024, 1));
+    for (auto _ : state) {
+        auto out = utils::base64_decode(encoded);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * encoded.size());
+}
+BENCHMARK(BM_Base64Decode)->Arg(1024)->Arg(8 * 1024)->Unit(benchmark::kMillisecond);
+
+// Model file hashing (page-cache warm after the first iteration)
+static void BM_ComputeSha256(benchmark::State& state) {
+    const size_t bytes = static_cast<size_t>(state.range(0)) << 20;
+    const std::string path = (scratch_dir() / "sha256.bin").string();
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        std::vector<char> chunk(1 << 20);
+        std::mt19937 rng(1);
+        for (auto& c : chunk) c = static_cast<char>(rng());
+        for (size_t written = 0; written < bytes; written += chunk.size()) out.write(chunk.data(), chunk.size());
+    }
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(utils::compute_sha256(path));
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * bytes);
+    fs::remove(path);
+}
+BENCHMARK(BM_ComputeSha256)->Arg(256)->Unit(benchmark::kMillisecond);
+
+// /queue filters walked over a 50k-job history
+static void BM_QueueFilterMatches(benchmark::State& state) {
+    const auto& items = history_50k();
+    QueueFilter filter;
+    switch (state.range(0)) {
+        case 0: filter.status = QueueStatus::Failed; break;
+        case 1: filter.search = "cyberpunk city"; break;
+        case 2: filter.model = "flux"; filter.search = "dragon"; break;
+    }
+    for (auto _ : state) {
+        size_t hits = 0;
+        for (const auto& item : items) hits += filter.matches(item) ? 1 : 0;
+        benchmark::DoNotOptimize(hits);
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * items.size());
+}
+BENCHMARK(BM_QueueFilterMatches)->ArgName("filter")->DenseRange(0, 2)->Unit(benchmark::kMillisecond);
+
+// Serializing every job, as a full snapshot rewrite does
+static void BM_QueueItemToJson(benchmark::State& state) {
+    const auto& items = history_50k();
+    for (auto _ : state) {
+        nlohmann::json all = nlohmann::json::array();
+        for (const auto& item : items) all.push_back(item.to_json());
+        benchmark::DoNotOptimize(all.dump().size());
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * items.size());
+}
+BENCHMARK(BM_QueueItemToJson)->Unit(benchmark::kMillisecond);
+
+// One job update persisted to disk (what the queue pays per status change)
+static void BM_JournalPut(benchmark::State& state) {
+    const auto& items = history_50k();
+    const std::string path = (scratch_dir() / "journal_put.json").string();
+    QueueJournal journal(path, 1u << 30);   // never compact inside the timed loop
+    journal.load();
+    journal.start();
+    size_t i = 0;
+    for (auto _ : state) {
+        const auto& item = items[i++ % items.size()];
+        journal.put(item.job_id, item.to_json());
+        journal.flush();
+    }
+    journal.stop();
+    fs::remove(path);
+    fs::remove(path + ".journal");
+}
+BENCHMARK(BM_JournalPut)->Unit(benchmark::kMicrosecond);
+
+// Startup load + compaction of a 50k-job state file
+static void BM_JournalCompact(benchmark::State& state) {
+    const auto& items = history_50k();
+    const std::string path = (scratch_dir() / "journal_compact.json").string();
+    {
+        QueueJournal seed(path, 1u << 30);
+        seed.load();
+        seed.start();
+        for (const auto& item : items) seed.put(item.job_id, item.to_json());
+        seed.stop();
+    }
+    for (auto _ : state) {
+        QueueJournal journal(path);
+        benchmark::DoNotOptimize(journal.load().size());
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * items.size());
+    fs::remove(path);
+    fs::remove(path + ".journal");
+}
+BENCHMARK(BM_JournalCompact)->Unit(benchmark::kMillisecond);
+
+// Prompt sweeps: 4 x 4 x 4 x 4 x 4 = 1024 variations
+static void BM_ExpandPromptTemplate(benchmark::State& state) {
+    const std::string templated =
+        "a {cat|dog|fox|owl} in a {forest|city|desert|castle}, {oil painting|watercolor|photo|sketch}, "
+        "{sunset|night|dawn|noon} lighting, {highly detailed|minimal|surreal|cinematic}";
+    for (auto _ : state) {
+        auto prompts = expand_prompt_template(templated);
+        benchmark::DoNotOptimize(prompts.data());
+    }
+}
+BENCHMARK(BM_ExpandPromptTemplate)->Unit(benchmark::kMicrosecond);
+
+int main(int argc, char** argv) {
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    std::error_code ec;
+    fs::remove_all(scratch_dir(), ec);
+    return 0;
+}
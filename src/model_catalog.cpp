@@ -0,0 +1,405 @@
+#include "model_catalog.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <sys/stat.h>
+
+namespace fs = std::filesystem;
+
+namespace sdcpp {
+
+namespace {
+
+int64_t steady_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool has_extension(const std::string& name, const std::vector<std::string>& extensions) {
+    size_t dot = name.rfind('.');
+    if (dot == std::string::npos) return false;
+    std::string ext = name.substr(dot);
+    std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+    return std::find(extensions.begin(), extensions.end(), ext) != extensions.end();
+}
+
+// Minimum interval between catalog rewrites triggered by hash updates
+constexpr int64_t kSaveIntervalMs = 2000;
+
+} // anonymous namespace
+
+ModelCatalog::ModelCatalog(std::string catalog_file, const std::string& legacy_hash_file)
+    : catalog_file_(std::move(catalog_file)) {
+    load(legacy_hash_file);
+}
+
+ModelCatalog::~ModelCatalog() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (dirty_) save_locked();
+}
+
+bool ModelCatalog::stat_path(const std::string& path, bool want_dir, uint64_t& size, int64_t& mtime_ns) {
+    struct stat st{};
+    if (::stat(path.c_str(), &st) != 0) return false;
+    if (want_dir ? !S_ISDIR(st.st_mode) : !S_ISREG(st.st_mode)) return false;
+    size = static_cast<uint64_t>(st.st_size);
+    mtime_ns = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+    return true;
+}
+
+void ModelCatalog::load(const std::string& legacy_hash_file) {
+    // Entries are not re-validated here: the first scan prunes what is gone
+    // and re-stats files in changed directories, without an O(files) stat
+    // storm at startup
+    std::string source = catalog_file_;
+    if (!fs::exists(source) && !legacy_hash_file.empty() && fs::exists(legacy_hash_file)) {
+        source = legacy_hash_file;
+    }
+
+    std::ifstream file(source);
+    if (!file) return;
+
+    try {
+        auto j = nlohmann::json::parse(file);
+        const auto files = j.value("files", nlohmann::json::object());
+        const auto dirs = j.value("dirs", nlohmann::json::object());
+        for (const auto& [path, e] : files.items()) {
+            FileEntry entry;
+            entry.size = e.value("size", uint64_t{0});
+            entry.mtime_ns = e.value("mtime_ns", int64_t{0});
+            entry.sha256 = e.value("sha256", "");
+            entry.zip_archive = e.value("zip", -1);
+            files_[path] = std::move(entry);
+        }
+        for (const auto& [path, d] : dirs.items()) {
+            DirEntry entry;
+            entry.mtime_ns = d.value("mtime_ns", int64_t{0});
+            entry.files = d.value("files", std::vector<std::string>{});
+            entry.subdirs = d.value("subdirs", std::vector<std::string>{});
+            dirs_[path] = std::move(entry);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "[ModelCatalog] Ignoring unreadable " << source << ": " << e.what() << std::endl;
+        files_.clear();
+        dirs_.clear();
+        return;
+    }
+
+    dirty_ = source != catalog_file_;
+    std::cout << "[ModelCatalog] Loaded " << files_.size() << " files, " << dirs_.size()
+              << " directories from " << source << std::endl;
+}
+
+void ModelCatalog::save_locked() {
+    nlohmann::json files = nlohmann::json::object();
+    for (const auto& [path, e] : files_) {
+        nlohmann::json entry = {{"size", e.size}, {"mtime_ns", e.mtime_ns}};
+        if (!e.sha256.empty()) entry["sha256"] = e.sha256;
+        if (e.zip_archive >= 0) entry["zip"] = e.zip_archive;
+        files[path] = std::move(entry);
+    }
+    nlohmann::json dirs = nlohmann::json::object();
+    for (const auto& [path, d] : dirs_) {
+        dirs[path] = {{"mtime_ns", d.mtime_ns}, {"files", d.files}, {"subdirs", d.subdirs}};
+    }
+    nlohmann::json j = {{"version", 1}, {"files", files}, {"dirs", dirs}};
+
+    dirty_ = false;
+    last_save_ms_ = steady_ms();
+
+    const std::string tmp_path = catalog_file_ + ".tmp";
+    {
+        std::ofstream file(tmp_path, std::ios::trunc);
+        if (!file || !(file << j.dump())) {
+            std::cerr << "[ModelCatalog] Failed to write " << tmp_path << std::endl;
+            return;
+        }
+    }
+    std::error_code ec;
+    fs::rename(tmp_path, catalog_file_, ec);
+    if (ec) {
+        std::cerr << "[ModelCatalog] Failed to replace " << catalog_file_ << ": " << ec.message() << std::endl;
+    }
+}
+
+// ── Directory scanning ──────────────────────────────────────────────────────
+
+void ModelCatalog::begin_scan() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    scanning_ = true;
+    seen_files_.clear();
+    seen_dirs_.clear();
+    dirs_reused_ = 0;
+    dirs_read_ = 0;
+    files_statted_ = 0;
+    scan_started_ms_ = steady_ms();
+}
+
+void ModelCatalog::end_scan() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!scanning_) return;
+    scanning_ = false;
+
+    size_t pruned = 0;
+    for (auto it = files_.begin(); it != files_.end();) {
+        if (seen_files_.count(it->first)) { ++it; continue; }
+        it = files_.erase(it);
+        pruned++;
+    }
+    for (auto it = dirs_.begin(); it != dirs_.end();) {
+        if (seen_dirs_.count(it->first)) { ++it; continue; }
+        it = dirs_.erase(it);
+        pruned++;
+    }
+    seen_files_.clear();
+    seen_dirs_.clear();
+    if (pruned > 0) dirty_ = true;
+
+    last_scan_ms_ = steady_ms() - scan_started_ms_;
+    std::cout << "[ModelCatalog] Scan: " << dirs_read_ << " directories read, " << dirs_reused_
+              << " unchanged, " << files_statted_ << " files statted, " << last_scan_ms_ << " ms" << std::endl;
+
+    if (dirty_) save_locked();
+}
+
+std::vector<ModelCatalog::ScannedFile> ModelCatalog::scan(
+    const std::string& root, const std::vector<std::string>& extensions, bool full
+) {
+    std::vector<ScannedFile> out;
+    std::lock_guard<std::mutex> lock(mutex_);
+    walk_locked(fs::path(root).lexically_normal().string(), "", extensions, full, out);
+    return out;
+}
+
+void ModelCatalog::walk_locked(const std::string& dir, const std::string& rel_prefix,
+                               const std::vector<std::string>& extensions, bool full,
+                               std::vector<ScannedFile>& out) {
+    uint64_t unused = 0;
+    int64_t dir_mtime = 0;
+    if (!stat_path(dir, true, unused, dir_mtime)) return;
+    if (scanning_) seen_dirs_.insert(dir);
+
+    // An unchanged directory mtime means no entry was added, removed or
+    // renamed: reuse the stored listing instead of reading the directory
+    auto it = dirs_.find(dir);
+    const bool reuse = !full && it != dirs_.end() && it->second.mtime_ns == dir_mtime;
+    if (reuse) {
+        dirs_reused_++;
+    } else {
+        DirEntry fresh;
+        fresh.mtime_ns = dir_mtime;
+        std::error_code ec;
+        for (fs::directory_iterator di(dir, ec), end; !ec && di != end; di.increment(ec)) {
+            std::error_code type_ec;
+            std::string name = di->path().filename().string();
+            // Like recursive_directory_iterator: don't descend into directory symlinks
+            if (di->is_directory(type_ec) && !di->is_symlink(type_ec)) {
+                fresh.subdirs.push_back(std::move(name));
+            } else if (di->is_regular_file(type_ec)) {
+                fresh.files.push_back(std::move(name));
+            }
+        }
+        std::sort(fresh.files.begin(), fresh.files.end());
+        std::sort(fresh.subdirs.begin(), fresh.subdirs.end());
+        it = dirs_.insert_or_assign(dir, std::move(fresh)).first;
+        dirs_read_++;
+        dirty_ = true;
+    }
+
+    // Element references survive rehashing when the recursion inserts
+    const DirEntry& listing = it->second;
+
+    for (const auto& name : listing.files) {
+        if (!has_extension(name, extensions)) continue;
+        std::string full_path = (fs::path(dir) / name).string();
+        if (scanning_) seen_files_.insert(full_path);
+
+        auto fit = files_.find(full_path);
+        if (!reuse || fit == files_.end()) {
+            uint64_t size = 0;
+            int64_t mtime_ns = 0;
+            files_statted_++;
+            if (!stat_path(full_path, false, size, mtime_ns)) continue;
+            if (fit == files_.end() || fit->second.size != size || fit->second.mtime_ns != mtime_ns) {
+                // New or changed file: whatever we knew about it is stale
+                FileEntry entry;
+                entry.size = size;
+                entry.mtime_ns = mtime_ns;
+                fit = files_.insert_or_assign(full_path, std::move(entry)).first;
+                dirty_ = true;
+            }
+        }
+
+        ScannedFile file;
+        file.rel_path = rel_prefix + name;
+        file.full_path = std::move(full_path);
+        file.size = fit->second.size;
+        file.sha256 = fit->second.sha256;
+        out.push_back(std::move(file));
+    }
+
+    for (const auto& sub : listing.subdirs) {
+        walk_locked((fs::path(dir) / sub).string(), rel_prefix + sub + "/", extensions, full, out);
+    }
+}
+
+bool ModelCatalog::is_zip_archive(const std::string& full_path) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = files_.find(full_path);
+    if (it != files_.end() && it->second.zip_archive >= 0) {
+        return it->second.zip_archive == 1;
+    }
+    bool zip = utils::is_zip_archive(full_path);
+    if (it != files_.end()) {
+        it->second.zip_archive = zip ? 1 : 0;
+        dirty_ = true;
+    }
+    return zip;
+}
+
+// ── Hashes ──────────────────────────────────────────────────────────────────
+
+std::optional<std::string> ModelCatalog::lookup(const std::string& path) const {
+    uint64_t size = 0;
+    int64_t mtime_ns = 0;
+    if (!stat_path(path, false, size, mtime_ns)) return std::nullopt;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = files_.find(path);
+    if (it == files_.end() || it->second.sha256.empty() ||
+        it->second.size != size || it->second.mtime_ns != mtime_ns) {
+        return std::nullopt;
+    }
+    return it->second.sha256;
+}
+
+void ModelCatalog::store(const std::string& path, const std::string& sha256) {
+    FileEntry entry;
+    if (!stat_path(path, false, entry.size, entry.mtime_ns)) return;
+    entry.sha256 = sha256;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = files_.find(path);
+    if (it != files_.end() && it->second.size == entry.size && it->second.mtime_ns == entry.mtime_ns) {
+        entry.zip_archive = it->second.zip_archive;
+    }
+    files_[path] = std::move(entry);
+    dirty_ = true;
+    // A batch of hashes is flushed by get_or_compute_many; single updates
+    // are rate-limited so a big catalog isn't rewritten per file
+    if (steady_ms() - last_save_ms_ >= kSaveIntervalMs) {
+        save_locked();
+    }
+}
+
+std::string ModelCatalog::get_or_compute(const std::string& path, const utils::HashProgressCallback& progress) {
+    if (auto cached = lookup(path)) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        hits_++;
+        return *cached;
+    }
+
+    uint64_t size = 0;
+    int64_t mtime_ns = 0;
+    stat_path(path, false, size, mtime_ns);
+
+    std::string hash = utils::compute_sha256(path, progress);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        misses_++;
+        bytes_hashed_ += size;
+    }
+    store(path, hash);
+    return hash;
+}
+
+std::map<std::string, std::string> ModelCatalog::get_or_compute_many(
+    const std::vector<std::string>& paths, int threads,
+    const std::function<void(size_t done, size_t total)>& progress
+) {
+    std::map<std::string, std::string> results;
+    if (paths.empty()) return results;
+
+    std::mutex results_mutex;
+    std::condition_variable finished_cv;
+    std::atomic<size_t> next{0};
+    size_t finished = 0;
+
+    // Disk-bound: a few readers saturate NVMe, more just thrash a spinning disk
+    const size_t worker_count = std::min<size_t>(paths.size(), static_cast<size_t>(std::max(1, threads)));
+
+    auto worker = [&] {
+        for (size_t i = next++; i < paths.size(); i = next++) {
+            std::optional<std::string> hash;
+            try {
+                hash = get_or_compute(paths[i]);
+            } catch (const std::exception& e) {
+                std::cerr << "[ModelCatalog] Failed to hash " << paths[i] << ": " << e.what() << std::endl;
+            }
+            {
+                std::lock_guard<std::mutex> lock(results_mutex);
+                if (hash) results[paths[i]] = std::move(*hash);
+                finished++;
+            }
+            finished_cv.notify_one();
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (size_t t = 0; t < worker_count; ++t) {
+        pool.emplace_back(worker);
+    }
+
+    // Progress is reported from the calling thread (the queue worker's
+    // progress hook is thread-local)
+    {
+        std::unique_lock<std::mutex> lock(results_mutex);
+        size_t reported = 0;
+        while (finished < paths.size()) {
+            finished_cv.wait(lock, [&] { return finished != reported; });
+            reported = finished;
+            if (progress) {
+                lock.unlock();
+                progress(reported, paths.size());
+                lock.lock();
+            }
+        }
+    }
+    for (auto& t : pool) t.join();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (dirty_) save_locked();
+    }
+    return results;
+}
+
+nlohmann::json ModelCatalog::stats_json() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t hashed = 0;
+    for (const auto& [path, e] : files_) {
+        if (!e.sha256.empty()) hashed++;
+    }
+    return {
+        {"files", files_.size()},
+        {"directories", dirs_.size()},
+        {"hashes", hashed},
+        {"last_scan", {
+            {"directories_read", dirs_read_},
+            {"directories_unchanged", dirs_reused_},
+            {"files_statted", files_statted_},
+            {"duration_ms", last_scan_ms_}
+        }},
+        {"hash_hits", hits_},
+        {"hash_misses", misses_},
+        {"bytes_hashed", bytes_hashed_}
+    };
+}
+
+} // namespace sdcpp
@@ -2,7 +2,13 @@
 #include "websocket_server.hpp"
 #include "utils.hpp"
 #include "memory_utils.hpp"
+#include "tiled_upscaler.hpp"
 #include "sd_error_capture.hpp"
+#include "job_timings.hpp"
+#include "metrics.hpp"
+#include "job_trace.hpp"
+#include "rpc_probe.hpp"
+#include "sd_wrapper.hpp"
 
 #include <iostream>
 #include <sstream>
@@ -12,6 +18,10 @@
 #include <cctype>
 #include <cmath>
 #include <unordered_set>
+#include <chrono>
+#include <ctime>
+#include <thread>
+#include <utility>
 
 #include "stable-diffusion.h"
 
@@ -33,6 +43,68 @@ static void model_loading_progress_callback(int step, int total_steps, float /*t
 
 namespace sdcpp {
 
+namespace {
+
+// rpc_split = "auto" leaves this much of every device free for compute buffers
+constexpr uint64_t RPC_SPLIT_HEADROOM = 1536ull * 1024 * 1024;
+
+// ggml's name for the local GPU in a max_vram budget ("" = none known)
+const char* local_gpu_device() {
+#if defined(SDCPP_USE_CUDA)
+    return "CUDA0";
+#elif defined(SDCPP_USE_VULKAN)
+    return "Vulkan0";
+#else
+    return "";
+#endif
+}
+
+// offload_tune's calibration generation
+constexpr const char* OFFLOAD_TUNE_PROMPT = "a photo of a cat sitting on a chair";
+
+// Overlay one offload_tune candidate (or cached choice) on load params
+ModelLoadParams with_offload_options(ModelLoadParams params, const nlohmann::json& options) {
+    params.max_vram = options.value("max_vram", params.max_vram);
+#if defined(SDCPP_EXPERIMENTAL_OFFLOAD) && !defined(SDCPP_UNIFIED_STREAMING)
+    params.offload_mode = options.value("offload_mode", params.offload_mode);
+    params.streaming_prefetch_layers = options.value("streaming_prefetch_layers", params.streaming_prefetch_layers);
+    // Same mode-aware default as ModelLoadParams::from_json
+    if (params.offload_mode == "layer_streaming") params.offload_cond_stage = false;
+#else
+    params.stream_layers = options.value("stream_layers", params.stream_layers);
+#endif
+    return params;
+}
+
+// Whether the quant cache may convert a model file: pickled checkpoints,
+// and safetensors whose tensors are all F32 / F16 / BF16. GGUF and FP8 or
+// NVFP4 safetensors are already quantized.
+bool float_weights(const ModelInfo& info) {
+    if (info.file_extension == "ckpt" || info.file_extension == "pt" || info.file_extension == "pth") return true;
+    if (info.file_extension != "safetensors") return false;
+    std::ifstream f(info.full_path, std::ios::binary);
+    uint64_t header_len = 0;
+    if (!f.read(reinterpret_cast<char*>(&header_len), sizeof(header_len)) ||
+        header_len == 0 || header_len > 100ull * 1024 * 1024) {
+        return false;
+    }
+    std::string header(static_cast<size_t>(header_len), '\0');
+    if (!f.read(header.data(), static_cast<std::streamsize>(header_len))) return false;
+    try {
+        const auto j = nlohmann::json::parse(header);
+        for (const auto& [name, tensor] : j.items()) {
+            if (name == "__metadata__" || !tensor.is_object()) continue;
+            const std::string dtype = tensor.value("dtype", "");
+            if (dtype != "F32" && dtype != "F16" && dtype != "BF16") return false;
+        }
+    } catch (const std::exception&) {
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
 // Helper functions to convert strings to sd.cpp enums
 static rng_type_t string_to_rng_type(const std::string& str) {
     if (str == "std_default" || str == "std") return STD_DEFAULT_RNG;
@@ -315,7 +387,7 @@ ModelLoadParams ModelLoadParams::from_json(const nlohmann::json& j) {
             // circular_x / circular_y moved to per-generation params in
             // leejet PR #1748 — see the /txt2img /img2img /txt2vid schemas.
             // Backend routing (sd.cpp post-2026-05-16; rpc_servers added in leejet PR #1629)
-            "backend", "params_backend", "rpc_servers",
+            "backend", "params_backend", "rpc_servers", "rpc_split",
             // Experimental offload (only honored when SDCPP_EXPERIMENTAL_OFFLOAD is on,
             // but accepted in the schema regardless so OFFLOAD=OFF builds don't 400
             // on configs authored against an OFFLOAD=ON build). Both fork variants'
@@ -333,6 +405,10 @@ ModelLoadParams ModelLoadParams::from_json(const nlohmann::json& j) {
             "stream_layers",
             // leejet PR #1687 — eager-load params at model-load time
             "eager_load",
+            // NUMA placement: lock the weight buffers in RAM
+            "mlock",
+            // Offload autotune
+            "offload_tune", "tune_width", "tune_height", "tune_steps",
         };
         reject_unknown_keys("/models/load options", opts, KNOWN_OPTIONS);
         params.n_threads = opts.value("n_threads", -1);
@@ -384,6 +460,10 @@ ModelLoadParams ModelLoadParams::from_json(const nlohmann::json& j) {
         params.backend = opts.value("backend", "");
         params.params_backend = opts.value("params_backend", "");
         params.rpc_servers = opts.value("rpc_servers", "");
+        params.rpc_split = opts.value("rpc_split", "");
+        if (params.rpc_split != "" && params.rpc_split != "auto") {
+            throw std::runtime_error("rpc_split must be \"auto\" or empty, got: " + params.rpc_split);
+        }
 
 #if defined(SDCPP_EXPERIMENTAL_OFFLOAD) && !defined(SDCPP_UNIFIED_STREAMING)
         // ── feature/vram-offloading-v2 path ──────────────────────────────
@@ -424,95 +504,147 @@ ModelLoadParams ModelLoadParams::from_json(const nlohmann::json& j) {
         // Default true — see ModelLoadParams.eager_load comment for why
         // the restapi flips the upstream default.
         params.eager_load = opts.value("eager_load", true);
+        if (opts.contains("mlock") && opts["mlock"].is_boolean()) {
+            params.mlock = opts["mlock"].get<bool>();
+        }
+
+        params.offload_tune = opts.value("offload_tune", "");
+        if (params.offload_tune != "" && params.offload_tune != "auto" && params.offload_tune != "force") {
+            throw std::runtime_error("offload_tune must be \"auto\", \"force\" or empty, got: " + params.offload_tune);
+        }
+        params.tune_width = opts.value("tune_width", 1024);
+        params.tune_height = opts.value("tune_height", 1024);
+        params.tune_steps = opts.value("tune_steps", 4);
+        if (params.tune_width < 64 || params.tune_height < 64 || params.tune_width > 4096 || params.tune_height > 4096) {
+            throw std::runtime_error("tune_width and tune_height must be between 64 and 4096");
+        }
+        if (params.tune_steps < 2 || params.tune_steps > 50) {
+            throw std::runtime_error("tune_steps must be between 2 and 50");
+        }
     }
 
     return params;
 }
 
 ModelManager::ModelManager(const Config& config)
-    : config_(config) {
+    : config_(config),
+      warm_cache_(std::make_unique<WarmModelCache>(
+          static_cast<uint64_t>(config.model_cache.ram_budget_mb) * 1024 * 1024,
+          config.model_cache.pin)),
+      lora_cache_(std::make_unique<LoraCache>(
+          static_cast<uint64_t>(config.lora_cache.ram_budget_mb) * 1024 * 1024,
+          config.lora_cache.pin)),
+      conditioning_cache_(std::make_unique<ConditioningCache>(
+          static_cast<uint64_t>(config.conditioning_cache.ram_budget_mb) * 1024 * 1024)),
+      prefetcher_(std::make_unique<ModelPrefetcher>(
+          static_cast<uint64_t>(config.model_cache.prefetch_min_free_mb) * 1024 * 1024,
+          warm_cache_.get())),
+      catalog_(std::make_unique<ModelCatalog>(
+          (fs::path(config.paths.output) / "model_catalog.json").string(),
+          (fs::path(config.paths.output) / "model_hashes.json").string())),
+      tune_cache_(std::make_unique<OffloadTuneCache>(
+          (fs::path(config.paths.output) / "offload_tune.json").string())),
+      quant_cache_(std::make_unique<QuantCache>(
+          config.quant_cache,
+          (fs::path(config.paths.output) / "quant_cache.json").string(),
+          config.quant_cache.dir.empty() ? (fs::path(config.paths.output) / ".quant_cache").string()
+                                         : config.quant_cache.dir)),
+      placement_(std::make_unique<NumaPlacement>(config.numa)) {
+    const auto& devices = config.queue.generation_devices;
+    if (!devices.empty()) device0_backend_ = devices[0];
+    for (size_t i = 1; i < devices.size(); ++i) {
+        auto d = std::make_unique<DeviceContext>();
+        d->backend = devices[i];
+        d->loras = std::make_unique<LoraCache>(
+            static_cast<uint64_t>(config.lora_cache.ram_budget_mb) * 1024 * 1024, config.lora_cache.pin);
+        devices_.push_back(std::move(d));
+    }
+    SDWrapper::set_conditioning_cache(conditioning_cache_.get());
 }
 
 ModelManager::~ModelManager() {
     unload_model();
     unload_upscaler();
     unload_adetailer();
+    SDWrapper::set_conditioning_cache(nullptr);
 }
 
-void ModelManager::scan_models() {
+void ModelManager::scan_models(bool full) {
     std::lock_guard<std::mutex> lock(registry_mutex_);
     models_.clear();
+    catalog_->begin_scan();
     
     // Scan each type of model directory
-    scan_directory(config_.paths.checkpoints, ModelType::Checkpoint);
-    scan_directory(config_.paths.diffusion_models, ModelType::Diffusion);
-    scan_directory(config_.paths.vae, ModelType::VAE);
-    scan_directory(config_.paths.lora, ModelType::LoRA);
-    scan_directory(config_.paths.clip, ModelType::CLIP);
-    scan_directory(config_.paths.t5, ModelType::T5);
+    scan_directory(config_.paths.checkpoints, ModelType::Checkpoint, full);
+    scan_directory(config_.paths.diffusion_models, ModelType::Diffusion, full);
+    scan_directory(config_.paths.vae, ModelType::VAE, full);
+    scan_directory(config_.paths.lora, ModelType::LoRA, full);
+    scan_directory(config_.paths.clip, ModelType::CLIP, full);
+    scan_directory(config_.paths.t5, ModelType::T5, full);
     
     if (!config_.paths.embeddings.empty() && utils::directory_exists(config_.paths.embeddings)) {
-        scan_directory(config_.paths.embeddings, ModelType::Embedding);
+        scan_directory(config_.paths.embeddings, ModelType::Embedding, full);
     }
     
     if (!config_.paths.controlnet.empty() && utils::directory_exists(config_.paths.controlnet)) {
-        scan_directory(config_.paths.controlnet, ModelType::ControlNet);
+        scan_directory(config_.paths.controlnet, ModelType::ControlNet, full);
     }
     
     if (!config_.paths.llm.empty() && utils::directory_exists(config_.paths.llm)) {
-        scan_directory(config_.paths.llm, ModelType::LLM);
+        scan_directory(config_.paths.llm, ModelType::LLM, full);
     }
     
     if (!config_.paths.esrgan.empty() && utils::directory_exists(config_.paths.esrgan)) {
-        scan_directory(config_.paths.esrgan, ModelType::ESRGAN);
+        scan_directory(config_.paths.esrgan, ModelType::ESRGAN, full);
     }
 
     if (!config_.paths.taesd.empty() && utils::directory_exists(config_.paths.taesd)) {
-        scan_directory(config_.paths.taesd, ModelType::TAESD);
+        scan_directory(config_.paths.taesd, ModelType::TAESD, full);
     }
 
     if (!config_.paths.motion_module.empty() && utils::directory_exists(config_.paths.motion_module)) {
-        scan_directory(config_.paths.motion_module, ModelType::MotionModule);
+        scan_directory(config_.paths.motion_module, ModelType::MotionModule, full);
     }
 
     if (!config_.paths.adetailer.empty() && utils::directory_exists(config_.paths.adetailer)) {
-        scan_directory(config_.paths.adetailer, ModelType::ADetailer);
+        scan_directory(config_.paths.adetailer, ModelType::ADetailer, full);
     }
 
+    catalog_->end_scan();
+
     std::cout << "[ModelManager] Scanned models:" << std::endl;
     for (const auto& [type, type_models] : models_) {
         std::cout << "  " << model_type_to_string(type) << ": " << type_models.size() << " models" << std::endl;
     }
 }
 
-void ModelManager::scan_directory(const std::string& base_path, ModelType type) {
+void ModelManager::scan_directory(const std::string& base_path, ModelType type, bool full) {
     if (base_path.empty() || !utils::directory_exists(base_path)) {
         return;
     }
 
-    std::vector<std::string> extensions = {".safetensors", ".gguf", ".ckpt", ".pt", ".pth"};
-    auto files = utils::list_files(base_path, extensions, true);
+    static const std::vector<std::string> extensions = {".safetensors", ".gguf", ".ckpt", ".pt", ".pth"};
 
-    for (const auto& rel_path : files) {
-        std::string full_path = (fs::path(base_path) / rel_path).string();
-        std::string ext = utils::get_file_extension(full_path);
+    for (auto& file : catalog_->scan(base_path, extensions, full)) {
+        std::string ext = utils::get_file_extension(file.full_path);
 
         // For ESRGAN models, .pth/.pt files must be ZIP-based (PyTorch ZIP archives).
         // Plain serialized .pth files are not supported by sd.cpp - skip them.
         if (type == ModelType::ESRGAN && (ext == "pth" || ext == "pt")) {
-            if (!utils::is_zip_archive(full_path)) {
+            if (!catalog_->is_zip_archive(file.full_path)) {
                 continue;  // Skip unsupported format
             }
         }
 
         ModelInfo info;
-        info.name = rel_path;
-        info.full_path = full_path;
+        info.name = file.rel_path;
+        info.full_path = std::move(file.full_path);
         info.type = type;
         info.file_extension = ext;
-        info.file_size = utils::get_file_size(full_path);
+        info.file_size = file.size;
+        info.hash = std::move(file.sha256);
 
-        models_[type][rel_path] = info;
+        models_[type][info.name] = std::move(info);
     }
 }
 
@@ -635,7 +767,16 @@ std::optional<ModelInfo> ModelManager::get_model(const std::string& name, ModelT
 }
 
 bool ModelManager::load_model(const ModelLoadParams& params) {
+    // The tuned path calls back in here for every load it makes
+    if (!params.offload_tune.empty() && !offload_tuning_.load()) {
+        return load_model_tuned(params);
+    }
+
+    // Includes the wait for context_mutex_ (a job loading its model)
+    JobTrace::Span load_span("load_model", "model");
     std::lock_guard<std::mutex> lock(context_mutex_);
+    // ...and for the generations running on the other devices
+    auto device_locks = lock_devices();
 
     // Set loading state
     loading_model_name_ = params.model_name;
@@ -649,6 +790,16 @@ bool ModelManager::load_model(const ModelLoadParams& params) {
     // into the next load's user-facing failure string.
     clear_sd_errors();
 
+    // Every exit lands in the /metrics load-time histogram
+    struct LoadTimer {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        const char* result = "failed";
+        ~LoadTimer() {
+            metrics::registry().model_load.with({result}).observe(
+                std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+        }
+    } load_timer;
+
     // Helper to clear loading state on exit
     auto clear_loading = [this]() {
         model_loading_ = false;
@@ -873,7 +1024,65 @@ bool ModelManager::load_model(const ModelLoadParams& params) {
 
         throw std::runtime_error(error_msg);
     }
-    
+
+    // A float model loaded without a weight type of its own opens its
+    // quantized copy from the quant cache, when one has been built
+    if (quant_cache_->enabled() && params.weight_type.empty() && params.tensor_type_rules.empty() &&
+        (params.model_type == ModelType::Checkpoint || params.model_type == ModelType::Diffusion) &&
+        float_weights(*model_info)) {
+        // offload_tune's calibration loads are not uses
+        if (!offload_tuning_.load()) {
+            quant_cache_->record_load(model_info->full_path, model_info->name, model_info->hash);
+        }
+        const std::string cached = quant_cache_->lookup(
+            model_info->hash, quant_cache_->target_type(get_memory_info().gpu_total));
+        if (!cached.empty()) {
+            std::cout << "[ModelManager] Quant cache: loading " << cached << " for " << params.model_name << std::endl;
+            std::error_code ec;
+            const auto size = fs::file_size(cached, ec);
+            model_info->full_path = cached;
+            if (!ec) model_info->file_size = size;
+        }
+    }
+
+    // Component files of this load, for the warm model cache
+    std::vector<std::string> component_paths;
+    uint64_t weight_bytes = 0;
+    for (const auto* info : {&model_info, &vae_info, &clip_l_info, &clip_g_info, &t5_info,
+                             &controlnet_info, &motion_module_info, &llm_info, &llm_vision_info,
+                             &clip_vision_info, &taesd_info, &high_noise_diffusion_info,
+                             &uncond_diffusion_info, &photo_maker_info, &pulid_weights_info}) {
+        if (*info) {
+            component_paths.push_back((*info)->full_path);
+            weight_bytes += (*info)->file_size;
+        }
+    }
+    bool warm = false;
+    if (warm_cache_->enabled()) {
+        warm = warm_cache_->lookup(component_paths);
+        std::cout << "[ModelManager] Warm cache " << (warm ? "hit" : "miss")
+                  << " for " << params.model_name << std::endl;
+    }
+
+    // new_sd_ctx() reads the components one after another; reading them
+    // into the page cache side by side first lets it parse from RAM
+    if (!warm && config_.model_cache.parallel_preread) {
+        prefetcher_->cancel();
+        std::vector<std::pair<std::string, std::string>> files;
+        const std::pair<const char*, const std::optional<ModelInfo>*> labelled[] = {
+            {"model", &model_info}, {"vae", &vae_info}, {"clip_l", &clip_l_info},
+            {"clip_g", &clip_g_info}, {"t5xxl", &t5_info}, {"controlnet", &controlnet_info},
+            {"motion_module", &motion_module_info}, {"llm", &llm_info},
+            {"llm_vision", &llm_vision_info}, {"clip_vision", &clip_vision_info},
+            {"taesd", &taesd_info}, {"high_noise_diffusion_model", &high_noise_diffusion_info},
+            {"uncond_diffusion_model", &uncond_diffusion_info}, {"photo_maker", &photo_maker_info},
+            {"pulid_weights", &pulid_weights_info}};
+        for (const auto& [label, info] : labelled) {
+            if (*info) files.emplace_back(label, (*info)->full_path);
+        }
+        preread_components(files);
+    }
+
     // ===== PHASE 2: All models validated, now unload and load =====
     
     // Unload current model if any
@@ -885,11 +1094,15 @@ bool ModelManager::load_model(const ModelLoadParams& params) {
         // handles the equivalent teardown internally.
         sd_free_gpu_resources(context_);
 #endif
+        SDWrapper::set_conditioning_scope(context_, "");
         free_sd_ctx(context_);
         context_ = nullptr;
+        placement_->clear();
+        lora_cache_->reset();
         loaded_model_name_.clear();
         loaded_model_architecture_.clear();
     }
+    free_device_contexts();
     
     // Initialize context parameters
     sd_ctx_params_t ctx_params;
@@ -1041,7 +1254,7 @@ bool ModelManager::load_model(const ModelLoadParams& params) {
     // The lora_model_dir parameter was removed in sd.cpp c3ad6a1
 
     // Set options
-    ctx_params.n_threads = params.n_threads > 0 ? params.n_threads : sd_get_num_physical_cores();
+    ctx_params.n_threads = params.n_threads > 0 ? params.n_threads : default_threads();
     ctx_params.flash_attn = params.flash_attn;
     ctx_params.diffusion_flash_attn = params.diffusion_flash_attn;
     ctx_params.enable_mmap = params.enable_mmap;
@@ -1103,13 +1316,47 @@ bool ModelManager::load_model(const ModelLoadParams& params) {
     // Backend routing. Pointers into sd_ctx_params_t must stay valid for the
     // duration of new_sd_ctx() — `params` outlives that call here, so passing
     // c_str() is safe. Empty strings → nullptr so sd.cpp falls back to its
-    // built-in selection logic.
-    ctx_params.backend = params.backend.empty() ? nullptr : params.backend.c_str();
+    // built-in selection logic. queue.generation_devices puts each device's
+    // context on its own backend, the first one here.
+    const std::string& backend = device0_backend_.empty() ? params.backend : device0_backend_;
+    ctx_params.backend = backend.empty() ? nullptr : backend.c_str();
     ctx_params.params_backend = params.params_backend.empty() ? nullptr : params.params_backend.c_str();
     // RPC distributed-backend node list (leejet PR #1629). Comma-separated
     // "host:port" pairs in sd.cpp's own format. Empty → nullptr → local.
     ctx_params.rpc_servers = params.rpc_servers.empty() ? nullptr : params.rpc_servers.c_str();
 
+    // rpc_split = "auto": probe the servers now (ggml's rpc-server takes one
+    // client at a time, so before sd.cpp connects), drop the ones that do
+    // not answer and hand sd.cpp a per-device max_vram budget in proportion
+    // to each device's free VRAM
+    std::optional<RpcSplitPlan> rpc_plan;
+    if (params.rpc_split == "auto" && !params.rpc_servers.empty()) {
+        JobTrace::Span probe_span("rpc_probe", "model");
+        const auto probe_start = std::chrono::steady_clock::now();
+        auto probes = probe_rpc_servers(params.rpc_servers);
+        const MemoryInfo mem = get_memory_info();
+        rpc_plan = plan_rpc_split(probes, mem.gpu_available ? local_gpu_device() : "",
+                                  mem.gpu_free, weight_bytes, RPC_SPLIT_HEADROOM);
+        rpc_plan->probe_ms = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - probe_start).count();
+        for (const auto& p : probes) {
+            std::cout << "[ModelManager] RPC " << p.endpoint << ": "
+                      << (p.reachable ? "v" + p.version + ", rtt " + std::to_string(p.rtt_ms) + " ms, free "
+                                        + std::to_string(p.free_bytes / (1024 * 1024)) + " MiB"
+                                      : "unreachable (" + p.error + ")")
+                      << std::endl;
+        }
+        if (rpc_plan->rpc_servers.empty()) {
+            std::cerr << "[ModelManager] No RPC server answered, loading locally" << std::endl;
+        }
+        if (!rpc_plan->max_vram.empty()) {
+            std::cout << "[ModelManager] RPC split: " << rpc_plan->max_vram
+                      << (rpc_plan->fits ? "" : " (weights exceed the devices' VRAM; the rest stays in RAM)")
+                      << std::endl;
+        }
+        ctx_params.rpc_servers = rpc_plan->rpc_servers.empty() ? nullptr : rpc_plan->rpc_servers.c_str();
+    }
+
     // max_vram became a string in leejet PR #1660 (bb90bfa) so it can carry
     // backend-specific budgets like "cuda:8,cpu:0" alongside the legacy float
     // semantics. Restapi keeps the input contract as float (preserves
@@ -1118,7 +1365,9 @@ bool ModelManager::load_model(const ModelLoadParams& params) {
     // scoped, not block-scoped. Special values: 0.0 → nullptr (disabled,
     // matches the previous behavior); negative → "-N" auto-detect sentinel.
     std::string max_vram_str;
-    if (params.max_vram != 0.0f) {
+    if (rpc_plan && !rpc_plan->max_vram.empty()) {
+        ctx_params.max_vram = rpc_plan->max_vram.c_str();
+    } else if (params.max_vram != 0.0f) {
         std::ostringstream oss;
         oss << params.max_vram;
         max_vram_str = oss.str();
@@ -1186,10 +1435,14 @@ bool ModelManager::load_model(const ModelLoadParams& params) {
     sd_set_progress_callback(model_loading_progress_callback, nullptr);
 
     // Create context
-    context_ = new_sd_ctx(&ctx_params);
+    const NumaPlacement::Snapshot maps_before = placement_->snapshot();
+    {
+        JobTrace::Span ctx_span("new_sd_ctx", "model");
+        context_ = new_sd_ctx(&ctx_params);
+    }
 
-    // Clear progress callback after loading
-    sd_set_progress_callback(nullptr, nullptr);
+    // Hand the callback back to the generations waiting for the context
+    SDWrapper::resume_progress_callback();
     g_loading_model_manager = nullptr;
 
     // Validate context integrity.
@@ -1334,6 +1587,23 @@ bool ModelManager::load_model(const ModelLoadParams& params) {
     loaded_options_["backend"] = params.backend;
     loaded_options_["params_backend"] = params.params_backend;
     loaded_options_["rpc_servers"] = params.rpc_servers;
+    loaded_options_["rpc_split"] = params.rpc_split;
+    rpc_split_plan_ = rpc_plan ? rpc_plan->to_json() : nlohmann::json();
+    {
+        // Per-device figures in the jobs' timings
+        std::vector<JobTimings::DeviceShare> split;
+        if (rpc_plan && !rpc_plan->max_vram.empty()) {
+            for (const auto& d : rpc_plan->devices) split.push_back({d.name, d.share, d.rtt_ms});
+        }
+        JobTimings::set_device_split(std::move(split));
+    }
+    if (!params.offload_tune.empty()) {
+        loaded_options_["offload_tune"] = params.offload_tune;
+        loaded_options_["tune_width"] = params.tune_width;
+        loaded_options_["tune_height"] = params.tune_height;
+        loaded_options_["tune_steps"] = params.tune_steps;
+    }
+    offload_tune_ = std::exchange(pending_offload_tune_, nlohmann::json());
     loaded_options_["force_sdxl_vae_conv_scale"] = params.force_sdxl_vae_conv_scale;
     loaded_options_["model_args"] = params.model_args;
     loaded_options_["vae_format"] = params.vae_format;
@@ -1361,13 +1631,55 @@ bool ModelManager::load_model(const ModelLoadParams& params) {
     loaded_options_["stream_layers"] = params.stream_layers;
 #endif
     loaded_options_["eager_load"] = params.eager_load;
+    if (params.mlock) {
+        loaded_options_["mlock"] = *params.mlock;
+    }
+
+    loaded_weight_bytes_ = weight_bytes;
+
+    // The same model on the other generation devices, from the same params.
+    // A device it doesn't load on stays empty and takes no generations.
+    if (!devices_.empty() && ctx_params.rpc_servers != nullptr) {
+        std::cerr << "[ModelManager] RPC servers take one client at a time: generation devices after "
+                  << (backend.empty() ? "the first" : backend) << " stay empty" << std::endl;
+    } else {
+        for (size_t i = 0; i < devices_.size(); ++i) {
+            auto& d = *devices_[i];
+            clear_sd_errors();
+            ctx_params.backend = d.backend.c_str();
+            {
+                JobTrace::Span ctx_span("new_sd_ctx", "model");
+                d.ctx = new_sd_ctx(&ctx_params);
+            }
+            if (d.ctx != nullptr && sd_get_model_version_name(d.ctx) == nullptr) {
+                free_sd_ctx(d.ctx);
+                d.ctx = nullptr;
+            }
+            d.loaded = d.ctx != nullptr;
+            if (d.loaded) {
+                std::cout << "[ModelManager] Device " << (i + 1) << " (" << d.backend << "): loaded" << std::endl;
+            } else {
+                const std::string sd_errors = get_sd_error();
+                std::cerr << "[ModelManager] Device " << (i + 1) << " (" << d.backend << "): load failed"
+                          << (sd_errors.empty() ? "" : ": " + sd_errors) << std::endl;
+            }
+        }
+    }
 
     // Set atomic flag for lock-free checks
     model_loaded_ = true;
+    publish_conditioning_scope();
 
     // Clear loading state on success
     clear_loading();
 
+    // Before retain(): its mappings of the same files are not the weights
+    placement_->place(maps_before, component_paths, params.mlock.value_or(placement_->mlock_default()));
+
+    // Keep this model's files resident so switching back to it later reads
+    // from RAM. Pages are already cached from the load, so this is cheap.
+    warm_cache_->retain(component_paths);
+
     // Persist load identity to disk so that on a server restart we can
     // auto-reload the same model. Without this, queued jobs picked up from
     // queue_state.json fail with "No model loaded" because the in-memory
@@ -1397,6 +1709,7 @@ bool ModelManager::load_model(const ModelLoadParams& params) {
         // loaded_options_ already has the full set of load options in the
         // shape ModelLoadParams::from_json expects under the "options" key.
         persisted["options"] = loaded_options_;
+        loaded_request_ = persisted;
 
         fs::path persist_path = fs::path(config_.paths.output) / "last_loaded_model.json";
         std::ofstream f(persist_path);
@@ -1421,6 +1734,7 @@ bool ModelManager::load_model(const ModelLoadParams& params) {
         });
     }
 
+    load_timer.result = "success";
     return true;
 }
 
@@ -1472,6 +1786,8 @@ bool ModelManager::try_auto_reload_from_disk() {
 
 void ModelManager::unload_model() {
     std::lock_guard<std::mutex> lock(context_mutex_);
+    auto device_locks = lock_devices();
+    free_device_contexts();
 
     // Clear error state when unloading
     last_load_error_.clear();
@@ -1505,8 +1821,11 @@ void ModelManager::unload_model() {
         // handles the cleanup itself there.
         sd_free_gpu_resources(context_);
 #endif
+        SDWrapper::set_conditioning_scope(context_, "");
         free_sd_ctx(context_);
         context_ = nullptr;
+        placement_->clear();
+        lora_cache_->reset();
         loaded_model_name_.clear();
         loaded_model_architecture_.clear();
 
@@ -1522,6 +1841,11 @@ void ModelManager::unload_model() {
 
         // Clear load options
         loaded_options_.clear();
+        loaded_request_ = nullptr;
+        loaded_weight_bytes_ = 0;
+        rpc_split_plan_ = nullptr;
+        offload_tune_ = nullptr;
+        JobTimings::set_device_split({});
 
         // Broadcast model unloaded via WebSocket
         if (auto* ws = get_websocket_server()) {
@@ -1538,6 +1862,31 @@ bool ModelManager::is_model_loaded() const {
     return model_loaded_.load();
 }
 
+bool ModelManager::is_model_loaded(size_t device) const {
+    return device == 0 ? model_loaded_.load() : devices_[device - 1]->loaded.load();
+}
+
+std::vector<std::unique_lock<std::mutex>> ModelManager::lock_devices() {
+    std::vector<std::unique_lock<std::mutex>> locks;
+    locks.reserve(devices_.size());
+    for (auto& d : devices_) locks.emplace_back(d->mutex);
+    return locks;
+}
+
+void ModelManager::free_device_contexts() {
+    for (auto& d : devices_) {
+        d->loaded = false;
+        if (d->ctx == nullptr) continue;
+#if defined(SDCPP_EXPERIMENTAL_OFFLOAD) && !defined(SDCPP_UNIFIED_STREAMING)
+        sd_free_gpu_resources(d->ctx);
+#endif
+        SDWrapper::set_conditioning_scope(d->ctx, "");
+        free_sd_ctx(d->ctx);
+        d->ctx = nullptr;
+        d->loras->reset();
+    }
+}
+
 std::string ModelManager::get_loaded_model_name() const {
     std::lock_guard<std::mutex> lock(context_mutex_);
     return loaded_model_name_;
@@ -1549,39 +1898,103 @@ std::string ModelManager::get_loaded_model_architecture() const {
 }
 
 std::string ModelManager::compute_model_hash(const std::string& name, ModelType type) {
-    std::lock_guard<std::mutex> lock(registry_mutex_);
-    
-    auto type_it = models_.find(type);
-    if (type_it == models_.end()) {
-        throw std::runtime_error("Model type not found");
-    }
-    
-    auto it = type_it->second.find(name);
-    if (it == type_it->second.end()) {
-        throw std::runtime_error("Model not found: " + name);
-    }
-    
-    // Return cached hash if available
-    if (!it->second.hash.empty()) {
-        return it->second.hash;
+    std::string full_path;
+    {
+        std::lock_guard<std::mutex> lock(registry_mutex_);
+
+        auto type_it = models_.find(type);
+        if (type_it == models_.end()) {
+            throw std::runtime_error("Model type not found");
+        }
+
+        auto it = type_it->second.find(name);
+        if (it == type_it->second.end()) {
+            throw std::runtime_error("Model not found: " + name);
+        }
+
+        // Return cached hash if available
+        if (!it->second.hash.empty()) {
+            return it->second.hash;
+        }
+        full_path = it->second.full_path;
     }
-    
-    // Compute hash
+
+    // Hash without the registry lock: a multi-GB read must not stall /models
     std::cout << "[ModelManager] Computing hash for: " << name << std::endl;
-    std::string hash = utils::compute_sha256(it->second.full_path);
-    
-    // Cache it
-    it->second.hash = hash;
-    
+    return hash_model_file(full_path);
+}
+
+std::string ModelManager::hash_model_file(const std::string& full_path,
+                                          const utils::HashProgressCallback& progress) {
+    std::string hash = catalog_->get_or_compute(full_path, progress);
+    set_registry_hash(full_path, hash);
     return hash;
 }
 
-sd_ctx_t* ModelManager::get_context() {
-    return context_;
+std::map<std::string, std::string> ModelManager::hash_model_files(
+    const std::vector<std::string>& full_paths, int threads,
+    const std::function<void(size_t done, size_t total)>& progress
+) {
+    auto hashes = catalog_->get_or_compute_many(full_paths, threads, progress);
+    for (const auto& [path, hash] : hashes) {
+        set_registry_hash(path, hash);
+    }
+    return hashes;
+}
+
+void ModelManager::record_model_hash(const std::string& full_path, const std::string& sha256) {
+    catalog_->store(full_path, sha256);
+    set_registry_hash(full_path, sha256);
+}
+
+std::vector<std::string> ModelManager::get_unhashed_model_paths(std::optional<ModelType> type) const {
+    std::lock_guard<std::mutex> lock(registry_mutex_);
+    std::vector<std::string> paths;
+    for (const auto& [t, type_models] : models_) {
+        if (type && *type != t) continue;
+        for (const auto& [name, info] : type_models) {
+            if (info.hash.empty()) paths.push_back(info.full_path);
+        }
+    }
+    // The same directory may be registered under more than one type
+    std::sort(paths.begin(), paths.end());
+    paths.erase(std::unique(paths.begin(), paths.end()), paths.end());
+    return paths;
+}
+
+void ModelManager::set_registry_hash(const std::string& full_path, const std::string& hash) {
+    std::lock_guard<std::mutex> lock(registry_mutex_);
+    for (auto& [type, type_models] : models_) {
+        for (auto& [name, info] : type_models) {
+            if (info.full_path == full_path) info.hash = hash;
+        }
+    }
 }
 
-std::mutex& ModelManager::get_context_mutex() {
-    return context_mutex_;
+nlohmann::json ModelManager::get_catalog_stats() const {
+    return catalog_->stats_json();
+}
+
+std::optional<nlohmann::json> ModelManager::next_quantize_job() const {
+    if (!quant_cache_->enabled()) return std::nullopt;
+    const std::string target = quant_cache_->target_type(get_memory_info().gpu_total);
+    auto candidate = quant_cache_->next_candidate(target);
+    if (!candidate) return std::nullopt;
+    return nlohmann::json{
+        {"input_path", candidate->source_path},
+        {"output_type", target},
+        {"tensor_type_rules", quant_cache_->tensor_type_rules()},
+        {"model_name", candidate->name},
+        {"quant_cache", true}
+    };
+}
+
+sd_ctx_t* ModelManager::get_context(size_t device) {
+    return device == 0 ? context_ : devices_[device - 1]->ctx;
+}
+
+std::mutex& ModelManager::get_context_mutex(size_t device) {
+    return device == 0 ? context_mutex_ : devices_[device - 1]->mutex;
 }
 
 std::string ModelManager::get_lora_dir() const {
@@ -1594,7 +2007,7 @@ nlohmann::json ModelManager::get_loaded_models_info() const {
     nlohmann::json result;
 
     bool is_loaded = model_loaded_.load();
-    bool is_loading = model_loading_.load();
+    bool is_loading = model_loading_.load() || offload_tuning_.load();
 
     result["model_loaded"] = is_loaded;
     result["model_loading"] = is_loading;
@@ -1607,6 +2020,9 @@ nlohmann::json ModelManager::get_loaded_models_info() const {
     if (is_loading) {
         result["loading_step"] = loading_step_.load();
         result["loading_total_steps"] = loading_total_steps_.load();
+        std::lock_guard<std::mutex> preread_lock(preread_mutex_);
+        result["loading_phase"] = preread_components_.is_null() ? "loading" : "reading";
+        if (!preread_components_.is_null()) result["loading_components"] = preread_components_;
     } else {
         result["loading_step"] = nullptr;
         result["loading_total_steps"] = nullptr;
@@ -1667,6 +2083,20 @@ nlohmann::json ModelManager::get_loaded_models_info() const {
     if (!loaded_options_.empty()) {
         result["load_options"] = loaded_options_;
     }
+    if (!rpc_split_plan_.is_null()) {
+        result["rpc_split"] = rpc_split_plan_;
+    }
+    if (!offload_tune_.is_null()) {
+        result["offload_tune"] = offload_tune_;
+    }
+    if (!config_.queue.generation_devices.empty()) {
+        nlohmann::json devices = nlohmann::json::array();
+        for (size_t i = 0; i < device_count(); ++i) {
+            devices.push_back({{"device", i}, {"backend", config_.queue.generation_devices[i]},
+                               {"loaded", is_model_loaded(i)}});
+        }
+        result["generation_devices"] = devices;
+    }
 
     return result;
 }
@@ -1699,7 +2129,14 @@ bool ModelManager::load_upscaler(const std::string& model_name, int n_threads, i
     }
     
     // Determine thread count
-    int threads = n_threads > 0 ? n_threads : sd_get_num_physical_cores();
+    int threads = n_threads > 0 ? n_threads : default_threads();
+
+    if (tile_size <= 0) {
+        auto mem = get_memory_info();
+        tile_size = auto_upscaler_tile_size(mem.gpu_available ? mem.gpu_free : 0);
+        std::cout << "[ModelManager] Auto upscaler tile_size " << tile_size << " for "
+                  << format_bytes(mem.gpu_free) << " free VRAM" << std::endl;
+    }
     
     std::cout << "[ModelManager] Loading upscaler: " << model_name << std::endl;
     std::cout << "[ModelManager] Using " << threads << " threads, tile_size=" << tile_size << std::endl;
@@ -1721,6 +2158,7 @@ bool ModelManager::load_upscaler(const std::string& model_name, int n_threads, i
     }
     
     loaded_upscaler_name_ = model_name;
+    upscaler_tile_size_ = tile_size;
     
     // Set atomic flag for lock-free checks
     upscaler_loaded_ = true;
@@ -1776,6 +2214,10 @@ std::mutex& ModelManager::get_upscaler_mutex() {
     return upscaler_mutex_;
 }
 
+int ModelManager::get_upscaler_tile_size() const {
+    return upscaler_tile_size_.load();
+}
+
 std::string ModelManager::get_loaded_upscaler_name() const {
     std::lock_guard<std::mutex> lock(upscaler_mutex_);
     return loaded_upscaler_name_;
@@ -1790,17 +2232,466 @@ int ModelManager::get_upscale_factor() const {
 }
 
 void ModelManager::update_loading_progress(int step, int total_steps) {
+    update_loading_progress(step, total_steps, nullptr);
+}
+
+void ModelManager::update_loading_progress(int step, int total_steps, const nlohmann::json& components) {
     loading_step_ = step;
     loading_total_steps_ = total_steps;
 
     // Broadcast loading progress via WebSocket
     if (auto* ws = get_websocket_server()) {
-        ws->broadcast(WSEventType::ModelLoadingProgress, {
+        nlohmann::json event = {
             {"model_name", loading_model_name_},
             {"step", step},
-            {"total_steps", total_steps}
+            {"total_steps", total_steps},
+            {"phase", components.is_null() ? "loading" : "reading"}
+        };
+        if (!components.is_null()) event["components"] = components;
+        ws->broadcast(WSEventType::ModelLoadingProgress, event);
+    }
+}
+
+void ModelManager::preread_components(const std::vector<std::pair<std::string, std::string>>& files) {
+    struct File {
+        std::string component;
+        std::string path;
+        uint64_t size = 0;
+        std::atomic<uint64_t> read{0};
+        std::atomic<bool> done{false};
+    };
+    std::vector<File> entries(files.size());
+    uint64_t total = 0;
+    for (size_t i = 0; i < files.size(); ++i) {
+        std::error_code ec;
+        entries[i].component = files[i].first;
+        entries[i].path = files[i].second;
+        entries[i].size = fs::file_size(files[i].second, ec);
+        if (ec) entries[i].size = 0;
+        total += entries[i].size;
+    }
+    if (entries.size() < 2 || total == 0) return;
+
+    // Pages that don't fit would only push each other (and the running
+    // process) out again before new_sd_ctx() gets to them
+    const uint64_t min_free =
+        static_cast<uint64_t>(config_.model_cache.prefetch_min_free_mb) * 1024 * 1024;
+    const uint64_t available = get_memory_info().system_free;
+    if (available < total + min_free) {
+        std::cout << "[ModelManager] Skipping parallel pre-read: " << format_bytes(total)
+                  << " of components, " << format_bytes(available) << " RAM available" << std::endl;
+        return;
+    }
+
+    auto t0 = std::chrono::steady_clock::now();
+    std::cout << "[ModelManager] Pre-reading " << entries.size() << " component files ("
+              << format_bytes(total) << ") in parallel" << std::endl;
+
+    auto progress = [&entries]() {
+        nlohmann::json components = nlohmann::json::array();
+        uint64_t read = 0;
+        for (const auto& e : entries) {
+            read += e.read.load(std::memory_order_relaxed);
+            components.push_back({
+                {"component", e.component},
+                {"bytes", e.size},
+                {"bytes_read", e.read.load(std::memory_order_relaxed)},
+                {"done", e.done.load()}
+            });
+        }
+        return std::make_pair(read, components);
+    };
+    auto publish = [&](const std::pair<uint64_t, nlohmann::json>& p) {
+        {
+            std::lock_guard<std::mutex> lock(preread_mutex_);
+            preread_components_ = p.second;
+        }
+        update_loading_progress(static_cast<int>(p.first >> 20), static_cast<int>(total >> 20), p.second);
+    };
+
+    const std::atomic<bool> stop{false};
+    std::vector<std::thread> readers;
+    readers.reserve(entries.size());
+    for (auto& e : entries) {
+        readers.emplace_back([&e, &stop, min_free]() {
+            ModelPrefetcher::read_into_page_cache(e.path, stop, e.read, min_free);
+            e.done = true;
         });
     }
+
+    // Report from this thread while the readers run
+    size_t finished = 0;
+    while (finished < entries.size()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(250));
+        finished = 0;
+        for (const auto& e : entries) finished += e.done.load() ? 1 : 0;
+        publish(progress());
+    }
+    for (auto& t : readers) t.join();
+
+    {
+        std::lock_guard<std::mutex> lock(preread_mutex_);
+        preread_components_ = nullptr;
+    }
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - t0).count();
+    std::cout << "[ModelManager] Pre-read " << format_bytes(progress().first) << " in " << ms << " ms" << std::endl;
+}
+
+nlohmann::json ModelManager::get_model_cache_stats() const {
+    return warm_cache_->stats_json();
+}
+
+nlohmann::json ModelManager::get_numa_stats() const {
+    return placement_->stats_json();
+}
+
+int ModelManager::default_threads() const {
+    const int cores = placement_->enabled() ? placement_->cores() : 0;
+    return cores > 0 ? cores : sd_get_num_physical_cores();
+}
+
+nlohmann::json ModelManager::get_lora_cache_stats() const {
+    return lora_cache_->stats_json();
+}
+
+nlohmann::json ModelManager::get_conditioning_cache_stats() const {
+    nlohmann::json j = conditioning_cache_->stats_json();
+    j["available"] = SDWrapper::conditioning_cache_available();
+    return j;
+}
+
+void ModelManager::publish_conditioning_scope() {
+    nlohmann::json fp = get_loaded_model_fingerprint();
+    for (const char* key : {"components", "files"}) {
+        if (fp.contains(key) && fp[key].is_object()) fp[key].erase("controlnet");
+    }
+    const std::string text = fp.dump();
+    utils::Sha256 sha;
+    sha.update(text.data(), text.size());
+    const std::string scope = sha.hex_digest();
+    SDWrapper::set_conditioning_scope(context_, scope);
+    for (auto& d : devices_) {
+        if (d->ctx != nullptr) SDWrapper::set_conditioning_scope(d->ctx, scope);
+    }
+}
+
+nlohmann::json ModelManager::prefetch_model(const ModelLoadParams& params) {
+    return prefetcher_->request(params.model_name, component_paths(params));
+}
+
+std::vector<std::string> ModelManager::component_paths(const ModelLoadParams& params) const {
+    auto model_info = get_model(params.model_name, params.model_type);
+    if (!model_info) {
+        throw std::runtime_error("Model not found: '" + params.model_name + "' (type: " +
+                                 model_type_to_string(params.model_type) + ")");
+    }
+
+    // Same component lookups as load_model(); missing optional files are
+    // left for the load to report
+    std::vector<std::string> paths = {model_info->full_path};
+    auto add = [&](const std::optional<std::string>& name, ModelType type) {
+        if (!name) return;
+        if (auto info = get_model(*name, type)) paths.push_back(info->full_path);
+    };
+    add(params.vae, ModelType::VAE);
+    add(params.clip_l, ModelType::CLIP);
+    add(params.clip_g, ModelType::CLIP);
+    add(params.t5xxl, ModelType::T5);
+    add(params.controlnet, ModelType::ControlNet);
+    add(params.motion_module, ModelType::MotionModule);
+    add(params.llm, ModelType::LLM);
+    add(params.llm_vision, ModelType::LLM);
+    add(params.clip_vision, ModelType::CLIP);
+    add(params.taesd, ModelType::TAESD);
+    add(params.high_noise_diffusion_model, ModelType::Diffusion);
+    add(params.uncond_diffusion_model, ModelType::Diffusion);
+    add(params.photo_maker, ModelType::Checkpoint);
+    add(params.pulid_weights, ModelType::Checkpoint);
+    add(params.audio_vae, ModelType::VAE);
+    add(params.embeddings_connectors, ModelType::T5);
+    return paths;
+}
+
+nlohmann::json ModelManager::get_prefetch_stats() const {
+    return prefetcher_->stats_json();
+}
+
+nlohmann::json ModelManager::get_loaded_model_fingerprint() const {
+    nlohmann::json info = get_loaded_models_info();
+    nlohmann::json fp = {
+        {"model_name", info["model_name"]},
+        {"model_type", info["model_type"]},
+        {"components", info["loaded_components"]},
+        {"options", info.value("load_options", nlohmann::json::object())}
+    };
+    if (!model_loaded_.load()) return fp;
+
+    // A file replaced under the same name must not match its old results
+    std::lock_guard<std::mutex> lock(registry_mutex_);
+    auto identity = [this](ModelType type, const std::string& name) -> nlohmann::json {
+        auto by_type = models_.find(type);
+        if (by_type == models_.end()) return nullptr;
+        auto it = by_type->second.find(name);
+        if (it == by_type->second.end()) return nullptr;
+        if (!it->second.hash.empty()) return it->second.hash;
+        return "size:" + std::to_string(it->second.file_size);
+    };
+    nlohmann::json files = {{"model", identity(loaded_model_type_, loaded_model_name_)}};
+    const std::pair<const char*, ModelType> components[] = {
+        {"vae", ModelType::VAE}, {"clip_l", ModelType::CLIP}, {"clip_g", ModelType::CLIP},
+        {"t5xxl", ModelType::T5}, {"controlnet", ModelType::ControlNet},
+        {"motion_module", ModelType::MotionModule}, {"llm", ModelType::LLM},
+        {"llm_vision", ModelType::LLM}};
+    for (const auto& [key, type] : components) {
+        if (fp["components"].contains(key) && fp["components"][key].is_string()) {
+            files[key] = identity(type, fp["components"][key].get<std::string>());
+        }
+    }
+    fp["files"] = files;
+    return fp;
+}
+
+VramModelInfo ModelManager::get_vram_model_info() const {
+    VramModelInfo info;
+    if (!model_loaded_.load()) return info;
+    // Only written while loading, like the fields get_loaded_models_info reads
+    info.architecture = loaded_model_architecture_;
+    info.weight_bytes = loaded_weight_bytes_.load();
+    const bool flash_attn = loaded_options_.value("flash_attn", true);
+    info.flash_attn = flash_attn || loaded_options_.value("diffusion_flash_attn", false);
+    info.vae_flash_attn = flash_attn;
+    info.max_vram_gib = loaded_options_.value("max_vram", 0.0f);
+    return info;
+}
+
+bool ModelManager::reload_with_options(const nlohmann::json& options) {
+    nlohmann::json request;
+    {
+        std::lock_guard<std::mutex> lock(context_mutex_);
+        if (!model_loaded_.load() || loaded_request_.is_null()) return false;
+        request = loaded_request_;
+    }
+    request["options"].update(options);
+    // The caller picked these options for a job; a cached offload_tune
+    // choice must not replace them
+    request["options"].erase("offload_tune");
+
+    std::cout << "[ModelManager] Reloading " << request.value("model_name", "") << " with "
+              << options.dump() << std::endl;
+    try {
+        return load_model(ModelLoadParams::from_json(request));
+    } catch (const std::exception& e) {
+        std::cerr << "[ModelManager] Reload failed: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool ModelManager::load_model_tuned(const ModelLoadParams& params) {
+    // Also keeps is_loading() true between the calibration's loads
+    offload_tuning_ = true;
+    struct TuningGuard {
+        ModelManager* self;
+        ~TuningGuard() {
+            self->offload_tuning_ = false;
+            self->pending_offload_tune_ = nullptr;
+        }
+    } guard{this};
+
+    if (params.rpc_split == "auto") {
+        std::cout << "[ModelManager] offload_tune ignored: rpc_split = \"auto\" sets max_vram" << std::endl;
+        return load_model(params);
+    }
+    const MemoryInfo gpu = get_memory_info();
+    if (!gpu.gpu_available) {
+        std::cout << "[ModelManager] offload_tune ignored: no GPU" << std::endl;
+        return load_model(params);
+    }
+
+    const std::string bucket = offload_tune_bucket(params.tune_width, params.tune_height);
+    const std::string gpu_name = gpu.gpu_name.empty() ? local_gpu_device() : gpu.gpu_name;
+    // Cached by the model catalog after the first time
+    const std::string key = OffloadTuneCache::key(
+        compute_model_hash(params.model_name, params.model_type), gpu_name, bucket);
+
+    if (params.offload_tune == "auto") {
+        if (auto entry = tune_cache_->lookup(key)) {
+            const nlohmann::json options = entry->value("options", nlohmann::json::object());
+            std::cout << "[ModelManager] Offload tune cache hit for " << params.model_name << " on "
+                      << gpu_name << " at " << bucket << ": " << options.dump() << std::endl;
+            pending_offload_tune_ = *entry;
+            pending_offload_tune_["source"] = "cache";
+            if (load_model(with_offload_options(params, options))) return true;
+            pending_offload_tune_ = nullptr;
+            std::cerr << "[ModelManager] Cached offload settings failed to load, calibrating again" << std::endl;
+        }
+    }
+
+    // Free VRAM with nothing of ours resident, which is what the candidates share
+    unload_model();
+    const MemoryInfo mem = get_memory_info();
+    uint64_t weight_bytes = 0;
+    for (const auto& path : component_paths(params)) {
+        std::error_code ec;
+        const auto size = fs::file_size(path, ec);
+        if (!ec) weight_bytes += size;
+    }
+    VramModelInfo model;
+    model.weight_bytes = weight_bytes;
+    model.flash_attn = params.flash_attn || params.diffusion_flash_attn;
+    model.vae_flash_attn = params.flash_attn;
+    const uint64_t compute = estimate_job_vram(
+        {{"width", params.tune_width}, {"height", params.tune_height}}, false, model).compute();
+    const auto candidates = offload_tune_candidates(weight_bytes, mem.gpu_free, compute);
+
+    std::cout << "[ModelManager] Offload tune: calibrating " << candidates.size() << " configs for "
+              << params.model_name << " on " << gpu_name << " at " << params.tune_width << "x"
+              << params.tune_height << ", " << params.tune_steps << " steps" << std::endl;
+
+    std::vector<OffloadTuneTrial> trials;
+    int best = -1;
+    for (const auto& options : candidates) {
+        trials.push_back(run_offload_trial(params, options));
+        const auto& t = trials.back();
+        std::cout << "[ModelManager] Offload tune " << trials.size() << "/" << candidates.size() << " "
+                  << options.dump() << ": "
+                  << (t.ok ? std::to_string(t.step_ms) + " ms/step, projected " +
+                                 std::to_string(static_cast<int>(t.projected_ms)) + " ms"
+                           : "failed (" + t.error + ")")
+                  << std::endl;
+        if (t.ok && (best < 0 || t.projected_ms < trials[best].projected_ms)) {
+            best = static_cast<int>(trials.size()) - 1;
+        }
+    }
+
+    if (best < 0) {
+        std::cerr << "[ModelManager] Offload tune: no config fit, loading as requested" << std::endl;
+        unload_model();
+        return load_model(params);
+    }
+
+    nlohmann::json tried = nlohmann::json::array();
+    for (const auto& t : trials) tried.push_back(t.to_json());
+    nlohmann::json entry = {
+        {"model", params.model_name},
+        {"model_hash", key.substr(0, key.find('|'))},
+        {"gpu", gpu_name},
+        {"bucket", bucket},
+        {"options", trials[best].options},
+        {"step_ms", trials[best].step_ms},
+        {"projected_ms", trials[best].projected_ms},
+        {"tuned_at", static_cast<int64_t>(std::time(nullptr))},
+        {"trials", tried}
+    };
+    tune_cache_->store(key, entry);
+    std::cout << "[ModelManager] Offload tune chose " << trials[best].options.dump() << std::endl;
+
+    entry["source"] = "calibrated";
+    // The last trial is still loaded: no need to load it a second time
+    if (best == static_cast<int>(trials.size()) - 1) {
+        std::lock_guard<std::mutex> lock(context_mutex_);
+        offload_tune_ = std::move(entry);
+        return model_loaded_.load();
+    }
+    pending_offload_tune_ = std::move(entry);
+    return load_model(with_offload_options(params, trials[best].options));
+}
+
+OffloadTuneTrial ModelManager::run_offload_trial(const ModelLoadParams& params, const nlohmann::json& options) {
+    using Clock = std::chrono::steady_clock;
+    auto ms_since = [](Clock::time_point t) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - t).count();
+    };
+
+    OffloadTuneTrial trial;
+    trial.options = options;
+
+    const auto load_start = Clock::now();
+    bool loaded = false;
+    try {
+        loaded = load_model(with_offload_options(params, options));
+    } catch (const std::exception& e) {
+        trial.error = e.what();
+    }
+    trial.load_ms = ms_since(load_start);
+    if (!loaded) {
+        if (trial.error.empty()) trial.error = last_load_error_.empty() ? "load failed" : last_load_error_;
+        return trial;
+    }
+
+    Txt2ImgParams gen;
+    gen.prompt = OFFLOAD_TUNE_PROMPT;
+    gen.width = params.tune_width;
+    gen.height = params.tune_height;
+    gen.steps = params.tune_steps;
+    gen.seed = 42;
+    gen.sampler = "euler";
+
+    std::vector<Clock::time_point> step_times;
+    std::lock_guard<std::mutex> lock(context_mutex_);
+    if (context_ == nullptr) {
+        trial.error = "model unloaded during calibration";
+        return trial;
+    }
+    SDWrapper::set_progress_callback([&step_times](int, int) { step_times.push_back(Clock::now()); },
+                                     gen.steps);
+    const auto gen_start = Clock::now();
+    try {
+        // Empty job_id and images_out: nothing is written to disk
+        std::vector<StageImage> images;
+        SDWrapper::generate_txt2img(context_, gen, get_lora_dir(), config_.paths.output, "",
+                                    nullptr, nullptr, &images);
+        trial.ok = !images.empty();
+        if (!trial.ok) trial.error = "no image generated";
+    } catch (const std::exception& e) {
+        trial.error = e.what();
+    }
+    trial.total_ms = ms_since(gen_start);
+    SDWrapper::clear_progress_callback();
+    if (!trial.ok) return trial;
+
+    // The first step also pays for graph allocation and lazy weight uploads
+    std::vector<double> deltas;
+    for (size_t i = 1; i < step_times.size(); ++i) {
+        deltas.push_back(std::chrono::duration<double, std::milli>(step_times[i] - step_times[i - 1]).count());
+    }
+    if (!deltas.empty()) {
+        std::sort(deltas.begin(), deltas.end());
+        trial.step_ms = deltas[deltas.size() / 2];
+    } else {
+        trial.step_ms = trial.total_ms / gen.steps;
+    }
+    trial.projected_ms = trial.total_ms + (OFFLOAD_TUNE_PROJECTED_STEPS - gen.steps) * trial.step_ms;
+    return trial;
+}
+
+void ModelManager::append_metrics(std::string& out) const {
+    using metrics::write_header;
+    using metrics::write_sample;
+
+    write_header(out, "sdcpp_model_loaded", "Whether a model is loaded", "gauge");
+    write_sample(out, "sdcpp_model_loaded", "", model_loaded_.load() ? 1 : 0);
+    write_header(out, "sdcpp_model_loading", "Whether a model load is in progress", "gauge");
+    write_sample(out, "sdcpp_model_loading", "", model_loading_.load() ? 1 : 0);
+
+    const std::pair<const char*, nlohmann::json> caches[] = {
+        {"model", warm_cache_->stats_json()},
+        {"lora", lora_cache_->stats_json()}};
+    write_header(out, "sdcpp_cache_hits_total", "Warm cache lookups that found every file resident", "counter");
+    for (const auto& [name, stats] : caches) {
+        write_sample(out, "sdcpp_cache_hits_total", metrics::label("cache", name), stats.value("hits", 0.0));
+    }
+    write_header(out, "sdcpp_cache_misses_total", "Warm cache lookups that had to read from disk", "counter");
+    for (const auto& [name, stats] : caches) {
+        write_sample(out, "sdcpp_cache_misses_total", metrics::label("cache", name), stats.value("misses", 0.0));
+    }
+    write_header(out, "sdcpp_cache_used_bytes", "Host RAM held by the warm cache", "gauge");
+    for (const auto& [name, stats] : caches) {
+        write_sample(out, "sdcpp_cache_used_bytes", metrics::label("cache", name), stats.value("used_bytes", 0.0));
+    }
+
+    write_header(out, "sdcpp_prefetch_bytes_read_total", "Bytes read ahead by /models/prefetch", "counter");
+    write_sample(out, "sdcpp_prefetch_bytes_read_total", "", prefetcher_->stats_json().value("bytes_read", 0.0));
 }
 
 nlohmann::json ModelManager::get_paths_config() const {
@@ -1834,6 +2725,16 @@ bool ModelManager::hot_load_controlnet(const std::string& name) {
         return false;
     }
     loaded_controlnet_ = name;
+    // The copies on the other generation devices run the same jobs
+    auto device_locks = lock_devices();
+    for (size_t i = 0; i < devices_.size(); ++i) {
+        auto& d = *devices_[i];
+        if (d.ctx != nullptr && !sd_ctx_load_control_net(d.ctx, info->full_path.c_str())) {
+            std::cerr << "[ModelManager] Device " << (i + 1) << " (" << d.backend
+                      << "): ControlNet load failed, device disabled until the next model load" << std::endl;
+            d.loaded = false;
+        }
+    }
     return true;
 }
 
@@ -1846,6 +2747,10 @@ bool ModelManager::hot_unload_controlnet() {
         return false;
     }
     loaded_controlnet_.clear();
+    auto device_locks = lock_devices();
+    for (auto& d : devices_) {
+        if (d->ctx != nullptr) sd_ctx_unload_control_net(d->ctx);
+    }
     return true;
 }
 
@@ -1885,15 +2790,18 @@ adetailer_ctx_t* ModelManager::get_or_create_adetailer(const std::string& detect
     }
     int threads = config_.sd_defaults.n_threads > 0
                       ? config_.sd_defaults.n_threads
-                      : sd_get_num_physical_cores();
+                      : default_threads();
     std::cout << "[ModelManager] Loading ADetailer detector: " << detector
               << " (" << info->full_path << ")" << std::endl;
-    adetailer_context_ = new_adetailer_ctx(
-        info->full_path.c_str(),
-        threads,
-        nullptr,    // backend (let sd.cpp pick)
-        nullptr     // params_backend
-    );
+    {
+        JobTimings::Span span("model_load");
+        adetailer_context_ = new_adetailer_ctx(
+            info->full_path.c_str(),
+            threads,
+            nullptr,    // backend (let sd.cpp pick)
+            nullptr     // params_backend
+        );
+    }
     if (adetailer_context_ == nullptr) {
         std::cerr << "[ModelManager] Failed to create adetailer ctx for " << detector << std::endl;
         return nullptr;
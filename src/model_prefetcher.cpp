@@ -0,0 +1,213 @@
+#include "model_prefetcher.hpp"
+#include "warm_model_cache.hpp"
+#include "memory_utils.hpp"
+
+#include <cerrno>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace sdcpp {
+
+namespace {
+
+constexpr size_t CHUNK_BYTES = 8 * 1024 * 1024;
+constexpr uint64_t RAM_CHECK_BYTES = 512ull * 1024 * 1024;   // Re-check MemAvailable this often
+
+} // namespace
+
+ModelPrefetcher::ModelPrefetcher(uint64_t min_free_bytes, WarmModelCache* warm_cache)
+    : min_free_bytes_(min_free_bytes), warm_cache_(warm_cache) {
+}
+
+ModelPrefetcher::~ModelPrefetcher() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+        queue_.clear();
+    }
+    cancel_ = true;
+    cv_.notify_all();
+    if (thread_.joinable()) thread_.join();
+}
+
+bool ModelPrefetcher::read_into_page_cache(const std::string& path,
+                                           const std::atomic<bool>& stop,
+                                           std::atomic<uint64_t>& bytes_read,
+                                           uint64_t min_free_bytes) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    ::posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+
+    std::vector<char> buf(CHUNK_BYTES);
+    off_t offset = 0;
+    uint64_t since_check = 0;
+    bool complete = true;
+    while (true) {
+        if (stop.load(std::memory_order_relaxed)) {
+            complete = false;
+            break;
+        }
+        ssize_t n = ::pread(fd, buf.data(), buf.size(), offset);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            complete = false;
+            break;
+        }
+        if (n == 0) break;
+        offset += n;
+        bytes_read.fetch_add(static_cast<uint64_t>(n), std::memory_order_relaxed);
+        since_check += static_cast<uint64_t>(n);
+        if (min_free_bytes > 0 && since_check >= RAM_CHECK_BYTES) {
+            since_check = 0;
+            if (get_memory_info().system_free < min_free_bytes) {
+                complete = false;
+                break;
+            }
+        }
+    }
+    ::close(fd);
+    return complete;
+}
+
+nlohmann::json ModelPrefetcher::request(const std::string& label, const std::vector<std::string>& paths) {
+    Request req;
+    req.label = label;
+    for (const auto& p : paths) {
+        std::error_code ec;
+        auto size = fs::file_size(p, ec);
+        if (ec) continue;
+        req.paths.push_back(p);
+        req.bytes += size;
+    }
+
+    nlohmann::json result = {
+        {"model_name", label},
+        {"files", req.paths.size()},
+        {"bytes", req.bytes}
+    };
+
+    const uint64_t available = get_memory_info().system_free;
+    std::lock_guard<std::mutex> lock(mutex_);
+    requests_++;
+    if ((current_label_ == label && current_state_ == "reading") ||
+        (!queue_.empty() && queue_.front().label == label)) {
+        result["state"] = "already_queued";
+        return result;
+    }
+    if (available < req.bytes + min_free_bytes_) {
+        skipped_low_ram_++;
+        std::cout << "[ModelPrefetcher] Skipping " << label << ": " << format_bytes(req.bytes)
+                  << " would leave less than " << format_bytes(min_free_bytes_) << " of "
+                  << format_bytes(available) << " available" << std::endl;
+        result["state"] = "skipped_low_ram";
+        result["available_bytes"] = available;
+        return result;
+    }
+
+    queue_.clear();
+    queue_.push_back(std::move(req));
+    if (!thread_.joinable()) {
+        thread_ = std::thread(&ModelPrefetcher::worker_loop, this);
+    }
+    cv_.notify_one();
+    result["state"] = "queued";
+    return result;
+}
+
+void ModelPrefetcher::cancel() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queue_.clear();
+    }
+    cancel_ = true;
+}
+
+void ModelPrefetcher::worker_loop() {
+    while (true) {
+        Request req;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+            if (stopping_) return;
+            req = std::move(queue_.front());
+            queue_.pop_front();
+            cancel_ = false;
+            current_label_ = req.label;
+            current_state_ = "reading";
+            current_total_ = req.bytes;
+            current_ms_ = 0;
+            current_read_ = 0;
+        }
+        run(req);
+    }
+}
+
+void ModelPrefetcher::run(const Request& req) {
+    auto t0 = std::chrono::steady_clock::now();
+    std::cout << "[ModelPrefetcher] Reading ahead " << req.label << ": " << req.paths.size()
+              << " file(s), " << format_bytes(req.bytes) << std::endl;
+
+    // With the warm cache on, the mapped files also stay resident under its
+    // own budget and count as a hit on the load that follows
+    if (warm_cache_ && warm_cache_->enabled()) warm_cache_->retain(req.paths);
+
+    std::string state = "done";
+    for (const auto& path : req.paths) {
+        std::atomic<uint64_t> read{0};
+        bool ok = read_into_page_cache(path, cancel_, read, min_free_bytes_);
+        current_read_ += read.load();
+        bytes_read_total_ += read.load();
+        if (!ok) {
+            if (cancel_) {
+                state = "cancelled";
+            } else if (get_memory_info().system_free < min_free_bytes_) {
+                state = "stopped_low_ram";
+            } else {
+                state = "failed";
+            }
+            break;
+        }
+    }
+
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - t0).count();
+    std::cout << "[ModelPrefetcher] " << req.label << ": " << state << " after "
+              << format_bytes(current_read_.load()) << " in " << ms << " ms" << std::endl;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    current_state_ = state;
+    current_ms_ = ms;
+    if (state == "done") completed_++;
+    if (state == "stopped_low_ram") stopped_low_ram_++;
+}
+
+nlohmann::json ModelPrefetcher::stats_json() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    nlohmann::json j = {
+        {"min_free_bytes", min_free_bytes_},
+        {"requests", requests_},
+        {"completed", completed_},
+        {"skipped_low_ram", skipped_low_ram_},
+        {"stopped_low_ram", stopped_low_ram_},
+        {"bytes_read", bytes_read_total_.load()},
+        {"state", current_state_}
+    };
+    if (!current_label_.empty()) {
+        j["current"] = {
+            {"model_name", current_label_},
+            {"state", current_state_},
+            {"bytes", current_total_},
+            {"bytes_read", current_read_.load()},
+            {"ms", current_ms_}
+        };
+    }
+    return j;
+}
+
+} // namespace sdcpp
@@ -0,0 +1,371 @@
+#include "numa_placement.hpp"
+#include "memory_utils.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_set>
+
+#ifdef __linux__
+#include <linux/mempolicy.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace sdcpp {
+
+namespace {
+
+// Anonymous mappings below this are allocator arenas, not weight buffers
+constexpr uint64_t MIN_ANON_REGION = 32ull * 1024 * 1024;
+
+// "0-3,8-11" -> {0, 1, 2, 3, 8, 9, 10, 11}
+std::vector<int> parse_cpu_list(const std::string& list) {
+    std::vector<int> cpus;
+    std::stringstream ss(list);
+    std::string part;
+    while (std::getline(ss, part, ',')) {
+        if (part.empty() || part == "\n") continue;
+        try {
+            const auto dash = part.find('-');
+            const int first = std::stoi(part.substr(0, dash));
+            const int last = dash == std::string::npos ? first : std::stoi(part.substr(dash + 1));
+            for (int c = first; c <= last; ++c) cpus.push_back(c);
+        } catch (...) { /* malformed entry */ }
+    }
+    return cpus;
+}
+
+#ifdef __linux__
+std::string join_ids(const std::vector<int>& ids) {
+    std::string out;
+    for (int id : ids) out += (out.empty() ? "" : ",") + std::to_string(id);
+    return out;
+}
+
+int read_int_file(const fs::path& path) {
+    std::ifstream f(path);
+    int v = -1;
+    if (!(f >> v)) return -1;
+    return v;
+}
+
+// Nodes the policy applies to: numa.nodes, or every node
+std::vector<NumaPlacement::Node> policy_nodes(const NumaConfig& config) {
+    auto all = NumaPlacement::nodes();
+    if (config.nodes.empty()) return all;
+    std::vector<NumaPlacement::Node> out;
+    for (int id : config.nodes) {
+        auto it = std::find_if(all.begin(), all.end(), [id](const auto& n) { return n.id == id; });
+        if (it == all.end()) {
+            throw std::runtime_error("numa.nodes: NUMA node " + std::to_string(id) + " does not exist");
+        }
+        out.push_back(*it);
+    }
+    return out;
+}
+
+constexpr size_t BITS_PER_MASK_WORD = sizeof(unsigned long) * 8;
+
+struct NodeMask {
+    std::vector<unsigned long> words;
+    unsigned long maxnode() const { return words.size() * BITS_PER_MASK_WORD + 1; }
+};
+
+NodeMask node_mask(const std::vector<NumaPlacement::Node>& nodes) {
+    NodeMask mask;
+    for (const auto& n : nodes) {
+        const size_t word = static_cast<size_t>(n.id) / BITS_PER_MASK_WORD;
+        if (mask.words.size() <= word) mask.words.resize(word + 1, 0);
+        mask.words[word] |= 1ul << (static_cast<size_t>(n.id) % BITS_PER_MASK_WORD);
+    }
+    return mask;
+}
+
+int policy_mode(const std::string& policy) {
+    if (policy == "interleave") return MPOL_INTERLEAVE;
+    if (policy == "bind") return MPOL_BIND;
+    return MPOL_DEFAULT;
+}
+
+struct Mapping {
+    uintptr_t start = 0;
+    uintptr_t end = 0;
+    std::string perms;
+    std::string path;
+};
+
+std::vector<Mapping> read_maps() {
+    std::vector<Mapping> maps;
+    std::ifstream f("/proc/self/maps");
+    std::string line;
+    while (std::getline(f, line)) {
+        // start-end perms offset dev inode [path]
+        std::istringstream iss(line);
+        std::string range, offset, dev, inode;
+        Mapping m;
+        if (!(iss >> range >> m.perms >> offset >> dev >> inode)) continue;
+        const auto dash = range.find('-');
+        if (dash == std::string::npos) continue;
+        m.start = std::stoull(range.substr(0, dash), nullptr, 16);
+        m.end = std::stoull(range.substr(dash + 1), nullptr, 16);
+        std::getline(iss >> std::ws, m.path);
+        maps.push_back(std::move(m));
+    }
+    return maps;
+}
+#endif
+
+} // namespace
+
+NumaPlacement::NumaPlacement(NumaConfig config)
+    : config_(std::move(config)), cores_(physical_cores()) {}
+
+bool NumaPlacement::enabled() const {
+#ifdef __linux__
+    return config_.policy != "off" || config_.hugepages != "off" || config_.mlock;
+#else
+    return false;
+#endif
+}
+
+std::vector<NumaPlacement::Node> NumaPlacement::nodes() {
+    std::vector<Node> out;
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator("/sys/devices/system/node", ec)) {
+        const std::string name = entry.path().filename().string();
+        if (name.rfind("node", 0) != 0 || name.size() == 4) continue;
+        Node node;
+        try {
+            node.id = std::stoi(name.substr(4));
+        } catch (...) {
+            continue;
+        }
+        std::ifstream f(entry.path() / "cpulist");
+        std::string list;
+        std::getline(f, list);
+        node.cpus = parse_cpu_list(list);
+        out.push_back(std::move(node));
+    }
+    std::sort(out.begin(), out.end(), [](const Node& a, const Node& b) { return a.id < b.id; });
+    return out;
+}
+
+int NumaPlacement::physical_cores() {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) != 0) return 0;
+    std::set<std::pair<int, int>> cores;
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (!CPU_ISSET(cpu, &set)) continue;
+        const fs::path topo = fs::path("/sys/devices/system/cpu") / ("cpu" + std::to_string(cpu)) / "topology";
+        const int package = read_int_file(topo / "physical_package_id");
+        const int core = read_int_file(topo / "core_id");
+        if (core < 0) return 0;
+        cores.emplace(package, core);
+    }
+    return static_cast<int>(cores.size());
+#else
+    return 0;
+#endif
+}
+
+NumaPlacement::Snapshot NumaPlacement::snapshot() const {
+    Snapshot snap;
+#ifdef __linux__
+    if (!enabled()) return snap;
+    for (const auto& m : read_maps()) snap.emplace(m.start, m.end);
+#endif
+    return snap;
+}
+
+void NumaPlacement::place(const Snapshot& before, const std::vector<std::string>& files, bool mlock) {
+#ifdef __linux__
+    if (!enabled()) return;
+    const std::unordered_set<std::string> file_set(files.begin(), files.end());
+
+    std::vector<Mapping> ranges;
+    for (auto& m : read_maps()) {
+        if (before.count({m.start, m.end})) continue;
+        const bool anon = m.path.empty() && m.perms.rfind("rw", 0) == 0 &&
+                          m.end - m.start >= MIN_ANON_REGION;
+        if (anon || file_set.count(m.path)) ranges.push_back(std::move(m));
+    }
+
+    const int mode = policy_mode(config_.policy);
+    NodeMask mask;
+    if (mode != MPOL_DEFAULT) {
+        try {
+            mask = node_mask(policy_nodes(config_));
+        } catch (const std::exception& e) {
+            std::cerr << "[NumaPlacement] " << e.what() << std::endl;
+            return;
+        }
+    }
+
+    uint64_t bytes = 0, locked = 0;
+    size_t huge = 0;
+    bool move_failed = false, lock_failed = false;
+    for (const auto& r : ranges) {
+        void* addr = reinterpret_cast<void*>(r.start);
+        const size_t len = r.end - r.start;
+        bytes += len;
+        // Pages new_sd_ctx() touched before the policy could apply move
+        // over; only pages no other process maps are moved
+        if (mode != MPOL_DEFAULT && !mask.words.empty() &&
+            syscall(SYS_mbind, addr, len, mode, mask.words.data(), mask.maxnode(), MPOL_MF_MOVE) != 0 &&
+            !move_failed) {
+            move_failed = true;
+            std::cerr << "[NumaPlacement] mbind failed: " << std::strerror(errno) << std::endl;
+        }
+        if (config_.hugepages == "madvise") {
+            ::madvise(addr, len, MADV_HUGEPAGE);
+#ifdef MADV_COLLAPSE
+            // The buffers are already filled, so khugepaged would get to them
+            // late; collapse now (Linux 6.1+, otherwise EINVAL)
+            if (::madvise(addr, len, MADV_COLLAPSE) == 0) huge++;
+#endif
+        }
+        if (mlock) {
+            if (::mlock(addr, len) == 0) {
+                locked += len;
+            } else if (!lock_failed) {
+                lock_failed = true;
+                std::cerr << "[NumaPlacement] mlock failed (RLIMIT_MEMLOCK?): " << std::strerror(errno) << std::endl;
+            }
+        }
+    }
+
+    // Where the weights ended up: N<node>=<pages> of each placed range
+    std::map<int, uint64_t> by_node;
+    std::unordered_set<uintptr_t> starts;
+    for (const auto& r : ranges) starts.insert(r.start);
+    std::ifstream numa_maps("/proc/self/numa_maps");
+    std::string line;
+    while (!starts.empty() && std::getline(numa_maps, line)) {
+        std::istringstream iss(line);
+        std::string addr;
+        if (!(iss >> addr) || !starts.count(std::stoull(addr, nullptr, 16))) continue;
+        std::map<int, uint64_t> pages;
+        uint64_t page_kb = 4;
+        std::string tok;
+        while (iss >> tok) {
+            const auto eq = tok.find('=');
+            if (eq == std::string::npos) continue;
+            try {
+                if (tok[0] == 'N') {
+                    pages[std::stoi(tok.substr(1, eq - 1))] += std::stoull(tok.substr(eq + 1));
+                } else if (tok.rfind("kernelpagesize_kB=", 0) == 0) {
+                    page_kb = std::stoull(tok.substr(eq + 1));
+                }
+            } catch (...) { /* not a counter */ }
+        }
+        for (const auto& [node, n] : pages) by_node[node] += n * page_kb * 1024;
+    }
+
+    std::cout << "[NumaPlacement] Placed " << ranges.size() << " mappings (" << format_bytes(bytes) << ")";
+    if (mode != MPOL_DEFAULT) std::cout << ", policy " << config_.policy;
+    if (locked > 0) std::cout << ", " << format_bytes(locked) << " locked";
+    if (huge > 0) std::cout << ", " << huge << " collapsed to huge pages";
+    for (const auto& [node, b] : by_node) std::cout << ", node " << node << ": " << format_bytes(b);
+    std::cout << std::endl;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    regions_ = ranges.size();
+    bytes_ = bytes;
+    locked_bytes_ = locked;
+    huge_ranges_ = huge;
+    by_node_ = std::move(by_node);
+#else
+    (void)before;
+    (void)files;
+    (void)mlock;
+#endif
+}
+
+void NumaPlacement::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    regions_ = 0;
+    bytes_ = 0;
+    locked_bytes_ = 0;
+    huge_ranges_ = 0;
+    by_node_.clear();
+}
+
+nlohmann::json NumaPlacement::stats_json() const {
+    nlohmann::json by_node = nlohmann::json::object();
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& [node, b] : by_node_) by_node[std::to_string(node)] = b;
+    return {
+        {"policy", config_.policy},
+        {"nodes", config_.nodes},
+        {"pin_threads", config_.pin_threads},
+        {"hugepages", config_.hugepages},
+        {"physical_cores", cores_},
+        {"regions", regions_},
+        {"bytes", bytes_},
+        {"locked_bytes", locked_bytes_},
+        {"huge_ranges", huge_ranges_},
+        {"weights_by_node", by_node}
+    };
+}
+
+void apply_numa_process_policy(const NumaConfig& config) {
+#ifdef __linux__
+    if (config.policy == "off") return;
+    const auto nodes = policy_nodes(config);
+    if (nodes.empty()) {
+        std::cerr << "[NumaPlacement] No NUMA topology in /sys/devices/system/node, policy "
+                  << config.policy << " ignored" << std::endl;
+        return;
+    }
+    std::vector<int> ids;
+    for (const auto& n : nodes) ids.push_back(n.id);
+
+    const NodeMask mask = node_mask(nodes);
+    if (syscall(SYS_set_mempolicy, policy_mode(config.policy), mask.words.data(), mask.maxnode()) != 0) {
+        std::cerr << "[NumaPlacement] set_mempolicy failed: " << std::strerror(errno) << std::endl;
+    } else {
+        std::cout << "[NumaPlacement] Memory policy " << config.policy << " on nodes " << join_ids(ids) << std::endl;
+    }
+
+    if (config.policy == "bind" && config.pin_threads) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        size_t count = 0;
+        for (const auto& n : nodes) {
+            for (int cpu : n.cpus) {
+                if (cpu < CPU_SETSIZE) {
+                    CPU_SET(cpu, &set);
+                    count++;
+                }
+            }
+        }
+        if (count == 0) {
+            std::cerr << "[NumaPlacement] Nodes " << join_ids(ids) << " have no CPUs, threads not pinned" << std::endl;
+        } else if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+            std::cerr << "[NumaPlacement] sched_setaffinity failed: " << std::strerror(errno) << std::endl;
+        } else {
+            std::cout << "[NumaPlacement] Threads pinned to " << count << " CPUs of nodes " << join_ids(ids)
+                      << " (" << NumaPlacement::physical_cores() << " physical cores)" << std::endl;
+        }
+    }
+#else
+    if (config.policy != "off") {
+        std::cerr << "[NumaPlacement] NUMA placement is Linux-only, policy " << config.policy
+                  << " ignored" << std::endl;
+    }
+#endif
+}
+
+} // namespace sdcpp
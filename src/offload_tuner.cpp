@@ -0,0 +1,142 @@
+#include "offload_tuner.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+namespace fs = std::filesystem;
+
+namespace sdcpp {
+
+namespace {
+
+constexpr uint64_t GiB = 1024ull * 1024 * 1024;
+
+// max_vram budgets are tried in quarter GiB, never below half a GiB
+constexpr double BUDGET_STEP_GIB = 0.25;
+constexpr double MIN_BUDGET_GIB = 0.5;
+
+int round_up(int v, int multiple) {
+    return std::max(multiple, (v + multiple - 1) / multiple * multiple);
+}
+
+} // namespace
+
+nlohmann::json OffloadTuneTrial::to_json() const {
+    nlohmann::json j = {
+        {"options", options},
+        {"ok", ok},
+        {"load_ms", load_ms},
+        {"step_ms", step_ms},
+        {"total_ms", total_ms},
+        {"projected_ms", projected_ms}
+    };
+    if (!error.empty()) j["error"] = error;
+    return j;
+}
+
+std::string offload_tune_bucket(int width, int height) {
+    return std::to_string(round_up(width, 256)) + "x" + std::to_string(round_up(height, 256));
+}
+
+std::vector<nlohmann::json> offload_tune_candidates(uint64_t weight_bytes, uint64_t gpu_free_bytes,
+                                                    uint64_t compute_bytes) {
+    std::vector<nlohmann::json> out;
+    // The VRAM estimate errs high, so half of it is enough to rule out a
+    // fully resident load
+    const bool resident = weight_bytes + compute_bytes / 2 <= gpu_free_bytes;
+    const uint64_t usable = gpu_free_bytes > compute_bytes ? gpu_free_bytes - compute_bytes : 0;
+
+#if defined(SDCPP_EXPERIMENTAL_OFFLOAD) && !defined(SDCPP_UNIFIED_STREAMING)
+    auto mode = [](const char* offload_mode, int prefetch) {
+        return nlohmann::json{{"max_vram", 0.0}, {"offload_mode", offload_mode},
+                              {"streaming_prefetch_layers", prefetch}};
+    };
+    if (resident) out.push_back(mode("none", 1));
+    out.push_back(mode("cond_only", 1));
+    // Same per-layer guess as streaming_tune.sh: ~30 blocks of equal size
+    const uint64_t per_layer = std::max<uint64_t>(1, weight_bytes / 30);
+    for (int prefetch : {1, 4, 8}) {
+        if (prefetch > 1 && static_cast<uint64_t>(prefetch) * per_layer > usable) break;
+        out.push_back(mode("layer_streaming", prefetch));
+    }
+#else
+    if (resident) out.push_back({{"max_vram", 0.0}, {"stream_layers", false}});
+    bool first = true;
+    for (double fraction : {0.9, 0.7, 0.5}) {
+        double budget = std::floor(static_cast<double>(usable) * fraction / GiB / BUDGET_STEP_GIB) * BUDGET_STEP_GIB;
+        budget = std::max(budget, MIN_BUDGET_GIB);
+        if (budget * GiB >= static_cast<double>(weight_bytes)) continue;   // Would be fully resident anyway
+        nlohmann::json streamed = {{"max_vram", budget}, {"stream_layers", true}};
+        if (std::find(out.begin(), out.end(), streamed) != out.end()) continue;
+        out.push_back(streamed);
+        // Segmented offload without the prefetch, once: it wins on slow PCIe links
+        if (first) out.push_back({{"max_vram", budget}, {"stream_layers", false}});
+        first = false;
+    }
+    if (out.empty()) out.push_back({{"max_vram", 0.0}, {"stream_layers", false}});
+#endif
+    return out;
+}
+
+OffloadTuneCache::OffloadTuneCache(std::string cache_file)
+    : cache_file_(std::move(cache_file)) {
+    load();
+}
+
+std::string OffloadTuneCache::key(const std::string& model_hash, const std::string& gpu, const std::string& bucket) {
+    return model_hash + "|" + gpu + "|" + bucket;
+}
+
+std::optional<nlohmann::json> OffloadTuneCache::lookup(const std::string& key) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(key);
+    if (it == entries_.end()) return std::nullopt;
+    return *it;
+}
+
+void OffloadTuneCache::store(const std::string& key, nlohmann::json entry) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_[key] = std::move(entry);
+    save_locked();
+}
+
+nlohmann::json OffloadTuneCache::stats_json() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return {{"entries", entries_.size()}, {"file", cache_file_}};
+}
+
+void OffloadTuneCache::load() {
+    std::ifstream file(cache_file_);
+    if (!file) return;
+    try {
+        auto j = nlohmann::json::parse(file);
+        entries_ = j.value("entries", nlohmann::json::object());
+    } catch (const std::exception& e) {
+        std::cerr << "[OffloadTune] Ignoring unreadable " << cache_file_ << ": " << e.what() << std::endl;
+        entries_ = nlohmann::json::object();
+        return;
+    }
+    std::cout << "[OffloadTune] Loaded " << entries_.size() << " tuned configs from " << cache_file_ << std::endl;
+}
+
+void OffloadTuneCache::save_locked() {
+    const nlohmann::json j = {{"version", 1}, {"entries", entries_}};
+    const std::string tmp_path = cache_file_ + ".tmp";
+    {
+        std::ofstream file(tmp_path, std::ios::trunc);
+        if (!file || !(file << j.dump(2))) {
+            std::cerr << "[OffloadTune] Failed to write " << tmp_path << std::endl;
+            return;
+        }
+    }
+    std::error_code ec;
+    fs::rename(tmp_path, cache_file_, ec);
+    if (ec) {
+        std::cerr << "[OffloadTune] Failed to replace " << cache_file_ << ": " << ec.message() << std::endl;
+    }
+}
+
+} // namespace sdcpp
@@ -0,0 +1,221 @@
+#include "output_pipeline.hpp"
+#include "thumbnail_cache.hpp"
+#include "job_trace.hpp"
+
+#include <chrono>
+#include <iostream>
+
+namespace sdcpp {
+
+// ── OutputBatch ─────────────────────────────────────────────────────────────
+
+void OutputBatch::add(OutputImage&& image) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (sealed_) {
+            throw std::runtime_error("OutputBatch::add after finish");
+        }
+        added_++;
+    }
+    pipeline_->enqueue({std::move(image), shared_from_this()});
+}
+
+void OutputBatch::finish(CompletionFn on_done) {
+    Result result;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        sealed_ = true;
+        if (done_ < added_) {
+            on_done_ = std::move(on_done);
+            return;
+        }
+        result = result_;
+    }
+    if (on_done) on_done(result);
+}
+
+size_t OutputBatch::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return added_;
+}
+
+void OutputBatch::image_done(const std::string& output_ref, bool ok) {
+    CompletionFn callback;
+    Result result;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        done_++;
+        if (ok) {
+            result_.written++;
+        } else {
+            result_.failed_refs.push_back(output_ref);
+        }
+        if (!sealed_ || done_ < added_ || !on_done_) return;
+        callback = std::move(on_done_);
+        on_done_ = nullptr;
+        result = result_;
+    }
+    try {
+        callback(result);
+    } catch (const std::exception& e) {
+        std::cerr << "[OutputPipeline] Completion callback failed: " << e.what() << std::endl;
+    }
+}
+
+// ── OutputPipeline ──────────────────────────────────────────────────────────
+
+OutputPipeline::OutputPipeline(int threads, size_t max_pending_bytes)
+    : thread_count_(std::max(1, threads)),
+      max_pending_bytes_(max_pending_bytes) {}
+
+OutputPipeline::~OutputPipeline() {
+    stop();
+}
+
+void OutputPipeline::start() {
+    if (running_) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = false;
+    }
+    running_ = true;
+    for (int i = 0; i < thread_count_; ++i) {
+        threads_.emplace_back(&OutputPipeline::worker_loop, this);
+    }
+    std::cout << "[OutputPipeline] Started " << thread_count_ << " encoder thread(s), budget "
+              << (max_pending_bytes_ / (1024 * 1024)) << " MB" << std::endl;
+}
+
+void OutputPipeline::stop() {
+    if (!running_) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    work_cv_.notify_all();
+    for (auto& t : threads_) {
+        if (t.joinable()) t.join();
+    }
+    threads_.clear();
+    running_ = false;
+    space_cv_.notify_all();
+}
+
+std::shared_ptr<OutputBatch> OutputPipeline::begin_batch() {
+    return std::shared_ptr<OutputBatch>(new OutputBatch(this));
+}
+
+void OutputPipeline::enqueue(Task&& task) {
+    const size_t bytes = task.image.bytes();
+    bool inline_write = !running_;
+
+    if (!inline_write) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        auto t0 = std::chrono::steady_clock::now();
+        space_cv_.wait(lock, [&] {
+            return stopping_ || pending_bytes_ == 0 || pending_bytes_ + bytes <= max_pending_bytes_;
+        });
+        const auto waited_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - t0).count();
+        producer_wait_ms_total_ += static_cast<uint64_t>(waited_ms);
+        if (JobTrace* trace = JobTrace::current(); trace && waited_ms > 0) {
+            // The sampler was held up by the encoders
+            const int64_t now = JobTrace::now_us();
+            trace->complete("output_backpressure", "output", now - waited_ms * 1000, now);
+        }
+
+        // Workers exit once stopping and drained; don't queue behind them
+        inline_write = stopping_;
+        if (!inline_write) {
+            pending_bytes_ += bytes;
+            queue_.push_back(std::move(task));
+        }
+    }
+
+    if (inline_write) {
+        // Pipeline disabled or shutting down: write on the caller's thread
+        JobTrace::Span span(task.batch ? task.batch->trace_.get() : JobTrace::current(), "save_image", "output");
+        bool ok = write_one(task.image);
+        const std::string ref = task.image.output_ref;
+        task.image.pixels.reset();
+        if (task.batch) task.batch->image_done(ref, ok);
+        return;
+    }
+    work_cv_.notify_one();
+}
+
+bool OutputPipeline::write_one(const OutputImage& image) {
+    auto t0 = std::chrono::steady_clock::now();
+
+    bool ok = write_image_file(image.path, image.pixels.get(),
+                               image.width, image.height, image.channels, image.encode);
+
+    if (ok && image.thumbnail && thumbnails_cache_) {
+        // Every size /thumb/ can serve, from the pixels we already hold
+        // instead of decoding the file again on first view
+        try {
+            thumbnails_ += static_cast<uint64_t>(thumbnails_cache_->generate(
+                image.path, image.pixels.get(), image.width, image.height, image.channels));
+        } catch (const std::exception& e) {
+            std::cerr << "[OutputPipeline] Thumbnail for " << image.path << " failed: " << e.what() << std::endl;
+        }
+    }
+
+    encode_ms_total_ += static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - t0).count());
+    (ok ? written_ : failed_)++;
+    return ok;
+}
+
+void OutputPipeline::worker_loop() {
+    while (true) {
+        Task task;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            work_cv_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+            if (queue_.empty()) return;  // stopping and drained
+            task = std::move(queue_.front());
+            queue_.pop_front();
+        }
+
+        const size_t bytes = task.image.bytes();
+        const int64_t t0 = task.batch && task.batch->trace_ ? JobTrace::now_us() : 0;
+        bool ok = write_one(task.image);
+        const std::string ref = task.image.output_ref;
+        if (t0) task.batch->trace_->complete("save_image", "output", t0, JobTrace::now_us(), ref);
+        task.image.pixels.reset();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            pending_bytes_ -= bytes;
+        }
+        space_cv_.notify_all();
+
+        if (task.batch) {
+            task.batch->image_done(ref, ok);
+        }
+    }
+}
+
+nlohmann::json OutputPipeline::stats_json() const {
+    size_t queued, pending;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queued = queue_.size();
+        pending = pending_bytes_;
+    }
+    return {
+        {"enabled", running_.load()},
+        {"threads", thread_count_},
+        {"queued", queued},
+        {"pending_bytes", pending},
+        {"max_pending_bytes", max_pending_bytes_},
+        {"written", written_.load()},
+        {"failed", failed_.load()},
+        {"thumbnails", thumbnails_.load()},
+        {"encode_ms_total", encode_ms_total_.load()},
+        {"producer_wait_ms_total", producer_wait_ms_total_.load()}
+    };
+}
+
+} // namespace sdcpp
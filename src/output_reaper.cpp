@@ -0,0 +1,205 @@
+#include "output_reaper.hpp"
+#include "thumbnail_cache.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <iterator>
+#include <iostream>
+#include <set>
+
+#ifdef __linux__
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace sdcpp {
+
+namespace {
+
+// Let deletions yield to generation and HTTP I/O: lowest CPU priority and
+// the idle I/O class for the calling thread (Linux only; both are per
+// thread there)
+void lower_thread_priority() {
+#ifdef __linux__
+    const auto tid = static_cast<id_t>(syscall(SYS_gettid));
+    setpriority(PRIO_PROCESS, tid, 19);
+#ifdef SYS_ioprio_set
+    constexpr int IOPRIO_WHO_PROCESS = 1;
+    constexpr int IOPRIO_CLASS_IDLE = 3;
+    constexpr int IOPRIO_CLASS_SHIFT = 13;
+    syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT);
+#endif
+#endif
+}
+
+} // namespace
+
+OutputReaper::OutputReaper(std::string output_dir, Hooks hooks,
+                           std::chrono::seconds sweep_interval, int files_per_second)
+    : output_dir_(std::move(output_dir)),
+      hooks_(std::move(hooks)),
+      sweep_interval_(std::max(sweep_interval, std::chrono::seconds(1))),
+      files_per_second_(files_per_second) {}
+
+OutputReaper::~OutputReaper() {
+    stop();
+}
+
+void OutputReaper::start() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (thread_.joinable()) return;
+    stopping_ = false;
+    sweep_requested_ = true;    // startup purge
+    thread_ = std::thread(&OutputReaper::run, this);
+}
+
+void OutputReaper::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!thread_.joinable()) return;
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    thread_.join();
+}
+
+void OutputReaper::remove(std::vector<std::string> files) {
+    if (files.empty()) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& f : files) pending_.push_back(std::move(f));
+    }
+    cv_.notify_all();
+}
+
+void OutputReaper::wake() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        sweep_requested_ = true;
+    }
+    cv_.notify_all();
+}
+
+void OutputReaper::run() {
+    lower_thread_priority();
+
+    auto next_sweep = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopping_) {
+        cv_.wait_until(lock, next_sweep, [&] {
+            return stopping_ || sweep_requested_ || !pending_.empty();
+        });
+        if (stopping_) break;
+
+        if (sweep_requested_ || std::chrono::steady_clock::now() >= next_sweep) {
+            sweep_requested_ = false;
+            lock.unlock();
+            try {
+                if (hooks_.sweep) hooks_.sweep();
+            } catch (const std::exception& e) {
+                std::cerr << "[OutputReaper] Sweep failed: " << e.what() << std::endl;
+            }
+            sweeps_++;
+            lock.lock();
+            next_sweep = std::chrono::steady_clock::now() + sweep_interval_;
+            continue;
+        }
+
+        std::vector<std::string> batch;
+        while (!pending_.empty() && batch.size() < REMOVE_BATCH) {
+            batch.push_back(std::move(pending_.front()));
+            pending_.pop_front();
+        }
+        lock.unlock();
+        remove_batch(batch);
+        lock.lock();
+
+        // Rate limit: one batch's share of a second, cut short by stop()
+        if (files_per_second_ > 0) {
+            auto pause = std::chrono::milliseconds(1000 * static_cast<int64_t>(batch.size()) / files_per_second_);
+            cv_.wait_for(lock, pause, [&] { return stopping_; });
+        }
+    }
+
+    // Drain: these jobs are gone from the journal, nothing else would delete their files
+    std::vector<std::string> rest(std::make_move_iterator(pending_.begin()),
+                                  std::make_move_iterator(pending_.end()));
+    pending_.clear();
+    lock.unlock();
+    for (size_t i = 0; i < rest.size(); i += REMOVE_BATCH) {
+        std::vector<std::string> batch(rest.begin() + i, rest.begin() + std::min(rest.size(), i + REMOVE_BATCH));
+        remove_batch(batch);
+    }
+}
+
+void OutputReaper::remove_batch(const std::vector<std::string>& batch) {
+    if (batch.empty()) return;
+    const std::unordered_set<std::string> live =
+        hooks_.referenced ? hooks_.referenced(batch) : std::unordered_set<std::string>{};
+    const fs::path root(output_dir_);
+
+    // Deepest first, so a parent is tried after its children
+    std::set<fs::path, std::greater<>> dirs;
+    std::error_code ec;
+    for (const auto& ref : batch) {
+        const fs::path rel = fs::path(ref).lexically_normal();
+        if (ref.empty() || rel.is_absolute() || rel.empty() || *rel.begin() == "..") {
+            failed_++;
+            continue;
+        }
+        if (live.count(ref)) {
+            kept_++;
+            continue;
+        }
+
+        const fs::path path = root / rel;
+        const auto size = fs::file_size(path, ec);
+        if (!fs::remove(path, ec) || ec) {
+            if (ec) failed_++;
+            continue;
+        }
+        removed_++;
+        if (size != static_cast<std::uintmax_t>(-1)) bytes_freed_ += size;
+
+        if (thumbnail_cache_) {
+            for (const auto& thumb : thumbnail_cache_->thumbnail_files(path.string())) {
+                fs::remove(thumb, ec);
+            }
+            thumbnail_cache_->invalidate(path.string());
+            dirs.insert(path.parent_path() / ".thumbs");
+        }
+        fs::path dir = path.parent_path();
+        for (auto depth = std::distance(rel.begin(), rel.end()); depth > 1; --depth) {
+            dirs.insert(dir);
+            dir = dir.parent_path();
+        }
+    }
+
+    // fs::remove() only takes directories that are empty
+    for (const auto& dir : dirs) {
+        if (fs::remove(dir, ec) && !ec) dirs_removed_++;
+    }
+}
+
+nlohmann::json OutputReaper::stats_json() const {
+    size_t pending = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending = pending_.size();
+    }
+    return {
+        {"pending", pending},
+        {"removed", removed_.load()},
+        {"kept", kept_.load()},
+        {"failed", failed_.load()},
+        {"bytes_freed", bytes_freed_.load()},
+        {"dirs_removed", dirs_removed_.load()},
+        {"sweeps", sweeps_.load()},
+        {"files_per_second", files_per_second_}
+    };
+}
+
+} // namespace sdcpp
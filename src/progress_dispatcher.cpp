@@ -0,0 +1,168 @@
+#include "progress_dispatcher.hpp"
+#include "websocket_server.hpp"
+
+#include <iostream>
+
+namespace sdcpp {
+
+ProgressDispatcher::ProgressDispatcher(Hooks hooks,
+                                       std::chrono::milliseconds progress_interval,
+                                       std::chrono::milliseconds preview_interval)
+    : hooks_(std::move(hooks)),
+      progress_interval_(progress_interval),
+      preview_interval_(preview_interval) {}
+
+ProgressDispatcher::~ProgressDispatcher() {
+    stop();
+}
+
+ProgressDispatcher::Ring* ProgressDispatcher::add_producer() {
+    std::lock_guard<std::mutex> lock(producers_mutex_);
+    rings_.push_back(std::make_unique<Ring>());
+    return rings_.back().get();
+}
+
+void ProgressDispatcher::start() {
+    if (running_) return;
+    running_ = true;
+    thread_ = std::thread(&ProgressDispatcher::dispatch_loop, this);
+}
+
+void ProgressDispatcher::stop() {
+    if (!running_) return;
+    running_ = false;
+    wake_seq_.fetch_add(1, std::memory_order_release);
+    wake_seq_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+bool ProgressDispatcher::publish(Ring* ring, ProgressEvent&& event) {
+    if (!ring || !ring->try_push(std::move(event))) {
+        dropped_++;
+        return false;
+    }
+    published_++;
+    wake_seq_.fetch_add(1, std::memory_order_release);
+    wake_seq_.notify_one();
+    return true;
+}
+
+nlohmann::json ProgressDispatcher::stats_json() const {
+    return {
+        {"published", published_.load()},
+        {"dropped", dropped_.load()},
+        {"coalesced", coalesced_.load()},
+        {"broadcasts", broadcasts_.load()}
+    };
+}
+
+void ProgressDispatcher::dispatch_loop() {
+    while (running_) {
+        const uint32_t seen = wake_seq_.load(std::memory_order_acquire);
+
+        drain_rings();
+        auto next = flush_due();
+
+        if (!running_) break;
+        if (next) {
+            // Something is held back by the throttle; come back when it is due
+            std::this_thread::sleep_until(*next);
+        } else {
+            wake_seq_.wait(seen, std::memory_order_acquire);
+        }
+    }
+    jobs_.clear();
+}
+
+void ProgressDispatcher::drain_rings() {
+    std::lock_guard<std::mutex> lock(producers_mutex_);
+    for (auto& ring : rings_) {
+        ProgressEvent ev;
+        while (ring->try_pop(ev)) {
+            if (ev.job_id.empty()) continue;
+
+            JobState& state = jobs_[ev.job_id];
+            if (ev.kind == ProgressEvent::Kind::Preview) {
+                if (!ev.jpeg || ev.jpeg->empty()) continue;
+                // Keep the HTTP preview current even when the WS send is throttled
+                if (hooks_.store_preview && (!hooks_.is_running || hooks_.is_running(ev.job_id))) {
+                    hooks_.store_preview(ev);
+                }
+                if (state.preview) coalesced_++;
+                state.preview = std::move(ev);
+            } else {
+                if (state.progress) coalesced_++;
+                state.progress = std::move(ev);
+            }
+        }
+    }
+}
+
+std::optional<std::chrono::steady_clock::time_point> ProgressDispatcher::flush_due() {
+    std::optional<std::chrono::steady_clock::time_point> next;
+    auto defer = [&next](std::chrono::steady_clock::time_point t) {
+        if (!next || t < *next) next = t;
+    };
+
+    auto* ws = get_websocket_server();
+    const auto now = std::chrono::steady_clock::now();
+
+    for (auto it = jobs_.begin(); it != jobs_.end();) {
+        const std::string& job_id = it->first;
+        JobState& state = it->second;
+
+        if (hooks_.is_running && !hooks_.is_running(job_id)) {
+            it = jobs_.erase(it);
+            continue;
+        }
+
+        if (state.progress) {
+            if (now - state.last_progress_sent >= progress_interval_) {
+                const nlohmann::json progress = {
+                    {"job_id", job_id},
+                    {"step", state.progress->step},
+                    {"total_steps", state.progress->total_steps}
+                };
+                if (ws) {
+                    ws->broadcast(WSEventType::JobProgress, progress);
+                    broadcasts_++;
+                }
+                if (hooks_.publish_progress) hooks_.publish_progress(progress);
+                state.last_progress_sent = now;
+                state.progress.reset();
+            } else {
+                defer(state.last_progress_sent + progress_interval_);
+            }
+        }
+
+        if (state.preview) {
+            if (now - state.last_preview_sent >= preview_interval_) {
+                // JSON URL notification, or the JPEG inline for binary subscribers
+                if (ws) {
+                    const ProgressEvent& p = *state.preview;
+                    ws->broadcast_preview({
+                        {"job_id", job_id},
+                        {"step", p.step},
+                        {"frame_count", p.frame_count},
+                        {"width", p.width},
+                        {"height", p.height},
+                        {"is_noisy", p.is_noisy},
+                        {"preview_url", "/jobs/" + job_id + "/preview"}
+                    }, p.jpeg);
+                    broadcasts_++;
+                }
+                state.last_preview_sent = now;
+                state.preview.reset();
+            } else {
+                defer(state.last_preview_sent + preview_interval_);
+            }
+        }
+
+        ++it;
+    }
+    return next;
+}
+
+} // namespace sdcpp
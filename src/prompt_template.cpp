@@ -315,6 +315,75 @@ size_t count_atom(const Atom& atom) {
     return total;
 }
 
+// Random access variant — the index-th string expand_* would produce, in
+// the same order: later atoms (and later pick-N slots) vary fastest.
+std::string atom_at(const Atom& atom, size_t index);
+
+std::string sequence_at(const Sequence& seq, size_t index) {
+    std::vector<std::string> frags(seq.size());
+    for (size_t k = seq.size(); k-- > 0;) {
+        size_t n = count_atom(seq[k]);
+        frags[k] = atom_at(seq[k], index % n);
+        index /= n;
+    }
+    std::string out;
+    for (auto& f : frags) out += f;
+    return out;
+}
+
+std::string atom_at(const Atom& atom, size_t index) {
+    if (atom.is_literal) return atom.literal;
+    const Group& g = atom.group;
+
+    if (g.pick_n == 1) {
+        for (const auto& opt : g.options) {
+            size_t n = count_sequence(opt);
+            if (index < n) return sequence_at(opt, index);
+            index -= n;
+        }
+        return {};
+    }
+
+    const int N = g.pick_n;
+    const int K = static_cast<int>(g.options.size());
+
+    std::vector<size_t> per_option;
+    per_option.reserve(g.options.size());
+    for (const auto& opt : g.options) {
+        per_option.push_back(count_sequence(opt));
+    }
+
+    std::vector<int> indices(N);
+    for (int i = 0; i < N; ++i) indices[i] = i;
+    while (true) {
+        size_t product = 1;
+        for (int slot = 0; slot < N; ++slot) product *= per_option[indices[slot]];
+
+        if (index < product) {
+            std::vector<std::string> parts(N);
+            for (int slot = N; slot-- > 0;) {
+                size_t n = per_option[indices[slot]];
+                parts[slot] = sequence_at(g.options[indices[slot]], index % n);
+                index /= n;
+            }
+            std::string out;
+            for (int slot = 0; slot < N; ++slot) {
+                if (slot > 0) out += ", ";
+                out += parts[slot];
+            }
+            return out;
+        }
+        index -= product;
+
+        int i = N - 1;
+        while (i >= 0 && indices[i] == K - N + i) --i;
+        if (i < 0) break;
+        ++indices[i];
+        for (int j = i + 1; j < N; ++j) indices[j] = indices[j - 1] + 1;
+    }
+    return {};
+}
+
 // Stable dedup that preserves first-seen order.
 void stable_dedup(std::vector<std::string>& v) {
     std::set<std::string> seen;
@@ -352,4 +421,30 @@ size_t count_prompt_variations(const std::string& templated) {
     // modal is a ceiling, the actual job count uses expand().size().
 }
 
+struct PromptTemplateCursor::Impl {
+    Sequence top;
+};
+
+PromptTemplateCursor::PromptTemplateCursor(const std::string& templated) {
+    auto impl = std::make_shared<Impl>();
+    if (templated.find('{') == std::string::npos) {
+        Atom a;
+        a.literal = templated;
+        impl->top.push_back(std::move(a));
+    } else {
+        Parser p(templated);
+        impl->top = p.parse_top();
+    }
+    size_ = count_sequence(impl->top);
+    impl_ = std::move(impl);
+}
+
+std::string PromptTemplateCursor::at(size_t index) const {
+    if (index >= size_) {
+        throw std::runtime_error("Prompt template: variation " + std::to_string(index)
+                                 + " out of range (" + std::to_string(size_) + ")");
+    }
+    return sequence_at(impl_->top, index);
+}
+
 } // namespace sdcpp
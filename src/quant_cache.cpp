@@ -0,0 +1,174 @@
+#include "quant_cache.hpp"
+#include "utils.hpp"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+namespace fs = std::filesystem;
+
+namespace sdcpp {
+
+namespace {
+
+// FNV-1a: names the tensor_type_rules variant of an artifact
+std::string short_hash(const std::string& s) {
+    uint32_t h = 2166136261u;
+    for (unsigned char c : s) {
+        h ^= c;
+        h *= 16777619u;
+    }
+    char buf[9];
+    std::snprintf(buf, sizeof(buf), "%08x", h);
+    return buf;
+}
+
+} // namespace
+
+QuantCache::QuantCache(QuantCacheConfig config, std::string index_file, std::string dir)
+    : config_(std::move(config)),
+      index_file_(std::move(index_file)),
+      dir_(std::move(dir)),
+      rules_tag_(config_.tensor_type_rules.empty() ? "" : short_hash(config_.tensor_type_rules)) {
+    if (config_.enabled) load();
+}
+
+std::string QuantCache::target_type(uint64_t vram_bytes) const {
+    if (config_.vram_classes.empty()) return "";
+    if (vram_bytes == 0) return config_.vram_classes.front().weight_type;
+    for (const auto& c : config_.vram_classes) {
+        if (vram_bytes <= static_cast<uint64_t>(c.max_vram_mb) * 1024 * 1024) return c.weight_type;
+    }
+    return "";
+}
+
+std::string QuantCache::key(const std::string& source_hash, const std::string& weight_type) const {
+    return source_hash + "|" + weight_type + "|" + rules_tag_;
+}
+
+void QuantCache::record_load(const std::string& source_path, const std::string& name, const std::string& hash) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& s = sources_[source_path];
+    s["name"] = name;
+    if (!hash.empty()) s["hash"] = hash;
+    s["loads"] = s.value("loads", uint64_t{0}) + 1;
+    s["last_load"] = utils::time_to_string(utils::get_time_now());
+    save_locked();
+}
+
+std::string QuantCache::lookup(const std::string& source_hash, const std::string& weight_type) {
+    if (source_hash.empty() || weight_type.empty()) return "";
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = artifacts_.find(key(source_hash, weight_type));
+    if (it == artifacts_.end()) return "";
+    const std::string path = it->value("path", "");
+    std::error_code ec;
+    if (path.empty() || !fs::is_regular_file(path, ec)) {
+        std::cerr << "[QuantCache] Dropping missing artifact " << path << std::endl;
+        artifacts_.erase(it);
+        save_locked();
+        return "";
+    }
+    hits_++;
+    return path;
+}
+
+std::optional<QuantCache::Candidate> QuantCache::next_candidate(const std::string& weight_type) const {
+    if (weight_type.empty()) return std::nullopt;
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::optional<Candidate> best;
+    for (const auto& [path, s] : sources_.items()) {
+        const uint64_t loads = s.value("loads", uint64_t{0});
+        if (loads < static_cast<uint64_t>(config_.min_loads)) continue;
+        if (best && loads <= best->loads) continue;
+        const std::string hash = s.value("hash", "");
+        if (!hash.empty() && artifacts_.contains(key(hash, weight_type))) continue;
+        if (failed_.contains(path + "|" + weight_type)) continue;
+        std::error_code ec;
+        if (!fs::is_regular_file(path, ec)) continue;
+        best = Candidate{path, s.value("name", ""), loads};
+    }
+    return best;
+}
+
+std::string QuantCache::artifact_path(const std::string& source_hash, const std::string& weight_type) const {
+    std::string name = source_hash.substr(0, 16) + "-" + weight_type;
+    if (!rules_tag_.empty()) name += "-r" + rules_tag_;
+    return (fs::path(dir_) / (name + ".gguf")).string();
+}
+
+void QuantCache::store(const std::string& source_path, const std::string& source_hash,
+                       const std::string& weight_type, const std::string& artifact) {
+    std::error_code ec;
+    const auto bytes = fs::file_size(artifact, ec);
+    std::lock_guard<std::mutex> lock(mutex_);
+    artifacts_[key(source_hash, weight_type)] = {
+        {"path", artifact},
+        {"source", source_path},
+        {"weight_type", weight_type},
+        {"bytes", ec ? 0 : static_cast<uint64_t>(bytes)},
+        {"created_at", utils::time_to_string(utils::get_time_now())}
+    };
+    sources_[source_path]["hash"] = source_hash;
+    conversions_++;
+    save_locked();
+}
+
+void QuantCache::mark_failed(const std::string& source_path, const std::string& weight_type,
+                             const std::string& error) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    failed_[source_path + "|" + weight_type] = error;
+}
+
+nlohmann::json QuantCache::stats_json() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint64_t bytes = 0;
+    for (const auto& [k, a] : artifacts_.items()) bytes += a.value("bytes", uint64_t{0});
+    return {
+        {"enabled", config_.enabled},
+        {"dir", dir_},
+        {"sources", sources_.size()},
+        {"artifacts", artifacts_.size()},
+        {"bytes", bytes},
+        {"hits", hits_},
+        {"conversions", conversions_},
+        {"failures", failed_}
+    };
+}
+
+void QuantCache::load() {
+    std::ifstream file(index_file_);
+    if (!file) return;
+    try {
+        auto j = nlohmann::json::parse(file);
+        sources_ = j.value("sources", nlohmann::json::object());
+        artifacts_ = j.value("artifacts", nlohmann::json::object());
+    } catch (const std::exception& e) {
+        std::cerr << "[QuantCache] Ignoring unreadable " << index_file_ << ": " << e.what() << std::endl;
+        sources_ = nlohmann::json::object();
+        artifacts_ = nlohmann::json::object();
+        return;
+    }
+    std::cout << "[QuantCache] Loaded " << artifacts_.size() << " quantized models and "
+              << sources_.size() << " load counts from " << index_file_ << std::endl;
+}
+
+void QuantCache::save_locked() {
+    const nlohmann::json j = {{"version", 1}, {"sources", sources_}, {"artifacts", artifacts_}};
+    const std::string tmp_path = index_file_ + ".tmp";
+    {
+        std::ofstream file(tmp_path, std::ios::trunc);
+        if (!file || !(file << j.dump(2))) {
+            std::cerr << "[QuantCache] Failed to write " << tmp_path << std::endl;
+            return;
+        }
+    }
+    std::error_code ec;
+    fs::rename(tmp_path, index_file_, ec);
+    if (ec) {
+        std::cerr << "[QuantCache] Failed to replace " << index_file_ << ": " << ec.message() << std::endl;
+    }
+}
+
+} // namespace sdcpp
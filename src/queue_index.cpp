@@ -0,0 +1,309 @@
+#include "queue_index.hpp"
+#include "queue_manager.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <iterator>
+
+namespace sdcpp {
+
+namespace {
+
+std::string to_lower(const std::string& s) {
+    std::string out = s;
+    std::transform(out.begin(), out.end(), out.begin(),
+        [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return out;
+}
+
+// Bytes >= 0x80 count as token characters so UTF-8 words stay whole
+bool is_token_char(unsigned char c) {
+    return std::isalnum(c) || c >= 0x80;
+}
+
+struct TokenSpan {
+    size_t begin;
+    size_t end;
+};
+
+std::vector<TokenSpan> token_spans(const std::string& s) {
+    std::vector<TokenSpan> spans;
+    size_t i = 0;
+    while (i < s.size()) {
+        while (i < s.size() && !is_token_char(static_cast<unsigned char>(s[i]))) ++i;
+        size_t start = i;
+        while (i < s.size() && is_token_char(static_cast<unsigned char>(s[i]))) ++i;
+        if (i > start) spans.push_back({start, i});
+    }
+    return spans;
+}
+
+void add_tokens(const std::string& s, std::vector<std::string>& out) {
+    for (const auto& span : token_spans(s)) {
+        out.push_back(s.substr(span.begin, span.end - span.begin));
+    }
+}
+
+std::string lowered_string_field(const nlohmann::json& j, const char* key) {
+    if (j.is_object() && j.contains(key) && j[key].is_string()) {
+        return to_lower(j[key].get<std::string>());
+    }
+    return "";
+}
+
+bool ends_with(const std::string& s, const std::string& suffix) {
+    return s.size() >= suffix.size() &&
+           s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+bool starts_with(const std::string& s, const std::string& prefix) {
+    return s.compare(0, prefix.size(), prefix) == 0;
+}
+
+} // namespace
+
+void QueueIndex::upsert(const QueueItem& item) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    erase_locked(item.job_id);
+
+    Entry e;
+    e.key = Key{item.created_at, item.job_id};
+    e.status = item.status;
+    e.type = item.type;
+    e.priority = item.priority;
+    e.model = lowered_string_field(item.settings(), "model_name");
+    e.arch = lowered_string_field(item.settings(), "model_architecture");
+    e.prompt = lowered_string_field(item.params, "prompt");
+    e.negative = lowered_string_field(item.params, "negative_prompt");
+    e.job_id = to_lower(item.job_id);
+
+    add_tokens(e.prompt, e.tokens);
+    add_tokens(e.negative, e.tokens);
+    add_tokens(e.job_id, e.tokens);
+    std::sort(e.tokens.begin(), e.tokens.end());
+    e.tokens.erase(std::unique(e.tokens.begin(), e.tokens.end()), e.tokens.end());
+
+    if (e.status != QueueStatus::Deleted) live_.insert(e.key);
+    by_status_[e.status].insert(e.key);
+    by_type_[e.type].insert(e.key);
+    by_priority_[{e.status, e.priority}]++;
+    if (!e.model.empty()) by_model_[e.model].insert(e.key);
+    if (!e.arch.empty()) by_arch_[e.arch].insert(e.key);
+    for (const auto& tok : e.tokens) {
+        postings_[tok].insert(item.job_id);
+    }
+
+    entries_.emplace(item.job_id, std::move(e));
+}
+
+void QueueIndex::erase(const std::string& job_id) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    erase_locked(job_id);
+}
+
+void QueueIndex::clear() {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    entries_.clear();
+    live_.clear();
+    by_status_.clear();
+    by_type_.clear();
+    by_priority_.clear();
+    by_model_.clear();
+    by_arch_.clear();
+    postings_.clear();
+}
+
+size_t QueueIndex::count(QueueStatus status) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    auto it = by_status_.find(status);
+    return it != by_status_.end() ? it->second.size() : 0;
+}
+
+size_t QueueIndex::count(QueueStatus status, JobPriority priority) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    auto it = by_priority_.find({status, priority});
+    return it != by_priority_.end() ? it->second : 0;
+}
+
+size_t QueueIndex::size() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return entries_.size();
+}
+
+void QueueIndex::erase_locked(const std::string& job_id) {
+    auto it = entries_.find(job_id);
+    if (it == entries_.end()) return;
+    const Entry& e = it->second;
+
+    auto drop = [&e](auto& index, const auto& bucket) {
+        auto b = index.find(bucket);
+        if (b == index.end()) return;
+        b->second.erase(e.key);
+        if (b->second.empty()) index.erase(b);
+    };
+
+    live_.erase(e.key);
+    drop(by_status_, e.status);
+    drop(by_type_, e.type);
+    auto p = by_priority_.find({e.status, e.priority});
+    if (p != by_priority_.end() && --p->second == 0) by_priority_.erase(p);
+    if (!e.model.empty()) drop(by_model_, e.model);
+    if (!e.arch.empty()) drop(by_arch_, e.arch);
+    for (const auto& tok : e.tokens) {
+        auto p = postings_.find(tok);
+        if (p == postings_.end()) continue;
+        p->second.erase(job_id);
+        if (p->second.empty()) postings_.erase(p);
+    }
+
+    entries_.erase(it);
+}
+
+bool QueueIndex::search_candidates_locked(const std::string& query_lc,
+                                          std::unordered_set<std::string>& out) const {
+    const auto spans = token_spans(query_lc);
+    if (spans.empty()) return false;
+
+    out.clear();
+    for (size_t i = 0; i < spans.size(); ++i) {
+        const std::string tok = query_lc.substr(spans[i].begin, spans[i].end - spans[i].begin);
+
+        // A query token touching the query's edge may be the tail/head of a
+        // longer token in the text; anything bounded by separators must be a
+        // whole token there too.
+        const bool open_left = (i == 0 && spans[i].begin == 0);
+        const bool open_right = (i == spans.size() - 1 && spans[i].end == query_lc.size());
+
+        std::unordered_set<std::string> matched;
+        auto collect = [&matched](const std::unordered_set<std::string>& ids) {
+            matched.insert(ids.begin(), ids.end());
+        };
+
+        if (!open_left && !open_right) {
+            auto p = postings_.find(tok);
+            if (p != postings_.end()) collect(p->second);
+        } else {
+            for (const auto& [vocab, ids] : postings_) {
+                bool ok;
+                if (open_left && open_right) {
+                    ok = vocab.find(tok) != std::string::npos;
+                } else if (open_left) {
+                    ok = ends_with(vocab, tok);
+                } else {
+                    ok = starts_with(vocab, tok);
+                }
+                if (ok) collect(ids);
+            }
+        }
+
+        if (i == 0) {
+            out = std::move(matched);
+        } else {
+            for (auto it = out.begin(); it != out.end();) {
+                it = matched.count(*it) ? std::next(it) : out.erase(it);
+            }
+        }
+        if (out.empty()) break;
+    }
+    return true;
+}
+
+bool QueueIndex::matches_locked(const Entry& e, const QueueFilter& filter, const Needles& needles,
+                                const std::unordered_set<std::string>* candidates) const {
+    // Same rules as QueueFilter::matches(), over the projection
+    if (e.status == QueueStatus::Deleted &&
+        (!filter.status.has_value() || filter.status.value() != QueueStatus::Deleted)) {
+        return false;
+    }
+    if (filter.status.has_value() && e.status != filter.status.value()) return false;
+    if (filter.type.has_value() && e.type != filter.type.value()) return false;
+
+    if (!needles.search.empty()) {
+        if (candidates && !candidates->count(e.key.second)) return false;
+        if (e.prompt.find(needles.search) == std::string::npos &&
+            e.negative.find(needles.search) == std::string::npos &&
+            e.job_id.find(needles.search) == std::string::npos) {
+            return false;
+        }
+    }
+    if (!needles.arch.empty() && e.arch.find(needles.arch) == std::string::npos) return false;
+    if (!needles.model.empty() && e.model.find(needles.model) == std::string::npos) return false;
+
+    return true;
+}
+
+void QueueIndex::for_each_match(
+    const QueueFilter& filter,
+    const std::function<bool(const std::string& job_id, Clock::time_point created_at)>& visit) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+
+    Needles needles;
+    if (filter.search.has_value()) needles.search = to_lower(filter.search.value());
+    if (filter.model.has_value()) needles.model = to_lower(filter.model.value());
+    if (filter.architecture.has_value()) needles.arch = to_lower(filter.architecture.value());
+
+    std::unordered_set<std::string> candidates;
+    const std::unordered_set<std::string>* candidate_ptr = nullptr;
+    if (!needles.search.empty() && search_candidates_locked(needles.search, candidates)) {
+        if (candidates.empty()) return;
+        candidate_ptr = &candidates;
+    }
+
+    // Drive the walk from the smallest ordered set that covers the filter;
+    // the remaining conditions are checked on each projection.
+    static const std::set<Key> kEmpty;
+    const std::set<Key>* driver = &live_;
+    if (filter.status.has_value()) {
+        auto it = by_status_.find(filter.status.value());
+        driver = it != by_status_.end() ? &it->second : &kEmpty;
+    }
+    auto consider = [&driver](const std::set<Key>& s) {
+        if (s.size() < driver->size()) driver = &s;
+    };
+    if (filter.type.has_value()) {
+        auto it = by_type_.find(filter.type.value());
+        if (it == by_type_.end()) return;
+        consider(it->second);
+    }
+    // Model/architecture filters are partial matches: scan the distinct
+    // values, and drive from the bucket when only one of them matches.
+    auto narrow_by_value = [&consider](const std::map<std::string, std::set<Key>>& index,
+                                       const std::string& needle) {
+        const std::set<Key>* only = nullptr;
+        size_t hits = 0;
+        for (const auto& [value, keys] : index) {
+            if (value.find(needle) == std::string::npos) continue;
+            only = &keys;
+            hits++;
+        }
+        if (hits == 1) consider(*only);
+        return hits > 0;
+    };
+    if (!needles.model.empty() && !narrow_by_value(by_model_, needles.model)) return;
+    if (!needles.arch.empty() && !narrow_by_value(by_arch_, needles.arch)) return;
+
+    // Date bounds (seconds): created < before, created > after
+    if (filter.before_timestamp.has_value() && filter.after_timestamp.has_value() &&
+        filter.after_timestamp.value() + 1 >= filter.before_timestamp.value()) {
+        return;
+    }
+    auto first = driver->begin();
+    auto last = driver->end();
+    if (filter.after_timestamp.has_value()) {
+        first = driver->lower_bound(Key{
+            Clock::time_point(std::chrono::seconds(filter.after_timestamp.value() + 1)), std::string()});
+    }
+    if (filter.before_timestamp.has_value()) {
+        last = driver->lower_bound(Key{
+            Clock::time_point(std::chrono::seconds(filter.before_timestamp.value())), std::string()});
+    }
+
+    for (auto it = std::make_reverse_iterator(last); it != std::make_reverse_iterator(first); ++it) {
+        auto e = entries_.find(it->second);
+        if (e == entries_.end()) continue;
+        if (!matches_locked(e->second, filter, needles, candidate_ptr)) continue;
+        if (!visit(it->second, it->first)) break;
+    }
+}
+
+} // namespace sdcpp
@@ -0,0 +1,291 @@
+#include "queue_journal.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+namespace sdcpp {
+
+QueueJournal::QueueJournal(const std::string& snapshot_path, size_t compact_after)
+    : snapshot_path_(snapshot_path),
+      journal_path_(snapshot_path + ".journal"),
+      compact_after_(compact_after > 0 ? compact_after : 1) {}
+
+QueueJournal::~QueueJournal() {
+    stop();
+    if (journal_) {
+        std::fclose(journal_);
+        journal_ = nullptr;
+    }
+}
+
+std::vector<nlohmann::json> QueueJournal::load() {
+    mirror_.clear();
+    // Parsed state while replaying; the mirror only keeps the dumps
+    std::map<std::string, nlohmann::json> state_items;
+
+    // Snapshot
+    if (fs::exists(snapshot_path_)) {
+        try {
+            std::ifstream file(snapshot_path_);
+            nlohmann::json state;
+            file >> state;
+            if (state.contains("items")) {
+                for (auto& j : state["items"]) {
+                    std::string id = j.value("job_id", "");
+                    if (!id.empty()) state_items[id] = std::move(j);
+                }
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "[QueueJournal] Failed to read snapshot " << snapshot_path_
+                      << ": " << e.what() << std::endl;
+        }
+    }
+
+    // Journal tail
+    size_t replayed = 0;
+    if (fs::exists(journal_path_)) {
+        std::ifstream file(journal_path_);
+        std::string line;
+        while (std::getline(file, line)) {
+            if (line.empty()) continue;
+            nlohmann::json rec;
+            try {
+                rec = nlohmann::json::parse(line);
+            } catch (const std::exception&) {
+                // Torn write from a crash — everything after it is suspect
+                std::cerr << "[QueueJournal] Ignoring truncated journal record after "
+                          << replayed << " records" << std::endl;
+                break;
+            }
+            Record r;
+            r.erase = rec.value("op", "") == "del";
+            if (r.erase) {
+                r.job_id = rec.value("job_id", "");
+            } else if (rec.contains("item")) {
+                r.item = std::move(rec["item"]);
+                r.job_id = r.item.value("job_id", "");
+            }
+            if (r.job_id.empty()) continue;
+            if (r.erase) {
+                state_items.erase(r.job_id);
+            } else {
+                state_items[r.job_id] = std::move(r.item);
+            }
+            replayed++;
+        }
+    }
+
+    if (replayed > 0) {
+        std::cout << "[QueueJournal] Replayed " << replayed << " journal records" << std::endl;
+    }
+
+    std::vector<nlohmann::json> items;
+    items.reserve(state_items.size());
+    for (auto& [id, j] : state_items) {
+        mirror_[id] = j.dump();
+        items.push_back(std::move(j));
+    }
+
+    // Fold the replayed tail into a fresh snapshot so the next start only
+    // replays what happens from here on
+    compact();
+    return items;
+}
+
+void QueueJournal::start() {
+    if (running_) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_requested_ = false;
+    }
+    if (!journal_ && !open_journal(false)) {
+        std::cerr << "[QueueJournal] Failed to open journal " << journal_path_ << std::endl;
+    }
+    running_ = true;
+    writer_ = std::thread(&QueueJournal::writer_loop, this);
+}
+
+void QueueJournal::stop() {
+    if (!running_) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_requested_ = true;
+    }
+    cv_.notify_all();
+    if (writer_.joinable()) {
+        writer_.join();
+    }
+    running_ = false;
+    drained_cv_.notify_all();
+
+    // Anything enqueued while the writer was exiting
+    std::vector<Record> rest;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        rest.swap(pending_);
+    }
+    for (const auto& r : rest) {
+        apply_to_mirror(r);
+    }
+    compact();
+}
+
+void QueueJournal::put(const std::string& job_id, nlohmann::json item) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_.push_back(Record{false, job_id, std::move(item)});
+        enqueued_seq_++;
+    }
+    cv_.notify_one();
+}
+
+void QueueJournal::erase(const std::string& job_id) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_.push_back(Record{true, job_id, nullptr});
+        enqueued_seq_++;
+    }
+    cv_.notify_one();
+}
+
+void QueueJournal::flush() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    const uint64_t target = enqueued_seq_;
+    if (!running_) return;
+    drained_cv_.wait(lock, [this, target] { return written_seq_ >= target || !running_; });
+}
+
+nlohmann::json QueueJournal::stats_json() const {
+    size_t pending;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending = pending_.size();
+    }
+    return {
+        {"records_written", records_written_.load()},
+        {"journal_length", journal_length_.load()},
+        {"compactions", compactions_.load()},
+        {"pending", pending}
+    };
+}
+
+void QueueJournal::writer_loop() {
+    while (true) {
+        std::vector<Record> batch;
+        bool stopping;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this] { return stop_requested_ || !pending_.empty(); });
+            batch.swap(pending_);
+            stopping = stop_requested_;
+        }
+
+        if (!batch.empty()) {
+            write_records(batch);
+            if (journal_records_ >= compact_after_) {
+                compact();
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                written_seq_ += batch.size();
+            }
+            drained_cv_.notify_all();
+        }
+
+        if (stopping) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (pending_.empty()) break;
+        }
+    }
+}
+
+void QueueJournal::apply_to_mirror(const Record& r) {
+    if (r.erase) {
+        mirror_.erase(r.job_id);
+    } else {
+        mirror_[r.job_id] = r.item.dump();
+    }
+}
+
+void QueueJournal::write_records(const std::vector<Record>& batch) {
+    std::string buf;
+    for (const auto& r : batch) {
+        if (r.erase) {
+            mirror_.erase(r.job_id);
+            buf += nlohmann::json{{"op", "del"}, {"job_id", r.job_id}}.dump();
+        } else {
+            // One dump serves the journal line and the mirror
+            std::string item = r.item.dump();
+            buf += "{\"op\":\"put\",\"item\":";
+            buf += item;
+            buf += '}';
+            mirror_[r.job_id] = std::move(item);
+        }
+        buf += '\n';
+    }
+
+    if (!journal_ && !open_journal(false)) {
+        return;  // mirror still has it; the next compaction persists it
+    }
+    if (std::fwrite(buf.data(), 1, buf.size(), journal_) != buf.size()) {
+        std::cerr << "[QueueJournal] Short write to " << journal_path_ << std::endl;
+    }
+    std::fflush(journal_);
+
+    journal_records_ += batch.size();
+    records_written_ += batch.size();
+    journal_length_ = journal_records_;
+}
+
+void QueueJournal::compact() {
+    // Same {"items": [...]} document, spliced from the stored dumps
+    std::string state = "{\"items\":[";
+    bool first = true;
+    for (const auto& [id, item] : mirror_) {
+        if (!first) state += ',';
+        state += item;
+        first = false;
+    }
+    state += "]}";
+
+    const std::string tmp_path = snapshot_path_ + ".tmp";
+    {
+        std::ofstream file(tmp_path, std::ios::trunc);
+        if (!file.is_open()) {
+            std::cerr << "[QueueJournal] Failed to write snapshot " << tmp_path << std::endl;
+            return;
+        }
+        file << state;
+        if (!file.good()) {
+            std::cerr << "[QueueJournal] Failed to write snapshot " << tmp_path << std::endl;
+            return;
+        }
+    }
+
+    std::error_code ec;
+    fs::rename(tmp_path, snapshot_path_, ec);
+    if (ec) {
+        std::cerr << "[QueueJournal] Failed to replace snapshot: " << ec.message() << std::endl;
+        return;
+    }
+
+    // Snapshot now covers every journaled record
+    open_journal(true);
+    journal_records_ = 0;
+    journal_length_ = 0;
+    compactions_++;
+}
+
+bool QueueJournal::open_journal(bool truncate) {
+    if (journal_) {
+        std::fclose(journal_);
+        journal_ = nullptr;
+    }
+    journal_ = std::fopen(journal_path_.c_str(), truncate ? "w" : "a");
+    return journal_ != nullptr;
+}
+
+} // namespace sdcpp
@@ -6,6 +6,16 @@
 #include "websocket_server.hpp"
 #include "utils.hpp"
 #include "config.hpp"
+#include "prompt_template.hpp"
+#include "image_encoder.hpp"
+#include "image_input.hpp"
+#include "memory_utils.hpp"
+#include "tiled_upscaler.hpp"
+#include "job_timings.hpp"
+#include "metrics.hpp"
+#include "job_trace.hpp"
+#include "cluster_coordinator.hpp"
+#include "thumbnail_cache.hpp"
 
 // Alias for shorter code
 using F = sdcpp::QueueItemFields;
@@ -14,6 +24,11 @@ using F = sdcpp::QueueItemFields;
 #include <fstream>
 #include <filesystem>
 #include <algorithm>
+#include <random>
+#include <set>
+#include <cstring>
+#include <cstdlib>
+#include <cmath>
 
 namespace sdcpp {
 
@@ -49,6 +64,7 @@ std::string generation_type_to_string(GenerationType type) {
         case GenerationType::ModelDownload: return "model_download";
         case GenerationType::ModelHash: return "model_hash";
         case GenerationType::ADetailer: return "adetailer";
+        case GenerationType::Pipeline: return "pipeline";
         default: return "unknown";
     }
 }
@@ -62,9 +78,15 @@ GenerationType string_to_generation_type(const std::string& str) {
     if (str == "model_download") return GenerationType::ModelDownload;
     if (str == "model_hash") return GenerationType::ModelHash;
     if (str == "adetailer") return GenerationType::ADetailer;
+    if (str == "pipeline") return GenerationType::Pipeline;
     return GenerationType::Text2Image;
 }
 
+const nlohmann::json& QueueItem::settings() const {
+    static const nlohmann::json empty = nlohmann::json::object();
+    return model_settings ? *model_settings : empty;
+}
+
 nlohmann::json QueueItem::to_json() const {
     nlohmann::json j = {
         {F::JOB_ID, job_id},
@@ -87,15 +109,28 @@ nlohmann::json QueueItem::to_json() const {
     if (!params.empty()) {
         j[F::PARAMS] = params;
     }
-    if (!model_settings.empty()) {
-        j[F::MODEL_SETTINGS] = model_settings;
+    if (!params_file.empty()) {
+        j[F::PARAMS_FILE] = params_file;
+    }
+    if (model_settings && !model_settings->empty()) {
+        j[F::MODEL_SETTINGS] = *model_settings;
     }
     if (!linked_job_id.empty()) {
         j[F::LINKED_JOB_ID] = linked_job_id;
     }
+    if (!dedup_key.empty()) {
+        j[F::DEDUP_KEY] = dedup_key;
+    }
     if (!title.empty()) {
         j[F::TITLE] = title;
     }
+    j[F::PRIORITY] = job_priority_to_string(priority);
+    if (!owner.empty()) {
+        j[F::OWNER] = owner;
+    }
+    if (!metadata.empty()) {
+        j[F::METADATA] = metadata;
+    }
 
     // Recycle bin fields
     if (status == QueueStatus::Deleted) {
@@ -127,8 +162,11 @@ QueueItem QueueItem::from_json(const nlohmann::json& j) {
     if (j.contains(F::PARAMS)) {
         item.params = j[F::PARAMS];
     }
+    if (j.contains(F::PARAMS_FILE) && j[F::PARAMS_FILE].is_string()) {
+        item.params_file = j[F::PARAMS_FILE].get<std::string>();
+    }
     if (j.contains(F::MODEL_SETTINGS)) {
-        item.model_settings = j[F::MODEL_SETTINGS];
+        item.model_settings = std::make_shared<const nlohmann::json>(j[F::MODEL_SETTINGS]);
     }
     if (j.contains(F::ERROR)) {
         item.error_message = j[F::ERROR].get<std::string>();
@@ -136,9 +174,25 @@ QueueItem QueueItem::from_json(const nlohmann::json& j) {
     if (j.contains(F::LINKED_JOB_ID)) {
         item.linked_job_id = j[F::LINKED_JOB_ID].get<std::string>();
     }
+    if (j.contains(F::DEDUP_KEY) && j[F::DEDUP_KEY].is_string()) {
+        item.dedup_key = j[F::DEDUP_KEY].get<std::string>();
+    }
     if (j.contains(F::TITLE) && j[F::TITLE].is_string()) {
         item.title = j[F::TITLE].get<std::string>();
     }
+    if (j.contains(F::PRIORITY) && j[F::PRIORITY].is_string()) {
+        try {
+            item.priority = string_to_job_priority(j[F::PRIORITY].get<std::string>());
+        } catch (const std::exception&) {
+            // Unknown class from a newer version: queue it as normal
+        }
+    }
+    if (j.contains(F::OWNER) && j[F::OWNER].is_string()) {
+        item.owner = j[F::OWNER].get<std::string>();
+    }
+    if (j.contains(F::METADATA) && j[F::METADATA].is_object()) {
+        item.metadata = j[F::METADATA];
+    }
 
     // Recycle bin fields
     if (j.contains("deleted_at")) {
@@ -206,9 +260,9 @@ bool QueueFilter::matches(const QueueItem& item) const {
     // Architecture filter (search in model_settings.model_architecture)
     if (architecture.has_value() && !architecture.value().empty()) {
         std::string item_arch;
-        if (item.model_settings.contains("model_architecture") &&
-            item.model_settings["model_architecture"].is_string()) {
-            item_arch = item.model_settings["model_architecture"].get<std::string>();
+        const auto& settings = item.settings();
+        if (settings.contains("model_architecture") && settings["model_architecture"].is_string()) {
+            item_arch = settings["model_architecture"].get<std::string>();
         }
         if (!contains_insensitive(item_arch, architecture.value())) {
             return false;
@@ -218,9 +272,9 @@ bool QueueFilter::matches(const QueueItem& item) const {
     // Model name filter (search in model_settings.model_name)
     if (model.has_value() && !model.value().empty()) {
         std::string item_model;
-        if (item.model_settings.contains("model_name") &&
-            item.model_settings["model_name"].is_string()) {
-            item_model = item.model_settings["model_name"].get<std::string>();
+        const auto& settings = item.settings();
+        if (settings.contains("model_name") && settings["model_name"].is_string()) {
+            item_model = settings["model_name"].get<std::string>();
         }
         if (!contains_insensitive(item_model, model.value())) {
             return false;
@@ -251,34 +305,122 @@ QueueManager::QueueManager(
     ModelManager& model_manager,
     const std::string& output_dir,
     const std::string& state_file,
-    const RecycleBinConfig& recycle_bin_config
+    const RecycleBinConfig& recycle_bin_config,
+    const QueueConfig& queue_config
 ) : model_manager_(model_manager),
     output_dir_(output_dir),
     state_file_(state_file),
-    recycle_bin_config_(recycle_bin_config) {
+    recycle_bin_config_(recycle_bin_config),
+    queue_config_(queue_config),
+    scheduler_(queue_config),
+    journal_(state_file, static_cast<size_t>(queue_config.journal_compact_records)),
+    job_events_(static_cast<size_t>(queue_config.max_job_waiters)),
+    progress_dispatcher_(
+        ProgressDispatcher::Hooks{
+            [this](const std::string& job_id) { return is_job_running(job_id); },
+            [this](const ProgressEvent& preview) { store_preview(preview); },
+            [this](const nlohmann::json& progress) {
+                job_events_.publish(progress["job_id"].get<std::string>(), "progress", progress);
+            }
+        },
+        PROGRESS_THROTTLE_MS, PREVIEW_THROTTLE_MS),
+    output_pipeline_(queue_config.output_workers,
+                     static_cast<size_t>(std::max(1, queue_config.output_buffer_mb)) * 1024 * 1024),
+    output_reaper_(output_dir,
+        OutputReaper::Hooks{
+            [this] { run_maintenance(); },
+            [this](const std::vector<std::string>& batch) { return referenced_files(batch); }
+        },
+        std::chrono::seconds(recycle_bin_config.sweep_interval_seconds),
+        recycle_bin_config.reap_files_per_second) {
 
     utils::create_directory(output_dir_);
     load_state();
-
-    // Purge expired recycle bin items on startup
-    if (recycle_bin_config_.enabled) {
-        int purged = purge_expired_jobs();
-        if (purged > 0) {
-            std::cout << "[QueueManager] Purged " << purged << " expired items from recycle bin on startup" << std::endl;
-        }
-    }
+    // Expired recycle bin items are purged by the reaper's first sweep, in start()
 }
 
 QueueManager::~QueueManager() {
     stop();
 }
 
+thread_local QueueManager::WorkerSlot* QueueManager::current_slot_ = nullptr;
+
+QueueManager::WorkerLane QueueManager::lane_for(GenerationType type) {
+    switch (type) {
+        case GenerationType::ModelDownload:
+        case GenerationType::ModelHash:
+            return WorkerLane::Io;
+        default:
+            return WorkerLane::Generation;
+    }
+}
+
+const char* QueueManager::lane_to_string(WorkerLane lane) {
+    switch (lane) {
+        case WorkerLane::Io: return "io";
+        case WorkerLane::Post: return "post";
+        case WorkerLane::Remote: return "remote";
+        default: return "generation";
+    }
+}
+
 void QueueManager::start() {
     if (running_) return;
     
     running_ = true;
-    worker_ = std::thread(&QueueManager::worker_thread, this);
-    std::cout << "[QueueManager] Worker thread started" << std::endl;
+
+    // One generation worker per ModelManager device, each on its own copy
+    // of the loaded model; they share the pending queue, so an idle device
+    // takes the next job whichever device its predecessors ran on
+    generation_workers_ = static_cast<int>(model_manager_.device_count());
+    for (int i = 0; i < generation_workers_; ++i) {
+        auto gen = std::make_unique<WorkerSlot>();
+        gen->id = i;
+        gen->lane = WorkerLane::Generation;
+        gen->device = static_cast<size_t>(i);
+        workers_.push_back(std::move(gen));
+    }
+
+    for (int i = 0; i < queue_config_.io_workers; ++i) {
+        auto io = std::make_unique<WorkerSlot>();
+        io->id = static_cast<int>(workers_.size());
+        io->lane = WorkerLane::Io;
+        workers_.push_back(std::move(io));
+    }
+
+    has_post_worker_ = queue_config_.post_worker;
+    if (has_post_worker_) {
+        auto post = std::make_unique<WorkerSlot>();
+        post->id = static_cast<int>(workers_.size());
+        post->lane = WorkerLane::Post;
+        workers_.push_back(std::move(post));
+    }
+
+    const int remote_workers = cluster_ && cluster_->enabled() ? cluster_->slot_count() : 0;
+    for (int i = 0; i < remote_workers; ++i) {
+        auto remote = std::make_unique<WorkerSlot>();
+        remote->id = static_cast<int>(workers_.size());
+        remote->lane = WorkerLane::Remote;
+        workers_.push_back(std::move(remote));
+    }
+
+    for (auto& slot : workers_) {
+        slot->events = progress_dispatcher_.add_producer();
+    }
+    progress_dispatcher_.start();
+
+    if (queue_config_.output_workers > 0) {
+        output_pipeline_.start();
+    }
+
+    for (auto& slot : workers_) {
+        slot->thread = std::thread(&QueueManager::worker_thread, this, slot.get());
+    }
+    output_reaper_.start();
+    std::cout << "[QueueManager] Worker pool started: " << generation_workers_ << " generation, "
+              << queue_config_.io_workers << " io" << (has_post_worker_ ? ", 1 post" : "")
+              << (remote_workers > 0 ? ", " + std::to_string(remote_workers) + " remote" : "")
+              << (queue_config_.work_stealing ? " (work stealing on)" : "") << std::endl;
 }
 
 void QueueManager::stop() {
@@ -286,70 +428,175 @@ void QueueManager::stop() {
 
     running_ = false;
     queue_cv_.notify_all();
+    job_events_.close();
+
+    // Use a timed approach: wait up to 5 seconds total, then detach.
+    // SD.cpp doesn't support mid-generation cancellation, so we can't interrupt a running job
+    std::cout << "[QueueManager] Waiting for worker threads to finish..." << std::endl;
+    auto start = std::chrono::steady_clock::now();
+    constexpr auto SHUTDOWN_TIMEOUT = std::chrono::seconds(5);
+
+    for (auto& slot : workers_) {
+        while (slot->thread.joinable()) {
+            // There's no portable timed_join. A worker with no running job is
+            // blocked on queue_cv_ (or about to be) and exits promptly once it
+            // sees running_ == false, so join as soon as the slot is idle.
+            {
+                std::lock_guard<std::mutex> plock(progress_mutex_);
+                if (slot->current_job_id.empty()) {
+                    slot->thread.join();
+                    break;
+                }
+            }
 
-    if (worker_.joinable()) {
-        // Use a timed approach: wait up to 5 seconds, then detach
-        // SD.cpp doesn't support mid-generation cancellation, so we can't interrupt a running job
-        std::cout << "[QueueManager] Waiting for worker thread to finish..." << std::endl;
-
-        // Try to join with a timeout by polling
-        auto start = std::chrono::steady_clock::now();
-        constexpr auto SHUTDOWN_TIMEOUT = std::chrono::seconds(5);
-
-        while (worker_.joinable()) {
-            // Check if thread has finished using a native handle approach isn't portable,
-            // so we just try join with a small sleep and check elapsed time
             auto elapsed = std::chrono::steady_clock::now() - start;
             if (elapsed >= SHUTDOWN_TIMEOUT) {
-                std::cout << "[QueueManager] Timeout waiting for worker, detaching thread" << std::endl;
-                worker_.detach();
+                std::cout << "[QueueManager] Timeout waiting for worker " << slot->id
+                          << ", detaching thread" << std::endl;
+                slot->thread.detach();
                 break;
             }
-
-            // Try a quick join check - there's no portable timed_join, so just sleep and check
             std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+    }
 
-            // Check if we can join by seeing if running is still active in the thread
-            // Since we set running_ = false, if the thread is waiting on CV, it will exit
-            // If it's in the middle of processing, it won't exit until done
+    // Write out images still in flight; their completions journal the final status
+    output_pipeline_.stop();
 
-            // Attempt join with a trick: check if thread is still doing work
-            // by seeing if current_job_id_ is still set
-            {
-                std::lock_guard<std::mutex> plock(progress_mutex_);
-                if (current_job_id_.empty()) {
-                    // No job running, thread should exit soon
-                    worker_.join();
-                    break;
-                }
-            }
+    // Finish deleting purged files; the purges themselves go to the journal
+    output_reaper_.stop();
+
+    progress_dispatcher_.stop();
+
+    // Drain the journal and fold it into a fresh snapshot
+    journal_.stop();
+    std::cout << "[QueueManager] Worker threads stopped" << std::endl;
+}
+
+std::string QueueManager::add_job(GenerationType type, const nlohmann::json& params,
+                                  const std::string& title, const JobOrigin& origin) {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    return add_job_locked(type, params, title, "", origin);
+}
+
+std::vector<std::string> QueueManager::add_jobs(GenerationType type, const std::vector<nlohmann::json>& params,
+                                                const std::string& title, const JobOrigin& origin,
+                                                std::string& refusal) {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    refusal = check_user_quota_locked(origin.owner, params.size());
+    if (!refusal.empty()) return {};
+    std::vector<std::string> ids;
+    ids.reserve(params.size());
+    for (const auto& p : params) ids.push_back(add_job_locked(type, p, title, "", origin));
+    return ids;
+}
+
+std::string QueueManager::check_user_quota_locked(const std::string& owner, size_t jobs) const {
+    const int limit = queue_config_.max_pending_per_user;
+    if (limit <= 0 || owner.empty()) return "";
+    size_t pending = 0;
+    for (const auto& id : pending_queue_) {
+        auto it = jobs_.find(id);
+        if (it != jobs_.end() && it->second.status == QueueStatus::Pending && it->second.owner == owner) {
+            pending++;
         }
     }
+    if (pending + jobs <= static_cast<size_t>(limit)) return "";
+    return "Queue quota reached: " + std::to_string(pending) + " job(s) already waiting, at most " +
+           std::to_string(limit) + " per user (queue.max_pending_per_user)";
+}
 
-    save_state();
-    std::cout << "[QueueManager] Worker thread stopped" << std::endl;
+std::string QueueManager::dedup_key_for(GenerationType type, const nlohmann::json& params) const {
+    if (!params.contains("seed") || !params["seed"].is_number_integer() ||
+        params["seed"].get<int64_t>() < 0) {
+        return "";
+    }
+    // nlohmann::json objects keep their keys sorted, so dump() is canonical
+    utils::Sha256 sha;
+    auto feed = [&sha](const std::string& s) {
+        sha.update(s.data(), s.size());
+        sha.update("\n", 1);
+    };
+    feed(generation_type_to_string(type));
+    feed(params.dump());
+    feed(model_manager_.get_loaded_model_fingerprint().dump());
+    return sha.hex_digest();
 }
 
-std::string QueueManager::add_job(GenerationType type, const nlohmann::json& params,
-                                  const std::string& title) {
+QueueManager::SubmitResult QueueManager::submit_job(GenerationType type, const nlohmann::json& params,
+                                                    const std::string& title, bool allow_dedup,
+                                                    const JobOrigin& origin) {
+    const std::string key = (allow_dedup && queue_config_.dedup_results)
+        ? dedup_key_for(type, params) : "";
+
     std::lock_guard<std::mutex> lock(queue_mutex_);
+    if (key.empty()) {
+        if (auto refusal = check_user_quota_locked(origin.owner, 1); !refusal.empty()) {
+            return {"", false, QueueStatus::Pending, refusal};
+        }
+        return {add_job_locked(type, params, title, "", origin), false, QueueStatus::Pending, ""};
+    }
+
+    auto hit = result_index_.find(key);
+    if (hit != result_index_.end()) {
+        auto it = jobs_.find(hit->second);
+        bool reusable = false;
+        if (it != jobs_.end()) {
+            const QueueItem& job = it->second;
+            if (job.status == QueueStatus::Pending || job.status == QueueStatus::Processing) {
+                reusable = true;
+            } else if (job.status == QueueStatus::Completed && !job.outputs.empty()) {
+                auto age = std::chrono::system_clock::now() - job.completed_at;
+                reusable = age <= std::chrono::minutes(recycle_bin_config_.retention_minutes);
+                for (const auto& out : job.outputs) {
+                    if (!reusable) break;
+                    reusable = std::filesystem::exists(std::filesystem::path(output_dir_) / out);
+                }
+            }
+        }
+        if (reusable) {
+            dedup_hits_++;
+            std::cout << "[QueueManager] Duplicate request, reusing job " << hit->second
+                      << " (" << queue_status_to_string(it->second.status) << ")" << std::endl;
+            return {hit->second, true, it->second.status, ""};
+        }
+        result_index_.erase(hit);
+    }
 
+    if (auto refusal = check_user_quota_locked(origin.owner, 1); !refusal.empty()) {
+        return {"", false, QueueStatus::Pending, refusal};
+    }
+    dedup_misses_++;
+    std::string job_id = add_job_locked(type, params, title, key, origin);
+    result_index_[key] = job_id;
+    return {job_id, false, QueueStatus::Pending, ""};
+}
+
+std::string QueueManager::add_job_locked(GenerationType type, const nlohmann::json& params,
+                                         const std::string& title, const std::string& dedup_key,
+                                         const JobOrigin& origin) {
     QueueItem item;
     item.job_id = utils::generate_uuid();
     item.type = type;
     item.status = QueueStatus::Pending;
     item.params = params;
     item.title = title;
+    item.dedup_key = dedup_key;
+    item.owner = origin.owner;
+    item.priority = origin.priority;
     item.created_at = utils::get_time_now();
+    auto trace = JobTrace::start(item.job_id);
+    JobTrace::Span enqueue_span(trace.get(), "enqueue", "queue");
 
     // Capture current model settings at job creation time
-    item.model_settings = model_manager_.get_loaded_models_info();
+    item.model_settings = intern_settings_locked(model_manager_.get_loaded_models_info());
 
     jobs_[item.job_id] = item;
-    pending_queue_.push(item.job_id);
+    pending_queue_.push_back(item.job_id);
 
-    save_state();
-    queue_cv_.notify_one();
+    record_job_locked(item);
+    // notify_all: the woken worker must be on the right lane for this job
+    queue_cv_.notify_all();
 
     // Broadcast job added event via WebSocket
     if (auto* ws = get_websocket_server()) {
@@ -375,6 +622,9 @@ std::string QueueManager::add_job(GenerationType type, const nlohmann::json& par
     std::cout << "[QueueManager] Job added: " << item.job_id
               << " | type=" << generation_type_to_string(type)
               << " | queue_size=" << pending_queue_.size();
+    if (item.priority != JobPriority::Normal) {
+        std::cout << " | priority=" << job_priority_to_string(item.priority);
+    }
     if (!prompt_preview.empty()) {
         std::cout << " | prompt=\"" << prompt_preview << "\"";
     }
@@ -384,35 +634,69 @@ std::string QueueManager::add_job(GenerationType type, const nlohmann::json& par
 }
 
 std::optional<QueueItem> QueueManager::get_job(const std::string& job_id) const {
-    std::lock_guard<std::mutex> lock(queue_mutex_);
-    
-    auto it = jobs_.find(job_id);
-    if (it == jobs_.end()) {
-        return std::nullopt;
-    }
-    
-    QueueItem item = it->second;
-    
-    // Add current progress if this is the processing job
-    if (item.status == QueueStatus::Processing && job_id == current_job_id_) {
-        std::lock_guard<std::mutex> plock(progress_mutex_);
-        item.progress = current_progress_;
+    std::optional<QueueItem> item;
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+
+        auto it = jobs_.find(job_id);
+        if (it == jobs_.end()) {
+            return std::nullopt;
+        }
+
+        item = it->second;
+
+        // Add live progress if this job is running on a worker
+        apply_live_progress(*item);
     }
-    
+    load_offloaded_params(*item);
     return item;
 }
 
-std::vector<QueueItem> QueueManager::get_all_jobs() const {
-    std::lock_guard<std::mutex> lock(queue_mutex_);
+std::shared_ptr<JobEvents::Watch> QueueManager::watch_job(const std::string& job_id) {
+    return job_events_.watch(job_id);
+}
+
+std::optional<QueueItem> QueueManager::wait_job(const std::string& job_id, std::chrono::seconds timeout,
+                                                bool* finished) {
+    auto is_final = [](QueueStatus s) {
+        return s == QueueStatus::Completed || s == QueueStatus::Failed ||
+               s == QueueStatus::Cancelled || s == QueueStatus::Deleted;
+    };
+    // Watch first: an event between the status read and the wait is queued
+    auto watch = job_events_.watch(job_id);
+    bool done = false;
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        auto it = jobs_.find(job_id);
+        if (it == jobs_.end()) return std::nullopt;
+        done = is_final(it->second.status);
+    }
+    if (!done && watch) {
+        const auto deadline = std::chrono::steady_clock::now() +
+            std::min(timeout, std::chrono::seconds(queue_config_.max_wait_seconds));
+        while (!watch->finished() && !watch->closed()) {
+            const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+                deadline - std::chrono::steady_clock::now());
+            if (left.count() <= 0) break;
+            watch->next(left);
+        }
+    }
+    watch.reset();
+
+    auto job = get_job(job_id);
+    if (finished) *finished = job && is_final(job->status);
+    return job;
+}
 
+std::vector<QueueItem> QueueManager::get_all_jobs() const {
     std::vector<QueueItem> result;
-    for (const auto& [id, item] : jobs_) {
-        QueueItem copy = item;
-        if (copy.status == QueueStatus::Processing && id == current_job_id_) {
-            std::lock_guard<std::mutex> plock(progress_mutex_);
-            copy.progress = current_progress_;
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        for (const auto& [id, item] : jobs_) {
+            QueueItem copy = item;
+            apply_live_progress(copy);
+            result.push_back(copy);
         }
-        result.push_back(copy);
     }
     return result;
 }
@@ -423,63 +707,51 @@ std::vector<QueueItem> QueueManager::get_all_jobs(const QueueFilter& filter) con
         return get_all_jobs();
     }
 
-    std::lock_guard<std::mutex> lock(queue_mutex_);
+    std::vector<std::string> ids;
+    index_.for_each_match(filter, [&ids](const std::string& id, std::chrono::system_clock::time_point) {
+        ids.push_back(id);
+        return true;
+    });
+    return materialize_jobs(ids);
+}
 
+std::vector<QueueItem> QueueManager::materialize_jobs(const std::vector<std::string>& job_ids) const {
     std::vector<QueueItem> result;
-    for (const auto& [id, item] : jobs_) {
-        // Check if item matches filter
-        if (!filter.matches(item)) {
-            continue;
-        }
-
-        QueueItem copy = item;
-        if (copy.status == QueueStatus::Processing && id == current_job_id_) {
-            std::lock_guard<std::mutex> plock(progress_mutex_);
-            copy.progress = current_progress_;
+    result.reserve(job_ids.size());
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        for (const auto& id : job_ids) {
+            auto it = jobs_.find(id);
+            if (it == jobs_.end()) continue;  // removed since the index walk
+            QueueItem copy = it->second;
+            apply_live_progress(copy);
+            result.push_back(std::move(copy));
         }
-        result.push_back(copy);
     }
     return result;
 }
 
 QueuePageResult QueueManager::get_jobs_paginated(const QueueFilter& filter) const {
-    std::lock_guard<std::mutex> lock(queue_mutex_);
-
     QueuePageResult result;
     result.offset = filter.offset;
     result.limit = filter.limit > 0 ? filter.limit : 20;
 
-    // First, collect all matching items and sort by created_at (newest first)
-    std::vector<QueueItem> matching_items;
-    for (const auto& [id, item] : jobs_) {
-        if (filter.matches(item)) {
-            QueueItem copy = item;
-            if (copy.status == QueueStatus::Processing && id == current_job_id_) {
-                std::lock_guard<std::mutex> plock(progress_mutex_);
-                copy.progress = current_progress_;
-            }
-            matching_items.push_back(copy);
+    // Walk the index newest first; only the requested page is copied out of
+    // jobs_, under queue_mutex_ once the walk is done
+    std::vector<std::string> page_ids;
+    size_t total = 0;
+    index_.for_each_match(filter, [&](const std::string& id, std::chrono::system_clock::time_point) {
+        if (total >= result.offset && page_ids.size() < result.limit) {
+            page_ids.push_back(id);
         }
-    }
-
-    // Sort by created_at descending (newest first)
-    std::sort(matching_items.begin(), matching_items.end(),
-        [](const QueueItem& a, const QueueItem& b) {
-            return a.created_at > b.created_at;
-        });
-
-    result.total_count = matching_items.size();
-
-    // Apply pagination
-    size_t start = std::min(filter.offset, matching_items.size());
-    size_t end = std::min(start + result.limit, matching_items.size());
-
-    for (size_t i = start; i < end; ++i) {
-        result.items.push_back(matching_items[i]);
-    }
+        total++;
+        return true;
+    });
 
+    result.total_count = total;
+    result.items = materialize_jobs(page_ids);
     result.filtered_count = result.items.size();
-    result.has_more = end < matching_items.size();
+    result.has_more = std::min(result.offset, total) + page_ids.size() < total;
 
     // Set timestamp bounds for the returned items
     if (!result.items.empty()) {
@@ -534,78 +806,54 @@ static std::string format_date_string(int64_t day_timestamp) {
 }
 
 QueueGroupedResult QueueManager::get_jobs_grouped_by_date(const QueueFilter& filter, size_t page, size_t limit) const {
-    std::lock_guard<std::mutex> lock(queue_mutex_);
-
     QueueGroupedResult result;
     result.page = page > 0 ? page : 1;
     result.limit = limit > 0 ? limit : 20;
 
-    // First, collect all matching items and sort by created_at (newest first)
-    std::vector<QueueItem> matching_items;
-    for (const auto& [id, item] : jobs_) {
-        if (filter.matches(item)) {
-            QueueItem copy = item;
-            if (copy.status == QueueStatus::Processing && id == current_job_id_) {
-                std::lock_guard<std::mutex> plock(progress_mutex_);
-                copy.progress = current_progress_;
-            }
-            matching_items.push_back(copy);
+    // Matches arrive newest first, so days arrive in descending order and a
+    // new group starts whenever an item falls before the current day.
+    struct DayGroup {
+        int64_t day_start;
+        size_t count = 0;
+        std::vector<std::string> page_ids;
+    };
+    std::vector<DayGroup> days;
+    const size_t skip = (result.page - 1) * result.limit;
+    size_t total = 0;
+    std::chrono::system_clock::time_point current_day_start = std::chrono::system_clock::time_point::max();
+
+    index_.for_each_match(filter, [&](const std::string& id, std::chrono::system_clock::time_point created_at) {
+        if (days.empty() || created_at < current_day_start) {
+            DayGroup day;
+            day.day_start = get_start_of_day(created_at);
+            current_day_start = std::chrono::system_clock::from_time_t(static_cast<std::time_t>(day.day_start));
+            days.push_back(std::move(day));
         }
-    }
-
-    result.total_count = matching_items.size();
-
-    // Sort by created_at descending (newest first)
-    std::sort(matching_items.begin(), matching_items.end(),
-        [](const QueueItem& a, const QueueItem& b) {
-            return a.created_at > b.created_at;
-        });
-
-    // Group items by date
-    std::map<int64_t, std::vector<QueueItem>, std::greater<int64_t>> date_groups;
-    for (const auto& item : matching_items) {
-        int64_t day_start = get_start_of_day(item.created_at);
-        date_groups[day_start].push_back(item);
-    }
+        DayGroup& day = days.back();
+        day.count++;
+        if (total >= skip && total < skip + result.limit) {
+            day.page_ids.push_back(id);
+        }
+        total++;
+        return true;
+    });
 
-    // Calculate pagination
-    result.total_pages = (matching_items.size() + result.limit - 1) / result.limit;
+    result.total_count = total;
+    result.total_pages = (total + result.limit - 1) / result.limit;
     if (result.total_pages == 0) result.total_pages = 1;
 
-    size_t skip = (result.page - 1) * result.limit;
-    size_t taken = 0;
-    size_t skipped = 0;
-
-    // Iterate through date groups and apply pagination
-    for (auto& [day_timestamp, items] : date_groups) {
-        // If we've taken enough items, stop
-        if (taken >= result.limit) break;
-
-        // Check if we need to skip this entire group
-        if (skipped + items.size() <= skip) {
-            skipped += items.size();
-            continue;
-        }
+    for (const auto& day : days) {
+        if (day.page_ids.empty()) continue;
 
         QueueDateGroup group;
-        group.timestamp = day_timestamp;
-        group.date = format_date_string(day_timestamp);
-        group.label = format_date_label(day_timestamp);
-        group.count = items.size();
-
-        // Calculate how many items to skip within this group
-        size_t group_skip = (skipped < skip) ? (skip - skipped) : 0;
-
-        // Take items from this group
-        for (size_t i = group_skip; i < items.size() && taken < result.limit; ++i) {
-            group.items.push_back(items[i]);
-            ++taken;
-        }
-
-        skipped += group_skip;
+        group.timestamp = day.day_start;
+        group.date = format_date_string(day.day_start);
+        group.label = format_date_label(day.day_start);
+        group.count = day.count;
+        group.items = materialize_jobs(day.page_ids);
 
         if (!group.items.empty()) {
-            result.groups.push_back(group);
+            result.groups.push_back(std::move(group));
         }
     }
 
@@ -616,28 +864,139 @@ QueueGroupedResult QueueManager::get_jobs_grouped_by_date(const QueueFilter& fil
 }
 
 nlohmann::json QueueManager::get_status() const {
-    std::lock_guard<std::mutex> lock(queue_mutex_);
-    
-    int pending = 0, processing = 0, completed = 0, failed = 0;
-    for (const auto& [id, item] : jobs_) {
-        switch (item.status) {
-            case QueueStatus::Pending: pending++; break;
-            case QueueStatus::Processing: processing++; break;
-            case QueueStatus::Completed: completed++; break;
-            case QueueStatus::Failed: failed++; break;
-            default: break;
-        }
-    }
-    
+    // Counts come from the index, so the WebUI's status polling doesn't
+    // walk jobs_ under queue_mutex_
+    nlohmann::json scheduler;
+    bool vram_held = false;
+    size_t shared_settings = 0;
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        scheduler = scheduler_.status_json();
+        vram_held = vram_held_;
+        shared_settings = settings_pool_.size();
+    }
+    scheduler["pending_by_priority"] = {
+        {"interactive", index_.count(QueueStatus::Pending, JobPriority::Interactive)},
+        {"normal", index_.count(QueueStatus::Pending, JobPriority::Normal)},
+        {"batch", index_.count(QueueStatus::Pending, JobPriority::Batch)}
+    };
+
+    nlohmann::json previews = SDWrapper::preview_pacing_json();
+    {
+        std::lock_guard<std::mutex> lock(preview_mutex_);
+        previews["on_demand"] = preview_settings_.on_demand;
+        previews["max_overhead_percent"] = preview_settings_.max_overhead_percent;
+    }
+
+    nlohmann::json output_gc = output_reaper_.stats_json();
+    output_gc["delete_outputs"] = recycle_bin_config_.delete_outputs;
+    output_gc["quota_mb"] = recycle_bin_config_.output_quota_mb;
+    output_gc["output_bytes"] = output_bytes_.load();
+    output_gc["quota_evicted"] = quota_evicted_.load();
+    scheduler["preempt_sweeps"] = queue_config_.preempt_sweeps;
+    scheduler["sweeps_preempted"] = sweeps_preempted_.load();
+    scheduler["max_pending_per_user"] = queue_config_.max_pending_per_user;
+
+    nlohmann::json checkpoints = {
+        {"interval_seconds", queue_config_.checkpoint_interval_seconds},
+        {"written", checkpoints_written_.load()},
+        {"resumed", batches_resumed_.load()},
+        {"seconds_per_step", checkpoint_estimates_.stats_json()}
+    };
+
     return nlohmann::json{
-        {"pending_count", pending},
-        {"processing_count", processing},
-        {"completed_count", completed},
-        {"failed_count", failed},
-        {"total_count", jobs_.size()}
+        {"pending_count", index_.count(QueueStatus::Pending)},
+        {"processing_count", index_.count(QueueStatus::Processing)},
+        {"completed_count", index_.count(QueueStatus::Completed)},
+        {"failed_count", index_.count(QueueStatus::Failed)},
+        {"total_count", index_.size()},
+        {"workers", get_workers_status()},
+        {"scheduler", scheduler},
+        {"persistence", journal_.stats_json()},
+        {"progress_events", progress_dispatcher_.stats_json()},
+        {"job_watchers", job_events_.stats_json()},
+        {"output_pipeline", output_pipeline_.stats_json()},
+        {"output_gc", output_gc},
+        {"previews", previews},
+        {"checkpoints", checkpoints},
+        {"batching", {
+            {"max_batch_images", queue_config_.max_batch_images},
+            {"merged_calls", merged_calls_.load()},
+            {"merged_jobs", merged_jobs_.load()}
+        }},
+        {"history", {
+            {"params_offloaded", params_offloaded_.load()},
+            {"shared_model_settings", shared_settings}
+        }},
+        {"result_cache", {
+            {"enabled", queue_config_.dedup_results},
+            {"hits", dedup_hits_.load()},
+            {"misses", dedup_misses_.load()}
+        }},
+        {"vram_admission", {
+            {"policy", queue_config_.vram_admission},
+            {"headroom_mb", queue_config_.vram_headroom_mb},
+            {"holding", vram_held},
+            {"refused", vram_refused_.load()},
+            {"downgraded", vram_downgraded_.load()}
+        }}
     };
 }
 
+void QueueManager::append_metrics(std::string& out) const {
+    using metrics::write_header;
+    using metrics::write_sample;
+
+    write_header(out, "sdcpp_queue_jobs", "Jobs by status", "gauge");
+    for (auto status : {QueueStatus::Pending, QueueStatus::Processing, QueueStatus::Completed,
+                        QueueStatus::Failed, QueueStatus::Cancelled, QueueStatus::Deleted}) {
+        write_sample(out, "sdcpp_queue_jobs", metrics::label("status", queue_status_to_string(status)),
+                     static_cast<double>(index_.count(status)));
+    }
+
+    write_header(out, "sdcpp_result_cache_hits_total", "Submissions answered by an identical earlier job", "counter");
+    write_sample(out, "sdcpp_result_cache_hits_total", "", static_cast<double>(dedup_hits_.load()));
+    write_header(out, "sdcpp_result_cache_misses_total", "Fixed-seed submissions that were queued as new jobs", "counter");
+    write_sample(out, "sdcpp_result_cache_misses_total", "", static_cast<double>(dedup_misses_.load()));
+
+    write_header(out, "sdcpp_batch_merged_jobs_total", "txt2img jobs that ran inside another job's generate call", "counter");
+    write_sample(out, "sdcpp_batch_merged_jobs_total", "", static_cast<double>(merged_jobs_.load()));
+}
+
+nlohmann::json QueueManager::get_workers_status() const {
+    std::lock_guard<std::mutex> plock(progress_mutex_);
+    nlohmann::json arr = nlohmann::json::array();
+    for (const auto& slot : workers_) {
+        nlohmann::json w = {
+            {"id", slot->id},
+            {"lane", lane_to_string(slot->lane)},
+            {"busy", !slot->current_job_id.empty()},
+            {"jobs_processed", slot->jobs_processed}
+        };
+        if (slot->lane == WorkerLane::Generation && generation_workers_ > 1) w["device"] = slot->device;
+        if (!slot->current_job_id.empty()) {
+            w["job_id"] = slot->current_job_id;
+            w["progress"] = slot->progress();
+            if (!slot->merged_job_ids.empty()) w["merged_job_ids"] = slot->merged_job_ids;
+        }
+        arr.push_back(std::move(w));
+    }
+    return arr;
+}
+
+void QueueManager::apply_live_progress(QueueItem& item) const {
+    if (item.status != QueueStatus::Processing) return;
+    std::lock_guard<std::mutex> plock(progress_mutex_);
+    for (const auto& slot : workers_) {
+        const auto& merged = slot->merged_job_ids;
+        if (slot->current_job_id == item.job_id ||
+            std::find(merged.begin(), merged.end(), item.job_id) != merged.end()) {
+            item.progress = slot->progress();
+            return;
+        }
+    }
+}
+
 bool QueueManager::cancel_job(const std::string& job_id) {
     std::lock_guard<std::mutex> lock(queue_mutex_);
 
@@ -647,6 +1006,13 @@ bool QueueManager::cancel_job(const std::string& job_id) {
         return false;
     }
 
+    if (it->second.status == QueueStatus::Processing && it->second.params.value("variation_sweep", false)) {
+        sweep_stops_.insert(job_id);
+        std::cout << "[QueueManager] Sweep " << job_id
+                  << " will stop after its current variation" << std::endl;
+        return true;
+    }
+
     if (it->second.status != QueueStatus::Pending) {
         std::cout << "[QueueManager] Cancel failed: job " << job_id
                   << " is " << queue_status_to_string(it->second.status)
@@ -656,15 +1022,15 @@ bool QueueManager::cancel_job(const std::string& job_id) {
 
     it->second.status = QueueStatus::Cancelled;
     it->second.completed_at = std::chrono::system_clock::now();
-    save_state();
+    compact_job_locked(it->second);
+    record_job_locked(it->second);
+    JobTrace::take(job_id);    // never ran: nothing worth exporting
 
     // Broadcast job cancelled event via WebSocket
-    if (auto* ws = get_websocket_server()) {
-        ws->broadcast(WSEventType::JobCancelled, {
-            {"job_id", job_id},
-            {"completed_at", utils::time_to_string(it->second.completed_at)}
-        });
-    }
+    publish_job_event(WSEventType::JobCancelled, {
+        {"job_id", job_id},
+        {"completed_at", utils::time_to_string(it->second.completed_at)}
+    });
 
     std::cout << "[QueueManager] Job cancelled: " << job_id
               << " | type=" << generation_type_to_string(it->second.type) << std::endl;
@@ -701,30 +1067,29 @@ bool QueueManager::delete_job(const std::string& job_id) {
         it->second.previous_status = it->second.status;
         it->second.status = QueueStatus::Deleted;
         it->second.deleted_at = std::chrono::system_clock::now();
-        save_state();
+        record_job_locked(it->second);
 
         // Broadcast job deleted event via WebSocket
-        if (auto* ws = get_websocket_server()) {
-            ws->broadcast(WSEventType::JobDeleted, {
-                {"job_id", job_id},
-                {"soft_delete", true}
-            });
-        }
+        publish_job_event(WSEventType::JobDeleted, {
+            {"job_id", job_id},
+            {"soft_delete", true}
+        });
 
         std::cout << "[QueueManager] Job moved to recycle bin: " << job_id
                   << " | type=" << type << " | was_status=" << status << std::endl;
     } else {
         // Hard delete - permanent removal
+        std::vector<std::string> files;
+        if (recycle_bin_config_.delete_outputs) append_job_files(it->second, files);
+        forget_job_locked(job_id);
         jobs_.erase(it);
-        save_state();
+        output_reaper_.remove(std::move(files));
 
         // Broadcast job deleted event via WebSocket
-        if (auto* ws = get_websocket_server()) {
-            ws->broadcast(WSEventType::JobDeleted, {
-                {"job_id", job_id},
-                {"soft_delete", false}
-            });
-        }
+        publish_job_event(WSEventType::JobDeleted, {
+            {"job_id", job_id},
+            {"soft_delete", false}
+        });
 
         std::cout << "[QueueManager] Job permanently deleted: " << job_id
                   << " | type=" << type << " | was_status=" << status << std::endl;
@@ -734,32 +1099,40 @@ bool QueueManager::delete_job(const std::string& job_id) {
 }
 
 void QueueManager::clear_completed() {
-    std::lock_guard<std::mutex> lock(queue_mutex_);
+    auto finished = [](const QueueItem& item) {
+        return item.status == QueueStatus::Completed ||
+               item.status == QueueStatus::Failed ||
+               item.status == QueueStatus::Cancelled;
+    };
+    std::vector<std::string> ids;
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        for (const auto& [id, item] : jobs_) {
+            if (finished(item)) ids.push_back(id);
+        }
+    }
 
     int cleared = 0;
-    auto now = std::chrono::system_clock::now();
-
-    for (auto it = jobs_.begin(); it != jobs_.end();) {
-        if (it->second.status == QueueStatus::Completed ||
-            it->second.status == QueueStatus::Failed ||
-            it->second.status == QueueStatus::Cancelled) {
-
-            if (recycle_bin_config_.enabled) {
-                // Soft delete - move to recycle bin
+    if (recycle_bin_config_.enabled) {
+        // Soft delete - move to recycle bin, a chunk per lock hold
+        const auto now = std::chrono::system_clock::now();
+        for (size_t i = 0; i < ids.size(); i += PURGE_CHUNK) {
+            std::lock_guard<std::mutex> lock(queue_mutex_);
+            const size_t end = std::min(ids.size(), i + PURGE_CHUNK);
+            for (size_t k = i; k < end; ++k) {
+                auto it = jobs_.find(ids[k]);
+                if (it == jobs_.end() || !finished(it->second)) continue;
                 it->second.previous_status = it->second.status;
                 it->second.status = QueueStatus::Deleted;
                 it->second.deleted_at = now;
-                ++it;
-            } else {
-                // Hard delete
-                it = jobs_.erase(it);
+                record_job_locked(it->second);
+                cleared++;
             }
-            cleared++;
-        } else {
-            ++it;
         }
+    } else {
+        // Hard delete
+        cleared = purge_jobs(ids, finished, recycle_bin_config_.delete_outputs);
     }
-    save_state();
 
     if (recycle_bin_config_.enabled) {
         std::cout << "[QueueManager] Moved " << cleared << " completed/failed/cancelled jobs to recycle bin" << std::endl;
@@ -787,7 +1160,7 @@ bool QueueManager::restore_job(const std::string& job_id) {
     it->second.status = it->second.previous_status;
     it->second.deleted_at = std::chrono::system_clock::time_point{};  // Reset
     it->second.previous_status = QueueStatus::Pending;  // Reset
-    save_state();
+    record_job_locked(it->second);
 
     // Broadcast job restored event via WebSocket
     if (auto* ws = get_websocket_server()) {
@@ -819,16 +1192,17 @@ bool QueueManager::purge_job(const std::string& job_id) {
 
     std::string type = generation_type_to_string(it->second.type);
     std::string status = queue_status_to_string(it->second.status);
+    std::vector<std::string> files;
+    if (recycle_bin_config_.delete_outputs) append_job_files(it->second, files);
     jobs_.erase(it);
-    save_state();
+    forget_job_locked(job_id);
+    output_reaper_.remove(std::move(files));
 
     // Broadcast job deleted event via WebSocket
-    if (auto* ws = get_websocket_server()) {
-        ws->broadcast(WSEventType::JobDeleted, {
-            {"job_id", job_id},
-            {"soft_delete", false}
-        });
-    }
+    publish_job_event(WSEventType::JobDeleted, {
+        {"job_id", job_id},
+        {"soft_delete", false}
+    });
 
     std::cout << "[QueueManager] Job permanently purged: " << job_id
               << " | type=" << type << " | was_status=" << status << std::endl;
@@ -836,12 +1210,13 @@ bool QueueManager::purge_job(const std::string& job_id) {
 }
 
 std::vector<QueueItem> QueueManager::get_deleted_jobs() const {
-    std::lock_guard<std::mutex> lock(queue_mutex_);
-
     std::vector<QueueItem> deleted_jobs;
-    for (const auto& [id, item] : jobs_) {
-        if (item.status == QueueStatus::Deleted) {
-            deleted_jobs.push_back(item);
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        for (const auto& [id, item] : jobs_) {
+            if (item.status == QueueStatus::Deleted) {
+                deleted_jobs.push_back(item);
+            }
         }
     }
 
@@ -855,214 +1230,933 @@ std::vector<QueueItem> QueueManager::get_deleted_jobs() const {
 }
 
 int QueueManager::purge_expired_jobs() {
-    std::lock_guard<std::mutex> lock(queue_mutex_);
-
-    auto now = std::chrono::system_clock::now();
-    auto retention = std::chrono::minutes(recycle_bin_config_.retention_minutes);
-    int purged = 0;
-
-    for (auto it = jobs_.begin(); it != jobs_.end();) {
-        if (it->second.status == QueueStatus::Deleted) {
-            auto age = now - it->second.deleted_at;
-            if (age > retention) {
-                std::cout << "[QueueManager] Purging expired job: " << it->first << std::endl;
-                it = jobs_.erase(it);
-                purged++;
-            } else {
-                ++it;
-            }
-        } else {
-            ++it;
+    const auto retention = std::chrono::minutes(recycle_bin_config_.retention_minutes);
+    auto expired = [retention, now = std::chrono::system_clock::now()](const QueueItem& item) {
+        return item.status == QueueStatus::Deleted && now - item.deleted_at > retention;
+    };
+    std::vector<std::string> ids;
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        for (const auto& [id, item] : jobs_) {
+            if (expired(item)) ids.push_back(id);
         }
     }
 
+    int purged = purge_jobs(ids, expired, recycle_bin_config_.delete_outputs);
     if (purged > 0) {
-        save_state();
+        std::cout << "[QueueManager] Purged " << purged << " expired jobs from recycle bin" << std::endl;
     }
-
     return purged;
 }
 
 int QueueManager::clear_recycle_bin() {
-    std::lock_guard<std::mutex> lock(queue_mutex_);
-
-    int purged = 0;
-    for (auto it = jobs_.begin(); it != jobs_.end();) {
-        if (it->second.status == QueueStatus::Deleted) {
-            it = jobs_.erase(it);
-            purged++;
-        } else {
-            ++it;
+    auto deleted = [](const QueueItem& item) { return item.status == QueueStatus::Deleted; };
+    std::vector<std::string> ids;
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        for (const auto& [id, item] : jobs_) {
+            if (deleted(item)) ids.push_back(id);
         }
     }
 
-    if (purged > 0) {
-        save_state();
-    }
-
+    int purged = purge_jobs(ids, deleted, recycle_bin_config_.delete_outputs);
     std::cout << "[QueueManager] Cleared recycle bin: " << purged << " jobs purged" << std::endl;
     return purged;
 }
 
 ProgressInfo QueueManager::get_current_progress() const {
     std::lock_guard<std::mutex> lock(progress_mutex_);
-    return current_progress_;
+    // The first busy generation worker (several with queue.generation_devices)
+    const WorkerSlot* first = nullptr;
+    for (const auto& slot : workers_) {
+        if (slot->lane != WorkerLane::Generation) continue;
+        if (!slot->current_job_id.empty()) return slot->progress();
+        if (!first) first = slot.get();
+    }
+    return first ? first->progress() : ProgressInfo{};
 }
 
-void QueueManager::worker_thread() {
-    while (running_) {
-        std::string job_id;
-        GenerationType job_type = GenerationType::Text2Image;
-        nlohmann::json job_params;
-        std::chrono::system_clock::time_point job_start_time;
+bool QueueManager::has_runnable_job_locked(const WorkerSlot& slot) const {
+    for (const auto& id : pending_queue_) {
+        auto it = jobs_.find(id);
+        if (it == jobs_.end() || it->second.status != QueueStatus::Pending) {
+            return true;  // stale entry; let a worker drain it
+        }
+        const GenerationType type = it->second.type;
+        const bool remote = runs_remote(type, it->second.params);
+        if (slot.lane == WorkerLane::Remote || remote) {
+            if (slot.lane == WorkerLane::Remote && remote) return true;
+            continue;
+        }
+        if (slot.lane == WorkerLane::Post) {
+            if (runs_on_post_lane(type) && !post_vram_blocked_) return true;
+            continue;
+        }
+        WorkerLane lane = lane_for(type);
+        if (lane == slot.lane && !(slot.lane == WorkerLane::Generation &&
+                                   (generation_defers_locked(type) || !runs_on_device_locked(slot, type)))) {
+            return true;
+        }
+        if (lane == WorkerLane::Io && may_steal_io_locked(slot)) return true;
+    }
+    return false;
+}
+
+bool QueueManager::runs_on_device_locked(const WorkerSlot& slot, GenerationType type) const {
+    if (slot.device == 0) return true;
+    return type != GenerationType::ADetailer && type != GenerationType::Pipeline &&
+           model_manager_.is_model_loaded(slot.device);
+}
+
+size_t QueueManager::current_device() {
+    return current_slot_ ? current_slot_->device : 0;
+}
+
+bool QueueManager::generation_defers_locked(GenerationType type) const {
+    return runs_on_post_lane(type) && has_post_worker_ && !post_vram_blocked_;
+}
+
+bool QueueManager::post_admits_locked(const MemoryInfo& mem) const {
+    if (!generation_busy_) return true;
+    // Beside a running generation: the upscaler's working set plus the
+    // reserve must fit in what the generation leaves free. Without VRAM
+    // numbers (CPU backend) there is nothing to run out of.
+    if (!mem.gpu_available) return true;
+    const uint64_t need = upscaler_vram_estimate(model_manager_.get_upscaler_tile_size()) +
+                          static_cast<uint64_t>(queue_config_.post_vram_reserve_mb) * 1024 * 1024;
+    return mem.gpu_free >= need;
+}
+
+bool QueueManager::may_steal_io_locked(const WorkerSlot& slot) const {
+    if (slot.lane != WorkerLane::Generation) return false;
+    // With no I/O workers the generation lane runs everything (the old
+    // single-worker behaviour). Otherwise an idle generation worker only
+    // steals once every I/O worker is busy, so a free I/O worker is never
+    // beaten to a download that would then block generations behind it.
+    if (queue_config_.io_workers == 0) return true;
+    return queue_config_.work_stealing && busy_io_workers_ >= queue_config_.io_workers;
+}
+
+QueueManager::VramPlan QueueManager::plan_vram(GenerationType type, const nlohmann::json& params,
+                                               const MemoryInfo& mem, bool whole_device,
+                                               bool allow_downgrade) const {
+    constexpr uint64_t GiB = 1024ull * 1024 * 1024;
+    const VramModelInfo model = model_manager_.get_vram_model_info();
+    const bool video = type == GenerationType::Text2Video;
+    const uint64_t headroom = static_cast<uint64_t>(queue_config_.vram_headroom_mb) * 1024 * 1024;
+
+    VramPlan plan;
+    plan.estimate = estimate_job_vram(params, video, model);
+    plan.planned = plan.estimate;
+
+    // The loaded weights already count in gpu_used, so at pickup only the
+    // compute buffers have to fit in what is free
+    auto fits = [&](const VramEstimate& e, uint64_t freed) {
+        return whole_device ? e.peak() + headroom <= mem.gpu_total
+                            : e.compute() + headroom <= mem.gpu_free + freed;
+    };
+    plan.fits = fits(plan.planned, 0);
+    if (plan.fits || !allow_downgrade) return plan;
+
+    // 1. Decode in tiles, when the VAE is what does not fit
+    const auto tiling = params.find("vae_tiling");
+    const bool tiled = tiling != params.end() && tiling->is_boolean() && tiling->get<bool>();
+    if (!tiled && plan.planned.vae > plan.planned.diffusion) {
+        nlohmann::json with_tiling = params;
+        with_tiling["vae_tiling"] = true;
+        plan.planned = estimate_job_vram(with_tiling, video, model);
+        plan.param_changes["vae_tiling"] = true;
+        plan.fits = fits(plan.planned, 0);
+        if (plan.fits) return plan;
+    }
+
+    // 2. Keep only part of the weights resident, leaving room for the
+    // compute buffers. Under 1 GiB streaming would do nothing but transfer.
+    if (mem.gpu_total > plan.planned.compute() + headroom) {
+        const uint64_t budget = mem.gpu_total - plan.planned.compute() - headroom;
+        if (budget >= GiB && budget < plan.planned.weights) {
+            const double gib = std::floor(static_cast<double>(budget) / GiB * 10.0) / 10.0;
+            const uint64_t resident = static_cast<uint64_t>(gib * GiB);
+            plan.load_options = {{"max_vram", gib}, {"stream_layers", true}};
+            const uint64_t freed = plan.planned.weights - resident;
+            plan.planned.weights = resident;
+            plan.fits = fits(plan.planned, freed);
+        }
+    }
+    return plan;
+}
+
+std::string QueueManager::vram_refusal(const VramPlan& plan, const MemoryInfo& mem, bool whole_device) const {
+    const VramEstimate& e = plan.estimate;
+    std::string msg = "Not enough VRAM: estimated peak " + format_bytes(e.peak()) +
+                      " (weights " + format_bytes(e.weights) +
+                      ", sampling " + format_bytes(e.diffusion) +
+                      ", VAE " + format_bytes(e.vae) + ")";
+    msg += whole_device ? " does not fit the " + format_bytes(mem.gpu_total) + " GPU"
+                        : " needs " + format_bytes(e.compute()) + " beyond the loaded weights, " +
+                          format_bytes(mem.gpu_free) + " free";
+    msg += " (queue.vram_admission=" + queue_config_.vram_admission + ", headroom " +
+           std::to_string(queue_config_.vram_headroom_mb) + " MB). ";
+    msg += "Lower the resolution or frames, enable vae_tiling, or load the model with max_vram and stream_layers";
+    return msg;
+}
+
+bool QueueManager::vram_admits_locked(const QueueItem& item, const MemoryInfo& mem) const {
+    if (!runs_vram_admission(item.type) || !model_manager_.is_model_loaded()) return true;
+    return plan_vram(item.type, item.params, mem, false, false).fits;
+}
+
+std::string QueueManager::check_vram_admission(GenerationType type, const nlohmann::json& params) const {
+    if (!vram_admission_enabled() || !runs_vram_admission(type) || !model_manager_.is_model_loaded()) return "";
+    const MemoryInfo mem = get_memory_info();
+    if (!mem.gpu_available || mem.gpu_total == 0) return "";
+    const VramPlan plan = plan_vram(type, params, mem, true, queue_config_.vram_admission == "auto");
+    if (plan.fits) return "";
+    vram_refused_++;
+    return vram_refusal(plan, mem, true);
+}
+
+void QueueManager::admit_vram_unlocked(const std::string& job_id, GenerationType type, nlohmann::json& params) {
+    if (!vram_admission_enabled() || !runs_vram_admission(type) || !model_manager_.is_model_loaded()) return;
+    const MemoryInfo mem = get_memory_info();
+    if (!mem.gpu_available || mem.gpu_total == 0) return;
+
+    const std::string& policy = queue_config_.vram_admission;
+    const VramPlan plan = plan_vram(type, params, mem, false, policy == "auto");
+    nlohmann::json record = plan.estimate.to_json();
+    record["policy"] = policy;
+    record["gpu_free_bytes"] = mem.gpu_free;
+    record["admitted"] = plan.fits;
+    if (!plan.fits) {
+        vram_refused_++;
+        set_job_metadata(job_id, "vram", record);
+        throw std::runtime_error(vram_refusal(plan, mem, false));
+    }
+
+    nlohmann::json downgrades = nlohmann::json::array();
+    for (const auto& [key, value] : plan.param_changes.items()) {
+        params[key] = value;
+        downgrades.push_back(key);
+    }
+    if (!plan.load_options.empty()) {
+        std::cout << "[QueueManager] Job " << job_id << " | VRAM admission: reloading the model with "
+                  << plan.load_options.dump() << std::endl;
+        if (!model_manager_.reload_with_options(plan.load_options)) {
+            throw std::runtime_error("VRAM admission: reloading the model with " + plan.load_options.dump() +
+                                     " failed: " + model_manager_.get_last_load_error());
+        }
+        for (const auto& [key, value] : plan.load_options.items()) downgrades.push_back(key);
+        record["load_options"] = plan.load_options;
+    }
+    if (!downgrades.empty()) {
+        vram_downgraded_++;
+        record["downgrades"] = downgrades;
+        record["planned_peak_bytes"] = plan.planned.peak();
+        std::cout << "[QueueManager] Job " << job_id << " | VRAM admission: estimated "
+                  << format_bytes(plan.estimate.peak()) << ", running with " << downgrades.dump()
+                  << " (" << format_bytes(plan.planned.peak()) << ")" << std::endl;
+    }
+    set_job_metadata(job_id, "vram", record);
+}
+
+bool QueueManager::needs_memory_sample_locked(const WorkerSlot& slot) const {
+    if (slot.lane == WorkerLane::Post) return generation_busy_;
+    return slot.lane == WorkerLane::Generation && queue_config_.vram_admission == "wait" &&
+           model_manager_.is_model_loaded();
+}
+
+bool QueueManager::take_next_job_locked(WorkerSlot& slot, std::string& job_id, const MemoryInfo& mem) {
+    // Drop entries cancelled/deleted while queued
+    for (auto qit = pending_queue_.begin(); qit != pending_queue_.end(); ) {
+        auto it = jobs_.find(*qit);
+        if (it == jobs_.end() || it->second.status != QueueStatus::Pending) {
+            scheduler_.forget(*qit);
+            qit = pending_queue_.erase(qit);
+        } else {
+            ++qit;
+        }
+    }
+
+    auto claim = [&](const std::string& id) {
+        auto qit = std::find(pending_queue_.begin(), pending_queue_.end(), id);
+        pending_queue_.erase(qit);
+        if (slot.lane == WorkerLane::Io) busy_io_workers_++;
+        if (slot.lane == WorkerLane::Generation) generation_busy_++;
+        auto& item = jobs_[id];
+        item.status = QueueStatus::Processing;
+        item.started_at = utils::get_time_now();
+        record_job_locked(item);
+        job_id = id;
+    };
+
+    if (slot.lane == WorkerLane::Post) {
+        // FIFO over upscale jobs, admitted against the free VRAM
+        for (const auto& id : pending_queue_) {
+            if (!runs_on_post_lane(jobs_.at(id).type)) continue;
+            if (!post_admits_locked(mem)) {
+                // Hand upscales back to the generation lane until the
+                // running generation ends
+                std::cout << "[QueueManager] Post worker: not enough free VRAM beside the running generation, "
+                          << "deferring " << id << std::endl;
+                post_vram_blocked_ = true;
+                queue_cv_.notify_all();
+                return false;
+            }
+            claim(id);
+            return true;
+        }
+        return false;
+    }
+
+    if (slot.lane == WorkerLane::Remote) {
+        // FIFO over remote generations, each to the best free node with its
+        // model. A job no node serves waits the fairness bound for one to
+        // come up (or load the model), then fails on the worker.
+        const auto now = utils::get_time_now();
+        bool held = false;
+        for (const auto& id : pending_queue_) {
+            const auto& item = jobs_.at(id);
+            if (!runs_remote(item.type, item.params)) continue;
+            const std::string model = item.params.value("model", "");
+            const int node = cluster_->acquire(model, JobScheduler::affinity_key(item.params, item.settings()));
+            if (node < 0 && (cluster_->serves(model) ||
+                             now - item.created_at < std::chrono::seconds(queue_config_.affinity_max_wait_seconds))) {
+                held = true;
+                continue;
+            }
+            remote_held_ = false;
+            slot.remote_node = node;
+            claim(id);
+            return true;
+        }
+        remote_held_ = held;
+        return false;
+    }
+
+    if (slot.lane == WorkerLane::Generation) {
+        // Generation lane: let the scheduler pick among the oldest pending
+        // generation jobs (affinity-aware, bounded wait).
+        std::vector<JobScheduler::Candidate> candidates;
+        // "wait": a job that does not fit next to what holds the GPU now
+        // lets smaller ones go first, until it has waited the fairness bound
+        // (`mem` is the first GPU's, for every device)
+        const bool vram_wait = queue_config_.vram_admission == "wait" && model_manager_.is_model_loaded();
+        const auto now = utils::get_time_now();
+        bool held = false;
+        for (const auto& id : pending_queue_) {
+            const auto& item = jobs_.at(id);
+            if (lane_for(item.type) != WorkerLane::Generation) continue;
+            if (generation_defers_locked(item.type) || runs_remote(item.type, item.params) ||
+                !runs_on_device_locked(slot, item.type)) {
+                continue;
+            }
+            if (vram_wait && mem.gpu_available &&
+                now - item.created_at < std::chrono::seconds(queue_config_.affinity_max_wait_seconds) &&
+                !vram_admits_locked(item, mem)) {
+                held = true;
+                continue;
+            }
+            candidates.push_back({id, "", item.created_at, item.priority, item.owner});
+        }
+        // Every runnable job is ranked; only the kept ones pay for a key
+        scheduler_.rank(candidates);
+        for (auto& candidate : candidates) {
+            const auto& item = jobs_.at(candidate.job_id);
+            candidate.affinity_key = JobScheduler::affinity_key(item.params, item.settings());
+        }
+        if (!candidates.empty()) {
+            JobScheduler::Reason reason = JobScheduler::Reason::Fifo;
+            size_t idx = scheduler_.pick(candidates, &reason, slot.id);
+            if (idx > 0 || (reason != JobScheduler::Reason::Fifo && reason != JobScheduler::Reason::Affinity)) {
+                std::cout << "[QueueManager] Scheduler: " << candidates[idx].job_id
+                          << " | reason=" << JobScheduler::reason_to_string(reason)
+                          << " | passed_over=" << idx << std::endl;
+            }
+            vram_held_ = false;
+            claim(candidates[idx].job_id);
+            return true;
+        }
+        vram_held_ = held;
+        if (held) return false;
+    }
+
+    // I/O lane, or a generation worker stealing: FIFO over I/O jobs
+    if (slot.lane == WorkerLane::Io || may_steal_io_locked(slot)) {
+        for (const auto& id : pending_queue_) {
+            if (lane_for(jobs_.at(id).type) == WorkerLane::Io) {
+                claim(id);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+namespace {
+
+// A concrete seed for a "seed": -1 job that must keep one across calls
+int64_t pick_random_seed() {
+    static thread_local std::mt19937_64 rng{std::random_device{}()};
+    return static_cast<int64_t>(rng() % 0x7fffffff);
+}
+
+// Params that may differ between txt2img jobs merged into one call
+const char* const MERGE_VARYING_KEYS[] = {
+    "seed", "batch_count",
+    "variation_group_id", "variation_index", "variation_total", "variation_template",
+};
+
+// Everything else must match for two jobs to share a generate_image call
+std::string merge_key(const QueueItem& item) {
+    nlohmann::json p = item.params;
+    for (const char* key : MERGE_VARYING_KEYS) p.erase(key);
+    return p.dump() + '\n' + item.settings().dump();
+}
+
+// seed and batch_count as stored; false if either isn't a plain integer
+bool merge_seed(const nlohmann::json& params, int64_t& seed, int& batch_count) {
+    seed = -1;
+    batch_count = 1;
+    if (params.contains("seed")) {
+        if (!params["seed"].is_number_integer()) return false;
+        seed = params["seed"].get<int64_t>();
+    }
+    if (params.contains("batch_count")) {
+        if (!params["batch_count"].is_number_integer()) return false;
+        batch_count = params["batch_count"].get<int>();
+    }
+    return batch_count >= 1;
+}
 
-        // Step 1: Get next job (with lock)
+bool merge_eligible(const QueueItem& item) {
+    // Hi-res fix may return a different number of images than requested,
+    // which would misassign outputs between the jobs
+    return item.type == GenerationType::Text2Image &&
+           !item.params.value("variation_sweep", false) &&
+           !(item.params.contains("hires_enabled") && item.params["hires_enabled"].is_boolean() &&
+             item.params["hires_enabled"].get<bool>());
+}
+
+} // namespace
+
+std::vector<std::string> QueueManager::take_merge_partners_locked(const std::string& lead_id) {
+    std::vector<std::string> partners;
+    const int max_images = queue_config_.max_batch_images;
+    auto& lead = jobs_.at(lead_id);
+
+    int64_t lead_seed = -1;
+    int total = 0;
+    if (max_images <= 1 || !merge_eligible(lead) || !merge_seed(lead.params, lead_seed, total) ||
+        total >= max_images) {
+        return partners;
+    }
+
+    // sd.cpp seeds image b of a batch with seed + b, so jobs whose seeds
+    // continue the lead's run get exactly the images they'd get alone.
+    // Random-seed jobs only merge with other random-seed jobs.
+    const bool random_seed = lead_seed < 0;
+    const int64_t base_seed = random_seed ? pick_random_seed() : lead_seed;
+
+    const std::string key = merge_key(lead);
+    int64_t next_seed = base_seed + total;
+    size_t scanned = 0;
+    const size_t limit = scheduler_.lookahead();
+    for (const auto& id : pending_queue_) {
+        if (total >= max_images || scanned++ >= limit) break;
+        auto& item = jobs_.at(id);
+        int64_t seed;
+        int count;
+        if (!merge_eligible(item) || !merge_seed(item.params, seed, count)) continue;
+        if (total + count > max_images) continue;
+        if (random_seed ? seed >= 0 : seed != next_seed) continue;
+        if (merge_key(item) != key) continue;
+        partners.push_back(id);
+        total += count;
+        next_seed += count;
+    }
+    if (partners.empty()) return partners;
+
+    auto now = utils::get_time_now();
+    int64_t seed = base_seed;
+    auto assign = [&](QueueItem& item) {
+        int64_t s;
+        int count;
+        merge_seed(item.params, s, count);
+        item.params["seed"] = seed;
+        seed += count;
+    };
+    if (random_seed) {
+        assign(lead);
+        record_job_locked(lead);
+    }
+
+    for (const auto& id : partners) {
+        pending_queue_.erase(std::find(pending_queue_.begin(), pending_queue_.end(), id));
+        scheduler_.forget(id);
+        auto& item = jobs_.at(id);
+        if (random_seed) assign(item);
+        item.status = QueueStatus::Processing;
+        item.started_at = now;
+        record_job_locked(item);
+    }
+    merged_calls_++;
+    merged_jobs_ += partners.size();
+    return partners;
+}
+
+void QueueManager::worker_thread(WorkerSlot* slot) {
+    current_slot_ = slot;
+    // The post worker reports its own progress; sd.cpp's callbacks on this
+    // thread belong to whatever generation is running
+    if (slot->lane == WorkerLane::Post) SDWrapper::set_thread_progress_muted(true);
+    JobTrace::set_thread_name(std::string(lane_to_string(slot->lane)) + "-" + std::to_string(slot->id));
+
+    while (running_) {
+        std::string job_id;
+        GenerationType job_type = GenerationType::Text2Image;
+        nlohmann::json job_params;
+        std::chrono::system_clock::time_point job_start_time;
+        std::chrono::system_clock::time_point job_created_at;
+        std::vector<MergedJob> merged;
+        std::vector<std::chrono::system_clock::time_point> merged_created_at;
+        int64_t pick_start_us = 0;
+        int64_t pick_end_us = 0;
+
+        // Step 1: Get next job for this worker's lane (with lock)
         {
             std::unique_lock<std::mutex> lock(queue_mutex_);
-            queue_cv_.wait(lock, [this] {
-                return !running_ || !pending_queue_.empty();
+            queue_cv_.wait(lock, [this, slot] {
+                return !running_ || has_runnable_job_locked(*slot);
             });
 
             if (!running_) break;
 
-            // Find next non-cancelled job
-            while (!pending_queue_.empty()) {
-                job_id = pending_queue_.front();
-                pending_queue_.pop();
-
-                auto it = jobs_.find(job_id);
-                if (it != jobs_.end() && it->second.status == QueueStatus::Pending) {
-                    it->second.status = QueueStatus::Processing;
-                    it->second.started_at = utils::get_time_now();
-                    job_start_time = it->second.started_at;
-                    // Copy data we need for processing
-                    job_type = it->second.type;
-                    job_params = it->second.params;
-
-                    // Broadcast status change via WebSocket. Include started_at
-                    // so the frontend can render the live elapsed-time counter
-                    // immediately — it doesn't have access to it otherwise
-                    // until a separate /queue refresh.
-                    if (auto* ws = get_websocket_server()) {
-                        ws->broadcast(WSEventType::JobStatusChanged, {
-                            {"job_id", job_id},
-                            {"status", "processing"},
-                            {"previous_status", "pending"},
-                            {"started_at", utils::time_to_string(it->second.started_at)}
-                        });
-                    }
-
-                    std::cout << "[QueueManager] Job status: " << job_id
-                              << " | pending -> processing"
-                              << " | type=" << generation_type_to_string(job_type)
-                              << " | remaining_in_queue=" << pending_queue_.size() << std::endl;
-                    break;
+            if (JobTrace::enabled()) pick_start_us = JobTrace::now_us();
+            // Device memory is a driver query: never with queue_mutex_ held.
+            // The take re-checks everything under the lock afterwards.
+            MemoryInfo mem;
+            if (needs_memory_sample_locked(*slot)) {
+                lock.unlock();
+                mem = get_memory_info();
+                lock.lock();
+                if (!running_) break;
+            }
+            if (!take_next_job_locked(*slot, job_id, mem)) {
+                // Jobs held back for VRAM stay runnable; look again once
+                // something finishes or memory may have been freed
+                if (slot->lane == WorkerLane::Generation && vram_held_) {
+                    queue_cv_.wait_for(lock, VRAM_RECHECK_INTERVAL);
+                } else if (slot->lane == WorkerLane::Remote && remote_held_) {
+                    // Nodes free up on our own jobs (notify) or on a poll
+                    queue_cv_.wait_for(lock, cluster_->health_interval());
                 }
-                job_id.clear();
+                continue;
+            }
+
+            auto it = jobs_.find(job_id);
+            std::vector<std::string> partners;
+            if (slot->lane == WorkerLane::Generation && it->second.type == GenerationType::Text2Image) {
+                partners = take_merge_partners_locked(job_id);
+            }
+
+            job_start_time = it->second.started_at;
+            job_created_at = it->second.created_at;
+            // Copy data we need for processing
+            job_type = it->second.type;
+            job_params = it->second.params;
+            for (const auto& id : partners) {
+                const auto& item = jobs_.at(id);
+                merged.push_back(MergedJob{id, item.params, item.started_at, nullptr, {}});
+                merged_created_at.push_back(item.created_at);
             }
+            if (JobTrace::enabled()) pick_end_us = JobTrace::now_us();
 
-            if (job_id.empty()) continue;
+            // Broadcast status change via WebSocket. Include started_at
+            // so the frontend can render the live elapsed-time counter
+            // immediately — it doesn't have access to it otherwise
+            // until a separate /queue refresh.
+            publish_job_event(WSEventType::JobStatusChanged, {
+                {"job_id", job_id},
+                {"status", "processing"},
+                {"previous_status", "pending"},
+                {"started_at", utils::time_to_string(it->second.started_at)}
+            });
+            for (const auto& m : merged) {
+                publish_job_event(WSEventType::JobStatusChanged, {
+                    {"job_id", m.job_id},
+                    {"status", "processing"},
+                    {"previous_status", "pending"},
+                    {"started_at", utils::time_to_string(m.started_at)},
+                    {"merged_into", job_id}
+                });
+            }
+
+            std::cout << "[QueueManager] Job status: " << job_id
+                      << " | pending -> processing"
+                      << " | type=" << generation_type_to_string(job_type)
+                      << " | worker=" << slot->id << "/" << lane_to_string(slot->lane)
+                      << " | remaining_in_queue=" << pending_queue_.size() << std::endl;
+            for (const auto& m : merged) {
+                std::cout << "[QueueManager] Job status: " << m.job_id
+                          << " | pending -> processing | merged into " << job_id << std::endl;
+            }
         }
         // Lock released here
 
+        // Queue wait and the pick itself, on the traces of every job taken
+        auto trace = JobTrace::find(job_id);
+        std::vector<std::shared_ptr<JobTrace>> merged_traces;
+        auto trace_pick = [&](JobTrace* t) {
+            if (!t) return;
+            t->complete("queued", "queue", t->created_us(), pick_start_us);
+            t->complete("scheduler_pick", "queue", pick_start_us, pick_end_us);
+        };
+        trace_pick(trace.get());
+        for (const auto& m : merged) {
+            merged_traces.push_back(JobTrace::find(m.job_id));
+            trace_pick(merged_traces.back().get());
+            if (merged_traces.back()) merged_traces.back()->instant("merged into " + job_id, "queue");
+        }
+
         // Step 2: Set progress tracking (with progress lock only)
         {
             std::lock_guard<std::mutex> plock(progress_mutex_);
-            current_job_id_ = job_id;
-            current_progress_ = ProgressInfo{};
+            slot->current_job_id = job_id;
+            slot->merged_job_ids.clear();
+            for (const auto& m : merged) slot->merged_job_ids.push_back(m.job_id);
+            slot->live_step = 0;
+            slot->live_total_steps = 0;
         }
 
-        // Step 3: Process job WITHOUT holding queue_mutex_
+        // Step 3: Process job WITHOUT holding queue_mutex_. Generation jobs
+        // hand their images to the output pipeline instead of encoding them
+        // here, so this worker can start sampling the next job right away.
         std::vector<std::string> outputs;
         std::string error_message;
         bool success = false;
 
+        std::shared_ptr<OutputBatch> batch;
+        if (output_pipeline_.running() && slot->lane != WorkerLane::Io && slot->lane != WorkerLane::Remote) {
+            batch = output_pipeline_.begin_batch();
+            batch->set_trace(trace);
+            for (size_t i = 0; i < merged.size(); ++i) {
+                merged[i].batch = output_pipeline_.begin_batch();
+                merged[i].batch->set_trace(merged_traces[i]);
+            }
+        }
+        slot->output_batch = batch.get();
+        slot->merged_jobs = merged.empty() ? nullptr : &merged;
+
+        JobTimings timings;
         try {
-            outputs = process_job_unlocked(job_type, job_params, job_id);
+            JobTimings::Scope timing_scope(timings);
+            JobTrace::Scope trace_scope(trace.get());
+            if (slot->lane == WorkerLane::Remote) {
+                outputs = process_remote_unlocked(job_type, job_params, job_id, slot->remote_node);
+            } else {
+                if (slot->lane == WorkerLane::Generation) admit_vram_unlocked(job_id, job_type, job_params);
+                outputs = process_job_unlocked(job_type, job_params, job_id);
+            }
             success = true;
         } catch (const std::exception& e) {
             error_message = e.what();
             std::cerr << "[QueueManager] Job error: " << job_id << " | " << e.what() << std::endl;
         }
+        slot->output_batch = nullptr;
+        slot->merged_jobs = nullptr;
 
-        // Calculate duration
-        auto job_end_time = utils::get_time_now();
-        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(job_end_time - job_start_time).count();
-        float duration_sec = duration / 1000.0f;
-
-        // Step 4: Save final progress and update job status
+        // Merged jobs shared the lead's run; only their queue wait differs
+        auto wait_ms = [](std::chrono::system_clock::time_point created,
+                          std::chrono::system_clock::time_point started) {
+            return std::chrono::duration_cast<std::chrono::milliseconds>(started - created).count();
+        };
+        timings.set_queue_wait_ms(wait_ms(job_created_at, job_start_time));
         {
-            // First, capture the final progress
-            ProgressInfo final_progress;
-            {
-                std::lock_guard<std::mutex> plock(progress_mutex_);
-                final_progress = current_progress_;
+            auto& wait_hist = metrics::registry().job_queue_wait.with({generation_type_to_string(job_type)});
+            wait_hist.observe(wait_ms(job_created_at, job_start_time) / 1000.0);
+            for (size_t i = 0; i < merged.size(); ++i) {
+                wait_hist.observe(wait_ms(merged_created_at[i], merged[i].started_at) / 1000.0);
             }
+        }
+        const nlohmann::json run_timings = timings.to_json();
+        set_job_metadata(job_id, "timings", run_timings);
+        for (size_t i = 0; i < merged.size(); ++i) {
+            nlohmann::json t = run_timings;
+            t["queue_wait_ms"] = wait_ms(merged_created_at[i], merged[i].started_at);
+            t["merged_into"] = job_id;
+            set_job_metadata(merged[i].job_id, "timings", t);
+        }
 
-            // Then update the job with final progress and status
+        // Step 4: Publish the final status — now, or once the outputs are on disk
+        const ProgressInfo final_progress = slot->progress();
+        {
             std::lock_guard<std::mutex> lock(queue_mutex_);
-            auto it = jobs_.find(job_id);
-            if (it != jobs_.end()) {
-                // Save final progress to job record
-                it->second.progress = final_progress;
-
-                // Set completed_at FIRST so we can include it in the
-                // broadcast — frontend uses it to switch from the live
-                // elapsed-time counter to the static duration display.
-                it->second.completed_at = job_end_time;
-                const std::string completed_at_iso = utils::time_to_string(job_end_time);
-
-                if (success) {
-                    it->second.status = QueueStatus::Completed;
-                    it->second.outputs = outputs;
-
-                    // Broadcast job completed via WebSocket
-                    if (auto* ws = get_websocket_server()) {
-                        ws->broadcast(WSEventType::JobStatusChanged, {
-                            {"job_id", job_id},
-                            {"status", "completed"},
-                            {"previous_status", "processing"},
-                            {"outputs", outputs},
-                            {"completed_at", completed_at_iso}
-                        });
-                    }
-
-                    std::cout << "[QueueManager] Job status: " << job_id
-                              << " | processing -> completed"
-                              << " | duration=" << std::fixed << std::setprecision(1) << duration_sec << "s"
-                              << " | outputs=" << outputs.size() << std::endl;
-                } else {
-                    it->second.status = QueueStatus::Failed;
-                    it->second.error_message = error_message;
-
-                    // Broadcast job failed via WebSocket
-                    if (auto* ws = get_websocket_server()) {
-                        ws->broadcast(WSEventType::JobStatusChanged, {
-                            {"job_id", job_id},
-                            {"status", "failed"},
-                            {"previous_status", "processing"},
-                            {"error", error_message},
-                            {"completed_at", completed_at_iso}
-                        });
-                    }
+            if (slot->lane == WorkerLane::Io) {
+                // A generation worker blocked on "all I/O workers busy" may steal again
+                busy_io_workers_--;
+            } else if (slot->lane == WorkerLane::Generation) {
+                // The generation's VRAM is back: the post worker may try again
+                generation_busy_--;
+                post_vram_blocked_ = false;
+
+                // Fair share: the run's time, split over the jobs it served
+                const double share = std::chrono::duration<double>(utils::get_time_now() - job_start_time).count() /
+                                     static_cast<double>(1 + merged.size());
+                if (auto it = jobs_.find(job_id); it != jobs_.end()) scheduler_.charge(it->second.owner, share);
+                for (const auto& m : merged) {
+                    if (auto it = jobs_.find(m.job_id); it != jobs_.end()) scheduler_.charge(it->second.owner, share);
+                }
+            } else if (slot->lane == WorkerLane::Remote) {
+                // process_remote_unlocked released the node: waiting jobs may take it
+                slot->remote_node = -1;
+            }
+            queue_cv_.notify_all();
+        }
 
-                    std::cout << "[QueueManager] Job status: " << job_id
-                              << " | processing -> failed"
-                              << " | duration=" << std::fixed << std::setprecision(1) << duration_sec << "s"
-                              << " | error=\"" << error_message << "\"" << std::endl;
+        auto publish = [&](const std::string& id, bool ok, const std::vector<std::string>& outs,
+                           const std::string& error, const std::shared_ptr<OutputBatch>& out_batch,
+                           std::chrono::system_clock::time_point start_time) {
+            if (ok && out_batch && out_batch->size() > 0) {
+                {
+                    std::lock_guard<std::mutex> lock(queue_mutex_);
+                    auto it = jobs_.find(id);
+                    if (it != jobs_.end()) it->second.progress = final_progress;
                 }
+                std::cout << "[QueueManager] Job " << id << " | sampling done, writing "
+                          << out_batch->size() << " output(s) in background" << std::endl;
+
+                const auto sampled_at = std::chrono::steady_clock::now();
+                out_batch->finish([this, id, outs, start_time, final_progress, sampled_at](const OutputBatch::Result& result) {
+                    // Background encode/write, after the run itself
+                    if (auto job = get_job(id); job && job->metadata.contains("timings")) {
+                        nlohmann::json t = job->metadata["timings"];
+                        t["save_ms"] = std::chrono::duration_cast<std::chrono::milliseconds>(
+                            std::chrono::steady_clock::now() - sampled_at).count();
+                        set_job_metadata(id, "timings", t);
+                    }
+                    std::vector<std::string> written;
+                    for (const auto& out : outs) {
+                        if (std::find(result.failed_refs.begin(), result.failed_refs.end(), out) == result.failed_refs.end()) {
+                            written.push_back(out);
+                        }
+                    }
+                    if (written.empty()) {
+                        finish_job(id, false, {}, "Failed to write output images", start_time, final_progress);
+                    } else {
+                        finish_job(id, true, written, "", start_time, final_progress);
+                    }
+                    export_trace(id);
+                });
+            } else {
+                // A failed job may still have queued images; let them drain unobserved
+                if (out_batch) out_batch->finish(nullptr);
+                finish_job(id, ok, outs, error, start_time, final_progress);
+                export_trace(id);
             }
+        };
+
+        publish(job_id, success, outputs, error_message, batch, job_start_time);
+        for (const auto& m : merged) {
+            // A merged job shares the lead's fate, except that it can come
+            // back short if sd.cpp returned fewer images than asked for
+            const bool ok = success && !m.outputs.empty();
+            publish(m.job_id, ok, m.outputs,
+                    success ? "Image generation failed - no valid images produced" : error_message,
+                    m.batch, m.started_at);
         }
 
         // Step 5: Clear progress tracking and preview buffer
         {
             std::lock_guard<std::mutex> plock(progress_mutex_);
-            current_job_id_.clear();
+            slot->current_job_id.clear();
+            slot->merged_job_ids.clear();
+            slot->jobs_processed += 1 + merged.size();
         }
         clear_preview_buffer(job_id);
+    }
+}
+
+void QueueManager::finish_job(const std::string& job_id, bool success,
+                              const std::vector<std::string>& outputs,
+                              const std::string& error_message,
+                              std::chrono::system_clock::time_point start_time,
+                              const ProgressInfo& final_progress) {
+    auto job_end_time = utils::get_time_now();
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(job_end_time - start_time).count();
+    float duration_sec = duration / 1000.0f;
+
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    auto it = jobs_.find(job_id);
+    if (it == jobs_.end()) return;
+
+    // Save final progress to job record
+    it->second.progress = final_progress;
+    last_job_finished_ = std::chrono::steady_clock::now();
+    if (it->second.metadata.is_object()) it->second.metadata.erase("checkpoint");
+
+    if (sweep_yields_.erase(job_id) > 0 && success && sweep_stops_.count(job_id) == 0) {
+        requeue_preempted_locked(it->second, outputs);
+        return;
+    }
+
+    {
+        const std::string type = generation_type_to_string(it->second.type);
+        const auto& settings = it->second.settings();
+        const std::string model = settings.contains("model_name") && settings["model_name"].is_string()
+            ? settings["model_name"].get<std::string>() : "";
+        const bool stopped = success && sweep_stops_.count(job_id) > 0;
+        auto& reg = metrics::registry();
+        reg.job_duration.with({type, model}).observe(duration / 1000.0);
+        reg.jobs_finished.inc({type, stopped ? "cancelled" : success ? "completed" : "failed"});
+    }
+
+    // Set completed_at FIRST so we can include it in the
+    // broadcast — frontend uses it to switch from the live
+    // elapsed-time counter to the static duration display.
+    it->second.completed_at = job_end_time;
+    const std::string completed_at_iso = utils::time_to_string(job_end_time);
+
+    if (success && sweep_stops_.erase(job_id) > 0) {
+        it->second.status = QueueStatus::Cancelled;
+        it->second.outputs = outputs;
+
+        publish_job_event(WSEventType::JobStatusChanged, {
+            {"job_id", job_id},
+            {"status", "cancelled"},
+            {"previous_status", "processing"},
+            {"outputs", outputs},
+            {"completed_at", completed_at_iso}
+        });
+
+        std::cout << "[QueueManager] Job status: " << job_id
+                  << " | processing -> cancelled (sweep stopped)"
+                  << " | outputs=" << outputs.size() << std::endl;
+    } else if (success) {
+        it->second.status = QueueStatus::Completed;
+        it->second.outputs = outputs;
+
+        // Broadcast job completed via WebSocket
+        publish_job_event(WSEventType::JobStatusChanged, {
+            {"job_id", job_id},
+            {"status", "completed"},
+            {"previous_status", "processing"},
+            {"outputs", outputs},
+            {"completed_at", completed_at_iso}
+        });
 
-        save_state();
+        std::cout << "[QueueManager] Job status: " << job_id
+                  << " | processing -> completed"
+                  << " | duration=" << std::fixed << std::setprecision(1) << duration_sec << "s"
+                  << " | outputs=" << outputs.size() << std::endl;
+    } else {
+        sweep_stops_.erase(job_id);
+        it->second.status = QueueStatus::Failed;
+        it->second.error_message = error_message;
+
+        // Broadcast job failed via WebSocket
+        publish_job_event(WSEventType::JobStatusChanged, {
+            {"job_id", job_id},
+            {"status", "failed"},
+            {"previous_status", "processing"},
+            {"error", error_message},
+            {"completed_at", completed_at_iso}
+        });
+
+        std::cout << "[QueueManager] Job status: " << job_id
+                  << " | processing -> failed"
+                  << " | duration=" << std::fixed << std::setprecision(1) << duration_sec << "s"
+                  << " | error=\"" << error_message << "\"" << std::endl;
+    }
+    compact_job_locked(it->second);
+    record_job_locked(it->second);
+}
+
+bool QueueManager::preempt_wanted_locked(const QueueItem& running) const {
+    if (!queue_config_.preempt_sweeps || running.priority == JobPriority::Interactive) return false;
+    // An idle generation worker takes the job without the sweep yielding
+    if (generation_busy_ < generation_workers_) return false;
+    const auto now = utils::get_time_now();
+    for (const auto& id : pending_queue_) {
+        auto it = jobs_.find(id);
+        if (it == jobs_.end() || it->second.status != QueueStatus::Pending) continue;
+        const QueueItem& item = it->second;
+        if (lane_for(item.type) != WorkerLane::Generation || generation_defers_locked(item.type) ||
+            runs_remote(item.type, item.params)) {
+            continue;
+        }
+        if (scheduler_.effective_priority(item.priority, item.created_at, now) < running.priority) return true;
+    }
+    return false;
+}
+
+void QueueManager::requeue_preempted_locked(QueueItem& item, const std::vector<std::string>& outputs) {
+    item.status = QueueStatus::Pending;
+    item.outputs = outputs;
+    item.progress = ProgressInfo{};
+    const int preemptions = item.metadata.is_object() ? item.metadata.value("preemptions", 0) : 0;
+    item.metadata["preemptions"] = preemptions + 1;
+    pending_queue_.push_front(item.job_id);
+    sweeps_preempted_++;
+    record_job_locked(item);
+    queue_cv_.notify_all();
+
+    publish_job_event(WSEventType::JobStatusChanged, {
+        {"job_id", item.job_id},
+        {"status", "pending"},
+        {"previous_status", "processing"},
+        {"preempted", true},
+        {"outputs", outputs}
+    });
+    std::cout << "[QueueManager] Job status: " << item.job_id
+              << " | processing -> pending (preempted)"
+              << " | outputs=" << outputs.size() << std::endl;
+}
+
+bool QueueManager::runs_remote(GenerationType type, const nlohmann::json& params) const {
+    if (!cluster_ || !cluster_->enabled()) return false;
+    if (type != GenerationType::Text2Image && type != GenerationType::Image2Image &&
+        type != GenerationType::Text2Video) {
+        return false;
     }
+    return !params.value("variation_sweep", false);
+}
+
+std::vector<std::string> QueueManager::process_remote_unlocked(GenerationType type, const nlohmann::json& params,
+                                                               const std::string& job_id, int node) {
+    const std::string model = params.value("model", "");
+    if (node < 0) {
+        throw std::runtime_error(model.empty() ? std::string("No cluster node has a model loaded")
+                                               : "No cluster node has model " + model + " loaded");
+    }
+
+    // Give the node back however the job ends
+    struct NodeRelease {
+        ClusterCoordinator* cluster;
+        int node;
+        bool success = false;
+        ~NodeRelease() { cluster->release(node, success); }
+    } release{cluster_, node};
+
+    const char* endpoint = type == GenerationType::Image2Image ? "/img2img"
+                         : type == GenerationType::Text2Video ? "/txt2vid" : "/txt2img";
+
+    ClusterCoordinator::JobHooks hooks;
+    hooks.on_submitted = [this, &job_id](const nlohmann::json& remote) {
+        set_job_metadata(job_id, "node", remote);
+        std::cout << "[QueueManager] Job " << job_id << " | dispatched to node " << remote["name"].get<std::string>()
+                  << " as " << remote["job_id"].get<std::string>() << std::endl;
+    };
+    hooks.on_progress = [this](int step, int total_steps) {
+        update_progress(step, total_steps);
+    };
+    hooks.on_preview = [this](int step, const std::vector<uint8_t>& jpeg, int width, int height) {
+        update_preview(step, 1, jpeg, width, height, false);
+    };
+
+    auto outputs = cluster_->run_job(node, endpoint, params, output_dir_, resolve_job_subpath(job_id, params), hooks);
+    save_job_config(job_id, type, params);
+    release.success = true;
+    return outputs;
 }
 
 std::vector<std::string> QueueManager::process_job_unlocked(
@@ -1087,6 +2181,20 @@ std::vector<std::string> QueueManager::process_job_unlocked(
         return dflt;
     };
 
+    // I/O jobs report progress through update_progress() directly and must
+    // not touch the global SDWrapper callbacks: they may run concurrently
+    // with a generation that owns them.
+    if (type == GenerationType::ModelDownload) {
+        return process_model_download_unlocked(params, job_id);
+    }
+    if (type == GenerationType::ModelHash) {
+        return process_model_hash_unlocked(params, job_id);
+    }
+    // So do upscales on the post lane, for the same reason
+    if (current_slot_ && current_slot_->lane == WorkerLane::Post) {
+        return process_upscale_unlocked(params, job_id);
+    }
+
     // Get expected diffusion steps from params (for phase detection in progress callback)
     int expected_steps = 0;
     if (type == GenerationType::Text2Image || type == GenerationType::Image2Image) {
@@ -1115,6 +2223,19 @@ std::vector<std::string> QueueManager::process_job_unlocked(
     }
 
     if (preview_settings.mode != PreviewMode::None) {
+        // On demand: unwatched jobs skip the decode entirely. Merged batch
+        // jobs count as watchers too; this worker owns their ids.
+        PreviewDemandFn demand;
+        if (preview_settings.on_demand) {
+            demand = [this, job_id, slot = current_slot_]() {
+                if (preview_wanted(job_id)) return true;
+                if (!slot) return false;
+                for (const auto& id : slot->merged_job_ids) {
+                    if (preview_wanted(id)) return true;
+                }
+                return false;
+            };
+        }
         SDWrapper::set_preview_callback(
             [this](int step, int frame_count, const std::vector<uint8_t>& jpeg_data,
                    int width, int height, bool is_noisy) {
@@ -1123,13 +2244,23 @@ std::vector<std::string> QueueManager::process_job_unlocked(
             preview_settings.mode,
             preview_settings.interval,
             preview_settings.max_size,
-            preview_settings.quality
+            preview_settings.quality,
+            std::move(demand),
+            preview_settings.max_overhead_percent
         );
     }
 
     std::vector<std::string> outputs;
     
     try {
+        if (params.value("variation_sweep", false) &&
+            (type == GenerationType::Text2Image || type == GenerationType::Image2Image ||
+             type == GenerationType::Text2Video)) {
+            outputs = process_sweep_unlocked(type, params, job_id);
+            SDWrapper::clear_progress_callback();
+            SDWrapper::clear_preview_callback();
+            return outputs;
+        }
         switch (type) {
             case GenerationType::Text2Image:
                 outputs = process_txt2img_unlocked(params, job_id);
@@ -1147,14 +2278,14 @@ std::vector<std::string> QueueManager::process_job_unlocked(
                 outputs = process_convert_unlocked(params, job_id);
                 break;
             case GenerationType::ModelDownload:
-                outputs = process_model_download_unlocked(params, job_id);
-                break;
             case GenerationType::ModelHash:
-                outputs = process_model_hash_unlocked(params, job_id);
-                break;
+                break;  // handled above
             case GenerationType::ADetailer:
                 outputs = process_adetailer_unlocked(params, job_id);
                 break;
+            case GenerationType::Pipeline:
+                outputs = process_pipeline_unlocked(params, job_id);
+                break;
         }
     } catch (...) {
         SDWrapper::clear_progress_callback();
@@ -1168,97 +2299,87 @@ std::vector<std::string> QueueManager::process_job_unlocked(
 }
 
 void QueueManager::update_progress(int step, int total_steps) {
-    std::string job_id;
-    bool should_broadcast = false;
-
-    {
-        std::lock_guard<std::mutex> lock(progress_mutex_);
-        // Always update internal state (for polling queries)
-        current_progress_.step = step;
-        current_progress_.total_steps = total_steps;
-
-        // Throttle broadcasts to reduce callback overhead
-        auto now = std::chrono::steady_clock::now();
-        if (now - last_progress_broadcast_ >= PROGRESS_THROTTLE_MS) {
-            last_progress_broadcast_ = now;
-            should_broadcast = true;
-            job_id = current_job_id_;
-        }
-    }
-
-    // Broadcast progress via WebSocket only if not throttled
-    if (should_broadcast && !job_id.empty()) {
-        if (auto* ws = get_websocket_server()) {
-            ws->broadcast(WSEventType::JobProgress, {
-                {"job_id", job_id},
-                {"step", step},
-                {"total_steps", total_steps}
-            });
-        }
-    }
+    // Runs on the sampler thread once per step: no locks, no I/O. The
+    // dispatcher thread throttles and broadcasts.
+    WorkerSlot* slot = current_slot_;
+    if (!slot) return;
+
+    // Always update internal state (for polling queries)
+    slot->live_step.store(step, std::memory_order_relaxed);
+    slot->live_total_steps.store(total_steps, std::memory_order_relaxed);
+
+    // current_job_id is only written by this thread
+    if (slot->current_job_id.empty()) return;
+
+    ProgressEvent ev;
+    ev.kind = ProgressEvent::Kind::Progress;
+    ev.job_id = slot->current_job_id;
+    ev.step = step;
+    ev.total_steps = total_steps;
+    progress_dispatcher_.publish(slot->events, std::move(ev));
 }
 
 void QueueManager::set_batch_info(int /*total_images*/) {
-    std::lock_guard<std::mutex> lock(progress_mutex_);
+    WorkerSlot* slot = current_slot_;
+    if (!slot) return;
     // Reset progress for new job
-    current_progress_.step = 0;
-    current_progress_.total_steps = 0;
+    slot->live_step.store(0, std::memory_order_relaxed);
+    slot->live_total_steps.store(0, std::memory_order_relaxed);
 }
 
 void QueueManager::update_preview(int step, int frame_count, const std::vector<uint8_t>& jpeg_data,
                                    int width, int height, bool is_noisy) {
-    std::string job_id;
-    bool should_broadcast = false;
-
-    {
-        std::lock_guard<std::mutex> lock(progress_mutex_);
-        job_id = current_job_id_;
-    }
-
-    if (job_id.empty() || jpeg_data.empty()) {
+    WorkerSlot* slot = current_slot_;
+    if (!slot || slot->current_job_id.empty() || jpeg_data.empty()) {
         return;
     }
 
-    // Always store preview in buffer (for HTTP endpoint access)
-    {
-        std::lock_guard<std::mutex> lock(preview_buffer_mutex_);
-        auto& buffer = preview_buffers_[job_id];
-        buffer.jpeg_data = jpeg_data;
-        buffer.width = width;
-        buffer.height = height;
-        buffer.step = step;
-        buffer.frame_count = frame_count;
-        buffer.is_noisy = is_noisy;
-    }
+    ProgressEvent ev;
+    ev.kind = ProgressEvent::Kind::Preview;
+    ev.job_id = slot->current_job_id;
+    ev.step = step;
+    ev.frame_count = frame_count;
+    ev.width = width;
+    ev.height = height;
+    ev.is_noisy = is_noisy;
+    ev.jpeg = std::make_shared<const std::vector<uint8_t>>(jpeg_data);
+    progress_dispatcher_.publish(slot->events, std::move(ev));
+}
 
-    // Rate limit WebSocket notifications
-    {
-        std::lock_guard<std::mutex> lock(preview_mutex_);
-        auto now = std::chrono::steady_clock::now();
-        if (now - last_preview_broadcast_ >= PREVIEW_THROTTLE_MS) {
-            last_preview_broadcast_ = now;
-            should_broadcast = true;
-        }
+bool QueueManager::is_job_running(const std::string& job_id) const {
+    std::lock_guard<std::mutex> lock(progress_mutex_);
+    for (const auto& slot : workers_) {
+        if (slot->current_job_id == job_id) return true;
+        const auto& merged = slot->merged_job_ids;
+        if (std::find(merged.begin(), merged.end(), job_id) != merged.end()) return true;
     }
+    return false;
+}
 
-    // Broadcast URL notification only (client fetches via HTTP)
-    if (should_broadcast) {
-        if (auto* ws = get_websocket_server()) {
-            ws->broadcast(WSEventType::JobPreview, {
-                {"job_id", job_id},
-                {"step", step},
-                {"frame_count", frame_count},
-                {"width", width},
-                {"height", height},
-                {"is_noisy", is_noisy},
-                {"preview_url", "/jobs/" + job_id + "/preview"}
-            });
-        }
-    }
+void QueueManager::store_preview(const ProgressEvent& preview) {
+    // Always store preview in buffer (for HTTP endpoint access)
+    std::lock_guard<std::mutex> lock(preview_buffer_mutex_);
+    auto& buffer = preview_buffers_[preview.job_id];
+    buffer.jpeg_data = *preview.jpeg;
+    buffer.width = preview.width;
+    buffer.height = preview.height;
+    buffer.step = preview.step;
+    buffer.frame_count = preview.frame_count;
+    buffer.is_noisy = preview.is_noisy;
 }
 
 std::optional<QueueManager::PreviewBuffer> QueueManager::get_preview(const std::string& job_id) const {
+    const auto now = std::chrono::steady_clock::now();
     std::lock_guard<std::mutex> lock(preview_buffer_mutex_);
+    if (preview_polls_.size() >= PREVIEW_POLLS_MAX && !preview_polls_.count(job_id)) {
+        for (auto p = preview_polls_.begin(); p != preview_polls_.end();) {
+            p = now - p->second > PREVIEW_POLL_GRACE ? preview_polls_.erase(p) : std::next(p);
+        }
+    }
+    if (preview_polls_.size() < PREVIEW_POLLS_MAX || preview_polls_.count(job_id)) {
+        preview_polls_[job_id] = now;
+    }
+
     auto it = preview_buffers_.find(job_id);
     if (it == preview_buffers_.end() || it->second.jpeg_data.empty()) {
         return std::nullopt;
@@ -1269,14 +2390,25 @@ std::optional<QueueManager::PreviewBuffer> QueueManager::get_preview(const std::
 void QueueManager::clear_preview_buffer(const std::string& job_id) {
     std::lock_guard<std::mutex> lock(preview_buffer_mutex_);
     preview_buffers_.erase(job_id);
+    preview_polls_.erase(job_id);
 }
 
-void QueueManager::set_preview_settings(PreviewMode mode, int interval, int max_size, int quality) {
+bool QueueManager::preview_wanted(const std::string& job_id) const {
+    if (auto* ws = get_websocket_server(); ws && ws->wants_previews(job_id)) return true;
+    std::lock_guard<std::mutex> lock(preview_buffer_mutex_);
+    auto it = preview_polls_.find(job_id);
+    return it != preview_polls_.end() && std::chrono::steady_clock::now() - it->second <= PREVIEW_POLL_GRACE;
+}
+
+void QueueManager::set_preview_settings(PreviewMode mode, int interval, int max_size, int quality,
+                                        bool on_demand, int max_overhead_percent) {
     std::lock_guard<std::mutex> lock(preview_mutex_);
     preview_settings_.mode = mode;
     preview_settings_.interval = interval;
     preview_settings_.max_size = max_size;
     preview_settings_.quality = quality;
+    preview_settings_.on_demand = on_demand;
+    preview_settings_.max_overhead_percent = max_overhead_percent;
 }
 
 QueueManager::PreviewSettings QueueManager::get_preview_settings() const {
@@ -1289,7 +2421,54 @@ void QueueManager::update_job_params(const std::string& job_id, const nlohmann::
     auto it = jobs_.find(job_id);
     if (it != jobs_.end()) {
         it->second.params = params;
+        it->second.params_file.clear();
+        record_job_locked(it->second);
+    }
+}
+
+void QueueManager::set_job_metadata(const std::string& job_id, const std::string& key,
+                                    const nlohmann::json& value) {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    auto it = jobs_.find(job_id);
+    if (it != jobs_.end()) {
+        it->second.metadata[key] = value;
+        record_job_locked(it->second);
+    }
+}
+
+void QueueManager::export_trace(const std::string& job_id) {
+    auto trace = JobTrace::take(job_id);
+    if (!trace) return;
+
+    // <job_id>.trace.json beside the first output, else under traces/
+    std::filesystem::path rel = "traces";
+    if (auto job = get_job(job_id); job && !job->outputs.empty()) {
+        rel = std::filesystem::path(job->outputs.front()).parent_path();
     }
+    rel /= job_id + ".trace.json";
+
+    const std::filesystem::path path = std::filesystem::path(output_dir_) / rel;
+    std::error_code ec;
+    std::filesystem::create_directories(path.parent_path(), ec);
+    std::ofstream out(path);
+    if (!out) {
+        std::cerr << "[QueueManager] Cannot write trace " << path << std::endl;
+        return;
+    }
+    out << trace->to_chrome_json().dump();
+    out.close();
+    set_job_metadata(job_id, "trace", rel.generic_string());
+}
+
+nlohmann::json QueueManager::get_job_trace(const std::string& job_id) const {
+    if (auto live = JobTrace::find(job_id)) return live->to_chrome_json();
+
+    auto job = get_job(job_id);
+    if (!job || !job->metadata.contains("trace") || !job->metadata["trace"].is_string()) return nullptr;
+    std::ifstream in(std::filesystem::path(output_dir_) / job->metadata["trace"].get<std::string>());
+    if (!in) return nullptr;
+    auto trace = nlohmann::json::parse(in, nullptr, false);
+    return trace.is_discarded() ? nullptr : trace;
 }
 
 // Merge typed roundtrip output with the original raw params to preserve fields
@@ -1312,33 +2491,115 @@ static nlohmann::json merge_preserve_unknowns(const nlohmann::json& typed_roundt
     return out;
 }
 
+// LoRAs a generate call will apply, for LoraCache::prepare(). Same parse as
+// SDWrapper does on the prompt, so the paths match what sd.cpp opens.
+static std::vector<LoraCache::Lora> prompt_loras(const std::string& prompt, const std::string& lora_dir) {
+    std::vector<LoraCache::Lora> out;
+    for (const auto& l : SDWrapper::parse_loras_from_prompt(prompt, lora_dir).second) {
+        out.push_back(LoraCache::Lora{l.path, l.multiplier, l.is_high_noise});
+    }
+    return out;
+}
+
+// Jobs that neither use nor drop a LoRA get no "lora" metadata
+static bool lora_activity(const nlohmann::json& info) {
+    return info.value("count", 0) > 0 || !info.value("removed", nlohmann::json::array()).empty();
+}
+
 std::vector<std::string> QueueManager::process_txt2img_unlocked(
     const nlohmann::json& job_params,
     const std::string& job_id
 ) {
     auto params = Txt2ImgParams::from_json(job_params);
 
+    // Jobs riding along in this call (take_merge_partners_locked): one
+    // generate_image with the summed batch_count, images split back per job
+    std::vector<MergedJob>* merged = current_slot_ ? current_slot_->merged_jobs : nullptr;
+
+    // A batch that may be split for checkpoints needs its seed fixed first,
+    // so every call (and a resume) continues the same seed + b sequence.
+    // Hi-res fix may return a different number of images than asked for.
+    const bool checkpointable = queue_config_.checkpoint_interval_seconds > 0 && params.batch_count > 1 &&
+                                !params.hires_enabled && !(merged && !merged->empty());
+    if (checkpointable && params.seed < 0) params.seed = pick_random_seed();
+
     // Store properly typed params back to the job, preserving any fields the
     // typed struct doesn't know about (variation_group_id, etc.).
     nlohmann::json full_params = merge_preserve_unknowns(params.to_json(), job_params);
     update_job_params(job_id, full_params);
+    std::vector<Txt2ImgShare> shares;
+    Txt2ImgParams call = params;
+    if (merged && !merged->empty()) {
+        const std::string subpath = resolve_job_subpath(job_id, job_params);
+        shares.push_back(Txt2ImgShare{subpath, params.batch_count, current_slot_->output_batch, {}});
+        for (auto& m : *merged) {
+            auto mp = Txt2ImgParams::from_json(m.params);
+            auto full = merge_preserve_unknowns(mp.to_json(), m.params);
+            update_job_params(m.job_id, full);
+            shares.push_back(Txt2ImgShare{resolve_job_subpath(m.job_id, m.params), mp.batch_count,
+                                          m.batch.get(), {}});
+            call.batch_count += mp.batch_count;
+            m.params = std::move(full);
+        }
+        std::cout << "[QueueManager] Job " << job_id << " | batching " << shares.size()
+                  << " jobs into one call (" << call.batch_count << " images)" << std::endl;
+    }
 
     // Set batch info for progress tracking
-    set_batch_info(params.batch_count);
+    set_batch_info(call.batch_count);
 
-    std::lock_guard<std::mutex> ctx_lock(model_manager_.get_context_mutex());
-    auto* ctx = model_manager_.get_context();
+    const std::string estimate_key = checkpointable
+        ? BatchCheckpoints::key(model_manager_.get_loaded_model_name(), params.width, params.height) : "";
+    const size_t device = current_device();
+    std::lock_guard<std::mutex> ctx_lock(model_manager_.get_context_mutex(device));
+    auto* ctx = model_manager_.get_context(device);
 
     if (!ctx) {
         throw std::runtime_error("No model loaded");
     }
 
-    auto outputs = SDWrapper::generate_txt2img(
-        ctx, params,
-        model_manager_.get_lora_dir(),
-        output_dir_,
-        resolve_job_subpath(job_id, job_params)
-    );
+    auto& loras = model_manager_.lora_cache(device);
+    auto lora_info = loras.prepare(prompt_loras(call.prompt, model_manager_.get_lora_dir()));
+
+    std::vector<std::string> outputs;
+    if (checkpointable) {
+        const std::string subpath = resolve_job_subpath(job_id, job_params);
+        outputs = run_checkpointed_batch_unlocked(job_id, params.batch_count, estimate_key, params.steps,
+                                                  [&](int first, int count) {
+            Txt2ImgParams part = params;
+            part.seed = params.seed + first;
+            part.batch_count = count;
+            return SDWrapper::generate_txt2img(ctx, part, model_manager_.get_lora_dir(), output_dir_, subpath,
+                                               current_slot_ ? current_slot_->output_batch : nullptr,
+                                               nullptr, nullptr, first);
+        });
+    } else {
+        outputs = SDWrapper::generate_txt2img(
+            ctx, call,
+            model_manager_.get_lora_dir(),
+            output_dir_,
+            resolve_job_subpath(job_id, job_params),
+            current_slot_ ? current_slot_->output_batch : nullptr,
+            shares.empty() ? nullptr : &shares
+        );
+    }
+
+    if (lora_activity(lora_info)) {
+        loras.finish(lora_info);
+        set_job_metadata(job_id, "lora", lora_info);
+        if (merged) {
+            for (const auto& m : *merged) set_job_metadata(m.job_id, "lora", lora_info);
+        }
+    }
+
+    if (!shares.empty()) {
+        outputs = std::move(shares[0].outputs);
+        for (size_t i = 0; i < merged->size(); ++i) {
+            auto& m = (*merged)[i];
+            m.outputs = std::move(shares[i + 1].outputs);
+            save_job_config(m.job_id, GenerationType::Text2Image, m.params);
+        }
+    }
 
     // Save config.json with all parameters (including defaults)
     save_job_config(job_id, GenerationType::Text2Image, full_params);
@@ -1352,6 +2613,11 @@ std::vector<std::string> QueueManager::process_img2img_unlocked(
 ) {
     auto params = Img2ImgParams::from_json(job_params);
 
+    // As for txt2img: fix the seed of a batch that may be checkpointed
+    const bool checkpointable = queue_config_.checkpoint_interval_seconds > 0 && params.batch_count > 1 &&
+                                !params.hires_enabled;
+    if (checkpointable && params.seed < 0) params.seed = pick_random_seed();
+
     // Preserve unknown fields (variation_group_id, etc.) — see helper comment.
     nlohmann::json full_params = merge_preserve_unknowns(params.to_json(), job_params);
     update_job_params(job_id, full_params);
@@ -1359,19 +2625,45 @@ std::vector<std::string> QueueManager::process_img2img_unlocked(
     // Set batch info for progress tracking
     set_batch_info(params.batch_count);
 
-    std::lock_guard<std::mutex> ctx_lock(model_manager_.get_context_mutex());
-    auto* ctx = model_manager_.get_context();
+    const std::string estimate_key = checkpointable
+        ? BatchCheckpoints::key(model_manager_.get_loaded_model_name(), params.width, params.height) : "";
+    const size_t device = current_device();
+    std::lock_guard<std::mutex> ctx_lock(model_manager_.get_context_mutex(device));
+    auto* ctx = model_manager_.get_context(device);
 
     if (!ctx) {
         throw std::runtime_error("No model loaded");
     }
 
-    auto outputs = SDWrapper::generate_img2img(
-        ctx, params,
-        model_manager_.get_lora_dir(),
-        output_dir_,
-        resolve_job_subpath(job_id, job_params)
-    );
+    auto& loras = model_manager_.lora_cache(device);
+    auto lora_info = loras.prepare(prompt_loras(params.prompt, model_manager_.get_lora_dir()));
+
+    std::vector<std::string> outputs;
+    if (checkpointable) {
+        const std::string subpath = resolve_job_subpath(job_id, job_params);
+        outputs = run_checkpointed_batch_unlocked(job_id, params.batch_count, estimate_key, params.steps,
+                                                  [&](int first, int count) {
+            Img2ImgParams part = params;
+            part.seed = params.seed + first;
+            part.batch_count = count;
+            return SDWrapper::generate_img2img(ctx, part, model_manager_.get_lora_dir(), output_dir_, subpath,
+                                               current_slot_ ? current_slot_->output_batch : nullptr,
+                                               nullptr, first);
+        });
+    } else {
+        outputs = SDWrapper::generate_img2img(
+            ctx, params,
+            model_manager_.get_lora_dir(),
+            output_dir_,
+            resolve_job_subpath(job_id, job_params),
+            current_slot_ ? current_slot_->output_batch : nullptr
+        );
+    }
+
+    if (lora_activity(lora_info)) {
+        loras.finish(lora_info);
+        set_job_metadata(job_id, "lora", lora_info);
+    }
 
     // Save config.json with all parameters (including defaults)
     save_job_config(job_id, GenerationType::Image2Image, full_params);
@@ -1392,26 +2684,190 @@ std::vector<std::string> QueueManager::process_txt2vid_unlocked(
     // Set batch info for progress tracking (video is always 1 output)
     set_batch_info(1);
 
-    std::lock_guard<std::mutex> ctx_lock(model_manager_.get_context_mutex());
-    auto* ctx = model_manager_.get_context();
+    const size_t device = current_device();
+    std::lock_guard<std::mutex> ctx_lock(model_manager_.get_context_mutex(device));
+    auto* ctx = model_manager_.get_context(device);
 
     if (!ctx) {
         throw std::runtime_error("No model loaded");
     }
 
+    auto& loras = model_manager_.lora_cache(device);
+    auto lora_info = loras.prepare(prompt_loras(params.prompt, model_manager_.get_lora_dir()));
+
     auto outputs = SDWrapper::generate_txt2vid(
         ctx, params,
         model_manager_.get_lora_dir(),
         output_dir_,
-        resolve_job_subpath(job_id, job_params)
+        resolve_job_subpath(job_id, job_params),
+        thumbnail_cache_
     );
 
+    if (lora_activity(lora_info)) {
+        loras.finish(lora_info);
+        set_job_metadata(job_id, "lora", lora_info);
+    }
+
     // Save config.json with all parameters (including defaults)
     save_job_config(job_id, GenerationType::Text2Video, full_params);
 
     return outputs;
 }
 
+std::vector<std::string> QueueManager::process_sweep_unlocked(
+    GenerationType type,
+    const nlohmann::json& params,
+    const std::string& job_id
+) {
+    PromptTemplateCursor cursor(params.value("variation_template", std::string()));
+    const size_t total = cursor.size();
+    size_t next = 0;
+    if (params.contains("variation_cursor") && params["variation_cursor"].is_number_integer()) {
+        next = static_cast<size_t>(std::max<int64_t>(0, params["variation_cursor"].get<int64_t>()));
+    }
+
+    // Outputs of the variations finished before a restart
+    std::vector<std::string> outputs;
+    if (next > 0) {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        auto it = jobs_.find(job_id);
+        if (it != jobs_.end()) outputs = it->second.outputs;
+    }
+
+    std::cout << "[QueueManager] Job " << job_id << " | sweep of " << total << " variations";
+    if (next > 0) std::cout << ", resuming at " << next;
+    std::cout << std::endl;
+
+    const std::string base = resolve_job_subpath(job_id, params);
+    const size_t first = next;
+    for (; next < total; ++next) {
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex_);
+            if (sweep_stops_.count(job_id)) break;
+            // Yield between variations, after at least one, so a long sweep
+            // never holds interactive work up for more than one image
+            auto it = jobs_.find(job_id);
+            if (next > first && it != jobs_.end() && preempt_wanted_locked(it->second)) {
+                sweep_yields_.insert(job_id);
+                std::cout << "[QueueManager] Sweep " << job_id << " | yielding to higher-priority work at "
+                          << next << "/" << total << std::endl;
+                break;
+            }
+        }
+
+        nlohmann::json variation = params;
+        variation.erase("variation_sweep");
+        variation.erase("variation_cursor");
+        variation.erase("variation_group_id");
+        variation["prompt"] = cursor.at(next);
+        variation["variation_index"] = static_cast<int64_t>(next);
+
+        // Not a real job id: it only places this variation's files (and
+        // config.json) in <job>/<index>/
+        const std::string variation_id = base + "/" + std::to_string(next);
+        std::vector<std::string> produced;
+        switch (type) {
+            case GenerationType::Image2Image:
+                produced = process_img2img_unlocked(variation, variation_id);
+                break;
+            case GenerationType::Text2Video:
+                produced = process_txt2vid_unlocked(variation, variation_id);
+                break;
+            default:
+                produced = process_txt2img_unlocked(variation, variation_id);
+                break;
+        }
+        outputs.insert(outputs.end(), produced.begin(), produced.end());
+
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        auto it = jobs_.find(job_id);
+        if (it == jobs_.end()) break;
+        it->second.params["variation_cursor"] = static_cast<int64_t>(next + 1);
+        it->second.params_file.clear();
+        it->second.outputs = outputs;
+        record_job_locked(it->second);
+
+        publish_job_event(WSEventType::JobStatusChanged, {
+            {"job_id", job_id},
+            {"status", "processing"},
+            {"previous_status", "processing"},
+            {"variation_index", next + 1},
+            {"variation_total", total},
+            {"outputs", outputs}
+        });
+    }
+
+    return outputs;
+}
+
+std::vector<std::string> QueueManager::run_checkpointed_batch_unlocked(
+    const std::string& job_id, int total, const std::string& estimate_key, int steps,
+    const std::function<std::vector<std::string>(int first, int count)>& generate) {
+    std::vector<std::string> outputs;
+    int done = 0;
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        auto it = jobs_.find(job_id);
+        if (it == jobs_.end()) {
+            // A sweep variation: the sweep keeps its own cursor
+            return generate(0, total);
+        }
+        const auto& meta = it->second.metadata;
+        if (meta.is_object() && meta.contains("checkpoint") && meta["checkpoint"].is_object()) {
+            done = std::clamp(meta["checkpoint"].value("images", 0), 0, total);
+            outputs = it->second.outputs;
+        }
+    }
+
+    if (done > 0) {
+        // Redo from the first image missing on disk
+        done = BatchCheckpoints::resume_point(outputs, done, [this](const std::string& out) {
+            std::error_code ec;
+            return std::filesystem::exists(std::filesystem::path(output_dir_) / out, ec);
+        });
+        outputs.resize(static_cast<size_t>(done));
+        batches_resumed_++;
+        set_job_metadata(job_id, "resumed_at_image", done);
+        std::cout << "[QueueManager] Job " << job_id << " | resuming batch at image " << done
+                  << "/" << total << std::endl;
+    }
+
+    const double interval = queue_config_.checkpoint_interval_seconds;
+    while (done < total) {
+        // Unmeasured for this model and resolution: one call, which
+        // measures it. Likewise for a batch expected to fit the interval.
+        const double per_image = checkpoint_estimates_.seconds_per_step(estimate_key) * steps;
+        const int count = BatchCheckpoints::next_call(total - done, per_image, interval);
+
+        const auto started = std::chrono::steady_clock::now();
+        std::vector<std::string> produced = generate(done, count);
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        checkpoint_estimates_.record(estimate_key, seconds, count, steps);
+
+        outputs.insert(outputs.end(), produced.begin(), produced.end());
+        done += count;
+        if (done >= total) break;
+
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        auto it = jobs_.find(job_id);
+        if (it == jobs_.end()) continue;
+        it->second.outputs = outputs;
+        it->second.metadata["checkpoint"] = {{"images", done}, {"total", total}};
+        record_job_locked(it->second);
+        checkpoints_written_++;
+
+        publish_job_event(WSEventType::JobStatusChanged, {
+            {"job_id", job_id},
+            {"status", "processing"},
+            {"previous_status", "processing"},
+            {"batch_index", done},
+            {"batch_total", total},
+            {"outputs", outputs}
+        });
+    }
+    return outputs;
+}
+
 std::vector<std::string> QueueManager::process_upscale_unlocked(
     const nlohmann::json& job_params,
     const std::string& job_id
@@ -1439,24 +2895,39 @@ std::vector<std::string> QueueManager::process_upscale_unlocked(
     {
         std::lock_guard<std::mutex> ctx_lock(model_manager_.get_upscaler_mutex());
         upscaler_ctx = model_manager_.get_upscaler_context();
+        params.model_tile_size = model_manager_.get_upscaler_tile_size();
     }
 
     if (!upscaler_ctx) {
         throw std::runtime_error("No upscaler loaded. Load an ESRGAN model first using /upscaler/load");
     }
 
-    // Set up progress callback for upscale (expected_steps=0 enables report-all mode)
-    SDWrapper::set_progress_callback([this](int step, int total) {
-        update_progress(step, total);
-    }, 0);
+    // On the post lane a generation may own the global callbacks: report
+    // per pass instead
+    const bool beside_generation = current_slot_ && current_slot_->lane == WorkerLane::Post;
+    ProgressCallback on_pass = nullptr;
+    if (beside_generation) {
+        on_pass = [this](int done, int total) { update_progress(done, total); };
+    } else {
+        // Set up progress callback for upscale (expected_steps=0 enables report-all mode)
+        SDWrapper::set_progress_callback([this](int step, int total) {
+            update_progress(step, total);
+        }, 0);
+    }
 
-    auto outputs = SDWrapper::upscale_image(
-        upscaler_ctx, params,
-        output_dir_,
-        job_id
-    );
+    std::vector<std::string> outputs;
+    {
+        std::lock_guard<std::mutex> run_lock(upscale_run_mutex_);
+        outputs = SDWrapper::upscale_image(
+            upscaler_ctx, params,
+            output_dir_,
+            job_id,
+            current_slot_ ? current_slot_->output_batch : nullptr,
+            on_pass
+        );
+    }
 
-    SDWrapper::clear_progress_callback();
+    if (!beside_generation) SDWrapper::clear_progress_callback();
 
     // Save config.json with all parameters (including defaults)
     save_job_config(job_id, GenerationType::Upscale, full_params);
@@ -1513,10 +2984,201 @@ std::vector<std::string> QueueManager::process_adetailer_unlocked(
     return outputs;
 }
 
+namespace {
+
+// Write pipeline images as <subpath>/<prefix><n>.<ext>; through the output
+// pipeline when the job has a batch
+std::vector<std::string> write_stage_images(std::vector<StageImage>& images,
+                                            const std::string& output_dir,
+                                            const std::string& subpath,
+                                            const std::string& prefix,
+                                            const EncodeOptions& encode,
+                                            OutputBatch* batch) {
+    namespace fs = std::filesystem;
+    utils::create_directory((fs::path(output_dir) / subpath).string());
+    std::vector<std::string> refs;
+    for (size_t i = 0; i < images.size(); ++i) {
+        auto& img = images[i];
+        const std::string ref = subpath + "/" + prefix + std::to_string(i) + "." +
+                                image_format_extension(encode.format);
+        const std::string path = (fs::path(output_dir) / ref).string();
+        if (batch) {
+            OutputImage out;
+            out.path = path;
+            out.output_ref = ref;
+            out.pixels.reset(static_cast<uint8_t*>(std::malloc(img.data.size())));
+            if (!out.pixels) throw std::bad_alloc();
+            std::memcpy(out.pixels.get(), img.data.data(), img.data.size());
+            out.width = img.width;
+            out.height = img.height;
+            out.channels = img.channels;
+            out.encode = encode;
+            batch->add(std::move(out));
+        } else if (!write_image_file(path, img.data.data(), img.width, img.height, img.channels, encode)) {
+            std::cerr << "[QueueManager] Failed to save pipeline image to " << path << std::endl;
+            continue;
+        }
+        refs.push_back(ref);
+    }
+    return refs;
+}
+
+} // namespace
+
+std::vector<std::string> QueueManager::process_pipeline_unlocked(
+    const nlohmann::json& job_params,
+    const std::string& job_id
+) {
+    if (!job_params.contains("stages") || !job_params["stages"].is_array() || job_params["stages"].empty()) {
+        throw std::runtime_error("stages must be a non-empty array");
+    }
+    const auto& stages = job_params["stages"];
+    const bool persist_all = job_params.value("persist_intermediate", false);
+    const std::string subpath = resolve_job_subpath(job_id, job_params);
+    const EncodeOptions encode = resolve_encode_options(job_params.value("output_format", std::string()),
+                                                        job_params.value("output_quality", -1));
+    const std::string lora_dir = model_manager_.get_lora_dir();
+
+    std::vector<StageImage> images;
+    std::vector<std::string> intermediate_outputs;
+    nlohmann::json timings = nlohmann::json::array();
+
+    for (size_t k = 0; k < stages.size(); ++k) {
+        nlohmann::json stage = stages[k];
+        const std::string type = stage.value("type", "");
+        const bool persist = stage.value("persist", persist_all) && k + 1 < stages.size();
+        stage.erase("type");
+        stage.erase("persist");
+
+        auto t0 = std::chrono::steady_clock::now();
+        std::vector<StageImage> next;
+
+        // Each stage runs on every image the previous one produced
+        if (type == "txt2img") {
+            if (k != 0) throw std::runtime_error("txt2img can only be the first pipeline stage");
+            auto params = Txt2ImgParams::from_json(stage);
+            set_batch_info(params.batch_count);
+            SDWrapper::set_progress_callback([this](int step, int total) { update_progress(step, total); },
+                                             params.steps);
+            std::lock_guard<std::mutex> ctx_lock(model_manager_.get_context_mutex());
+            auto* ctx = model_manager_.get_context();
+            if (!ctx) throw std::runtime_error("No model loaded");
+            SDWrapper::generate_txt2img(ctx, params, lora_dir, output_dir_, "", nullptr, nullptr, &next);
+        } else if (type == "img2img") {
+            if (k == 0 && !stage.contains("init_image_base64")) {
+                throw std::runtime_error("A first img2img stage needs init_image_base64");
+            }
+            auto base = Img2ImgParams::from_json(stage);
+            SDWrapper::set_progress_callback([this](int step, int total) { update_progress(step, total); },
+                                             base.steps);
+            std::lock_guard<std::mutex> ctx_lock(model_manager_.get_context_mutex());
+            auto* ctx = model_manager_.get_context();
+            if (!ctx) throw std::runtime_error("No model loaded");
+            if (k == 0) {
+                set_batch_info(base.batch_count);
+                SDWrapper::generate_img2img(ctx, base, lora_dir, output_dir_, "", nullptr, &next);
+            } else {
+                set_batch_info(static_cast<int>(images.size()) * base.batch_count);
+                for (auto& img : images) {
+                    Img2ImgParams params = base;
+                    // Refine at the incoming size unless the stage asks otherwise
+                    if (!stage.contains("width")) params.width = img.width;
+                    if (!stage.contains("height")) params.height = img.height;
+                    params.init_image_width = img.width;
+                    params.init_image_height = img.height;
+                    params.init_image_channels = img.channels;
+                    params.init_image_data = std::move(img.data);
+                    SDWrapper::generate_img2img(ctx, params, lora_dir, output_dir_, "", nullptr, &next);
+                }
+            }
+        } else if (type == "upscale") {
+            if (k == 0) throw std::runtime_error("upscale needs an earlier stage to upscale");
+            TiledUpscaleOptions options;
+            options.repeats = std::max(1, stage.value("repeats", 1));
+            options.pass_tile = std::max(0, stage.value("pass_tile_size", 0));
+            options.overlap = std::max(0, stage.value("tile_overlap", 16));
+            upscaler_ctx_t* upscaler_ctx = nullptr;
+            {
+                std::lock_guard<std::mutex> ctx_lock(model_manager_.get_upscaler_mutex());
+                upscaler_ctx = model_manager_.get_upscaler_context();
+                options.model_tile = model_manager_.get_upscaler_tile_size();
+            }
+            if (!upscaler_ctx) {
+                throw std::runtime_error("No upscaler loaded. Load an ESRGAN model first using /upscaler/load");
+            }
+            set_batch_info(static_cast<int>(images.size()));
+            SDWrapper::set_progress_callback([this](int step, int total) { update_progress(step, total); }, 0);
+            std::lock_guard<std::mutex> run_lock(upscale_run_mutex_);
+            for (auto& img : images) {
+                StageImage up;
+                up.data = SDWrapper::upscale_image_data(upscaler_ctx, img.data.data(), img.width, img.height,
+                                                        img.channels, up.width, up.height, options);
+                next.push_back(std::move(up));
+            }
+        } else if (type == "adetailer") {
+            if (k == 0) throw std::runtime_error("adetailer needs an earlier stage to refine");
+            auto base = AdetailerParams::from_json(stage);
+            if (base.detector.empty()) throw std::runtime_error("adetailer stage: detector is required");
+            set_batch_info(static_cast<int>(images.size()));
+            SDWrapper::set_progress_callback([this](int step, int total) { update_progress(step, total); },
+                                             base.steps);
+            std::lock_guard<std::mutex> ctx_lock(model_manager_.get_context_mutex());
+            auto* ctx = model_manager_.get_context();
+            if (!ctx) throw std::runtime_error("No base model loaded — load one before running ADetailer");
+            auto* ad_ctx = model_manager_.get_or_create_adetailer(base.detector);
+            if (!ad_ctx) throw std::runtime_error("Failed to load ADetailer detector: " + base.detector);
+            for (auto& img : images) {
+                AdetailerParams params = base;
+                params.image_width = img.width;
+                params.image_height = img.height;
+                params.image_channels = img.channels;
+                params.image_data = std::move(img.data);
+                SDWrapper::run_adetailer(ad_ctx, ctx, params, output_dir_, "", &next);
+            }
+        } else {
+            throw std::runtime_error("Unknown pipeline stage type: '" + type + "'");
+        }
+        SDWrapper::clear_progress_callback();
+
+        if (next.empty()) {
+            throw std::runtime_error("Pipeline stage " + std::to_string(k) + " (" + type + ") produced no images");
+        }
+        images = std::move(next);
+
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - t0).count();
+        timings.push_back({{"type", type}, {"images", images.size()}, {"ms", ms}});
+        std::cout << "[QueueManager] Job " << job_id << " | pipeline stage " << k + 1 << "/"
+                  << stages.size() << " " << type << ": " << images.size() << " image(s), "
+                  << ms << " ms" << std::endl;
+
+        if (persist) {
+            auto refs = write_stage_images(images, output_dir_,
+                                           subpath + "/stage_" + std::to_string(k) + "_" + type,
+                                           "output_", encode, nullptr);
+            intermediate_outputs.insert(intermediate_outputs.end(), refs.begin(), refs.end());
+        }
+    }
+
+    set_job_metadata(job_id, "pipeline", {{"stages", timings}});
+
+    auto outputs = write_stage_images(images, output_dir_, subpath, "output_", encode,
+                                      current_slot_ ? current_slot_->output_batch : nullptr);
+    // Intermediates are already on disk; list them after the final images
+    outputs.insert(outputs.end(), intermediate_outputs.begin(), intermediate_outputs.end());
+
+    save_job_config(job_id, GenerationType::Pipeline, job_params);
+    return outputs;
+}
+
 std::vector<std::string> QueueManager::process_convert_unlocked(
     const nlohmann::json& job_params,
-    const std::string& /*job_id*/
+    const std::string& job_id
 ) {
+    if (job_params.value("quant_cache", false)) {
+        return process_quant_cache_unlocked(job_params, job_id);
+    }
+
     // Get input path (required)
     if (!job_params.contains("input_path") || job_params["input_path"].get<std::string>().empty()) {
         throw std::runtime_error("input_path is required");
@@ -1575,6 +3237,51 @@ std::vector<std::string> QueueManager::process_convert_unlocked(
     return { output_path };
 }
 
+std::vector<std::string> QueueManager::process_quant_cache_unlocked(
+    const nlohmann::json& job_params,
+    const std::string& job_id
+) {
+    namespace fs = std::filesystem;
+    auto& cache = model_manager_.quant_cache();
+    const std::string input_path = job_params.value("input_path", "");
+    const std::string output_type = job_params.value("output_type", "");
+    const std::string rules = job_params.value("tensor_type_rules", "");
+
+    try {
+        // The artifact is named by the source's content; usually cached by the catalog
+        update_progress(0, 100);
+        const std::string hash = model_manager_.hash_model_file(input_path, [this](uint64_t done, uint64_t total) {
+            if (total > 0) update_progress(static_cast<int>(done * 50 / total), 100);
+        });
+        const std::string artifact = cache.artifact_path(hash, output_type);
+
+        std::error_code ec;
+        if (!fs::is_regular_file(artifact, ec)) {
+            fs::create_directories(fs::path(artifact).parent_path(), ec);
+            // Written aside and renamed, so a load never opens a partial file
+            const std::string tmp = artifact + ".tmp";
+            SDWrapper::convert_model(input_path, "", tmp, output_type, rules);
+            fs::rename(tmp, artifact, ec);
+            if (ec) {
+                fs::remove(tmp, ec);
+                throw std::runtime_error("Failed to store quantized model " + artifact + ": " + ec.message());
+            }
+        }
+        cache.store(input_path, hash, output_type, artifact);
+        update_progress(100, 100);
+
+        std::cout << "[QueueManager] Quant cache: " << input_path << " -> " << artifact << std::endl;
+        // Not listed as an output: job deletion and the output quota must leave it alone
+        set_job_metadata(job_id, "quant_cache", {
+            {"source", input_path}, {"source_hash", hash}, {"weight_type", output_type}, {"artifact", artifact}
+        });
+        return {};
+    } catch (const std::exception& e) {
+        cache.mark_failed(input_path, output_type, e.what());
+        throw;
+    }
+}
+
 std::string QueueManager::resolve_job_subpath(const std::string& job_id,
                                                 const nlohmann::json& params) const {
     if (!group_folders_enabled_.load(std::memory_order_relaxed)) {
@@ -1604,7 +3311,7 @@ void QueueManager::save_job_config(const std::string& job_id, GenerationType typ
     }
 
     // Get the job's model settings
-    nlohmann::json model_settings;
+    std::shared_ptr<const nlohmann::json> model_settings;
     {
         std::lock_guard<std::mutex> lock(queue_mutex_);
         auto it = jobs_.find(job_id);
@@ -1619,66 +3326,308 @@ void QueueManager::save_job_config(const std::string& job_id, GenerationType typ
     config["type"] = generation_type_to_string(type);
     config["created_at"] = utils::time_to_string(utils::get_time_now());
     config["params"] = params;
-    if (!model_settings.empty()) {
-        config["model_settings"] = model_settings;
+    if (model_settings && !model_settings->empty()) {
+        config["model_settings"] = *model_settings;
     }
 
     // Write to config.json in the job folder
     fs::path config_path = job_dir / "config.json";
-    std::ofstream file(config_path);
-    if (file.is_open()) {
-        file << config.dump(2);
-        std::cout << "[QueueManager] Saved job config to: " << config_path.string() << std::endl;
+    {
+        std::ofstream file(config_path);
+        if (!file.is_open() || !(file << config.dump(2))) {
+            return;
+        }
     }
-}
+    std::cout << "[QueueManager] Saved job config to: " << config_path.string() << std::endl;
 
-void QueueManager::save_state() {
-    nlohmann::json state;
-    nlohmann::json items_array = nlohmann::json::array();
-    
-    for (const auto& [id, item] : jobs_) {
-        items_array.push_back(item.to_json());
-    }
-    
-    state["items"] = items_array;
-    
-    std::ofstream file(state_file_);
-    if (file.is_open()) {
-        file << state.dump(2);
+    // The file now holds this job's params, so the finished job can drop
+    // them from memory (compact_job_locked)
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    auto it = jobs_.find(job_id);
+    if (it != jobs_.end() && it->second.params == params) {
+        it->second.params_file = fs::path(config_path).lexically_relative(output_dir_).generic_string();
     }
 }
 
-void QueueManager::load_state() {
-    if (!utils::file_exists(state_file_)) {
+void QueueManager::compact_job_locked(QueueItem& item) {
+    if (!item.params.is_object()) return;
+
+    if (!item.params_file.empty()) {
+        nlohmann::json summary = nlohmann::json::object();
+        for (const char* key : {F::PARAM_PROMPT, F::PARAM_NEGATIVE_PROMPT, "variation_group_id",
+                                "width", "height", "steps", "seed", "sampler", "scheduler", "batch_count"}) {
+            auto it = item.params.find(key);
+            if (it != item.params.end()) summary[key] = *it;
+        }
+        item.params = std::move(summary);
+        params_offloaded_++;
         return;
     }
-    
+
+    // No config.json to fall back on (failed jobs, sweeps): keep the
+    // params, minus the inline images nobody reads after the run
+    const auto stripped = strip_image_blobs(item.params);
+    if (!stripped.empty()) {
+        item.metadata["stripped_inputs"] = stripped;
+    }
+}
+
+void QueueManager::load_offloaded_params(QueueItem& item) const {
+    if (item.params_file.empty()) return;
+    std::ifstream file(std::filesystem::path(output_dir_) / item.params_file);
+    if (!file) return;
     try {
-        std::ifstream file(state_file_);
-        nlohmann::json state;
-        file >> state;
-        
-        if (state.contains("items")) {
-            for (const auto& j : state["items"]) {
-                QueueItem item = QueueItem::from_json(j);
-                
-                // Reset processing jobs to pending
-                if (item.status == QueueStatus::Processing) {
-                    item.status = QueueStatus::Pending;
-                    pending_queue_.push(item.job_id);
-                } else if (item.status == QueueStatus::Pending) {
-                    pending_queue_.push(item.job_id);
+        auto config = nlohmann::json::parse(file);
+        if (config.contains("params") && config["params"].is_object()) {
+            item.params = std::move(config["params"]);
+            item.params_file.clear();
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "[QueueManager] Unreadable " << item.params_file << ": " << e.what() << std::endl;
+    }
+}
+
+std::shared_ptr<const nlohmann::json> QueueManager::intern_settings_locked(nlohmann::json settings) {
+    std::string key = settings.dump();
+    auto it = settings_pool_.find(key);
+    if (it != settings_pool_.end()) {
+        if (auto shared = it->second.lock()) return shared;
+    }
+
+    // Settings only change on model loads, so the pool stays small; drop
+    // the copies no job holds any more whenever a new one comes in
+    for (auto pit = settings_pool_.begin(); pit != settings_pool_.end();) {
+        pit = pit->second.expired() ? settings_pool_.erase(pit) : std::next(pit);
+    }
+    auto shared = std::make_shared<const nlohmann::json>(std::move(settings));
+    settings_pool_[std::move(key)] = shared;
+    return shared;
+}
+
+void QueueManager::record_job_locked(const QueueItem& item) {
+    journal_.put(item.job_id, item.to_json());
+    index_.upsert(item);
+}
+
+void QueueManager::forget_job_locked(const std::string& job_id) {
+    journal_.erase(job_id);
+    index_.erase(job_id);
+    auto it = jobs_.find(job_id);
+    if (it != jobs_.end() && !it->second.dedup_key.empty()) {
+        auto hit = result_index_.find(it->second.dedup_key);
+        if (hit != result_index_.end() && hit->second == job_id) result_index_.erase(hit);
+    }
+}
+
+int QueueManager::purge_jobs(const std::vector<std::string>& job_ids,
+                             const std::function<bool(const QueueItem&)>& still_matches, bool delete_files) {
+    int purged = 0;
+    for (size_t i = 0; i < job_ids.size(); i += PURGE_CHUNK) {
+        std::vector<std::string> files;
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex_);
+            const size_t end = std::min(job_ids.size(), i + PURGE_CHUNK);
+            for (size_t k = i; k < end; ++k) {
+                auto it = jobs_.find(job_ids[k]);
+                if (it == jobs_.end() || it->second.status == QueueStatus::Processing ||
+                    !still_matches(it->second)) {
+                    continue;
                 }
-                
-                jobs_[item.job_id] = item;
+                if (delete_files) append_job_files(it->second, files);
+                forget_job_locked(job_ids[k]);
+                jobs_.erase(it);
+                purged++;
             }
         }
-        
-        std::cout << "[QueueManager] Loaded " << jobs_.size() << " jobs from state file" << std::endl;
+        output_reaper_.remove(std::move(files));
+    }
+    return purged;
+}
+
+void QueueManager::append_job_files(const QueueItem& item, std::vector<std::string>& files) {
+    namespace fs = std::filesystem;
+    files.insert(files.end(), item.outputs.begin(), item.outputs.end());
+    if (!item.params_file.empty()) files.push_back(item.params_file);
+    auto trace = item.metadata.find("trace");
+    if (trace != item.metadata.end() && trace->is_string()) files.push_back(trace->get<std::string>());
+
+    // Written next to the outputs without being listed: config.json (sweep
+    // variations, merged batches) and video posters and previews. Only in
+    // the job's own directories; never the output root or another job's.
+    std::set<fs::path> dirs;
+    for (const auto& out : item.outputs) {
+        const fs::path dir = fs::path(out).parent_path();
+        if (std::find(dir.begin(), dir.end(), fs::path(item.job_id)) != dir.end()) dirs.insert(dir);
+    }
+    for (const auto& dir : dirs) {
+        for (const char* name : {"config.json", ThumbnailCache::VIDEO_POSTER_NAME, ThumbnailCache::VIDEO_PREVIEW_NAME}) {
+            const std::string file = (dir / name).generic_string();
+            if (file != item.params_file) files.push_back(file);
+        }
+    }
+}
 
-    } catch (const std::exception& e) {
-        std::cerr << "[QueueManager] Failed to load state: " << e.what() << std::endl;
+std::unordered_set<std::string> QueueManager::referenced_files(const std::vector<std::string>& batch) const {
+    std::unordered_set<std::string> listed;
+    std::unordered_set<std::string> looked_up;
+    std::vector<std::string> files;
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    for (const auto& ref : batch) {
+        for (const auto& part : std::filesystem::path(ref)) {
+            const std::string id = part.string();
+            if (!looked_up.insert(id).second) continue;
+            auto it = jobs_.find(id);
+            if (it == jobs_.end()) continue;
+            files.clear();
+            append_job_files(it->second, files);
+            for (auto& f : files) listed.insert(std::move(f));
+        }
+    }
+
+    std::unordered_set<std::string> referenced;
+    for (const auto& ref : batch) {
+        if (listed.count(ref)) referenced.insert(ref);
+    }
+    return referenced;
+}
+
+void QueueManager::publish_job_event(WSEventType type, const nlohmann::json& data) {
+    const char* name = type == WSEventType::JobCancelled ? "cancelled"
+                     : type == WSEventType::JobDeleted ? "deleted"
+                     : "status";
+    job_events_.publish(data.value("job_id", ""), name, data);
+    if (auto* ws = get_websocket_server()) ws->broadcast(type, data);
+}
+
+void QueueManager::run_maintenance() {
+    if (recycle_bin_config_.enabled) purge_expired_jobs();
+    enforce_output_quota();
+    schedule_quantization();
+}
+
+void QueueManager::schedule_quantization() {
+    auto& cache = model_manager_.quant_cache();
+    if (!cache.enabled()) return;
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        if (index_.count(QueueStatus::Pending) > 0 || index_.count(QueueStatus::Processing) > 0) return;
+        if (std::chrono::steady_clock::now() - last_job_finished_ < std::chrono::seconds(cache.idle_seconds())) {
+            return;
+        }
+    }
+    auto params = model_manager_.next_quantize_job();
+    if (!params) return;
+    const std::string title = "Quantize " + params->value("model_name", "") + " (" +
+                              params->value("output_type", "") + ")";
+    const std::string job_id = add_job(GenerationType::Convert, *params, title, JobOrigin{"", JobPriority::Batch});
+    std::cout << "[QueueManager] Queue idle, quant cache job " << job_id << ": " << title << std::endl;
+}
+
+void QueueManager::enforce_output_quota() {
+    if (recycle_bin_config_.output_quota_mb <= 0) return;
+
+    struct Candidate {
+        bool deleted = false;
+        std::chrono::system_clock::time_point at;
+        std::string job_id;
+        std::vector<std::string> files;
+        uint64_t bytes = 0;
+    };
+    std::vector<Candidate> candidates;
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        for (const auto& [id, item] : jobs_) {
+            if (item.outputs.empty() || item.status == QueueStatus::Pending ||
+                item.status == QueueStatus::Processing) {
+                continue;
+            }
+            const bool deleted = item.status == QueueStatus::Deleted;
+            Candidate c{deleted, deleted ? item.deleted_at : item.completed_at, id, {}, 0};
+            append_job_files(item, c.files);
+            candidates.push_back(std::move(c));
+        }
+    }
+
+    // Files listed by several jobs count once; missing ones (no poster for
+    // an image job) count nothing
+    const std::filesystem::path root(output_dir_);
+    std::unordered_set<std::string> seen;
+    std::error_code ec;
+    uint64_t total = 0;
+    for (auto& c : candidates) {
+        for (const auto& out : c.files) {
+            if (!seen.insert(out).second) continue;
+            const auto size = std::filesystem::file_size(root / out, ec);
+            if (!ec) c.bytes += size;
+        }
+        total += c.bytes;
+    }
+    output_bytes_ = total;
+
+    const uint64_t quota = static_cast<uint64_t>(recycle_bin_config_.output_quota_mb) * 1024 * 1024;
+    if (total <= quota) return;
+
+    // Recycle bin first, then the oldest completions
+    std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) {
+        if (a.deleted != b.deleted) return a.deleted;
+        return a.at < b.at;
+    });
+    std::vector<std::string> evict;
+    uint64_t freed = 0;
+    for (const auto& c : candidates) {
+        if (total - freed <= quota) break;
+        evict.push_back(c.job_id);
+        freed += c.bytes;
+    }
+
+    const int purged = purge_jobs(evict, [](const QueueItem& item) {
+        return item.status != QueueStatus::Pending;
+    }, true);
+    quota_evicted_ += purged;
+    output_bytes_ = total - freed;
+    std::cout << "[QueueManager] Output quota " << recycle_bin_config_.output_quota_mb << " MB exceeded: evicted "
+              << purged << " jobs (" << freed / (1024 * 1024) << " MB)" << std::endl;
+}
+
+void QueueManager::load_state() {
+    // QueueJournal reads the snapshot (legacy queue_state.json included),
+    // replays the journal tail and compacts before handing items back
+    for (const auto& j : journal_.load()) {
+        try {
+            QueueItem item = QueueItem::from_json(j);
+
+            // Reset processing jobs to pending
+            if (item.status == QueueStatus::Processing) {
+                item.status = QueueStatus::Pending;
+                pending_queue_.push_back(item.job_id);
+            } else if (item.status == QueueStatus::Pending) {
+                pending_queue_.push_back(item.job_id);
+            }
+
+            // Jobs finished before params off-loading existed still carry
+            // their inline images
+            if (item.params_file.empty() && item.status != QueueStatus::Pending &&
+                item.status != QueueStatus::Processing) {
+                compact_job_locked(item);
+            }
+            if (item.model_settings) item.model_settings = intern_settings_locked(*item.model_settings);
+
+            index_.upsert(item);
+            if (!item.dedup_key.empty()) result_index_[item.dedup_key] = item.job_id;
+            jobs_[item.job_id] = std::move(item);
+        } catch (const std::exception& e) {
+            std::cerr << "[QueueManager] Skipping unreadable queue item: " << e.what() << std::endl;
+        }
     }
+
+    // Pending order is creation order, not job-id order
+    std::stable_sort(pending_queue_.begin(), pending_queue_.end(),
+        [this](const std::string& a, const std::string& b) {
+            return jobs_.at(a).created_at < jobs_.at(b).created_at;
+        });
+
+    std::cout << "[QueueManager] Loaded " << jobs_.size() << " jobs from state file" << std::endl;
+    journal_.start();
 }
 
 std::pair<std::string, std::string> QueueManager::add_download_job(const nlohmann::json& params) {
@@ -1703,19 +3652,16 @@ std::pair<std::string, std::string> QueueManager::add_download_job(const nlohman
     {
         std::lock_guard<std::mutex> lock(queue_mutex_);
         jobs_[hash_item.job_id] = hash_item;
+        record_job_locked(hash_item);
         // Don't add to pending queue yet - it will be added after download completes
-    }
 
-    // Update download job with linked hash job ID
-    {
-        std::lock_guard<std::mutex> lock(queue_mutex_);
+        // Update download job with linked hash job ID
         if (jobs_.count(download_job_id)) {
             jobs_[download_job_id].linked_job_id = hash_item.job_id;
+            record_job_locked(jobs_[download_job_id]);
         }
     }
 
-    save_state();
-
     // Broadcast job added events via WebSocket
     if (auto* ws = get_websocket_server()) {
         ws->broadcast(WSEventType::JobAdded, {
@@ -1733,6 +3679,31 @@ std::pair<std::string, std::string> QueueManager::add_download_job(const nlohman
     return {download_job_id, hash_item.job_id};
 }
 
+void QueueManager::complete_linked_job(const std::string& job_id, const std::vector<std::string>& outputs) {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+
+    auto it = jobs_.find(job_id);
+    if (it != jobs_.end() && it->second.status == QueueStatus::Pending) {
+        auto now = std::chrono::system_clock::now();
+        it->second.status = QueueStatus::Completed;
+        it->second.outputs = outputs;
+        it->second.started_at = now;
+        it->second.completed_at = now;
+        it->second.progress = ProgressInfo{100, 100};
+        record_job_locked(it->second);
+        JobTrace::take(job_id);
+
+        // Broadcast job status change via WebSocket
+        publish_job_event(WSEventType::JobStatusChanged, {
+            {"job_id", job_id},
+            {"status", "completed"},
+            {"previous_status", "pending"},
+            {"outputs", outputs},
+            {"completed_at", utils::time_to_string(now)}
+        });
+    }
+}
+
 void QueueManager::fail_linked_job(const std::string& job_id, const std::string& error_message) {
     std::lock_guard<std::mutex> lock(queue_mutex_);
 
@@ -1741,16 +3712,16 @@ void QueueManager::fail_linked_job(const std::string& job_id, const std::string&
         it->second.status = QueueStatus::Failed;
         it->second.error_message = error_message;
         it->second.completed_at = std::chrono::system_clock::now();
+        record_job_locked(it->second);
+        JobTrace::take(job_id);
 
         // Broadcast job status change via WebSocket
-        if (auto* ws = get_websocket_server()) {
-            ws->broadcast(WSEventType::JobStatusChanged, {
-                {"job_id", job_id},
-                {"status", "failed"},
-                {"error_message", error_message},
-                {"completed_at", utils::time_to_string(it->second.completed_at)}
-            });
-        }
+        publish_job_event(WSEventType::JobStatusChanged, {
+            {"job_id", job_id},
+            {"status", "failed"},
+            {"error_message", error_message},
+            {"completed_at", utils::time_to_string(it->second.completed_at)}
+        });
     }
 }
 
@@ -1777,7 +3748,10 @@ std::vector<std::string> QueueManager::process_model_download_unlocked(
     try {
         // Get paths config from model manager
         nlohmann::json paths_config = model_manager_.get_paths_config();
-        DownloadManager download_manager(paths_config);
+        DownloadConfig download_options = download_config_;
+        download_options.connections = params.value("connections", download_options.connections);
+        download_options.max_speed_kbps = params.value("max_speed_kbps", download_options.max_speed_kbps);
+        DownloadManager download_manager(paths_config, download_options);
 
         DownloadResult result;
 
@@ -1836,26 +3810,43 @@ std::vector<std::string> QueueManager::process_model_download_unlocked(
 
         outputs.push_back(result.file_path);
 
-        // Update hash job with file path and add to pending queue
-        if (!hash_job_id.empty()) {
+        // Rescan models to pick up the new file
+        model_manager_.scan_models();
+
+        if (!result.sha256.empty()) {
+            // Hashed on the way in: persist it and close the hash job
+            // without reading the file a second time
+            model_manager_.record_model_hash(result.file_path, result.sha256);
+            std::cout << "[QueueManager] Hashed during download " << result.file_path << ": "
+                      << result.sha256 << std::endl;
+            if (!hash_job_id.empty()) {
+                {
+                    std::lock_guard<std::mutex> lock(queue_mutex_);
+                    if (jobs_.count(hash_job_id)) {
+                        jobs_[hash_job_id].params["file_path"] = result.file_path;
+                        jobs_[hash_job_id].params["file_name"] = result.file_name;
+                        jobs_[hash_job_id].params["metadata"] = result.metadata;
+                    }
+                }
+                complete_linked_job(hash_job_id, {result.sha256});
+            }
+        } else if (!hash_job_id.empty()) {
+            // Update hash job with file path and add to pending queue
             std::lock_guard<std::mutex> lock(queue_mutex_);
             if (jobs_.count(hash_job_id)) {
                 jobs_[hash_job_id].params["file_path"] = result.file_path;
                 jobs_[hash_job_id].params["file_name"] = result.file_name;
                 jobs_[hash_job_id].params["metadata"] = result.metadata;
-                pending_queue_.push(hash_job_id);
+                record_job_locked(jobs_[hash_job_id]);
+                pending_queue_.push_back(hash_job_id);
             }
-            queue_cv_.notify_one();
+            queue_cv_.notify_all();
         }
 
-        // Rescan models to pick up the new file
-        model_manager_.scan_models();
-
     } catch (const std::exception& e) {
         // Fail the linked hash job
         if (!hash_job_id.empty()) {
             fail_linked_job(hash_job_id, "Download failed: " + std::string(e.what()));
-            save_state();
         }
         throw;
     }
@@ -1869,6 +3860,27 @@ std::vector<std::string> QueueManager::process_model_hash_unlocked(
 ) {
     std::vector<std::string> outputs;
 
+    // Batch form (POST /models/hash): hash several files concurrently
+    if (params.contains("file_paths")) {
+        auto paths = params["file_paths"].get<std::vector<std::string>>();
+        update_progress(0, static_cast<int>(paths.size()));
+
+        auto hashes = model_manager_.hash_model_files(paths, MODEL_HASH_THREADS,
+            [this](size_t done, size_t total) {
+                update_progress(static_cast<int>(done), static_cast<int>(total));
+            });
+
+        for (const auto& path : paths) {
+            auto it = hashes.find(path);
+            outputs.push_back(it != hashes.end() ? it->second : "");
+        }
+        std::cout << "[QueueManager] Hashed " << hashes.size() << "/" << paths.size() << " model files" << std::endl;
+        if (hashes.empty() && !paths.empty()) {
+            throw std::runtime_error("None of the " + std::to_string(paths.size()) + " files could be hashed");
+        }
+        return outputs;
+    }
+
     std::string file_path = params.value("file_path", "");
     if (file_path.empty()) {
         throw std::runtime_error("File path is required for hashing");
@@ -1882,21 +3894,16 @@ std::vector<std::string> QueueManager::process_model_hash_unlocked(
     // Update progress
     update_progress(0, 100);
 
-    // Compute hash
-    std::string hash = utils::compute_sha256(file_path);
+    // Cached by (path, size, mtime); otherwise a fast sequential read
+    std::string hash = model_manager_.hash_model_file(file_path, [this](uint64_t done, uint64_t total) {
+        if (total > 0) update_progress(static_cast<int>(done * 100 / total), 100);
+    });
 
     update_progress(100, 100);
 
     // Store the hash in outputs for visibility
     outputs.push_back(hash);
 
-    // Update the model registry with the hash if possible
-    std::string model_type = params.value("model_type", "");
-    if (!model_type.empty()) {
-        // The model manager will pick this up on next scan or we can update it directly
-        // For now, we'll just return the hash
-    }
-
     std::cout << "[QueueManager] Computed hash for " << file_path << ": " << hash << std::endl;
 
     return outputs;
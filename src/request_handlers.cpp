@@ -10,6 +10,18 @@
 #include "utils.hpp"
 #include "prompt_template.hpp"
 #include "sd_wrapper.hpp"
+#include "image_resize.hpp"
+#include "image_encoder.hpp"
+#include "image_input.hpp"
+#include "thumbnail_cache.hpp"
+#include "file_server.hpp"
+#include "upload_writer.hpp"
+#include "http_front_end.hpp"
+#include "video_encoder.hpp"
+#include "metrics.hpp"
+#include "cluster_coordinator.hpp"
+#include "startup_status.hpp"
+#include "websocket_server.hpp"
 
 #ifdef SDCPP_ASSISTANT_ENABLED
 #include "assistant_client.hpp"
@@ -29,14 +41,9 @@
 #include <vector>
 #include <array>
 #include <cstdint>
+#include <limits>
 #include <chrono>
 #include <unordered_set>
-#ifndef _WIN32
-#include <unistd.h>  // getpid() for atomic-rename temp files in WebDAV PUT
-#else
-#include <process.h>
-#define getpid _getpid
-#endif
 
 #include "stb_image.h"
 #include "stb_image_write.h"
@@ -45,107 +52,6 @@ namespace fs = std::filesystem;
 
 namespace sdcpp {
 
-// Serve a regular file with proper HTTP caching and chunked streaming.
-//
-// Why this exists: the previous code path read each file into a
-// std::stringstream, copied the contents into a std::string, then handed
-// that to res.set_content() — three allocations per request and a
-// worker thread pinned for the entire transfer. Worse, no cache headers
-// were sent at all, so every browser repaint of an output image did a
-// full re-download. This helper:
-//
-//   - Sends Cache-Control: public, max-age=31536000, immutable. Outputs
-//     are write-once (the filename embeds job_id) so aggressive caching
-//     is safe.
-//   - Sends ETag (size-mtime) + Last-Modified, and short-circuits with
-//     304 Not Modified when the client's If-None-Match / If-Modified-Since
-//     matches.
-//   - Streams the file via set_content_provider() with a 64 KB buffer
-//     instead of buffering the whole thing in RAM. httplib auto-handles
-//     Range: requests on top of this (Accept-Ranges: bytes), which is
-//     what mobile video players need to seek.
-static void serve_file_cached(const httplib::Request& req,
-                              httplib::Response& res,
-                              const fs::path& full_path,
-                              const std::string& mime) {
-    std::error_code ec;
-    auto file_size = fs::file_size(full_path, ec);
-    if (ec) {
-        res.status = 500;
-        res.set_content("Cannot stat file", "text/plain");
-        return;
-    }
-    auto file_mtime = fs::last_write_time(full_path, ec);
-    if (ec) {
-        res.status = 500;
-        res.set_content("Cannot stat file", "text/plain");
-        return;
-    }
-    // C++20 file_clock → system_clock for an RFC 1123 timestamp.
-    auto sys_mtime = std::chrono::file_clock::to_sys(file_mtime);
-    std::time_t mtime_t = std::chrono::system_clock::to_time_t(sys_mtime);
-
-    std::string etag =
-        "\"" + std::to_string(static_cast<uint64_t>(file_size))
-        + "-" + std::to_string(static_cast<int64_t>(mtime_t)) + "\"";
-
-    char lm_buf[64];
-    std::strftime(lm_buf, sizeof(lm_buf),
-                  "%a, %d %b %Y %H:%M:%S GMT", std::gmtime(&mtime_t));
-    std::string last_modified(lm_buf);
-
-    // 304 short-circuit. Strong-compare the ETag (no W/ prefix in use)
-    // and exact-match Last-Modified. Sending the same caching headers on
-    // the 304 lets the browser keep its existing cache entry alive.
-    std::string inm = req.get_header_value("If-None-Match");
-    std::string ims = req.get_header_value("If-Modified-Since");
-    bool not_modified =
-        (!inm.empty() && inm == etag) ||
-        (!ims.empty() && ims == last_modified);
-    if (not_modified) {
-        res.status = 304;
-        res.set_header("ETag", etag);
-        res.set_header("Last-Modified", last_modified);
-        res.set_header("Cache-Control", "public, max-age=31536000, immutable");
-        return;
-    }
-
-    res.set_header("ETag", etag);
-    res.set_header("Last-Modified", last_modified);
-    res.set_header("Cache-Control", "public, max-age=31536000, immutable");
-    res.set_header("Accept-Ranges", "bytes");
-
-    const std::string path_str = full_path.string();
-    res.set_content_provider(
-        static_cast<size_t>(file_size), mime,
-        [path_str](size_t offset, size_t length, httplib::DataSink& sink) -> bool {
-            // Fixed-length provider: do NOT call sink.done() — that field
-            // is only wired up by httplib for set_content_provider_without_length().
-            // Calling it here throws std::bad_function_call. We just write
-            // exactly `length` bytes from `offset` and return true; httplib
-            // tracks completion via the declared content length.
-            std::ifstream f(path_str, std::ios::binary);
-            if (!f) return false;
-            f.seekg(static_cast<std::streamoff>(offset));
-            if (!f) return false;
-            constexpr size_t CHUNK = 64 * 1024;
-            std::array<char, CHUNK> buf{};
-            size_t remaining = length;
-            while (remaining > 0 && f) {
-                size_t to_read = std::min(remaining, CHUNK);
-                f.read(buf.data(), static_cast<std::streamsize>(to_read));
-                auto n = f.gcount();
-                if (n <= 0) break;
-                if (!sink.write(buf.data(), static_cast<size_t>(n))) {
-                    // Client disconnected; bail out cleanly.
-                    return false;
-                }
-                remaining -= static_cast<size_t>(n);
-            }
-            return true;
-        });
-}
-
 // Decorate a serialized QueueItem with absolute `output_urls[]` derived
 // from the current request. Caller-provided base_url is computed once
 // per request via compute_base_url() so listing endpoints don't pay the
@@ -173,9 +79,12 @@ RequestHandlers::RequestHandlers(ModelManager& model_manager, QueueManager& queu
       auth_manager_(auth_manager),
       paths_config_(config.paths),
       allow_public_outputs_(config.auth.allow_public_outputs),
+      allow_public_metrics_(config.auth.allow_public_metrics),
       trusted_proxies_(config.server.trusted_proxies),
+      webdav_max_depth_(config.server.webdav_max_depth),
       mcp_image_tool_enabled_(config.mcp.image_tool_enabled),
       output_dir_(output_dir), webui_dir_(webui_dir), docs_dir_(docs_dir)
+    , files_(std::make_unique<FileServer>(static_cast<size_t>(config.server.static_cache_mb) * 1024 * 1024))
     // ArchitectureManager uses config directory (where model_architectures.json lives), not output directory
     , architecture_manager_(std::make_unique<ArchitectureManager>(
           config_file_path.empty() ? output_dir : fs::path(config_file_path).parent_path().string()))
@@ -187,27 +96,46 @@ RequestHandlers::RequestHandlers(ModelManager& model_manager, QueueManager& queu
     }
 
 #ifdef SDCPP_ASSISTANT_ENABLED
-    // Build the documentation index up front so the assistant's
-    // search_docs tool can answer "how do I…" questions about features
-    // (auth, mount, RunPod, MCP, etc.). Empty / missing docs_dir → empty
-    // index → tool returns no results gracefully.
-    docs_index_ = std::make_unique<DocsIndex>(docs_dir);
-
-    // Create tool executor for backend query tool execution
-    tool_executor_ = std::make_unique<ToolExecutor>(
-        model_manager_, queue_manager_, architecture_manager_.get());
-    tool_executor_->set_output_dir(output_dir);
-    tool_executor_->set_settings_manager(settings_manager_.get());
-    tool_executor_->set_docs_index(docs_index_.get());
-
-    // Create assistant client with tool executor
-    assistant_client_ = std::make_unique<AssistantClient>(
-        assistant_config, output_dir, config_file_path, tool_executor_.get());
+    assistant_config_ = assistant_config;
+    config_file_path_ = config_file_path;
 #else
     (void)assistant_config;  // Suppress unused parameter warning
 #endif
 }
 
+#ifdef SDCPP_ASSISTANT_ENABLED
+AssistantClient& RequestHandlers::assistant() {
+    std::call_once(assistant_once_, [this]() {
+        // Create tool executor for backend query tool execution
+        tool_executor_ = std::make_unique<ToolExecutor>(
+            model_manager_, queue_manager_, architecture_manager_.get());
+        tool_executor_->set_output_dir(output_dir_);
+        tool_executor_->set_settings_manager(settings_manager_.get());
+        tool_executor_->set_docs_index([this]() { return docs_index(); });
+
+        // Create assistant client with tool executor
+        assistant_client_ = std::make_unique<AssistantClient>(
+            assistant_config_, output_dir_, config_file_path_, tool_executor_.get());
+    });
+    return *assistant_client_;
+}
+
+DocsIndex* RequestHandlers::docs_index() {
+    // The documentation index lets the assistant's search_docs tool answer
+    // "how do I…" questions about features (auth, mount, RunPod, MCP,
+    // etc.). Reading and indexing every docs/*.md is the slow part of the
+    // assistant, so it waits for the first search; after the first run the
+    // tokenized chunks come from <output>/docs_index.bin and only edited
+    // files are read again. Empty / missing docs_dir → empty index → tool
+    // returns no results gracefully.
+    std::call_once(docs_index_once_, [this]() {
+        const std::string cache = output_dir_.empty() ? "" : (fs::path(output_dir_) / "docs_index.bin").string();
+        docs_index_ = std::make_unique<DocsIndex>(docs_dir_, cache);
+    });
+    return docs_index_.get();
+}
+#endif
+
 void RequestHandlers::register_routes(httplib::Server& server) {
     using namespace api;
     using FT = schema::FieldType;
@@ -302,18 +230,8 @@ void RequestHandlers::register_routes(httplib::Server& server) {
                     return httplib::Server::HandlerResponse::Unhandled;
                 }
 
-                // /login is a public page. /assets, /favicon, /login.css are
-                // referenced by it and must be reachable too.
-                if (req.path == "/login" ||
-                    req.path == "/login.css" ||
-                    req.path == "/login.html" ||
-                    req.path == "/favicon.ico" ||
-                    req.path == "/favicon.svg") {
-                    return httplib::Server::HandlerResponse::Unhandled;
-                }
-
-                // Allowlist (health, openapi, /auth/login, /ui/, /docs/,
-                // /output/, /thumb/, /webdav/, /assets/).
+                // Allowlist (health, openapi, /auth/login, the /login page
+                // and its assets, /ui/, /docs/, /webdav/): one trie lookup.
                 if (AuthManager::is_always_allowed(req.path)) {
                     return httplib::Server::HandlerResponse::Unhandled;
                 }
@@ -332,6 +250,9 @@ void RequestHandlers::register_routes(httplib::Server& server) {
                         return httplib::Server::HandlerResponse::Unhandled;
                     }
                 }
+                if (allow_public_metrics_ && req.path == "/metrics") {
+                    return httplib::Server::HandlerResponse::Unhandled;
+                }
 
                 // Resolve "who is this caller?" trying, in order:
                 //   1. Cookie (sdcpp_auth=<token>) — set by /auth/login,
@@ -409,11 +330,33 @@ void RequestHandlers::register_routes(httplib::Server& server) {
         "Server health check", "Status", 200,
         [this](auto& req, auto& res) { handle_health(req, res); });
 
+    // Probes for orchestrators: cheap, and independent of the model state
+    api.addEndpointRaw(
+        server, "GET", "/health/live", "/health/live",
+        "Liveness probe: 200 as soon as the listener is up", "Status", 200,
+        [](auto& /*req*/, auto& res) { res.set_content(R"({"status":"alive"})", "application/json"); });
+
+    api.addEndpointRaw(
+        server, "GET", "/health/ready", "/health/ready",
+        "Readiness probe: 200 once the startup stages finished (?model=true: and a model is loaded), else 503", "Status", 200,
+        [this](auto& req, auto& res) { handle_health_ready(req, res); });
+
     api.addEndpoint<void, MemoryResponse>(
         server, "GET", "/memory",
         "System and GPU memory status", "Status", 200,
         [this](auto& req, auto& res) { handle_memory(req, res); });
 
+    api.addEndpointRaw(
+        server, "GET", "/cluster/nodes", "/cluster/nodes",
+        "Cluster worker nodes and their polled state (coordinator mode)", "Status", 200,
+        [this](auto& req, auto& res) { handle_cluster_nodes(req, res); });
+
+    api.addEndpointRaw(
+        server, "GET", "/metrics", "/metrics",
+        "Prometheus metrics: queue, jobs, models, caches, memory, HTTP", "Status", 200,
+        [this](auto& req, auto& res) { handle_metrics(req, res); })
+        .response_type("text/plain; version=0.0.4");
+
     api.addEndpoint<void, OptionsResponse>(
         server, "GET", "/options",
         "Available samplers, schedulers, quantization types", "Status", 200,
@@ -442,13 +385,19 @@ void RequestHandlers::register_routes(httplib::Server& server) {
     api.addEndpoint<void, ModelRefreshResponse>(
         server, "POST", "/models/refresh",
         "Rescan model directories", "Models", 200,
-        [this](auto& req, auto& res) { handle_refresh_models(req, res); });
+        [this](auto& req, auto& res) { handle_refresh_models(req, res); })
+        .query("full", FT::Boolean, "Re-read every directory instead of only changed ones", false, false);
 
     api.addEndpoint<LoadModelRequest, LoadModelResponse>(
         server, "POST", "/models/load",
         "Load a model into memory", "Models", 200,
         [this](auto& req, auto& res) { handle_load_model(req, res); });
 
+    api.addEndpoint<LoadModelRequest, PrefetchModelResponse>(
+        server, "POST", "/models/prefetch",
+        "Read a model's files into RAM ahead of loading it", "Models", 202,
+        [this](auto& req, auto& res) { handle_prefetch_model(req, res); });
+
     api.addEndpoint<void, SuccessResponse>(
         server, "POST", "/models/unload",
         "Unload the current model", "Models", 200,
@@ -487,6 +436,12 @@ void RequestHandlers::register_routes(httplib::Server& server) {
         .path_param("model_type", FT::String, "Model type category")
         .path_param("model_name", FT::String, "Model filename");
 
+    api.addEndpoint<HashModelsRequest, JobCreatedResponse>(
+        server, "POST", "/models/hash",
+        "Queue SHA256 hashing of several models (default: every model without a hash)",
+        "Models", 202,
+        [this](auto& req, auto& res) { handle_hash_models(req, res); });
+
     api.addEndpoint<void, ModelPathsResponse>(
         server, "GET", "/models/paths",
         "Get configured model storage paths", "Models", 200,
@@ -496,11 +451,11 @@ void RequestHandlers::register_routes(httplib::Server& server) {
     // the OpenAPI spec yet (SchemaBuilder doesn't have multipart support).
     // The endpoint is auth-protected automatically via the pre-routing
     // middleware. See handle_upload_model() for the field contract.
-    api.addEndpoint<void, UploadModelResponse>(
+    api.addStreamingEndpoint<UploadModelResponse>(
         server, "POST", "/models/upload",
         "Upload a model file (multipart/form-data: file, model_type, [filename], [subfolder])",
         "Models", 201,
-        [this](auto& req, auto& res) { handle_upload_model(req, res); });
+        [this](auto& req, auto& res, auto& reader) { handle_upload_model(req, res, reader); });
 
     // ── Model Downloads ──────────────────────────────────────────────
     api.addEndpoint<DownloadModelRequest, DownloadModelResponse>(
@@ -544,6 +499,11 @@ void RequestHandlers::register_routes(httplib::Server& server) {
         "Upscale image using ESRGAN", "Generation", 202,
         [this](auto& req, auto& res) { handle_upscale(req, res); });
 
+    api.addEndpoint<PipelineRequest, JobCreatedResponse>(
+        server, "POST", "/pipeline",
+        "Run chained stages (txt2img/img2img -> upscale/adetailer/img2img) as one job", "Generation", 202,
+        [this](auto& req, auto& res) { handle_pipeline(req, res); });
+
     api.addEndpoint<ConvertRequest, JobCreatedResponse>(
         server, "POST", "/convert",
         "Convert model format (safetensors to GGUF)", "Generation", 202,
@@ -585,6 +545,29 @@ void RequestHandlers::register_routes(httplib::Server& server) {
         [this](auto& req, auto& res) { handle_get_job(req, res); })
         .path_param("job_id", FT::String, "Job UUID");
 
+    api.addEndpointRaw(
+        server, "GET", "/queue/{job_id}/wait",
+        R"(/queue/([a-f0-9\-]+)/wait)",
+        "Wait for a job to finish (long-poll)", "Queue", 200,
+        [this](auto& req, auto& res) { handle_wait_job(req, res); })
+        .path_param("job_id", FT::String, "Job UUID")
+        .query("timeout", FT::Integer, "Seconds to wait (capped at queue.max_wait_seconds)", false, 30);
+
+    api.addEndpointRaw(
+        server, "GET", "/queue/{job_id}/events",
+        R"(/queue/([a-f0-9\-]+)/events)",
+        "Stream a job's progress and status (SSE)", "Queue", 200,
+        [this](auto& req, auto& res) { handle_job_events(req, res); })
+        .path_param("job_id", FT::String, "Job UUID")
+        .response_type("text/event-stream");
+
+    api.addEndpointRaw(
+        server, "GET", "/queue/{job_id}/trace",
+        R"(/queue/([a-f0-9\-]+)/trace)",
+        "Chrome trace of a job's execution (queue.trace_jobs)", "Queue", 200,
+        [this](auto& req, auto& res) { handle_get_job_trace(req, res); })
+        .path_param("job_id", FT::String, "Job UUID");
+
     api.addEndpointRaw(
         server, "DELETE", "/queue/{job_id}",
         R"(/queue/([a-f0-9\-]+))",
@@ -651,6 +634,7 @@ void RequestHandlers::register_routes(httplib::Server& server) {
         "Get thumbnail for image/video file", "Files", 200,
         [this](auto& req, auto& res) { handle_thumbnail(req, res); })
         .path_param("path", FT::String, "File path relative to output directory")
+        .query("size", FT::Integer, "Edge length in px, snapped to the nearest configured size", false, 120)
         .response_type("image/jpeg");
 
     api.addEndpoint<void, void>(
@@ -684,18 +668,13 @@ void RequestHandlers::register_routes(httplib::Server& server) {
         // <webui_dir>/login.{html,css}. The pre-routing handler skips auth
         // for these paths so anyone can reach them.
         auto serve_static = [this](const std::string& filename, const std::string& mime,
-                                    const httplib::Request&, httplib::Response& res) {
+                                    const httplib::Request& req, httplib::Response& res) {
             namespace fs = std::filesystem;
             fs::path p = fs::path(webui_dir_) / filename;
-            std::ifstream f(p, std::ios::binary);
-            if (!f) {
+            if (!files_->serve_asset(req, res, p.string(), mime, FileServer::REVALIDATE)) {
                 res.status = 404;
                 res.set_content("Not found", "text/plain");
-                return;
             }
-            std::stringstream buf;
-            buf << f.rdbuf();
-            res.set_content(buf.str(), mime.c_str());
         };
         server.Get("/login", [serve_static](const httplib::Request& req, httplib::Response& res) {
             serve_static("login.html", "text/html; charset=utf-8", req, res);
@@ -847,8 +826,9 @@ void RequestHandlers::register_routes(httplib::Server& server) {
     server.Get(R"(/webdav/(.*))", [this](const httplib::Request& req, httplib::Response& res) {
         handle_webdav_get(req, res, /*head_only=*/(req.method == "HEAD"));
     });
-    server.Put(R"(/webdav/(.*))", [this](const httplib::Request& req, httplib::Response& res) {
-        handle_webdav_put(req, res);
+    server.Put(R"(/webdav/(.*))", [this](const httplib::Request& req, httplib::Response& res,
+                                         const httplib::ContentReader& content_reader) {
+        handle_webdav_put(req, res, content_reader);
     });
     server.Delete(R"(/webdav/(.*))", [this](const httplib::Request& req, httplib::Response& res) {
         handle_webdav_delete(req, res);
@@ -1023,20 +1003,7 @@ void RequestHandlers::handle_health(const httplib::Request& req, httplib::Respon
     // /health is a no-auth endpoint so callers without a session see null;
     // callers with a valid cookie/bearer get their username back.
     nlohmann::json username = nullptr;
-    if (auth_manager_.enabled()) {
-        std::string token = extract_cookie_token(req);
-        if (token.empty()) {
-            std::string h = req.get_header_value("Authorization");
-            const std::string p = "Bearer ";
-            if (h.size() > p.size() && h.compare(0, p.size(), p) == 0) {
-                token = h.substr(p.size());
-            }
-        }
-        if (!token.empty()) {
-            auto u = auth_manager_.verify_token(token);
-            if (u.has_value()) username = *u;
-        }
-    }
+    if (std::string user = authenticated_user(req); !user.empty()) username = user;
     auto memory_info = get_memory_info();
 
     nlohmann::json response = {
@@ -1054,6 +1021,8 @@ void RequestHandlers::handle_health(const httplib::Request& req, httplib::Respon
         {"model_architecture", loaded_info["model_architecture"]},
         {"loaded_components", loaded_info["loaded_components"]},
         {"load_options", loaded_info.contains("load_options") ? loaded_info["load_options"] : nlohmann::json(nullptr)},
+        {"rpc_split", loaded_info.contains("rpc_split") ? loaded_info["rpc_split"] : nlohmann::json(nullptr)},
+        {"offload_tune", loaded_info.contains("offload_tune") ? loaded_info["offload_tune"] : nlohmann::json(nullptr)},
         {"username", username},
         {"upscaler_loaded", loaded_info["upscaler_loaded"]},
         {"upscaler_name", loaded_info["upscaler_name"]},
@@ -1063,6 +1032,17 @@ void RequestHandlers::handle_health(const httplib::Request& req, httplib::Respon
         {"ws_enabled", false},
 #endif
         {"memory", memory_info.to_json()},
+        {"model_cache", model_manager_.get_model_cache_stats()},
+        {"lora_cache", model_manager_.get_lora_cache_stats()},
+        {"conditioning_cache", model_manager_.get_conditioning_cache_stats()},
+        {"model_catalog", model_manager_.get_catalog_stats()},
+        {"quant_cache", model_manager_.quant_cache().stats_json()},
+        {"numa_placement", model_manager_.get_numa_stats()},
+        {"thumbnails", thumbnails_ ? thumbnails_->stats_json() : nlohmann::json(nullptr)},
+        {"file_server", files_->stats_json()},
+        {"front_end", front_end_ ? front_end_->stats_json() : nlohmann::json(nullptr)},
+        {"startup", startup_ ? startup_->to_json() : nlohmann::json(nullptr)},
+        {"image_encoders", image_encoder_backends()},
         {"features", {
 #ifdef SDCPP_EXPERIMENTAL_OFFLOAD
             {"experimental_offload", true},
@@ -1094,6 +1074,8 @@ void RequestHandlers::handle_health(const httplib::Request& req, httplib::Respon
             // tool that returns generated images inline is enabled.
             {"mcp_image_tool", mcp_image_tool_enabled_},
             {"controlnet_hotswap", true},
+            {"webp_output", image_format_available(ImageFormat::Webp)},
+            {"video_output", video_encoder_backends()},
             {"auth_required", auth_manager_.enabled()}
         }}
     };
@@ -1101,9 +1083,69 @@ void RequestHandlers::handle_health(const httplib::Request& req, httplib::Respon
     send_json(res, response);
 }
 
+void RequestHandlers::handle_metrics(const httplib::Request& /*req*/, httplib::Response& res) {
+    // Recorded histograms and counters, then gauges read now. Nothing here
+    // takes queue_mutex_ or the model context mutex.
+    std::string out = metrics::registry().render();
+    queue_manager_.append_metrics(out);
+    model_manager_.append_metrics(out);
+
+    const MemoryInfo mem = get_memory_info();
+    metrics::write_header(out, "sdcpp_process_resident_bytes", "Resident set size of the server", "gauge");
+    metrics::write_sample(out, "sdcpp_process_resident_bytes", "", static_cast<double>(mem.process_rss));
+    metrics::write_header(out, "sdcpp_system_memory_available_bytes", "Host RAM available", "gauge");
+    metrics::write_sample(out, "sdcpp_system_memory_available_bytes", "", static_cast<double>(mem.system_free));
+    if (mem.gpu_available) {
+        const std::string gpu = metrics::label("gpu", mem.gpu_name);
+        metrics::write_header(out, "sdcpp_gpu_memory_total_bytes", "GPU memory", "gauge");
+        metrics::write_sample(out, "sdcpp_gpu_memory_total_bytes", gpu, static_cast<double>(mem.gpu_total));
+        metrics::write_header(out, "sdcpp_gpu_memory_used_bytes", "GPU memory in use (all processes)", "gauge");
+        metrics::write_sample(out, "sdcpp_gpu_memory_used_bytes", gpu, static_cast<double>(mem.gpu_used));
+        metrics::write_header(out, "sdcpp_gpu_memory_free_bytes", "GPU memory free", "gauge");
+        metrics::write_sample(out, "sdcpp_gpu_memory_free_bytes", gpu, static_cast<double>(mem.gpu_free));
+    }
+
+    auto* ws = get_websocket_server();
+    metrics::write_header(out, "sdcpp_websocket_clients", "Connected WebSocket clients", "gauge");
+    metrics::write_sample(out, "sdcpp_websocket_clients", "", ws ? static_cast<double>(ws->get_client_count()) : 0);
+    metrics::write_header(out, "sdcpp_websocket_dropped_messages_total",
+                          "Messages evicted from slow clients' outboxes", "counter");
+    metrics::write_sample(out, "sdcpp_websocket_dropped_messages_total", "",
+                          static_cast<double>(WebSocketServer::dropped_messages_total()));
+
+    res.set_content(out, "text/plain; version=0.0.4; charset=utf-8");
+}
+
+void RequestHandlers::handle_health_ready(const httplib::Request& req, httplib::Response& res) {
+    const bool want_model = req.get_param_value("model") == "true";
+    const bool ready = !startup_ || startup_->ready();
+    const bool model_ready = model_manager_.is_model_loaded() && !model_manager_.is_loading();
+
+    nlohmann::json response = {
+        {"ready", ready && (!want_model || model_ready)},
+        {"model_ready", model_ready},
+        {"startup", startup_ ? startup_->to_json() : nlohmann::json(nullptr)}
+    };
+    send_json(res, response, response["ready"].get<bool>() ? 200 : 503);
+}
+
 void RequestHandlers::handle_memory(const httplib::Request& /*req*/, httplib::Response& res) {
     auto memory_info = get_memory_info();
-    send_json(res, memory_info.to_json());
+    nlohmann::json body = memory_info.to_json();
+    body["model_cache"] = model_manager_.get_model_cache_stats();
+    body["lora_cache"] = model_manager_.get_lora_cache_stats();
+    body["conditioning_cache"] = model_manager_.get_conditioning_cache_stats();
+    body["prefetch"] = model_manager_.get_prefetch_stats();
+    body["numa_placement"] = model_manager_.get_numa_stats();
+    send_json(res, body);
+}
+
+void RequestHandlers::handle_cluster_nodes(const httplib::Request& /*req*/, httplib::Response& res) {
+    if (!cluster_ || !cluster_->enabled()) {
+        send_json(res, {{"role", "standalone"}, {"nodes", nlohmann::json::array()}});
+        return;
+    }
+    send_json(res, cluster_->status_json());
 }
 
 void RequestHandlers::handle_get_options(const httplib::Request& /*req*/, httplib::Response& res) {
@@ -1210,11 +1252,14 @@ void RequestHandlers::handle_get_models(const httplib::Request& req, httplib::Re
     send_json(res, model_manager_.get_models_json(filter));
 }
 
-void RequestHandlers::handle_refresh_models(const httplib::Request& /*req*/, httplib::Response& res) {
-    std::cout << "[RequestHandlers] Refreshing model list..." << std::endl;
+void RequestHandlers::handle_refresh_models(const httplib::Request& req, httplib::Response& res) {
+    // ?full=true re-reads every directory; the default only revisits
+    // directories whose mtime changed
+    bool full = req.get_param_value("full") == "true";
+    std::cout << "[RequestHandlers] Refreshing model list" << (full ? " (full rescan)" : "") << "..." << std::endl;
 
-    // Rescan all model directories
-    model_manager_.scan_models();
+    // Rescan model directories
+    model_manager_.scan_models(full);
 
     // Return success with updated model list
     nlohmann::json response = {
@@ -1430,6 +1475,27 @@ void RequestHandlers::handle_load_model(const httplib::Request& req, httplib::Re
     }
 }
 
+void RequestHandlers::handle_prefetch_model(const httplib::Request& req, httplib::Response& res) {
+    // Unlike /models/load this is fine while another model is loaded and
+    // generating: it only reads files, so the next load starts from RAM
+    try {
+        auto body = parse_json_body(req);
+        auto params = ModelLoadParams::from_json(body);
+
+        if (model_manager_.is_model_loaded() &&
+            model_manager_.get_loaded_model_name() == params.model_name) {
+            send_json(res, {{"model_name", params.model_name}, {"state", "loaded"}});
+            return;
+        }
+
+        send_json(res, model_manager_.prefetch_model(params), 202);
+    } catch (const nlohmann::json::exception& e) {
+        send_error(res, std::string("Invalid JSON: ") + e.what(), 400);
+    } catch (const std::exception& e) {
+        send_error(res, e.what(), 400);
+    }
+}
+
 void RequestHandlers::handle_unload_model(const httplib::Request& /*req*/, httplib::Response& res) {
     model_manager_.unload_model();
     send_json(res, {
@@ -1501,7 +1567,7 @@ void RequestHandlers::handle_adetailer(const httplib::Request& req, httplib::Res
             return;
         }
 
-        auto body = parse_json_body(req);
+        auto body = parse_image_request_body(req, "image_base64");
 
         // Optional user-supplied display title — strip before typed validation.
         std::string title;
@@ -1509,6 +1575,8 @@ void RequestHandlers::handle_adetailer(const httplib::Request& req, httplib::Res
             title = body["title"].get<std::string>();
         }
         body.erase("title");
+        JobOrigin origin;
+        if (!take_job_origin(req, body, origin, res)) return;
 
         // Validate body shape at the boundary. The worker re-parses via
         // AdetailerParams::from_json against the stored body.
@@ -1519,7 +1587,12 @@ void RequestHandlers::handle_adetailer(const httplib::Request& req, httplib::Res
             return;
         }
 
-        std::string job_id = queue_manager_.add_job(GenerationType::ADetailer, body, title);
+        auto submitted = queue_manager_.submit_job(GenerationType::ADetailer, body, title, false, origin);
+        if (!submitted.refusal.empty()) {
+            send_error(res, submitted.refusal, 429);
+            return;
+        }
+        const std::string& job_id = submitted.job_id;
         auto status = queue_manager_.get_status();
         send_json(res, {
             {"job_id", job_id},
@@ -1551,6 +1624,55 @@ void RequestHandlers::handle_get_model_hash(const httplib::Request& req, httplib
     }
 }
 
+void RequestHandlers::handle_hash_models(const httplib::Request& req, httplib::Response& res) {
+    try {
+        nlohmann::json body = req.body.empty() ? nlohmann::json::object() : nlohmann::json::parse(req.body);
+
+        std::optional<ModelType> type;
+        if (body.contains("model_type")) {
+            type = string_to_model_type(body["model_type"].get<std::string>());
+        }
+
+        std::vector<std::string> paths;
+        if (body.contains("names")) {
+            if (!type) {
+                send_error(res, "model_type is required when names are given", 400);
+                return;
+            }
+            auto models = model_manager_.get_models(*type);
+            for (const auto& name : body["names"].get<std::vector<std::string>>()) {
+                auto it = std::find_if(models.begin(), models.end(),
+                                       [&](const ModelInfo& m) { return m.name == name; });
+                if (it == models.end()) {
+                    send_error(res, "Model not found: " + name, 404);
+                    return;
+                }
+                paths.push_back(it->full_path);
+            }
+        } else {
+            paths = model_manager_.get_unhashed_model_paths(type);
+        }
+
+        if (paths.empty()) {
+            send_error(res, "No models to hash", 400);
+            return;
+        }
+
+        std::string job_id = queue_manager_.add_job(GenerationType::ModelHash, {{"file_paths", paths}});
+        auto status = queue_manager_.get_status();
+        send_json(res, {
+            {"job_id", job_id},
+            {"status", "pending"},
+            {"position", status["pending_count"]},
+            {"file_count", paths.size()}
+        }, 202);
+    } catch (const nlohmann::json::exception& e) {
+        send_error(res, std::string("Invalid JSON: ") + e.what(), 400);
+    } catch (const std::exception& e) {
+        send_error(res, e.what(), 400);
+    }
+}
+
 void RequestHandlers::handle_txt2img(const httplib::Request& req, httplib::Response& res) {
     submit_generation_jobs(req, res, static_cast<int>(GenerationType::Text2Image));
 }
@@ -1570,6 +1692,12 @@ namespace {
 // these earlier; this is the server-side backstop.
 constexpr size_t MAX_PROMPT_VARIATIONS = 200;
 
+// Beyond MAX_PROMPT_VARIATIONS (or with "expand_prompt": "sweep") the
+// template becomes a single sweep job that walks the variations with a
+// PromptTemplateCursor, one generate call at a time. Nothing is
+// materialized, so this only bounds how long one job may run.
+constexpr size_t MAX_SWEEP_VARIATIONS = 1000000;
+
 // Normalize a generation request body so the queued job has clean JSON
 // types. Naive HTTP clients (shell scripts, form-encoded wrappers) often
 // send numbers and booleans as strings — `"steps": "9"`, `"easycache":
@@ -1630,13 +1758,47 @@ void RequestHandlers::submit_generation_jobs(const httplib::Request& req,
                                               httplib::Response& res,
                                               int generation_type_int) {
     try {
-        if (!model_manager_.is_model_loaded()) {
+        // A coordinator runs generations on its nodes, not on a local model
+        const bool coordinator = cluster_ && cluster_->enabled();
+        if (!coordinator && !model_manager_.is_model_loaded()) {
             send_error(res, "No model loaded", 400);
             return;
         }
 
-        auto body = parse_json_body(req);
         const auto type = static_cast<GenerationType>(generation_type_int);
+        // A raw image body is the init image (img2img, vid2vid)
+        auto body = parse_image_request_body(req, type == GenerationType::Text2Image ? "" : "init_image_base64");
+
+        // ?wait=true answers with the finished job instead of a job id to
+        // poll; ?timeout= bounds the wait (queue.max_wait_seconds at most)
+        bool wait = false;
+        if (req.has_param("wait")) {
+            std::string v = req.get_param_value("wait");
+            for (auto& c : v) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+            wait = (v == "1" || v == "true" || v == "yes" || v == "on");
+        }
+        int wait_timeout = std::numeric_limits<int>::max();
+        if (wait && req.has_param("timeout")) {
+            try {
+                wait_timeout = std::max(0, std::stoi(req.get_param_value("timeout")));
+            } catch (...) { /* keep the default */ }
+        }
+
+        // Coordinator mode: "model" picks the nodes that may run the job
+        // (matched against each node's loaded model, by name or file stem)
+        std::string model;
+        if (body.contains("model")) {
+            if (!coordinator) {
+                send_error(res, "model is only accepted in cluster coordinator mode; load models with POST /models/load", 400);
+                return;
+            }
+            if (!body["model"].is_string()) {
+                send_error(res, "model must be a string", 400);
+                return;
+            }
+            model = body["model"].get<std::string>();
+            body.erase("model");
+        }
 
         // Decide whether this is a template-expansion submission, then
         // strip the helper flag before normalization. expand_prompt isn't a
@@ -1644,9 +1806,32 @@ void RequestHandlers::submit_generation_jobs(const httplib::Request& req,
         // strict validator inside normalize_generation_body() would reject
         // it as an unknown field. Stripping here also keeps it out of the
         // per-variation params persisted on each queued job.
-        bool expand = body.value("expand_prompt", false);
+        bool expand = false;
+        bool sweep = false;
+        if (body.contains("expand_prompt")) {
+            const auto& flag = body["expand_prompt"];
+            if (flag.is_string() && flag.get<std::string>() == "sweep") {
+                expand = sweep = true;
+            } else if (flag.is_boolean()) {
+                expand = flag.get<bool>();
+            } else if (!flag.is_null()) {
+                send_error(res, "expand_prompt must be a boolean or \"sweep\"", 400);
+                return;
+            }
+        }
         body.erase("expand_prompt");
 
+        // "dedup": false opts out of reusing an identical earlier job
+        bool dedup = true;
+        if (body.contains("dedup")) {
+            if (!body["dedup"].is_boolean()) {
+                send_error(res, "dedup must be a boolean", 400);
+                return;
+            }
+            dedup = body["dedup"].get<bool>();
+        }
+        body.erase("dedup");
+
         // Optional user-supplied display title. Stored on the QueueItem
         // (not on params) so it never reaches the typed generation
         // structs — strip before strict validation.
@@ -1656,6 +1841,10 @@ void RequestHandlers::submit_generation_jobs(const httplib::Request& req,
         }
         body.erase("title");
 
+        // "priority" and the queueing user stay off params as well
+        JobOrigin origin;
+        if (!take_job_origin(req, body, origin, res)) return;
+
         // Type-coerce + validate the request body at the API boundary so
         // bad input (e.g. "steps": "abc") fails fast as a 400 rather than
         // crashing the worker, and unknown fields ("diffusion_fa") are
@@ -1668,6 +1857,14 @@ void RequestHandlers::submit_generation_jobs(const httplib::Request& req,
             send_error(res, std::string("Invalid request body: ") + e.what(), 400);
             return;
         }
+        if (!model.empty()) body["model"] = model;
+
+        // queue.vram_admission: refuse what can never fit on this GPU now,
+        // rather than after the model, conditioning and sampling time
+        if (auto refusal = queue_manager_.check_vram_admission(type, body); !refusal.empty()) {
+            send_error(res, refusal, 400);
+            return;
+        }
 
         std::string prompt;
         if (body.contains("prompt") && body["prompt"].is_string()) {
@@ -1677,10 +1874,31 @@ void RequestHandlers::submit_generation_jobs(const httplib::Request& req,
         // Fast path: no expansion requested, or no template syntax present.
         // Behaves identically to the previous direct add_job() flow.
         if (!expand || prompt.find('{') == std::string::npos) {
-            std::string job_id = queue_manager_.add_job(type, body, title);
+            auto submitted = queue_manager_.submit_job(type, body, title, dedup, origin);
+            if (!submitted.refusal.empty()) {
+                send_error(res, submitted.refusal, 429);
+                return;
+            }
+            if (wait) {
+                send_job_when_finished(req, res, submitted.job_id, wait_timeout, 202);
+                return;
+            }
+            if (submitted.deduplicated) {
+                const bool done = submitted.status == QueueStatus::Completed;
+                nlohmann::json result = {
+                    {"job_id", submitted.job_id},
+                    {"status", queue_status_to_string(submitted.status)},
+                    {"deduplicated", true}
+                };
+                if (done) {
+                    if (auto job = queue_manager_.get_job(submitted.job_id)) result["outputs"] = job->outputs;
+                }
+                send_json(res, result, done ? 200 : 202);
+                return;
+            }
             auto status = queue_manager_.get_status();
             send_json(res, {
-                {"job_id", job_id},
+                {"job_id", submitted.job_id},
                 {"status", "pending"},
                 {"position", status["pending_count"]}
             }, 202);
@@ -1689,23 +1907,71 @@ void RequestHandlers::submit_generation_jobs(const httplib::Request& req,
 
         // Expansion path. The parser throws std::runtime_error on malformed
         // input (unterminated brace, pick-N > options, etc.) — bubble that up
-        // as a 400 with the parser's message.
-        std::vector<std::string> variations;
+        // as a 400 with the parser's message. Count first: a large template
+        // is never expanded here.
+        size_t count = 0;
         try {
-            variations = expand_prompt_template(prompt);
+            count = count_prompt_variations(prompt);
         } catch (const std::exception& e) {
             send_error(res, std::string("Prompt template error: ") + e.what(), 400);
             return;
         }
-        if (variations.empty()) {
+        if (count == 0) {
             send_error(res, "Prompt template expanded to 0 variations", 400);
             return;
         }
-        if (variations.size() > MAX_PROMPT_VARIATIONS) {
-            send_error(res,
-                "Prompt template would create " + std::to_string(variations.size())
-                + " jobs, exceeds limit of " + std::to_string(MAX_PROMPT_VARIATIONS)
-                + ". Reduce the number of choices in the template.", 400);
+
+        if (sweep || count > MAX_PROMPT_VARIATIONS) {
+            if (coordinator) {
+                send_error(res, "Prompt sweeps are not dispatched to cluster nodes; use at most "
+                    + std::to_string(MAX_PROMPT_VARIATIONS) + " variations without \"sweep\"", 400);
+                return;
+            }
+            if (count > MAX_SWEEP_VARIATIONS) {
+                send_error(res,
+                    "Prompt template has " + (count == SIZE_MAX ? std::string("too many")
+                                                                : std::to_string(count))
+                    + " variations, exceeds the sweep limit of " + std::to_string(MAX_SWEEP_VARIATIONS)
+                    + ". Reduce the number of choices in the template.", 400);
+                return;
+            }
+            // One job; the worker keeps its place in variation_cursor
+            nlohmann::json job_params = body;
+            job_params["variation_template"] = prompt;
+            job_params["variation_total"] = static_cast<int64_t>(count);
+            job_params["variation_cursor"] = 0;
+            job_params["variation_sweep"] = true;
+            auto submitted = queue_manager_.submit_job(type, job_params, title, false, origin);
+            if (!submitted.refusal.empty()) {
+                send_error(res, submitted.refusal, 429);
+                return;
+            }
+            const std::string& job_id = submitted.job_id;
+            if (wait) {
+                send_job_when_finished(req, res, job_id, wait_timeout, 202);
+                return;
+            }
+            auto status = queue_manager_.get_status();
+            send_json(res, {
+                {"job_id", job_id},
+                {"sweep", true},
+                {"variation_count", count},
+                {"status", "pending"},
+                {"position", status["pending_count"]}
+            }, 202);
+            return;
+        }
+
+        if (wait) {
+            send_error(res, "?wait=true needs a single job; use \"expand_prompt\": \"sweep\" or wait on each job_id", 400);
+            return;
+        }
+
+        std::vector<std::string> variations;
+        try {
+            variations = expand_prompt_template(prompt);
+        } catch (const std::exception& e) {
+            send_error(res, std::string("Prompt template error: ") + e.what(), 400);
             return;
         }
 
@@ -1713,8 +1979,8 @@ void RequestHandlers::submit_generation_jobs(const httplib::Request& req,
         // the original templated prompt under `variation_template` so the UI
         // can display it as the group header.
         std::string group_id = utils::generate_uuid();
-        std::vector<std::string> job_ids;
-        job_ids.reserve(variations.size());
+        std::vector<nlohmann::json> jobs;
+        jobs.reserve(variations.size());
         for (size_t i = 0; i < variations.size(); ++i) {
             nlohmann::json job_params = body;
             job_params["prompt"] = variations[i];
@@ -1722,7 +1988,13 @@ void RequestHandlers::submit_generation_jobs(const httplib::Request& req,
             job_params["variation_index"] = static_cast<int>(i);
             job_params["variation_total"] = static_cast<int>(variations.size());
             job_params["variation_template"] = prompt;
-            job_ids.push_back(queue_manager_.add_job(type, job_params, title));
+            jobs.push_back(std::move(job_params));
+        }
+        std::string refusal;
+        const auto job_ids = queue_manager_.add_jobs(type, jobs, title, origin, refusal);
+        if (!refusal.empty()) {
+            send_error(res, refusal, 429);
+            return;
         }
 
         auto status = queue_manager_.get_status();
@@ -1745,7 +2017,7 @@ void RequestHandlers::handle_upscale(const httplib::Request& req, httplib::Respo
             return;
         }
 
-        auto body = parse_json_body(req);
+        auto body = parse_image_request_body(req, "image_base64");
 
         // Optional user-supplied display title — strip before strict
         // validation since UpscaleParams doesn't model it.
@@ -1754,6 +2026,8 @@ void RequestHandlers::handle_upscale(const httplib::Request& req, httplib::Respo
             title = body["title"].get<std::string>();
         }
         body.erase("title");
+        JobOrigin origin;
+        if (!take_job_origin(req, body, origin, res)) return;
 
         // Convenience: resolve `job_id` (+ optional `image_index`, defaults 0)
         // into the `image_base64` payload that UpscaleParams::from_json + the
@@ -1804,19 +2078,9 @@ void RequestHandlers::handle_upscale(const httplib::Request& req, httplib::Respo
                 return;
             }
 
-            // Read the raw file bytes and base64-encode them. UpscaleParams::
-            // from_json's decode_base64_image path expects encoded file bytes
-            // (matches what direct image_base64 callers send), not decoded
-            // pixel data — so we just slurp + encode, no stbi round-trip.
-            std::ifstream f(full_path, std::ios::binary);
-            if (!f) {
-                send_error(res, "Cannot open source image: " + full_path.string(), 500);
-                return;
-            }
-            std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(f)),
-                                       std::istreambuf_iterator<char>());
-
-            body["image_base64"] = utils::base64_encode(bytes);
+            // Queue a reference to the file; the worker decodes it straight
+            // from disk instead of from a base64 copy in the job params
+            body["image_base64"] = image_ref_for_path(full_path.string());
             body.erase("job_id");
             body.erase("image_index");
         }
@@ -1832,7 +2096,12 @@ void RequestHandlers::handle_upscale(const httplib::Request& req, httplib::Respo
             return;
         }
 
-        std::string job_id = queue_manager_.add_job(GenerationType::Upscale, body, title);
+        auto submitted = queue_manager_.submit_job(GenerationType::Upscale, body, title, false, origin);
+        if (!submitted.refusal.empty()) {
+            send_error(res, submitted.refusal, 429);
+            return;
+        }
+        const std::string& job_id = submitted.job_id;
         
         auto status = queue_manager_.get_status();
         
@@ -1846,6 +2115,88 @@ void RequestHandlers::handle_upscale(const httplib::Request& req, httplib::Respo
     }
 }
 
+void RequestHandlers::handle_pipeline(const httplib::Request& req, httplib::Response& res) {
+    try {
+        if (!model_manager_.is_model_loaded()) {
+            send_error(res, "No model loaded. Please load a model first using POST /models/load", 400);
+            return;
+        }
+
+        auto body = parse_json_body(req);
+
+        std::string title;
+        if (body.contains("title") && body["title"].is_string()) {
+            title = body["title"].get<std::string>();
+        }
+        body.erase("title");
+        JobOrigin origin;
+        if (!take_job_origin(req, body, origin, res)) return;
+
+        if (!body.contains("stages") || !body["stages"].is_array() || body["stages"].empty()) {
+            send_error(res, "stages must be a non-empty array", 400);
+            return;
+        }
+
+        // Validate every stage at the boundary, like the single-stage
+        // endpoints do; the worker re-parses each one as it runs it
+        const auto& stages = body["stages"];
+        for (size_t k = 0; k < stages.size(); ++k) {
+            const std::string where = "stages[" + std::to_string(k) + "]: ";
+            if (!stages[k].is_object()) {
+                send_error(res, where + "must be an object", 400);
+                return;
+            }
+            nlohmann::json stage = stages[k];
+            const std::string type = stage.value("type", "");
+            stage.erase("type");
+            stage.erase("persist");
+            try {
+                if (type == "txt2img") {
+                    if (k != 0) throw std::runtime_error("txt2img can only be the first stage");
+                    (void) Txt2ImgParams::from_json(stage);
+                } else if (type == "img2img") {
+                    auto p = Img2ImgParams::from_json(stage);
+                    if (k == 0 && p.init_image_data.empty()) {
+                        throw std::runtime_error("a first img2img stage needs init_image_base64");
+                    }
+                } else if (type == "upscale" || type == "adetailer") {
+                    if (k == 0) throw std::runtime_error(type + " needs an earlier stage to feed it");
+                    if (type == "upscale") {
+                        if (!model_manager_.is_upscaler_loaded()) {
+                            throw std::runtime_error("no upscaler loaded. Load one using POST /upscaler/load");
+                        }
+                    } else if (AdetailerParams::from_json(stage).detector.empty()) {
+                        throw std::runtime_error("detector is required");
+                    }
+                } else {
+                    throw std::runtime_error("unknown stage type '" + type +
+                                             "' (expected txt2img, img2img, upscale or adetailer)");
+                }
+            } catch (const std::exception& e) {
+                send_error(res, where + e.what(), 400);
+                return;
+            }
+        }
+
+        auto submitted = queue_manager_.submit_job(GenerationType::Pipeline, body, title, false, origin);
+        if (!submitted.refusal.empty()) {
+            send_error(res, submitted.refusal, 429);
+            return;
+        }
+        const std::string& job_id = submitted.job_id;
+        auto status = queue_manager_.get_status();
+        send_json(res, {
+            {"job_id", job_id},
+            {"status", "pending"},
+            {"position", status["pending_count"]}
+        }, 202);
+    } catch (const nlohmann::json::exception& e) {
+        send_error(res, std::string("Invalid JSON: ") + e.what(), 400);
+    } catch (const std::exception& e) {
+        send_error(res, e.what(), 400);
+    }
+}
+
 void RequestHandlers::handle_convert(const httplib::Request& req, httplib::Response& res) {
     try {
         auto body = parse_json_body(req);
@@ -2266,21 +2617,124 @@ void RequestHandlers::handle_get_queue(const httplib::Request& req, httplib::Res
         status["applied_filters"] = applied_filters;
     }
 
-    send_json(res, status);
+    send_json(res, status);
+}
+
+void RequestHandlers::handle_get_job(const httplib::Request& req, httplib::Response& res) {
+    std::string job_id = req.matches[1];
+
+    auto job = queue_manager_.get_job(job_id);
+    if (!job) {
+        send_error(res, "Job not found", 404);
+        return;
+    }
+
+    nlohmann::json body = job->to_json();
+    inject_output_urls(body, compute_base_url(req, trusted_proxies_));
+    send_json(res, body);
+}
+
+void RequestHandlers::send_job_when_finished(const httplib::Request& req, httplib::Response& res,
+                                             const std::string& job_id, int timeout_seconds,
+                                             int unfinished_status) {
+    bool finished = false;
+    auto job = queue_manager_.wait_job(job_id, std::chrono::seconds(timeout_seconds), &finished);
+    if (!job) {
+        send_error(res, "Job not found", 404);
+        return;
+    }
+    nlohmann::json body = job->to_json();
+    inject_output_urls(body, compute_base_url(req, trusted_proxies_));
+    body["finished"] = finished;
+    send_json(res, body, finished ? 200 : unfinished_status);
+}
+
+void RequestHandlers::handle_wait_job(const httplib::Request& req, httplib::Response& res) {
+    int timeout = 30;
+    if (req.has_param("timeout")) {
+        try {
+            timeout = std::stoi(req.get_param_value("timeout"));
+        } catch (...) {
+            timeout = -1;
+        }
+        if (timeout < 0) {
+            send_error(res, "timeout must be a number of seconds", 400);
+            return;
+        }
+    }
+    send_job_when_finished(req, res, req.matches[1], timeout, 200);
+}
+
+void RequestHandlers::handle_job_events(const httplib::Request& req, httplib::Response& res) {
+    const std::string job_id = req.matches[1];
+    // Watch before the first snapshot so nothing falls between the two
+    auto watch = queue_manager_.watch_job(job_id);
+    if (!watch) {
+        send_error(res, "Too many job watchers (queue.max_job_waiters); poll GET /queue/{id} instead", 503);
+        return;
+    }
+    if (!queue_manager_.get_job(job_id)) {
+        send_error(res, "Job not found", 404);
+        return;
+    }
+
+    res.set_header("Cache-Control", "no-cache");
+    res.set_header("Connection", "keep-alive");
+    res.set_header("X-Accel-Buffering", "no");
+    const std::string base_url = compute_base_url(req, trusted_proxies_);
+    res.set_chunked_content_provider(
+        "text/event-stream",
+        [this, watch, job_id, base_url](size_t /*offset*/, httplib::DataSink& sink) {
+            auto send = [&sink](const std::string& event, const nlohmann::json& data) {
+                const std::string sse = "event: " + event + "\ndata: " + data.dump() + "\n\n";
+                return sink.write(sse.data(), sse.size());
+            };
+            // "job" events carry the whole job, as GET /queue/{id} returns it
+            auto send_job = [&]() {
+                auto job = queue_manager_.get_job(job_id);
+                if (!job) return false;
+                nlohmann::json body = job->to_json();
+                inject_output_urls(body, base_url);
+                if (!send("job", body)) return false;
+                const auto s = job->status;
+                return s == QueueStatus::Pending || s == QueueStatus::Processing;
+            };
+
+            if (send_job()) {
+                static const std::string keep_alive = ": keep-alive\n\n";
+                while (!watch->closed()) {
+                    auto event = watch->next(std::chrono::seconds(15));
+                    if (!event) {
+                        // Also how a client that went away is noticed
+                        if (!sink.write(keep_alive.data(), keep_alive.size())) return false;
+                        continue;
+                    }
+                    if (!send(event->name, event->data)) return false;
+                    if (watch->finished()) {
+                        send_job();
+                        break;
+                    }
+                }
+            }
+            sink.done();
+            return true;
+        });
 }
 
-void RequestHandlers::handle_get_job(const httplib::Request& req, httplib::Response& res) {
+void RequestHandlers::handle_get_job_trace(const httplib::Request& req, httplib::Response& res) {
     std::string job_id = req.matches[1];
 
-    auto job = queue_manager_.get_job(job_id);
-    if (!job) {
+    if (!queue_manager_.get_job(job_id)) {
         send_error(res, "Job not found", 404);
         return;
     }
-
-    nlohmann::json body = job->to_json();
-    inject_output_urls(body, compute_base_url(req, trusted_proxies_));
-    send_json(res, body);
+    auto trace = queue_manager_.get_job_trace(job_id);
+    if (trace.is_null()) {
+        send_error(res, "No trace for this job (queue.trace_jobs is off, or the job never ran)", 404);
+        return;
+    }
+    res.set_header("Content-Disposition", "inline; filename=\"" + job_id + ".trace.json\"");
+    send_json(res, trace);
 }
 
 void RequestHandlers::handle_get_job_preview(const httplib::Request& req, httplib::Response& res) {
@@ -2473,6 +2927,103 @@ nlohmann::json RequestHandlers::parse_json_body(const httplib::Request& req) {
     return nlohmann::json::parse(req.body);
 }
 
+nlohmann::json RequestHandlers::parse_image_request_body(const httplib::Request& req,
+                                                         const std::string& raw_field) {
+    const std::string content_type = req.get_header_value("Content-Type");
+    const bool raw = content_type.rfind("application/octet-stream", 0) == 0 ||
+                     content_type.rfind("image/", 0) == 0;
+
+    nlohmann::json body;
+    if (req.is_multipart_form_data()) {
+        body = req.form.has_field("json") ? nlohmann::json::parse(req.form.get_field("json"))
+                                          : nlohmann::json::object();
+        if (!body.is_object()) {
+            throw std::runtime_error("The json form field must be an object");
+        }
+        // Plain fields arrive as strings; the typed params coerce them
+        for (const auto& [name, field] : req.form.fields) {
+            if (name == "json") continue;
+            if (is_image_array_field(name)) {
+                body[name].push_back(field.content);
+            } else {
+                body[name] = field.content;
+            }
+        }
+        for (const auto& [name, file] : req.form.files) {
+            const std::string field = image_field_for_part(name);
+            if (field.empty()) {
+                throw std::runtime_error("Unknown image part '" + name + "'");
+            }
+            const std::string ref = spool_image_upload(file.content);
+            if (is_image_array_field(field)) {
+                body[field].push_back(ref);
+            } else {
+                body[field] = ref;
+            }
+        }
+    } else if (raw) {
+        if (raw_field.empty()) {
+            throw std::runtime_error("This endpoint takes no raw image body; send JSON or multipart/form-data");
+        }
+        body = req.has_param("json") ? nlohmann::json::parse(req.get_param_value("json"))
+                                     : nlohmann::json::object();
+        if (!body.is_object()) {
+            throw std::runtime_error("The json query parameter must be an object");
+        }
+        for (const auto& [name, value] : req.params) {
+            if (name != "json") body[name] = value;
+        }
+        body[raw_field] = spool_image_upload(req.body);
+    } else {
+        body = parse_json_body(req);
+    }
+    resolve_job_image_refs(body);
+    return body;
+}
+
+void RequestHandlers::resolve_job_image_refs(nlohmann::json& body) {
+    if (!body.is_object()) return;
+
+    auto resolve = [this](nlohmann::json& value) {
+        if (!value.is_string()) return;
+        const std::string ref = value.get<std::string>();
+        if (ref.compare(0, IMAGE_REF_JOB.size(), IMAGE_REF_JOB) != 0) return;
+
+        std::string job_id = ref.substr(IMAGE_REF_JOB.size());
+        size_t index = 0;
+        if (auto hash = job_id.find('#'); hash != std::string::npos) {
+            try {
+                index = std::stoul(job_id.substr(hash + 1));
+            } catch (const std::exception&) {
+                throw std::runtime_error("Invalid output index in image reference: " + ref);
+            }
+            job_id.resize(hash);
+        }
+        auto job = queue_manager_.get_job(job_id);
+        if (!job) {
+            throw std::runtime_error("Source job not found: " + job_id);
+        }
+        if (index >= job->outputs.size()) {
+            throw std::runtime_error("Image reference " + ref + " is out of range: job has " +
+                                     std::to_string(job->outputs.size()) + " output(s)");
+        }
+        // Outputs are relative to the output dir; older jobs may carry "/output/"
+        std::string output = job->outputs[index];
+        if (output.rfind("/output/", 0) == 0) output = output.substr(8);
+        value = image_ref_for_path(output);
+        (void) image_ref_path(value.get<std::string>());   // Still on disk
+    };
+
+    for (const char* field : IMAGE_SCALAR_FIELDS) {
+        if (body.contains(field)) resolve(body[field]);
+    }
+    for (const char* field : IMAGE_ARRAY_FIELDS) {
+        if (body.contains(field) && body[field].is_array()) {
+            for (auto& item : body[field]) resolve(item);
+        }
+    }
+}
+
 std::string RequestHandlers::get_mime_type(const std::string& filepath) {
     std::string ext = fs::path(filepath).extension().string();
     std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
@@ -2598,70 +3149,6 @@ bool RequestHandlers::is_video_file(const std::string& path) {
     return ext == ".mp4" || ext == ".webm" || ext == ".avi" || ext == ".mov" || ext == ".mkv";
 }
 
-std::string RequestHandlers::get_thumbnail_path(const std::string& source_path) {
-    // Create .thumbs directory in the same folder as the source
-    fs::path source(source_path);
-    fs::path thumb_dir = source.parent_path() / ".thumbs";
-    fs::path thumb_file = thumb_dir / (source.stem().string() + ".jpg");
-    return thumb_file.string();
-}
-
-bool RequestHandlers::generate_thumbnail(const std::string& source_path, const std::string& thumb_path, int target_size) {
-    // Load source image
-    int width, height, channels;
-    unsigned char* data = stbi_load(source_path.c_str(), &width, &height, &channels, 3);
-    if (!data) {
-        return false;
-    }
-
-    // Calculate crop and resize dimensions (square center crop, then resize)
-    int crop_size = std::min(width, height);
-    int crop_x = (width - crop_size) / 2;
-    int crop_y = (height - crop_size) / 2;
-
-    // Allocate thumbnail buffer
-    std::vector<unsigned char> thumb_data(target_size * target_size * 3);
-
-    // Simple bilinear resize with center crop
-    float scale = static_cast<float>(crop_size) / target_size;
-    for (int ty = 0; ty < target_size; ty++) {
-        for (int tx = 0; tx < target_size; tx++) {
-            float sx = crop_x + tx * scale;
-            float sy = crop_y + ty * scale;
-
-            int x0 = static_cast<int>(sx);
-            int y0 = static_cast<int>(sy);
-            int x1 = std::min(x0 + 1, width - 1);
-            int y1 = std::min(y0 + 1, height - 1);
-
-            float fx = sx - x0;
-            float fy = sy - y0;
-
-            for (int c = 0; c < 3; c++) {
-                float v00 = data[(y0 * width + x0) * 3 + c];
-                float v10 = data[(y0 * width + x1) * 3 + c];
-                float v01 = data[(y1 * width + x0) * 3 + c];
-                float v11 = data[(y1 * width + x1) * 3 + c];
-
-                float v = v00 * (1 - fx) * (1 - fy) +
-                          v10 * fx * (1 - fy) +
-                          v01 * (1 - fx) * fy +
-                          v11 * fx * fy;
-
-                thumb_data[(ty * target_size + tx) * 3 + c] = static_cast<unsigned char>(v);
-            }
-        }
-    }
-
-    stbi_image_free(data);
-
-    // Ensure thumbnail directory exists
-    fs::create_directories(fs::path(thumb_path).parent_path());
-
-    // Save as JPEG (quality 85)
-    return stbi_write_jpg(thumb_path.c_str(), target_size, target_size, 3, thumb_data.data(), 85) != 0;
-}
-
 void RequestHandlers::handle_thumbnail(const httplib::Request& req, httplib::Response& res) {
     // Extract path after /thumb/
     std::string rel_path;
@@ -2694,21 +3181,32 @@ void RequestHandlers::handle_thumbnail(const httplib::Request& req, httplib::Res
     // Build full path
     fs::path source_path = fs::path(output_dir_) / rel_path;
 
-    if (!fs::exists(source_path) || !fs::is_regular_file(source_path)) {
-        send_error(res, "Not found", 404);
-        return;
-    }
-
     // Check if it's an image or video
     bool is_img = is_image_file(source_path.string());
     bool is_vid = is_video_file(source_path.string());
 
     if (!is_img && !is_vid) {
-        send_error(res, "Not a media file", 400);
+        if (!fs::exists(source_path) || !fs::is_regular_file(source_path)) {
+            send_error(res, "Not found", 404);
+        } else {
+            send_error(res, "Not a media file", 400);
+        }
         return;
     }
 
-    // For videos, return a placeholder SVG
+    // Videos: the poster frame written next to them at generation time,
+    // else a placeholder SVG
+    if (is_vid) {
+        if (!fs::exists(source_path) || !fs::is_regular_file(source_path)) {
+            send_error(res, "Not found", 404);
+            return;
+        }
+        fs::path poster = source_path.parent_path() / ThumbnailCache::VIDEO_POSTER_NAME;
+        if (thumbnails_ && fs::exists(poster)) {
+            source_path = poster;
+            is_vid = false;
+        }
+    }
     if (is_vid) {
         std::string svg = R"(<svg xmlns="http://www.w3.org/2000/svg" width="120" height="120" viewBox="0 0 120 120">
             <rect width="120" height="120" fill="#1a1a2e"/>
@@ -2719,34 +3217,59 @@ void RequestHandlers::handle_thumbnail(const httplib::Request& req, httplib::Res
         return;
     }
 
-    // For images, generate/serve thumbnail
-    std::string thumb_path = get_thumbnail_path(source_path.string());
-
-    // Check if thumbnail exists and is newer than source
-    bool need_generate = true;
-    if (fs::exists(thumb_path)) {
-        auto source_time = fs::last_write_time(source_path);
-        auto thumb_time = fs::last_write_time(thumb_path);
-        need_generate = (source_time > thumb_time);
+    if (!thumbnails_) {
+        send_error(res, "Thumbnails not available", 503);
+        return;
     }
 
-    if (need_generate) {
-        if (!generate_thumbnail(source_path.string(), thumb_path, 120)) {
-            // Failed to generate, return placeholder
-            std::string svg = R"(<svg xmlns="http://www.w3.org/2000/svg" width="120" height="120" viewBox="0 0 120 120">
-                <rect width="120" height="120" fill="#1a1a2e"/>
-                <text x="60" y="65" text-anchor="middle" fill="#ff6b9d" font-size="40">🖼️</text>
-            </svg>)";
-            res.set_content(svg, "image/svg+xml");
+    int requested_size = 0;
+    if (req.has_param("size")) {
+        try {
+            requested_size = std::stoi(req.get_param_value("size"));
+        } catch (...) {
+            send_error(res, "Invalid size", 400);
             return;
         }
     }
 
-    // Serve the thumbnail via the cached streaming helper (same
-    // ETag / Last-Modified / 304 / chunked-streaming pipeline as
-    // /output, so the gallery doesn't refetch thumbnails on each
-    // repaint).
-    serve_file_cached(req, res, fs::path(thumb_path), "image/jpeg");
+    // Memory and manifest hits touch neither the source nor the thumbnail's
+    // metadata; only the first view of a file this process hasn't seen stats it
+    auto result = thumbnails_->get(source_path.string(), thumbnails_->resolve_size(requested_size));
+    if (result.status == ThumbnailCache::Status::NotFound) {
+        send_error(res, "Not found", 404);
+        return;
+    }
+    if (!result.thumbnail) {
+        // Failed to generate, return placeholder
+        std::string svg = R"(<svg xmlns="http://www.w3.org/2000/svg" width="120" height="120" viewBox="0 0 120 120">
+            <rect width="120" height="120" fill="#1a1a2e"/>
+            <text x="60" y="65" text-anchor="middle" fill="#ff6b9d" font-size="40">🖼️</text>
+        </svg>)";
+        res.set_content(svg, "image/svg+xml");
+        return;
+    }
+
+    // Same caching contract as serve_file_cached(): ETag + Last-Modified,
+    // 304 on a match, long-lived immutable Cache-Control
+    const auto& thumb = result.thumbnail;
+    res.set_header("ETag", thumb->etag);
+    res.set_header("Last-Modified", thumb->last_modified);
+    res.set_header("Cache-Control", "public, max-age=31536000, immutable");
+
+    std::string inm = req.get_header_value("If-None-Match");
+    std::string ims = req.get_header_value("If-Modified-Since");
+    if ((!inm.empty() && inm == thumb->etag) || (!ims.empty() && ims == thumb->last_modified)) {
+        res.status = 304;
+        return;
+    }
+
+    // Stream straight from the cached buffer; the shared_ptr keeps it alive
+    // even if the LRU evicts it mid-transfer
+    res.set_content_provider(
+        thumb->data.size(), thumb->mime,
+        [thumb](size_t offset, size_t length, httplib::DataSink& sink) -> bool {
+            return sink.write(reinterpret_cast<const char*>(thumb->data.data()) + offset, length);
+        });
 }
 
 std::string RequestHandlers::generate_directory_html(const std::string& dir_path, const std::string& url_path,
@@ -3406,10 +3929,13 @@ void RequestHandlers::handle_file_browser(const httplib::Request& req, httplib::
         std::string html = generate_directory_html(full_path.string(), url_path, sort_by, sort_asc, page, per_page);
         res.set_content(html, "text/html");
     } else {
-        // File: stream via the cached helper. Adds Cache-Control / ETag /
-        // Last-Modified, handles If-None-Match → 304, and streams the
-        // body in 64 KB chunks (which also gives us Range: support).
-        serve_file_cached(req, res, full_path, get_mime_type(full_path.string()));
+        // File: memory-mapped, conditional and Range requests handled.
+        // Outputs are write-once (the path embeds the job_id), so they
+        // can be cached forever.
+        if (!files_->serve(req, res, full_path.string(), get_mime_type(full_path.string()),
+                           FileServer::IMMUTABLE)) {
+            send_error(res, "Cannot read file", 500);
+        }
     }
 }
 
@@ -3468,18 +3994,14 @@ void RequestHandlers::handle_webui(const httplib::Request& req, httplib::Respons
         return;
     }
 
-    std::ifstream file(full_path, std::ios::binary);
-    if (!file) {
+    // Vite content-hashes everything under assets/, so those never change
+    // under the same URL; index.html and the rest must be revalidated
+    // (a 304 when unchanged) so a redeploy is picked up on reload
+    const bool hashed = rel_path.rfind("assets/", 0) == 0 && full_path.filename() != "index.html";
+    if (!files_->serve_asset(req, res, full_path.string(), get_mime_type(full_path.string()),
+                             hashed ? FileServer::IMMUTABLE : FileServer::REVALIDATE)) {
         send_error(res, "Cannot read file", 500);
-        return;
     }
-
-    std::ostringstream oss;
-    oss << file.rdbuf();
-    std::string content = oss.str();
-
-    std::string mime_type = get_mime_type(full_path.string());
-    res.set_content(content, mime_type);
 }
 
 // Top-level directories under docs/ that are kept on disk but hidden from the
@@ -3656,7 +4178,9 @@ void RequestHandlers::handle_get_preview_settings(const httplib::Request& /*req*
         {"mode", mode_str},
         {"interval", settings.interval},
         {"max_size", settings.max_size},
-        {"quality", settings.quality}
+        {"quality", settings.quality},
+        {"on_demand", settings.on_demand},
+        {"max_overhead_percent", settings.max_overhead_percent}
     });
 }
 
@@ -3669,7 +4193,7 @@ void RequestHandlers::handle_update_preview_settings(const httplib::Request& req
 
     // Strict body validation
     static const std::unordered_set<std::string> KNOWN_PREVIEW = {
-        "enabled", "mode", "interval", "max_size", "quality",
+        "enabled", "mode", "interval", "max_size", "quality", "on_demand", "max_overhead_percent",
     };
     std::vector<std::string> unknown;
     if (json.is_object()) {
@@ -3685,7 +4209,7 @@ void RequestHandlers::handle_update_preview_settings(const httplib::Request& req
             if (i) msg += ", ";
             msg += unknown[i];
         }
-        msg += ". Accepted: enabled, mode, interval, max_size, quality.";
+        msg += ". Accepted: enabled, mode, interval, max_size, quality, on_demand, max_overhead_percent.";
         send_error(res, msg, 400);
         return;
     }
@@ -3696,6 +4220,10 @@ void RequestHandlers::handle_update_preview_settings(const httplib::Request& req
     int interval = json.value("interval", 1);
     int max_size = json.value("max_size", 256);
     int quality = json.value("quality", 75);
+    // Older clients don't send the pacing fields; keep what is set
+    const auto current = queue_manager_.get_preview_settings();
+    bool on_demand = json.value("on_demand", current.on_demand);
+    int max_overhead_percent = json.value("max_overhead_percent", current.max_overhead_percent);
 
     // Convert string mode to enum
     PreviewMode mode = PreviewMode::Tae;
@@ -3716,9 +4244,11 @@ void RequestHandlers::handle_update_preview_settings(const httplib::Request& req
     if (max_size > 1024) max_size = 1024;
     if (quality < 1) quality = 1;
     if (quality > 100) quality = 100;
+    if (max_overhead_percent < 0) max_overhead_percent = 0;
+    if (max_overhead_percent > 100) max_overhead_percent = 100;
 
     // Update settings
-    queue_manager_.set_preview_settings(mode, interval, max_size, quality);
+    queue_manager_.set_preview_settings(mode, interval, max_size, quality, on_demand, max_overhead_percent);
 
     // Return updated settings
     send_json(res, {
@@ -3728,7 +4258,9 @@ void RequestHandlers::handle_update_preview_settings(const httplib::Request& req
             {"mode", mode_str},
             {"interval", interval},
             {"max_size", max_size},
-            {"quality", quality}
+            {"quality", quality},
+            {"on_demand", on_demand},
+            {"max_overhead_percent", max_overhead_percent}
         }}
     });
 }
@@ -3753,7 +4285,7 @@ void RequestHandlers::handle_assistant_chat(const httplib::Request& req, httplib
     nlohmann::json context = json.value("context", nlohmann::json::object());
 
     // Send to assistant
-    auto response = assistant_client_->chat(message, context);
+    auto response = assistant().chat(message, context);
 
     if (response.success) {
         nlohmann::json result = {
@@ -3828,7 +4360,7 @@ void RequestHandlers::handle_assistant_chat_stream(const httplib::Request& req,
         "text/event-stream",
         [this, message, context](size_t /*offset*/, httplib::DataSink& sink) {
             std::cout << "[SSE] Starting chunked content provider" << std::endl;
-            bool success = assistant_client_->chat_stream(
+            bool success = assistant().chat_stream(
                 message,
                 context,
                 [&sink](const std::string& event, const nlohmann::json& data) {
@@ -3852,7 +4384,7 @@ void RequestHandlers::handle_assistant_chat_stream(const httplib::Request& req,
 }
 
 void RequestHandlers::handle_assistant_history(const httplib::Request& /*req*/, httplib::Response& res) {
-    auto history = assistant_client_->get_history();
+    auto history = assistant().get_history();
 
     nlohmann::json messages = nlohmann::json::array();
     for (const auto& msg : history) {
@@ -3866,16 +4398,16 @@ void RequestHandlers::handle_assistant_history(const httplib::Request& /*req*/,
 }
 
 void RequestHandlers::handle_assistant_clear_history(const httplib::Request& /*req*/, httplib::Response& res) {
-    assistant_client_->clear_history();
+    assistant().clear_history();
     send_json(res, {{"success", true}});
 }
 
 void RequestHandlers::handle_assistant_status(const httplib::Request& /*req*/, httplib::Response& res) {
-    send_json(res, assistant_client_->get_status());
+    send_json(res, assistant().get_status());
 }
 
 void RequestHandlers::handle_assistant_get_settings(const httplib::Request& /*req*/, httplib::Response& res) {
-    send_json(res, assistant_client_->get_settings());
+    send_json(res, assistant().get_settings());
 }
 
 void RequestHandlers::handle_assistant_update_settings(const httplib::Request& req, httplib::Response& res) {
@@ -3885,10 +4417,10 @@ void RequestHandlers::handle_assistant_update_settings(const httplib::Request& r
         return;
     }
 
-    if (assistant_client_->update_settings(json)) {
+    if (assistant().update_settings(json)) {
         send_json(res, {
             {"success", true},
-            {"settings", assistant_client_->get_settings()}
+            {"settings", assistant().get_settings()}
         });
     } else {
         send_error(res, "Failed to update settings", 500);
@@ -3902,7 +4434,7 @@ void RequestHandlers::handle_assistant_model_info(const httplib::Request& req, h
         model_name = req.get_param_value("model");
     }
 
-    auto caps = assistant_client_->get_model_info(model_name);
+    auto caps = assistant().get_model_info(model_name);
     send_json(res, caps.to_json());
 }
 #endif // SDCPP_ASSISTANT_ENABLED
@@ -3958,7 +4490,20 @@ void RequestHandlers::handle_detect_architecture(const httplib::Request& req, ht
 // JSON file. Used by /options/descriptions (load options) and
 // /options/generation. Returns {"options": {}} when not found, so the
 // frontend can degrade gracefully (no tooltips, but no error either).
-void RequestHandlers::serve_options_json(httplib::Response& res, const std::string& filename) {
+// A file that was found is kept serialized and compressed for good.
+void RequestHandlers::serve_options_json(const httplib::Request& req, httplib::Response& res,
+                                         const std::string& filename) {
+    std::shared_ptr<const CachedDocument> doc;
+    {
+        std::lock_guard<std::mutex> lock(options_docs_mutex_);
+        auto it = options_docs_.find(filename);
+        if (it != options_docs_.end()) doc = it->second;
+    }
+    if (doc) {
+        doc->serve(req, res);
+        return;
+    }
+
     std::vector<std::string> search_paths = {
         "data/" + filename,
         "../data/" + filename,
@@ -3978,7 +4523,12 @@ void RequestHandlers::serve_options_json(httplib::Response& res, const std::stri
             std::ifstream f(path);
             if (!f.is_open()) continue;
             nlohmann::json j = nlohmann::json::parse(f);
-            send_json(res, j);
+            doc = std::make_shared<const CachedDocument>(j.dump(), "application/json");
+            {
+                std::lock_guard<std::mutex> lock(options_docs_mutex_);
+                options_docs_.emplace(filename, doc);
+            }
+            doc->serve(req, res);
             return;
         } catch (const std::exception&) {
             // Try next candidate
@@ -3987,12 +4537,12 @@ void RequestHandlers::serve_options_json(httplib::Response& res, const std::stri
     send_json(res, {{"options", nlohmann::json::object()}});
 }
 
-void RequestHandlers::handle_get_option_descriptions(const httplib::Request& /*req*/, httplib::Response& res) {
-    serve_options_json(res, "load_options.json");
+void RequestHandlers::handle_get_option_descriptions(const httplib::Request& req, httplib::Response& res) {
+    serve_options_json(req, res, "load_options.json");
 }
 
-void RequestHandlers::handle_get_generation_option_descriptions(const httplib::Request& /*req*/, httplib::Response& res) {
-    serve_options_json(res, "generation_options.json");
+void RequestHandlers::handle_get_generation_option_descriptions(const httplib::Request& req, httplib::Response& res) {
+    serve_options_json(req, res, "generation_options.json");
 }
 
 // ==================== Download Handlers ====================
@@ -4062,6 +4612,23 @@ void RequestHandlers::handle_download_model(const httplib::Request& req, httplib
             {"subfolder", subfolder}
         };
 
+        // Optional per-job transfer overrides (server defaults: "download" config)
+        if (body.contains("connections")) {
+            if (!body["connections"].is_number_integer() ||
+                body["connections"].get<int>() < 1 || body["connections"].get<int>() > 16) {
+                send_error(res, "connections must be an integer between 1 and 16", 400);
+                return;
+            }
+            download_params["connections"] = body["connections"].get<int>();
+        }
+        if (body.contains("max_speed_kbps")) {
+            if (!body["max_speed_kbps"].is_number_integer() || body["max_speed_kbps"].get<int>() < 0) {
+                send_error(res, "max_speed_kbps must be a non-negative integer", 400);
+                return;
+            }
+            download_params["max_speed_kbps"] = body["max_speed_kbps"].get<int>();
+        }
+
         if (source == "url") {
             if (url.empty()) {
                 send_error(res, "url is required for URL source", 400);
@@ -4246,28 +4813,43 @@ void RequestHandlers::handle_get_model_paths(const httplib::Request& /*req*/, ht
 //   subfolder  (optional) — relative path under the model_type directory;
 //                           rejected if it contains ".." or starts with "/"
 //
-// v1 LIMITATION: cpp-httplib's multipart parser buffers the full file in
-// memory (req.form.files[<key>].content). The server's max payload length
-// in main.cpp gates how large an upload can be; once that's exceeded the
-// request is rejected with 413 by httplib before reaching this handler.
-// TODO: switch to streaming multipart parsing once cpp-httplib offers it
-// or once we replace the parser, and write directly to disk like
-// DownloadManager does for downloads.
+// The body is read through httplib's ContentReader, so the file part
+// streams into an UploadWriter (temp file, hashed as it arrives) and
+// memory use stays flat regardless of size. When the text fields come
+// before the file part (the WebUI sends them first) the temp file lives
+// in the destination directory and a bad field fails the request before
+// the file is read; otherwise the file is spooled in the checkpoints
+// directory and moved once the fields are known.
 // ──────────────────────────────────────────────────────────────────────
-void RequestHandlers::handle_upload_model(const httplib::Request& req, httplib::Response& res) {
-    if (!req.is_multipart_form_data()) {
-        send_error(res, "Content-Type must be multipart/form-data", 400);
-        return;
-    }
+namespace {
 
-    // model_type is sent as a regular text field.
+// Text parts are tiny; anything bigger is not one of our fields
+constexpr size_t MAX_UPLOAD_FIELD_BYTES = 4096;
+
+struct UploadTarget {
     std::string model_type;
-    if (req.form.has_field("model_type")) {
-        model_type = req.form.get_field("model_type");
-    }
-    if (model_type.empty()) {
-        send_error(res, "model_type form field is required", 400);
-        return;
+    std::string filename;
+    std::string subfolder;
+    fs::path dest_dir;
+    fs::path dest_path;
+};
+
+std::string upload_field(const std::map<std::string, std::string>& fields, const std::string& name) {
+    auto it = fields.find(name);
+    return it == fields.end() ? std::string() : it->second;
+}
+
+// Validate the /models/upload fields and resolve where the file goes.
+// On failure sets error/status and returns false.
+bool resolve_upload_target(const nlohmann::json& paths_config,
+                           const std::map<std::string, std::string>& fields,
+                           const std::string& part_filename,
+                           UploadTarget& out, std::string& error, int& status) {
+    status = 400;
+    out.model_type = upload_field(fields, "model_type");
+    if (out.model_type.empty()) {
+        error = "model_type form field is required";
+        return false;
     }
 
     // Validate against the supported set used by DownloadManager and the
@@ -4277,71 +4859,52 @@ void RequestHandlers::handle_upload_model(const httplib::Request& req, httplib::
         "checkpoint", "diffusion", "vae", "lora", "clip", "t5",
         "embedding", "controlnet", "llm", "esrgan", "taesd"
     };
-    if (std::find(kValidTypes.begin(), kValidTypes.end(), model_type) == kValidTypes.end()) {
-        send_error(res, "Invalid model_type. Valid: checkpoint, diffusion, vae, lora, clip, t5, embedding, controlnet, llm, esrgan, taesd", 400);
-        return;
-    }
-
-    // The file part is mandatory.
-    if (!req.form.has_file("file")) {
-        send_error(res, "file form field is required", 400);
-        return;
+    if (std::find(kValidTypes.begin(), kValidTypes.end(), out.model_type) == kValidTypes.end()) {
+        error = "Invalid model_type. Valid: checkpoint, diffusion, vae, lora, clip, t5, embedding, controlnet, llm, esrgan, taesd";
+        return false;
     }
-    const auto file_part = req.form.get_file("file");
 
     // Determine the destination filename. Explicit "filename" form field
     // wins; otherwise fall back to the Content-Disposition filename from
     // the file part itself.
-    std::string filename_override;
-    if (req.form.has_field("filename")) {
-        filename_override = req.form.get_field("filename");
-    }
-    std::string filename = filename_override.empty() ? file_part.filename : filename_override;
+    std::string filename_override = upload_field(fields, "filename");
+    std::string filename = filename_override.empty() ? part_filename : filename_override;
     if (filename.empty()) {
-        send_error(res, "filename could not be determined (provide one or set Content-Disposition filename)", 400);
-        return;
+        error = "filename could not be determined (provide one or set Content-Disposition filename)";
+        return false;
     }
 
     // Defense-in-depth: strip any path components a malicious client may
     // have stuffed into the filename. Only the basename is honoured;
     // subdirectory placement must come from the explicit `subfolder`
     // form field (which we validate separately below).
-    {
-        fs::path fname_path(filename);
-        filename = fname_path.filename().string();
-        if (filename.empty() || filename == "." || filename == "..") {
-            send_error(res, "filename is invalid", 400);
-            return;
-        }
+    filename = fs::path(filename).filename().string();
+    if (filename.empty() || filename == "." || filename == "..") {
+        error = "filename is invalid";
+        return false;
     }
 
     // Extension whitelist mirrors DownloadManager::is_supported_extension.
-    fs::path filename_path(filename);
-    if (!DownloadManager::is_supported_extension(filename_path.extension().string())) {
-        send_error(res,
-                   "Unsupported file extension. Supported: .safetensors, .ckpt, .pt, .pth, .bin, .gguf",
-                   400);
-        return;
+    if (!DownloadManager::is_supported_extension(fs::path(filename).extension().string())) {
+        error = "Unsupported file extension. Supported: .safetensors, .ckpt, .pt, .pth, .bin, .gguf";
+        return false;
     }
+    out.filename = filename;
 
     // Subfolder validation — block traversal and absolute paths.
-    std::string subfolder;
-    if (req.form.has_field("subfolder")) {
-        subfolder = req.form.get_field("subfolder");
-    }
-    if (!subfolder.empty()) {
-        if (subfolder.front() == '/' || subfolder.front() == '\\') {
-            send_error(res, "subfolder must be relative (must not start with '/')", 400);
-            return;
+    out.subfolder = upload_field(fields, "subfolder");
+    if (!out.subfolder.empty()) {
+        if (out.subfolder.front() == '/' || out.subfolder.front() == '\\') {
+            error = "subfolder must be relative (must not start with '/')";
+            return false;
         }
-        if (subfolder.find("..") != std::string::npos) {
-            send_error(res, "subfolder must not contain '..'", 400);
-            return;
+        if (out.subfolder.find("..") != std::string::npos) {
+            error = "subfolder must not contain '..'";
+            return false;
         }
     }
 
     // Resolve destination directory from the model paths config.
-    auto paths_config = model_manager_.get_paths_config();
     static const std::map<std::string, std::string> kTypeKey = {
         {"checkpoint", "checkpoints"},
         {"diffusion",  "diffusion_models"},
@@ -4355,77 +4918,180 @@ void RequestHandlers::handle_upload_model(const httplib::Request& req, httplib::
         {"esrgan",     "esrgan"},
         {"taesd",      "taesd"},
     };
-    auto key_it = kTypeKey.find(model_type);
+    auto key_it = kTypeKey.find(out.model_type);
     if (key_it == kTypeKey.end() ||
         !paths_config.contains(key_it->second) ||
         !paths_config[key_it->second].is_string()) {
-        send_error(res, "Server has no directory configured for model_type=" + model_type, 500);
-        return;
+        error = "Server has no directory configured for model_type=" + out.model_type;
+        status = 500;
+        return false;
     }
     fs::path base_dir(paths_config[key_it->second].get<std::string>());
-    fs::path dest_dir = subfolder.empty() ? base_dir : (base_dir / subfolder);
-    fs::path dest_path = dest_dir / filename;
+    out.dest_dir = out.subfolder.empty() ? base_dir : (base_dir / out.subfolder);
+    out.dest_path = out.dest_dir / out.filename;
 
     // Sanity check the resolved destination really lives under base_dir.
     // weakly_canonical handles components that don't exist yet (the
     // destination file itself), unlike canonical().
     try {
         fs::path canonical_base = fs::weakly_canonical(base_dir);
-        fs::path canonical_dest = fs::weakly_canonical(dest_path);
+        fs::path canonical_dest = fs::weakly_canonical(out.dest_path);
         auto base_str = canonical_base.string();
         auto dest_str = canonical_dest.string();
         if (dest_str.size() < base_str.size() ||
             dest_str.compare(0, base_str.size(), base_str) != 0) {
-            send_error(res, "Resolved destination path escapes the model directory", 400);
-            return;
+            error = "Resolved destination path escapes the model directory";
+            return false;
         }
     } catch (const std::exception& e) {
-        send_error(res, std::string("Failed to resolve destination path: ") + e.what(), 500);
-        return;
+        error = std::string("Failed to resolve destination path: ") + e.what();
+        status = 500;
+        return false;
     }
 
     // Refuse to clobber an existing file (use the convert/rename flow
     // for replacements; uploads are append-only).
     std::error_code ec;
-    if (fs::exists(dest_path, ec) && fs::file_size(dest_path, ec) > 0) {
-        send_error(res, "A file with that name already exists at " + dest_path.string(), 409);
-        return;
+    if (fs::exists(out.dest_path, ec) && fs::file_size(out.dest_path, ec) > 0) {
+        error = "A file with that name already exists at " + out.dest_path.string();
+        status = 409;
+        return false;
     }
 
     // Ensure the parent directory exists.
-    fs::create_directories(dest_dir, ec);
+    fs::create_directories(out.dest_dir, ec);
     if (ec) {
-        send_error(res, "Failed to create destination directory: " + ec.message(), 500);
+        error = "Failed to create destination directory: " + ec.message();
+        status = 500;
+        return false;
+    }
+    return true;
+}
+
+uint64_t request_content_length(const httplib::Request& req) {
+    const std::string value = req.get_header_value("Content-Length");
+    if (value.empty()) return 0;
+    try {
+        return std::stoull(value);
+    } catch (const std::exception&) {
+        return 0;
+    }
+}
+
+}  // namespace
+
+void RequestHandlers::handle_upload_model(const httplib::Request& req, httplib::Response& res,
+                                          const httplib::ContentReader& content_reader) {
+    if (!req.is_multipart_form_data()) {
+        send_error(res, "Content-Type must be multipart/form-data", 400);
         return;
     }
 
-    // Write the in-memory buffer to disk. v1 path: the parser already
-    // buffered everything; we just persist it in one pass.
-    {
-        std::ofstream ofs(dest_path, std::ios::binary | std::ios::trunc);
-        if (!ofs) {
-            send_error(res, "Failed to open destination file for writing", 500);
-            return;
-        }
-        ofs.write(file_part.content.data(),
-                  static_cast<std::streamsize>(file_part.content.size()));
-        if (!ofs) {
-            // Best-effort cleanup so we don't leave a half-written model behind.
-            std::error_code rm_ec;
-            fs::remove(dest_path, rm_ec);
-            send_error(res, "Failed to write upload to disk", 500);
-            return;
-        }
+    const auto paths_config = model_manager_.get_paths_config();
+    const uint64_t content_length = request_content_length(req);
+
+    std::map<std::string, std::string> fields;
+    std::string current_field;
+    std::string part_filename;
+    bool in_file = false;
+    bool have_file = false;
+    UploadWriter writer;
+    std::string error;
+    int error_status = 400;
+
+    bool received = content_reader(
+        [&](const auto& part) {
+            in_file = false;
+            current_field.clear();
+            if (part.name != "file") {
+                current_field = part.name;
+                fields[current_field].clear();
+                return true;
+            }
+            if (have_file) {
+                error = "Only one file part is accepted";
+                return false;
+            }
+            have_file = true;
+            in_file = true;
+            part_filename = part.filename;
+
+            std::string spool_dir;
+            if (fields.count("model_type")) {
+                UploadTarget target;
+                if (!resolve_upload_target(paths_config, fields, part_filename, target, error, error_status)) {
+                    return false;
+                }
+                spool_dir = target.dest_dir.string();
+            } else if (paths_config.contains("checkpoints") && paths_config["checkpoints"].is_string()) {
+                spool_dir = paths_config["checkpoints"].get<std::string>();
+            }
+            std::error_code ec;
+            if (spool_dir.empty() || !fs::is_directory(spool_dir, ec)) {
+                spool_dir = fs::temp_directory_path(ec).string();
+            }
+            if (!writer.open(spool_dir, "model", content_length)) {
+                error = writer.error();
+                error_status = writer.out_of_space() ? 507 : 500;
+                return false;
+            }
+            return true;
+        },
+        [&](const char* data, size_t len) {
+            if (in_file) {
+                if (!writer.write(data, len)) {
+                    error = writer.error();
+                    error_status = writer.out_of_space() ? 507 : 500;
+                    return false;
+                }
+                return true;
+            }
+            if (current_field.empty()) return true;
+            auto& value = fields[current_field];
+            if (value.size() + len > MAX_UPLOAD_FIELD_BYTES) {
+                error = "Form field '" + current_field + "' is too large";
+                return false;
+            }
+            value.append(data, len);
+            return true;
+        });
+
+    if (!received) {
+        send_error(res, error.empty() ? "Failed to read upload body" : error, error_status);
+        return;
+    }
+    if (!have_file) {
+        send_error(res, "file form field is required", 400);
+        return;
+    }
+
+    UploadTarget target;
+    if (!resolve_upload_target(paths_config, fields, part_filename, target, error, error_status)) {
+        send_error(res, error, error_status);
+        return;
+    }
+
+    // An empty leftover with the same name may be replaced (matches the
+    // size check in resolve_upload_target)
+    std::error_code ec;
+    if (fs::exists(target.dest_path, ec) && fs::file_size(target.dest_path, ec) == 0) {
+        fs::remove(target.dest_path, ec);
+    }
+    if (!writer.commit(target.dest_path.string(), /*replace=*/false)) {
+        send_error(res, writer.error(), writer.exists() ? 409 : 500);
+        return;
     }
 
-    const size_t bytes_written = file_part.content.size();
+    const uint64_t bytes_written = writer.size();
     std::cout << "[RequestHandlers] Uploaded " << bytes_written << " bytes to "
-              << dest_path.string() << " (model_type=" << model_type << ")" << std::endl;
+              << target.dest_path.string() << " (model_type=" << target.model_type << ")" << std::endl;
 
     // Refresh the in-memory model index so the new file is visible to
     // /models, the WebUI, and load operations without an explicit refresh.
     try {
         model_manager_.scan_models();
+        // Hashed on the way in, so the catalog needn't read it again
+        model_manager_.record_model_hash(target.dest_path.string(), writer.sha256());
     } catch (const std::exception& e) {
         std::cerr << "[RequestHandlers] scan_models after upload failed: "
                   << e.what() << std::endl;
@@ -4434,13 +5100,14 @@ void RequestHandlers::handle_upload_model(const httplib::Request& req, httplib::
 
     nlohmann::json body = {
         {"success",    true},
-        {"filename",   filename},
-        {"model_type", model_type},
+        {"filename",   target.filename},
+        {"model_type", target.model_type},
         {"size_bytes", bytes_written},
-        {"full_path",  dest_path.string()},
+        {"full_path",  target.dest_path.string()},
+        {"sha256",     writer.sha256()},
     };
-    if (!subfolder.empty()) {
-        body["subfolder"] = subfolder;
+    if (!target.subfolder.empty()) {
+        body["subfolder"] = target.subfolder;
     }
     send_json(res, body, 201);
 }
@@ -4919,6 +5586,40 @@ static int webdav_resolve_failure_status(const std::string& url_path) {
     return has_dotdot(decoded) ? 400 : 404;
 }
 
+std::string RequestHandlers::authenticated_user(const httplib::Request& req) const {
+    if (!auth_manager_.enabled()) return "";
+    std::string token = extract_cookie_token(req);
+    if (token.empty()) {
+        std::string h = req.get_header_value("Authorization");
+        const std::string p = "Bearer ";
+        if (h.size() > p.size() && h.compare(0, p.size(), p) == 0) {
+            token = h.substr(p.size());
+        }
+    }
+    if (token.empty()) return "";
+    return auth_manager_.verify_token(token).value_or("");
+}
+
+bool RequestHandlers::take_job_origin(const httplib::Request& req, nlohmann::json& body,
+                                      JobOrigin& origin, httplib::Response& res) {
+    if (body.contains("priority")) {
+        if (!body["priority"].is_string()) {
+            send_error(res, "priority must be a string", 400);
+            return false;
+        }
+        try {
+            origin.priority = string_to_job_priority(body["priority"].get<std::string>());
+        } catch (const std::exception& e) {
+            send_error(res, e.what(), 400);
+            return false;
+        }
+    }
+    body.erase("priority");
+
+    origin.owner = authenticated_user(req);
+    return true;
+}
+
 std::string RequestHandlers::extract_cookie_token(const httplib::Request& req) {
     // The Cookie header is a single line of the form
     //   Cookie: name1=val1; name2=val2; ...
@@ -5024,13 +5725,14 @@ httplib::Server::HandlerResponse
 RequestHandlers::handle_webdav_propfind(const httplib::Request& req, httplib::Response& res) {
     namespace fs = std::filesystem;
 
-    // Depth: 0, 1, or "infinity". We treat "infinity" as 1 to avoid recursive
-    // blowup on /webdav/models/diffusion_models/ (could contain dozens of GB).
+    // Depth: 0, 1, or "infinity". "infinity" (and a missing header) descends
+    // server.webdav_max_depth levels - 1 unless the operator opted in, so a
+    // client can't walk /webdav/models/ recursively by default.
     std::string depth_hdr = req.get_header_value("Depth");
     int depth = 1;
     if (depth_hdr == "0") depth = 0;
     else if (depth_hdr == "1") depth = 1;
-    else depth = 1;  // default + "infinity" both clamped to 1
+    else depth = webdav_max_depth_;
 
     // Pseudo-roots that don't resolve to a single filesystem directory:
     //   /webdav/                — top-level: lists "output" + "models"
@@ -5134,34 +5836,61 @@ RequestHandlers::handle_webdav_propfind(const httplib::Request& req, httplib::Re
                                  xml_escape(self_name),
                                  is_dir, self_size, lastmod, ctype);
 
-        // Children (depth >= 1, only for directories).
+        // Children (depth >= 1, only for directories): the tree is walked
+        // depth-first from the cached listings and streamed in chunks, so
+        // neither the entries nor the XML of a large output tree are ever
+        // held whole
         if (is_dir && depth >= 1) {
-            std::vector<fs::directory_entry> kids;
-            for (auto& de : fs::directory_iterator(full, fs::directory_options::skip_permission_denied, ec)) {
-                kids.push_back(de);
-                // Cap at a large but bounded number to prevent OOM on
-                // pathological directories (e.g. someone dumped 100k files).
-                if (kids.size() >= 5000) break;
-            }
-            std::sort(kids.begin(), kids.end(),
-                      [](const fs::directory_entry& a, const fs::directory_entry& b) {
-                          return a.path().filename().string() < b.path().filename().string();
-                      });
-            for (auto& de : kids) {
-                std::error_code ec2;
-                bool kdir = de.is_directory(ec2);
-                std::string kname = de.path().filename().string();
-                std::string khref = canonical_self + url_encode_segment(kname);
-                if (kdir) khref.push_back('/');
-                uintmax_t ksize = kdir ? 0 : fs::file_size(de.path(), ec2);
-                std::string klm;
-                auto kft = fs::last_write_time(de.path(), ec2);
-                if (!ec2) klm = rfc1123_from_filetime(kft);
-                std::string kct = kdir ? "" : mime_for_extension(de.path());
-                append_propfind_response(body, xml_escape(khref),
-                                         xml_escape(kname),
-                                         kdir, ksize, klm, kct);
-            }
+            struct Frame {
+                fs::path dir;
+                std::string href;       // URL-encoded, trailing slash
+                int remaining;          // Levels still to list below `dir`
+                std::shared_ptr<const FileServer::DirListing> listing;
+                size_t next = 0;
+            };
+            struct Walk {
+                std::string pending;    // Multistatus head + self entry
+                std::vector<Frame> stack;
+            };
+            auto walk = std::make_shared<Walk>();
+            walk->pending = std::move(body);
+            walk->stack.push_back({full, canonical_self, depth, nullptr, 0});
+
+            res.status = 207;
+            res.set_header("DAV", "1");
+            res.set_chunked_content_provider(
+                "application/xml; charset=utf-8",
+                [this, walk](size_t /*offset*/, httplib::DataSink& sink) {
+                    constexpr size_t kChunkBytes = 64 * 1024;
+                    std::string out;
+                    out.swap(walk->pending);
+                    out.reserve(kChunkBytes + 1024);
+                    auto& stack = walk->stack;
+                    while (out.size() < kChunkBytes && !stack.empty()) {
+                        Frame& f = stack.back();
+                        if (!f.listing) f.listing = files_->list_directory(f.dir.string());
+                        if (!f.listing || f.next >= f.listing->entries.size()) {
+                            stack.pop_back();
+                            continue;
+                        }
+                        const auto& e = f.listing->entries[f.next++];
+                        std::string href = f.href + url_encode_segment(e.name);
+                        if (e.is_dir) href.push_back('/');
+                        fs::path path = f.dir / e.name;
+                        append_propfind_response(out, xml_escape(href), xml_escape(e.name),
+                                                 e.is_dir, e.size, e.last_modified,
+                                                 e.is_dir ? "" : mime_for_extension(path));
+                        if (e.is_dir && f.remaining > 1) {
+                            const int remaining = f.remaining - 1;
+                            stack.push_back({std::move(path), std::move(href), remaining, nullptr, 0});
+                        }
+                    }
+                    if (stack.empty()) out += "</D:multistatus>";
+                    if (!out.empty() && !sink.write(out.data(), out.size())) return false;
+                    if (stack.empty()) sink.done();
+                    return true;
+                });
+            return httplib::Server::HandlerResponse::Handled;
         }
     }
 
@@ -5206,6 +5935,7 @@ RequestHandlers::handle_webdav_mkcol(const httplib::Request& req, httplib::Respo
         res.body = std::string("mkdir failed: ") + ec.message();
         return httplib::Server::HandlerResponse::Handled;
     }
+    files_->invalidate(maybe->string());
     res.status = 201;  // Created
     res.body = "";
     return httplib::Server::HandlerResponse::Handled;
@@ -5290,6 +6020,12 @@ RequestHandlers::handle_webdav_move(const httplib::Request& req, httplib::Respon
         }
         fs::remove_all(*src, ec2);
     }
+    if (thumbnails_) {
+        thumbnails_->invalidate(src->string());
+        thumbnails_->invalidate(dst->string());
+    }
+    files_->invalidate(src->string());
+    files_->invalidate(dst->string());
     res.status = dst_exists ? 204 : 201;
     res.body = "";
     return httplib::Server::HandlerResponse::Handled;
@@ -5339,6 +6075,8 @@ RequestHandlers::handle_webdav_copy(const httplib::Request& req, httplib::Respon
         res.body = std::string("copy failed: ") + ec.message();
         return httplib::Server::HandlerResponse::Handled;
     }
+    if (thumbnails_) thumbnails_->invalidate(dst->string());
+    files_->invalidate(dst->string());
     res.status = dst_exists ? 204 : 201;
     res.body = "";
     return httplib::Server::HandlerResponse::Handled;
@@ -5380,53 +6118,18 @@ void RequestHandlers::handle_webdav_get(const httplib::Request& req,
         return;
     }
 
-    // Regular file. Stream from disk so we don't blow memory on big checkpoints.
-    auto size = fs::file_size(*maybe, ec);
-    if (ec) {
-        res.status = 500;
-        res.body = "stat failed";
-        return;
-    }
-    auto ft = fs::last_write_time(*maybe, ec);
-    std::string lastmod = ec ? "" : rfc1123_from_filetime(ft);
-    std::string ctype = mime_for_extension(*maybe);
-    if (!lastmod.empty()) res.set_header("Last-Modified", lastmod);
-
-    if (head_only) {
-        // For HEAD, populate metadata-only response. cpp-httplib will strip
-        // the body, but we still need Content-Length/Content-Type set.
-        res.status = 200;
-        res.set_header("Content-Length", std::to_string(size));
-        res.set_header("Content-Type", ctype);
-        return;
-    }
-
-    // Use chunked content provider for large files. The lambda owns an
-    // ifstream; cpp-httplib calls it repeatedly until offset == size.
-    auto file_path = *maybe;
-    auto ifs = std::make_shared<std::ifstream>(file_path, std::ios::binary);
-    if (!ifs->is_open()) {
+    // Regular file: memory-mapped, so multi-GB checkpoints stream without
+    // a user-space copy. No long-lived Cache-Control here: WebDAV files are
+    // mutable, clients revalidate with the ETag / Last-Modified instead.
+    if (!files_->serve(req, res, maybe->string(), mime_for_extension(*maybe), "", head_only)) {
         res.status = 500;
         res.body = "open failed";
-        return;
     }
-    res.status = 200;
-    res.set_content_provider(
-        size, ctype,
-        [ifs](size_t offset, size_t length, httplib::DataSink& sink) -> bool {
-            ifs->seekg(static_cast<std::streamoff>(offset), std::ios::beg);
-            const size_t kChunk = 256 * 1024;
-            std::vector<char> buf(std::min(length, kChunk));
-            ifs->read(buf.data(), static_cast<std::streamsize>(buf.size()));
-            auto n = ifs->gcount();
-            if (n > 0) sink.write(buf.data(), static_cast<size_t>(n));
-            return n > 0;
-        },
-        [ifs](bool /*success*/) { ifs->close(); });
 }
 
 void RequestHandlers::handle_webdav_put(const httplib::Request& req,
-                                        httplib::Response& res) {
+                                        httplib::Response& res,
+                                        const httplib::ContentReader& content_reader) {
     namespace fs = std::filesystem;
     std::string url_root;
     auto maybe = resolve_webdav_path(req.path, url_root);
@@ -5454,39 +6157,32 @@ void RequestHandlers::handle_webdav_put(const httplib::Request& req,
     }
     bool existed = fs::exists(*maybe, ec);
 
-    // Write atomically: write to <name>.webdav.tmp.<pid>, then rename. This
-    // prevents a partial upload from clobbering a good file if the connection
-    // drops. (Many DAV clients chunk uploads; cpp-httplib has buffered the
-    // whole body into req.body by the time we get here.)
-    fs::path tmp_path = *maybe;
-    tmp_path += ".webdav.tmp." + std::to_string(::getpid());
-    {
-        std::ofstream ofs(tmp_path, std::ios::binary | std::ios::trunc);
-        if (!ofs.is_open()) {
-            res.status = 500;
-            res.body = "open for write failed";
-            return;
-        }
-        if (!req.body.empty()) {
-            ofs.write(req.body.data(), static_cast<std::streamsize>(req.body.size()));
-        }
-        ofs.flush();
-        if (!ofs) {
-            res.status = 500;
-            res.body = "write failed";
-            std::error_code ec2;
-            fs::remove(tmp_path, ec2);
-            return;
-        }
+    // Stream the body into a temp file next to the target, then rename.
+    // Memory stays flat for multi-GB PUTs (chunked or not), and a dropped
+    // connection never clobbers a good file: the writer removes its temp
+    // file unless the commit succeeds.
+    UploadWriter writer;
+    if (!writer.open(maybe->parent_path().string(), maybe->filename().string(),
+                     request_content_length(req))) {
+        res.status = writer.out_of_space() ? 507 : 500;
+        res.body = writer.error();
+        return;
     }
-    fs::rename(tmp_path, *maybe, ec);
-    if (ec) {
-        std::error_code ec2;
-        fs::remove(tmp_path, ec2);
+    bool received = content_reader([&](const char* data, size_t len) {
+        return writer.write(data, len);
+    });
+    if (!received) {
+        res.status = writer.error().empty() ? 400 : (writer.out_of_space() ? 507 : 500);
+        res.body = writer.error().empty() ? "request body incomplete" : writer.error();
+        return;
+    }
+    if (!writer.commit(maybe->string(), /*replace=*/true)) {
         res.status = 500;
-        res.body = std::string("rename failed: ") + ec.message();
+        res.body = writer.error();
         return;
     }
+    if (thumbnails_) thumbnails_->invalidate(maybe->string());
+    files_->invalidate(maybe->string());
     res.status = existed ? 204 : 201;
     res.body = "";
 }
@@ -5518,6 +6214,8 @@ void RequestHandlers::handle_webdav_delete(const httplib::Request& req,
         res.body = std::string("delete failed: ") + ec.message();
         return;
     }
+    if (thumbnails_) thumbnails_->invalidate(maybe->string());
+    files_->invalidate(maybe->string());
     res.status = 204;
     res.body = "";
 }
@@ -0,0 +1,275 @@
+#include "rpc_probe.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <sstream>
+#include <iomanip>
+
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace sdcpp {
+
+namespace {
+
+// ggml-rpc's rpc_cmd values for the two commands used here; unchanged
+// since protocol 2.0. A request is { u8 cmd, u64 size, payload }, a
+// response { u64 size, payload }.
+constexpr uint8_t RPC_CMD_GET_DEVICE_MEMORY = 11;
+constexpr uint8_t RPC_CMD_HELLO = 14;
+
+using Clock = std::chrono::steady_clock;
+
+double ms_since(Clock::time_point t) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - t).count();
+}
+
+class Socket {
+public:
+    ~Socket() { if (fd_ >= 0) ::close(fd_); }
+
+    bool connect(const std::string& host, const std::string& port, int timeout_ms, std::string& error) {
+        addrinfo hints{};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo* res = nullptr;
+        if (int rc = ::getaddrinfo(host.c_str(), port.c_str(), &hints, &res); rc != 0) {
+            error = std::string("resolve: ") + ::gai_strerror(rc);
+            return false;
+        }
+        for (addrinfo* ai = res; ai; ai = ai->ai_next) {
+            fd_ = ::socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+            if (fd_ < 0) continue;
+            const int flags = ::fcntl(fd_, F_GETFL, 0);
+            ::fcntl(fd_, F_SETFL, flags | O_NONBLOCK);
+            int rc = ::connect(fd_, ai->ai_addr, ai->ai_addrlen);
+            if (rc != 0 && errno == EINPROGRESS) {
+                pollfd p{fd_, POLLOUT, 0};
+                rc = ::poll(&p, 1, timeout_ms) == 1 ? 0 : -1;
+                int so_error = 0;
+                socklen_t len = sizeof(so_error);
+                if (rc == 0 && (::getsockopt(fd_, SOL_SOCKET, SO_ERROR, &so_error, &len) != 0 || so_error != 0)) {
+                    errno = so_error;
+                    rc = -1;
+                }
+            }
+            if (rc == 0) {
+                ::fcntl(fd_, F_SETFL, flags);
+                timeval tv{timeout_ms / 1000, (timeout_ms % 1000) * 1000};
+                ::setsockopt(fd_, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+                ::setsockopt(fd_, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+                int one = 1;
+                ::setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+                ::freeaddrinfo(res);
+                return true;
+            }
+            error = std::string("connect: ") + std::strerror(errno ? errno : ETIMEDOUT);
+            ::close(fd_);
+            fd_ = -1;
+        }
+        ::freeaddrinfo(res);
+        if (error.empty()) error = "connect failed";
+        return false;
+    }
+
+    bool send_all(const void* data, size_t size) {
+        const char* p = static_cast<const char*>(data);
+        while (size > 0) {
+            ssize_t n = ::send(fd_, p, size, MSG_NOSIGNAL);
+            if (n <= 0) return false;
+            p += n;
+            size -= static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    bool recv_all(void* data, size_t size) {
+        char* p = static_cast<char*>(data);
+        while (size > 0) {
+            ssize_t n = ::recv(fd_, p, size, 0);
+            if (n <= 0) return false;
+            p += n;
+            size -= static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    // One command round trip; the response payload must be `out_size` bytes
+    bool command(uint8_t cmd, const void* in, uint64_t in_size, void* out, uint64_t out_size) {
+        if (!send_all(&cmd, 1) || !send_all(&in_size, sizeof(in_size))) return false;
+        if (in_size > 0 && !send_all(in, in_size)) return false;
+        uint64_t size = 0;
+        if (!recv_all(&size, sizeof(size)) || size != out_size) return false;
+        return recv_all(out, out_size);
+    }
+
+private:
+    int fd_ = -1;
+};
+
+std::vector<std::string> split_endpoints(const std::string& list) {
+    std::vector<std::string> out;
+    std::stringstream ss(list);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        item.erase(0, item.find_first_not_of(" \t"));
+        item.erase(item.find_last_not_of(" \t") + 1);
+        if (!item.empty()) out.push_back(item);
+    }
+    return out;
+}
+
+RpcNodeProbe probe_one(const std::string& endpoint, int samples, int timeout_ms) {
+    RpcNodeProbe probe;
+    probe.endpoint = endpoint;
+
+    const size_t colon = endpoint.rfind(':');
+    if (colon == std::string::npos || colon == 0 || colon + 1 == endpoint.size()) {
+        probe.error = "expected host:port";
+        return probe;
+    }
+    std::string host = endpoint.substr(0, colon);
+    if (host.size() > 2 && host.front() == '[' && host.back() == ']') host = host.substr(1, host.size() - 2);
+
+    Socket sock;
+    const auto connect_start = Clock::now();
+    if (!sock.connect(host, endpoint.substr(colon + 1), timeout_ms, probe.error)) return probe;
+    probe.connect_ms = ms_since(connect_start);
+
+    uint8_t version[3] = {0, 0, 0};
+    if (!sock.command(RPC_CMD_HELLO, nullptr, 0, version, sizeof(version))) {
+        probe.error = "no HELLO response (not a ggml rpc-server, or one that is busy with another client)";
+        return probe;
+    }
+    probe.reachable = true;
+    probe.version = std::to_string(version[0]) + "." + std::to_string(version[1]) + "." + std::to_string(version[2]);
+
+    // Protocol 3 addresses one of the server's devices; earlier ones have one
+    const uint32_t device = 0;
+    const uint64_t in_size = version[0] >= 3 ? sizeof(device) : 0;
+    std::vector<double> rtts;
+    for (int i = 0; i < std::max(1, samples); ++i) {
+        uint64_t mem[2] = {0, 0};
+        const auto t = Clock::now();
+        if (!sock.command(RPC_CMD_GET_DEVICE_MEMORY, &device, in_size, mem, sizeof(mem))) {
+            probe.error = "GET_DEVICE_MEMORY failed";
+            break;
+        }
+        rtts.push_back(ms_since(t));
+        probe.free_bytes = mem[0];
+        probe.total_bytes = mem[1];
+    }
+    if (!rtts.empty()) {
+        std::sort(rtts.begin(), rtts.end());
+        probe.rtt_ms = rtts[rtts.size() / 2];
+    }
+    return probe;
+}
+
+std::string gib(uint64_t bytes) {
+    std::ostringstream oss;
+    oss << std::fixed << std::setprecision(2) << bytes / (1024.0 * 1024.0 * 1024.0);
+    return oss.str();
+}
+
+} // namespace
+
+nlohmann::json RpcNodeProbe::to_json() const {
+    nlohmann::json j = {
+        {"endpoint", endpoint},
+        {"reachable", reachable},
+        {"connect_ms", connect_ms},
+        {"rtt_ms", rtt_ms},
+        {"free_bytes", free_bytes},
+        {"total_bytes", total_bytes}
+    };
+    if (!version.empty()) j["version"] = version;
+    if (!error.empty()) j["error"] = error;
+    return j;
+}
+
+std::vector<RpcNodeProbe> probe_rpc_servers(const std::string& rpc_servers, int samples, int timeout_ms) {
+    std::vector<RpcNodeProbe> probes;
+    for (const auto& endpoint : split_endpoints(rpc_servers)) {
+        probes.push_back(probe_one(endpoint, samples, timeout_ms));
+    }
+    return probes;
+}
+
+nlohmann::json RpcSplitPlan::to_json() const {
+    nlohmann::json devs = nlohmann::json::array();
+    for (const auto& d : devices) {
+        nlohmann::json j = {
+            {"device", d.name},
+            {"free_bytes", d.free_bytes},
+            {"budget_bytes", d.budget_bytes},
+            {"share", d.share},
+            {"rtt_ms", d.rtt_ms}
+        };
+        if (!d.endpoint.empty()) j["endpoint"] = d.endpoint;
+        devs.push_back(std::move(j));
+    }
+    nlohmann::json nodes = nlohmann::json::array();
+    for (const auto& p : probes) nodes.push_back(p.to_json());
+    return {
+        {"devices", devs},
+        {"rpc_servers", rpc_servers},
+        {"max_vram", max_vram},
+        {"weight_bytes", weight_bytes},
+        {"fits", fits},
+        {"probe_ms", probe_ms},
+        {"probes", nodes}
+    };
+}
+
+RpcSplitPlan plan_rpc_split(const std::vector<RpcNodeProbe>& probes, const std::string& local_device,
+                            uint64_t local_free_bytes, uint64_t weight_bytes, uint64_t headroom_bytes) {
+    RpcSplitPlan plan;
+    plan.probes = probes;
+    plan.weight_bytes = weight_bytes;
+
+    auto usable = [headroom_bytes](uint64_t free) { return free > headroom_bytes ? free - headroom_bytes : 0; };
+
+    if (!local_device.empty()) {
+        plan.devices.push_back({local_device, "", local_free_bytes, 0, 0.0, 0.0});
+    }
+    for (const auto& p : probes) {
+        if (!p.reachable) continue;
+        if (!plan.rpc_servers.empty()) plan.rpc_servers += ",";
+        plan.rpc_servers += p.endpoint;
+        // ggml names RPC devices after their endpoint
+        if (p.total_bytes > 0) plan.devices.push_back({"RPC[" + p.endpoint + "]", p.endpoint, p.free_bytes, 0, 0.0, p.rtt_ms});
+    }
+
+    uint64_t total_usable = 0;
+    for (const auto& d : plan.devices) total_usable += usable(d.free_bytes);
+    if (total_usable == 0 || weight_bytes == 0) return plan;
+
+    // Proportional to usable VRAM, so every device fills to the same level;
+    // when the weights do not fit each device simply gets all it has
+    plan.fits = weight_bytes <= total_usable;
+    for (auto& d : plan.devices) {
+        const double fraction = static_cast<double>(usable(d.free_bytes)) / static_cast<double>(total_usable);
+        d.budget_bytes = plan.fits ? static_cast<uint64_t>(std::ceil(fraction * static_cast<double>(weight_bytes)))
+                                   : usable(d.free_bytes);
+        d.budget_bytes = std::min(d.budget_bytes, usable(d.free_bytes));
+    }
+    uint64_t placed = 0;
+    for (const auto& d : plan.devices) placed += d.budget_bytes;
+    for (auto& d : plan.devices) {
+        d.share = placed > 0 ? static_cast<double>(d.budget_bytes) / static_cast<double>(placed) : 0.0;
+        if (!plan.max_vram.empty()) plan.max_vram += ",";
+        plan.max_vram += d.name + ":" + gib(d.budget_bytes);
+    }
+    return plan;
+}
+
+} // namespace sdcpp
@@ -1,16 +1,31 @@
 #include "sd_wrapper.hpp"
+#include "conditioning_cache.hpp"
 #include "sd_error_capture.hpp"
 #include "utils.hpp"
+#include "image_resize.hpp"
+#include "image_encoder.hpp"
+#include "image_input.hpp"
+#include "output_pipeline.hpp"
+#include "thumbnail_cache.hpp"
+#include "video_encoder.hpp"
+#include "job_timings.hpp"
+#include "job_trace.hpp"
 
 #include <iostream>
 #include <iomanip>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <filesystem>
 #include <fstream>
 #include <cstring>
+#include <cstdlib>
 #include <cmath>
 #include <stdexcept>
 #include <regex>
 #include <map>
+#include <mutex>
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 #include <unistd.h>
@@ -271,53 +286,387 @@ static bool save_audio_wav(const std::string& path, const sd_audio_t* audio) {
 
 } // anonymous namespace
 
-ProgressCallback SDWrapper::progress_callback_ = nullptr;
-int SDWrapper::expected_diffusion_steps_ = 0;
+namespace {
+
+// sd.cpp keeps one progress callback for the process. It stays registered
+// while any thread has a callback of its own (several generation workers);
+// SDWrapper's thread_local state routes each call to its thread's job.
+std::mutex progress_registration_mutex;
+int progress_users = 0;
+thread_local bool progress_registered = false;
+
+} // namespace
+
+thread_local ProgressCallback SDWrapper::progress_callback_ = nullptr;
+thread_local int SDWrapper::expected_diffusion_steps_ = 0;
 
 void SDWrapper::set_progress_callback(ProgressCallback callback, int expected_steps) {
     progress_callback_ = callback;
     expected_diffusion_steps_ = expected_steps;
+    std::lock_guard<std::mutex> lock(progress_registration_mutex);
+    if (!progress_registered) {
+        progress_registered = true;
+        progress_users++;
+    }
     sd_set_progress_callback(internal_progress_callback, nullptr);
 }
 
 void SDWrapper::clear_progress_callback() {
     progress_callback_ = nullptr;
     expected_diffusion_steps_ = 0;
-    sd_set_progress_callback(nullptr, nullptr);
+    std::lock_guard<std::mutex> lock(progress_registration_mutex);
+    if (!progress_registered) return;
+    progress_registered = false;
+    if (--progress_users == 0) sd_set_progress_callback(nullptr, nullptr);
+}
+
+void SDWrapper::resume_progress_callback() {
+    std::lock_guard<std::mutex> lock(progress_registration_mutex);
+    sd_set_progress_callback(progress_users > 0 ? internal_progress_callback : nullptr, nullptr);
+}
+
+thread_local bool SDWrapper::progress_muted_ = false;
+
+void SDWrapper::set_thread_progress_muted(bool muted) {
+    progress_muted_ = muted;
+}
+
+namespace {
+
+// Conditioning cache: sd.cpp's hook is process-wide, the key prefix is per
+// generate call. Outside a ConditioningScope (ADetailer's inpaint pass,
+// offload tuning runs) encodes neither read nor store.
+std::atomic<ConditioningCache*> conditioning_cache{nullptr};
+std::mutex conditioning_scopes_mutex;
+std::unordered_map<const sd_ctx_t*, std::string> conditioning_scopes;
+thread_local std::string conditioning_prefix;
+thread_local std::shared_ptr<const std::string> conditioning_fetched;  // Blob sd.cpp is copying
+
+#ifdef SDCPP_COND_CACHE
+bool conditioning_fetch(const char* key, const void** data, size_t* size, void* /*user*/) {
+    ConditioningCache* cache = conditioning_cache.load();
+    if (!cache || conditioning_prefix.empty()) return false;
+    conditioning_fetched = cache->find(conditioning_prefix + key);
+    if (!conditioning_fetched) return false;
+    *data = conditioning_fetched->data();
+    *size = conditioning_fetched->size();
+    return true;
+}
+
+void conditioning_store(const char* key, const void* data, size_t size, void* /*user*/) {
+    ConditioningCache* cache = conditioning_cache.load();
+    if (!cache || conditioning_prefix.empty()) return;
+    cache->insert(conditioning_prefix + key, std::string(static_cast<const char*>(data), size));
+}
+#endif
+
+/**
+ * Key prefix of one generate call: the context's scope and the LoRA set
+ * (LoRAs may patch the text encoders). sd.cpp appends the prompt text,
+ * clip_skip and size.
+ */
+class ConditioningScope {
+public:
+    ConditioningScope(const sd_ctx_t* ctx, const std::vector<SDWrapper::ParsedLora>& loras) {
+        ConditioningCache* cache = conditioning_cache.load();
+        if (!cache || !cache->enabled()) return;
+        std::string prefix;
+        {
+            std::lock_guard<std::mutex> lock(conditioning_scopes_mutex);
+            auto it = conditioning_scopes.find(ctx);
+            if (it == conditioning_scopes.end()) return;
+            prefix = it->second;
+        }
+        for (const auto& lora : loras) {
+            prefix += '|' + lora.path + ':' + std::to_string(lora.multiplier) + (lora.is_high_noise ? ":high" : "");
+        }
+        prefix += '\x1e';
+        conditioning_prefix = std::move(prefix);
+    }
+
+    ~ConditioningScope() {
+        conditioning_prefix.clear();
+        conditioning_fetched.reset();
+    }
+
+    ConditioningScope(const ConditioningScope&) = delete;
+    ConditioningScope& operator=(const ConditioningScope&) = delete;
+};
+
+} // namespace
+
+void SDWrapper::set_conditioning_cache(ConditioningCache* cache) {
+    conditioning_cache.store(cache);
+#ifdef SDCPP_COND_CACHE
+    if (cache && cache->enabled()) {
+        sd_set_cond_cache_hooks(conditioning_fetch, conditioning_store, nullptr);
+    } else {
+        sd_set_cond_cache_hooks(nullptr, nullptr, nullptr);
+    }
+#endif
+}
+
+void SDWrapper::set_conditioning_scope(const sd_ctx_t* ctx, const std::string& scope) {
+    std::lock_guard<std::mutex> lock(conditioning_scopes_mutex);
+    if (scope.empty()) {
+        conditioning_scopes.erase(ctx);
+    } else {
+        conditioning_scopes[ctx] = scope;
+    }
+}
+
+bool SDWrapper::conditioning_cache_available() {
+#ifdef SDCPP_COND_CACHE
+    return true;
+#else
+    return false;
+#endif
+}
+
+namespace {
+
+using PreviewFn = void (*)(int step, int frame_count, sd_image_t* frames, bool is_noisy, void* data);
+
+constexpr int PARKED_INTERVAL = 1 << 30;
+
+/**
+ * sd.cpp's preview registration (callback, mode, interval), shared by the
+ * threads that have a preview callback. sd.cpp previews a step when
+ * step % interval == 0: every step while a paced thread has armed the
+ * next one, else the fixed interval, else never (parked).
+ */
+struct PreviewRegistration {
+    std::mutex mutex;
+    PreviewFn callback = nullptr;
+    preview_t mode = PREVIEW_NONE;
+    int users = 0;              // Threads with a preview callback
+    int fixed_users = 0;        // ...of them at a fixed interval
+    int fixed_interval = 1;
+    int armed = 0;              // Paced threads wanting the next step
+
+    void apply_locked() {
+        if (users == 0) {
+            sd_set_preview_callback(nullptr, PREVIEW_NONE, 0, false, false, nullptr);
+            return;
+        }
+        const int interval = armed > 0 ? 1 : fixed_users > 0 ? fixed_interval : PARKED_INTERVAL;
+        sd_set_preview_callback(callback, mode, interval, true, false, nullptr);
+    }
+};
+
+PreviewRegistration& preview_registration() {
+    static PreviewRegistration registration;
+    return registration;
 }
 
+/** Pacing counters since startup, over all threads */
+struct PreviewPacingStats {
+    std::atomic<uint64_t> previews{0};
+    std::atomic<uint64_t> steps_unwatched{0};
+    std::atomic<uint64_t> steps_throttled{0};
+    std::atomic<int> interval{1};
+    std::atomic<double> last_step_ms{0.0};
+    std::atomic<double> last_preview_ms{0.0};
+};
+
+PreviewPacingStats& preview_stats() {
+    static PreviewPacingStats stats;
+    return stats;
+}
+
+/**
+ * Per-step preview pacing (SDWrapper::set_preview_callback with a demand
+ * check or budget). sd.cpp sizes its preview buffers from the mode when
+ * sampling starts, so the mode and callback stay fixed for the whole job
+ * and only the interval moves: arming the next step sets it to 1, parking
+ * skips the step. One per thread, touched only from its sampler thread.
+ */
+struct PreviewPacer {
+    using Clock = std::chrono::steady_clock;
+
+    // Preview every step still leaves one step in this many unpreviewed,
+    // so the no-preview step time can't go stale
+    static constexpr int BASELINE_EVERY = 8;
+    static constexpr double EMA_WEIGHT = 0.3;
+
+    bool registered = false;            // Counted in PreviewRegistration::users
+    bool active = false;                // Paced (else a fixed interval)
+    int every = 1;                      // The fixed interval
+    PreviewDemandFn demand;
+    int min_interval = 1;
+    int budget_percent = 0;
+
+    bool armed = false;
+    bool previewed_gap = false;         // A preview ran since the last step callback
+    int steps_since_preview = 0;
+    int previews_since_baseline = 0;
+    Clock::time_point last_step{};
+    double step_ms = 0.0;               // EMA of steps without a preview
+    double preview_step_ms = 0.0;       // EMA of steps with one
+
+    void arm(bool on) {
+        if (on == armed) return;
+        armed = on;
+        auto& reg = preview_registration();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        reg.armed += on ? 1 : -1;
+        reg.apply_locked();
+    }
+
+    // Leave the registration: disarm and stop counting as a user
+    void release() {
+        auto& reg = preview_registration();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        if (armed) reg.armed--;
+        if (registered) {
+            reg.users--;
+            if (!active) reg.fixed_users--;
+        }
+        armed = false;
+        registered = false;
+        active = false;
+        demand = nullptr;
+        reg.apply_locked();
+    }
+
+    static void ema(double& avg, double sample) {
+        avg = avg <= 0.0 ? sample : avg + EMA_WEIGHT * (sample - avg);
+    }
+
+    // Steps to leave between previews so their cost fits the budget
+    int paced_interval() const {
+        int n = min_interval;
+        if (budget_percent > 0 && step_ms > 0.0 && preview_step_ms > step_ms) {
+            const double cost = preview_step_ms - step_ms;
+            n = std::max(n, static_cast<int>(std::ceil(cost * 100.0 / (budget_percent * step_ms))));
+        }
+        return n;
+    }
+
+    void on_step() {
+        auto& stats = preview_stats();
+        const auto now = Clock::now();
+        if (last_step != Clock::time_point{}) {
+            const double gap = std::chrono::duration<double, std::milli>(now - last_step).count();
+            ema(previewed_gap ? preview_step_ms : step_ms, gap);
+            if (!previewed_gap) previews_since_baseline = 0;
+        }
+        last_step = now;
+        previewed_gap = false;
+        ++steps_since_preview;
+
+        if (demand && !demand()) {
+            stats.steps_unwatched++;
+            arm(false);
+            return;
+        }
+        int n = paced_interval();
+        // No baseline yet (or a stale one): leave this step unpreviewed
+        if (budget_percent > 0 && (step_ms <= 0.0 || previews_since_baseline >= BASELINE_EVERY)) {
+            n = std::max(n, 2);
+        }
+        stats.interval = n;
+        stats.last_step_ms = step_ms;
+        stats.last_preview_ms = std::max(0.0, preview_step_ms - step_ms);
+        const bool due = steps_since_preview >= n;
+        if (!due && n > min_interval) stats.steps_throttled++;
+        arm(due);
+    }
+
+    void on_preview() {
+        preview_stats().previews++;
+        previewed_gap = true;
+        steps_since_preview = 0;
+        ++previews_since_baseline;
+        arm(false);
+    }
+};
+
+PreviewPacer& preview_pacer() {
+    static thread_local PreviewPacer pacer;
+    return pacer;
+}
+
+} // namespace
+
 // Preview callback support
-PreviewCallback SDWrapper::preview_callback_ = nullptr;
-int SDWrapper::preview_max_size_ = 256;
-int SDWrapper::preview_quality_ = 75;
+thread_local PreviewCallback SDWrapper::preview_callback_ = nullptr;
+thread_local int SDWrapper::preview_max_size_ = 256;
+thread_local int SDWrapper::preview_quality_ = 75;
+
+void SDWrapper::set_preview_callback(PreviewCallback callback, PreviewMode mode, int interval, int max_size, int quality,
+                                     PreviewDemandFn demand, int max_overhead_percent) {
+    auto& pacer = preview_pacer();
+    pacer.release();
 
-void SDWrapper::set_preview_callback(PreviewCallback callback, PreviewMode mode, int interval, int max_size, int quality) {
     preview_callback_ = callback;
     preview_max_size_ = max_size;
     preview_quality_ = quality;
 
-    if (callback && mode != PreviewMode::None) {
-        // Map our PreviewMode to sd.cpp's preview_t enum
-        preview_t sd_mode;
-        switch (mode) {
-            case PreviewMode::Proj: sd_mode = PREVIEW_PROJ; break;
-            case PreviewMode::Tae:  sd_mode = PREVIEW_TAE; break;
-            case PreviewMode::Vae:  sd_mode = PREVIEW_VAE; break;
-            default:                sd_mode = PREVIEW_NONE; break;
-        }
-        // Set preview callback: mode, interval, denoised=true, noisy=false
-        sd_set_preview_callback(internal_preview_callback, sd_mode, interval, true, false, nullptr);
-    } else {
-        sd_set_preview_callback(nullptr, PREVIEW_NONE, 0, false, false, nullptr);
-    }
+    if (!callback || mode == PreviewMode::None) return;
+
+    // Map our PreviewMode to sd.cpp's preview_t enum
+    preview_t sd_mode;
+    switch (mode) {
+        case PreviewMode::Proj: sd_mode = PREVIEW_PROJ; break;
+        case PreviewMode::Tae:  sd_mode = PREVIEW_TAE; break;
+        case PreviewMode::Vae:  sd_mode = PREVIEW_VAE; break;
+        default:                sd_mode = PREVIEW_NONE; break;
+    }
+    pacer.every = std::max(1, interval);
+    if (demand || max_overhead_percent > 0) {
+        // Paced: parked until the first step callback decides
+        pacer.active = true;
+        pacer.demand = std::move(demand);
+        pacer.min_interval = pacer.every;
+        pacer.budget_percent = max_overhead_percent;
+        pacer.previewed_gap = false;
+        pacer.steps_since_preview = pacer.min_interval;
+        pacer.previews_since_baseline = 0;
+        pacer.last_step = {};
+        pacer.step_ms = pacer.preview_step_ms = 0.0;
+    }
+
+    auto& reg = preview_registration();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    pacer.registered = true;
+    reg.users++;
+    if (!pacer.active) {
+        reg.fixed_users++;
+        reg.fixed_interval = pacer.every;
+    }
+    // Denoised previews of the mode; the same for every job (server-wide settings)
+    reg.callback = internal_preview_callback;
+    reg.mode = sd_mode;
+    reg.apply_locked();
 }
 
 void SDWrapper::clear_preview_callback() {
     preview_callback_ = nullptr;
-    sd_set_preview_callback(nullptr, PREVIEW_NONE, 0, false, false, nullptr);
+    preview_pacer().release();
+}
+
+nlohmann::json SDWrapper::preview_pacing_json() {
+    const auto& stats = preview_stats();
+    return {
+        {"previews", stats.previews.load()},
+        {"steps_unwatched", stats.steps_unwatched.load()},
+        {"steps_throttled", stats.steps_throttled.load()},
+        {"interval", stats.interval.load()},
+        {"step_ms", stats.last_step_ms.load()},
+        {"preview_ms", stats.last_preview_ms.load()}
+    };
 }
 
 void SDWrapper::internal_preview_callback(int step, int frame_count, sd_image_t* frames, bool is_noisy, void* /*data*/) {
+    // sd.cpp decodes for whichever thread wants the step; the others drop it
+    auto& pacer = preview_pacer();
+    if (pacer.active) {
+        if (!pacer.armed) return;
+        pacer.on_preview();
+    } else if (step % pacer.every != 0) {
+        return;
+    }
     if (!preview_callback_ || !frames || frame_count == 0) {
         return;
     }
@@ -337,7 +686,11 @@ void SDWrapper::internal_preview_callback(int step, int frame_count, sd_image_t*
     // This eliminates O(n*m) CPU work per preview
 
     // Encode as JPEG directly from source frame
-    std::vector<uint8_t> jpeg_data = encode_jpeg_memory(frame.data, width, height, channels, preview_quality_);
+    std::vector<uint8_t> jpeg_data;
+    {
+        JobTrace::Span span("preview_encode", "preview");
+        jpeg_data = encode_jpeg_memory(frame.data, width, height, channels, preview_quality_);
+    }
 
     if (!jpeg_data.empty()) {
         preview_callback_(step, frame_count, jpeg_data, width, height, is_noisy);
@@ -345,57 +698,29 @@ void SDWrapper::internal_preview_callback(int step, int frame_count, sd_image_t*
 }
 
 std::vector<uint8_t> SDWrapper::resize_image_bilinear(const uint8_t* data, int src_w, int src_h, int channels, int dst_w, int dst_h) {
-    std::vector<uint8_t> result(dst_w * dst_h * channels);
-
-    float x_ratio = static_cast<float>(src_w) / dst_w;
-    float y_ratio = static_cast<float>(src_h) / dst_h;
-
-    for (int y = 0; y < dst_h; y++) {
-        for (int x = 0; x < dst_w; x++) {
-            float src_x = x * x_ratio;
-            float src_y = y * y_ratio;
-
-            int x0 = static_cast<int>(src_x);
-            int y0 = static_cast<int>(src_y);
-            int x1 = std::min(x0 + 1, src_w - 1);
-            int y1 = std::min(y0 + 1, src_h - 1);
-
-            float x_diff = src_x - x0;
-            float y_diff = src_y - y0;
-
-            for (int c = 0; c < channels; c++) {
-                float val00 = data[(y0 * src_w + x0) * channels + c];
-                float val01 = data[(y1 * src_w + x0) * channels + c];
-                float val10 = data[(y0 * src_w + x1) * channels + c];
-                float val11 = data[(y1 * src_w + x1) * channels + c];
-
-                float val = val00 * (1 - x_diff) * (1 - y_diff) +
-                           val10 * x_diff * (1 - y_diff) +
-                           val01 * (1 - x_diff) * y_diff +
-                           val11 * x_diff * y_diff;
-
-                result[(y * dst_w + x) * channels + c] = static_cast<uint8_t>(std::min(255.0f, std::max(0.0f, val)));
-            }
-        }
-    }
-
-    return result;
+    return resize_image(data, src_w, src_h, channels, dst_w, dst_h, ResizeFilter::Bilinear);
 }
 
 std::vector<uint8_t> SDWrapper::encode_jpeg_memory(const uint8_t* data, int width, int height, int channels, int quality) {
-    std::vector<uint8_t> result;
-
-    auto write_func = [](void* context, void* data, int size) {
-        auto* vec = static_cast<std::vector<uint8_t>*>(context);
-        auto* bytes = static_cast<uint8_t*>(data);
-        vec->insert(vec->end(), bytes, bytes + size);
-    };
-
-    stbi_write_jpg_to_func(write_func, &result, width, height, channels, data, quality);
-    return result;
+    EncodeOptions options;
+    options.format = ImageFormat::Jpeg;
+    options.quality = quality;
+    try {
+        return encode_image(data, width, height, channels, options);
+    } catch (const std::exception& e) {
+        std::cerr << "[SDWrapper] Preview encode failed: " << e.what() << std::endl;
+        return {};
+    }
 }
 
 void SDWrapper::internal_progress_callback(int step, int steps, float time, void* /*data*/) {
+    // Per-thread, so safe on muted threads too
+    JobTimings::note_step();
+    JobTrace::note_step(step, steps);
+
+    // Muted threads (the post worker) report their own progress
+    if (progress_muted_) return;
+
     // Determine which phase this callback is from
     // - Diffusion phase: steps matches expected_diffusion_steps_
     // - VAE/other phase: steps differs from expected
@@ -410,6 +735,11 @@ void SDWrapper::internal_progress_callback(int step, int steps, float time, void
     if (progress_callback_ && (is_diffusion_phase || report_all_mode)) {
         progress_callback_(step, steps);
     }
+    // Sampling passes whose step count differs from the expected one
+    // (hires fix) are paced too; very short ones are internal operations
+    if ((is_diffusion_phase || steps > 3) && preview_pacer().active) {
+        preview_pacer().on_step();
+    }
 
     // Console output: only on first step, last step, or every 5th step to reduce I/O overhead
     if (step == 0 || step == steps || (step % 5 == 0)) {
@@ -629,6 +959,7 @@ std::vector<std::string> parse_string_array(const nlohmann::json& j, const std::
 // client replaying a prior job's params shouldn't be forced to strip them.
 static const std::unordered_set<std::string> VARIATION_METADATA_KEYS = {
     "variation_group_id", "variation_index", "variation_total", "variation_template",
+    "variation_cursor", "variation_sweep",
 };
 static void reject_unknown_keys(const std::string& where,
                                 const nlohmann::json& j,
@@ -775,6 +1106,7 @@ Txt2ImgParams Txt2ImgParams::from_json(const nlohmann::json& j) {
         // Qwen-Image layered (PR #1119, surfaced on sd_img_gen_params_t after #1748).
         "qwen_image_layers",
         "upscale", "upscale_auto_unload", "upscale_repeats",
+        "output_format", "output_quality",
     };
     reject_unknown_keys("/txt2img body", j, KNOWN);
 
@@ -887,6 +1219,11 @@ Txt2ImgParams Txt2ImgParams::from_json(const nlohmann::json& j) {
     p.upscale_auto_unload = parse_bool(j, "upscale_auto_unload", true);
     p.upscale_repeats = parse_int(j, "upscale_repeats", 1);
 
+    // Output encoding (validated here so a bad format 400s at submit time)
+    p.output_format = parse_string(j, "output_format", "");
+    p.output_quality = parse_int(j, "output_quality", -1);
+    resolve_encode_options(p.output_format, p.output_quality);
+
     return p;
 }
 
@@ -976,6 +1313,13 @@ nlohmann::json Txt2ImgParams::to_json() const {
         j["upscale_repeats"] = upscale_repeats;
     }
 
+    if (!output_format.empty()) {
+        j["output_format"] = output_format;
+    }
+    if (output_quality > 0) {
+        j["output_quality"] = output_quality;
+    }
+
     return j;
 }
 
@@ -1013,6 +1357,7 @@ Img2ImgParams Img2ImgParams::from_json(const nlohmann::json& j) {
         // Per-gen circular RoPE + Qwen-Image layered (leejet PRs #1748 / #1119).
         "circular_x", "circular_y", "qwen_image_layers",
         "upscale", "upscale_auto_unload", "upscale_repeats",
+        "output_format", "output_quality",
     };
     reject_unknown_keys("/img2img body", j, KNOWN);
 
@@ -1147,6 +1492,11 @@ Img2ImgParams Img2ImgParams::from_json(const nlohmann::json& j) {
     p.upscale_auto_unload = parse_bool(j, "upscale_auto_unload", true);
     p.upscale_repeats = parse_int(j, "upscale_repeats", 1);
 
+    // Output encoding (validated here so a bad format 400s at submit time)
+    p.output_format = parse_string(j, "output_format", "");
+    p.output_quality = parse_int(j, "output_quality", -1);
+    resolve_encode_options(p.output_format, p.output_quality);
+
     return p;
 }
 
@@ -1243,6 +1593,13 @@ nlohmann::json Img2ImgParams::to_json() const {
         j["upscale_repeats"] = upscale_repeats;
     }
 
+    if (!output_format.empty()) {
+        j["output_format"] = output_format;
+    }
+    if (output_quality > 0) {
+        j["output_quality"] = output_quality;
+    }
+
     return j;
 }
 
@@ -1285,6 +1642,8 @@ Txt2VidParams Txt2VidParams::from_json(const nlohmann::json& j) {
         "hires_steps", "hires_denoising_strength", "hires_upscale_tile_size",
         // Per-gen circular RoPE (leejet PR #1748). Video path has no qwen_image_layers.
         "circular_x", "circular_y",
+        // Video file output
+        "video_format", "video_codec", "keep_frames",
     };
     reject_unknown_keys("/txt2vid body", j, KNOWN);
 
@@ -1419,6 +1778,12 @@ Txt2VidParams Txt2VidParams::from_json(const nlohmann::json& j) {
     p.circular_x = parse_bool(j, "circular_x", false);
     p.circular_y = parse_bool(j, "circular_y", false);
 
+    // Video file output; resolved here so bad formats fail at submit time
+    p.video_format = parse_string(j, "video_format", "");
+    p.video_codec = parse_string(j, "video_codec", "");
+    p.keep_frames = parse_bool(j, "keep_frames", default_keep_frames());
+    resolve_video_options(p.video_format, p.video_codec, p.fps);
+
     return p;
 }
 
@@ -1502,6 +1867,15 @@ nlohmann::json Txt2VidParams::to_json() const {
         j["vae_tile_overlap"] = vae_tile_overlap;
     }
 
+    // Video file output
+    if (!video_format.empty()) {
+        j["video_format"] = video_format;
+    }
+    if (!video_codec.empty()) {
+        j["video_codec"] = video_codec;
+    }
+    j["keep_frames"] = keep_frames;
+
     return j;
 }
 
@@ -1510,6 +1884,7 @@ UpscaleParams UpscaleParams::from_json(const nlohmann::json& j) {
 
     static const std::unordered_set<std::string> KNOWN = {
         "upscale_factor", "tile_size", "repeats", "image_base64",
+        "pass_tile_size", "tile_overlap",
         // Convenience: handle_upscale resolves job_id + image_index into
         // image_base64 BEFORE this parser sees the body, then erases both
         // keys. We still list them in KNOWN so the path is honest: direct
@@ -1518,6 +1893,7 @@ UpscaleParams UpscaleParams::from_json(const nlohmann::json& j) {
         // re-parse (queue_manager.cpp's UpscaleParams::from_json call on
         // the stored body) won't trip if anything ever leaves the keys in.
         "job_id", "image_index",
+        "output_format", "output_quality",
     };
     reject_unknown_keys("/upscale body", j, KNOWN);
 
@@ -1525,6 +1901,14 @@ UpscaleParams UpscaleParams::from_json(const nlohmann::json& j) {
     p.upscale_factor = parse_int(j, "upscale_factor", 4);
     p.tile_size = parse_int(j, "tile_size", 128);
     p.repeats = parse_int(j, "repeats", 1);
+    p.pass_tile_size = parse_int(j, "pass_tile_size", 0);
+    p.tile_overlap = parse_int(j, "tile_overlap", 16);
+    if (p.repeats < 1) throw std::runtime_error("repeats must be at least 1");
+    if (p.pass_tile_size < 0) throw std::runtime_error("pass_tile_size must be >= 0 (0 = auto)");
+    if (p.tile_overlap < 0) throw std::runtime_error("tile_overlap must be >= 0");
+    p.output_format = parse_string(j, "output_format", "");
+    p.output_quality = parse_int(j, "output_quality", -1);
+    resolve_encode_options(p.output_format, p.output_quality);
 
     // Image (required)
     if (j.contains("image_base64") && !j["image_base64"].is_null()) {
@@ -1540,13 +1924,22 @@ UpscaleParams UpscaleParams::from_json(const nlohmann::json& j) {
 }
 
 nlohmann::json UpscaleParams::to_json() const {
-    return nlohmann::json{
+    nlohmann::json j = {
         {"image_width", image_width},
         {"image_height", image_height},
         {"upscale_factor", upscale_factor},
         {"tile_size", tile_size},
-        {"repeats", repeats}
+        {"repeats", repeats},
+        {"pass_tile_size", pass_tile_size},
+        {"tile_overlap", tile_overlap}
     };
+    if (!output_format.empty()) {
+        j["output_format"] = output_format;
+    }
+    if (output_quality > 0) {
+        j["output_quality"] = output_quality;
+    }
+    return j;
 }
 
 AdetailerParams AdetailerParams::from_json(const nlohmann::json& j) {
@@ -1623,12 +2016,39 @@ nlohmann::json AdetailerParams::to_json() const {
     return j;
 }
 
+// Copy an sd.cpp result for the next pipeline stage
+static StageImage to_stage_image(const sd_image_t& image) {
+    StageImage out;
+    out.width = static_cast<int>(image.width);
+    out.height = static_cast<int>(image.height);
+    out.channels = static_cast<int>(image.channel);
+    out.data.assign(image.data, image.data + static_cast<size_t>(out.width) * out.height * out.channels);
+    return out;
+}
+
+// Move an sd.cpp result into an OutputImage. The buffer is malloc'd by
+// sd.cpp; the caller's later free_sd_images() skips the nulled slot.
+static OutputImage adopt_output_image(sd_image_t& image, const std::string& path,
+                                      const std::string& output_ref, const EncodeOptions& encode) {
+    OutputImage out;
+    out.path = path;
+    out.output_ref = output_ref;
+    out.pixels.reset(image.data);
+    out.width = static_cast<int>(image.width);
+    out.height = static_cast<int>(image.height);
+    out.channels = static_cast<int>(image.channel);
+    out.encode = encode;
+    image.data = nullptr;
+    return out;
+}
+
 std::vector<std::string> SDWrapper::run_adetailer(
     adetailer_ctx_t* adetailer_ctx,
     sd_ctx_t* sd_ctx,
     const AdetailerParams& params,
     const std::string& output_dir,
-    const std::string& job_id
+    const std::string& job_id,
+    std::vector<StageImage>* images_out
 ) {
     std::vector<std::string> outputs;
 
@@ -1643,14 +2063,15 @@ std::vector<std::string> SDWrapper::run_adetailer(
     }
 
     // Create output directory
+    const bool persist = !(images_out && job_id.empty());
     std::string job_output_dir = (fs::path(output_dir) / job_id).string();
-    utils::create_directory(job_output_dir);
+    if (persist) utils::create_directory(job_output_dir);
 
     // Persist input image alongside outputs (mirrors upscale / img2img flow)
     std::string source_filepath = (fs::path(job_output_dir) / "source.png").string();
-    if (!save_image(source_filepath,
-                    params.image_data.data(),
-                    params.image_width, params.image_height, params.image_channels)) {
+    if (persist && !save_image(source_filepath,
+                               params.image_data.data(),
+                               params.image_width, params.image_height, params.image_channels)) {
         std::cerr << "[SDWrapper] ADetailer: failed to save source image to "
                   << source_filepath << std::endl;
     }
@@ -1703,6 +2124,8 @@ std::vector<std::string> SDWrapper::run_adetailer(
     for (int i = 0; i < num_results; ++i) {
         const sd_image_t& img = result_arr[i];
         if (img.data == nullptr) continue;
+        if (images_out) images_out->push_back(to_stage_image(img));
+        if (!persist) continue;
         std::string filename = "adetailer_" + std::to_string(i) + ".png";
         std::string filepath = (fs::path(job_output_dir) / filename).string();
         if (!save_image(filepath, img.data, img.width, img.height, img.channel)) {
@@ -1720,7 +2143,9 @@ std::vector<std::string> SDWrapper::upscale_image(
     upscaler_ctx_t* upscaler_ctx,
     const UpscaleParams& params,
     const std::string& output_dir,
-    const std::string& job_id
+    const std::string& job_id,
+    OutputBatch* outputs_batch,
+    const ProgressCallback& on_pass
 ) {
     std::vector<std::string> outputs;
 
@@ -1739,38 +2164,49 @@ std::vector<std::string> SDWrapper::upscale_image(
         std::cerr << "[SDWrapper] Failed to save source image to " << source_filepath << std::endl;
     }
 
-    // Create input image structure
-    sd_image_t input_image;
-    input_image.width = params.image_width;
-    input_image.height = params.image_height;
-    input_image.channel = params.image_channels;
-    input_image.data = const_cast<uint8_t*>(params.image_data.data());
-
-    // Upscale. leejet PR #1728 changed upscale() from returning a single
-    // sd_image_t (by value, .data==null on fail) to bool + out-params (an
-    // array with count). Even for the ESRGAN case that always produces one
-    // output, the new API uses the array shape uniformly, so we take the
-    // first entry and free via free_sd_images().
-    sd_image_t* upscaled_arr = nullptr;
-    int num_upscaled = 0;
-    bool up_ok = upscale(upscaler_ctx, input_image, params.upscale_factor,
-                         &upscaled_arr, &num_upscaled);
-    if (!up_ok || upscaled_arr == nullptr || num_upscaled == 0 ||
-        upscaled_arr[0].data == nullptr) {
-        throw std::runtime_error(build_error_message("Upscaling failed"));
-    }
-    const sd_image_t& upscaled = upscaled_arr[0];
-
-    std::string filename = "upscaled.png";
+    // Large images go through upscale() in overlapping passes, each
+    // covering several of the context's tiles (tiled_upscaler.cpp)
+    TiledUpscaleOptions options;
+    options.upscale_factor = params.upscale_factor;
+    options.pass_tile = params.pass_tile_size;
+    options.overlap = params.tile_overlap;
+    options.model_tile = params.model_tile_size;
+    options.repeats = params.repeats;
+
+    int out_width = 0, out_height = 0;
+    std::vector<uint8_t> upscaled;
+    {
+        JobTimings::Span span("upscale");
+        upscaled = tiled_upscale(
+            upscaler_ctx, params.image_data.data(), params.image_width, params.image_height,
+            params.image_channels, options, out_width, out_height,
+            [&on_pass](int done, int total) {
+                if (total > 1) std::cout << "[SDWrapper] Upscale pass " << done << "/" << total << std::endl;
+                if (on_pass) on_pass(done, total);
+            });
+    }
+
+    const EncodeOptions encode = resolve_encode_options(params.output_format, params.output_quality);
+    std::string filename = "upscaled." + image_format_extension(encode.format);
     std::string filepath = (fs::path(job_output_dir) / filename).string();
 
-    if (!save_image(filepath, upscaled.data, upscaled.width, upscaled.height, upscaled.channel)) {
+    if (outputs_batch) {
+        OutputImage image;
+        image.path = filepath;
+        image.output_ref = job_id + "/" + filename;
+        image.pixels.reset(static_cast<uint8_t*>(std::malloc(upscaled.size())));
+        if (!image.pixels) throw std::bad_alloc();
+        std::memcpy(image.pixels.get(), upscaled.data(), upscaled.size());
+        image.width = out_width;
+        image.height = out_height;
+        image.channels = 3;
+        image.encode = encode;
+        outputs_batch->add(std::move(image));
+    } else if (!write_image_file(filepath, upscaled.data(), out_width, out_height, 3, encode)) {
         std::cerr << "[SDWrapper] Failed to save upscaled image to " << filepath << std::endl;
     }
     outputs.push_back(job_id + "/" + filename);
 
-    free_sd_images(upscaled_arr, num_upscaled);
-
     return outputs;
 }
 
@@ -1781,36 +2217,11 @@ std::vector<uint8_t> SDWrapper::upscale_image_data(
     int height,
     int channels,
     int& out_width,
-    int& out_height
+    int& out_height,
+    const TiledUpscaleOptions& options
 ) {
-    // Create input image structure
-    sd_image_t input_image;
-    input_image.width = width;
-    input_image.height = height;
-    input_image.channel = channels;
-    input_image.data = const_cast<uint8_t*>(image_data);
-
-    // Upscale (factor is determined by the model). Same signature swap as
-    // the file-emitting upscale path above — leejet PR #1728.
-    sd_image_t* upscaled_arr = nullptr;
-    int num_upscaled = 0;
-    bool up_ok = upscale(upscaler_ctx, input_image, 4, &upscaled_arr, &num_upscaled);
-    if (!up_ok || upscaled_arr == nullptr || num_upscaled == 0 ||
-        upscaled_arr[0].data == nullptr) {
-        throw std::runtime_error(build_error_message("Upscaling failed"));
-    }
-    const sd_image_t& upscaled = upscaled_arr[0];
-
-    out_width = upscaled.width;
-    out_height = upscaled.height;
-
-    // Copy data to vector before freeing the sd.cpp-owned buffer
-    size_t data_size = out_width * out_height * upscaled.channel;
-    std::vector<uint8_t> result(upscaled.data, upscaled.data + data_size);
-
-    free_sd_images(upscaled_arr, num_upscaled);
-
-    return result;
+    JobTimings::Span span("upscale");
+    return tiled_upscale(upscaler_ctx, image_data, width, height, channels, options, out_width, out_height);
 }
 
 std::vector<std::string> SDWrapper::generate_txt2img(
@@ -1818,14 +2229,25 @@ std::vector<std::string> SDWrapper::generate_txt2img(
     const Txt2ImgParams& params,
     const std::string& lora_dir,
     const std::string& output_dir,
-    const std::string& job_id
+    const std::string& job_id,
+    OutputBatch* outputs_batch,
+    std::vector<Txt2ImgShare>* shares,
+    std::vector<StageImage>* images_out,
+    int first_index
 ) {
     std::vector<std::string> outputs;
     sd_image_t* images = nullptr;
 
     // Create output directory
+    const bool persist = !(images_out && job_id.empty());
     std::string job_output_dir = (fs::path(output_dir) / job_id).string();
-    utils::create_directory(job_output_dir);
+    if (persist) utils::create_directory(job_output_dir);
+    if (shares) {
+        for (const auto& share : *shares) {
+            utils::create_directory((fs::path(output_dir) / share.subpath).string());
+        }
+    }
+    const EncodeOptions encode = resolve_encode_options(params.output_format, params.output_quality);
 
     // Parse LoRAs from prompt
     auto [cleaned_prompt, parsed_loras] = parse_loras_from_prompt(params.prompt, lora_dir);
@@ -1919,7 +2341,7 @@ std::vector<std::string> SDWrapper::generate_txt2img(
         // set alongside the output for multi-ref workflows (Flux Kontext
         // with several image conditions).
         for (size_t ri = 0; ri < ref_images.size(); ++ri) {
-            if (!ref_images[ri].data) continue;
+            if (!persist || !ref_images[ri].data) continue;
             std::string filename = (ri == 0) ? "source.png"
                                              : ("ref_" + std::to_string(ri) + ".png");
             std::string ref_filepath = (fs::path(job_output_dir) / filename).string();
@@ -1947,7 +2369,7 @@ std::vector<std::string> SDWrapper::generate_txt2img(
         // the file names don't collide since only one flow ever writes
         // both, and the Queue view treats them as distinct thumbnails.
         std::string control_filepath = (fs::path(job_output_dir) / "control.png").string();
-        if (!save_image(control_filepath,
+        if (persist && !save_image(control_filepath,
                         params.control_image_data.data(),
                         params.control_image_width,
                         params.control_image_height,
@@ -2028,8 +2450,16 @@ std::vector<std::string> SDWrapper::generate_txt2img(
     // Batch count still comes from gen_params.batch_count; n_out lets the lib
     // report a shorter list (e.g. hi-res-fix producing fewer frames than the
     // batch would suggest) instead of us assuming batch_count post-generation.
+    //
+    // The prompt encodes inside this call go through the conditioning
+    // cache (ConditioningScope), so a prompt seen before on this model and
+    // LoRA set skips the text encoders.
     int num_images = 0;
-    bool gen_ok = generate_image(ctx, &gen_params, &images, &num_images);
+    bool gen_ok = false;
+    {
+        ConditioningScope cond_scope(ctx, parsed_loras);
+        gen_ok = generate_image(ctx, &gen_params, &images, &num_images);
+    }
 
     if (!gen_ok || images == nullptr) {
         std::cerr << "[SDWrapper] generate_image returned false or null!" << std::endl;
@@ -2038,22 +2468,47 @@ std::vector<std::string> SDWrapper::generate_txt2img(
 
     std::cout << "[SDWrapper] generate_image returned, processing " << num_images << " images" << std::endl;
 
+    // Merged call: image i belongs to the share whose range covers it, and
+    // is numbered from 0 within that share's directory
+    size_t share_idx = 0;
+    int share_used = 0;
+
     for (int i = 0; i < num_images; i++) {
         std::cout << "[SDWrapper] Image " << i << ": "
                   << images[i].width << "x" << images[i].height << "x" << images[i].channel
                   << ", data=" << (images[i].data ? "valid" : "NULL") << std::endl;
 
-        if (images[i].data) {
-            std::string filename = "output_" + std::to_string(i) + ".png";
-            std::string filepath = (fs::path(job_output_dir) / filename).string();
+        Txt2ImgShare* share = nullptr;
+        int index = first_index + i;
+        if (shares) {
+            while (share_idx < shares->size() && share_used >= (*shares)[share_idx].images) {
+                ++share_idx;
+                share_used = 0;
+            }
+            if (share_idx == shares->size()) break;  // more images than requested
+            share = &(*shares)[share_idx];
+            index = share_used++;
+        }
 
-            if (!save_image(filepath, images[i].data,
-                      images[i].width, images[i].height, images[i].channel)) {
+        if (images[i].data && images_out) {
+            images_out->push_back(to_stage_image(images[i]));
+        }
+        if (images[i].data && persist) {
+            const std::string& subpath = share ? share->subpath : job_id;
+            OutputBatch* batch = share ? share->outputs_batch : outputs_batch;
+            std::string filename = "output_" + std::to_string(index) + "." + image_format_extension(encode.format);
+            std::string filepath = (fs::path(output_dir) / subpath / filename).string();
+
+            if (batch) {
+                batch->add(adopt_output_image(images[i], filepath, subpath + "/" + filename, encode));
+            } else if (!write_image_file(filepath, images[i].data,
+                      images[i].width, images[i].height, images[i].channel, encode)) {
                 std::cerr << "[SDWrapper] Failed to save image " << i << " to " << filepath << std::endl;
             }
 
             // Return relative path
-            outputs.push_back(job_id + "/" + filename);
+            outputs.push_back(subpath + "/" + filename);
+            if (share) share->outputs.push_back(outputs.back());
         }
     }
     // free_sd_images() (new helper) handles both the per-image data buffers
@@ -2061,7 +2516,7 @@ std::vector<std::string> SDWrapper::generate_txt2img(
     free_sd_images(images, num_images);
 
     // Check if any images were successfully generated
-    if (outputs.empty()) {
+    if (outputs.empty() && (!images_out || images_out->empty())) {
         throw std::runtime_error(build_error_message("Image generation failed - no valid images produced"));
     }
 
@@ -2073,7 +2528,10 @@ std::vector<std::string> SDWrapper::generate_img2img(
     const Img2ImgParams& params,
     const std::string& lora_dir,
     const std::string& output_dir,
-    const std::string& job_id
+    const std::string& job_id,
+    OutputBatch* outputs_batch,
+    std::vector<StageImage>* images_out,
+    int first_index
 ) {
     std::vector<std::string> outputs;
 
@@ -2082,13 +2540,15 @@ std::vector<std::string> SDWrapper::generate_img2img(
     }
 
     // Create output directory
+    const bool persist = !(images_out && job_id.empty());
     std::string job_output_dir = (fs::path(output_dir) / job_id).string();
-    utils::create_directory(job_output_dir);
+    if (persist) utils::create_directory(job_output_dir);
+    const EncodeOptions encode = resolve_encode_options(params.output_format, params.output_quality);
 
     // Save source image for reference
     std::string source_filename = "source.png";
     std::string source_filepath = (fs::path(job_output_dir) / source_filename).string();
-    if (!save_image(source_filepath, params.init_image_data.data(), params.init_image_width, params.init_image_height, params.init_image_channels)) {
+    if (persist && !save_image(source_filepath, params.init_image_data.data(), params.init_image_width, params.init_image_height, params.init_image_channels)) {
         std::cerr << "[SDWrapper] Failed to save source image to " << source_filepath << std::endl;
     }
 
@@ -2255,7 +2715,7 @@ std::vector<std::string> SDWrapper::generate_img2img(
         // can render it as a job thumbnail and Reload can restore the
         // widget without needing the base64 payload in the snapshot.
         std::string mask_filepath = (fs::path(job_output_dir) / "mask.png").string();
-        if (!save_image(mask_filepath, mask_ptr, mask_width, mask_height, 1)) {
+        if (persist && !save_image(mask_filepath, mask_ptr, mask_width, mask_height, 1)) {
             std::cerr << "[SDWrapper] Failed to save mask image to " << mask_filepath << std::endl;
         }
     } else {
@@ -2305,7 +2765,7 @@ std::vector<std::string> SDWrapper::generate_img2img(
         // the file names don't collide since only one flow ever writes
         // both, and the Queue view treats them as distinct thumbnails.
         std::string control_filepath = (fs::path(job_output_dir) / "control.png").string();
-        if (!save_image(control_filepath,
+        if (persist && !save_image(control_filepath,
                         params.control_image_data.data(),
                         params.control_image_width,
                         params.control_image_height,
@@ -2376,19 +2836,29 @@ std::vector<std::string> SDWrapper::generate_img2img(
     // path above for the rationale (leejet PR #1728: bool return + out-params).
     sd_image_t* images = nullptr;
     int num_images = 0;
-    bool gen_ok = generate_image(ctx, &gen_params, &images, &num_images);
+    bool gen_ok = false;
+    {
+        ConditioningScope cond_scope(ctx, parsed_loras);
+        gen_ok = generate_image(ctx, &gen_params, &images, &num_images);
+    }
 
     if (!gen_ok || images == nullptr) {
         throw std::runtime_error(build_error_message("Image generation failed"));
     }
 
     for (int i = 0; i < num_images; i++) {
-        if (images[i].data) {
-            std::string filename = "output_" + std::to_string(i) + ".png";
+        if (images[i].data && images_out) {
+            images_out->push_back(to_stage_image(images[i]));
+        }
+        if (images[i].data && persist) {
+            std::string filename = "output_" + std::to_string(first_index + i) + "." +
+                                   image_format_extension(encode.format);
             std::string filepath = (fs::path(job_output_dir) / filename).string();
 
-            if (!save_image(filepath, images[i].data,
-                      images[i].width, images[i].height, images[i].channel)) {
+            if (outputs_batch) {
+                outputs_batch->add(adopt_output_image(images[i], filepath, job_id + "/" + filename, encode));
+            } else if (!write_image_file(filepath, images[i].data,
+                      images[i].width, images[i].height, images[i].channel, encode)) {
                 std::cerr << "[SDWrapper] Failed to save image " << i << " to " << filepath << std::endl;
             }
 
@@ -2398,7 +2868,7 @@ std::vector<std::string> SDWrapper::generate_img2img(
     free_sd_images(images, num_images);
 
     // Check if any images were successfully generated
-    if (outputs.empty()) {
+    if (outputs.empty() && (!images_out || images_out->empty())) {
         throw std::runtime_error(build_error_message("Image generation failed - no valid images produced"));
     }
 
@@ -2410,7 +2880,8 @@ std::vector<std::string> SDWrapper::generate_txt2vid(
     const Txt2VidParams& params,
     const std::string& lora_dir,
     const std::string& output_dir,
-    const std::string& job_id
+    const std::string& job_id,
+    ThumbnailCache* thumbnails
 ) {
     std::vector<std::string> outputs;
 
@@ -2610,7 +3081,11 @@ std::vector<std::string> SDWrapper::generate_txt2vid(
     int num_frames = 0;
     sd_image_t* frames = nullptr;
     sd_audio_t* audio_out = nullptr;
-    bool video_ok = generate_video(ctx, &vid_params, &frames, &num_frames, &audio_out);
+    bool video_ok = false;
+    {
+        ConditioningScope cond_scope(ctx, parsed_loras);
+        video_ok = generate_video(ctx, &vid_params, &frames, &num_frames, &audio_out);
+    }
 
     if (!video_ok || frames == nullptr) {
         if (audio_out) {
@@ -2619,33 +3094,116 @@ std::vector<std::string> SDWrapper::generate_txt2vid(
         throw std::runtime_error(build_error_message("Video generation failed"));
     }
 
-    for (int i = 0; i < num_frames; i++) {
+    // Poster + preview strip while the frames are still in memory, so the
+    // queue UI never has to decode full-size frames to show the job
+    if (thumbnails && num_frames > 0) {
+        std::vector<FrameView> views;
+        views.reserve(num_frames);
+        for (int i = 0; i < num_frames; i++) {
+            views.push_back({frames[i].data, static_cast<int>(frames[i].width),
+                             static_cast<int>(frames[i].height), static_cast<int>(frames[i].channel)});
+        }
+        try {
+            if (!thumbnails->generate_video_previews(job_output_dir, views)) {
+                std::cerr << "[SDWrapper] Failed to write video poster for " << job_id << std::endl;
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "[SDWrapper] Video previews failed: " << e.what() << std::endl;
+        }
+    }
+
+    // Encode the video file in one pass over the decoded frames. Each frame
+    // is freed as soon as it has been encoded (and written as PNG when the
+    // frames are kept), so peak memory doesn't grow with a second copy.
+    const auto video_options = resolve_video_options(params.video_format, params.video_codec, params.fps);
+    std::unique_ptr<VideoWriter> writer;
+    std::string video_output;
+    int video_width = 0, video_height = 0;
+    for (int i = 0; i < num_frames && video_width == 0; i++) {
         if (frames[i].data) {
-            char filename[64];
-            snprintf(filename, sizeof(filename), "frame_%04d.png", i);
-            std::string filepath = (fs::path(job_output_dir) / filename).string();
+            video_width = static_cast<int>(frames[i].width);
+            video_height = static_cast<int>(frames[i].height);
+        }
+    }
+    if (video_options && video_width > 0) {
+        const std::string name = "video." + video_container_to_string(video_options->container);
+        AudioTrack track;
+        if (audio_out) {
+            track.samples = audio_out->data;
+            track.sample_count = audio_out->sample_count;
+            track.channels = static_cast<int>(audio_out->channels);
+            track.sample_rate = static_cast<int>(audio_out->sample_rate);
+        }
+        try {
+            writer = VideoWriter::open((fs::path(job_output_dir) / name).string(),
+                                       video_width, video_height, *video_options,
+                                       audio_out ? &track : nullptr);
+            video_output = job_id + "/" + name;
+        } catch (const std::exception& e) {
+            std::cerr << "[SDWrapper] Cannot start video encoder: " << e.what() << std::endl;
+        }
+    }
+    // Without a video file the frames are the only output, whatever was asked
+    const bool write_frames = params.keep_frames || !writer;
 
-            if (!save_image(filepath, frames[i].data,
-                      frames[i].width, frames[i].height, frames[i].channel)) {
-                std::cerr << "[SDWrapper] Failed to save frame " << i << " to " << filepath << std::endl;
+    for (int i = 0; i < num_frames; i++) {
+        if (frames[i].data) {
+            if (writer && static_cast<int>(frames[i].width) == video_width
+                       && static_cast<int>(frames[i].height) == video_height) {
+                try {
+                    writer->add_frame(frames[i].data, static_cast<int>(frames[i].channel));
+                } catch (const std::exception& e) {
+                    std::cerr << "[SDWrapper] Video encoding failed at frame " << i << ": " << e.what() << std::endl;
+                    writer.reset();
+                    video_output.clear();
+                    // Earlier frames are gone with the abandoned file
+                    // unless they were kept; save the rest as PNGs
+                }
             }
 
-            outputs.push_back(job_id + "/" + std::string(filename));
+            if (write_frames || !writer) {
+                char filename[64];
+                snprintf(filename, sizeof(filename), "frame_%04d.png", i);
+                std::string filepath = (fs::path(job_output_dir) / filename).string();
+
+                if (!save_image(filepath, frames[i].data,
+                          frames[i].width, frames[i].height, frames[i].channel)) {
+                    std::cerr << "[SDWrapper] Failed to save frame " << i << " to " << filepath << std::endl;
+                }
 
-            free(frames[i].data);
+                outputs.push_back(job_id + "/" + std::string(filename));
+            }
         }
+        free(frames[i].data);
+        frames[i].data = nullptr;
     }
     free(frames);
 
+    bool audio_muxed = false;
+    if (writer) {
+        try {
+            writer->finish();
+            audio_muxed = writer->muxed_audio();
+            outputs.push_back(video_output);
+            std::cout << "[SDWrapper] Encoded " << video_output << " (" << writer->encoder()
+                      << (audio_muxed ? ", with audio" : "") << ")" << std::endl;
+        } catch (const std::exception& e) {
+            std::cerr << "[SDWrapper] Failed to finalize video: " << e.what() << std::endl;
+        }
+        writer.reset();
+    }
+
     // LTXAV (and any future audio-VAE models) populate audio_out alongside the
-    // frames. Save it as a sibling audio.wav so callers can mux it back with
-    // the frame sequence. The non-audio path leaves audio_out null and skips this.
+    // frames. It is muxed into MP4/WebM when possible; a sibling audio.wav is
+    // still written when it wasn't, or when the raw frames are kept too.
     if (audio_out != nullptr) {
-        std::string audio_path = (fs::path(job_output_dir) / "audio.wav").string();
-        if (save_audio_wav(audio_path, audio_out)) {
-            outputs.push_back(job_id + "/audio.wav");
-        } else {
-            std::cerr << "[SDWrapper] Failed to save audio to " << audio_path << std::endl;
+        if (!audio_muxed || params.keep_frames) {
+            std::string audio_path = (fs::path(job_output_dir) / "audio.wav").string();
+            if (save_audio_wav(audio_path, audio_out)) {
+                outputs.push_back(job_id + "/audio.wav");
+            } else {
+                std::cerr << "[SDWrapper] Failed to save audio to " << audio_path << std::endl;
+            }
         }
         free_sd_audio(audio_out);
     }
@@ -2682,23 +3240,9 @@ std::vector<uint8_t> SDWrapper::decode_base64_image(
     int& height,
     int& channels
 ) {
-    // Decode base64
-    std::vector<uint8_t> binary = utils::base64_decode(base64_data);
-
-    // Load image from memory
-    uint8_t* data = stbi_load_from_memory(
-        binary.data(), static_cast<int>(binary.size()),
-        &width, &height, &channels, 3
-    );
-
-    if (!data) {
-        throw std::runtime_error("Failed to decode base64 image");
-    }
-
+    // Base64 file bytes, or an "output:" reference to an uploaded / earlier output file
+    std::vector<uint8_t> result = decode_image_input(base64_data, width, height);
     channels = 3;
-    std::vector<uint8_t> result(data, data + (width * height * channels));
-    stbi_image_free(data);
-
     return result;
 }
 
@@ -2709,6 +3253,8 @@ bool SDWrapper::save_image(
     int height,
     int channels
 ) {
+    JobTrace::Span span("save_image", "output");
+
     // Validate parameters
     if (data == nullptr) {
         std::cerr << "[SDWrapper] save_image: data is null!" << std::endl;
@@ -2726,21 +3272,22 @@ bool SDWrapper::save_image(
 
     std::string ext = utils::get_file_extension(filepath);
 
-    int result = 0;
-    if (ext == "png") {
-        result = stbi_write_png(filepath.c_str(), width, height, channels, data, 0);
-    } else if (ext == "jpg" || ext == "jpeg") {
-        result = stbi_write_jpg(filepath.c_str(), width, height, channels, data, 90);
+    // Format follows the extension (default PNG); level/quality from config
+    EncodeOptions options = default_encode_options();
+    if (ext == "jpg" || ext == "jpeg") {
+        options = resolve_encode_options("jpeg", -1);
+    } else if (ext == "webp" && image_format_available(ImageFormat::Webp)) {
+        options = resolve_encode_options("webp", -1);
     } else {
-        // Default to PNG
-        result = stbi_write_png(filepath.c_str(), width, height, channels, data, 0);
+        options.format = ImageFormat::Png;
     }
 
-    if (result == 0) {
+    bool ok = write_image_file(filepath, data, width, height, channels, options);
+    if (!ok) {
         std::cerr << "[SDWrapper] save_image: failed to write " << filepath << std::endl;
     }
 
-    return result != 0;
+    return ok;
 }
 
 bool SDWrapper::convert_model(
@@ -0,0 +1,121 @@
+#include "startup_status.hpp"
+
+#include <iostream>
+
+namespace sdcpp {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double ms_between(Clock::time_point from, Clock::time_point to) {
+    return std::chrono::duration<double, std::milli>(to - from).count();
+}
+
+} // namespace
+
+StartupStatus::StartupStatus() : created_(Clock::now()) {}
+
+void StartupStatus::add(const std::string& stage, bool gates_ready) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (find_locked(stage)) return;
+    Stage s;
+    s.name = stage;
+    s.gates_ready = gates_ready;
+    stages_.push_back(std::move(s));
+}
+
+StartupStatus::Stage* StartupStatus::find_locked(const std::string& stage) {
+    for (auto& s : stages_) {
+        if (s.name == stage) return &s;
+    }
+    return nullptr;
+}
+
+void StartupStatus::begin(const std::string& stage) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (Stage* s = find_locked(stage)) {
+        s->state = State::Running;
+        s->started = Clock::now();
+    }
+}
+
+void StartupStatus::finish(const std::string& stage, State state, const std::string& note) {
+    double ms = 0.0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Stage* s = find_locked(stage);
+        if (!s) return;
+        s->finished = Clock::now();
+        if (s->state == State::Pending) s->started = s->finished;
+        s->state = state;
+        s->note = note;
+        ms = ms_between(s->started, s->finished);
+    }
+    if (state == State::Failed) {
+        std::cerr << "[Startup] " << stage << " failed after " << static_cast<int>(ms) << " ms: "
+                  << note << std::endl;
+    } else {
+        std::cout << "[Startup] " << stage << (state == State::Skipped ? " skipped" : " ready")
+                  << " (" << static_cast<int>(ms) << " ms" << (note.empty() ? "" : ", " + note) << ")"
+                  << std::endl;
+    }
+}
+
+void StartupStatus::done(const std::string& stage, const std::string& note) {
+    finish(stage, State::Done, note);
+}
+
+void StartupStatus::skip(const std::string& stage, const std::string& note) {
+    finish(stage, State::Skipped, note);
+}
+
+void StartupStatus::fail(const std::string& stage, const std::string& error) {
+    finish(stage, State::Failed, error);
+}
+
+void StartupStatus::run(const std::string& stage, const std::function<void()>& fn) {
+    begin(stage);
+    try {
+        fn();
+    } catch (const std::exception& e) {
+        fail(stage, e.what());
+        return;
+    }
+    done(stage);
+}
+
+bool StartupStatus::ready() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& s : stages_) {
+        if (s.gates_ready && s.state != State::Done && s.state != State::Skipped) return false;
+    }
+    return true;
+}
+
+nlohmann::json StartupStatus::to_json() const {
+    static const char* const NAMES[] = {"pending", "running", "done", "skipped", "failed"};
+    const auto now = Clock::now();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    bool ready = true;
+    nlohmann::json stages = nlohmann::json::array();
+    for (const auto& s : stages_) {
+        const bool finished = s.state == State::Done || s.state == State::Skipped || s.state == State::Failed;
+        if (s.gates_ready && s.state != State::Done && s.state != State::Skipped) ready = false;
+        nlohmann::json j = {
+            {"name", s.name},
+            {"state", NAMES[static_cast<int>(s.state)]},
+            {"gates_ready", s.gates_ready},
+            {"started_ms", s.state == State::Pending ? nlohmann::json(nullptr)
+                                                     : nlohmann::json(ms_between(created_, s.started))},
+            {"duration_ms", s.state == State::Pending ? nlohmann::json(nullptr)
+                                                      : nlohmann::json(ms_between(s.started, finished ? s.finished : now))}
+        };
+        if (!s.note.empty()) j["note"] = s.note;
+        stages.push_back(std::move(j));
+    }
+    return {{"ready", ready}, {"uptime_ms", ms_between(created_, now)}, {"stages", stages}};
+}
+
+} // namespace sdcpp
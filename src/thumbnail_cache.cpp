@@ -0,0 +1,439 @@
+#include "thumbnail_cache.hpp"
+#include "image_resize.hpp"
+#include "utils.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+namespace sdcpp {
+
+namespace {
+
+int64_t to_unix_seconds(fs::file_time_type t) {
+    auto sys = std::chrono::file_clock::to_sys(t);
+    return std::chrono::duration_cast<std::chrono::seconds>(sys.time_since_epoch()).count();
+}
+
+std::string http_date(int64_t unix_seconds) {
+    std::time_t t = static_cast<std::time_t>(unix_seconds);
+    std::tm tm{};
+#ifdef _WIN32
+    gmtime_s(&tm, &t);
+#else
+    gmtime_r(&t, &tm);
+#endif
+    char buf[64];
+    std::strftime(buf, sizeof(buf), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+    return buf;
+}
+
+bool read_file(const std::string& path, std::vector<uint8_t>& out) {
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in) return false;
+    auto size = in.tellg();
+    if (size <= 0) return false;
+    out.resize(static_cast<size_t>(size));
+    in.seekg(0);
+    in.read(reinterpret_cast<char*>(out.data()), size);
+    return static_cast<bool>(in);
+}
+
+// Write via a temp file so a concurrent reader never sees half a JPEG
+bool write_file_atomic(const std::string& path, const std::vector<uint8_t>& data) {
+    std::string tmp = path + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        if (!out) return false;
+        out.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+        if (!out) return false;
+    }
+    std::error_code ec;
+    fs::rename(tmp, path, ec);
+    if (ec) {
+        fs::remove(tmp, ec);
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+ThumbnailCache::ThumbnailCache(const ThumbnailConfig& config)
+    : sizes_(config.sizes),
+      memory_budget_(static_cast<size_t>(std::max(0, config.memory_cache_mb)) * 1024 * 1024) {
+    std::sort(sizes_.begin(), sizes_.end());
+    sizes_.erase(std::unique(sizes_.begin(), sizes_.end()), sizes_.end());
+    if (sizes_.empty()) sizes_.push_back(utils::THUMBNAIL_SIZE);
+    if (sizes_.size() > 32) sizes_.resize(32);  // on_disk is a 32-bit mask
+
+    encode_.format = image_format_from_string(config.format);
+    encode_.quality = config.quality;
+    extension_ = image_format_extension(encode_.format);
+    mime_ = encode_.format == ImageFormat::Webp ? "image/webp" : "image/jpeg";
+
+    // Each render decodes a full-size image single-threaded; a few at a time
+    // keeps the CPU for generation instead of for a burst of gallery views
+    unsigned hw = std::thread::hardware_concurrency();
+    max_renders_ = std::clamp(static_cast<int>(hw / 2), 1, 4);
+}
+
+int ThumbnailCache::resolve_size(int requested) const {
+    if (requested <= 0) {
+        return size_index(utils::THUMBNAIL_SIZE) >= 0 ? utils::THUMBNAIL_SIZE : sizes_.front();
+    }
+    for (int size : sizes_) {
+        if (size >= requested) return size;
+    }
+    return sizes_.back();
+}
+
+int ThumbnailCache::size_index(int size) const {
+    auto it = std::find(sizes_.begin(), sizes_.end(), size);
+    return it == sizes_.end() ? -1 : static_cast<int>(it - sizes_.begin());
+}
+
+std::string ThumbnailCache::normalize(const std::string& path) {
+    return fs::path(path).lexically_normal().string();
+}
+
+std::string ThumbnailCache::memory_key(const std::string& source, int size) {
+    return source + "#" + std::to_string(size);
+}
+
+std::string ThumbnailCache::path_for(const std::string& source, int size) const {
+    return utils::thumbnail_path(source, size, extension_);
+}
+
+std::shared_ptr<Thumbnail> ThumbnailCache::make_thumbnail(std::vector<uint8_t>&& data,
+                                                          const SourceInfo& info, int size) const {
+    auto thumb = std::make_shared<Thumbnail>();
+    thumb->data = std::move(data);
+    thumb->mime = mime_;
+    thumb->etag = "\"t" + std::to_string(size) + "-" + std::to_string(info.size) + "-"
+                + std::to_string(info.mtime) + "\"";
+    thumb->last_modified = http_date(info.mtime);
+    return thumb;
+}
+
+uint32_t ThumbnailCache::render(const std::string& source, const uint8_t* pixels, int width, int height,
+                                int channels, const SourceInfo& info,
+                                std::vector<std::shared_ptr<const Thumbnail>>& out) {
+    out.assign(sizes_.size(), nullptr);
+    uint32_t written = 0;
+
+    std::error_code ec;
+    fs::create_directories(fs::path(path_for(source, sizes_.back())).parent_path(), ec);
+
+    // Crop and downscale the source once, to the largest size; the smaller
+    // ones are resampled from that square instead of the full frame
+    const int largest = sizes_.back();
+    std::vector<uint8_t> square = make_square_thumbnail(pixels, width, height, channels, largest);
+
+    for (size_t i = sizes_.size(); i-- > 0;) {
+        const int size = sizes_[i];
+        try {
+            std::vector<uint8_t> scaled;
+            const uint8_t* src = square.data();
+            if (size != largest) {
+                scaled = resize_image(square.data(), largest, largest, channels, size, size, ResizeFilter::Area);
+                src = scaled.data();
+            }
+            std::vector<uint8_t> encoded = encode_image(src, size, size, channels, encode_);
+            if (write_file_atomic(path_for(source, size), encoded)) {
+                written |= 1u << i;
+            } else {
+                std::cerr << "[ThumbnailCache] Cannot write " << path_for(source, size) << std::endl;
+            }
+            out[i] = make_thumbnail(std::move(encoded), info, size);
+        } catch (const std::exception& e) {
+            std::cerr << "[ThumbnailCache] " << size << "px thumbnail for " << source
+                      << " failed: " << e.what() << std::endl;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < sizes_.size(); ++i) {
+        if (out[i]) insert_memory_locked(memory_key(source, sizes_[i]), out[i]);
+    }
+    return written;
+}
+
+int ThumbnailCache::generate(const std::string& source_path, const uint8_t* pixels,
+                             int width, int height, int channels) {
+    const std::string source = normalize(source_path);
+
+    // One stat now, while the file is hot, so later hits need none
+    std::error_code ec;
+    SourceInfo info;
+    info.size = fs::file_size(source, ec);
+    if (ec) return 0;
+    auto mtime = fs::last_write_time(source, ec);
+    if (ec) return 0;
+    info.mtime = to_unix_seconds(mtime);
+
+    std::vector<std::shared_ptr<const Thumbnail>> rendered;
+    info.on_disk = render(source, pixels, width, height, channels, info, rendered);
+    remember(source, info);
+
+    int count = std::popcount(info.on_disk);
+    generated_ += static_cast<uint64_t>(count);
+    return count;
+}
+
+bool ThumbnailCache::generate_video_previews(const std::string& dir, const std::vector<FrameView>& frames) {
+    std::vector<const FrameView*> valid;
+    for (const auto& frame : frames) {
+        if (frame.pixels && frame.width > 0 && frame.height > 0) valid.push_back(&frame);
+    }
+    if (valid.empty()) return false;
+
+    EncodeOptions jpeg;
+    jpeg.format = ImageFormat::Jpeg;
+    jpeg.quality = encode_.quality;
+
+    // Middle frame: the first ones are often a fade-in or still settling
+    const FrameView& poster = *valid[valid.size() / 2];
+    const std::string poster_path = (fs::path(dir) / VIDEO_POSTER_NAME).string();
+    if (!write_image_file(poster_path, poster.pixels, poster.width, poster.height, poster.channels, jpeg)) {
+        return false;
+    }
+    generate(poster_path, poster.pixels, poster.width, poster.height, poster.channels);
+
+    // Sprite of evenly spaced frames; all tiles share the sprite's channel
+    // count, so frames that differ from the first are skipped
+    const int tile = resolve_size(0);
+    const int channels = valid.front()->channels;
+    const int count = std::min<int>(VIDEO_PREVIEW_FRAMES, static_cast<int>(valid.size()));
+    std::vector<uint8_t> strip(static_cast<size_t>(tile) * count * tile * channels, 0);
+    const size_t strip_stride = static_cast<size_t>(tile) * count * channels;
+    for (int i = 0; i < count; ++i) {
+        const FrameView& frame = *valid[static_cast<size_t>(i) * valid.size() / count];
+        if (frame.channels != channels) continue;
+        std::vector<uint8_t> square = make_square_thumbnail(frame.pixels, frame.width, frame.height, channels, tile);
+        const size_t tile_stride = static_cast<size_t>(tile) * channels;
+        for (int y = 0; y < tile; ++y) {
+            std::copy_n(square.data() + y * tile_stride, tile_stride,
+                        strip.data() + y * strip_stride + i * tile_stride);
+        }
+    }
+    const std::string preview_path = (fs::path(dir) / VIDEO_PREVIEW_NAME).string();
+    if (!write_image_file(preview_path, strip.data(), tile * count, tile, channels, jpeg)) {
+        std::cerr << "[ThumbnailCache] Cannot write video preview " << preview_path << std::endl;
+    }
+    return true;
+}
+
+std::shared_ptr<const Thumbnail> ThumbnailCache::load_from_disk(const std::string& source, int size,
+                                                                const SourceInfo& info) {
+    std::vector<uint8_t> data;
+    if (!read_file(path_for(source, size), data)) return nullptr;
+    std::shared_ptr<const Thumbnail> thumb = make_thumbnail(std::move(data), info, size);
+    std::lock_guard<std::mutex> lock(mutex_);
+    insert_memory_locked(memory_key(source, size), thumb);
+    return thumb;
+}
+
+ThumbnailCache::Result ThumbnailCache::get(const std::string& source_path, int size) {
+    const std::string source = normalize(source_path);
+    int index = size_index(size);
+    if (index < 0) {
+        size = resolve_size(size);
+        index = size_index(size);
+    }
+    const uint32_t bit = 1u << index;
+    const std::string key = memory_key(source, size);
+
+    // 1-2. Memory, then manifest: no filesystem metadata calls
+    SourceInfo info;
+    bool known = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (auto thumb = find_memory_locked(key)) {
+            memory_hits_++;
+            return {Status::Ok, thumb};
+        }
+        auto it = manifest_.find(source);
+        if (it != manifest_.end() && (it->second.on_disk & bit)) {
+            info = it->second;
+            known = true;
+        }
+    }
+    if (known) {
+        if (auto thumb = load_from_disk(source, size, info)) {
+            disk_hits_++;
+            return {Status::Ok, thumb};
+        }
+        // Thumbnail removed behind our back; revalidate from scratch
+        invalidate(source);
+    }
+
+    // 3. Filesystem: stat the source and any existing thumbnails once
+    std::error_code ec;
+    if (!fs::is_regular_file(source, ec)) {
+        return {Status::NotFound, nullptr};
+    }
+    info = SourceInfo{};
+    info.size = fs::file_size(source, ec);
+    if (ec) return {Status::NotFound, nullptr};
+    auto mtime = fs::last_write_time(source, ec);
+    if (ec) return {Status::NotFound, nullptr};
+    info.mtime = to_unix_seconds(mtime);
+    for (size_t i = 0; i < sizes_.size(); ++i) {
+        auto thumb_time = fs::last_write_time(path_for(source, sizes_[i]), ec);
+        if (!ec && thumb_time >= mtime) info.on_disk |= 1u << i;
+    }
+    if (info.on_disk & bit) {
+        remember(source, info);
+        if (auto thumb = load_from_disk(source, size, info)) {
+            disk_hits_++;
+            return {Status::Ok, thumb};
+        }
+        info.on_disk &= ~bit;
+    }
+
+    // Render: one per source, at most max_renders_ at a time
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (rendering_.count(source)) {
+            render_waits_++;
+            render_cv_.wait(lock, [&] { return rendering_.count(source) == 0; });
+            if (auto thumb = find_memory_locked(key)) {
+                return {Status::Ok, thumb};
+            }
+            auto it = manifest_.find(source);
+            if (it == manifest_.end() || !(it->second.on_disk & bit)) {
+                return {Status::Failed, nullptr};
+            }
+            info = it->second;
+            lock.unlock();
+            auto thumb = load_from_disk(source, size, info);
+            return {thumb ? Status::Ok : Status::Failed, thumb};
+        }
+        rendering_.insert(source);
+        render_cv_.wait(lock, [this] { return active_renders_ < max_renders_; });
+        active_renders_++;
+    }
+
+    Result result;
+    try {
+        int width = 0, height = 0;
+        std::vector<uint8_t> pixels = load_image_file_rgb(source, width, height);
+        if (!pixels.empty()) {
+            renders_++;
+            std::vector<std::shared_ptr<const Thumbnail>> rendered;
+            info.on_disk |= render(source, pixels.data(), width, height, 3, info, rendered);
+            remember(source, info);
+            if (rendered[index]) {
+                result = {Status::Ok, rendered[index]};
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "[ThumbnailCache] Cannot render " << source << ": " << e.what() << std::endl;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        rendering_.erase(source);
+        active_renders_--;
+    }
+    render_cv_.notify_all();
+    return result;
+}
+
+void ThumbnailCache::remember(const std::string& source, const SourceInfo& info) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    manifest_[source] = info;
+}
+
+void ThumbnailCache::invalidate(const std::string& path) {
+    const std::string prefix = normalize(path);
+    // "<prefix>" itself, "<prefix>#<size>" and anything under "<prefix>/"
+    auto covers = [&](const std::string& key) {
+        if (key.compare(0, prefix.size(), prefix) != 0) return false;
+        if (key.size() == prefix.size()) return true;
+        char next = key[prefix.size()];
+        return next == '#' || next == '/' || prefix.back() == '/';
+    };
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto it = manifest_.begin(); it != manifest_.end();) {
+        it = covers(it->first) ? manifest_.erase(it) : std::next(it);
+    }
+    for (auto it = memory_.begin(); it != memory_.end();) {
+        if (covers(it->first)) {
+            memory_bytes_ -= it->second.thumbnail->data.size();
+            lru_.erase(it->second.lru_it);
+            it = memory_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+std::vector<std::string> ThumbnailCache::thumbnail_files(const std::string& source_path) const {
+    std::vector<std::string> files;
+    files.reserve(sizes_.size());
+    for (int size : sizes_) files.push_back(path_for(source_path, size));
+    return files;
+}
+
+void ThumbnailCache::insert_memory_locked(const std::string& key, std::shared_ptr<const Thumbnail> thumbnail) {
+    const size_t bytes = thumbnail->data.size();
+    if (bytes > memory_budget_) return;
+
+    auto existing = memory_.find(key);
+    if (existing != memory_.end()) {
+        memory_bytes_ -= existing->second.thumbnail->data.size();
+        lru_.erase(existing->second.lru_it);
+        memory_.erase(existing);
+    }
+    while (memory_bytes_ + bytes > memory_budget_ && !lru_.empty()) {
+        auto victim = memory_.find(lru_.back());
+        memory_bytes_ -= victim->second.thumbnail->data.size();
+        memory_.erase(victim);
+        lru_.pop_back();
+    }
+    lru_.push_front(key);
+    memory_.emplace(key, MemoryEntry{std::move(thumbnail), lru_.begin()});
+    memory_bytes_ += bytes;
+}
+
+std::shared_ptr<const Thumbnail> ThumbnailCache::find_memory_locked(const std::string& key) {
+    auto it = memory_.find(key);
+    if (it == memory_.end()) return nullptr;
+    lru_.splice(lru_.begin(), lru_, it->second.lru_it);
+    return it->second.thumbnail;
+}
+
+nlohmann::json ThumbnailCache::stats_json() const {
+    size_t entries, bytes, manifest;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        entries = memory_.size();
+        bytes = memory_bytes_;
+        manifest = manifest_.size();
+    }
+    return {
+        {"sizes", sizes_},
+        {"format", image_format_to_string(encode_.format)},
+        {"memory_entries", entries},
+        {"memory_bytes", bytes},
+        {"memory_budget_bytes", memory_budget_},
+        {"manifest_entries", manifest},
+        {"memory_hits", memory_hits_.load()},
+        {"disk_hits", disk_hits_.load()},
+        {"renders", renders_.load()},
+        {"render_waits", render_waits_.load()},
+        {"generated", generated_.load()}
+    };
+}
+
+} // namespace sdcpp
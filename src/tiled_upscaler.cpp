@@ -0,0 +1,242 @@
+#include "tiled_upscaler.hpp"
+#include "sd_error_capture.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <future>
+#include <stdexcept>
+#include <string>
+
+namespace sdcpp {
+
+namespace {
+
+// Rough peak VRAM per model-tile pixel for a 4x RRDB ESRGAN: 64-channel
+// activations at 4x resolution plus the im2col buffers of the upsampling
+// convolutions
+constexpr uint64_t ESRGAN_BYTES_PER_TILE_PIXEL = 48 * 1024;
+
+// Keep one pass' host-side buffers (sd.cpp converts input and output to
+// float) well below the image itself
+constexpr int MAX_PASS_TILE = 1024;
+
+using PassProgress = std::function<void(int done, int total)>;
+
+struct Rect {
+    int x = 0, y = 0, w = 0, h = 0;
+    int overlap_left = 0;   // Source pixels shared with the pass to the left
+    int overlap_top = 0;    // ...and with the row above
+};
+
+struct Pixels {
+    std::vector<uint8_t> data;
+    int width = 0;
+    int height = 0;
+    int channels = 3;
+};
+
+std::string upscale_error() {
+    std::string sd_error = get_sd_error();
+    return sd_error.empty() ? "Upscaling failed" : "Upscaling failed: " + sd_error;
+}
+
+Pixels run_pass(upscaler_ctx_t* ctx, const uint8_t* data, int width, int height, int channels, int factor) {
+    sd_image_t input;
+    input.width = width;
+    input.height = height;
+    input.channel = channels;
+    input.data = const_cast<uint8_t*>(data);
+
+    sd_image_t* upscaled = nullptr;
+    int count = 0;
+    if (!upscale(ctx, input, factor, &upscaled, &count) || !upscaled || count == 0 || !upscaled[0].data) {
+        if (upscaled) free_sd_images(upscaled, count);
+        throw std::runtime_error(upscale_error());
+    }
+    Pixels out;
+    out.width = upscaled[0].width;
+    out.height = upscaled[0].height;
+    out.channels = upscaled[0].channel;
+    out.data.assign(upscaled[0].data,
+                    upscaled[0].data + static_cast<size_t>(out.width) * out.height * out.channels);
+    free_sd_images(upscaled, count);
+    return out;
+}
+
+// Pass origins along one axis: every `pass - overlap` pixels, with the last
+// pass pulled back to end at the edge
+std::vector<int> pass_starts(int size, int pass, int overlap) {
+    std::vector<int> starts;
+    const int step = pass - overlap;
+    for (int pos = 0;; pos += step) {
+        if (pos + pass >= size) {
+            starts.push_back(std::max(0, size - pass));
+            break;
+        }
+        starts.push_back(pos);
+    }
+    return starts;
+}
+
+Pixels extract(const uint8_t* src, int width, int channels, const Rect& r) {
+    Pixels p;
+    p.width = r.w;
+    p.height = r.h;
+    p.channels = channels;
+    p.data.resize(static_cast<size_t>(r.w) * r.h * channels);
+    const size_t row = static_cast<size_t>(r.w) * channels;
+    for (int y = 0; y < r.h; ++y) {
+        std::memcpy(p.data.data() + y * row,
+                    src + (static_cast<size_t>(r.y + y) * width + r.x) * channels, row);
+    }
+    return p;
+}
+
+// Write an upscaled pass into `out`, cross-fading linearly from what the
+// earlier passes left in the overlap towards this pass' pixels
+void blend(std::vector<uint8_t>& out, int out_width, int scale, const Rect& r, const Pixels& tile) {
+    const int c = tile.channels;
+    const int ox = r.x * scale;
+    const int oy = r.y * scale;
+    const int fade_x = r.overlap_left * scale;
+    const int fade_y = r.overlap_top * scale;
+    const size_t row_bytes = static_cast<size_t>(tile.width) * c;
+
+    for (int y = 0; y < tile.height; ++y) {
+        const uint8_t* in = tile.data.data() + y * row_bytes;
+        uint8_t* dst = out.data() + (static_cast<size_t>(oy + y) * out_width + ox) * c;
+        const float wy = y < fade_y ? (y + 0.5f) / fade_y : 1.0f;
+        int x = 0;
+        if (wy >= 1.0f) {
+            for (; x < fade_x; ++x) {
+                const float w = (x + 0.5f) / fade_x;
+                for (int k = 0; k < c; ++k) {
+                    dst[x * c + k] = static_cast<uint8_t>(dst[x * c + k] + (in[x * c + k] - dst[x * c + k]) * w + 0.5f);
+                }
+            }
+            std::memcpy(dst + x * c, in + x * c, row_bytes - static_cast<size_t>(x) * c);
+            continue;
+        }
+        for (; x < tile.width; ++x) {
+            const float w = (x < fade_x ? (x + 0.5f) / fade_x : 1.0f) * wy;
+            for (int k = 0; k < c; ++k) {
+                dst[x * c + k] = static_cast<uint8_t>(dst[x * c + k] + (in[x * c + k] - dst[x * c + k]) * w + 0.5f);
+            }
+        }
+    }
+}
+
+std::vector<uint8_t> upscale_once(upscaler_ctx_t* ctx, const uint8_t* data, int width, int height, int channels,
+                                  const TiledUpscaleOptions& options, int& out_width, int& out_height,
+                                  const PassProgress& on_pass) {
+    const int pass = options.pass_tile > 0
+        ? options.pass_tile
+        : std::min(MAX_PASS_TILE, std::max(256, 4 * std::max(1, options.model_tile)));
+    const int overlap = std::clamp(options.overlap, 0, pass / 4);
+
+    if (width <= pass && height <= pass) {
+        Pixels up = run_pass(ctx, data, width, height, channels, options.upscale_factor);
+        out_width = up.width;
+        out_height = up.height;
+        if (on_pass) on_pass(1, 1);
+        return std::move(up.data);
+    }
+
+    const auto xs = pass_starts(width, pass, overlap);
+    const auto ys = pass_starts(height, pass, overlap);
+    std::vector<Rect> rects;
+    for (size_t j = 0; j < ys.size(); ++j) {
+        for (size_t i = 0; i < xs.size(); ++i) {
+            Rect r;
+            r.x = xs[i];
+            r.y = ys[j];
+            r.w = std::min(pass, width - r.x);
+            r.h = std::min(pass, height - r.y);
+            r.overlap_left = i > 0 ? xs[i - 1] + std::min(pass, width - xs[i - 1]) - r.x : 0;
+            r.overlap_top = j > 0 ? ys[j - 1] + std::min(pass, height - ys[j - 1]) - r.y : 0;
+            rects.push_back(r);
+        }
+    }
+
+    std::vector<uint8_t> out;
+    int scale = 0;
+    int out_channels = channels;
+    std::future<void> stitching;
+    std::future<Pixels> cutting;
+    Pixels next = extract(data, width, channels, rects[0]);
+
+    for (size_t i = 0; i < rects.size(); ++i) {
+        Pixels cur = std::move(next);
+        if (i + 1 < rects.size()) {
+            cutting = std::async(std::launch::async, extract, data, width, channels, std::cref(rects[i + 1]));
+        }
+
+        Pixels up = run_pass(ctx, cur.data.data(), cur.width, cur.height, cur.channels, options.upscale_factor);
+        if (scale == 0) {
+            scale = up.width / cur.width;
+            out_channels = up.channels;
+            if (scale < 1) throw std::runtime_error("Upscaler returned a smaller image");
+            out_width = width * scale;
+            out_height = height * scale;
+            out.resize(static_cast<size_t>(out_width) * out_height * out_channels);
+        }
+        if (up.width != cur.width * scale || up.height != cur.height * scale || up.channels != out_channels) {
+            throw std::runtime_error("Upscaler returned inconsistent tile sizes");
+        }
+
+        if (stitching.valid()) stitching.get();
+        stitching = std::async(std::launch::async,
+            [&out, out_width, scale, r = rects[i], tile = std::move(up)]() {
+                blend(out, out_width, scale, r, tile);
+            });
+
+        if (cutting.valid()) next = cutting.get();
+        if (on_pass) on_pass(static_cast<int>(i + 1), static_cast<int>(rects.size()));
+    }
+    stitching.get();
+    return out;
+}
+
+} // namespace
+
+uint64_t upscaler_vram_estimate(int tile_size) {
+    const uint64_t tile = static_cast<uint64_t>(std::max(1, tile_size));
+    return tile * tile * ESRGAN_BYTES_PER_TILE_PIXEL;
+}
+
+int auto_upscaler_tile_size(uint64_t gpu_free_bytes) {
+    if (gpu_free_bytes == 0) return 128;
+    const uint64_t budget = gpu_free_bytes / 2;
+    for (int tile : {512, 384, 256, 192, 128, 96}) {
+        if (upscaler_vram_estimate(tile) <= budget) return tile;
+    }
+    return 64;
+}
+
+std::vector<uint8_t> tiled_upscale(
+    upscaler_ctx_t* ctx,
+    const uint8_t* data,
+    int width,
+    int height,
+    int channels,
+    const TiledUpscaleOptions& options,
+    int& out_width,
+    int& out_height,
+    const std::function<void(int done, int total)>& on_pass
+) {
+    std::vector<uint8_t> cur;
+    int w = width, h = height;
+    for (int r = 0; r < std::max(1, options.repeats); ++r) {
+        const uint8_t* src = r == 0 ? data : cur.data();
+        int next_w = 0, next_h = 0;
+        auto next = upscale_once(ctx, src, w, h, r == 0 ? channels : 3, options, next_w, next_h, on_pass);
+        cur = std::move(next);
+        w = next_w;
+        h = next_h;
+    }
+    out_width = w;
+    out_height = h;
+    return cur;
+}
+
+} // namespace sdcpp
@@ -6,6 +6,8 @@
 #include "docs_index.hpp"
 
 #include <algorithm>
+#include <atomic>
+#include <future>
 #include <iostream>
 #include <set>
 #include <fstream>
@@ -47,6 +49,35 @@ bool ToolExecutor::is_backend_tool(const std::string& tool_name) const {
     return BACKEND_TOOLS.find(tool_name) != BACKEND_TOOLS.end();
 }
 
+std::vector<nlohmann::json> ToolExecutor::execute_all(
+    const std::vector<std::pair<std::string, nlohmann::json>>& calls) {
+    std::vector<nlohmann::json> results(calls.size());
+    if (calls.size() <= 1) {
+        for (size_t i = 0; i < calls.size(); ++i) {
+            results[i] = execute(calls[i].first, calls[i].second);
+        }
+        return results;
+    }
+
+    // Workers take the next call until none are left; execute() catches
+    // its own exceptions, so a failing tool is just an error result
+    std::atomic<size_t> next{0};
+    auto worker = [&]() {
+        for (size_t i = next++; i < calls.size(); i = next++) {
+            results[i] = execute(calls[i].first, calls[i].second);
+        }
+    };
+    const size_t threads = std::min(calls.size(), MAX_PARALLEL_TOOLS);
+    std::vector<std::future<void>> helpers;
+    for (size_t t = 1; t < threads; ++t) {
+        helpers.push_back(std::async(std::launch::async, worker));
+    }
+    worker();
+    for (auto& h : helpers) h.get();
+    std::cout << "[ToolExecutor] Ran " << calls.size() << " tools on " << threads << " threads" << std::endl;
+    return results;
+}
+
 nlohmann::json ToolExecutor::execute(const std::string& tool_name,
                                       const nlohmann::json& parameters) {
     std::cout << "[ToolExecutor] Executing tool: " << tool_name << std::endl;
@@ -123,14 +154,13 @@ nlohmann::json ToolExecutor::execute_get_status() {
 
         // Include model info so LLM knows which model was used for each job
         // Handle null values safely
-        if (!item.model_settings.empty()) {
-            if (item.model_settings.contains("model_name") &&
-                item.model_settings["model_name"].is_string()) {
-                job_entry["model_name"] = item.model_settings["model_name"].get<std::string>();
+        const auto& settings = item.settings();
+        if (!settings.empty()) {
+            if (settings.contains("model_name") && settings["model_name"].is_string()) {
+                job_entry["model_name"] = settings["model_name"].get<std::string>();
             }
-            if (item.model_settings.contains("model_architecture") &&
-                item.model_settings["model_architecture"].is_string()) {
-                job_entry["model_architecture"] = item.model_settings["model_architecture"].get<std::string>();
+            if (settings.contains("model_architecture") && settings["model_architecture"].is_string()) {
+                job_entry["model_architecture"] = settings["model_architecture"].get<std::string>();
             }
         }
         recent_jobs.push_back(job_entry);
@@ -691,12 +721,13 @@ void ToolExecutor::set_settings_manager(SettingsManager* settings_manager) {
     settings_manager_ = settings_manager;
 }
 
-void ToolExecutor::set_docs_index(DocsIndex* docs_index) {
-    docs_index_ = docs_index;
+void ToolExecutor::set_docs_index(std::function<DocsIndex*()> docs_index) {
+    docs_index_ = std::move(docs_index);
 }
 
 nlohmann::json ToolExecutor::execute_search_docs(const nlohmann::json& params) {
-    if (!docs_index_) {
+    DocsIndex* docs_index = docs_index_ ? docs_index_() : nullptr;
+    if (!docs_index) {
         return {{"error", "Documentation index is not available."}};
     }
     std::string query = params.value("query", "");
@@ -709,7 +740,7 @@ nlohmann::json ToolExecutor::execute_search_docs(const nlohmann::json& params) {
         if (n > 0) max_results = static_cast<std::size_t>(std::min(n, 10));
     }
 
-    auto hits = docs_index_->search(query, max_results);
+    auto hits = docs_index->search(query, max_results);
     std::cout << "[ToolExecutor] search_docs: query=\"" << query
               << "\" → " << hits.size() << " hits" << std::endl;
 
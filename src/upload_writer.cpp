@@ -0,0 +1,209 @@
+#include "upload_writer.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace sdcpp {
+
+namespace {
+
+constexpr size_t BUFFER_SIZE = 1024 * 1024;
+
+std::atomic<uint64_t> g_upload_seq{0};
+
+bool write_all(int fd, const char* data, size_t len) {
+    while (len > 0) {
+        ssize_t n = ::write(fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += n;
+        len -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// Hard-link `src` to `dest` without clobbering, then drop `src`. Falls back
+// to check-then-rename on filesystems without hard links.
+int link_into_place(const std::string& src, const std::string& dest) {
+    if (::link(src.c_str(), dest.c_str()) == 0) {
+        ::unlink(src.c_str());
+        return 0;
+    }
+    int err = errno;
+    if (err != EPERM && err != ENOTSUP && err != EOPNOTSUPP && err != ENOSYS) {
+        return err;
+    }
+    std::error_code ec;
+    if (fs::exists(dest, ec)) return EEXIST;
+    return ::rename(src.c_str(), dest.c_str()) == 0 ? 0 : errno;
+}
+
+} // namespace
+
+UploadWriter::~UploadWriter() {
+    discard();
+}
+
+bool UploadWriter::fail(const std::string& what) {
+    out_of_space_ = (errno == ENOSPC || errno == EDQUOT);
+    error_ = what + " (" + std::strerror(errno) + ")";
+    return false;
+}
+
+bool UploadWriter::open(const std::string& dir, const std::string& name, uint64_t expected_size) {
+    discard();
+    error_.clear();
+    exists_ = false;
+    out_of_space_ = false;
+    written_ = 0;
+    buffered_ = 0;
+    reserved_ = 0;
+    sha256_.clear();
+    hasher_.reset();
+
+    temp_path_ = (fs::path(dir) / ("." + name + ".upload." + std::to_string(::getpid()) + "." +
+                                   std::to_string(++g_upload_seq))).string();
+    fd_ = ::open(temp_path_.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
+        temp_path_.clear();
+        return fail("Failed to create upload file in " + dir);
+    }
+
+    if (expected_size > 0) {
+        int err = ::posix_fallocate(fd_, 0, static_cast<off_t>(expected_size));
+        if (err == ENOSPC) {
+            discard();
+            out_of_space_ = true;
+            error_ = "Not enough disk space for " + std::to_string(expected_size / (1024 * 1024)) +
+                     " MB upload";
+            return false;
+        }
+        // EINVAL/EOPNOTSUPP: the filesystem can't reserve; just write
+        if (err == 0) reserved_ = expected_size;
+    }
+
+    ::posix_fadvise(fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+    buffer_.resize(BUFFER_SIZE);
+    return true;
+}
+
+bool UploadWriter::flush() {
+    if (buffered_ == 0) return true;
+    if (!write_all(fd_, buffer_.data(), buffered_)) {
+        return fail("Failed to write upload to disk");
+    }
+    hasher_.update(buffer_.data(), buffered_);
+    written_ += buffered_;
+    buffered_ = 0;
+    return true;
+}
+
+bool UploadWriter::write(const char* data, size_t len) {
+    if (fd_ < 0) return false;
+    while (len > 0) {
+        if (buffered_ == 0 && len >= buffer_.size()) {
+            // Large slice: skip the copy into the buffer
+            if (!write_all(fd_, data, len)) {
+                return fail("Failed to write upload to disk");
+            }
+            hasher_.update(data, len);
+            written_ += len;
+            return true;
+        }
+        size_t n = std::min(len, buffer_.size() - buffered_);
+        std::memcpy(buffer_.data() + buffered_, data, n);
+        buffered_ += n;
+        data += n;
+        len -= n;
+        if (buffered_ == buffer_.size() && !flush()) return false;
+    }
+    return true;
+}
+
+bool UploadWriter::commit(const std::string& dest, bool replace) {
+    if (fd_ < 0) {
+        if (error_.empty()) error_ = "Upload file is not open";
+        return false;
+    }
+    if (!flush()) {
+        discard();
+        return false;
+    }
+    // The reservation was sized from Content-Length, which for multipart
+    // bodies includes the other parts and boundaries
+    if (reserved_ > written_ && ::ftruncate(fd_, static_cast<off_t>(written_)) != 0) {
+        fail("Failed to truncate upload file");
+        discard();
+        return false;
+    }
+    if (::fdatasync(fd_) != 0) {
+        fail("Failed to flush upload file");
+        discard();
+        return false;
+    }
+    ::close(fd_);
+    fd_ = -1;
+    buffer_.clear();
+    buffer_.shrink_to_fit();
+
+    // A temp file spooled on another filesystem is copied next to the
+    // destination first, so the final step is still atomic
+    std::string src = temp_path_;
+    std::string staged;
+    auto dest_dir = fs::path(dest).parent_path();
+    std::error_code ec;
+    if (!dest_dir.empty() && !fs::equivalent(fs::path(temp_path_).parent_path(), dest_dir, ec)) {
+        staged = (dest_dir / (fs::path(temp_path_).filename().string() + ".staged")).string();
+        if (::rename(src.c_str(), staged.c_str()) != 0) {
+            if (errno != EXDEV || !fs::copy_file(src, staged, ec)) {
+                error_ = "Failed to move upload to " + dest_dir.string() +
+                         (ec ? ": " + ec.message() : std::string(" (") + std::strerror(errno) + ")");
+                fs::remove(staged, ec);
+                discard();
+                return false;
+            }
+            fs::remove(src, ec);
+        }
+        temp_path_ = staged;
+        src = staged;
+    }
+
+    int err = replace ? (::rename(src.c_str(), dest.c_str()) == 0 ? 0 : errno)
+                      : link_into_place(src, dest);
+    if (err != 0) {
+        exists_ = (err == EEXIST);
+        error_ = exists_ ? "A file with that name already exists at " + dest
+                         : "Failed to move upload into place: " + std::string(std::strerror(err));
+        discard();
+        return false;
+    }
+    temp_path_.clear();
+    sha256_ = hasher_.hex_digest();
+    return true;
+}
+
+void UploadWriter::discard() {
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+    if (!temp_path_.empty()) {
+        std::error_code ec;
+        fs::remove(temp_path_, ec);
+        temp_path_.clear();
+    }
+    buffer_.clear();
+    buffer_.shrink_to_fit();
+    buffered_ = 0;
+}
+
+} // namespace sdcpp
@@ -71,8 +71,25 @@ std::string first_csv(const std::string& v) {
     return trim(comma == std::string::npos ? v : v.substr(0, comma));
 }
 
+std::string g_peer_header_token;
+
 } // namespace
 
+void set_peer_header_token(const std::string& token) {
+    g_peer_header_token = token;
+}
+
+std::string peer_address(const httplib::Request& req) {
+    if (!g_peer_header_token.empty()) {
+        const std::string v = req.get_header_value(PEER_HEADER);
+        const size_t n = g_peer_header_token.size();
+        if (v.size() > n + 1 && v[n] == ' ' && v.compare(0, n, g_peer_header_token) == 0) {
+            return v.substr(n + 1);
+        }
+    }
+    return req.remote_addr;
+}
+
 bool ip_in_trusted_list(const std::string& ip,
                         const std::vector<std::string>& trusted) {
     if (ip.empty()) return false;
@@ -84,7 +101,7 @@ bool ip_in_trusted_list(const std::string& ip,
 
 std::string compute_base_url(const httplib::Request& req,
                              const std::vector<std::string>& trusted_proxies) {
-    bool trust_forwarded = ip_in_trusted_list(req.remote_addr, trusted_proxies);
+    bool trust_forwarded = ip_in_trusted_list(peer_address(req), trusted_proxies);
 
     std::string scheme = "http";
     if (trust_forwarded) {
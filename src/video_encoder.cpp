@@ -0,0 +1,688 @@
+#include "video_encoder.hpp"
+#include "image_encoder.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+
+#ifdef SDCPP_HAVE_FFMPEG
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/channel_layout.h>
+#include <libavutil/opt.h>
+#include <libswscale/swscale.h>
+}
+#endif
+
+namespace sdcpp {
+
+namespace {
+
+struct Defaults {
+    std::mutex mutex;
+    VideoConfig config;
+};
+
+Defaults& defaults() {
+    static Defaults d;
+    return d;
+}
+
+std::string to_lower(std::string s) {
+    std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return std::tolower(c); });
+    return s;
+}
+
+// ── Motion JPEG AVI ─────────────────────────────────────────────────────────
+//
+// Minimal RIFF/AVI 1.0 writer: one MJPG video stream, frames appended to the
+// movi list as they arrive, idx1 index and frame counts patched in finish().
+// Every player and browser-side <video> fallback handles it, and it needs
+// nothing beyond the JPEG encoder we already have.
+
+class AviMjpegWriter : public VideoWriter {
+public:
+    AviMjpegWriter(const std::string& path, int width, int height, const VideoEncodeOptions& options)
+        : path_(path), width_(width), height_(height), fps_(std::max(1, options.fps)),
+          encoder_name_("mjpeg") {
+        // CRF-style knob mapped onto JPEG quality: 23 → 90, 0 → 100, 51 → 62
+        jpeg_.format = ImageFormat::Jpeg;
+        jpeg_.quality = std::clamp(113 - options.crf, 50, 100);
+
+        out_.open(path, std::ios::binary | std::ios::trunc);
+        if (!out_) {
+            throw std::runtime_error("Cannot open " + path + " for writing");
+        }
+        write_headers();
+    }
+
+    void add_frame(const uint8_t* pixels, int channels) override {
+        std::vector<uint8_t> jpeg = encode_image(pixels, width_, height_, channels, jpeg_);
+        const uint32_t size = static_cast<uint32_t>(jpeg.size());
+
+        index_.push_back({static_cast<uint32_t>(static_cast<uint64_t>(out_.tellp()) - movi_fourcc_pos_), size});
+        fourcc("00dc");
+        put32(size);
+        out_.write(reinterpret_cast<const char*>(jpeg.data()), static_cast<std::streamsize>(size));
+        if (size & 1) out_.put('\0');  // RIFF chunks are word aligned
+        max_frame_bytes_ = std::max(max_frame_bytes_, size);
+        if (!out_) {
+            throw std::runtime_error("Short write to " + path_);
+        }
+    }
+
+    void finish() override {
+        const uint64_t movi_end = static_cast<uint64_t>(out_.tellp());
+
+        fourcc("idx1");
+        put32(static_cast<uint32_t>(index_.size() * 16));
+        for (const auto& entry : index_) {
+            fourcc("00dc");
+            put32(0x10);  // AVIIF_KEYFRAME
+            put32(entry.offset);
+            put32(entry.size);
+        }
+        const uint64_t file_end = static_cast<uint64_t>(out_.tellp());
+        const uint32_t frames = static_cast<uint32_t>(index_.size());
+
+        patch32(4, static_cast<uint32_t>(file_end - 8));
+        patch32(total_frames_pos_, frames);
+        patch32(stream_length_pos_, frames);
+        patch32(avih_buffer_pos_, max_frame_bytes_);
+        patch32(strh_buffer_pos_, max_frame_bytes_);
+        patch32(movi_size_pos_, static_cast<uint32_t>(movi_end - movi_size_pos_ - 4));
+        out_.close();
+        if (out_.fail()) {
+            throw std::runtime_error("Cannot finalize " + path_);
+        }
+    }
+
+    bool muxed_audio() const override { return false; }
+    const std::string& encoder() const override { return encoder_name_; }
+
+private:
+    struct IndexEntry {
+        uint32_t offset;    // From the 'movi' fourcc
+        uint32_t size;
+    };
+
+    void fourcc(const char* code) { out_.write(code, 4); }
+    void put32(uint32_t v) {
+        const char b[4] = {char(v & 0xff), char((v >> 8) & 0xff), char((v >> 16) & 0xff), char((v >> 24) & 0xff)};
+        out_.write(b, 4);
+    }
+    void put16(uint16_t v) {
+        const char b[2] = {char(v & 0xff), char((v >> 8) & 0xff)};
+        out_.write(b, 2);
+    }
+    uint64_t pos() { return static_cast<uint64_t>(out_.tellp()); }
+    void patch32(uint64_t at, uint32_t v) {
+        out_.seekp(static_cast<std::streamoff>(at));
+        put32(v);
+    }
+
+    void write_headers() {
+        const uint32_t w = static_cast<uint32_t>(width_);
+        const uint32_t h = static_cast<uint32_t>(height_);
+
+        fourcc("RIFF"); put32(0); fourcc("AVI ");
+
+        fourcc("LIST"); put32(4 + (8 + 56) + (8 + 4 + (8 + 56) + (8 + 40))); fourcc("hdrl");
+
+        fourcc("avih"); put32(56);
+        put32(static_cast<uint32_t>(1000000 / fps_));     // dwMicroSecPerFrame
+        put32(0);                                       // dwMaxBytesPerSec
+        put32(0);                                       // dwPaddingGranularity
+        put32(0x10);                                    // dwFlags = AVIF_HASINDEX
+        total_frames_pos_ = pos(); put32(0);            // dwTotalFrames
+        put32(0);                                       // dwInitialFrames
+        put32(1);                                       // dwStreams
+        avih_buffer_pos_ = pos(); put32(0);             // dwSuggestedBufferSize
+        put32(w); put32(h);
+        put32(0); put32(0); put32(0); put32(0);         // dwReserved
+
+        fourcc("LIST"); put32(4 + (8 + 56) + (8 + 40)); fourcc("strl");
+
+        fourcc("strh"); put32(56);
+        fourcc("vids"); fourcc("MJPG");
+        put32(0);                                       // dwFlags
+        put16(0); put16(0);                             // wPriority, wLanguage
+        put32(0);                                       // dwInitialFrames
+        put32(1);                                       // dwScale
+        put32(static_cast<uint32_t>(fps_));             // dwRate
+        put32(0);                                       // dwStart
+        stream_length_pos_ = pos(); put32(0);           // dwLength
+        strh_buffer_pos_ = pos(); put32(0);             // dwSuggestedBufferSize
+        put32(0xFFFFFFFFu);                             // dwQuality (default)
+        put32(0);                                       // dwSampleSize
+        put16(0); put16(0);
+        put16(static_cast<uint16_t>(w)); put16(static_cast<uint16_t>(h));
+
+        fourcc("strf"); put32(40);                      // BITMAPINFOHEADER
+        put32(40);
+        put32(w); put32(h);
+        put16(1); put16(24);
+        fourcc("MJPG");
+        put32(w * h * 3);
+        put32(0); put32(0); put32(0); put32(0);
+
+        fourcc("LIST");
+        movi_size_pos_ = pos(); put32(0);
+        movi_fourcc_pos_ = pos();
+        fourcc("movi");
+    }
+
+    std::string path_;
+    int width_, height_, fps_;
+    std::string encoder_name_;
+    EncodeOptions jpeg_;
+    std::ofstream out_;
+    std::vector<IndexEntry> index_;
+    uint32_t max_frame_bytes_ = 0;
+    uint64_t total_frames_pos_ = 0, stream_length_pos_ = 0;
+    uint64_t avih_buffer_pos_ = 0, strh_buffer_pos_ = 0;
+    uint64_t movi_size_pos_ = 0, movi_fourcc_pos_ = 0;
+};
+
+#ifdef SDCPP_HAVE_FFMPEG
+
+// ── FFmpeg (libavformat / libavcodec) ───────────────────────────────────────
+
+std::string av_error(int err) {
+    char buf[AV_ERROR_MAX_STRING_SIZE] = {0};
+    av_strerror(err, buf, sizeof(buf));
+    return buf;
+}
+
+// Encoder names to try, best first. Hardware encoders are only tried when
+// requested; one that exists in the FFmpeg build but has no device behind it
+// fails avcodec_open2() and the next candidate is used.
+std::vector<std::string> encoder_candidates(const std::string& codec, bool hardware) {
+    std::vector<std::string> names;
+    if (codec == "h264") {
+        if (hardware) names = {"h264_nvenc", "h264_videotoolbox"};
+        names.insert(names.end(), {"libx264", "libopenh264"});
+    } else if (codec == "vp9") {
+        names = {"libvpx-vp9"};
+    } else if (codec == "av1") {
+        if (hardware) names = {"av1_nvenc"};
+        names.insert(names.end(), {"libsvtav1", "libaom-av1", "librav1e"});
+    }
+    return names;
+}
+
+AVCodecID codec_id(const std::string& codec) {
+    if (codec == "h264") return AV_CODEC_ID_H264;
+    if (codec == "vp9") return AV_CODEC_ID_VP9;
+    return AV_CODEC_ID_AV1;
+}
+
+// Constant-quality settings per encoder family; unknown options are ignored
+void apply_quality(AVCodecContext* ctx, const std::string& name, int crf) {
+    void* priv = ctx->priv_data;
+    if (name.find("nvenc") != std::string::npos) {
+        av_opt_set(priv, "preset", "p5", 0);
+        av_opt_set(priv, "rc", "vbr", 0);
+        av_opt_set_int(priv, "cq", crf, 0);
+        ctx->bit_rate = 0;
+    } else if (name == "libx264") {
+        av_opt_set(priv, "preset", "medium", 0);
+        av_opt_set_int(priv, "crf", crf, 0);
+    } else if (name == "libvpx-vp9") {
+        av_opt_set_int(priv, "crf", crf, 0);
+        av_opt_set(priv, "deadline", "good", 0);
+        av_opt_set_int(priv, "cpu-used", 4, 0);
+        av_opt_set_int(priv, "row-mt", 1, 0);
+        ctx->bit_rate = 0;
+    } else if (name == "libsvtav1") {
+        av_opt_set_int(priv, "crf", crf, 0);
+        av_opt_set_int(priv, "preset", 8, 0);
+    } else if (name == "libaom-av1") {
+        av_opt_set_int(priv, "crf", crf, 0);
+        av_opt_set_int(priv, "cpu-used", 6, 0);
+        av_opt_set_int(priv, "row-mt", 1, 0);
+        ctx->bit_rate = 0;
+    } else {
+        // No CRF mode (videotoolbox, openh264, rav1e): ~0.1 bit per pixel
+        ctx->bit_rate = static_cast<int64_t>(ctx->width) * ctx->height * ctx->time_base.den / 10;
+    }
+}
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wdeprecated-declarations"
+// sample_fmts / supported_samplerates are deprecated in FFmpeg 7.1 in favour
+// of avcodec_get_supported_config(), but still present and simpler to use
+AVSampleFormat pick_sample_format(const AVCodec* codec) {
+    if (!codec->sample_fmts) return AV_SAMPLE_FMT_FLTP;
+    for (const AVSampleFormat* f = codec->sample_fmts; *f != AV_SAMPLE_FMT_NONE; ++f) {
+        if (*f == AV_SAMPLE_FMT_FLTP || *f == AV_SAMPLE_FMT_FLT) return *f;
+    }
+    return AV_SAMPLE_FMT_NONE;
+}
+
+bool supports_sample_rate(const AVCodec* codec, int rate) {
+    if (!codec->supported_samplerates) return true;
+    for (const int* r = codec->supported_samplerates; *r; ++r) {
+        if (*r == rate) return true;
+    }
+    return false;
+}
+#pragma GCC diagnostic pop
+
+class FfmpegWriter : public VideoWriter {
+public:
+    FfmpegWriter(const std::string& path, int width, int height,
+                 const VideoEncodeOptions& options, const AudioTrack* audio)
+        : path_(path), src_width_(width),
+          width_(width & ~1), height_(height & ~1), fps_(std::max(1, options.fps)) {
+        try {
+            open(options, audio);
+        } catch (...) {
+            release();
+            throw;
+        }
+    }
+
+    ~FfmpegWriter() override { release(); }
+
+    void add_frame(const uint8_t* pixels, int channels) override {
+        AVPixelFormat src_format = channels == 1 ? AV_PIX_FMT_GRAY8
+                                 : channels == 4 ? AV_PIX_FMT_RGBA : AV_PIX_FMT_RGB24;
+        sws_ = sws_getCachedContext(sws_, width_, height_, src_format,
+                                    width_, height_, video_ctx_->pix_fmt,
+                                    SWS_BICUBIC, nullptr, nullptr, nullptr);
+        if (!sws_) throw std::runtime_error("swscale context failed");
+
+        int ret = av_frame_make_writable(frame_);
+        if (ret < 0) throw std::runtime_error("av_frame_make_writable: " + av_error(ret));
+
+        // Odd sizes are cropped by one pixel: 4:2:0 needs even dimensions
+        const uint8_t* src[1] = {pixels};
+        const int src_stride[1] = {src_width_ * channels};
+        sws_scale(sws_, src, src_stride, 0, height_, frame_->data, frame_->linesize);
+        frame_->pts = frames_++;
+        encode(video_ctx_, video_stream_, frame_);
+
+        // Keep the audio interleaved with the video instead of appending it
+        // all at the end, so the muxer never buffers the whole clip
+        write_audio_until(static_cast<double>(frames_) / fps_);
+    }
+
+    void finish() override {
+        write_audio_until(-1.0);
+        encode(video_ctx_, video_stream_, nullptr);
+        if (audio_ctx_) encode(audio_ctx_, audio_stream_, nullptr);
+        int ret = av_write_trailer(fmt_);
+        if (ret < 0) throw std::runtime_error("av_write_trailer: " + av_error(ret));
+    }
+
+    bool muxed_audio() const override { return audio_ctx_ != nullptr; }
+    const std::string& encoder() const override { return encoder_name_; }
+
+private:
+    void open(const VideoEncodeOptions& options, const AudioTrack* audio) {
+        const char* format_name = options.container == VideoContainer::Webm ? "webm" : "mp4";
+        int ret = avformat_alloc_output_context2(&fmt_, nullptr, format_name, path_.c_str());
+        if (ret < 0 || !fmt_) throw std::runtime_error("avformat: " + av_error(ret));
+
+        open_video(options);
+        if (audio && audio->samples && audio->sample_count > 0 && audio->channels > 0 && audio->sample_rate > 0) {
+            open_audio(options.container, *audio);
+        }
+
+        if (!(fmt_->oformat->flags & AVFMT_NOFILE)) {
+            ret = avio_open(&fmt_->pb, path_.c_str(), AVIO_FLAG_WRITE);
+            if (ret < 0) throw std::runtime_error("Cannot open " + path_ + ": " + av_error(ret));
+        }
+        AVDictionary* mux_options = nullptr;
+        if (options.container == VideoContainer::Mp4) {
+            // moov atom up front so browsers can start playback while downloading
+            av_dict_set(&mux_options, "movflags", "+faststart", 0);
+        }
+        ret = avformat_write_header(fmt_, &mux_options);
+        av_dict_free(&mux_options);
+        if (ret < 0) throw std::runtime_error("avformat_write_header: " + av_error(ret));
+
+        frame_ = av_frame_alloc();
+        packet_ = av_packet_alloc();
+        if (!frame_ || !packet_) throw std::runtime_error("Out of memory");
+        frame_->format = video_ctx_->pix_fmt;
+        frame_->width = width_;
+        frame_->height = height_;
+        ret = av_frame_get_buffer(frame_, 0);
+        if (ret < 0) throw std::runtime_error("av_frame_get_buffer: " + av_error(ret));
+    }
+
+    void open_video(const VideoEncodeOptions& options) {
+        std::vector<const AVCodec*> codecs;
+        for (const auto& name : encoder_candidates(options.codec, options.hardware)) {
+            if (const AVCodec* c = avcodec_find_encoder_by_name(name.c_str())) codecs.push_back(c);
+        }
+        if (const AVCodec* c = avcodec_find_encoder(codec_id(options.codec))) codecs.push_back(c);
+
+        std::string tried;
+        for (const AVCodec* codec : codecs) {
+            AVCodecContext* ctx = avcodec_alloc_context3(codec);
+            if (!ctx) continue;
+            ctx->width = width_;
+            ctx->height = height_;
+            ctx->time_base = AVRational{1, fps_};
+            ctx->framerate = AVRational{fps_, 1};
+            ctx->pix_fmt = AV_PIX_FMT_YUV420P;
+            ctx->gop_size = fps_ * 2;
+            if (fmt_->oformat->flags & AVFMT_GLOBALHEADER) {
+                ctx->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+            }
+            apply_quality(ctx, codec->name, options.crf);
+
+            int ret = avcodec_open2(ctx, codec, nullptr);
+            if (ret == 0) {
+                video_ctx_ = ctx;
+                encoder_name_ = codec->name;
+                break;
+            }
+            tried += std::string(tried.empty() ? "" : ", ") + codec->name + " (" + av_error(ret) + ")";
+            avcodec_free_context(&ctx);
+        }
+        if (!video_ctx_) {
+            throw std::runtime_error("No usable " + options.codec + " encoder"
+                                     + (tried.empty() ? " in this FFmpeg build" : ": " + tried));
+        }
+
+        video_stream_ = avformat_new_stream(fmt_, nullptr);
+        if (!video_stream_) throw std::runtime_error("avformat_new_stream failed");
+        video_stream_->time_base = video_ctx_->time_base;
+        avcodec_parameters_from_context(video_stream_->codecpar, video_ctx_);
+    }
+
+    // Best effort: if the container's audio codec can't take this track the
+    // video is written silent and the caller keeps audio.wav
+    void open_audio(VideoContainer container, const AudioTrack& audio) {
+        const AVCodec* codec = container == VideoContainer::Mp4
+            ? avcodec_find_encoder(AV_CODEC_ID_AAC)
+            : avcodec_find_encoder_by_name("libopus");
+        if (!codec && container == VideoContainer::Webm) codec = avcodec_find_encoder_by_name("libvorbis");
+        if (!codec) {
+            std::cerr << "[VideoEncoder] No audio encoder for " << video_container_to_string(container)
+                      << ", keeping audio separate" << std::endl;
+            return;
+        }
+        AVSampleFormat sample_format = pick_sample_format(codec);
+        if (sample_format == AV_SAMPLE_FMT_NONE || !supports_sample_rate(codec, audio.sample_rate)) {
+            std::cerr << "[VideoEncoder] " << codec->name << " cannot encode " << audio.sample_rate
+                      << " Hz float audio, keeping audio separate" << std::endl;
+            return;
+        }
+
+        AVCodecContext* ctx = avcodec_alloc_context3(codec);
+        if (!ctx) return;
+        ctx->sample_fmt = sample_format;
+        ctx->sample_rate = audio.sample_rate;
+        ctx->time_base = AVRational{1, audio.sample_rate};
+        ctx->bit_rate = 128000;
+#if LIBAVUTIL_VERSION_INT >= AV_VERSION_INT(57, 24, 100)
+        av_channel_layout_default(&ctx->ch_layout, audio.channels);
+#else
+        ctx->channels = audio.channels;
+        ctx->channel_layout = av_get_default_channel_layout(audio.channels);
+#endif
+        if (fmt_->oformat->flags & AVFMT_GLOBALHEADER) {
+            ctx->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+        }
+        int ret = avcodec_open2(ctx, codec, nullptr);
+        if (ret < 0) {
+            std::cerr << "[VideoEncoder] " << codec->name << ": " << av_error(ret)
+                      << ", keeping audio separate" << std::endl;
+            avcodec_free_context(&ctx);
+            return;
+        }
+        audio_stream_ = avformat_new_stream(fmt_, nullptr);
+        if (!audio_stream_) {
+            avcodec_free_context(&ctx);
+            return;
+        }
+        audio_stream_->time_base = ctx->time_base;
+        avcodec_parameters_from_context(audio_stream_->codecpar, ctx);
+        audio_ctx_ = ctx;
+        audio_ = audio;
+    }
+
+    // Encode audio up to `seconds` (< 0 = everything left)
+    void write_audio_until(double seconds) {
+        if (!audio_ctx_) return;
+        const size_t total = audio_.sample_count;
+        size_t until = seconds < 0 ? total
+                     : std::min(total, static_cast<size_t>(seconds * audio_.sample_rate));
+        const int frame_size = audio_ctx_->frame_size > 0 ? audio_ctx_->frame_size : 1024;
+        const bool variable = audio_ctx_->codec->capabilities & AV_CODEC_CAP_VARIABLE_FRAME_SIZE;
+
+        while (audio_pos_ < until && (seconds < 0 || until - audio_pos_ >= static_cast<size_t>(frame_size))) {
+            const size_t n = std::min<size_t>(frame_size, total - audio_pos_);
+            AVFrame* af = av_frame_alloc();
+            if (!af) throw std::runtime_error("Out of memory");
+            // Fixed-frame encoders (AAC) need a full last frame: pad with silence
+            af->nb_samples = variable ? static_cast<int>(n) : frame_size;
+            af->format = audio_ctx_->sample_fmt;
+            af->sample_rate = audio_ctx_->sample_rate;
+#if LIBAVUTIL_VERSION_INT >= AV_VERSION_INT(57, 24, 100)
+            av_channel_layout_copy(&af->ch_layout, &audio_ctx_->ch_layout);
+#else
+            af->channels = audio_ctx_->channels;
+            af->channel_layout = audio_ctx_->channel_layout;
+#endif
+            int ret = av_frame_get_buffer(af, 0);
+            if (ret < 0) {
+                av_frame_free(&af);
+                throw std::runtime_error("av_frame_get_buffer: " + av_error(ret));
+            }
+            const int ch = audio_.channels;
+            const float* src = audio_.samples + audio_pos_ * ch;
+            if (audio_ctx_->sample_fmt == AV_SAMPLE_FMT_FLTP) {
+                for (int c = 0; c < ch; ++c) {
+                    float* dst = reinterpret_cast<float*>(af->data[c]);
+                    for (size_t i = 0; i < n; ++i) dst[i] = src[i * ch + c];
+                    std::fill(dst + n, dst + af->nb_samples, 0.0f);
+                }
+            } else {
+                float* dst = reinterpret_cast<float*>(af->data[0]);
+                std::memcpy(dst, src, n * ch * sizeof(float));
+                std::fill(dst + n * ch, dst + static_cast<size_t>(af->nb_samples) * ch, 0.0f);
+            }
+            af->pts = static_cast<int64_t>(audio_pos_);
+            audio_pos_ += n;
+            try {
+                encode(audio_ctx_, audio_stream_, af);
+            } catch (...) {
+                av_frame_free(&af);
+                throw;
+            }
+            av_frame_free(&af);
+        }
+    }
+
+    void encode(AVCodecContext* ctx, AVStream* stream, const AVFrame* frame) {
+        int ret = avcodec_send_frame(ctx, frame);
+        if (ret < 0 && ret != AVERROR_EOF) throw std::runtime_error("avcodec_send_frame: " + av_error(ret));
+        while (true) {
+            ret = avcodec_receive_packet(ctx, packet_);
+            if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) return;
+            if (ret < 0) throw std::runtime_error("avcodec_receive_packet: " + av_error(ret));
+            av_packet_rescale_ts(packet_, ctx->time_base, stream->time_base);
+            packet_->stream_index = stream->index;
+            ret = av_interleaved_write_frame(fmt_, packet_);
+            if (ret < 0) throw std::runtime_error("write: " + av_error(ret));
+        }
+    }
+
+    void release() {
+        if (sws_) sws_freeContext(sws_);
+        sws_ = nullptr;
+        av_frame_free(&frame_);
+        av_packet_free(&packet_);
+        avcodec_free_context(&video_ctx_);
+        avcodec_free_context(&audio_ctx_);
+        if (fmt_) {
+            if (fmt_->pb && !(fmt_->oformat->flags & AVFMT_NOFILE)) avio_closep(&fmt_->pb);
+            avformat_free_context(fmt_);
+            fmt_ = nullptr;
+        }
+    }
+
+    std::string path_;
+    int src_width_;
+    int width_, height_, fps_;
+    std::string encoder_name_;
+
+    AVFormatContext* fmt_ = nullptr;
+    AVCodecContext* video_ctx_ = nullptr;
+    AVCodecContext* audio_ctx_ = nullptr;
+    AVStream* video_stream_ = nullptr;
+    AVStream* audio_stream_ = nullptr;
+    SwsContext* sws_ = nullptr;
+    AVFrame* frame_ = nullptr;
+    AVPacket* packet_ = nullptr;
+    int64_t frames_ = 0;
+
+    AudioTrack audio_;
+    size_t audio_pos_ = 0;      // Samples per channel already encoded
+};
+
+#endif // SDCPP_HAVE_FFMPEG
+
+// Default codec per container and which codecs each one can carry
+std::string default_codec(VideoContainer container) {
+    switch (container) {
+        case VideoContainer::Mp4:  return "h264";
+        case VideoContainer::Webm: return "vp9";
+        case VideoContainer::Avi:  return "mjpeg";
+    }
+    return "mjpeg";
+}
+
+bool codec_fits(VideoContainer container, const std::string& codec) {
+    switch (container) {
+        case VideoContainer::Mp4:  return codec == "h264" || codec == "av1";
+        case VideoContainer::Webm: return codec == "vp9" || codec == "av1";
+        case VideoContainer::Avi:  return codec == "mjpeg";
+    }
+    return false;
+}
+
+} // namespace
+
+VideoContainer video_container_from_string(const std::string& name) {
+    std::string n = to_lower(name);
+    if (n == "mp4") return VideoContainer::Mp4;
+    if (n == "webm") return VideoContainer::Webm;
+    if (n == "avi") return VideoContainer::Avi;
+    throw std::runtime_error("Unknown video format: " + name + " (expected mp4, webm, avi or none)");
+}
+
+std::string video_container_to_string(VideoContainer container) {
+    switch (container) {
+        case VideoContainer::Mp4:  return "mp4";
+        case VideoContainer::Webm: return "webm";
+        case VideoContainer::Avi:  return "avi";
+    }
+    return "avi";
+}
+
+bool video_container_available(VideoContainer container) {
+#ifdef SDCPP_HAVE_FFMPEG
+    (void)container;
+    return true;
+#else
+    return container == VideoContainer::Avi;
+#endif
+}
+
+void set_default_video_config(const VideoConfig& config) {
+    auto& d = defaults();
+    std::lock_guard<std::mutex> lock(d.mutex);
+    d.config = config;
+}
+
+bool default_keep_frames() {
+    auto& d = defaults();
+    std::lock_guard<std::mutex> lock(d.mutex);
+    return d.config.keep_frames;
+}
+
+std::optional<VideoEncodeOptions> resolve_video_options(const std::string& format,
+                                                        const std::string& codec, int fps) {
+    VideoConfig config;
+    {
+        auto& d = defaults();
+        std::lock_guard<std::mutex> lock(d.mutex);
+        config = d.config;
+    }
+
+    std::string name = to_lower(format.empty() ? config.format : format);
+    if (name == "none") return std::nullopt;
+    if (name == "auto") {
+        name = video_container_available(VideoContainer::Mp4) ? "mp4" : "avi";
+    }
+
+    VideoEncodeOptions options;
+    options.container = video_container_from_string(name);
+    if (!video_container_available(options.container)) {
+        throw std::runtime_error("video_format \"" + name + "\" is not available in this build (no FFmpeg)");
+    }
+
+    // An explicit request codec must fit the container; the config default
+    // only applies where it fits (e.g. codec "h264" with a webm request)
+    if (!codec.empty()) {
+        options.codec = to_lower(codec);
+        if (!codec_fits(options.container, options.codec)) {
+            throw std::runtime_error("video_codec \"" + codec + "\" cannot be stored in " + name);
+        }
+    } else if (!config.codec.empty() && codec_fits(options.container, to_lower(config.codec))) {
+        options.codec = to_lower(config.codec);
+    } else {
+        options.codec = default_codec(options.container);
+    }
+
+    options.fps = std::max(1, fps);
+    options.crf = config.crf;
+    options.hardware = config.hardware;
+    return options;
+}
+
+std::unique_ptr<VideoWriter> VideoWriter::open(const std::string& path, int width, int height,
+                                               const VideoEncodeOptions& options,
+                                               const AudioTrack* audio) {
+    if (width <= 0 || height <= 0) {
+        throw std::runtime_error("Invalid video size");
+    }
+    if (options.container == VideoContainer::Avi) {
+        return std::make_unique<AviMjpegWriter>(path, width, height, options);
+    }
+#ifdef SDCPP_HAVE_FFMPEG
+    return std::make_unique<FfmpegWriter>(path, width, height, options, audio);
+#else
+    (void)audio;
+    throw std::runtime_error("Video format " + video_container_to_string(options.container)
+                             + " needs a build with FFmpeg");
+#endif
+}
+
+nlohmann::json video_encoder_backends() {
+    nlohmann::json containers = nlohmann::json::array();
+    for (auto c : {VideoContainer::Mp4, VideoContainer::Webm, VideoContainer::Avi}) {
+        if (video_container_available(c)) containers.push_back(video_container_to_string(c));
+    }
+    return {
+#ifdef SDCPP_HAVE_FFMPEG
+        {"ffmpeg", LIBAVCODEC_IDENT},
+#else
+        {"ffmpeg", nullptr},
+#endif
+        {"containers", containers}
+    };
+}
+
+} // namespace sdcpp
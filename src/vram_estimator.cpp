@@ -0,0 +1,130 @@
+#include "vram_estimator.hpp"
+
+#include <cctype>
+
+namespace sdcpp {
+
+namespace {
+
+constexpr uint64_t KiB = 1024;
+
+// Diffusion compute buffer per latent pixel, and how the attention that
+// dominates without flash attention is shaped: tokens = latent pixels /
+// attn_div (patching or the first attention level's downsampling), and the
+// head count of that level. Sizes are from sd.cpp's reported compute
+// buffers at 512² (SD1/SD2) and 1024² (the rest), rounded up.
+struct Family {
+    uint64_t bytes_per_latent_px;
+    int attn_div;
+    int heads;
+};
+
+constexpr Family UNET_SD1 = {140 * KiB, 1, 8};
+constexpr Family UNET_SDXL = {56 * KiB, 4, 10};
+constexpr Family DIT = {88 * KiB, 4, 24};
+
+// VAE decoder: convolution activations per image pixel; its mid-block
+// attention runs over one token per latent pixel
+constexpr uint64_t VAE_BYTES_PER_PX = 1600;
+constexpr int VAE_TILE_LATENT = 32;        // sd.cpp's default tile edge, in latent pixels
+
+// Latent channels generously (Flux-class 16) at f32, per image of a batch
+constexpr uint64_t LATENT_BYTES_PER_PX = 16 * 4;
+
+std::string lower(std::string s) {
+    for (auto& c : s) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    return s;
+}
+
+const Family& family_for(const std::string& architecture) {
+    const std::string a = lower(architecture);
+    if (a.find("sdxl") != std::string::npos) return UNET_SDXL;
+    if (a.find("sd 1") != std::string::npos || a.find("sd 2") != std::string::npos ||
+        a.find("sd1") != std::string::npos || a.find("sd2") != std::string::npos ||
+        a.find("svd") != std::string::npos) {
+        return UNET_SD1;
+    }
+    // Flux, SD3, Chroma, Wan, Qwen Image, Z-Image and anything newer
+    return DIT;
+}
+
+int int_param(const nlohmann::json& p, const char* key, int fallback) {
+    auto it = p.find(key);
+    return (it != p.end() && it->is_number()) ? it->get<int>() : fallback;
+}
+
+bool bool_param(const nlohmann::json& p, const char* key) {
+    auto it = p.find(key);
+    return it != p.end() && it->is_boolean() && it->get<bool>();
+}
+
+uint64_t attention_bytes(uint64_t tokens, int heads) {
+    // f32 score matrix per head
+    return tokens * tokens * static_cast<uint64_t>(heads) * 4;
+}
+
+} // namespace
+
+nlohmann::json VramEstimate::to_json() const {
+    return {
+        {"weights_bytes", weights},
+        {"diffusion_bytes", diffusion},
+        {"vae_bytes", vae},
+        {"peak_bytes", peak()}
+    };
+}
+
+VramEstimate estimate_job_vram(const nlohmann::json& params, bool video, const VramModelInfo& model) {
+    VramEstimate e;
+    e.weights = model.weight_bytes;
+    if (model.max_vram_gib > 0.0f) {
+        e.weights = std::min(e.weights, static_cast<uint64_t>(model.max_vram_gib * 1024.0 * 1024.0 * 1024.0));
+    }
+
+    int width = std::max(64, int_param(params, "width", 512));
+    int height = std::max(64, int_param(params, "height", 512));
+    if (bool_param(params, "hires_enabled")) {
+        // The second pass samples and decodes at the target size
+        const int tw = int_param(params, "hires_target_width", 0);
+        const int th = int_param(params, "hires_target_height", 0);
+        double scale = 2.0;
+        if (auto it = params.find("hires_scale"); it != params.end() && it->is_number()) {
+            scale = std::max(1.0, it->get<double>());
+        }
+        width = tw > 0 ? tw : static_cast<int>(width * scale);
+        height = th > 0 ? th : static_cast<int>(height * scale);
+    }
+    const int batch = std::max(1, int_param(params, "batch_count", 1));
+    // Video latents are 4x compressed in time (Wan-style causal VAE)
+    const uint64_t latent_frames = video
+        ? static_cast<uint64_t>((std::max(1, int_param(params, "video_frames", 33)) - 1) / 4 + 1)
+        : 1;
+
+    const uint64_t latent_px = static_cast<uint64_t>(width / 8) * static_cast<uint64_t>(height / 8);
+
+    const Family& fam = family_for(model.architecture);
+    e.diffusion = latent_px * latent_frames * fam.bytes_per_latent_px;
+    if (!model.flash_attn) {
+        e.diffusion += attention_bytes(latent_px * latent_frames / fam.attn_div, fam.heads);
+    }
+    e.diffusion += latent_px * latent_frames * LATENT_BYTES_PER_PX * batch;
+
+    uint64_t vae_w = static_cast<uint64_t>(width);
+    uint64_t vae_h = static_cast<uint64_t>(height);
+    if (bool_param(params, "vae_tiling")) {
+        const int tx = int_param(params, "vae_tile_size_x", 0);
+        const int ty = int_param(params, "vae_tile_size_y", 0);
+        vae_w = std::min<uint64_t>(vae_w, static_cast<uint64_t>(tx > 0 ? tx : VAE_TILE_LATENT) * 8);
+        vae_h = std::min<uint64_t>(vae_h, static_cast<uint64_t>(ty > 0 ? ty : VAE_TILE_LATENT) * 8);
+    }
+    const uint64_t vae_px = vae_w * vae_h;
+    e.vae = vae_px * VAE_BYTES_PER_PX;
+    if (!model.vae_flash_attn) e.vae += attention_bytes(vae_px / 64, 1);
+    if (video && !bool_param(params, "temporal_tiling")) {
+        // The causal decoder keeps a few latent frames of features around
+        e.vae *= std::min<uint64_t>(latent_frames, 4);
+    }
+    return e;
+}
+
+} // namespace sdcpp
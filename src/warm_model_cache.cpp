@@ -0,0 +1,149 @@
+#include "warm_model_cache.hpp"
+#include "memory_utils.hpp"
+
+#include <iostream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace sdcpp {
+
+WarmModelCache::WarmModelCache(uint64_t budget_bytes, bool pin)
+    : budget_bytes_(budget_bytes), pin_(pin) {
+    if (enabled()) {
+        std::cout << "[WarmModelCache] RAM budget " << format_bytes(budget_bytes_)
+                  << (pin_ ? " (pinned)" : "") << std::endl;
+    }
+}
+
+WarmModelCache::~WarmModelCache() {
+    clear();
+}
+
+bool WarmModelCache::lookup(const std::vector<std::string>& paths) {
+    if (!enabled() || paths.empty()) return false;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    bool all_resident = true;
+    for (const auto& p : paths) {
+        auto it = index_.find(p);
+        if (it == index_.end()) {
+            all_resident = false;
+            continue;
+        }
+        lru_.splice(lru_.begin(), lru_, it->second);
+    }
+    if (all_resident) hits_++; else misses_++;
+    return all_resident;
+}
+
+bool WarmModelCache::map_locked(const std::string& path, Entry& out) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+
+    struct stat st {};
+    if (::fstat(fd, &st) != 0 || st.st_size <= 0) {
+        ::close(fd);
+        return false;
+    }
+    const uint64_t size = static_cast<uint64_t>(st.st_size);
+    if (size > budget_bytes_) {
+        ::close(fd);
+        return false;
+    }
+
+    evict_until_locked(size);
+
+    void* addr = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);  // mapping keeps the file referenced
+    if (addr == MAP_FAILED) return false;
+
+    ::madvise(addr, size, MADV_WILLNEED);
+
+    out.path = path;
+    out.addr = addr;
+    out.size = size;
+    out.pinned = false;
+    if (pin_) {
+        // Usually limited by RLIMIT_MEMLOCK; fall back to a plain mapping.
+        out.pinned = (::mlock(addr, size) == 0);
+        if (!out.pinned) {
+            std::cerr << "[WarmModelCache] mlock failed for " << path
+                      << " (RLIMIT_MEMLOCK?), keeping unpinned" << std::endl;
+        }
+    }
+    return true;
+}
+
+void WarmModelCache::unmap(Entry& e) {
+    if (e.addr == nullptr) return;
+    if (e.pinned) ::munlock(e.addr, e.size);
+    ::munmap(e.addr, e.size);
+    e.addr = nullptr;
+}
+
+void WarmModelCache::evict_until_locked(uint64_t needed) {
+    while (!lru_.empty() && used_bytes_ + needed > budget_bytes_) {
+        Entry& victim = lru_.back();
+        std::cout << "[WarmModelCache] Evicting " << victim.path
+                  << " (" << format_bytes(victim.size) << ")" << std::endl;
+        used_bytes_ -= victim.size;
+        unmap(victim);
+        index_.erase(victim.path);
+        lru_.pop_back();
+        evictions_++;
+    }
+}
+
+void WarmModelCache::retain(const std::vector<std::string>& paths) {
+    if (!enabled()) return;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& p : paths) {
+        auto it = index_.find(p);
+        if (it != index_.end()) {
+            lru_.splice(lru_.begin(), lru_, it->second);
+            continue;
+        }
+        Entry e;
+        if (!map_locked(p, e)) continue;
+        used_bytes_ += e.size;
+        lru_.push_front(std::move(e));
+        index_[p] = lru_.begin();
+    }
+}
+
+void WarmModelCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& e : lru_) unmap(e);
+    lru_.clear();
+    index_.clear();
+    used_bytes_ = 0;
+}
+
+nlohmann::json WarmModelCache::stats_json() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    nlohmann::json entries = nlohmann::json::array();
+    for (const auto& e : lru_) {
+        entries.push_back({
+            {"path", e.path},
+            {"size", e.size},
+            {"pinned", e.pinned}
+        });
+    }
+    const uint64_t lookups = hits_ + misses_;
+    return {
+        {"enabled", enabled()},
+        {"budget_bytes", budget_bytes_},
+        {"used_bytes", used_bytes_},
+        {"pin", pin_},
+        {"hits", hits_},
+        {"misses", misses_},
+        {"hit_rate", lookups ? static_cast<double>(hits_) / lookups : 0.0},
+        {"evictions", evictions_},
+        {"entries", entries}
+    };
+}
+
+} // namespace sdcpp
@@ -6,26 +6,237 @@
 #include <ctime>
 #include <algorithm>
 #include <optional>
+#include <deque>
+#include <thread>
+#include <condition_variable>
+#include <memory>
+#include <unordered_set>
 
 #include "httplib_compat.h"
 #include "auth_manager.hpp"
+#include "job_trace.hpp"
 
 namespace sdcpp {
 
+/**
+ * Queued outbound message. The payload is serialized once per broadcast and
+ * shared by every client's queue. Droppable messages (progress, previews,
+ * memory status) are superseded by newer ones and go first when the queue is
+ * full.
+ */
+struct OutboundMessage {
+    std::shared_ptr<const std::string> payload;
+    bool droppable = false;
+    bool binary = false;         // binary frame (preview), otherwise JSON text
+};
+
+/**
+ * Event topics a client can subscribe to (bit mask)
+ */
+enum WSTopic : uint32_t {
+    TopicJobs     = 1u << 0,   // job_added, job_status_changed, job_cancelled, job_deleted, job_restored
+    TopicProgress = 1u << 1,   // job_progress, job_preview
+    TopicModels   = 1u << 2,   // model_*, upscaler_*
+    TopicServer   = 1u << 3,   // server_status, server_shutdown
+    TopicMemory   = 1u << 4,   // memory_status
+    TopicAll      = TopicJobs | TopicProgress | TopicModels | TopicServer | TopicMemory
+};
+
 /**
  * Per-client connection data (internal to .cpp)
+ *
+ * broadcast() only appends to `outbox`; the client's own sender thread does
+ * the blocking ws->send(), so a slow or stalled client delays nobody else.
+ * Front-end clients have no ws and no sender: `wake` tells the event loop
+ * to pull from the outbox instead.
  */
 struct ClientConnection {
     size_t id;
-    httplib::ws::WebSocket* ws;  // non-owning, valid during handler lifetime
-    std::mutex send_mutex;       // protects ws->send() from concurrent broadcasts
+    httplib::ws::WebSocket* ws = nullptr;  // non-owning, valid during handler lifetime; null for front-end clients
+    std::mutex send_mutex;       // protects ws->send() between sender thread and handler
     std::string username;        // populated from query token at handshake time
+
+    std::mutex outbox_mutex;
+    std::condition_variable outbox_cv;
+    std::deque<OutboundMessage> outbox;   // guarded by outbox_mutex
+    bool closing = false;                 // guarded by outbox_mutex
+    size_t dropped = 0;                   // guarded by outbox_mutex
+    std::thread sender;
+    std::function<void()> wake;           // front-end clients only
+
+    // Subscription (guarded by outbox_mutex). Defaults to everything; an
+    // empty job_ids set means all jobs.
+    uint32_t topics = TopicAll;
+    std::unordered_set<std::string> job_ids;
+    bool binary_previews = false;   // job_preview as binary frames with the JPEG inline
 };
 
+namespace {
+
+// Bounded per-client queue: a client that falls this far behind loses its
+// oldest droppable messages (or, failing that, its oldest message)
+constexpr size_t CLIENT_OUTBOX_MAX = 256;
+
+std::atomic<uint64_t> g_dropped_messages{0};   // Across all clients, for /metrics
+
+bool is_droppable(WSEventType type) {
+    return type == WSEventType::JobProgress ||
+           type == WSEventType::JobPreview ||
+           type == WSEventType::ModelLoadingProgress ||
+           type == WSEventType::MemoryStatus;
+}
+
+uint32_t topic_for(WSEventType type) {
+    switch (type) {
+        case WSEventType::JobProgress:
+        case WSEventType::JobPreview:
+            return TopicProgress;
+        case WSEventType::JobAdded:
+        case WSEventType::JobStatusChanged:
+        case WSEventType::JobCancelled:
+        case WSEventType::JobDeleted:
+        case WSEventType::JobRestored:
+            return TopicJobs;
+        case WSEventType::ModelLoadingProgress:
+        case WSEventType::ModelLoaded:
+        case WSEventType::ModelLoadFailed:
+        case WSEventType::ModelUnloaded:
+        case WSEventType::UpscalerLoaded:
+        case WSEventType::UpscalerUnloaded:
+            return TopicModels;
+        case WSEventType::ServerStatus:
+        case WSEventType::ServerShutdown:
+            return TopicServer;
+        case WSEventType::MemoryStatus:
+            return TopicMemory;
+    }
+    return TopicServer;
+}
+
+const std::pair<const char*, uint32_t> TOPIC_NAMES[] = {
+    {"jobs", TopicJobs},
+    {"progress", TopicProgress},
+    {"models", TopicModels},
+    {"server", TopicServer},
+    {"memory", TopicMemory}
+};
+
+nlohmann::json topics_to_json(uint32_t topics) {
+    nlohmann::json arr = nlohmann::json::array();
+    for (const auto& [name, bit] : TOPIC_NAMES) {
+        if (topics & bit) arr.push_back(name);
+    }
+    return arr;
+}
+
+// Whether a client wants an event. Caller holds client.outbox_mutex.
+bool wants_locked(const ClientConnection& client, uint32_t topic, const std::string& job_id) {
+    if (!(client.topics & topic)) return false;
+    if (!job_id.empty() && !client.job_ids.empty() && !client.job_ids.count(job_id)) return false;
+    return true;
+}
+
+// Append to the outbox, evicting when full. Caller holds client.outbox_mutex.
+void push_locked(ClientConnection& client, OutboundMessage&& msg) {
+    if (client.outbox.size() >= CLIENT_OUTBOX_MAX) {
+        auto victim = std::find_if(client.outbox.begin(), client.outbox.end(),
+            [](const OutboundMessage& m) { return m.droppable; });
+        if (victim == client.outbox.end()) victim = client.outbox.begin();
+        client.outbox.erase(victim);
+        client.dropped++;
+        g_dropped_messages.fetch_add(1, std::memory_order_relaxed);
+    }
+    client.outbox.push_back(std::move(msg));
+}
+
+void enqueue(ClientConnection& client, const std::shared_ptr<const std::string>& payload,
+             bool droppable, uint32_t topic, const std::string& job_id) {
+    {
+        std::lock_guard<std::mutex> lock(client.outbox_mutex);
+        if (client.closing || !wants_locked(client, topic, job_id)) return;
+        push_locked(client, OutboundMessage{payload, droppable, false});
+    }
+    client.outbox_cv.notify_one();
+    if (client.wake) client.wake();
+}
+
+void put_u16(std::string& buf, size_t off, uint16_t v) {
+    buf[off] = static_cast<char>(v & 0xff);
+    buf[off + 1] = static_cast<char>((v >> 8) & 0xff);
+}
+
+void put_u32(std::string& buf, size_t off, uint32_t v) {
+    for (int i = 0; i < 4; ++i) {
+        buf[off + i] = static_cast<char>((v >> (8 * i)) & 0xff);
+    }
+}
+
+// Binary preview frame: fixed little-endian header, then the JPEG bytes.
+// See "Binary Preview Frames" in docs/API.md.
+//   0  char[4]  "SDPV"
+//   4  u8       version (1)
+//   5  u8       flags (bit 0: is_noisy)
+//   6  u16      header length (64)
+//   8  u32      step
+//  12  u32      frame_count
+//  16  u32      width
+//  20  u32      height
+//  24  char[36] job id (ASCII, NUL-padded)
+//  60  u32      reserved (0)
+constexpr size_t PREVIEW_FRAME_HEADER = 64;
+constexpr size_t PREVIEW_FRAME_JOB_ID = 36;
+
+std::string encode_preview_frame(const nlohmann::json& data, const std::vector<uint8_t>& jpeg) {
+    std::string buf(PREVIEW_FRAME_HEADER + jpeg.size(), '\0');
+    buf[0] = 'S'; buf[1] = 'D'; buf[2] = 'P'; buf[3] = 'V';
+    buf[4] = 1;
+    buf[5] = data.value("is_noisy", false) ? 1 : 0;
+    put_u16(buf, 6, static_cast<uint16_t>(PREVIEW_FRAME_HEADER));
+    put_u32(buf, 8, static_cast<uint32_t>(std::max(0, data.value("step", 0))));
+    put_u32(buf, 12, static_cast<uint32_t>(std::max(0, data.value("frame_count", 0))));
+    put_u32(buf, 16, static_cast<uint32_t>(std::max(0, data.value("width", 0))));
+    put_u32(buf, 20, static_cast<uint32_t>(std::max(0, data.value("height", 0))));
+    const std::string job_id = data.value("job_id", "");
+    std::copy_n(job_id.begin(), std::min(job_id.size(), PREVIEW_FRAME_JOB_ID), buf.begin() + 24);
+    std::copy(jpeg.begin(), jpeg.end(), buf.begin() + PREVIEW_FRAME_HEADER);
+    return buf;
+}
+
+void sender_loop(ClientConnection* client) {
+    while (true) {
+        OutboundMessage msg;
+        {
+            std::unique_lock<std::mutex> lock(client->outbox_mutex);
+            client->outbox_cv.wait(lock, [client] {
+                return client->closing || !client->outbox.empty();
+            });
+            if (client->closing) return;
+            msg = std::move(client->outbox.front());
+            client->outbox.pop_front();
+        }
+        std::lock_guard<std::mutex> send_lock(client->send_mutex);
+        try {
+            if (msg.binary) {
+                client->ws->send(msg.payload->data(), msg.payload->size());
+            } else {
+                client->ws->send(*msg.payload);
+            }
+        } catch (...) {
+            // Ignore send errors - client will be cleaned up by its read loop
+        }
+    }
+}
+
+} // namespace
+
 // Global WebSocket server instance
 static WebSocketServer* g_websocket_server = nullptr;
 static StatusProviderCallback g_status_provider = nullptr;
 
+uint64_t WebSocketServer::dropped_messages_total() {
+    return g_dropped_messages.load(std::memory_order_relaxed);
+}
+
 WebSocketServer* get_websocket_server() {
     return g_websocket_server;
 }
@@ -64,63 +275,67 @@ void WebSocketServer::setup_endpoint(httplib::Server& server) {
         // have rejected unauthenticated handshakes with HTTP 401, but if
         // auth somehow slipped through (e.g. middleware ordering bug),
         // close the socket immediately with an auth-failure code.
-        std::string username;
-        if (auth_manager_ && auth_manager_->enabled()) {
-            // Try, in order: query token (?token=), Authorization: Bearer,
-            // and the sdcpp_auth cookie (set by /auth/login). Browser SPA
-            // uses the cookie path; curl/scripts use the Bearer header;
-            // legacy clients may pass ?token=.
-            std::string token = req.has_param("token")
-                ? req.get_param_value("token")
-                : "";
-            if (token.empty()) {
-                std::string auth_header = req.get_header_value("Authorization");
-                const std::string bearer_prefix = "Bearer ";
-                if (auth_header.size() > bearer_prefix.size() &&
-                    auth_header.compare(0, bearer_prefix.size(), bearer_prefix) == 0) {
-                    token = auth_header.substr(bearer_prefix.size());
-                }
-            }
-            if (token.empty()) {
-                // Cookie: sdcpp_auth=<token>; ...
-                std::string cookie_hdr = req.get_header_value("Cookie");
-                static const std::string key = "sdcpp_auth=";
-                size_t pos = 0;
-                while (pos < cookie_hdr.size()) {
-                    while (pos < cookie_hdr.size() &&
-                           (cookie_hdr[pos] == ' ' || cookie_hdr[pos] == '\t')) ++pos;
-                    size_t end = cookie_hdr.find(';', pos);
-                    if (end == std::string::npos) end = cookie_hdr.size();
-                    if (cookie_hdr.compare(pos, key.size(), key) == 0) {
-                        token = cookie_hdr.substr(pos + key.size(),
-                                                   end - (pos + key.size()));
-                        break;
-                    }
-                    pos = end + 1;
-                }
-            }
-            auto user = token.empty()
-                ? std::nullopt
-                : auth_manager_->verify_token(token);
-            if (!user.has_value()) {
-                // 4401 is the WebSocket "Unauthorized" application close code
-                // (private-use range; widely used by tooling for WS auth fails).
-                try {
-                    ws.close(static_cast<httplib::ws::CloseStatus>(4401),
-                             "Unauthorized");
-                } catch (...) {
-                    // Already closed — fine.
-                }
-                return;
+        auto username = authenticate(req);
+        if (!username) {
+            // 4401 is the WebSocket "Unauthorized" application close code
+            // (private-use range; widely used by tooling for WS auth fails).
+            try {
+                ws.close(static_cast<httplib::ws::CloseStatus>(4401),
+                         "Unauthorized");
+            } catch (...) {
+                // Already closed — fine.
             }
-            username = *user;
+            return;
         }
-        handle_connection(static_cast<void*>(&ws), username);
+        handle_connection(static_cast<void*>(&ws), *username);
     });
 #pragma GCC diagnostic pop
     std::cout << "[WebSocket] Registered /ws endpoint" << std::endl;
 }
 
+std::optional<std::string> WebSocketServer::authenticate(const httplib::Request& req) const {
+    if (!auth_manager_ || !auth_manager_->enabled()) {
+        return std::string();
+    }
+    // Try, in order: query token (?token=), Authorization: Bearer,
+    // and the sdcpp_auth cookie (set by /auth/login). Browser SPA
+    // uses the cookie path; curl/scripts use the Bearer header;
+    // legacy clients may pass ?token=.
+    std::string token = req.has_param("token")
+        ? req.get_param_value("token")
+        : "";
+    if (token.empty()) {
+        std::string auth_header = req.get_header_value("Authorization");
+        const std::string bearer_prefix = "Bearer ";
+        if (auth_header.size() > bearer_prefix.size() &&
+            auth_header.compare(0, bearer_prefix.size(), bearer_prefix) == 0) {
+            token = auth_header.substr(bearer_prefix.size());
+        }
+    }
+    if (token.empty()) {
+        // Cookie: sdcpp_auth=<token>; ...
+        std::string cookie_hdr = req.get_header_value("Cookie");
+        static const std::string key = "sdcpp_auth=";
+        size_t pos = 0;
+        while (pos < cookie_hdr.size()) {
+            while (pos < cookie_hdr.size() &&
+                   (cookie_hdr[pos] == ' ' || cookie_hdr[pos] == '\t')) ++pos;
+            size_t end = cookie_hdr.find(';', pos);
+            if (end == std::string::npos) end = cookie_hdr.size();
+            if (cookie_hdr.compare(pos, key.size(), key) == 0) {
+                token = cookie_hdr.substr(pos + key.size(),
+                                           end - (pos + key.size()));
+                break;
+            }
+            pos = end + 1;
+        }
+    }
+    if (token.empty()) {
+        return std::nullopt;
+    }
+    return auth_manager_->verify_token(token);
+}
+
 void WebSocketServer::start() {
     if (running_.load()) {
         return;
@@ -150,8 +365,20 @@ void WebSocketServer::stop() {
         };
         std::string msg_str = message.dump();
 
+        auto payload = std::make_shared<const std::string>(msg_str);
+
         std::lock_guard<std::mutex> lock(clients_mutex_);
         for (auto* client : clients_) {
+            if (!client->ws) {
+                // Front-end client: the loop flushes this and closes the
+                // socket when the front end stops
+                {
+                    std::lock_guard<std::mutex> qlock(client->outbox_mutex);
+                    push_locked(*client, OutboundMessage{payload, false, false});
+                }
+                if (client->wake) client->wake();
+                continue;
+            }
             std::lock_guard<std::mutex> send_lock(client->send_mutex);
             try {
                 client->ws->send(msg_str);
@@ -188,46 +415,24 @@ void WebSocketServer::handle_connection(void* ws_ptr, const std::string& usernam
               << ", total=" << client_count_.load() << ")" << std::endl;
 
     // Send current server status to new client
-    auto status = get_server_status();
+    const std::string status = status_message();
     if (!status.empty()) {
-        nlohmann::json response = {
-            {"event", "server_status"},
-            {"timestamp", format_timestamp(std::chrono::system_clock::now())},
-            {"data", status}
-        };
-        ws.send(response.dump());
+        std::lock_guard<std::mutex> send_lock(client.send_mutex);
+        ws.send(status);
     }
 
+    client.sender = std::thread(sender_loop, &client);
+
     // Read loop - blocks until message arrives or connection closes
     std::string msg;
     while (ws.is_open() && !should_stop_.load()) {
         auto result = ws.read(msg);
 
         if (result == httplib::ws::Text) {
-            // Handle incoming text messages
-            try {
-                auto j = nlohmann::json::parse(msg);
-                std::string type = j.value("type", "");
-
-                if (type == "ping") {
-                    nlohmann::json response = {
-                        {"event", "pong"},
-                        {"timestamp", format_timestamp(std::chrono::system_clock::now())}
-                    };
-                    std::lock_guard<std::mutex> send_lock(client.send_mutex);
-                    ws.send(response.dump());
-                } else if (type == "get_status") {
-                    auto srv_status = get_server_status();
-                    nlohmann::json response = {
-                        {"event", "server_status"},
-                        {"timestamp", format_timestamp(std::chrono::system_clock::now())},
-                        {"data", srv_status}
-                    };
-                    std::lock_guard<std::mutex> send_lock(client.send_mutex);
-                    ws.send(response.dump());
-                }
-            } catch (const std::exception& /*e*/) {
-                // Ignore malformed messages
+            const std::string reply = reply_to(client, msg);
+            if (!reply.empty()) {
+                std::lock_guard<std::mutex> send_lock(client.send_mutex);
+                ws.send(reply);
             }
         } else if (result == httplib::ws::Fail) {
             // Connection closed or error
@@ -246,12 +451,206 @@ void WebSocketServer::handle_connection(void* ws_ptr, const std::string& usernam
         client_count_.store(clients_.size());
     }
 
+    // No broadcast can reach the client any more; stop its sender
+    size_t dropped;
+    {
+        std::lock_guard<std::mutex> lock(client.outbox_mutex);
+        client.closing = true;
+        client.outbox.clear();
+        dropped = client.dropped;
+    }
+    client.outbox_cv.notify_one();
+    if (client.sender.joinable()) {
+        client.sender.join();
+    }
+
     std::cout << "[WebSocket] Client disconnected (id=" << client_id
-              << ", total=" << client_count_.load() << ")" << std::endl;
+              << ", total=" << client_count_.load()
+              << (dropped ? ", dropped " + std::to_string(dropped) + " queued messages" : "")
+              << ")" << std::endl;
+}
+
+std::string WebSocketServer::status_message() {
+    auto status = get_server_status();
+    if (status.empty()) {
+        return "";
+    }
+    nlohmann::json message = {
+        {"event", "server_status"},
+        {"timestamp", format_timestamp(std::chrono::system_clock::now())},
+        {"data", status}
+    };
+    return message.dump();
+}
+
+std::string WebSocketServer::reply_to(ClientConnection& client, const std::string& text) {
+    try {
+        auto j = nlohmann::json::parse(text);
+        std::string type = j.value("type", "");
+
+        if (type == "ping") {
+            nlohmann::json response = {
+                {"event", "pong"},
+                {"timestamp", format_timestamp(std::chrono::system_clock::now())}
+            };
+            return response.dump();
+        }
+        if (type == "get_status") {
+            nlohmann::json response = {
+                {"event", "server_status"},
+                {"timestamp", format_timestamp(std::chrono::system_clock::now())},
+                {"data", get_server_status()}
+            };
+            return response.dump();
+        }
+        if (type == "subscribe") {
+            // {"type":"subscribe","topics":[...],"job_ids":[...]}
+            // replaces the subscription; omitted fields mean "all"
+            uint32_t topics = TopicAll;
+            std::unordered_set<std::string> job_ids;
+            nlohmann::json unknown = nlohmann::json::array();
+            if (j.contains("topics") && j["topics"].is_array()) {
+                topics = 0;
+                for (const auto& t : j["topics"]) {
+                    if (!t.is_string()) continue;
+                    const std::string name = t.get<std::string>();
+                    bool found = false;
+                    for (const auto& [topic_name, bit] : TOPIC_NAMES) {
+                        if (name == topic_name) {
+                            topics |= bit;
+                            found = true;
+                        }
+                    }
+                    if (!found) unknown.push_back(name);
+                }
+            }
+            if (j.contains("job_ids") && j["job_ids"].is_array()) {
+                for (const auto& id : j["job_ids"]) {
+                    if (id.is_string()) job_ids.insert(id.get<std::string>());
+                }
+            }
+
+            const bool binary_previews =
+                j.contains("binary_previews") && j["binary_previews"].is_boolean() &&
+                j["binary_previews"].get<bool>();
+
+            nlohmann::json data = {
+                {"topics", topics_to_json(topics)},
+                {"job_ids", job_ids},
+                {"binary_previews", binary_previews}
+            };
+            if (!unknown.empty()) data["unknown_topics"] = unknown;
+            {
+                std::lock_guard<std::mutex> lock(client.outbox_mutex);
+                client.topics = topics;
+                client.job_ids = std::move(job_ids);
+                client.binary_previews = binary_previews;
+            }
+
+            nlohmann::json response = {
+                {"event", "subscribed"},
+                {"timestamp", format_timestamp(std::chrono::system_clock::now())},
+                {"data", data}
+            };
+            return response.dump();
+        }
+    } catch (const std::exception& /*e*/) {
+        // Ignore malformed messages
+    }
+    return "";
+}
+
+std::optional<size_t> WebSocketServer::open_client(const httplib::Request& handshake,
+                                                   std::function<void()> wake) {
+    auto username = authenticate(handshake);
+    if (!username) {
+        return std::nullopt;
+    }
+
+    auto client = std::make_unique<ClientConnection>();
+    client->username = *username;
+    client->wake = std::move(wake);
+    const std::string status = status_message();
+    if (!status.empty()) {
+        client->outbox.push_back(OutboundMessage{std::make_shared<const std::string>(status), false, false});
+    }
+
+    size_t client_id;
+    {
+        std::lock_guard<std::mutex> lock(clients_mutex_);
+        client->id = next_client_id_++;
+        client_id = client->id;
+        clients_.push_back(client.get());
+        front_end_clients_.emplace(client_id, std::move(client));
+        client_count_.store(clients_.size());
+    }
+
+    std::cout << "[WebSocket] Client connected (id=" << client_id
+              << (username->empty() ? "" : (", user=" + *username))
+              << ", total=" << client_count_.load() << ", event loop)" << std::endl;
+    return client_id;
+}
+
+void WebSocketServer::client_message(size_t id, const std::string& text) {
+    // Only close_client() removes the entry, and it runs on the caller's
+    // thread, so the pointer stays valid after the lock is dropped
+    ClientConnection* client;
+    {
+        std::lock_guard<std::mutex> lock(clients_mutex_);
+        auto it = front_end_clients_.find(id);
+        if (it == front_end_clients_.end()) return;
+        client = it->second.get();
+    }
+    const std::string reply = reply_to(*client, text);
+    if (reply.empty()) return;
+    {
+        std::lock_guard<std::mutex> lock(client->outbox_mutex);
+        push_locked(*client, OutboundMessage{std::make_shared<const std::string>(reply), false, false});
+    }
+    client->wake();
+}
+
+bool WebSocketServer::next_message(size_t id, std::shared_ptr<const std::string>& payload, bool& binary) {
+    std::lock_guard<std::mutex> lock(clients_mutex_);
+    auto it = front_end_clients_.find(id);
+    if (it == front_end_clients_.end()) return false;
+    ClientConnection& client = *it->second;
+    std::lock_guard<std::mutex> qlock(client.outbox_mutex);
+    if (client.outbox.empty()) return false;
+    payload = std::move(client.outbox.front().payload);
+    binary = client.outbox.front().binary;
+    client.outbox.pop_front();
+    return true;
+}
+
+void WebSocketServer::close_client(size_t id) {
+    std::unique_ptr<ClientConnection> client;
+    {
+        std::lock_guard<std::mutex> lock(clients_mutex_);
+        auto it = front_end_clients_.find(id);
+        if (it == front_end_clients_.end()) return;
+        client = std::move(it->second);
+        front_end_clients_.erase(it);
+        clients_.erase(std::remove(clients_.begin(), clients_.end(), client.get()), clients_.end());
+        client_count_.store(clients_.size());
+    }
+    // No broadcast can reach the client any more
+    size_t dropped;
+    {
+        std::lock_guard<std::mutex> lock(client->outbox_mutex);
+        client->closing = true;
+        client->outbox.clear();
+        dropped = client->dropped;
+    }
+
+    std::cout << "[WebSocket] Client disconnected (id=" << id
+              << ", total=" << client_count_.load()
+              << (dropped ? ", dropped " + std::to_string(dropped) + " queued messages" : "")
+              << ")" << std::endl;
 }
 
 void WebSocketServer::broadcast(WSEventType type, const nlohmann::json& data) {
-    if (!running_.load()) {
+    if (!running_.load() || client_count_.load() == 0) {
         return;
     }
 
@@ -264,22 +663,96 @@ void WebSocketServer::broadcast(WSEventType type, const nlohmann::json& data) {
         last_progress_broadcast_ = now;
     }
 
+    const int64_t trace_t0 = JobTrace::enabled() ? JobTrace::now_us() : 0;
+
     // Build JSON message once
     nlohmann::json message = {
         {"event", event_type_to_string(type)},
         {"timestamp", format_timestamp(std::chrono::system_clock::now())},
         {"data", data}
     };
-    std::string msg_str = message.dump();
+    // Serialized once; every client's queue holds a reference, not a copy
+    auto payload = std::make_shared<const std::string>(message.dump());
+
+    // Queue for every subscribed client; their sender threads do the sends
+    const bool droppable = is_droppable(type);
+    const uint32_t topic = topic_for(type);
+    std::string job_id;
+    if (data.is_object() && data.contains("job_id") && data["job_id"].is_string()) {
+        job_id = data["job_id"].get<std::string>();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(clients_mutex_);
+        for (auto* client : clients_) {
+            enqueue(*client, payload, droppable, topic, job_id);
+        }
+    }
 
-    // Send to all connected clients
+    if (trace_t0 && !job_id.empty()) {
+        if (auto trace = JobTrace::find(job_id)) {
+            trace->complete("ws " + event_type_to_string(type), "websocket", trace_t0, JobTrace::now_us());
+        }
+    }
+}
+
+bool WebSocketServer::wants_previews(const std::string& job_id) const {
+    if (!running_.load() || client_count_.load() == 0) {
+        return false;
+    }
     std::lock_guard<std::mutex> lock(clients_mutex_);
     for (auto* client : clients_) {
-        std::lock_guard<std::mutex> send_lock(client->send_mutex);
-        try {
-            client->ws->send(msg_str);
-        } catch (...) {
-            // Ignore send errors - client will be cleaned up by its read loop
+        std::lock_guard<std::mutex> qlock(client->outbox_mutex);
+        if (!client->closing && wants_locked(*client, TopicProgress, job_id)) return true;
+    }
+    return false;
+}
+
+void WebSocketServer::broadcast_preview(const nlohmann::json& data,
+                                        const std::shared_ptr<const std::vector<uint8_t>>& jpeg) {
+    if (!running_.load() || client_count_.load() == 0) {
+        return;
+    }
+
+    const std::string job_id = data.value("job_id", "");
+    const bool have_jpeg = jpeg && !jpeg->empty();
+    const int64_t trace_t0 = JobTrace::enabled() ? JobTrace::now_us() : 0;
+
+    // Each representation is built at most once, and only if some client
+    // wants it
+    std::shared_ptr<const std::string> json_payload;
+    std::shared_ptr<const std::string> binary_payload;
+
+    std::lock_guard<std::mutex> lock(clients_mutex_);
+    for (auto* client : clients_) {
+        {
+            std::lock_guard<std::mutex> qlock(client->outbox_mutex);
+            if (client->closing || !wants_locked(*client, TopicProgress, job_id)) continue;
+
+            if (client->binary_previews && have_jpeg) {
+                if (!binary_payload) {
+                    binary_payload = std::make_shared<const std::string>(encode_preview_frame(data, *jpeg));
+                }
+                push_locked(*client, OutboundMessage{binary_payload, true, true});
+            } else {
+                if (!json_payload) {
+                    nlohmann::json message = {
+                        {"event", event_type_to_string(WSEventType::JobPreview)},
+                        {"timestamp", format_timestamp(std::chrono::system_clock::now())},
+                        {"data", data}
+                    };
+                    json_payload = std::make_shared<const std::string>(message.dump());
+                }
+                push_locked(*client, OutboundMessage{json_payload, true, false});
+            }
+        }
+        client->outbox_cv.notify_one();
+        if (client->wake) client->wake();
+    }
+
+    if (trace_t0 && !job_id.empty()) {
+        if (auto trace = JobTrace::find(job_id)) {
+            trace->complete("ws job_preview", "websocket", trace_t0, JobTrace::now_us());
         }
     }
 }
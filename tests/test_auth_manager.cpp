@@ -0,0 +1,122 @@
+#include "auth_manager.hpp"
+#include "config.hpp"
+#include "test_common.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using sdcpp::AuthManager;
+
+namespace {
+
+sdcpp::Config auth_config() {
+    sdcpp::Config config;
+    config.auth.enabled = true;
+    config.auth.username = "admin";
+    config.auth.password = "secret";
+    return config;
+}
+
+void test_public_paths() {
+    // Exact paths
+    CHECK(AuthManager::is_always_allowed("/health"));
+    CHECK(AuthManager::is_always_allowed("/"));
+    CHECK(AuthManager::is_always_allowed("/auth/login"));
+    CHECK(AuthManager::is_always_allowed("/ui"));
+    CHECK(!AuthManager::is_always_allowed("/health/"));
+    CHECK(!AuthManager::is_always_allowed("/healthz"));
+    CHECK(!AuthManager::is_always_allowed("/auth"));
+    CHECK(!AuthManager::is_always_allowed(""));
+
+    // Prefixes match everything below them, and themselves
+    CHECK(AuthManager::is_always_allowed("/ui/"));
+    CHECK(AuthManager::is_always_allowed("/ui/assets/index.js"));
+    CHECK(AuthManager::is_always_allowed("/docs/API.md"));
+    CHECK(AuthManager::is_always_allowed("/webdav/models/a.safetensors"));
+    CHECK(!AuthManager::is_always_allowed("/uix"));
+    CHECK(!AuthManager::is_always_allowed("/webdav"));
+
+    // Not public
+    CHECK(!AuthManager::is_always_allowed("/queue"));
+    CHECK(!AuthManager::is_always_allowed("/output/a/b.png"));
+    CHECK(!AuthManager::is_always_allowed("/txt2img"));
+
+    // Every listed path matches
+    for (const auto& p : AuthManager::always_allowed_exact_paths()) CHECK(AuthManager::is_always_allowed(p));
+    for (const auto& p : AuthManager::always_allowed_path_prefixes()) {
+        CHECK(AuthManager::is_always_allowed(p + "x"));
+    }
+}
+
+void test_tokens() {
+    AuthManager auth(auth_config());
+    CHECK(auth.enabled());
+
+    const std::string token = auth.issue_token("admin");
+    CHECK(token.size() >= 40);
+    auto user = auth.verify_token(token);
+    CHECK(user.has_value() && *user == "admin");
+    CHECK(!auth.verify_token(token + "x").has_value());
+    CHECK(!auth.verify_token("").has_value());
+
+    auth.revoke_token(token);
+    CHECK(!auth.verify_token(token).has_value());
+    auth.revoke_token(token);   // Unknown: no-op
+}
+
+void test_tokens_across_shards() {
+    AuthManager auth(auth_config());
+    std::vector<std::string> tokens;
+    for (int i = 0; i < 200; ++i) tokens.push_back(auth.issue_token("user" + std::to_string(i)));
+
+    // Concurrent verification, with revocations going on in other shards
+    std::atomic<int> mismatches{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&, t] {
+            for (int round = 0; round < 50; ++round) {
+                for (size_t i = static_cast<size_t>(t); i < 100; i += 4) {
+                    auto user = auth.verify_token(tokens[i]);
+                    if (!user || *user != "user" + std::to_string(i)) mismatches++;
+                }
+            }
+        });
+    }
+    for (size_t i = 100; i < tokens.size(); ++i) auth.revoke_token(tokens[i]);
+    for (auto& thread : threads) thread.join();
+
+    CHECK_EQ(mismatches.load(), 0);
+    for (size_t i = 100; i < tokens.size(); ++i) CHECK(!auth.verify_token(tokens[i]).has_value());
+}
+
+void test_credentials() {
+    AuthManager auth(auth_config());
+    CHECK(auth.verify_credentials("admin", "secret"));
+    CHECK(!auth.verify_credentials("admin", "secrets"));
+
+    sdcpp::Config missing;
+    missing.auth.enabled = true;
+    bool threw = false;
+    if (std::getenv("SDCPP_AUTH_USERNAME") == nullptr) {
+        try {
+            AuthManager bad(missing);
+        } catch (const std::runtime_error&) {
+            threw = true;
+        }
+        CHECK(threw);
+    }
+}
+
+} // namespace
+
+int main() {
+    test_public_paths();
+    test_tokens();
+    test_tokens_across_shards();
+    test_credentials();
+    return sdcpp_test::finish("test_auth_manager");
+}
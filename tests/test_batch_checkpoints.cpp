@@ -0,0 +1,89 @@
+#include "batch_checkpoints.hpp"
+#include "test_common.hpp"
+
+#include <set>
+#include <string>
+#include <vector>
+
+using sdcpp::BatchCheckpoints;
+
+namespace {
+
+void test_next_call() {
+    // No estimate: the whole rest in one call, never a 1 + rest split
+    CHECK_EQ(BatchCheckpoints::next_call(8, 0.0, 120.0), 8);
+    CHECK_EQ(BatchCheckpoints::next_call(8, -1.0, 120.0), 8);
+
+    // Fits the interval: one call
+    CHECK_EQ(BatchCheckpoints::next_call(8, 15.0, 120.0), 8);
+    CHECK_EQ(BatchCheckpoints::next_call(4, 10.0, 120.0), 4);
+
+    // Too long: as many as fit, at least one
+    CHECK_EQ(BatchCheckpoints::next_call(8, 40.0, 120.0), 3);
+    CHECK_EQ(BatchCheckpoints::next_call(8, 500.0, 120.0), 1);
+
+    // Nothing or one left
+    CHECK_EQ(BatchCheckpoints::next_call(1, 500.0, 120.0), 1);
+    CHECK_EQ(BatchCheckpoints::next_call(0, 40.0, 120.0), 0);
+}
+
+void test_resume_point() {
+    const std::vector<std::string> outputs{"j/output_0.png", "j/output_1.png", "j/output_2.png", "j/output_3.png"};
+    std::set<std::string> disk{"j/output_0.png", "j/output_1.png", "j/output_3.png"};
+    auto exists = [&](const std::string& out) { return disk.count(out) > 0; };
+
+    // A gap: resume at the first missing image, even with later ones on disk
+    CHECK_EQ(BatchCheckpoints::resume_point(outputs, 4, exists), 2);
+    // Only the recorded images count
+    CHECK_EQ(BatchCheckpoints::resume_point(outputs, 1, exists), 1);
+    CHECK_EQ(BatchCheckpoints::resume_point(outputs, 0, exists), 0);
+    // Recorded more images than outputs listed (torn record)
+    disk.insert("j/output_2.png");
+    CHECK_EQ(BatchCheckpoints::resume_point(outputs, 9, exists), 4);
+    disk.clear();
+    CHECK_EQ(BatchCheckpoints::resume_point(outputs, 4, exists), 0);
+    CHECK_EQ(BatchCheckpoints::resume_point({}, 3, exists), 0);
+}
+
+void test_estimates_are_per_key() {
+    BatchCheckpoints estimates;
+    const std::string small = BatchCheckpoints::key("sdxl", 512, 512);
+    const std::string large = BatchCheckpoints::key("sdxl", 1024, 1024);
+    CHECK_EQ(small, std::string("sdxl@512x512"));
+
+    CHECK_EQ(estimates.seconds_per_step(small), 0.0);
+    estimates.record(small, 40.0, 2, 20);      // 2 images x 20 steps in 40 s
+    CHECK_NEAR(estimates.seconds_per_step(small), 1.0, 1e-9);
+    CHECK_EQ(estimates.seconds_per_step(large), 0.0);
+    CHECK_EQ(estimates.seconds_per_step(BatchCheckpoints::key("flux", 512, 512)), 0.0);
+
+    // The last call wins; empty calls are ignored
+    estimates.record(small, 10.0, 1, 20);
+    CHECK_NEAR(estimates.seconds_per_step(small), 0.5, 1e-9);
+    estimates.record(small, 0.0, 1, 20);
+    estimates.record(small, 10.0, 0, 20);
+    CHECK_NEAR(estimates.seconds_per_step(small), 0.5, 1e-9);
+
+    CHECK(estimates.stats_json().contains(small));
+    CHECK(!estimates.stats_json().contains(large));
+}
+
+void test_oldest_key_evicted() {
+    BatchCheckpoints estimates;
+    for (size_t i = 0; i <= BatchCheckpoints::MAX_KEYS; ++i) {
+        estimates.record(BatchCheckpoints::key("m" + std::to_string(i), 512, 512), 1.0, 1, 1);
+    }
+    CHECK_EQ(estimates.stats_json().size(), BatchCheckpoints::MAX_KEYS);
+    CHECK_EQ(estimates.seconds_per_step(BatchCheckpoints::key("m0", 512, 512)), 0.0);
+    CHECK_NEAR(estimates.seconds_per_step(BatchCheckpoints::key("m1", 512, 512)), 1.0, 1e-9);
+}
+
+} // namespace
+
+int main() {
+    test_next_call();
+    test_resume_point();
+    test_estimates_are_per_key();
+    test_oldest_key_evicted();
+    return sdcpp_test::finish("test_batch_checkpoints");
+}
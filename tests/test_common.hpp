@@ -0,0 +1,47 @@
+#pragma once
+
+// Minimal checks for the unit tests: no framework to fetch, and each test
+// binary is a plain ctest executable that fails with a non-zero exit.
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+namespace sdcpp_test {
+
+inline int& failures() {
+    static int count = 0;
+    return count;
+}
+
+inline int finish(const char* name) {
+    if (failures() == 0) {
+        std::cout << "[" << name << "] OK" << std::endl;
+        return EXIT_SUCCESS;
+    }
+    std::cerr << "[" << name << "] " << failures() << " check(s) failed" << std::endl;
+    return EXIT_FAILURE;
+}
+
+} // namespace sdcpp_test
+
+#define CHECK(cond)                                                                         \
+    do {                                                                                    \
+        if (!(cond)) {                                                                      \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK(" #cond ") failed" << std::endl; \
+            ++sdcpp_test::failures();                                                       \
+        }                                                                                   \
+    } while (0)
+
+#define CHECK_EQ(a, b)                                                                      \
+    do {                                                                                    \
+        const auto& check_a_ = (a);                                                         \
+        const auto& check_b_ = (b);                                                         \
+        if (!(check_a_ == check_b_)) {                                                      \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK_EQ(" #a ", " #b ") failed: " \
+                      << check_a_ << " != " << check_b_ << std::endl;                       \
+            ++sdcpp_test::failures();                                                       \
+        }                                                                                   \
+    } while (0)
+
+#define CHECK_NEAR(a, b, eps) CHECK(std::fabs((a) - (b)) <= (eps))
@@ -0,0 +1,92 @@
+#include "conditioning_cache.hpp"
+#include "test_common.hpp"
+
+#include <string>
+
+using sdcpp::ConditioningCache;
+
+namespace {
+
+void test_hit_and_miss() {
+    ConditioningCache cache(1024);
+    CHECK(cache.find("a") == nullptr);
+
+    cache.insert("a", "blob-a");
+    auto blob = cache.find("a");
+    CHECK(blob != nullptr);
+    if (blob) CHECK_EQ(*blob, std::string("blob-a"));
+
+    auto stats = cache.stats_json();
+    CHECK_EQ(stats["hits"].get<int>(), 1);
+    CHECK_EQ(stats["misses"].get<int>(), 1);
+    CHECK_EQ(stats["entries"].get<int>(), 1);
+    CHECK_EQ(stats["used_bytes"].get<int>(), 7);
+}
+
+void test_least_recently_used_evicted() {
+    // Each entry is 1 + 9 bytes; three fit
+    ConditioningCache cache(30);
+    cache.insert("a", std::string(9, 'a'));
+    cache.insert("b", std::string(9, 'b'));
+    cache.insert("c", std::string(9, 'c'));
+    CHECK(cache.find("a") != nullptr);  // b is now the oldest
+
+    cache.insert("d", std::string(9, 'd'));
+    CHECK(cache.find("b") == nullptr);
+    CHECK(cache.find("a") != nullptr);
+    CHECK(cache.find("c") != nullptr);
+    CHECK(cache.find("d") != nullptr);
+
+    auto stats = cache.stats_json();
+    CHECK_EQ(stats["evictions"].get<int>(), 1);
+    CHECK(stats["used_bytes"].get<int>() <= 30);
+}
+
+void test_replace_and_oversized() {
+    ConditioningCache cache(16);
+    cache.insert("k", "12345");
+    cache.insert("k", "1234567890");
+    auto blob = cache.find("k");
+    CHECK(blob != nullptr);
+    if (blob) CHECK_EQ(blob->size(), static_cast<size_t>(10));
+    CHECK_EQ(cache.stats_json()["used_bytes"].get<int>(), 11);
+
+    // Larger than the whole budget: not kept, and nothing is evicted for it
+    cache.insert("big", std::string(64, 'x'));
+    CHECK(cache.find("big") == nullptr);
+    CHECK(cache.find("k") != nullptr);
+}
+
+void test_blob_outlives_eviction() {
+    ConditioningCache cache(10);
+    cache.insert("a", "12345678");
+    auto held = cache.find("a");
+    cache.insert("b", "87654321");
+    CHECK(cache.find("a") == nullptr);
+    CHECK(held != nullptr);
+    if (held) CHECK_EQ(*held, std::string("12345678"));
+}
+
+void test_disabled_and_clear() {
+    ConditioningCache off(0);
+    CHECK(!off.enabled());
+    off.insert("a", "x");
+    CHECK(off.find("a") == nullptr);
+
+    ConditioningCache cache(100);
+    cache.insert("a", "x");
+    cache.clear();
+    CHECK(cache.find("a") == nullptr);
+    CHECK_EQ(cache.stats_json()["used_bytes"].get<int>(), 0);
+}
+
+} // namespace
+
+int main() {
+    test_hit_and_miss();
+    test_least_recently_used_evicted();
+    test_replace_and_oversized();
+    test_blob_outlives_eviction();
+    test_disabled_and_clear();
+    return sdcpp_test::finish("test_conditioning_cache");
+}
@@ -0,0 +1,139 @@
+#include "docs_index.hpp"
+#include "test_common.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+using sdcpp::DocsIndex;
+namespace fs = std::filesystem;
+
+namespace {
+
+fs::path fresh_dir(const std::string& name) {
+    const fs::path dir = fs::temp_directory_path() / ("sdcpp_test_" + name + "_" + std::to_string(::getpid()));
+    fs::remove_all(dir);
+    fs::create_directories(dir / "docs");
+    return dir;
+}
+
+void write(const fs::path& path, const std::string& text) {
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << text;
+}
+
+// doc > section path | content, per result
+std::vector<std::string> results(const DocsIndex& index, const std::string& query) {
+    std::vector<std::string> out;
+    for (const auto& r : index.search(query, 5)) {
+        out.push_back(r.doc_filename + " > " + r.section_path + " | " + r.content);
+    }
+    return out;
+}
+
+void write_docs(const fs::path& docs) {
+    write(docs / "AUTH.md",
+          "# Auth\n\n## Login\n\nPOST credentials to /auth/login for a bearer token.\n\n"
+          "## Tokens\n\nTokens expire after the configured token lifetime.\n");
+    write(docs / "RUNPOD.md",
+          "# RunPod\n\n## Choosing a GPU\n\nPick a GPU with enough VRAM for the model.\n\n"
+          "### Bootstrap profiles\n\nProfiles download models on first boot.\n");
+    write(docs / "notes.txt", "not markdown: bearer token");
+}
+
+void test_search_without_cache() {
+    const fs::path dir = fresh_dir("docs_plain");
+    write_docs(dir / "docs");
+    DocsIndex index((dir / "docs").string());
+    CHECK(index.chunk_count() >= 4);
+
+    const auto login = index.search("bearer token login", 3);
+    CHECK(!login.empty());
+    if (!login.empty()) {
+        CHECK_EQ(login[0].doc_filename, std::string("AUTH.md"));
+        CHECK_EQ(login[0].section, std::string("Login"));
+    }
+    const auto boot = index.search("bootstrap profiles", 3);
+    CHECK(!boot.empty());
+    if (!boot.empty()) CHECK(boot[0].section_path.find("Bootstrap profiles") != std::string::npos);
+    CHECK(index.search("zzzunknownterm").empty());
+    CHECK(index.search("").empty());
+
+    DocsIndex missing((dir / "nope").string());
+    CHECK_EQ(missing.chunk_count(), 0u);
+    CHECK(missing.search("token").empty());
+    fs::remove_all(dir);
+}
+
+void test_cache_round_trip() {
+    const fs::path dir = fresh_dir("docs_cache");
+    const fs::path docs = dir / "docs";
+    const std::string cache = (dir / "docs_index.bin").string();
+    write_docs(docs);
+
+    const DocsIndex fresh(docs.string());
+    const std::vector<std::string> queries{"bearer token", "gpu vram model", "bootstrap profiles download"};
+
+    {
+        DocsIndex built(docs.string(), cache);
+        CHECK(fs::exists(cache));
+        for (const auto& q : queries) CHECK(results(built, q) == results(fresh, q));
+    }
+
+    // Served from the mapped cache
+    const auto cache_mtime = fs::last_write_time(cache);
+    {
+        DocsIndex cached(docs.string(), cache);
+        CHECK_EQ(cached.chunk_count(), fresh.chunk_count());
+        for (const auto& q : queries) CHECK(results(cached, q) == results(fresh, q));
+    }
+    CHECK(fs::last_write_time(cache) == cache_mtime);   // Unchanged corpus: not rewritten
+
+    // A changed file is re-read; a removed one drops out
+    write(docs / "AUTH.md", "# Auth\n\n## Sessions\n\nA session cookie replaces the header.\n");
+    fs::last_write_time(docs / "AUTH.md", fs::last_write_time(docs / "AUTH.md") + std::chrono::seconds(2));
+    fs::remove(docs / "RUNPOD.md");
+    {
+        DocsIndex updated(docs.string(), cache);
+        const auto hits = updated.search("session cookie", 3);
+        CHECK(!hits.empty());
+        if (!hits.empty()) CHECK_EQ(hits[0].section, std::string("Sessions"));
+        CHECK(updated.search("bootstrap profiles").empty());
+        CHECK(updated.search("bearer").empty());
+    }
+    fs::remove_all(dir);
+}
+
+void test_damaged_cache() {
+    const fs::path dir = fresh_dir("docs_damaged");
+    const fs::path docs = dir / "docs";
+    const std::string cache = (dir / "docs_index.bin").string();
+    write_docs(docs);
+    const DocsIndex fresh(docs.string());
+    { DocsIndex built(docs.string(), cache); }
+
+    // Cut mid-record, then plain garbage: both rebuild from the markdown
+    fs::resize_file(cache, fs::file_size(cache) / 2);
+    {
+        DocsIndex cut(docs.string(), cache);
+        CHECK(results(cut, "bearer token") == results(fresh, "bearer token"));
+    }
+    write(cache, std::string(64, '\x7f'));
+    {
+        DocsIndex garbage(docs.string(), cache);
+        CHECK(results(garbage, "gpu vram") == results(fresh, "gpu vram"));
+    }
+    fs::remove_all(dir);
+}
+
+} // namespace
+
+int main() {
+    test_search_without_cache();
+    test_cache_round_trip();
+    test_damaged_cache();
+    return sdcpp_test::finish("test_docs_index");
+}
@@ -0,0 +1,206 @@
+#include "http_front_end.hpp"
+#include "url_utils.hpp"
+#include "test_common.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+using sdcpp::HttpFrontEnd;
+
+namespace {
+
+// A free loopback port (bound once, then released for the real listener)
+int free_port() {
+    const int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    ::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+    socklen_t len = sizeof(addr);
+    ::getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &len);
+    ::close(fd);
+    return ntohs(addr.sin_port);
+}
+
+int connect_to(int port) {
+    const int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    timeval timeout{5, 0};
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    for (int attempt = 0; attempt < 50; ++attempt) {
+        if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0) return fd;
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    ::close(fd);
+    return -1;
+}
+
+std::string read_until_close(int fd) {
+    std::string out;
+    char buf[4096];
+    ssize_t n;
+    while ((n = ::recv(fd, buf, sizeof(buf), 0)) > 0) out.append(buf, static_cast<size_t>(n));
+    return out;
+}
+
+// Stand-in for httplib: records each request head and answers "ok"
+class Backend {
+public:
+    explicit Backend(int port) {
+        fd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+        const int one = 1;
+        ::setsockopt(fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(static_cast<uint16_t>(port));
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        ::bind(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+        ::listen(fd_, 16);
+        thread_ = std::thread([this] { run(); });
+    }
+
+    ~Backend() {
+        stopping_ = true;
+        ::shutdown(fd_, SHUT_RDWR);
+        ::close(fd_);
+        thread_.join();
+    }
+
+    std::vector<std::string> heads() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return heads_;
+    }
+
+private:
+    void run() {
+        while (!stopping_) {
+            const int c = ::accept(fd_, nullptr, nullptr);
+            if (c < 0) break;
+            std::string head;
+            char buf[4096];
+            ssize_t n;
+            while (head.find("\r\n\r\n") == std::string::npos && (n = ::recv(c, buf, sizeof(buf), 0)) > 0) {
+                head.append(buf, static_cast<size_t>(n));
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                heads_.push_back(head.substr(0, head.find("\r\n\r\n")));
+            }
+            const std::string response = "HTTP/1.1 200 OK\r\nContent-Length: 2\r\nConnection: close\r\n\r\nok";
+            ::send(c, response.data(), response.size(), MSG_NOSIGNAL);
+            ::close(c);
+        }
+    }
+
+    int fd_ = -1;
+    std::atomic<bool> stopping_{false};
+    std::thread thread_;
+    std::mutex mutex_;
+    std::vector<std::string> heads_;
+};
+
+std::string lower(std::string s) {
+    std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return s;
+}
+
+// Header lines of `head` named `name` (case-insensitive), values trimmed of the leading space
+std::vector<std::string> header_values(const std::string& head, const std::string& name) {
+    std::vector<std::string> values;
+    const std::string prefix = lower(name) + ":";
+    size_t pos = 0;
+    while (pos < head.size()) {
+        size_t end = head.find("\r\n", pos);
+        if (end == std::string::npos) end = head.size();
+        const std::string line = head.substr(pos, end - pos);
+        if (lower(line.substr(0, prefix.size())) == prefix) {
+            std::string value = line.substr(prefix.size());
+            values.push_back(value.substr(value.find_first_not_of(' ')));
+        }
+        pos = end + 2;
+    }
+    return values;
+}
+
+// Send a raw request through the front end; the response, status line first
+std::string exchange(int port, const std::string& request) {
+    const int fd = connect_to(port);
+    if (fd < 0) return "";
+    ::send(fd, request.data(), request.size(), MSG_NOSIGNAL);
+    std::string response = read_until_close(fd);
+    ::close(fd);
+    return response;
+}
+
+int status_of(const std::string& response) {
+    if (response.size() < 12 || response.compare(0, 5, "HTTP/") != 0) return 0;
+    return std::stoi(response.substr(9, 3));
+}
+
+void test_framing_and_peer_header() {
+    sdcpp::FrontEndOptions options;
+    options.host = "127.0.0.1";
+    options.port = free_port();
+    options.backend_port = free_port();
+    options.header_timeout_sec = 5;
+
+    Backend backend(options.backend_port);
+    HttpFrontEnd fe(options);
+    fe.start();
+
+    // A body framed both ways is a smuggling vector: refused, never forwarded
+    CHECK_EQ(status_of(exchange(options.port,
+        "POST /txt2img HTTP/1.1\r\nHost: x\r\nTransfer-Encoding: chunked\r\nContent-Length: 5\r\n\r\n0\r\n\r\n")), 400);
+    CHECK_EQ(status_of(exchange(options.port,
+        "POST /txt2img HTTP/1.1\r\nHost: x\r\nTransfer-Encoding: chunked\r\nTransfer-Encoding: chunked\r\n\r\n0\r\n\r\n")), 400);
+    CHECK_EQ(status_of(exchange(options.port,
+        "POST /txt2img HTTP/1.1\r\nHost: x\r\nContent-Length: 5\r\nContent-Length: 6\r\n\r\nhello")), 400);
+    CHECK_EQ(status_of(exchange(options.port,
+        "POST /txt2img HTTP/1.1\r\nHost: x\r\nTransfer-Encoding: gzip\r\n\r\n")), 501);
+    CHECK_EQ(status_of(exchange(options.port,
+        "POST /txt2img HTTP/1.1\r\nHost: x\r\nContent-Length: -1\r\n\r\n")), 400);
+    CHECK(backend.heads().empty());
+
+    // Client-sent peer headers are dropped; the only one is the front end's
+    const std::string response = exchange(options.port,
+        "GET /queue HTTP/1.1\r\nHost: x\r\nX-Sdcpp-Peer: forged 10.0.0.1\r\n"
+        "x-sdcpp-peer: forged 10.0.0.2\r\nConnection: close\r\n\r\n");
+    CHECK_EQ(status_of(response), 200);
+    const auto heads = backend.heads();
+    CHECK_EQ(heads.size(), 1u);
+    if (!heads.empty()) {
+        const auto peers = header_values(heads[0], sdcpp::PEER_HEADER);
+        CHECK_EQ(peers.size(), 1u);
+        if (!peers.empty()) CHECK_EQ(peers[0], fe.peer_token() + " 127.0.0.1");
+        CHECK(heads[0].find("forged") == std::string::npos);
+        CHECK(header_values(heads[0], "Connection") == std::vector<std::string>{"close"});
+    }
+
+    fe.request_stop();
+    fe.stop();
+}
+
+} // namespace
+
+int main() {
+    if (!HttpFrontEnd::supported()) {
+        std::cout << "[test_http_front_end] skipped (no epoll)" << std::endl;
+        return EXIT_SUCCESS;
+    }
+    test_framing_and_peer_header();
+    return sdcpp_test::finish("test_http_front_end");
+}
@@ -0,0 +1,252 @@
+#include "job_scheduler.hpp"
+#include "test_common.hpp"
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using sdcpp::JobPriority;
+using sdcpp::JobScheduler;
+using Clock = std::chrono::system_clock;
+
+namespace {
+
+sdcpp::QueueConfig make_config() {
+    sdcpp::QueueConfig config;
+    config.scheduler = "affinity";
+    config.affinity_lookahead = 8;
+    config.affinity_max_skips = 2;
+    config.affinity_max_wait_seconds = 300;
+    config.priority_aging_seconds = 600;
+    config.fair_share_half_life_seconds = 600;
+    return config;
+}
+
+JobScheduler::Candidate job(const std::string& id, JobPriority priority = JobPriority::Normal,
+                            int waited_seconds = 0, const std::string& owner = "",
+                            const std::string& key = "") {
+    JobScheduler::Candidate c;
+    c.job_id = id;
+    c.priority = priority;
+    c.created_at = Clock::now() - std::chrono::seconds(waited_seconds);
+    c.owner = owner;
+    c.affinity_key = key;
+    return c;
+}
+
+std::vector<std::string> ids(const std::vector<JobScheduler::Candidate>& candidates) {
+    std::vector<std::string> out;
+    for (const auto& c : candidates) out.push_back(c.job_id);
+    return out;
+}
+
+// Make `key` the last one run (on generation worker `worker`)
+void run_key(JobScheduler& scheduler, const std::string& key, int worker = 0) {
+    std::vector<JobScheduler::Candidate> one{job("warmup-" + key, JobPriority::Normal, 0, "", key)};
+    scheduler.rank(one);
+    scheduler.pick(one, nullptr, worker);
+}
+
+void test_rank_by_class_then_queue_order() {
+    JobScheduler scheduler(make_config());
+    std::vector<JobScheduler::Candidate> candidates{
+        job("batch", JobPriority::Batch, 30),
+        job("normal-1", JobPriority::Normal, 20),
+        job("interactive", JobPriority::Interactive, 10),
+        job("normal-2", JobPriority::Normal, 5),
+    };
+    scheduler.rank(candidates);
+    CHECK(ids(candidates) == (std::vector<std::string>{"interactive", "normal-1", "normal-2", "batch"}));
+
+    JobScheduler::Reason reason = JobScheduler::Reason::Fifo;
+    CHECK_EQ(scheduler.pick(candidates, &reason), 0u);
+    CHECK(reason == JobScheduler::Reason::Priority);
+}
+
+void test_rank_keeps_lookahead() {
+    auto config = make_config();
+    config.affinity_lookahead = 2;
+    JobScheduler scheduler(config);
+    std::vector<JobScheduler::Candidate> candidates{job("a"), job("b"), job("c")};
+    scheduler.rank(candidates);
+    CHECK(ids(candidates) == (std::vector<std::string>{"a", "b"}));
+
+    config.scheduler = "fifo";
+    JobScheduler fifo(config);
+    CHECK_EQ(fifo.lookahead(), 1u);
+}
+
+void test_aging() {
+    JobScheduler scheduler(make_config());
+    const auto now = Clock::now();
+    CHECK(scheduler.effective_priority(JobPriority::Batch, now, now) == JobPriority::Batch);
+    CHECK(scheduler.effective_priority(JobPriority::Batch, now - std::chrono::seconds(600), now) ==
+          JobPriority::Normal);
+    CHECK(scheduler.effective_priority(JobPriority::Batch, now - std::chrono::seconds(5000), now) ==
+          JobPriority::Interactive);
+
+    // An old batch job has aged into the normal class and is older than the normal job
+    std::vector<JobScheduler::Candidate> candidates{
+        job("normal", JobPriority::Normal, 10),
+        job("old-batch", JobPriority::Batch, 700),
+    };
+    scheduler.rank(candidates);
+    CHECK(ids(candidates) == (std::vector<std::string>{"normal", "old-batch"}));
+
+    auto config = make_config();
+    config.priority_aging_seconds = 0;
+    JobScheduler never(config);
+    CHECK(never.effective_priority(JobPriority::Batch, now - std::chrono::hours(24), now) == JobPriority::Batch);
+}
+
+void test_fair_share_within_class() {
+    JobScheduler scheduler(make_config());
+    scheduler.charge("alice", 120.0);
+    std::vector<JobScheduler::Candidate> candidates{
+        job("alice-1", JobPriority::Normal, 20, "alice"),
+        job("bob-1", JobPriority::Normal, 10, "bob"),
+        job("alice-urgent", JobPriority::Interactive, 5, "alice"),
+    };
+    scheduler.rank(candidates);
+    // Class first, then the user with less recent generation time
+    CHECK(ids(candidates) == (std::vector<std::string>{"alice-urgent", "bob-1", "alice-1"}));
+}
+
+void test_affinity_within_class() {
+    JobScheduler scheduler(make_config());
+    run_key(scheduler, "model=a|lora=x:1");
+
+    std::vector<JobScheduler::Candidate> candidates{
+        job("other", JobPriority::Normal, 20, "", "model=a"),
+        job("same", JobPriority::Normal, 10, "", "model=a|lora=x:1"),
+    };
+    scheduler.rank(candidates);
+    JobScheduler::Reason reason = JobScheduler::Reason::Fifo;
+    CHECK_EQ(scheduler.pick(candidates, &reason), 1u);
+    CHECK(reason == JobScheduler::Reason::Affinity);
+}
+
+void test_affinity_never_crosses_a_class() {
+    JobScheduler scheduler(make_config());
+    run_key(scheduler, "model=a|lora=x:1");
+
+    // The matching job is of a worse class: the head runs
+    std::vector<JobScheduler::Candidate> candidates{
+        job("interactive", JobPriority::Interactive, 5, "", "model=a"),
+        job("normal-same", JobPriority::Normal, 10, "", "model=a|lora=x:1"),
+    };
+    scheduler.rank(candidates);
+    CHECK_EQ(scheduler.pick(candidates), 0u);
+
+    // A batch job aged into the head's class may still be preferred
+    run_key(scheduler, "model=a|lora=x:1");
+    std::vector<JobScheduler::Candidate> aged{
+        job("normal", JobPriority::Normal, 5, "", "model=a"),
+        job("batch-aged", JobPriority::Batch, 650, "", "model=a|lora=x:1"),
+    };
+    scheduler.rank(aged);
+    CHECK(ids(aged) == (std::vector<std::string>{"normal", "batch-aged"}));
+    CHECK_EQ(scheduler.pick(aged), 1u);
+}
+
+void test_affinity_per_worker() {
+    JobScheduler scheduler(make_config());
+    run_key(scheduler, "lora-a", 0);
+    run_key(scheduler, "lora-b", 1);
+
+    auto candidates = [] {
+        return std::vector<JobScheduler::Candidate>{
+            job("a", JobPriority::Normal, 20, "", "lora-a"),
+            job("b", JobPriority::Normal, 10, "", "lora-b"),
+        };
+    };
+    // Each worker picks the job matching what its own context ran last
+    JobScheduler::Reason reason = JobScheduler::Reason::Fifo;
+    auto for_1 = candidates();
+    CHECK_EQ(scheduler.pick(for_1, &reason, 1), 1u);
+    CHECK(reason == JobScheduler::Reason::Affinity);
+    auto for_0 = candidates();
+    CHECK_EQ(scheduler.pick(for_0, &reason, 0), 0u);
+    CHECK(reason == JobScheduler::Reason::Affinity);
+
+    // A worker with no history takes the queue head
+    auto for_2 = candidates();
+    CHECK_EQ(scheduler.pick(for_2, &reason, 2), 0u);
+    CHECK(reason == JobScheduler::Reason::Fifo);
+}
+
+void test_fairness_bound() {
+    JobScheduler scheduler(make_config());
+    const std::string key = "model=a|lora=x:1";
+
+    // The head is passed over affinity_max_skips times, then forced through
+    for (int round = 0; round < 2; ++round) {
+        run_key(scheduler, key);
+        std::vector<JobScheduler::Candidate> candidates{
+            job("head", JobPriority::Normal, 20, "", "model=b"),
+            job("match-" + std::to_string(round), JobPriority::Normal, 10, "", key),
+        };
+        CHECK_EQ(scheduler.pick(candidates), 1u);
+    }
+    run_key(scheduler, key);
+    std::vector<JobScheduler::Candidate> candidates{
+        job("head", JobPriority::Normal, 20, "", "model=b"),
+        job("match-2", JobPriority::Normal, 10, "", key),
+    };
+    JobScheduler::Reason reason = JobScheduler::Reason::Fifo;
+    CHECK_EQ(scheduler.pick(candidates, &reason), 0u);
+    CHECK(reason == JobScheduler::Reason::Fairness);
+
+    // Waiting affinity_max_wait_seconds forces the head too
+    run_key(scheduler, key);
+    std::vector<JobScheduler::Candidate> waited{
+        job("old-head", JobPriority::Normal, 400, "", "model=b"),
+        job("match-3", JobPriority::Normal, 10, "", key),
+    };
+    CHECK_EQ(scheduler.pick(waited, &reason), 0u);
+    CHECK(reason == JobScheduler::Reason::Fairness);
+}
+
+void test_affinity_key() {
+    const nlohmann::json settings = {{"model_name", "sdxl.safetensors"}};
+    CHECK_EQ(JobScheduler::affinity_key(nlohmann::json::object(), settings),
+             std::string("model=sdxl.safetensors"));
+    CHECK_EQ(JobScheduler::affinity_key(nullptr, nullptr), std::string("model="));
+
+    // LoRA order in the prompt does not matter
+    const nlohmann::json a = {{"prompt", "a <lora:b:0.5> cat <lora:a:1>"}, {"detector", "face"}};
+    const nlohmann::json b = {{"prompt", "<lora:a:1> a cat"}, {"negative_prompt", "<lora:b:0.5>"},
+                              {"detector", "face"}};
+    CHECK_EQ(JobScheduler::affinity_key(a, settings), JobScheduler::affinity_key(b, settings));
+    CHECK_EQ(JobScheduler::affinity_key(a, settings),
+             std::string("model=sdxl.safetensors|lora=a:1,b:0.5|detector=face"));
+}
+
+void test_priority_strings() {
+    CHECK(sdcpp::string_to_job_priority("interactive") == JobPriority::Interactive);
+    CHECK(sdcpp::string_to_job_priority("batch") == JobPriority::Batch);
+    CHECK_EQ(std::string(sdcpp::job_priority_to_string(JobPriority::Normal)), std::string("normal"));
+    bool threw = false;
+    try {
+        sdcpp::string_to_job_priority("urgent");
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    CHECK(threw);
+}
+
+} // namespace
+
+int main() {
+    test_rank_by_class_then_queue_order();
+    test_rank_keeps_lookahead();
+    test_aging();
+    test_fair_share_within_class();
+    test_affinity_within_class();
+    test_affinity_never_crosses_a_class();
+    test_affinity_per_worker();
+    test_fairness_bound();
+    test_affinity_key();
+    test_priority_strings();
+    return sdcpp_test::finish("test_job_scheduler");
+}
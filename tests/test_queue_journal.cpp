@@ -0,0 +1,120 @@
+#include "queue_journal.hpp"
+#include "test_common.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+using sdcpp::QueueJournal;
+namespace fs = std::filesystem;
+
+namespace {
+
+fs::path fresh_dir(const std::string& name) {
+    const fs::path dir = fs::temp_directory_path() / ("sdcpp_test_" + name + "_" + std::to_string(::getpid()));
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+    return dir;
+}
+
+nlohmann::json item(const std::string& id, const std::string& status) {
+    return {{"job_id", id}, {"status", status}};
+}
+
+// Items by job id, as load() returns them
+std::vector<std::string> summary(const std::vector<nlohmann::json>& items) {
+    std::vector<std::string> out;
+    for (const auto& j : items) out.push_back(j.value("job_id", "") + "=" + j.value("status", ""));
+    return out;
+}
+
+void test_replay_snapshot_and_tail() {
+    const fs::path dir = fresh_dir("journal_replay");
+    const std::string state = (dir / "queue_state.json").string();
+    {
+        std::ofstream snapshot(state);
+        snapshot << nlohmann::json{{"items", {item("a", "pending"), item("b", "pending")}}}.dump();
+        std::ofstream journal(state + ".journal");
+        journal << nlohmann::json{{"op", "put"}, {"item", item("c", "pending")}}.dump() << "\n"
+                << nlohmann::json{{"op", "put"}, {"item", item("a", "completed")}}.dump() << "\n"
+                << nlohmann::json{{"op", "del"}, {"job_id", "b"}}.dump() << "\n"
+                << "\n"
+                << nlohmann::json{{"op", "put"}, {"item", {{"status", "no id"}}}}.dump() << "\n"
+                // Torn by a crash: this and everything after it is dropped
+                << R"({"op":"put","item":{"job_id":"d")" << "\n"
+                << nlohmann::json{{"op", "put"}, {"item", item("e", "pending")}}.dump() << "\n";
+    }
+
+    QueueJournal journal(state);
+    const auto items = journal.load();
+    CHECK(summary(items) == (std::vector<std::string>{"a=completed", "c=pending"}));
+
+    // load() folded the tail into the snapshot
+    CHECK_EQ(fs::file_size(state + ".journal"), 0u);
+    QueueJournal again(state);
+    CHECK(summary(again.load()) == summary(items));
+    fs::remove_all(dir);
+}
+
+void test_writer_round_trip() {
+    const fs::path dir = fresh_dir("journal_round_trip");
+    const std::string state = (dir / "queue_state.json").string();
+    {
+        QueueJournal journal(state, 3);
+        CHECK(journal.load().empty());
+        journal.start();
+        for (int i = 0; i < 10; ++i) journal.put("job" + std::to_string(i), item("job" + std::to_string(i), "pending"));
+        journal.put("job3", item("job3", "failed"));
+        journal.erase("job5");
+        journal.erase("unknown");
+        journal.flush();
+
+        const auto stats = journal.stats_json();
+        CHECK_EQ(stats["records_written"].get<uint64_t>(), 13u);
+        CHECK(stats["compactions"].get<uint64_t>() >= 1u);
+        CHECK(stats["journal_length"].get<size_t>() < 3u);
+
+        // A second reader sees the flushed state while the writer still runs
+        QueueJournal reader((dir / "copy.json").string());
+        fs::copy_file(state, dir / "copy.json");
+        if (fs::exists(state + ".journal")) fs::copy_file(state + ".journal", dir / "copy.json.journal");
+        CHECK_EQ(reader.load().size(), 9u);
+        journal.stop();
+    }
+
+    QueueJournal journal(state);
+    const auto items = journal.load();
+    CHECK_EQ(items.size(), 9u);
+    for (const auto& j : items) {
+        const std::string id = j.value("job_id", "");
+        CHECK(id != "job5");
+        if (id == "job3") CHECK_EQ(j.value("status", ""), std::string("failed"));
+    }
+    fs::remove_all(dir);
+}
+
+void test_unreadable_snapshot() {
+    const fs::path dir = fresh_dir("journal_unreadable");
+    const std::string state = (dir / "queue_state.json").string();
+    {
+        std::ofstream snapshot(state);
+        snapshot << "{not json";
+        std::ofstream journal(state + ".journal");
+        journal << nlohmann::json{{"op", "put"}, {"item", item("a", "pending")}}.dump() << "\n";
+    }
+    QueueJournal journal(state);
+    CHECK(summary(journal.load()) == std::vector<std::string>{"a=pending"});
+    fs::remove_all(dir);
+}
+
+} // namespace
+
+int main() {
+    test_replay_snapshot_and_tail();
+    test_writer_round_trip();
+    test_unreadable_snapshot();
+    return sdcpp_test::finish("test_queue_journal");
+}
@@ -134,6 +134,11 @@ export interface HealthResponse {
      */
     sefi_image?: boolean
     auth_required?: boolean
+    /** Video containers this build can write; mp4/webm need FFmpeg */
+    video_output?: {
+      ffmpeg: string | null
+      containers: VideoFormat[]
+    }
   }
 }
 
@@ -201,6 +206,7 @@ export interface GenerationParams {
   // Optional display title attached to the queue job. Stored on the
   // QueueItem (not on params) and surfaced in the WebUI Queue card.
   title?: string
+  priority?: JobPriority
   negative_prompt?: string
   width?: number
   height?: number
@@ -286,11 +292,17 @@ export interface GenerationParams {
   upscale?: boolean
   upscale_repeats?: number
   upscale_auto_unload?: boolean
+  // Output encoding; omitted = server "output" config defaults.
+  // 'webp' only when /health features.webp_output is true.
+  output_format?: OutputFormat
+  output_quality?: number
 
   // When true, prompt is parsed for {a|b|c} / {N$$a|b|c} dynamic-prompts
   // syntax and expanded into multiple queue items sharing a variation_group_id.
   // The response then contains group_id + job_ids[] instead of a single job_id.
-  expand_prompt?: boolean
+  // 'sweep' (implied above 200 variations) queues one job that walks the
+  // variations itself; the response then has job_id + sweep: true.
+  expand_prompt?: boolean | 'sweep'
 }
 
 export interface Img2ImgParams extends GenerationParams {
@@ -329,14 +341,47 @@ export interface Txt2VidParams extends GenerationParams {
   high_noise_slg_end?: number
   moe_boundary?: number
   vace_strength?: number
+  /** Video container; 'none' writes frames only. Default from server config. */
+  video_format?: VideoFormat | 'none'
+  video_codec?: 'h264' | 'vp9' | 'av1'
+  /** Also write every frame as PNG next to the video */
+  keep_frames?: boolean
 }
 
+export type OutputFormat = 'png' | 'jpeg' | 'webp'
+
+export type JobPriority = 'interactive' | 'normal' | 'batch'
+
+export type VideoFormat = 'mp4' | 'webm' | 'avi'
+
 export interface UpscaleParams {
   image_base64: string
   title?: string
+  priority?: JobPriority
   upscale_factor?: number
   tile_size?: number
   repeats?: number
+  pass_tile_size?: number
+  tile_overlap?: number
+  output_format?: OutputFormat
+  output_quality?: number
+}
+
+// One /pipeline stage: the stage type plus that endpoint's own params.
+// Stages after the first take their input image from the previous stage.
+export type PipelineStage =
+  | ({ type: 'txt2img'; persist?: boolean } & Partial<GenerationParams>)
+  | ({ type: 'img2img'; persist?: boolean } & Partial<Img2ImgParams>)
+  | ({ type: 'upscale'; persist?: boolean } & Partial<Omit<UpscaleParams, 'image_base64'>>)
+  | { type: 'adetailer'; persist?: boolean; detector: string; prompt?: string; negative_prompt?: string; extra_ad_args?: string; inpaint_params?: Record<string, unknown> }
+
+export interface PipelineParams {
+  stages: PipelineStage[]
+  persist_intermediate?: boolean
+  output_format?: OutputFormat
+  output_quality?: number
+  title?: string
+  priority?: JobPriority
 }
 
 export interface LoadUpscalerParams {
@@ -385,7 +430,7 @@ export interface JobModelSettings {
 
 export interface Job {
   job_id: string
-  type: 'txt2img' | 'img2img' | 'txt2vid' | 'upscale' | 'convert' | 'model_download' | 'model_hash'
+  type: 'txt2img' | 'img2img' | 'txt2vid' | 'upscale' | 'convert' | 'model_download' | 'model_hash' | 'pipeline'
   status: 'pending' | 'processing' | 'completed' | 'failed' | 'cancelled' | 'deleted'
   progress: JobProgress
   created_at: string
@@ -395,10 +440,17 @@ export interface Job {
   previous_status?: string     // Status before deletion (only for deleted items)
   outputs: string[]
   params?: Record<string, unknown>
+  /** Set when `params` is the short form of a listing; GET /queue/{id} has the full params */
+  params_file?: string
   model_settings?: JobModelSettings
   error?: string
   linked_job_id?: string
   title?: string
+  priority?: JobPriority
+  /** User who queued the job (auth enabled only) */
+  owner?: string
+  /** Facts recorded while the job ran, e.g. `lora` (applied-set delta, apply timing) */
+  metadata?: Record<string, unknown>
 }
 
 export interface RecycleBinResponse {
@@ -475,6 +527,8 @@ export interface JobSubmitResponse {
   group_id?: string
   variation_count?: number
   job_ids?: string[]
+  // Sweep submission: a single job_id covering variation_count prompts
+  sweep?: boolean
 }
 
 export interface ModelHashResponse {
@@ -747,6 +801,11 @@ class ApiClient {
     return this.request('POST', '/models/load', params)
   }
 
+  // Read a model's files into RAM while the current one keeps generating
+  async prefetchModel(params: LoadModelParams): Promise<{ model_name: string; state: string; files?: number; bytes?: number; available_bytes?: number }> {
+    return this.request('POST', '/models/prefetch', params)
+  }
+
   async unloadModel(): Promise<{ success: boolean; message: string }> {
     return this.request('POST', '/models/unload', {})
   }
@@ -818,12 +877,14 @@ class ApiClient {
     signal?: AbortSignal
   ): Promise<UploadModelResponse> {
     return new Promise<UploadModelResponse>((resolve, reject) => {
+      // Text fields go first: the server then knows the destination
+      // before the file bytes arrive and streams them straight there
       const form = new FormData()
-      form.append('file', file, file.name)
       form.append('model_type', modelType)
       if (subfolder && subfolder.trim().length > 0) {
         form.append('subfolder', subfolder.trim())
       }
+      form.append('file', file, file.name)
 
       const xhr = new XMLHttpRequest()
       xhr.open('POST', this.baseUrl + '/models/upload', true)
@@ -927,6 +988,10 @@ class ApiClient {
     return this.request('POST', '/upscale', params)
   }
 
+  async runPipeline(params: PipelineParams): Promise<JobSubmitResponse> {
+    return this.request('POST', '/pipeline', params)
+  }
+
   async convert(params: ConvertParams): Promise<ConvertResponse> {
     return this.request('POST', '/convert', params)
   }
@@ -998,6 +1063,7 @@ class ApiClient {
 
   // Restart a job by resubmitting with same params
   async restartJob(job: Job): Promise<JobSubmitResponse> {
+    if (job.params_file) job = await this.getJob(job.job_id)
     if (!job.params) {
       throw new ApiError('Job has no parameters to restart', 400)
     }
@@ -1010,6 +1076,8 @@ class ApiClient {
         return this.txt2vid(job.params as unknown as Txt2VidParams)
       case 'upscale':
         return this.upscale(job.params as unknown as UpscaleParams)
+      case 'pipeline':
+        return this.runPipeline(job.params as unknown as PipelineParams)
       default:
         throw new ApiError(`Unknown job type: ${job.type}`, 400)
     }
@@ -1188,6 +1256,8 @@ export interface PreviewSettings {
   interval: number
   max_size: number
   quality: number
+  on_demand?: boolean
+  max_overhead_percent?: number
 }
 
 export interface PreviewSettingsUpdateResponse {
@@ -1404,6 +1474,8 @@ export interface DownloadParams {
   repo_id?: string   // For HuggingFace
   filename?: string  // For HuggingFace or custom filename
   revision?: string  // For HuggingFace
+  connections?: number     // Parallel range connections (1-16)
+  max_speed_kbps?: number  // Bandwidth cap in KiB/s, 0 = unlimited
 }
 
 export interface DownloadResponse {
@@ -18,6 +18,7 @@ export type WSEventType =
   | 'server_status'
   | 'server_shutdown'
   | 'memory_status'
+  | 'subscribed'
   | 'pong'
 
 // Event data interfaces
@@ -55,6 +56,36 @@ export interface JobPreviewData {
   height: number
   is_noisy: boolean
   preview_url: string  // URL to fetch preview image (e.g., /jobs/{id}/preview)
+  image?: Blob         // JPEG delivered inline as a binary frame (no fetch needed)
+}
+
+// Binary preview frame header (see "Binary Preview Frames" in docs/API.md)
+const PREVIEW_FRAME_MAGIC = 'SDPV'
+const PREVIEW_FRAME_JOB_ID_OFFSET = 24
+const PREVIEW_FRAME_JOB_ID_LENGTH = 36
+
+function parsePreviewFrame(buffer: ArrayBuffer): JobPreviewData | null {
+  if (buffer.byteLength < 64) return null
+  const view = new DataView(buffer)
+  const magic = String.fromCharCode(view.getUint8(0), view.getUint8(1), view.getUint8(2), view.getUint8(3))
+  if (magic !== PREVIEW_FRAME_MAGIC) return null
+  const headerLength = view.getUint16(6, true)
+  if (headerLength > buffer.byteLength) return null
+
+  const idBytes = new Uint8Array(buffer, PREVIEW_FRAME_JOB_ID_OFFSET, PREVIEW_FRAME_JOB_ID_LENGTH)
+  const nul = idBytes.indexOf(0)
+  const jobId = new TextDecoder().decode(nul >= 0 ? idBytes.subarray(0, nul) : idBytes)
+
+  return {
+    job_id: jobId,
+    step: view.getUint32(8, true),
+    frame_count: view.getUint32(12, true),
+    width: view.getUint32(16, true),
+    height: view.getUint32(20, true),
+    is_noisy: (view.getUint8(5) & 1) !== 0,
+    preview_url: `/jobs/${jobId}/preview`,
+    image: new Blob([buffer.slice(headerLength)], { type: 'image/jpeg' })
+  }
 }
 
 export interface JobCancelledData {
@@ -203,6 +234,7 @@ class WebSocketService {
 
     try {
       this.ws = new WebSocket(this.url)
+      this.ws.binaryType = 'arraybuffer'
 
       this.ws.onopen = () => {
         console.log('[WebSocket] Connected')
@@ -210,9 +242,18 @@ class WebSocketService {
         this.reconnectDelay = 1000
         this.updateState('connected')
         this.startPingInterval()
+        // Receive previews inline as binary frames instead of fetching each one
+        this.send({ type: 'subscribe', binary_previews: true })
       }
 
       this.ws.onmessage = (event) => {
+        if (event.data instanceof ArrayBuffer) {
+          const preview = parsePreviewFrame(event.data)
+          if (preview) {
+            this.handleMessage({ event: 'job_preview', timestamp: new Date().toISOString(), data: preview })
+          }
+          return
+        }
         try {
           const message = JSON.parse(event.data) as WSMessage
           this.handleMessage(message)
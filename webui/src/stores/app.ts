@@ -743,18 +743,21 @@ export const useAppStore = defineStore('app', () => {
       })
     )
 
-    // Handle live preview images - fetch via HTTP
+    // Handle live preview images - inline binary frame, or fetch via HTTP
     wsUnsubscribers.push(
       wsService.on<JobPreviewData>('job_preview', async (data) => {
         try {
-          // Fetch preview image from server
-          const response = await fetch(data.preview_url)
-          if (!response.ok) {
-            console.warn(`[Preview] Failed to fetch: ${response.status}`)
-            return
+          let blob = data.image
+          if (!blob) {
+            // Fetch preview image from server
+            const response = await fetch(data.preview_url)
+            if (!response.ok) {
+              console.warn(`[Preview] Failed to fetch: ${response.status}`)
+              return
+            }
+            blob = await response.blob()
           }
 
-          const blob = await response.blob()
           const imageUrl = URL.createObjectURL(blob)
 
           // Revoke previous blob URL to prevent memory leak